@@ -0,0 +1,615 @@
+/*
+ * This program measures file growth and update throughput of sparse structured chunks that change
+ * size on every rewrite.  Structured chunks are emulated as described in structured_chunk.h.
+ *
+ * The program creates a file "alloc_file.h5" with one 2-dim dataset "sparse" that has G1 x G2 chunks
+ * (command line option -g).  Each chunk starts with the density specified with the option -m (percent
+ * of defined elements) and is then updated incrementally: every update picks a random chunk, defines
+ * A more random elements in it (option -a), re-encodes the selection and the data and rewrites the
+ * chunk.  The updates are done in N sessions (option -n); the file is closed and reopened between
+ * sessions as a long-running writer does when it is restarted.
+ *
+ * Two allocation policies for the rewritten chunks can be compared (option -p):
+ *
+ *  0 - default; every chunk is stored with its exact size.  The library allocates new space each time
+ *      a chunk grows and the old space becomes a free-space hole.
+ *  1 - slack policy; a chunk is stored with slack capacity (option -l, percent of the used size)
+ *      rounded up to a size class.  Four size classes between consecutive powers of two allow
+ *      holes left by one chunk to be reused by chunks of the same class.  A chunk that still fits
+ *      into its allocation is rewritten in place.
+ *
+ * The free-space management of the file is specified with the option -f:
+ *
+ *  0 - default; library free-space tracking that is lost when the file is closed
+ *  1 - persistent free-space managers (H5F_FSPACE_STRATEGY_FSM_AGGR), so that holes are reused
+ *      across sessions
+ *
+ * The program reports, for each session, the size of the live structured chunks (prefix and sections
+ * without slack), the allocated chunk size (with slack), the file size, the ratio of the file size
+ * to the live size and the number of updates per second.
+ *
+ * To compile the program, please use h5cc.  The -h option lists all the command line options:
+ *
+ *   [-h] [-c --dimsChunk] [-g --gridChunks] [-m --mPercent] [-a --aElements] [-u --uUpdates]
+ *   [-n --nSessions] [-p --pPolicy] [-l --lSlack] [-f --fSpace] [-d --dRandom] [-v --Verbose]
+ *
+ * Example: The commands
+ *
+ *           h5cc alloc.c
+ *           ./a.out -c 256x256 -g 8x8 -u 4000 -n 5 -p 0
+ *           ./a.out -c 256x256 -g 8x8 -u 4000 -n 5 -p 1 -f 1
+ *
+ * compare the file growth of 64 chunks of 256x256 elements updated 20000 times with the default
+ * allocation and with the slack policy and persistent free-space managers.
+ */
+
+#include "hdf5.h"
+#include "structured_chunk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <time.h>
+#include <string.h>
+#include <getopt.h>
+
+#define FILE_NAME                       "alloc_file.h5"
+#define DSET_NAME                       "sparse"
+#define CHUNK_DIM1                      256
+#define CHUNK_DIM2                      256
+#define GRID_DIM1                       8
+#define GRID_DIM2                       8
+#define RANK                            2
+#define START_PERCENT                   1
+#define ADD_ELEMENTS                    64
+#define UPDATES                         4000
+#define SESSIONS                        5
+#define SLACK_PERCENT                   25
+#define MAX_SESSIONS                    100
+
+typedef struct {
+    long long int   chunk_dim1;
+    long long int   chunk_dim2;
+    long long int   grid_dim1;
+    long long int   grid_dim2;
+    int             start_percent;
+    int             add_elements;
+    int             updates;
+    int             sessions;
+    int             policy;          /* allocation policy for rewritten chunks */
+    int             slack;           /* slack capacity in percent of the used size */
+    int             fspace;          /* flag to use persistent free-space managers */
+    int             d;               /* flag to generate random or compressible data values */
+    int             v;               /* prints progress messages */
+} handler_t;
+
+typedef struct {
+    long long int   live;            /* size of the used part of the structured chunks */
+    long long int   allocated;       /* size of the stored chunks including slack */
+    long long int   file;            /* size of the file */
+    double          seconds;         /* time spent on updates */
+} storage_t;
+
+typedef struct {
+    uint8_t        *mask;            /* defined elements of the chunk */
+    uint8_t        *values;          /* values of the elements of the chunk */
+    size_t          used;            /* size of the used part of the stored chunk */
+    size_t          allocated;       /* size of the stored chunk */
+} chunk_t;
+
+handler_t    hand;
+storage_t    st[MAX_SESSIONS];
+chunk_t     *chunks;
+
+/*------------------------------------------------------------
+ * Display command line usage
+ *------------------------------------------------------------
+ */
+void
+usage(void)
+{
+    printf("    [-h] [-c --dimsChunk] [-g --gridChunks] [-m --mPercent] [-a --aElements] [-u --uUpdates]\n");
+    printf("    [-n --nSessions] [-p --pPolicy] [-l --lSlack] [-f --fSpace] [-d --dRandom] [-v --Verbose]\n");
+    printf("    [-h --help]: this help page\n");
+    printf("    [-c --dimsChunk]: the 2D dimensions of the chunks in elements, e.g. 256x256\n");
+    printf("    [-g --gridChunks]: the number of chunks in each dimension of the dataset, e.g. 8x8\n");
+    printf("    [-m --mPercent]: the initial percentage of defined elements in each chunk\n");
+    printf("    [-a --aElements]: the number of elements defined by each update of a chunk\n");
+    printf("    [-u --uUpdates]: the number of chunk updates in each session\n");
+    printf("    [-n --nSessions]: the number of sessions; the file is closed and reopened between sessions\n");
+    printf("    [-p --pPolicy]: allocation policy: exact chunk sizes (0) or slack capacity and size classes (1)\n");
+    printf("    [-l --lSlack]: slack capacity in percent of the used chunk size for policy 1\n");
+    printf("    [-f --fSpace]: library default free-space management (0) or persistent free-space managers (1)\n");
+    printf("    [-d --dRandom]: Use random data values (1) or compressible data values (0) \n");
+    printf("    [-v --Verbose]: Print progress messages(1); default no messages displayed (0) \n");
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Parse a string of the form AxB
+ *------------------------------------------------------------
+ */
+void
+parse_dims(const char *str, long long int *dim1, long long int *dim2)
+{
+    char *dims_str, *dim1_str, *dim2_str;
+
+    dims_str = strdup(str);
+    dim1_str = strtok(dims_str, "x");
+    dim2_str = strtok(NULL, "x");
+    *dim1    = dim1_str ? atoll(dim1_str) : 0;
+    *dim2    = dim2_str ? atoll(dim2_str) : 0;
+    free(dims_str);
+}
+
+/*------------------------------------------------------------
+ * Parse command line option
+ *------------------------------------------------------------
+ */
+void
+parse_command_line(int argc, char *argv[])
+{
+    int           opt;
+    struct option long_options[] = {
+                                    {"dimsChunk=", required_argument, NULL, 'c'},
+                                    {"gridChunks=", required_argument, NULL, 'g'},
+                                    {"help", no_argument, NULL, 'h'},
+                                    {"mPercent=", required_argument, NULL, 'm'},
+                                    {"aElements=", required_argument, NULL, 'a'},
+                                    {"uUpdates=", required_argument, NULL, 'u'},
+                                    {"nSessions=", required_argument, NULL, 'n'},
+                                    {"pPolicy=", required_argument, NULL, 'p'},
+                                    {"lSlack=", required_argument, NULL, 'l'},
+                                    {"fSpace=", required_argument, NULL, 'f'},
+                                    {"dRandom=", required_argument, NULL, 'd'},
+                                    {"Verbose=", required_argument, NULL, 'v'},
+                                    {NULL, 0, NULL, 0}};
+
+    /* Initialize the command line options */
+    hand.chunk_dim1    = CHUNK_DIM1;
+    hand.chunk_dim2    = CHUNK_DIM2;
+    hand.grid_dim1     = GRID_DIM1;
+    hand.grid_dim2     = GRID_DIM2;
+    hand.start_percent = START_PERCENT;
+    hand.add_elements  = ADD_ELEMENTS;
+    hand.updates       = UPDATES;
+    hand.sessions      = SESSIONS;
+    hand.policy        = SC_ALLOC_EXACT;
+    hand.slack         = SLACK_PERCENT;
+    hand.fspace        = 0;
+    hand.d             = 1;
+    hand.v             = 0;
+
+    while ((opt = getopt_long(argc, argv, "c:g:hm:a:u:n:p:l:f:d:v:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'c':
+                /* The dimensions of the chunks */
+                if (optarg) {
+                    parse_dims(optarg, &hand.chunk_dim1, &hand.chunk_dim2);
+                    fprintf(stdout, "Chunk dimensions:\t\t\t\t\t%lld x %lld\n", hand.chunk_dim1, hand.chunk_dim2);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'g':
+                /* The number of chunks in each dimension */
+                if (optarg) {
+                    parse_dims(optarg, &hand.grid_dim1, &hand.grid_dim2);
+                    fprintf(stdout, "Number of chunks:\t\t\t\t\t%lld x %lld\n", hand.grid_dim1, hand.grid_dim2);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'h':
+                fprintf(stdout, "Help page:\n");
+                usage();
+
+                exit(0);
+
+                break;
+            case 'm':
+                if (optarg) {
+                    fprintf(stdout, "Initial percentage of data density:\t\t\t%s\n", optarg);
+                    hand.start_percent = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'a':
+                if (optarg) {
+                    fprintf(stdout, "Elements defined by each update:\t\t\t%s\n", optarg);
+                    hand.add_elements = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'u':
+                if (optarg) {
+                    fprintf(stdout, "Updates in each session:\t\t\t\t%s\n", optarg);
+                    hand.updates = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'n':
+                if (optarg) {
+                    fprintf(stdout, "Number of sessions:\t\t\t\t\t%s\n", optarg);
+                    hand.sessions = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'p':
+                if (optarg) {
+                    hand.policy = atoi(optarg);
+                    if (hand.policy == SC_ALLOC_EXACT)
+                        fprintf(stdout, "Allocation policy:\t\t\t\t\texact chunk sizes\n");
+                    else if (hand.policy == SC_ALLOC_SLACK)
+                        fprintf(stdout, "Allocation policy:\t\t\t\t\tslack capacity and size classes\n");
+                    else
+                        fprintf(stdout, "Allocation policy:\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'l':
+                if (optarg) {
+                    fprintf(stdout, "Slack capacity in percent:\t\t\t\t%s\n", optarg);
+                    hand.slack = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'f':
+                if (optarg) {
+                    hand.fspace = atoi(optarg);
+                    if (hand.fspace == 0)
+                        fprintf(stdout, "Free-space management:\t\t\t\t\tlibrary default\n");
+                    else if (hand.fspace == 1)
+                        fprintf(stdout, "Free-space management:\t\t\t\t\tpersistent free-space managers\n");
+                    else
+                        fprintf(stdout, "Free-space management:\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'd':
+                if (optarg) {
+                    hand.d = atoi(optarg);
+                    if (hand.d == 1)
+                        fprintf(stdout, "Options of data generation:\t\t\t\trandom values\n");
+                    else if (hand.d == 0)
+                        fprintf(stdout, "Options of data generation:\t\t\t\tcompressible values\n");
+                    else
+                        fprintf(stdout, "Options of data generation:\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'v':
+                if (optarg) {
+                    hand.v = atoi(optarg);
+                    if (hand.v == 1)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\ton\n");
+                    else if (hand.v == 0)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Verbose mode:\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case ':':
+                printf("Option needs a value\n");
+                break;
+            case '?':
+                printf("Unknown option: %c\n", optopt);
+                break;
+        }
+    }
+
+    /* optind is for the extra arguments which are not parsed */
+    for (; optind < argc; optind++) {
+        printf("extra arguments not parsed: %s\n", argv[optind]);
+    }
+
+    /* Make sure the command line options are valid */
+    if (hand.chunk_dim1 < 1 || hand.chunk_dim2 < 1 || hand.grid_dim1 < 1 || hand.grid_dim2 < 1) {
+        printf("The dimensions of the chunks and the number of chunks must be positive\n");
+        exit(1);
+    }
+
+    if (hand.start_percent < 0 || hand.start_percent > 100) {
+        printf("The initial percentage of the data density isn't valid\n");
+        exit(1);
+    }
+
+    if (hand.add_elements < 1 || hand.updates < 1) {
+        printf("The number of elements per update and the number of updates must be positive\n");
+        exit(1);
+    }
+
+    if (hand.sessions < 1 || hand.sessions > MAX_SESSIONS) {
+        printf("The number of sessions must be between 1 and %d\n", MAX_SESSIONS);
+        exit(1);
+    }
+
+    if (hand.policy < SC_ALLOC_EXACT || hand.policy > SC_ALLOC_SLACK) {
+        printf("The allocation policy can only be 0 (exact) or 1 (slack)\n");
+        exit(1);
+    }
+
+    if (hand.slack < 0) {
+        printf("The slack capacity can't be negative\n");
+        exit(1);
+    }
+
+    if (hand.fspace < 0 || hand.fspace > 1) {
+        printf("Free-space management flag can only be 0 (default) or 1 (persistent)\n");
+        exit(1);
+    }
+
+    if (hand.d < 0 || hand.d > 1) {
+        printf("Data generation flag can only be 0 (compressible data) or 1 (random)\n");
+        exit(1);
+    }
+
+    if (hand.v < 0 || hand.v > 1) {
+        printf("Verbose flag can only be 0 or 1 \n");
+        exit(1);
+    }
+}
+
+/*------------------------------------------------------------
+ * Print live and allocated storage, file size and update rate
+ *------------------------------------------------------------
+ */
+void print_results(int index)
+{
+    int           i;
+    long long int a;
+    long long int b;
+    long long int c;
+    float         d;
+    float         e;
+
+    printf("\n");
+    printf("Printing session, live structured storage size (LSS), allocated chunk storage size (ACS), file size (FS),\n");
+    printf("file growth ratio (GR = FS/LSS) and updates per second (UPS)\n");
+    printf("\n");
+    printf("   session        LSS        ACS         FS         GR        UPS\n");
+    printf("\n");
+
+    for (i = 0; i < index; i++) {
+        a = st[i].live;
+        b = st[i].allocated;
+        c = st[i].file;
+        d = (float)c / a;
+        e = (float)(hand.updates / st[i].seconds);
+        printf("%10d %10lli %10lli %10lli %10.2f %10.0f \n", i + 1, a, b, c, d, e);
+    }
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Define "nelemts" random elements of a chunk
+ *------------------------------------------------------------
+ */
+void define_elements(chunk_t *chunk, uint64_t nelemts)
+{
+    uint64_t size = hand.chunk_dim1 * hand.chunk_dim2;
+    uint64_t i;
+
+    for (i = 0; i < nelemts; i++) {
+        uint64_t k = ((uint64_t)rand() * RAND_MAX + rand()) % size;
+
+        chunk->mask[k] = 1;
+        if (hand.d)
+            chunk->values[k] = rand() % UCHAR_MAX + 1;
+        else
+            chunk->values[k] = (k + 1) % UCHAR_MAX;
+    }
+}
+
+/*------------------------------------------------------------
+ * Encode a chunk and write it with the structured chunk
+ * emulation
+ *------------------------------------------------------------
+ */
+int write_chunk(hid_t dset, hid_t dxpl, long long int index)
+{
+    chunk_t        *chunk = &chunks[index];
+    sc_chunk_info_t info;
+    sc_run_t       *runs;
+    hsize_t         chunk_dims[RANK];
+    hsize_t         offset[RANK];
+    uint64_t        size = hand.chunk_dim1 * hand.chunk_dim2;
+    uint64_t        nelemts = 0;
+    size_t          nruns, n;
+    uint8_t        *sel, *data;
+    const void     *buf[2];
+    hsize_t         stored_size;
+
+    chunk_dims[0] = hand.chunk_dim1;
+    chunk_dims[1] = hand.chunk_dim2;
+    offset[0]     = (index / hand.grid_dim2) * hand.chunk_dim1;
+    offset[1]     = (index % hand.grid_dim2) * hand.chunk_dim2;
+
+    /* Encode the selection of the defined elements */
+    nruns = sc_mask_to_runs(chunk->mask, size, hand.chunk_dim2, NULL);
+    runs  = (sc_run_t *)malloc((nruns ? nruns : 1) * sizeof(sc_run_t));
+    sc_mask_to_runs(chunk->mask, size, hand.chunk_dim2, runs);
+    for (n = 0; n < nruns; n++)
+        nelemts += runs[n].len;
+
+    memset(&info, 0, sizeof(info));
+    info.type                                   = SC_SPARSE_CHUNK;
+    info.num_sections                           = 2;
+    info.nelemts                                = nelemts;
+    info.section_orig_size[SC_SECTION_SELECTION] = sc_encode_runs(RANK, chunk_dims, nruns, runs, NULL);
+    info.section_orig_size[SC_SECTION_FIXED]     = nelemts;
+
+    sel  = (uint8_t *)malloc(info.section_orig_size[SC_SECTION_SELECTION]);
+    data = (uint8_t *)malloc(nelemts ? nelemts : 1);
+    sc_encode_runs(RANK, chunk_dims, nruns, runs, sel);
+    sc_gather_runs(chunk->values, 1, nruns, runs, data);
+
+    buf[SC_SECTION_SELECTION] = sel;
+    buf[SC_SECTION_FIXED]     = data;
+    if (sc_write_struct_chunk(dset, dxpl, &info, offset, buf) < 0)
+        goto error;
+
+    if (H5Dget_chunk_storage_size(dset, offset, &stored_size) < 0)
+        goto error;
+    chunk->used      = sc_image_size(&info);
+    chunk->allocated = (size_t)stored_size;
+
+    free(runs);
+    free(sel);
+    free(data);
+
+    return 0;
+
+error:
+    free(runs);
+    free(sel);
+    free(data);
+    return -1;
+}
+
+/*------------------------------------------------------------
+ * Run one session of updates
+ *------------------------------------------------------------
+ */
+int run_session(hid_t file, int session)
+{
+    hid_t           dset, dxpl;
+    long long int   nchunks = hand.grid_dim1 * hand.grid_dim2;
+    long long int   i;
+    struct timespec start, end;
+
+    dset = H5Dopen2(file, DSET_NAME, H5P_DEFAULT);
+
+    dxpl = H5Pcreate(H5P_DATASET_XFER);
+    sc_set_alloc_policy(dxpl, hand.policy, hand.slack);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < hand.updates; i++) {
+        long long int index = rand() % nchunks;
+
+        define_elements(&chunks[index], hand.add_elements);
+        if (write_chunk(dset, dxpl, index) < 0) {
+            printf("Failed to write chunk %lld\n", index);
+            goto error;
+        }
+    }
+    H5Dflush(dset);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    st[session].seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    st[session].live      = 0;
+    st[session].allocated = 0;
+    for (i = 0; i < nchunks; i++) {
+        st[session].live += chunks[i].used;
+        st[session].allocated += chunks[i].allocated;
+    }
+
+    H5Pclose(dxpl);
+    H5Dclose(dset);
+
+    return 0;
+
+error:
+    H5Pclose(dxpl);
+    H5Dclose(dset);
+    return -1;
+}
+
+/*------------------------------------------------------------
+ * Main function
+ *------------------------------------------------------------
+ */
+int
+main(int argc, char **argv)
+{
+    hid_t         file, fcpl, dcpl, dxpl, dataspace, dset;
+    hsize_t       dims[RANK], chunk_dims[RANK];
+    hsize_t       file_size;
+    long long int nchunks, i;
+    uint64_t      size;
+    int           n;
+
+    parse_command_line(argc, argv);
+
+    /* Use the same seed for reproducibility of the results */
+    srand(2);
+
+    nchunks = hand.grid_dim1 * hand.grid_dim2;
+    size    = hand.chunk_dim1 * hand.chunk_dim2;
+    chunks  = (chunk_t *)calloc(nchunks, sizeof(chunk_t));
+    for (i = 0; i < nchunks; i++) {
+        chunks[i].mask   = (uint8_t *)calloc(size, 1);
+        chunks[i].values = (uint8_t *)calloc(size, 1);
+    }
+
+    /* Create a new file with the requested free-space management */
+    fcpl = H5Pcreate(H5P_FILE_CREATE);
+    if (hand.fspace)
+        H5Pset_file_space_strategy(fcpl, H5F_FSPACE_STRATEGY_FSM_AGGR, 1, (hsize_t)1);
+    file = H5Fcreate(FILE_NAME, H5F_ACC_TRUNC, fcpl, H5P_DEFAULT);
+
+    chunk_dims[0] = hand.chunk_dim1;
+    chunk_dims[1] = hand.chunk_dim2;
+    dims[0]       = hand.chunk_dim1 * hand.grid_dim1;
+    dims[1]       = hand.chunk_dim2 * hand.grid_dim2;
+
+    dcpl      = sc_create_dcpl(RANK, chunk_dims);
+    dataspace = H5Screate_simple(RANK, dims, NULL);
+    dset      = H5Dcreate2(file, DSET_NAME, H5T_STD_U8LE, dataspace, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+
+    if (hand.v) printf("Writing chunks with the initial density\n");
+
+    /* Write all chunks with the initial density */
+    dxpl = H5Pcreate(H5P_DATASET_XFER);
+    sc_set_alloc_policy(dxpl, hand.policy, hand.slack);
+    for (i = 0; i < nchunks; i++) {
+        define_elements(&chunks[i], size * hand.start_percent / 100);
+        write_chunk(dset, dxpl, i);
+    }
+    H5Pclose(dxpl);
+
+    H5Dclose(dset);
+    H5Sclose(dataspace);
+    H5Pclose(dcpl);
+    H5Pclose(fcpl);
+    H5Fclose(file);
+
+    for (n = 0; n < hand.sessions; n++) {
+        if (hand.v) printf("Starting session %d\n", n + 1);
+
+        file = H5Fopen(FILE_NAME, H5F_ACC_RDWR, H5P_DEFAULT);
+        if (run_session(file, n) < 0) {
+            H5Fclose(file);
+            return 1;
+        }
+        H5Fclose(file);
+
+        /* The file size is measured after closing to include the free-space information */
+        file = H5Fopen(FILE_NAME, H5F_ACC_RDONLY, H5P_DEFAULT);
+        H5Fget_filesize(file, &file_size);
+        st[n].file = (long long int)file_size;
+        H5Fclose(file);
+    }
+
+    if (hand.v) printf("Done! \n");
+
+    for (i = 0; i < nchunks; i++) {
+        free(chunks[i].mask);
+        free(chunks[i].values);
+    }
+    free(chunks);
+
+    /* Print results */
+    print_results(hand.sessions);
+
+    return 0;
+}
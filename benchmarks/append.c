@@ -0,0 +1,573 @@
+/*
+ * This program measures the ingest rate of sparse time series appended to a structured chunk dataset
+ * with an unlimited time dimension.  Structured chunks are emulated as described in structured_chunk.h.
+ *
+ * The program creates a file "append_file.h5" with one 3-dim dataset "hits" of 16-bit values with
+ * dimensions 0 x Y x X and an unlimited first (time) dimension (option -f sets the frame dimensions
+ * Y x X).  T frames (option -t) of N hits each (option -n) are appended with the appender of
+ * structured_chunk.h (sc_append_open, sc_append_hits, sc_append_close):
+ *
+ *  - the hits of the open time slab (C1 frames, the first chunk dimension of option -c) are buffered
+ *    in memory for each chunk of the slab;
+ *  - when a hit of a later time slab arrives, the chunks of the open slab that have hits are sealed:
+ *    their Encoded Selections and packed values are written with H5Dwrite_chunk; chunks without hits
+ *    are never written;
+ *  - the time dimension is extended with H5Dset_extent E time slabs at a time (option -e), and set to
+ *    the number of frames when the appender is closed.
+ *
+ * The hits of a frame are at distinct random positions.  The ingest is run with extensions of one time
+ * slab and of E time slabs; each run is repeated R times (option -r) and the best time, from the
+ * creation of the file to its close, is reported.  With the option -k 1 the file is read back and the
+ * number of defined elements is compared with the number of hits.
+ *
+ * To compile the program, please use h5cc.  The -h option lists all the command line options:
+ *
+ *   [-h] [-f --dimsFrame] [-c --dimsChunk] [-t --tFrames] [-n --nHits] [-e --eExtend] [-z --zDeflate]
+ *   [-r --rRepeat] [-k --kVerify] [-v --Verbose]
+ *
+ * Example: The commands
+ *
+ *           h5cc append.c -o append
+ *           ./append -f 1024x1024 -c 16x64x64 -t 4096 -n 4096 -e 64
+ *
+ * append 16 million hits in 4096 frames of 1024x1024 elements and compare extending the time dimension
+ * for every time slab of 16 frames with extending it by 64 time slabs.
+ */
+
+#include "hdf5.h"
+#include "structured_chunk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <getopt.h>
+
+#define FILE_NAME                       "append_file.h5"
+#define DSET_NAME                       "hits"
+#define RANK                            3
+#define FRAME_DIM1                      1024
+#define FRAME_DIM2                      1024
+#define CHUNK_DIM0                      16
+#define CHUNK_DIM1                      64
+#define CHUNK_DIM2                      64
+#define FRAMES                          4096
+#define HITS                            4096
+#define EXTEND_SLABS                    64
+#define POOL_FRAMES                     16          /* Frames of hits generated before the runs */
+#define REPEAT                          3
+
+typedef struct {
+    long long int   frame_dim1;
+    long long int   frame_dim2;
+    long long int   chunk_dim0;
+    long long int   chunk_dim1;
+    long long int   chunk_dim2;
+    long long int   frames;
+    long long int   hits;            /* number of hits per frame */
+    long long int   extend;          /* time slabs added by each extension */
+    int             z;               /* flag to deflate the Data sections */
+    int             repeat;
+    int             k;               /* flag to verify the file */
+    int             v;               /* prints progress messages */
+} handler_t;
+
+typedef struct {
+    long long int   extend;
+    long long int   nsealed;         /* number of chunks written */
+    long long int   nextends;        /* number of calls to H5Dset_extent */
+    long long int   file_size;
+    double          time;            /* best time of a run */
+} result_t;
+
+handler_t    hand;
+result_t     res[2];
+hsize_t     *pool_coords;
+uint16_t    *pool_values;
+
+/*------------------------------------------------------------
+ * Display command line usage
+ *------------------------------------------------------------
+ */
+void
+usage(void)
+{
+    printf("    [-h] [-f --dimsFrame] [-c --dimsChunk] [-t --tFrames] [-n --nHits] [-e --eExtend] [-z --zDeflate]\n");
+    printf("    [-r --rRepeat] [-k --kVerify] [-v --Verbose]\n");
+    printf("    [-h --help]: this help page\n");
+    printf("    [-f --dimsFrame]: the 2D dimensions of a frame in elements, e.g. 1024x1024\n");
+    printf("    [-c --dimsChunk]: the 3D dimensions of the chunks in frames and elements, e.g. 16x64x64\n");
+    printf("    [-t --tFrames]: the number of frames appended\n");
+    printf("    [-n --nHits]: the number of hits in each frame\n");
+    printf("    [-e --eExtend]: the number of time slabs added by each extension of the time dimension\n");
+    printf("    [-z --zDeflate]: Deflate the values of the chunks (1) or store them unfiltered (0, default)\n");
+    printf("    [-r --rRepeat]: the number of runs for each extension\n");
+    printf("    [-k --kVerify]: Read the file back and verify the number of defined elements (1); default off (0)\n");
+    printf("    [-v --Verbose]: Print progress messages(1); default no messages displayed (0) \n");
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Parse a string of the form AxB or AxBxC; missing dimensions
+ * are set to 0
+ *------------------------------------------------------------
+ */
+void
+parse_dims(const char *str, int ndims, long long int *dims[])
+{
+    char *dims_str, *dim_str;
+    int   i;
+
+    dims_str = strdup(str);
+    dim_str  = strtok(dims_str, "x");
+    for (i = 0; i < ndims; i++) {
+        *dims[i] = dim_str ? atoll(dim_str) : 0;
+        dim_str  = strtok(NULL, "x");
+    }
+    free(dims_str);
+}
+
+/*------------------------------------------------------------
+ * Parse command line option
+ *------------------------------------------------------------
+ */
+void
+parse_command_line(int argc, char *argv[])
+{
+    int            opt;
+    long long int *frame_dims[2] = {&hand.frame_dim1, &hand.frame_dim2};
+    long long int *chunk_dims[3] = {&hand.chunk_dim0, &hand.chunk_dim1, &hand.chunk_dim2};
+    struct option  long_options[] = {
+                                    {"help", no_argument, NULL, 'h'},
+                                    {"dimsFrame=", required_argument, NULL, 'f'},
+                                    {"dimsChunk=", required_argument, NULL, 'c'},
+                                    {"tFrames=", required_argument, NULL, 't'},
+                                    {"nHits=", required_argument, NULL, 'n'},
+                                    {"eExtend=", required_argument, NULL, 'e'},
+                                    {"zDeflate=", required_argument, NULL, 'z'},
+                                    {"rRepeat=", required_argument, NULL, 'r'},
+                                    {"kVerify=", required_argument, NULL, 'k'},
+                                    {"Verbose=", required_argument, NULL, 'v'},
+                                    {NULL, 0, NULL, 0}};
+
+    /* Initialize the command line options */
+    hand.frame_dim1 = FRAME_DIM1;
+    hand.frame_dim2 = FRAME_DIM2;
+    hand.chunk_dim0 = CHUNK_DIM0;
+    hand.chunk_dim1 = CHUNK_DIM1;
+    hand.chunk_dim2 = CHUNK_DIM2;
+    hand.frames     = FRAMES;
+    hand.hits       = HITS;
+    hand.extend     = EXTEND_SLABS;
+    hand.z          = 0;
+    hand.repeat     = REPEAT;
+    hand.k          = 0;
+    hand.v          = 0;
+
+    while ((opt = getopt_long(argc, argv, "hf:c:t:n:e:z:r:k:v:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'h':
+                fprintf(stdout, "Help page:\n");
+                usage();
+
+                exit(0);
+
+                break;
+            case 'f':
+                if (optarg) {
+                    fprintf(stdout, "Frame dimensions:\t\t\t\t\t%s\n", optarg);
+                    parse_dims(optarg, 2, frame_dims);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'c':
+                if (optarg) {
+                    fprintf(stdout, "Chunk dimensions:\t\t\t\t\t%s\n", optarg);
+                    parse_dims(optarg, 3, chunk_dims);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 't':
+                if (optarg) {
+                    fprintf(stdout, "Number of frames:\t\t\t\t\t%s\n", optarg);
+                    hand.frames = atoll(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'n':
+                if (optarg) {
+                    fprintf(stdout, "Hits per frame:\t\t\t\t\t\t%s\n", optarg);
+                    hand.hits = atoll(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'e':
+                if (optarg) {
+                    fprintf(stdout, "Time slabs per extension:\t\t\t\t%s\n", optarg);
+                    hand.extend = atoll(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'z':
+                if (optarg) {
+                    hand.z = atoi(optarg);
+                    if (hand.z == 1)
+                        fprintf(stdout, "Deflate the values: \t\t\t\t\ton\n");
+                    else if (hand.z == 0)
+                        fprintf(stdout, "Deflate the values: \t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Deflate the values:\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'r':
+                if (optarg) {
+                    fprintf(stdout, "Number of runs:\t\t\t\t\t\t%s\n", optarg);
+                    hand.repeat = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'k':
+                if (optarg) {
+                    hand.k = atoi(optarg);
+                    if (hand.k == 1)
+                        fprintf(stdout, "Verify the file: \t\t\t\t\ton\n");
+                    else if (hand.k == 0)
+                        fprintf(stdout, "Verify the file: \t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Verify the file:\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'v':
+                if (optarg) {
+                    hand.v = atoi(optarg);
+                    if (hand.v == 1)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\ton\n");
+                    else if (hand.v == 0)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Verbose mode:\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case ':':
+                printf("Option needs a value\n");
+                break;
+            case '?':
+                printf("Unknown option: %c\n", optopt);
+                break;
+        }
+    }
+
+    /* optind is for the extra arguments which are not parsed */
+    for (; optind < argc; optind++) {
+        printf("extra arguments not parsed: %s\n", argv[optind]);
+    }
+
+    /* Make sure the command line options are valid */
+    if (hand.frame_dim1 <= 0 || hand.frame_dim2 <= 0) {
+        printf("Invalid frame dimensions\n");
+        exit(1);
+    }
+
+    if (hand.chunk_dim0 <= 0 || hand.chunk_dim1 <= 0 || hand.chunk_dim2 <= 0 ||
+        hand.chunk_dim1 > hand.frame_dim1 || hand.chunk_dim2 > hand.frame_dim2) {
+        printf("Invalid chunk dimensions\n");
+        exit(1);
+    }
+
+    if (hand.frames < 1) {
+        printf("The number of frames must be positive\n");
+        exit(1);
+    }
+
+    if (hand.hits < 1 || hand.hits > hand.frame_dim1 * hand.frame_dim2) {
+        printf("The number of hits per frame must be between 1 and the number of elements of a frame\n");
+        exit(1);
+    }
+
+    if (hand.extend < 1) {
+        printf("The number of time slabs per extension must be positive\n");
+        exit(1);
+    }
+
+    if (hand.z < 0 || hand.z > 1) {
+        printf("Deflate flag can only be 0 or 1 \n");
+        exit(1);
+    }
+
+    if (hand.repeat < 1) {
+        printf("The number of runs must be positive\n");
+        exit(1);
+    }
+
+    if (hand.k < 0 || hand.k > 1) {
+        printf("Verify flag can only be 0 or 1 \n");
+        exit(1);
+    }
+
+    if (hand.v < 0 || hand.v > 1) {
+        printf("Verbose flag can only be 0 or 1 \n");
+        exit(1);
+    }
+}
+
+/*------------------------------------------------------------
+ * Print the ingest rate of each extension
+ *------------------------------------------------------------
+ */
+void print_results(int nres)
+{
+    long long int nhits = hand.frames * hand.hits;
+    int           i;
+
+    printf("\n");
+    printf("Number of hits appended:\t\t\t\t%lli\n", nhits);
+    printf("\n");
+    printf("Printing the time slabs per extension (E), chunks written (NC), calls to H5Dset_extent (NE),\n");
+    printf("file size in bytes (FS), time in seconds (T), million hits per second (MHPS) and speedup over\n");
+    printf("the extension of one time slab (SU)\n");
+    printf("\n");
+    printf("         E         NC         NE         FS          T       MHPS         SU\n");
+    printf("\n");
+
+    for (i = 0; i < nres; i++)
+        printf("%10lli %10lli %10lli %10lli %10.4f %10.2f %10.2f \n", res[i].extend, res[i].nsealed,
+               res[i].nextends, res[i].file_size, res[i].time, nhits / res[i].time / 1e6,
+               res[0].time / res[i].time);
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Elapsed time
+ *------------------------------------------------------------
+ */
+double elapsed(struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*------------------------------------------------------------
+ * Generate POOL_FRAMES frames of hits at distinct random
+ * positions; the time coordinate is set when a frame is
+ * appended
+ *------------------------------------------------------------
+ */
+void generate_hits(void)
+{
+    long long int frame_size = hand.frame_dim1 * hand.frame_dim2;
+    uint8_t      *mark;
+    long long int f, h;
+
+    pool_coords = (hsize_t *)malloc(POOL_FRAMES * hand.hits * RANK * sizeof(hsize_t));
+    pool_values = (uint16_t *)malloc(POOL_FRAMES * hand.hits * sizeof(uint16_t));
+    mark        = (uint8_t *)malloc(frame_size);
+
+    for (f = 0; f < POOL_FRAMES; f++) {
+        memset(mark, 0, frame_size);
+        for (h = 0; h < hand.hits; h++) {
+            hsize_t      *coord = pool_coords + (f * hand.hits + h) * RANK;
+            long long int k;
+
+            do
+                k = ((long long int)rand() * RAND_MAX + rand()) % frame_size;
+            while (mark[k]);
+            mark[k] = 1;
+
+            coord[0] = 0;
+            coord[1] = k / hand.frame_dim2;
+            coord[2] = k % hand.frame_dim2;
+            pool_values[f * hand.hits + h] = (uint16_t)(rand() % 65535 + 1);
+        }
+    }
+
+    free(mark);
+}
+
+/*------------------------------------------------------------
+ * Create the file and append all frames; returns the time
+ *------------------------------------------------------------
+ */
+double append_frames(long long int extend, result_t *r)
+{
+    struct timespec start;
+    struct stat     sb;
+    sc_append_t     app;
+    hid_t           file, dcpl, space, dset;
+    hsize_t         dims[RANK], maxdims[RANK], chunk_dims[RANK];
+    long long int   t, h;
+    double          time;
+
+    dims[0]       = 0;
+    dims[1]       = hand.frame_dim1;
+    dims[2]       = hand.frame_dim2;
+    maxdims[0]    = H5S_UNLIMITED;
+    maxdims[1]    = hand.frame_dim1;
+    maxdims[2]    = hand.frame_dim2;
+    chunk_dims[0] = hand.chunk_dim0;
+    chunk_dims[1] = hand.chunk_dim1;
+    chunk_dims[2] = hand.chunk_dim2;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    file  = H5Fcreate(FILE_NAME, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    dcpl  = sc_create_dcpl(RANK, chunk_dims);
+    space = H5Screate_simple(RANK, dims, maxdims);
+    dset  = H5Dcreate2(file, DSET_NAME, H5T_STD_U16LE, space, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+    if (dset < 0) {
+        printf("Failed to create the dataset %s\n", DSET_NAME);
+        exit(1);
+    }
+
+    if (sc_append_open(dset, H5P_DEFAULT, sizeof(uint16_t), hand.z ? SC_PIPELINE_DEFLATE : SC_PIPELINE_NONE,
+                       (hsize_t)extend, &app) < 0) {
+        printf("Failed to open the appender\n");
+        exit(1);
+    }
+
+    for (t = 0; t < hand.frames; t++) {
+        long long int f      = t % POOL_FRAMES;
+        hsize_t      *coords = pool_coords + f * hand.hits * RANK;
+
+        for (h = 0; h < hand.hits; h++)
+            coords[h * RANK] = (hsize_t)t;
+        if (sc_append_hits(&app, (size_t)hand.hits, coords, pool_values + f * hand.hits) < 0) {
+            printf("Failed to append frame %lli\n", t);
+            exit(1);
+        }
+    }
+
+    if (sc_append_close(&app) < 0) {
+        printf("Failed to close the appender\n");
+        exit(1);
+    }
+    r->nsealed  = (long long int)app.nsealed;
+    r->nextends = (long long int)app.nextends;
+
+    H5Dclose(dset);
+    H5Sclose(space);
+    H5Pclose(dcpl);
+    H5Fclose(file);
+
+    time = elapsed(&start);
+
+    stat(FILE_NAME, &sb);
+    r->file_size = (long long int)sb.st_size;
+
+    return time;
+}
+
+/*------------------------------------------------------------
+ * Count the defined elements of a chunk (callback for
+ * sc_get_defined)
+ *------------------------------------------------------------
+ */
+herr_t count_defined(const hsize_t *offset, size_t nruns, const sc_run_t *runs, void *op_data)
+{
+    long long int *npoints = (long long int *)op_data;
+    size_t         n;
+
+    (void)offset;
+
+    for (n = 0; n < nruns; n++)
+        *npoints += (long long int)runs[n].len;
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Check the time dimension and the number of defined elements
+ * of the file
+ *------------------------------------------------------------
+ */
+int verify_file(void)
+{
+    hid_t         file, dset, space;
+    hsize_t       dims[RANK];
+    long long int npoints = 0;
+
+    file  = H5Fopen(FILE_NAME, H5F_ACC_RDONLY, H5P_DEFAULT);
+    dset  = H5Dopen2(file, DSET_NAME, H5P_DEFAULT);
+    space = H5Dget_space(dset);
+    H5Sget_simple_extent_dims(space, dims, NULL);
+    H5Sclose(space);
+    H5Dclose(dset);
+
+    if (sc_get_defined(file, DSET_NAME, 0, count_defined, &npoints) < 0) {
+        printf("Failed to get the defined elements of %s\n", DSET_NAME);
+        H5Fclose(file);
+        return -1;
+    }
+    H5Fclose(file);
+
+    if ((long long int)dims[0] != hand.frames) {
+        printf("The time dimension is %lli instead of %lli\n", (long long int)dims[0], hand.frames);
+        return -1;
+    }
+    if (npoints != hand.frames * hand.hits) {
+        printf("The file has %lli defined elements instead of %lli\n", npoints, hand.frames * hand.hits);
+        return -1;
+    }
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Main function
+ *------------------------------------------------------------
+ */
+int
+main(int argc, char **argv)
+{
+    long long int extend[2];
+    double        t;
+    int           nres, i, n;
+
+    parse_command_line(argc, argv);
+
+    /* Use the same seed for reproducibility of the results */
+    srand(2);
+
+    if (hand.v) printf("Generating the hits\n");
+    generate_hits();
+
+    extend[0] = 1;
+    extend[1] = hand.extend;
+    nres      = hand.extend > 1 ? 2 : 1;
+
+    for (i = 0; i < nres; i++) {
+        if (hand.v) printf("Appending with %lli time slabs per extension\n", extend[i]);
+        res[i].extend = extend[i];
+        res[i].time   = 1e30;
+        for (n = 0; n < hand.repeat; n++)
+            if ((t = append_frames(extend[i], &res[i])) < res[i].time)
+                res[i].time = t;
+
+        if (hand.k) {
+            if (hand.v) printf("Verifying the file\n");
+            if (verify_file() < 0)
+                return 1;
+        }
+    }
+
+    if (hand.v) printf("Done! \n");
+
+    free(pool_coords);
+    free(pool_values);
+
+    print_results(nres);
+
+    return 0;
+}
@@ -0,0 +1,550 @@
+/*
+ * This program measures how merging nearby reads of a structured chunk dataset into larger I/Os
+ * (sc_read_coalesced in structured_chunk.h) trades the number of I/Os against the bytes read in the
+ * gaps between the requested ranges.
+ *
+ * Two kinds of requests can be read (command line option -m):
+ *
+ *  1 - default; the stored chunks of the dataset, e.g. the chunks touched by a read of the whole dataset;
+ *  2 - the Encoded Selection sections of all chunks, as needed to find the defined elements of the
+ *      dataset.  The prefixes of the chunks are read first to get the sizes of the sections, then the
+ *      sections are read and their checksums are verified.
+ *
+ * The requests are read with merging disabled ("off") and with a maximum gap between merged requests
+ * of 0 (adjacent requests only), 4 KiB, 16 KiB, ... up to the option -g.  The option -x limits the size
+ * of a merged I/O.  The reads go through a driver that adds the latency of a storage profile to each
+ * I/O (option -p, default all profiles):
+ *
+ *  - hdd: 0.1 ms per I/O, 8 ms seek when an I/O does not start where the previous one ended, 150 MB/s;
+ *  - nvme: 80 us per I/O, 2.5 GB/s;
+ *  - lustre: 1 ms per I/O (one RPC round trip to the object storage server), 1 GB/s.
+ *
+ * The file is read through the page cache, which is warmed by the first pass; the latency of the
+ * profile is added to the measured time of each pass, or spent in nanosleep with the option -s 1.
+ * Each pass is repeated R times (option -r) and the best time is reported.
+ *
+ * To compile the program, please use h5cc.  The -h option lists all the command line options:
+ *
+ *   [-h] [-i --inFile] [-n --nameDset] [-m --mRequest] [-p --pProfile] [-g --gMaxGap] [-x --xMaxIO]
+ *   [-s --sSleep] [-r --rRepeat] [-v --Verbose]
+ *
+ * Example: The commands
+ *
+ *           h5cc alloc.c -o alloc
+ *           h5cc coalesce.c -o coalesce
+ *           ./alloc -c 64x64 -g 64x64 -n 1
+ *           ./coalesce -i alloc_file.h5 -m 2 -p lustre
+ *
+ * read the Encoded Selection sections of 4096 chunks with the latency of the Lustre-like profile.
+ */
+
+#include "hdf5.h"
+#include "structured_chunk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <getopt.h>
+
+#define FILE_NAME                       "alloc_file.h5"
+#define DSET_NAME                       "sparse"
+#define MAX_GAP                         (1024 * 1024)
+#define MAX_RESULTS                     16
+#define REPEAT                          3
+#define NPROFILES                       3
+
+typedef struct {
+    char           *in_file;
+    char           *dset_name;
+    int             mode;            /* read the chunks (1) or the Encoded Selection sections (2) */
+    int             profile;         /* index of the latency profile; -1 for all */
+    long long int   max_gap;
+    long long int   max_io;          /* maximum size of a merged I/O; 0 for no limit */
+    int             s;               /* flag to sleep for the injected latency */
+    int             repeat;
+    int             v;               /* prints progress messages */
+} handler_t;
+
+/* Latency of a storage system */
+typedef struct {
+    const char     *name;
+    double          latency;         /* seconds per I/O */
+    double          seek;            /* seconds added when an I/O does not continue the previous one */
+    double          bandwidth;       /* bytes per second */
+} profile_t;
+
+/* Driver that adds the latency of a profile to each read */
+typedef struct {
+    int              fd;
+    const profile_t *prof;
+    uint64_t         last_end;       /* end of the previous I/O */
+    double           delay;          /* injected latency in seconds */
+} driver_t;
+
+typedef struct {
+    long long int   gap;             /* maximum gap; -1 for no merging */
+    long long int   nios;            /* number of I/Os */
+    long long int   bytes;           /* bytes read */
+    long long int   useful;          /* bytes requested */
+    double          time;            /* best time of a pass */
+    uint64_t        sum;             /* sum of the bytes used */
+} result_t;
+
+handler_t    hand;
+result_t     res[MAX_RESULTS];
+profile_t    profiles[NPROFILES] = {{"hdd", 100e-6, 8e-3, 150e6},
+                                    {"nvme", 80e-6, 0.0, 2.5e9},
+                                    {"lustre", 1e-3, 0.0, 1e9}};
+
+/*------------------------------------------------------------
+ * Display command line usage
+ *------------------------------------------------------------
+ */
+void
+usage(void)
+{
+    printf("    [-h] [-i --inFile] [-n --nameDset] [-m --mRequest] [-p --pProfile] [-g --gMaxGap] [-x --xMaxIO]\n");
+    printf("    [-s --sSleep] [-r --rRepeat] [-v --Verbose]\n");
+    printf("    [-h --help]: this help page\n");
+    printf("    [-i --inFile]: the file to read (default %s)\n", FILE_NAME);
+    printf("    [-n --nameDset]: the name of the structured chunk dataset (default %s)\n", DSET_NAME);
+    printf("    [-m --mRequest]: read the chunks (1) or the Encoded Selection sections (2)\n");
+    printf("    [-p --pProfile]: latency profile hdd, nvme or lustre; default all profiles\n");
+    printf("    [-g --gMaxGap]: the largest maximum gap in bytes between merged reads (default %d)\n", MAX_GAP);
+    printf("    [-x --xMaxIO]: the maximum size in bytes of a merged read; default no limit (0)\n");
+    printf("    [-s --sSleep]: sleep for the injected latency (1); default add it to the measured time (0)\n");
+    printf("    [-r --rRepeat]: the number of passes over the data for each gap\n");
+    printf("    [-v --Verbose]: Print progress messages(1); default no messages displayed (0) \n");
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Parse command line option
+ *------------------------------------------------------------
+ */
+void
+parse_command_line(int argc, char *argv[])
+{
+    int           opt, i;
+    struct option long_options[] = {
+                                    {"help", no_argument, NULL, 'h'},
+                                    {"inFile=", required_argument, NULL, 'i'},
+                                    {"nameDset=", required_argument, NULL, 'n'},
+                                    {"mRequest=", required_argument, NULL, 'm'},
+                                    {"pProfile=", required_argument, NULL, 'p'},
+                                    {"gMaxGap=", required_argument, NULL, 'g'},
+                                    {"xMaxIO=", required_argument, NULL, 'x'},
+                                    {"sSleep=", required_argument, NULL, 's'},
+                                    {"rRepeat=", required_argument, NULL, 'r'},
+                                    {"Verbose=", required_argument, NULL, 'v'},
+                                    {NULL, 0, NULL, 0}};
+
+    /* Initialize the command line options */
+    hand.in_file   = FILE_NAME;
+    hand.dset_name = DSET_NAME;
+    hand.mode      = 1;
+    hand.profile   = -1;
+    hand.max_gap   = MAX_GAP;
+    hand.max_io    = 0;
+    hand.s         = 0;
+    hand.repeat    = REPEAT;
+    hand.v         = 0;
+
+    while ((opt = getopt_long(argc, argv, "hi:n:m:p:g:x:s:r:v:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'h':
+                fprintf(stdout, "Help page:\n");
+                usage();
+
+                exit(0);
+
+                break;
+            case 'i':
+                if (optarg) {
+                    fprintf(stdout, "Input file:\t\t\t\t\t\t%s\n", optarg);
+                    hand.in_file = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'n':
+                if (optarg) {
+                    fprintf(stdout, "Dataset:\t\t\t\t\t\t%s\n", optarg);
+                    hand.dset_name = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'm':
+                if (optarg) {
+                    hand.mode = atoi(optarg);
+                    if (hand.mode == 1)
+                        fprintf(stdout, "Requests:\t\t\t\t\t\tchunks\n");
+                    else if (hand.mode == 2)
+                        fprintf(stdout, "Requests:\t\t\t\t\t\tencoded selection sections\n");
+                    else
+                        fprintf(stdout, "Requests:\t\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'p':
+                if (optarg) {
+                    fprintf(stdout, "Latency profile:\t\t\t\t\t%s\n", optarg);
+                    hand.profile = -2;
+                    for (i = 0; i < NPROFILES; i++)
+                        if (strcmp(optarg, profiles[i].name) == 0)
+                            hand.profile = i;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'g':
+                if (optarg) {
+                    fprintf(stdout, "Largest maximum gap:\t\t\t\t\t%s\n", optarg);
+                    hand.max_gap = atoll(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'x':
+                if (optarg) {
+                    fprintf(stdout, "Maximum size of a read:\t\t\t\t\t%s\n", optarg);
+                    hand.max_io = atoll(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 's':
+                if (optarg) {
+                    hand.s = atoi(optarg);
+                    if (hand.s == 1)
+                        fprintf(stdout, "Sleep for the latency: \t\t\t\t\ton\n");
+                    else if (hand.s == 0)
+                        fprintf(stdout, "Sleep for the latency: \t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Sleep for the latency:\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'r':
+                if (optarg) {
+                    fprintf(stdout, "Number of passes:\t\t\t\t\t%s\n", optarg);
+                    hand.repeat = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'v':
+                if (optarg) {
+                    hand.v = atoi(optarg);
+                    if (hand.v == 1)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\ton\n");
+                    else if (hand.v == 0)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Verbose mode:\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case ':':
+                printf("Option needs a value\n");
+                break;
+            case '?':
+                printf("Unknown option: %c\n", optopt);
+                break;
+        }
+    }
+
+    /* optind is for the extra arguments which are not parsed */
+    for (; optind < argc; optind++) {
+        printf("extra arguments not parsed: %s\n", argv[optind]);
+    }
+
+    /* Make sure the command line options are valid */
+    if (hand.mode < 1 || hand.mode > 2) {
+        printf("The requests can only be 1 or 2\n");
+        exit(1);
+    }
+
+    if (hand.profile == -2) {
+        printf("The latency profile can only be hdd, nvme or lustre\n");
+        exit(1);
+    }
+
+    if (hand.max_gap < 0 || hand.max_io < 0) {
+        printf("The maximum gap and read size can't be negative\n");
+        exit(1);
+    }
+
+    if (hand.s < 0 || hand.s > 1) {
+        printf("Sleep flag can only be 0 or 1 \n");
+        exit(1);
+    }
+
+    if (hand.repeat < 1) {
+        printf("The number of passes must be positive\n");
+        exit(1);
+    }
+
+    if (hand.v < 0 || hand.v > 1) {
+        printf("Verbose flag can only be 0 or 1 \n");
+        exit(1);
+    }
+}
+
+/*------------------------------------------------------------
+ * Print the I/Os, bytes and throughput for each maximum gap
+ *------------------------------------------------------------
+ */
+void print_results(int nres, const profile_t *prof)
+{
+    int   i;
+    float mb;
+
+    printf("\n");
+    printf("Printing for the %s profile the maximum gap in bytes (GAP), number of I/Os (NIO), bytes read (BR),\n",
+           prof->name);
+    printf("percentage of bytes read in the gaps (W), time in seconds (T), I/Os per second (IOPS), throughput\n");
+    printf("of the requested bytes in MiB/s (RT) and speedup over reads without merging (SU)\n");
+    printf("\n");
+    printf("       GAP        NIO         BR          W          T       IOPS         RT         SU\n");
+    printf("\n");
+
+    for (i = 0; i < nres; i++) {
+        mb = (float)res[i].useful / (1024 * 1024);
+        if (res[i].gap < 0)
+            printf("%10s ", "off");
+        else
+            printf("%10lli ", res[i].gap);
+        printf("%10lli %10lli %10.1f %10.4f %10.0f %10.1f %10.2f \n", res[i].nios, res[i].bytes,
+               100.0 * (double)(res[i].bytes - res[i].useful) / (double)res[i].bytes, res[i].time,
+               (double)res[i].nios / res[i].time, mb / res[i].time, res[0].time / res[i].time);
+    }
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Elapsed time
+ *------------------------------------------------------------
+ */
+double elapsed(struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*------------------------------------------------------------
+ * Read with the latency of the profile (sc_read_op_t)
+ *------------------------------------------------------------
+ */
+ssize_t latency_read(void *op_data, void *buf, size_t size, uint64_t offset)
+{
+    driver_t *drv   = (driver_t *)op_data;
+    double    delay = drv->prof->latency + (double)size / drv->prof->bandwidth;
+    ssize_t   n;
+
+    if (offset != drv->last_end)
+        delay += drv->prof->seek;
+    drv->last_end = offset + size;
+    drv->delay += delay;
+
+    if (hand.s) {
+        struct timespec ts;
+
+        ts.tv_sec  = (time_t)delay;
+        ts.tv_nsec = (long)((delay - (double)ts.tv_sec) * 1e9);
+        nanosleep(&ts, NULL);
+    }
+
+    if ((n = pread(drv->fd, buf, size, (off_t)offset)) < 0)
+        printf("pread failed at offset %llu\n", (unsigned long long)offset);
+
+    return n;
+}
+
+/*------------------------------------------------------------
+ * Read the requests of one pass with a maximum gap; returns
+ * the time of the pass
+ *------------------------------------------------------------
+ */
+double read_pass(driver_t *drv, size_t nchunks, const sc_chunk_loc_t *locs, sc_io_t *reqs, uint8_t *buf,
+                 size_t gap, result_t *r)
+{
+    struct timespec start;
+    size_t          c, nios;
+    uint64_t        nbytes, sum = 0;
+    size_t          max_io = (size_t)hand.max_io;
+    uint8_t        *p;
+
+    drv->last_end = 0;
+    drv->delay    = 0;
+    r->nios = r->bytes = r->useful = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    /* The chunks, or the prefixes of the chunks */
+    for (c = 0, p = buf; c < nchunks; c++) {
+        reqs[c].addr = locs[c].addr;
+        reqs[c].size = hand.mode == 1 ? (size_t)locs[c].size : SC_PREFIX_SIZE;
+        reqs[c].buf  = p;
+        p += reqs[c].size;
+    }
+    if (sc_read_coalesced(nchunks, reqs, gap, max_io, latency_read, drv, &nios, &nbytes) < 0) {
+        printf("Failed to read the chunks\n");
+        exit(1);
+    }
+    r->nios += (long long int)nios;
+    r->bytes += (long long int)nbytes;
+
+    for (c = 0; c < nchunks; c++) {
+        sc_chunk_info_t info;
+        const uint8_t  *data;
+        uint64_t        i;
+
+        r->useful += (long long int)reqs[c].size;
+        if (hand.mode == 1) {
+            /* Use the unfiltered Data sections in place */
+            if (sc_disassemble_chunk((const uint8_t *)reqs[c].buf, reqs[c].size, &info, NULL) < 0)
+                goto error;
+            data = (const uint8_t *)reqs[c].buf + SC_PREFIX_SIZE + info.section_size[SC_SECTION_SELECTION];
+            if (!(info.pipeline[SC_SECTION_FIXED] & SC_PIPELINE_DEFLATE) || (info.filter_mask[SC_SECTION_FIXED] & 0x1))
+                for (i = 0; i < info.section_size[SC_SECTION_FIXED]; i++)
+                    sum += data[i];
+        }
+        else {
+            /* Replace the prefix request by the Encoded Selection section */
+            if (sc_decode_prefix((const uint8_t *)reqs[c].buf, &info) < 0)
+                goto error;
+            reqs[c].addr = locs[c].addr + SC_PREFIX_SIZE;
+            reqs[c].size = (size_t)info.section_size[SC_SECTION_SELECTION];
+        }
+    }
+
+    if (hand.mode == 2) {
+        uint8_t *sel_buf;
+        size_t   total = 0;
+
+        for (c = 0; c < nchunks; c++)
+            total += reqs[c].size;
+        if (NULL == (sel_buf = (uint8_t *)malloc(total ? total : 1)))
+            goto error;
+        for (c = 0, p = sel_buf; c < nchunks; c++) {
+            reqs[c].buf = p;
+            p += reqs[c].size;
+        }
+        if (sc_read_coalesced(nchunks, reqs, gap, max_io, latency_read, drv, &nios, &nbytes) < 0) {
+            printf("Failed to read the encoded selections\n");
+            exit(1);
+        }
+        r->nios += (long long int)nios;
+        r->bytes += (long long int)nbytes;
+
+        /* Verify the checksums */
+        for (c = 0; c < nchunks; c++) {
+            const uint8_t *sel  = (const uint8_t *)reqs[c].buf;
+            size_t         size = reqs[c].size - SC_CHECKSUM_SIZE;
+            const uint8_t *q    = sel + size;
+            size_t         i;
+
+            r->useful += (long long int)reqs[c].size;
+            if (sc_decode32(&q) != (uint32_t)crc32(0L, sel, (uInt)size))
+                goto error;
+            for (i = 0; i < size; i++)
+                sum += sel[i];
+        }
+        free(sel_buf);
+    }
+
+    r->sum = sum;
+
+    return elapsed(&start) + (hand.s ? 0.0 : drv->delay);
+
+error:
+    printf("Failed to decode chunk %zu\n", c);
+    exit(1);
+}
+
+/*------------------------------------------------------------
+ * Main function
+ *------------------------------------------------------------
+ */
+int
+main(int argc, char **argv)
+{
+    hid_t           fapl, file, dset;
+    sc_chunk_loc_t *locs;
+    sc_io_t        *reqs;
+    uint8_t        *buf;
+    size_t          nchunks, c, total = 0;
+    driver_t        drv;
+    long long int   gap;
+    double          t;
+    int             p, nres, n, i;
+
+    parse_command_line(argc, argv);
+
+    fapl = H5Pcreate(H5P_FILE_ACCESS);
+    H5Pset_fapl_sec2(fapl);
+    if ((file = H5Fopen(hand.in_file, H5F_ACC_RDONLY, fapl)) < 0) {
+        printf("Failed to open %s\n", hand.in_file);
+        return 1;
+    }
+    if ((dset = H5Dopen2(file, hand.dset_name, H5P_DEFAULT)) < 0 ||
+        sc_get_chunk_locations(dset, &nchunks, &locs) < 0) {
+        printf("Failed to read the chunk locations of %s\n", hand.dset_name);
+        return 1;
+    }
+    H5Dclose(dset);
+    H5Fclose(file);
+    H5Pclose(fapl);
+
+    for (c = 0; c < nchunks; c++)
+        total += (size_t)locs[c].size;
+    reqs = (sc_io_t *)malloc((nchunks ? nchunks : 1) * sizeof(sc_io_t));
+    buf  = (uint8_t *)malloc(total ? total : 1);
+
+    if ((drv.fd = open(hand.in_file, O_RDONLY)) < 0) {
+        printf("Failed to open %s\n", hand.in_file);
+        return 1;
+    }
+
+    for (p = 0; p < NPROFILES; p++) {
+        if (hand.profile >= 0 && hand.profile != p)
+            continue;
+        drv.prof = &profiles[p];
+
+        /* No merging, then maximum gaps of 0, 4 KiB, 16 KiB, ... */
+        for (nres = 0, gap = -1; nres < MAX_RESULTS && gap <= hand.max_gap; nres++) {
+            if (hand.v) printf("Reading with the %s profile, maximum gap %lli\n", drv.prof->name, gap);
+
+            res[nres].gap  = gap;
+            res[nres].time = 1e30;
+            for (n = 0; n < hand.repeat; n++)
+                if ((t = read_pass(&drv, nchunks, locs, reqs, buf, gap < 0 ? SC_NO_COALESCING : (size_t)gap,
+                                   &res[nres])) < res[nres].time)
+                    res[nres].time = t;
+
+            gap = gap < 0 ? 0 : (gap == 0 ? 4096 : gap * 4);
+        }
+
+        for (i = 1; i < nres; i++)
+            if (res[i].sum != res[0].sum)
+                printf("Values read with maximum gap %lli differ from the reads without merging\n", res[i].gap);
+
+        print_results(nres, drv.prof);
+    }
+
+    if (hand.v) printf("Done! \n");
+
+    close(drv.fd);
+    free(buf);
+    free(reqs);
+    free(locs);
+
+    return 0;
+}
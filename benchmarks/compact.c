@@ -0,0 +1,562 @@
+/*
+ * This program compacts a dataset stored with sparse structured chunks (see structured_chunk.h) and
+ * reports the chunk placement and the sequential read throughput before and after the compaction.
+ *
+ * After many rewrites the chunks of a dataset are scattered over the file in no particular order and
+ * are separated by free-space holes (see alloc.c, which produces such a file).  Reading the chunks in
+ * the logical order then requires a seek for almost every chunk.  Both modes rewrite the chunks in the
+ * logical order of the chunks and drop the slack capacity of the chunks, but only the repack mode makes
+ * them contiguous.
+ *
+ * There are two modes selected by the command line option -o:
+ *
+ *  - in place (default): the dataset is rewritten in the input file with sc_compact_dataset().  The
+ *    chunks are written to a new dataset that replaces the original one.  The library places each
+ *    chunk in the first free-space hole that fits it, so the rewritten chunks fill the holes instead of
+ *    following one another: the discontiguities are reduced, not removed, and the file does not shrink.
+ *    The space of the original chunks becomes free space (FREE) for later writes; the input file must
+ *    have been created with persistent free-space managers (e.g. alloc -f 1), otherwise that space
+ *    would be lost when the file is closed.  To show that readers can keep working during the rewrite,
+ *    the program opens the dataset before it (the reader's snapshot), reads it again after it and
+ *    checks that it still sees the same data.  The snapshot is only kept for readers in this process;
+ *    readers in other processes must not have the file open.  The space of the original chunks is
+ *    released when the snapshot is closed.  The rewritten dataset is a new object: other hard links to
+ *    the original dataset and object references to it are not updated.
+ *  - repack (-o FILE): the compacted dataset is written first to a new file, so that its chunks are
+ *    contiguous, and all other objects of the input file are copied after it, as h5repack does.  This
+ *    also returns the free space to the file system.
+ *
+ * For a file written with "alloc -u 2000 -n 3 -p 1 -f 1", the in-place mode reduces the discontiguities
+ * (DC) from 62 to 15 while the file grows from 8.6 MB to 14.2 MB with 7.9 MB of free space; repacking
+ * the result gives no discontiguity in a 6.3 MB file.
+ *
+ * The read throughput is measured by reading all chunks with H5Dread_chunk in the logical order after
+ * dropping the file pages from the page cache with posix_fadvise.  The placement of the chunks is
+ * described by the number of discontiguities (consecutive chunks in the logical order that are not
+ * adjacent in the file) and the total distance of the seeks between them.
+ *
+ * To compile the program, please use h5cc.  The -h option lists all the command line options:
+ *
+ *   [-h] [-i --inFile] [-n --nameDset] [-o --outFile] [-l --lSlack] [-v --Verbose]
+ *
+ * Example: The commands
+ *
+ *           h5cc alloc.c -o alloc
+ *           h5cc compact.c -o compact
+ *           ./alloc -u 2000 -n 3 -p 1 -f 1
+ *           ./compact -i alloc_file.h5
+ *           ./compact -i alloc_file.h5 -o alloc_file_repacked.h5
+ *
+ * create a fragmented file, rewrite its dataset "sparse" in place and compact it into a new file.
+ */
+
+#include "hdf5.h"
+#include "structured_chunk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define FILE_NAME                       "alloc_file.h5"
+#define DSET_NAME                       "sparse"
+#define SLACK_PERCENT                   0
+
+typedef struct {
+    char           *in_file;
+    char           *dset_name;
+    char           *out_file;        /* output file for the repack mode; NULL to rewrite in place */
+    int             slack;           /* slack capacity in percent kept for future growth */
+    int             v;               /* prints progress messages */
+} handler_t;
+
+typedef struct {
+    long long int   nchunks;         /* number of stored chunks */
+    long long int   bytes;           /* stored size of the chunks */
+    long long int   span;            /* distance between the first and the last byte of the chunks */
+    long long int   discontig;       /* number of discontiguities in the logical order */
+    long long int   seek;            /* total seek distance in the logical order */
+    long long int   file;            /* size of the file */
+    long long int   free_space;      /* free space tracked by the library */
+    double          seconds;         /* time to read all chunks */
+    uint32_t        checksum;        /* checksum of the decoded sections */
+} layout_t;
+
+handler_t    hand;
+layout_t     before, after;
+
+/*------------------------------------------------------------
+ * Display command line usage
+ *------------------------------------------------------------
+ */
+void
+usage(void)
+{
+    printf("    [-h] [-i --inFile] [-n --nameDset] [-o --outFile] [-l --lSlack] [-v --Verbose]\n");
+    printf("    [-h --help]: this help page\n");
+    printf("    [-i --inFile]: the file with the dataset to compact (default %s)\n", FILE_NAME);
+    printf("    [-n --nameDset]: the name of the dataset to compact (default %s)\n", DSET_NAME);
+    printf("    [-o --outFile]: repack into this file instead of rewriting the dataset in place\n");
+    printf("    [-l --lSlack]: slack capacity in percent of the chunk size kept for future growth (default 0)\n");
+    printf("    [-v --Verbose]: Print progress messages(1); default no messages displayed (0) \n");
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Parse command line option
+ *------------------------------------------------------------
+ */
+void
+parse_command_line(int argc, char *argv[])
+{
+    int           opt;
+    struct option long_options[] = {
+                                    {"help", no_argument, NULL, 'h'},
+                                    {"inFile=", required_argument, NULL, 'i'},
+                                    {"nameDset=", required_argument, NULL, 'n'},
+                                    {"outFile=", required_argument, NULL, 'o'},
+                                    {"lSlack=", required_argument, NULL, 'l'},
+                                    {"Verbose=", required_argument, NULL, 'v'},
+                                    {NULL, 0, NULL, 0}};
+
+    /* Initialize the command line options */
+    hand.in_file   = FILE_NAME;
+    hand.dset_name = DSET_NAME;
+    hand.out_file  = NULL;
+    hand.slack     = SLACK_PERCENT;
+    hand.v         = 0;
+
+    while ((opt = getopt_long(argc, argv, "hi:n:o:l:v:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'h':
+                fprintf(stdout, "Help page:\n");
+                usage();
+
+                exit(0);
+
+                break;
+            case 'i':
+                if (optarg) {
+                    fprintf(stdout, "Input file:\t\t\t\t\t\t%s\n", optarg);
+                    hand.in_file = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'n':
+                if (optarg) {
+                    fprintf(stdout, "Dataset:\t\t\t\t\t\t%s\n", optarg);
+                    hand.dset_name = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'o':
+                if (optarg) {
+                    fprintf(stdout, "Repack into file:\t\t\t\t\t%s\n", optarg);
+                    hand.out_file = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'l':
+                if (optarg) {
+                    fprintf(stdout, "Slack capacity in percent:\t\t\t\t%s\n", optarg);
+                    hand.slack = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'v':
+                if (optarg) {
+                    hand.v = atoi(optarg);
+                    if (hand.v == 1)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\ton\n");
+                    else if (hand.v == 0)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Verbose mode:\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case ':':
+                printf("Option needs a value\n");
+                break;
+            case '?':
+                printf("Unknown option: %c\n", optopt);
+                break;
+        }
+    }
+
+    /* optind is for the extra arguments which are not parsed */
+    for (; optind < argc; optind++) {
+        printf("extra arguments not parsed: %s\n", argv[optind]);
+    }
+
+    /* Make sure the command line options are valid */
+    if (hand.slack < 0) {
+        printf("The slack capacity can't be negative\n");
+        exit(1);
+    }
+
+    if (hand.v < 0 || hand.v > 1) {
+        printf("Verbose flag can only be 0 or 1 \n");
+        exit(1);
+    }
+}
+
+/*------------------------------------------------------------
+ * Print chunk placement and read throughput
+ *------------------------------------------------------------
+ */
+void print_layout(const char *label, layout_t *l)
+{
+    printf("%10s %10lli %12lli %12lli %10lli %12lli %12lli %10lli %10.1f\n", label, l->nchunks, l->bytes, l->span,
+           l->discontig, l->seek, l->file, l->free_space, l->bytes / l->seconds / (1024 * 1024));
+}
+
+void print_results(void)
+{
+    printf("\n");
+    printf("Printing number of chunks (NC), stored chunk size (CS), span of the chunks in the file (SPAN),\n");
+    printf("discontiguities (DC) and seek distance (SEEK) in the logical order, file size (FS), free space (FREE)\n");
+    printf("and read throughput in MiB/s (RT) before and after compaction\n");
+    printf("\n");
+    printf("                   NC           CS         SPAN         DC         SEEK           FS       FREE         RT\n");
+    printf("\n");
+    print_layout("before", &before);
+    print_layout("after", &after);
+    printf("\n");
+    if (before.checksum != after.checksum)
+        printf("Data read after compaction differs from data read before compaction\n");
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Describe the placement of the chunks of a dataset
+ *------------------------------------------------------------
+ */
+int get_layout(hid_t dset, layout_t *l)
+{
+    sc_chunk_loc_t *locs;
+    size_t          nchunks, n;
+    haddr_t         lo = HADDR_UNDEF, hi = 0;
+
+    if (sc_get_chunk_locations(dset, &nchunks, &locs) < 0)
+        return -1;
+
+    memset(l, 0, sizeof(layout_t));
+    l->nchunks = (long long int)nchunks;
+    for (n = 0; n < nchunks; n++) {
+        l->bytes += (long long int)locs[n].size;
+        if (locs[n].addr < lo)
+            lo = locs[n].addr;
+        if (locs[n].addr + locs[n].size > hi)
+            hi = locs[n].addr + locs[n].size;
+        if (n > 0 && locs[n].addr != locs[n - 1].addr + locs[n - 1].size) {
+            haddr_t prev_end = locs[n - 1].addr + locs[n - 1].size;
+
+            l->discontig++;
+            l->seek += (long long int)(locs[n].addr > prev_end ? locs[n].addr - prev_end : prev_end - locs[n].addr);
+        }
+    }
+    l->span = nchunks ? (long long int)(hi - lo) : 0;
+
+    free(locs);
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Drop the pages of a file from the page cache
+ *------------------------------------------------------------
+ */
+void drop_cache(const char *file_name)
+{
+    int fd;
+
+    if ((fd = open(file_name, O_RDONLY)) < 0)
+        return;
+    fsync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+/*------------------------------------------------------------
+ * Read all chunks of a dataset in the logical order; returns the
+ * checksum of the decoded sections and the time spent
+ *------------------------------------------------------------
+ */
+int read_chunks(hid_t dset, uint32_t *checksum, double *seconds)
+{
+    sc_chunk_loc_t *locs;
+    size_t          nchunks, n;
+    struct timespec start, end;
+    uLong           crc = crc32(0L, Z_NULL, 0);
+
+    if (sc_get_chunk_locations(dset, &nchunks, &locs) < 0)
+        return -1;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (n = 0; n < nchunks; n++) {
+        sc_chunk_info_t info;
+        void           *buf[SC_MAX_SECTIONS] = {NULL};
+        unsigned        i;
+
+        if (sc_read_struct_chunk(dset, H5P_DEFAULT, locs[n].offset, &info, NULL) < 0)
+            goto error;
+        for (i = 0; i < info.num_sections; i++)
+            buf[i] = malloc(info.section_orig_size[i] ? info.section_orig_size[i] : 1);
+        if (sc_read_struct_chunk(dset, H5P_DEFAULT, locs[n].offset, &info, buf) < 0)
+            goto error;
+        for (i = 0; i < info.num_sections; i++) {
+            crc = crc32(crc, (const Bytef *)buf[i], (uInt)info.section_orig_size[i]);
+            free(buf[i]);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    *seconds  = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    *checksum = (uint32_t)crc;
+
+    free(locs);
+    return 0;
+
+error:
+    free(locs);
+    return -1;
+}
+
+/*------------------------------------------------------------
+ * Measure placement, file size and read throughput of the
+ * dataset in a file
+ *------------------------------------------------------------
+ */
+int measure(const char *file_name, const char *dset_name, layout_t *l)
+{
+    hid_t   file, dset;
+    hsize_t file_size;
+
+    drop_cache(file_name);
+
+    file = H5Fopen(file_name, H5F_ACC_RDONLY, H5P_DEFAULT);
+    dset = H5Dopen2(file, dset_name, H5P_DEFAULT);
+    if (dset < 0 || get_layout(dset, l) < 0 || read_chunks(dset, &l->checksum, &l->seconds) < 0) {
+        printf("Failed to read dataset %s in %s\n", dset_name, file_name);
+        exit(1);
+    }
+    H5Fget_filesize(file, &file_size);
+    l->file       = (long long int)file_size;
+    l->free_space = (long long int)H5Fget_freespace(file);
+    H5Dclose(dset);
+    H5Fclose(file);
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Rewrite the dataset in place while a reader keeps its
+ * snapshot open
+ *------------------------------------------------------------
+ */
+int compact_in_place(hid_t dxpl)
+{
+    hid_t    file, snapshot;
+    uint32_t checksum;
+    double   seconds;
+
+    file = H5Fopen(hand.in_file, H5F_ACC_RDWR, H5P_DEFAULT);
+
+    /* Without persistent free space the space of the original chunks would be lost at close */
+    if (sc_file_persists_free_space(file) != 1) {
+        printf("%s does not keep its free space across sessions; create it with persistent free-space\n"
+               "managers (alloc -f 1) or repack it with -o\n", hand.in_file);
+        H5Fclose(file);
+        return -1;
+    }
+
+    /* The reader opens the dataset before the rewrite starts */
+    snapshot = H5Dopen2(file, hand.dset_name, H5P_DEFAULT);
+
+    if (hand.v) printf("Rewriting dataset %s in %s\n", hand.dset_name, hand.in_file);
+    if (sc_compact_dataset(file, hand.dset_name, dxpl) < 0) {
+        printf("Failed to rewrite dataset %s\n", hand.dset_name);
+        H5Dclose(snapshot);
+        H5Fclose(file);
+        return -1;
+    }
+
+    /* The reader's snapshot still returns the data it had before the rewrite */
+    if (read_chunks(snapshot, &checksum, &seconds) < 0 || checksum != before.checksum)
+        printf("The reader's snapshot changed during the rewrite\n");
+    else if (hand.v)
+        printf("The reader's snapshot is unchanged after the rewrite\n");
+
+    /* Closing the snapshot releases the space of the original chunks */
+    H5Dclose(snapshot);
+    H5Fclose(file);
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Check whether the group whose path (relative to the root
+ * group) is the first "len" characters of "name" contains the
+ * dataset being compacted; len 0 is the root group
+ *------------------------------------------------------------
+ */
+int on_dset_path(const char *name, size_t len)
+{
+    const char *path = hand.dset_name + (hand.dset_name[0] == '/');
+
+    return len == 0 || (strncmp(path, name, len) == 0 && path[len] == '/');
+}
+
+/*------------------------------------------------------------
+ * Recreate a soft or external link of a group on the path of
+ * the compacted dataset in the output file (callback for
+ * H5Literate2); the hard links are copied by copy_object
+ *------------------------------------------------------------
+ */
+herr_t copy_link(hid_t group, const char *name, const H5L_info2_t *info, void *op_data)
+{
+    hid_t       dst = *(hid_t *)op_data;
+    const char *file_name, *obj_name;
+    char       *buf;
+    herr_t      ret;
+
+    if (info->type == H5L_TYPE_HARD)
+        return 0;
+    if (NULL == (buf = (char *)malloc(info->u.val_size)))
+        return -1;
+    ret = H5Lget_val(group, name, buf, info->u.val_size, H5P_DEFAULT);
+    if (ret >= 0 && info->type == H5L_TYPE_SOFT)
+        ret = H5Lcreate_soft(buf, dst, name, H5P_DEFAULT, H5P_DEFAULT);
+    else if (ret >= 0 && info->type == H5L_TYPE_EXTERNAL) {
+        ret = H5Lunpack_elink_val(buf, info->u.val_size, NULL, &file_name, &obj_name);
+        if (ret >= 0)
+            ret = H5Lcreate_external(file_name, obj_name, dst, name, H5P_DEFAULT, H5P_DEFAULT);
+    }
+    free(buf);
+
+    return ret;
+}
+
+/*------------------------------------------------------------
+ * Copy an object of the input file to the output file except
+ * the dataset being compacted (callback for H5Ovisit3).  The
+ * groups on the path of the dataset were created with it, so
+ * only their attributes and links are copied; the other
+ * objects in them are copied with H5Ocopy, which copies the
+ * objects below them too
+ *------------------------------------------------------------
+ */
+herr_t copy_object(hid_t obj, const char *name, const H5O_info2_t *info, void *op_data)
+{
+    hid_t       out_file = *(hid_t *)op_data;
+    hid_t       src, dst;
+    const char *path  = hand.dset_name + (hand.dset_name[0] == '/');
+    const char *slash = strrchr(name, '/');
+    herr_t      ret   = -1;
+
+    if (strcmp(name, ".") == 0 || (info->type == H5O_TYPE_GROUP && on_dset_path(name, strlen(name)))) {
+        src = H5Gopen2(obj, name, H5P_DEFAULT);
+        dst = H5Gopen2(out_file, name, H5P_DEFAULT);
+        if (src >= 0 && dst >= 0 && H5Aiterate2(src, H5_INDEX_NAME, H5_ITER_INC, NULL, sc_copy_attribute, &dst) >= 0)
+            ret = H5Literate2(src, H5_INDEX_NAME, H5_ITER_INC, NULL, copy_link, &dst);
+        H5Gclose(dst);
+        H5Gclose(src);
+        return ret;
+    }
+
+    /* Skip the compacted dataset and the objects copied with their group */
+    if (strcmp(name, path) == 0 || !on_dset_path(name, slash ? (size_t)(slash - name) : 0))
+        return 0;
+    return H5Ocopy(obj, name, out_file, name, H5P_DEFAULT, H5P_DEFAULT);
+}
+
+/*------------------------------------------------------------
+ * Repack the file with the compacted dataset
+ *------------------------------------------------------------
+ */
+int compact_repack(hid_t dxpl)
+{
+    hid_t file, out_file;
+    hid_t src, dst, dcpl, dtype, dspace, lcpl;
+    int   ret = 0;
+
+    file     = H5Fopen(hand.in_file, H5F_ACC_RDONLY, H5P_DEFAULT);
+    out_file = H5Fcreate(hand.out_file, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+
+    if (hand.v) printf("Repacking %s into %s\n", hand.in_file, hand.out_file);
+
+    /* Write the chunks of the compacted dataset first, so that they are contiguous; the groups on
+       its path are created with it */
+    src    = H5Dopen2(file, hand.dset_name, H5P_DEFAULT);
+    dcpl   = H5Dget_create_plist(src);
+    dtype  = H5Dget_type(src);
+    dspace = H5Dget_space(src);
+    lcpl   = H5Pcreate(H5P_LINK_CREATE);
+    H5Pset_create_intermediate_group(lcpl, 1);
+    dst = H5Dcreate2(out_file, hand.dset_name, dtype, dspace, lcpl, dcpl, H5P_DEFAULT);
+    if (dst < 0 || sc_copy_struct_chunks(src, dst, dxpl) < 0 ||
+        H5Aiterate2(src, H5_INDEX_NAME, H5_ITER_INC, NULL, sc_copy_attribute, &dst) < 0) {
+        printf("Failed to copy dataset %s\n", hand.dset_name);
+        ret = -1;
+    }
+    H5Dclose(dst);
+    H5Pclose(lcpl);
+    H5Sclose(dspace);
+    H5Tclose(dtype);
+    H5Pclose(dcpl);
+    H5Dclose(src);
+
+    /* Copy the remaining objects */
+    if (ret == 0 && H5Ovisit3(file, H5_INDEX_NAME, H5_ITER_INC, copy_object, &out_file, H5O_INFO_BASIC) < 0) {
+        printf("Failed to copy the objects of %s\n", hand.in_file);
+        ret = -1;
+    }
+
+    H5Fclose(out_file);
+    H5Fclose(file);
+
+    return ret;
+}
+
+/*------------------------------------------------------------
+ * Main function
+ *------------------------------------------------------------
+ */
+int
+main(int argc, char **argv)
+{
+    hid_t dxpl;
+    int   ret;
+
+    parse_command_line(argc, argv);
+
+    measure(hand.in_file, hand.dset_name, &before);
+
+    /* Keep the requested slack capacity in the compacted chunks */
+    dxpl = H5Pcreate(H5P_DATASET_XFER);
+    sc_set_alloc_policy(dxpl, hand.slack ? SC_ALLOC_SLACK : SC_ALLOC_EXACT, hand.slack);
+
+    if (hand.out_file)
+        ret = compact_repack(dxpl);
+    else
+        ret = compact_in_place(dxpl);
+    H5Pclose(dxpl);
+    if (ret < 0)
+        return 1;
+
+    measure(hand.out_file ? hand.out_file : hand.in_file, hand.dset_name, &after);
+
+    if (hand.v) printf("Done! \n");
+
+    /* Print results */
+    print_results();
+
+    return 0;
+}
@@ -0,0 +1,859 @@
+/*
+ * This program measures reads of sparse data with a type conversion and a data transform.  H5Dread of
+ * the dense "sparse" dataset of sparse.c converts every element of the selection from the file type to
+ * the memory type and applies the transform set with H5Pset_data_transform to every element, including
+ * the fill values of the undefined elements.  For structured chunks only the packed values of the defined
+ * elements are converted and transformed, in place in the buffer of the Data section; the fill value is
+ * converted and transformed once.
+ *
+ * For each percentage of data density X between 1 and M (command line option -m), the program creates
+ * a file "convert_file.h5" with two 2-dim datasets of G1 x G2 chunks (option -g) of 64-bit floating-point
+ * numbers (H5T_IEEE_F64LE):
+ *
+ *  sparse     - a regular chunked dataset in which undefined elements hold the fill value, as in sparse.c
+ *  structured - structured chunks with the Encoded Selection and the values of the defined elements
+ *
+ * The defined elements are placed in each chunk as in sparse.c (option -s): 1 - random locations in
+ * each row, 2 - a randomly placed rectangle, 3 - randomly placed continuous locations in each row.
+ * The fill value is specified with the option -f (default 0).
+ *
+ * The whole dataset is read chunk by chunk as 32-bit floats (H5T_NATIVE_FLOAT) without and with the
+ * data transform given with the option -t (default "2.5*x+1"; the expression must be linear in x) with:
+ *
+ *  dense  - H5Dread of each chunk of the "sparse" dataset into a buffer of dense chunks
+ *  fill   - sc_read_dense_chunk of each structured chunk into a buffer of dense chunks
+ *  elide  - sc_read_dense_chunk into a buffer that holds the fill value (sc_set_fill_initialized)
+ *  packed - sc_read_struct_chunk_mem of each structured chunk: the values of the defined elements only
+ *
+ * Doubles are converted to floats four at a time with SSE2 (sc_convert_values) and the transform is
+ * applied as scale * x + offset four floats at a time (sc_transform_values).  The program also converts
+ * and transforms the values in memory, without the reads: the dense chunks and the packed values with
+ * H5Tconvert, the packed values with sc_convert_values, and the transform of the dense chunks and of
+ * the packed values.  The files are read from the page cache.  Each pass is repeated R times (option -r)
+ * and the best time is reported.  With the option -k 1 the buffers of the structured reads are compared
+ * with the buffers of the dense reads.
+ *
+ * To compile the program, please use h5cc.  The -h option lists all the command line options:
+ *
+ *   [-h] [-c --dimsChunk] [-g --gridChunks] [-m --mPercent] [-s --spaceSelect] [-f --fillValue]
+ *   [-t --tTransform] [-r --rRepeat] [-k --kVerify] [-v --Verbose]
+ *
+ * Example: The commands
+ *
+ *           h5cc convert_read.c -o convert_read
+ *           ./convert_read -c 1024x1024 -g 4x4 -m 20 -t "2.5*x+1" -k 1
+ *
+ * read 16 chunks of 1024x1024 doubles (128 MiB) as floats at densities from 1 to 20 percent from the
+ * dense dataset and from the structured chunks, without and with the transform 2.5*x+1.
+ */
+
+#include "hdf5.h"
+#include "structured_chunk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <time.h>
+#include <math.h>
+#include <string.h>
+#include <getopt.h>
+
+#define FILE_NAME                       "convert_file.h5"
+#define DSET_NAME                       "sparse"
+#define STRUCT_DSET_NAME                "structured"
+#define TRANSFORM                       "2.5*x+1"
+#define CHUNK_DIM1                      1024
+#define CHUNK_DIM2                      1024
+#define GRID_DIM1                       4
+#define GRID_DIM2                       4
+#define GROUP_NUM                       10
+#define MAX_PERCENT                     20
+#define REPEAT                          3
+#define RANK                            2
+#define TOLERANCE                       1e-6        /* Relative difference of the transformed values */
+
+/* Reads of the dataset */
+#define READ_DENSE                      0
+#define READ_FILL                       1
+#define READ_ELIDE                      2
+#define READ_PACKED                     3
+#define NUM_READS                       4
+
+/* Conversions and transforms in memory */
+#define MEM_CONVERT_DENSE               0           /* H5Tconvert of the dense chunks */
+#define MEM_CONVERT_PACKED              1           /* H5Tconvert of the packed values */
+#define MEM_CONVERT_SSE                 2           /* sc_convert_values of the packed values */
+#define MEM_TRANSFORM_DENSE             3
+#define MEM_TRANSFORM_PACKED            4
+#define NUM_MEM                         5
+
+typedef struct {
+    long long int   chunk_dim1;
+    long long int   chunk_dim2;
+    long long int   grid_dim1;
+    long long int   grid_dim2;
+    int             max_percent;
+    int             space_select;
+    double          fill;            /* fill value */
+    char           *transform;       /* data transform expression */
+    int             repeat;
+    int             k;               /* compares the buffers */
+    int             v;               /* prints progress messages */
+} handler_t;
+
+/* Decoded structured chunk */
+typedef struct {
+    size_t          nruns;
+    sc_run_t       *runs;
+    double         *data;
+    uint64_t        nelemts;
+} decoded_t;
+
+typedef struct {
+    long long int   nelemts;         /* number of defined elements */
+    double          t_read[2][NUM_READS];  /* best times without and with the transform */
+    double          t_mem[NUM_MEM];
+    int             verified;        /* -1 not verified, 0 failed, 1 passed */
+} result_t;
+
+handler_t    hand;
+result_t     res[MAX_PERCENT];
+
+/*------------------------------------------------------------
+ * Display command line usage
+ *------------------------------------------------------------
+ */
+void
+usage(void)
+{
+    printf("    [-h] [-c --dimsChunk] [-g --gridChunks] [-m --mPercent] [-s --spaceSelect] [-f --fillValue]\n");
+    printf("    [-t --tTransform] [-r --rRepeat] [-k --kVerify] [-v --Verbose]\n");
+    printf("    [-h --help]: this help page\n");
+    printf("    [-c --dimsChunk]: the chunk dimensions (default %dx%d)\n", CHUNK_DIM1, CHUNK_DIM2);
+    printf("    [-g --gridChunks]: the number of chunks in each dimension (default %dx%d)\n", GRID_DIM1, GRID_DIM2);
+    printf("    [-m --mPercent]: the maximal percentage of data density, e.g., a value of 5 means the data density will be from 1 to 5 percent (default %d)\n", GROUP_NUM);
+    printf("    [-s --spaceSelect]: the selection of the defined elements in each chunk: random points in each row (1, default),\n");
+    printf("	    a randomly placed rectangle (2) or continuous points in each row with random position (3)\n");
+    printf("    [-f --fillValue]: the fill value (default 0)\n");
+    printf("    [-t --tTransform]: the data transform expression, linear in x (default %s)\n", TRANSFORM);
+    printf("    [-r --rRepeat]: the number of reads of each pass (default %d)\n", REPEAT);
+    printf("    [-k --kVerify]: compare the buffers of the structured reads with the dense reads (1) or not (0, default)\n");
+    printf("    [-v --Verbose]: Print progress messages(1); default no messages displayed (0) \n");
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Parse a string of the form AxB; missing dimensions are set
+ * to 0
+ *------------------------------------------------------------
+ */
+void
+parse_dims(const char *str, int ndims, long long int *dims[])
+{
+    char *dims_str, *dim_str;
+    int   i;
+
+    dims_str = strdup(str);
+    dim_str  = strtok(dims_str, "x");
+    for (i = 0; i < ndims; i++) {
+        *dims[i] = dim_str ? atoll(dim_str) : 0;
+        dim_str  = strtok(NULL, "x");
+    }
+    free(dims_str);
+}
+
+/*------------------------------------------------------------
+ * Parse command line option
+ *------------------------------------------------------------
+ */
+void
+parse_command_line(int argc, char *argv[])
+{
+    int            opt, has_transform;
+    double         scale, offset;
+    hid_t          dxpl;
+    long long int *chunk_dims[2] = {&hand.chunk_dim1, &hand.chunk_dim2};
+    long long int *grid_dims[2]  = {&hand.grid_dim1, &hand.grid_dim2};
+    struct option  long_options[] = {
+                                    {"help", no_argument, NULL, 'h'},
+                                    {"dimsChunk=", required_argument, NULL, 'c'},
+                                    {"gridChunks=", required_argument, NULL, 'g'},
+                                    {"mPercent=", required_argument, NULL, 'm'},
+                                    {"spaceSelect=", required_argument, NULL, 's'},
+                                    {"fillValue=", required_argument, NULL, 'f'},
+                                    {"tTransform=", required_argument, NULL, 't'},
+                                    {"rRepeat=", required_argument, NULL, 'r'},
+                                    {"kVerify=", required_argument, NULL, 'k'},
+                                    {"Verbose=", required_argument, NULL, 'v'},
+                                    {NULL, 0, NULL, 0}};
+
+    /* Initialize the command line options */
+    hand.chunk_dim1   = CHUNK_DIM1;
+    hand.chunk_dim2   = CHUNK_DIM2;
+    hand.grid_dim1    = GRID_DIM1;
+    hand.grid_dim2    = GRID_DIM2;
+    hand.max_percent  = GROUP_NUM;
+    hand.space_select = 1;
+    hand.fill         = 0;
+    hand.transform    = TRANSFORM;
+    hand.repeat       = REPEAT;
+    hand.k            = 0;
+    hand.v            = 0;
+
+    while ((opt = getopt_long(argc, argv, "hc:g:m:s:f:t:r:k:v:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'h':
+                fprintf(stdout, "Help page:\n");
+                usage();
+
+                exit(0);
+
+                break;
+            case 'c':
+                if (optarg) {
+                    fprintf(stdout, "Chunk dimensions:\t\t\t\t\t%s\n", optarg);
+                    parse_dims(optarg, 2, chunk_dims);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'g':
+                if (optarg) {
+                    fprintf(stdout, "Chunks in each dimension:\t\t\t\t%s\n", optarg);
+                    parse_dims(optarg, 2, grid_dims);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'm':
+                if (optarg) {
+                    fprintf(stdout, "Maximal percentage of data density:\t\t\t%s\n", optarg);
+                    hand.max_percent = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 's':
+                if (optarg) {
+                    hand.space_select = atoi(optarg);
+
+                    if (hand.space_select == 1)
+                        fprintf(stdout, "Options of data space selection:\t\t\trandomly selected locations in each row\n");
+                    else if (hand.space_select == 2)
+                        fprintf(stdout, "Options of data space selection:\t\t\trandomly selected rectangular in the whole chunk\n");
+                    else if (hand.space_select == 3)
+                        fprintf(stdout, "Options of data space selection:\t\t\trandomly selected continuous locations in each row\n");
+                    else
+                        fprintf(stdout, "Options of data space selection:\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'f':
+                if (optarg) {
+                    fprintf(stdout, "Fill value:\t\t\t\t\t\t%s\n", optarg);
+                    hand.fill = atof(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 't':
+                if (optarg) {
+                    fprintf(stdout, "Data transform:\t\t\t\t\t\t%s\n", optarg);
+                    hand.transform = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'r':
+                if (optarg) {
+                    fprintf(stdout, "Number of reads of each pass:\t\t\t\t%s\n", optarg);
+                    hand.repeat = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'k':
+                if (optarg) {
+                    hand.k = atoi(optarg);
+                    if (hand.k == 1)
+                        fprintf(stdout, "Verify: \t\t\t\t\t\ton\n");
+                    else if (hand.k == 0)
+                        fprintf(stdout, "Verify: \t\t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Verify:\t\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'v':
+                if (optarg) {
+                    hand.v = atoi(optarg);
+                    if (hand.v == 1)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\ton\n");
+                    else if (hand.v == 0)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Verbose mode:\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case ':':
+                printf("Option needs a value\n");
+                break;
+            case '?':
+                printf("Unknown option: %c\n", optopt);
+                break;
+        }
+    }
+
+    /* optind is for the extra arguments which are not parsed */
+    for (; optind < argc; optind++) {
+        printf("extra arguments not parsed: %s\n", argv[optind]);
+    }
+
+    /* Make sure the command line options are valid */
+    if (hand.chunk_dim1 < 1 || hand.chunk_dim2 < 1 || hand.grid_dim1 < 1 || hand.grid_dim2 < 1) {
+        printf("The chunk dimensions and the number of chunks must be positive\n");
+        exit(1);
+    }
+
+    if (hand.max_percent < 1 || hand.max_percent > MAX_PERCENT) {
+        printf("The maximal percentage of the data density isn't valid\n");
+        exit(1);
+    }
+
+    if (hand.space_select < 1 || hand.space_select > 3) {
+        printf("The option of hyperslab selection can only be 1, 2, or 3\n");
+        exit(1);
+    }
+
+    dxpl = H5Pcreate(H5P_DATASET_XFER);
+    if (H5Pset_data_transform(dxpl, hand.transform) < 0 ||
+        sc_get_transform(dxpl, &has_transform, &scale, &offset) < 0) {
+        printf("The data transform must be an expression linear in x, e.g. 2.5*x+1\n");
+        exit(1);
+    }
+    H5Pclose(dxpl);
+
+    if (hand.repeat < 1) {
+        printf("The number of reads must be positive\n");
+        exit(1);
+    }
+
+    if (hand.k < 0 || hand.k > 1) {
+        printf("Verify flag can only be 0 or 1 \n");
+        exit(1);
+    }
+
+    if (hand.v < 0 || hand.v > 1) {
+        printf("Verbose flag can only be 0 or 1 \n");
+        exit(1);
+    }
+}
+
+/*------------------------------------------------------------
+ * Elapsed time
+ *------------------------------------------------------------
+ */
+double elapsed(struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*------------------------------------------------------------
+ * Print the results
+ *------------------------------------------------------------
+ */
+void print_results(int index)
+{
+    int i, j, x;
+
+    for (x = 0; x < 2; x++) {
+        printf("\n");
+        printf("Printing percentage, number of defined elements (NE), time to read the dataset as floats%s from the dense\n",
+               x ? " with the transform" : "");
+        printf("dataset (TD), from the structured chunks with the fill (TF), with the fill elided (TE) and as packed values\n");
+        printf("(TP) in seconds, the speedup of TF, TE and TP over TD (SF, SE, SP) and the result of the comparison of the\n");
+        printf("buffers (OK, FAILED or - if not compared)\n");
+        printf("\n");
+        printf("         %%         NE         TD         TF         TE         TP         SF         SE         SP   VERIFIED\n");
+        printf("\n");
+
+        for (i = 0; i < index; i++) {
+            printf("%10d %10lli", i + 1, res[i].nelemts);
+            for (j = 0; j < NUM_READS; j++)
+                printf(" %10.4f", res[i].t_read[x][j]);
+            for (j = READ_FILL; j < NUM_READS; j++)
+                printf(" %10.1f", res[i].t_read[x][READ_DENSE] / res[i].t_read[x][j]);
+            printf(" %10s \n", res[i].verified < 0 ? "-" : res[i].verified ? "OK" : "FAILED");
+        }
+    }
+
+    printf("\n");
+    printf("Printing percentage, time to convert the doubles to floats in memory: the dense chunks with H5Tconvert (CD),\n");
+    printf("the packed values with H5Tconvert (CP) and with sc_convert_values (CV), and time to apply the transform to the\n");
+    printf("dense chunks (XD) and to the packed values (XP) in seconds\n");
+    printf("\n");
+    printf("         %%         CD         CP         CV         XD         XP\n");
+    printf("\n");
+
+    for (i = 0; i < index; i++) {
+        printf("%10d", i + 1);
+        for (j = 0; j < NUM_MEM; j++)
+            printf(" %10.4f", res[i].t_mem[j]);
+        printf(" \n");
+    }
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Mark the defined elements of a chunk as in create_hyperslab
+ * of sparse.c
+ *------------------------------------------------------------
+ */
+void generate_mask(int percent, uint8_t *mask)
+{
+    uint64_t dim1 = hand.chunk_dim1, dim2 = hand.chunk_dim2;
+    uint64_t i, j;
+
+    memset(mask, 0, dim1 * dim2);
+
+    if (hand.space_select == 1) {
+        uint64_t num_selections = dim2 * percent / 100;
+        uint64_t sections       = 100 / percent;
+
+        /* One random point in each section of the row */
+        for (i = 0; i < dim1; i++)
+            for (j = 0; j < num_selections; j++)
+                mask[i * dim2 + j * sections + rand() % sections] = 1;
+    }
+    else if (hand.space_select == 2) {
+        /* A rectangle of the shape of the chunk with its upper-left corner in the upper-left quadrant */
+        uint64_t start1 = rand() % (dim1 / 2 ? dim1 / 2 : 1);
+        uint64_t start2 = rand() % (dim2 / 2 ? dim2 / 2 : 1);
+        uint64_t block1 = dim1 * sqrt(percent) / 10;
+        uint64_t block2 = dim2 * sqrt(percent) / 10;
+
+        for (i = start1; i < start1 + block1; i++)
+            memset(mask + i * dim2 + start2, 1, block2);
+    }
+    else {
+        /* Continuous points with a random position in each row */
+        uint64_t block = dim2 * percent / 100;
+
+        for (i = 0; i < dim1; i++)
+            memset(mask + i * dim2 + rand() % (dim2 - block), 1, block);
+    }
+}
+
+/*------------------------------------------------------------
+ * Create the file with the dense and the structured datasets
+ * of one percentage
+ *------------------------------------------------------------
+ */
+int create_file(int percent, long long int *nelemts)
+{
+    hid_t           file, space, dcpl, struct_dcpl, dset, struct_dset, mem_space, file_space;
+    hsize_t         dims[RANK], chunk_dims[RANK], offset[RANK];
+    uint64_t        size = hand.chunk_dim1 * hand.chunk_dim2;
+    uint8_t        *mask, *sel;
+    double         *dense, *data;
+    sc_run_t       *runs;
+    sc_chunk_info_t info;
+    const void     *buf[2];
+    size_t          nruns, n;
+    uint64_t        e, c, ndefined;
+    int             ret_value = 0;
+
+    chunk_dims[0] = hand.chunk_dim1;
+    chunk_dims[1] = hand.chunk_dim2;
+    dims[0]       = hand.chunk_dim1 * hand.grid_dim1;
+    dims[1]       = hand.chunk_dim2 * hand.grid_dim2;
+
+    file  = H5Fcreate(FILE_NAME, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    space = H5Screate_simple(RANK, dims, NULL);
+
+    dcpl = H5Pcreate(H5P_DATASET_CREATE);
+    H5Pset_chunk(dcpl, RANK, chunk_dims);
+    H5Pset_fill_value(dcpl, H5T_NATIVE_DOUBLE, &hand.fill);
+    dset = H5Dcreate2(file, DSET_NAME, H5T_IEEE_F64LE, space, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+
+    struct_dcpl = sc_create_dcpl(RANK, chunk_dims);
+    H5Pset_fill_value(struct_dcpl, H5T_NATIVE_DOUBLE, &hand.fill);
+    struct_dset = H5Dcreate2(file, STRUCT_DSET_NAME, H5T_IEEE_F64LE, space, H5P_DEFAULT, struct_dcpl, H5P_DEFAULT);
+
+    mem_space  = H5Screate_simple(RANK, chunk_dims, NULL);
+    file_space = H5Scopy(space);
+
+    mask  = (uint8_t *)malloc(size);
+    dense = (double *)malloc(size * sizeof(double));
+    data  = (double *)malloc(size * sizeof(double));
+    runs  = (sc_run_t *)malloc(size * sizeof(sc_run_t));
+    sel   = (uint8_t *)malloc(sc_encode_runs(RANK, chunk_dims, size, NULL, NULL));
+
+    *nelemts = 0;
+    for (c = 0; c < (uint64_t)(hand.grid_dim1 * hand.grid_dim2); c++) {
+        offset[0] = (c / hand.grid_dim2) * chunk_dims[0];
+        offset[1] = (c % hand.grid_dim2) * chunk_dims[1];
+
+        generate_mask(percent, mask);
+        for (e = 0; e < size; e++)
+            dense[e] = mask[e] ? (rand() % 1000000 + 1) / 1000.0 : hand.fill;
+
+        /* The dense chunk */
+        H5Sselect_hyperslab(file_space, H5S_SELECT_SET, offset, NULL, chunk_dims, NULL);
+        if (H5Dwrite(dset, H5T_NATIVE_DOUBLE, mem_space, file_space, H5P_DEFAULT, dense) < 0)
+            goto error;
+
+        /* The structured chunk */
+        nruns = sc_mask_to_runs(mask, size, chunk_dims[1], runs);
+        if (nruns == 0)
+            continue;
+        for (n = 0, ndefined = 0; n < nruns; n++)
+            ndefined += runs[n].len;
+        *nelemts += ndefined;
+
+        memset(&info, 0, sizeof(info));
+        info.type                                    = SC_SPARSE_CHUNK;
+        info.num_sections                            = 2;
+        info.nelemts                                 = ndefined;
+        info.section_orig_size[SC_SECTION_SELECTION] = sc_encode_runs(RANK, chunk_dims, nruns, runs, sel);
+        info.section_orig_size[SC_SECTION_FIXED]     = ndefined * sizeof(double);
+        sc_gather_runs(dense, sizeof(double), nruns, runs, data);
+
+        buf[SC_SECTION_SELECTION] = sel;
+        buf[SC_SECTION_FIXED]     = data;
+        if (sc_write_struct_chunk(struct_dset, H5P_DEFAULT, &info, offset, buf) < 0)
+            goto error;
+    }
+
+done:
+    free(mask);
+    free(dense);
+    free(data);
+    free(runs);
+    free(sel);
+    H5Sclose(file_space);
+    H5Sclose(mem_space);
+    H5Dclose(struct_dset);
+    H5Dclose(dset);
+    H5Pclose(struct_dcpl);
+    H5Pclose(dcpl);
+    H5Sclose(space);
+    H5Fclose(file);
+
+    return ret_value;
+
+error:
+    printf("Failed to write the datasets\n");
+    ret_value = -1;
+    goto done;
+}
+
+/*------------------------------------------------------------
+ * Read the whole dense dataset chunk by chunk as floats into a
+ * buffer of dense chunks
+ *------------------------------------------------------------
+ */
+int read_dense(hid_t file, hid_t dxpl, float *buffer, double *t)
+{
+    hid_t           dset, mem_space, file_space;
+    hsize_t         chunk_dims[RANK], offset[RANK];
+    uint64_t        size = hand.chunk_dim1 * hand.chunk_dim2, c;
+    struct timespec start;
+    int             ret_value = 0;
+
+    chunk_dims[0] = hand.chunk_dim1;
+    chunk_dims[1] = hand.chunk_dim2;
+
+    dset       = H5Dopen2(file, DSET_NAME, H5P_DEFAULT);
+    file_space = H5Dget_space(dset);
+    mem_space  = H5Screate_simple(RANK, chunk_dims, NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (c = 0; c < (uint64_t)(hand.grid_dim1 * hand.grid_dim2); c++) {
+        offset[0] = (c / hand.grid_dim2) * chunk_dims[0];
+        offset[1] = (c % hand.grid_dim2) * chunk_dims[1];
+        H5Sselect_hyperslab(file_space, H5S_SELECT_SET, offset, NULL, chunk_dims, NULL);
+        if (H5Dread(dset, H5T_NATIVE_FLOAT, mem_space, file_space, dxpl, buffer + c * size) < 0) {
+            ret_value = -1;
+            break;
+        }
+    }
+    *t = elapsed(&start);
+
+    H5Sclose(mem_space);
+    H5Sclose(file_space);
+    H5Dclose(dset);
+
+    return ret_value;
+}
+
+/*------------------------------------------------------------
+ * Read the whole structured chunk dataset chunk by chunk as
+ * floats: into a buffer of dense chunks, with the fill value
+ * set before the timer starts for "elide", or as the packed
+ * values of the chunks one after the other
+ *------------------------------------------------------------
+ */
+int read_structured(hid_t file, hid_t dxpl, int read, float *buffer, double *t)
+{
+    hid_t           dset, read_dxpl;
+    hsize_t         offset[RANK];
+    uint64_t        size = hand.chunk_dim1 * hand.chunk_dim2, c, i;
+    sc_chunk_info_t info;
+    void           *buf[2];
+    float          *packed = buffer;
+    struct timespec start;
+    int             ret_value = 0;
+
+    dset      = H5Dopen2(file, STRUCT_DSET_NAME, H5P_DEFAULT);
+    read_dxpl = dxpl == H5P_DEFAULT ? H5Pcreate(H5P_DATASET_XFER) : H5Pcopy(dxpl);
+    if (read == READ_ELIDE) {
+        float fill = (float)hand.fill;
+        int   has_transform;
+        double scale, fill_offset;
+
+        sc_get_transform(read_dxpl, &has_transform, &scale, &fill_offset);
+        if (has_transform)
+            fill = fill * (float)scale + (float)fill_offset;
+        for (i = 0; i < size * hand.grid_dim1 * hand.grid_dim2; i++)
+            buffer[i] = fill;
+        sc_set_fill_initialized(read_dxpl, 1);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (c = 0; c < (uint64_t)(hand.grid_dim1 * hand.grid_dim2); c++) {
+        offset[0] = (c / hand.grid_dim2) * hand.chunk_dim1;
+        offset[1] = (c % hand.grid_dim2) * hand.chunk_dim2;
+
+        if (read != READ_PACKED) {
+            if (sc_read_dense_chunk(dset, H5T_NATIVE_FLOAT, read_dxpl, offset, NULL, buffer + c * size) < 0) {
+                ret_value = -1;
+                break;
+            }
+            continue;
+        }
+
+        /* The values are converted in place after the values of the previous chunks; the buffer of the
+         * dense chunks has room for the doubles of up to half of the elements */
+        buf[SC_SECTION_SELECTION] = NULL;
+        buf[SC_SECTION_FIXED]     = packed;
+        if (sc_read_struct_chunk_mem(dset, H5T_NATIVE_FLOAT, read_dxpl, offset, &info, buf) < 0) {
+            ret_value = -1;
+            break;
+        }
+        packed += info.nelemts;
+    }
+    *t = elapsed(&start);
+
+    H5Pclose(read_dxpl);
+    H5Dclose(dset);
+
+    return ret_value;
+}
+
+/*------------------------------------------------------------
+ * Compare a buffer of floats with the buffer of the dense read;
+ * transformed values may differ by the rounding of the order
+ * of the operations
+ *------------------------------------------------------------
+ */
+int compare(const float *expected, const float *buffer, uint64_t n, int transform)
+{
+    uint64_t i;
+
+    if (!transform)
+        return memcmp(expected, buffer, n * sizeof(float)) == 0;
+
+    for (i = 0; i < n; i++)
+        if (fabs((double)expected[i] - buffer[i]) > TOLERANCE * fabs((double)expected[i]) + TOLERANCE)
+            return 0;
+    return 1;
+}
+
+/*------------------------------------------------------------
+ * Read and decode all structured chunks for the conversions in
+ * memory
+ *------------------------------------------------------------
+ */
+int decode_chunks(hid_t file, decoded_t *chunks)
+{
+    hid_t           dset;
+    hsize_t         offset[RANK], dims[RANK];
+    sc_chunk_info_t info;
+    void           *buf[2];
+    uint64_t        c;
+    int             rank;
+
+    dset = H5Dopen2(file, STRUCT_DSET_NAME, H5P_DEFAULT);
+
+    for (c = 0; c < (uint64_t)(hand.grid_dim1 * hand.grid_dim2); c++) {
+        offset[0] = (c / hand.grid_dim2) * hand.chunk_dim1;
+        offset[1] = (c % hand.grid_dim2) * hand.chunk_dim2;
+
+        if (sc_read_struct_chunk(dset, H5P_DEFAULT, offset, &info, NULL) < 0)
+            continue;
+        buf[SC_SECTION_SELECTION] = malloc(info.section_orig_size[SC_SECTION_SELECTION]);
+        buf[SC_SECTION_FIXED]     = malloc(info.section_orig_size[SC_SECTION_FIXED] + 1);
+        if (sc_read_struct_chunk(dset, H5P_DEFAULT, offset, &info, buf) < 0 ||
+            sc_decode_runs(buf[SC_SECTION_SELECTION], info.section_orig_size[SC_SECTION_SELECTION], &rank, dims,
+                           &chunks[c].nruns, NULL) < 0)
+            goto error;
+        chunks[c].runs = (sc_run_t *)malloc((chunks[c].nruns + 1) * sizeof(sc_run_t));
+        sc_decode_runs(buf[SC_SECTION_SELECTION], info.section_orig_size[SC_SECTION_SELECTION], &rank, dims,
+                       &chunks[c].nruns, chunks[c].runs);
+        chunks[c].data    = (double *)buf[SC_SECTION_FIXED];
+        chunks[c].nelemts = info.nelemts;
+        free(buf[SC_SECTION_SELECTION]);
+    }
+
+    H5Dclose(dset);
+    return 0;
+
+error:
+    printf("Failed to decode the structured chunks\n");
+    H5Dclose(dset);
+    return -1;
+}
+
+/*------------------------------------------------------------
+ * Convert or transform the values of the decoded chunks in
+ * memory; the chunk or the packed values are copied to the
+ * scratch buffer before the timer starts
+ *------------------------------------------------------------
+ */
+double convert_chunks(const decoded_t *chunks, int op, double *scratch)
+{
+    uint64_t        size = hand.chunk_dim1 * hand.chunk_dim2, c, n;
+    double          scale, offset, t = 0;
+    int             has_transform;
+    hid_t           dxpl;
+    struct timespec start;
+
+    dxpl = H5Pcreate(H5P_DATASET_XFER);
+    H5Pset_data_transform(dxpl, hand.transform);
+    sc_get_transform(dxpl, &has_transform, &scale, &offset);
+    H5Pclose(dxpl);
+
+    for (c = 0; c < (uint64_t)(hand.grid_dim1 * hand.grid_dim2); c++) {
+        int dense = op == MEM_CONVERT_DENSE || op == MEM_TRANSFORM_DENSE;
+
+        if (dense)
+            sc_fill_scatter_runs(chunks[c].data, sizeof(double), chunks[c].nruns, chunks[c].runs, &hand.fill, size,
+                                 0, scratch);
+        else
+            memcpy(scratch, chunks[c].data, chunks[c].nelemts * sizeof(double));
+        n = dense ? size : chunks[c].nelemts;
+
+        /* The transforms are applied to the values converted to floats */
+        if (op == MEM_TRANSFORM_DENSE || op == MEM_TRANSFORM_PACKED)
+            sc_convert_values(H5T_NATIVE_DOUBLE, H5T_NATIVE_FLOAT, n, scratch, H5P_DEFAULT);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (op == MEM_CONVERT_DENSE || op == MEM_CONVERT_PACKED)
+            H5Tconvert(H5T_NATIVE_DOUBLE, H5T_NATIVE_FLOAT, n, scratch, NULL, H5P_DEFAULT);
+        else if (op == MEM_CONVERT_SSE)
+            sc_convert_values(H5T_NATIVE_DOUBLE, H5T_NATIVE_FLOAT, n, scratch, H5P_DEFAULT);
+        else
+            sc_transform_values(scratch, n, H5T_NATIVE_FLOAT, scale, offset);
+        t += elapsed(&start);
+    }
+
+    return t;
+}
+
+/*------------------------------------------------------------
+ * Main function
+ *------------------------------------------------------------
+ */
+int
+main(int argc, char **argv)
+{
+    hid_t      file, dxpl[2];
+    uint64_t   nchunks, size, c;
+    float     *buffer, *expected = NULL;
+    double    *scratch;
+    decoded_t *chunks;
+    double     t;
+    int        n, i, j, x;
+
+    parse_command_line(argc, argv);
+
+    srand(2);
+
+    nchunks = hand.grid_dim1 * hand.grid_dim2;
+    size    = hand.chunk_dim1 * hand.chunk_dim2 * nchunks;
+
+    dxpl[0] = H5P_DEFAULT;
+    dxpl[1] = H5Pcreate(H5P_DATASET_XFER);
+    H5Pset_data_transform(dxpl[1], hand.transform);
+
+    /* The buffers are touched before the reads so that the page faults are not timed */
+    buffer = (float *)malloc(size * sizeof(float));
+    memset(buffer, 0, size * sizeof(float));
+    if (hand.k)
+        expected = (float *)malloc(size * sizeof(float));
+    scratch = (double *)malloc(hand.chunk_dim1 * hand.chunk_dim2 * sizeof(double));
+    memset(scratch, 0, hand.chunk_dim1 * hand.chunk_dim2 * sizeof(double));
+    chunks = (decoded_t *)calloc(nchunks, sizeof(decoded_t));
+
+    for (n = 0; n < hand.max_percent; n++) {
+        if (hand.v) printf("Generating file for %d percent\n", n + 1);
+        if (create_file(n + 1, &res[n].nelemts) < 0)
+            return 1;
+
+        file = H5Fopen(FILE_NAME, H5F_ACC_RDONLY, H5P_DEFAULT);
+        res[n].verified = hand.k ? 1 : -1;
+
+        for (x = 0; x < 2; x++)
+            for (j = 0; j < NUM_READS; j++) {
+                for (i = 0; i < hand.repeat; i++) {
+                    int ret = j == READ_DENSE ? read_dense(file, dxpl[x], buffer, &t)
+                                              : read_structured(file, dxpl[x], j, buffer, &t);
+
+                    if (ret < 0) {
+                        printf("Failed to read the dataset\n");
+                        return 1;
+                    }
+                    if (i == 0 || t < res[n].t_read[x][j])
+                        res[n].t_read[x][j] = t;
+                }
+
+                if (hand.k && j == READ_DENSE)
+                    memcpy(expected, buffer, size * sizeof(float));
+                else if (hand.k && j != READ_PACKED && !compare(expected, buffer, size, x))
+                    res[n].verified = 0;
+            }
+
+        if (decode_chunks(file, chunks) < 0)
+            return 1;
+        for (j = 0; j < NUM_MEM; j++)
+            for (i = 0; i < hand.repeat; i++) {
+                t = convert_chunks(chunks, j, scratch);
+                if (i == 0 || t < res[n].t_mem[j])
+                    res[n].t_mem[j] = t;
+            }
+        for (c = 0; c < nchunks; c++) {
+            free(chunks[c].runs);
+            free(chunks[c].data);
+        }
+        memset(chunks, 0, nchunks * sizeof(decoded_t));
+
+        H5Fclose(file);
+    }
+
+    print_results(hand.max_percent);
+
+    H5Pclose(dxpl[1]);
+    free(chunks);
+    free(scratch);
+    free(expected);
+    free(buffer);
+
+    return 0;
+}
@@ -0,0 +1,366 @@
+/*
+ * This program compares two ways of getting the defined elements of a whole structured chunk dataset,
+ * the emulation of H5Dget_defined(dset, H5S_ALL, ...) in sc_get_defined():
+ *
+ *  - interleaved: the Encoded Selection of each chunk is stored in the chunk next to its data, so
+ *    the prefix and the selection of every chunk are read with one seek per chunk;
+ *  - cluster: the Encoded Selections of all chunks are also stored together in the contiguous dataset
+ *    "<name>.selections" built by sc_build_selection_cluster(), and read in one sequential pass.
+ *
+ * The program first builds the selection cluster of the dataset in the input file (option -b 0 uses
+ * the cluster already in the file).  Then, for each layout, it drops the file pages from the page
+ * cache with posix_fadvise, opens the file and gets the defined elements of the dataset; the runs of
+ * defined elements are counted for each chunk, as when the occupancy map of the dataset is built.
+ * Each pass is repeated R times (option -r) and the best time is reported.
+ *
+ * To compile the program, please use h5cc.  The -h option lists all the command line options:
+ *
+ *   [-h] [-i --inFile] [-n --nameDset] [-b --bBuild] [-r --rRepeat] [-v --Verbose]
+ *
+ * Example: The commands
+ *
+ *           h5cc alloc.c -o alloc
+ *           h5cc defined.c -o defined
+ *           ./alloc -c 64x64 -g 64x64 -n 1
+ *           ./defined -i alloc_file.h5
+ *
+ * add the selection cluster of the 4096 chunks of the dataset "sparse" to alloc_file.h5 and compare
+ * the time to read the defined elements with and without it.
+ */
+
+#include "hdf5.h"
+#include "structured_chunk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <getopt.h>
+
+#define FILE_NAME                       "alloc_file.h5"
+#define DSET_NAME                       "sparse"
+#define REPEAT                          3
+
+typedef struct {
+    char           *in_file;
+    char           *dset_name;
+    int             b;               /* flag to build the selection cluster */
+    int             repeat;
+    int             v;               /* prints progress messages */
+} handler_t;
+
+/* Occupancy of the dataset */
+typedef struct {
+    long long int   nchunks;         /* number of stored chunks */
+    long long int   nruns;           /* number of runs of defined elements */
+    long long int   npoints;         /* number of defined elements */
+} occupancy_t;
+
+typedef struct {
+    const char     *layout;
+    occupancy_t     occ;
+    double          time;            /* best time of a pass */
+} result_t;
+
+handler_t    hand;
+result_t     res[2];
+
+/*------------------------------------------------------------
+ * Display command line usage
+ *------------------------------------------------------------
+ */
+void
+usage(void)
+{
+    printf("    [-h] [-i --inFile] [-n --nameDset] [-b --bBuild] [-r --rRepeat] [-v --Verbose]\n");
+    printf("    [-h --help]: this help page\n");
+    printf("    [-i --inFile]: the file with the structured chunk dataset (default %s)\n", FILE_NAME);
+    printf("    [-n --nameDset]: the name of the dataset (default %s)\n", DSET_NAME);
+    printf("    [-b --bBuild]: build the selection cluster (1, default) or use the one in the file (0)\n");
+    printf("    [-r --rRepeat]: the number of passes for each layout\n");
+    printf("    [-v --Verbose]: Print progress messages(1); default no messages displayed (0) \n");
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Parse command line option
+ *------------------------------------------------------------
+ */
+void
+parse_command_line(int argc, char *argv[])
+{
+    int           opt;
+    struct option long_options[] = {
+                                    {"help", no_argument, NULL, 'h'},
+                                    {"inFile=", required_argument, NULL, 'i'},
+                                    {"nameDset=", required_argument, NULL, 'n'},
+                                    {"bBuild=", required_argument, NULL, 'b'},
+                                    {"rRepeat=", required_argument, NULL, 'r'},
+                                    {"Verbose=", required_argument, NULL, 'v'},
+                                    {NULL, 0, NULL, 0}};
+
+    /* Initialize the command line options */
+    hand.in_file   = FILE_NAME;
+    hand.dset_name = DSET_NAME;
+    hand.b         = 1;
+    hand.repeat    = REPEAT;
+    hand.v         = 0;
+
+    while ((opt = getopt_long(argc, argv, "hi:n:b:r:v:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'h':
+                fprintf(stdout, "Help page:\n");
+                usage();
+
+                exit(0);
+
+                break;
+            case 'i':
+                if (optarg) {
+                    fprintf(stdout, "Input file:\t\t\t\t\t\t%s\n", optarg);
+                    hand.in_file = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'n':
+                if (optarg) {
+                    fprintf(stdout, "Dataset:\t\t\t\t\t\t%s\n", optarg);
+                    hand.dset_name = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'b':
+                if (optarg) {
+                    hand.b = atoi(optarg);
+                    if (hand.b == 1)
+                        fprintf(stdout, "Build the selection cluster: \t\t\t\ton\n");
+                    else if (hand.b == 0)
+                        fprintf(stdout, "Build the selection cluster: \t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Build the selection cluster:\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'r':
+                if (optarg) {
+                    fprintf(stdout, "Number of passes:\t\t\t\t\t%s\n", optarg);
+                    hand.repeat = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'v':
+                if (optarg) {
+                    hand.v = atoi(optarg);
+                    if (hand.v == 1)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\ton\n");
+                    else if (hand.v == 0)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Verbose mode:\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case ':':
+                printf("Option needs a value\n");
+                break;
+            case '?':
+                printf("Unknown option: %c\n", optopt);
+                break;
+        }
+    }
+
+    /* optind is for the extra arguments which are not parsed */
+    for (; optind < argc; optind++) {
+        printf("extra arguments not parsed: %s\n", argv[optind]);
+    }
+
+    /* Make sure the command line options are valid */
+    if (hand.b < 0 || hand.b > 1) {
+        printf("Build flag can only be 0 or 1 \n");
+        exit(1);
+    }
+
+    if (hand.repeat < 1) {
+        printf("The number of passes must be positive\n");
+        exit(1);
+    }
+
+    if (hand.v < 0 || hand.v > 1) {
+        printf("Verbose flag can only be 0 or 1 \n");
+        exit(1);
+    }
+}
+
+/*------------------------------------------------------------
+ * Print the occupancy and the time of both layouts
+ *------------------------------------------------------------
+ */
+void print_results(long long int cluster_size, double build_time)
+{
+    int i;
+
+    printf("\n");
+    printf("Size of the selection cluster in bytes:\t\t\t%lli\n", cluster_size);
+    if (build_time > 0)
+        printf("Time to build the selection cluster in seconds:\t\t%.4f\n", build_time);
+    printf("\n");
+    printf("Printing the layout, number of chunks (NC), runs of defined elements (NR), defined elements (NP),\n");
+    printf("time in seconds (T) and speedup over the interleaved layout (SU)\n");
+    printf("\n");
+    printf("     layout         NC         NR         NP          T         SU\n");
+    printf("\n");
+
+    for (i = 0; i < 2; i++)
+        printf("%11s %10lli %10lli %10lli %10.4f %10.2f \n", res[i].layout, res[i].occ.nchunks, res[i].occ.nruns,
+               res[i].occ.npoints, res[i].time, res[0].time / res[i].time);
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Elapsed time
+ *------------------------------------------------------------
+ */
+double elapsed(struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*------------------------------------------------------------
+ * Drop the pages of a file from the page cache
+ *------------------------------------------------------------
+ */
+void drop_cache(const char *file_name)
+{
+    int fd;
+
+    if ((fd = open(file_name, O_RDONLY)) < 0)
+        return;
+    fsync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+/*------------------------------------------------------------
+ * Add the runs of a chunk to the occupancy (callback for
+ * sc_get_defined)
+ *------------------------------------------------------------
+ */
+herr_t count_defined(const hsize_t *offset, size_t nruns, const sc_run_t *runs, void *op_data)
+{
+    occupancy_t *occ = (occupancy_t *)op_data;
+    size_t       n;
+
+    (void)offset;
+
+    occ->nchunks++;
+    occ->nruns += (long long int)nruns;
+    for (n = 0; n < nruns; n++)
+        occ->npoints += (long long int)runs[n].len;
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Get the defined elements of the dataset with a cold page
+ * cache; returns the time
+ *------------------------------------------------------------
+ */
+double read_defined(int use_cluster, occupancy_t *occ)
+{
+    struct timespec start;
+    hid_t           fapl, file;
+    double          t;
+
+    drop_cache(hand.in_file);
+
+    fapl = H5Pcreate(H5P_FILE_ACCESS);
+    H5Pset_fapl_sec2(fapl);
+    if ((file = H5Fopen(hand.in_file, H5F_ACC_RDONLY, fapl)) < 0) {
+        printf("Failed to open %s\n", hand.in_file);
+        exit(1);
+    }
+
+    memset(occ, 0, sizeof(*occ));
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (sc_get_defined(file, hand.dset_name, use_cluster, count_defined, occ) < 0) {
+        printf("Failed to get the defined elements of %s\n", hand.dset_name);
+        exit(1);
+    }
+    t = elapsed(&start);
+
+    H5Fclose(file);
+    H5Pclose(fapl);
+
+    return t;
+}
+
+/*------------------------------------------------------------
+ * Main function
+ *------------------------------------------------------------
+ */
+int
+main(int argc, char **argv)
+{
+    char            cluster_name[256];
+    struct timespec start;
+    hid_t           file, dset, space;
+    long long int   cluster_size = 0;
+    double          build_time = 0, t;
+    int             i, n;
+
+    parse_command_line(argc, argv);
+
+    if ((file = H5Fopen(hand.in_file, hand.b ? H5F_ACC_RDWR : H5F_ACC_RDONLY, H5P_DEFAULT)) < 0) {
+        printf("Failed to open %s\n", hand.in_file);
+        return 1;
+    }
+
+    if (hand.b) {
+        if (hand.v) printf("Building the selection cluster\n");
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (sc_build_selection_cluster(file, hand.dset_name) < 0) {
+            printf("Failed to build the selection cluster of %s\n", hand.dset_name);
+            return 1;
+        }
+        H5Fflush(file, H5F_SCOPE_GLOBAL);
+        build_time = elapsed(&start);
+    }
+
+    snprintf(cluster_name, sizeof(cluster_name), "%s%s", hand.dset_name, SC_CLUSTER_SUFFIX);
+    if (H5Lexists(file, cluster_name, H5P_DEFAULT) <= 0) {
+        printf("The dataset %s has no selection cluster\n", hand.dset_name);
+        return 1;
+    }
+    dset  = H5Dopen2(file, cluster_name, H5P_DEFAULT);
+    space = H5Dget_space(dset);
+    cluster_size = (long long int)H5Sget_simple_extent_npoints(space);
+    H5Sclose(space);
+    H5Dclose(dset);
+    H5Fclose(file);
+
+    res[0].layout = "interleaved";
+    res[1].layout = "cluster";
+    for (i = 0; i < 2; i++) {
+        if (hand.v) printf("Reading the defined elements with the %s layout\n", res[i].layout);
+        res[i].time = 1e30;
+        for (n = 0; n < hand.repeat; n++)
+            if ((t = read_defined(i, &res[i].occ)) < res[i].time)
+                res[i].time = t;
+    }
+
+    if (res[0].occ.npoints != res[1].occ.npoints || res[0].occ.nruns != res[1].occ.nruns)
+        printf("The defined elements read with both layouts differ\n");
+
+    if (hand.v) printf("Done! \n");
+
+    print_results(cluster_size, build_time);
+
+    return 0;
+}
@@ -0,0 +1,768 @@
+/*
+ * This program measures reads of sparse data into dense buffers.  The dense buffer of a chunk holds
+ * every element: the defined elements get their values and the undefined elements get the fill value.
+ * Reading the dense "sparse" dataset of sparse.c writes every element from storage; reading a structured
+ * chunk only needs the defined elements from storage, and the fill value for the others.
+ *
+ * For each percentage of data density X between 1 and M (command line option -m), the program creates
+ * a file "fill_file.h5" with two 2-dim datasets of G1 x G2 chunks (option -g) of 1-byte elements:
+ *
+ *  sparse     - a regular chunked dataset in which undefined elements hold the fill value, as in sparse.c
+ *  structured - structured chunks with the Encoded Selection and the values of the defined elements
+ *
+ * The defined elements are placed in each chunk as in sparse.c (option -s): 1 - random locations in
+ * each row, 2 - a randomly placed rectangle, 3 - randomly placed continuous locations in each row.
+ * The fill value is specified with the option -f (default 0).
+ *
+ * The whole dataset is read chunk by chunk into one buffer of G1 x G2 dense chunks with:
+ *
+ *  dense  - H5Dread of each chunk of the "sparse" dataset
+ *  fill   - sc_read_dense_chunk of each structured chunk; the undefined elements are filled.  Chunks of at
+ *           least SC_STREAM_MIN_SIZE bytes are assembled in blocks in cache and stored with non-temporal
+ *           SSE2 stores, so the lines of the buffer are written without being read
+ *  elide  - sc_read_dense_chunk with the fill-initialized flag set on the transfer property list
+ *           (sc_set_fill_initialized); the buffer holds the fill value (e.g., it was allocated with
+ *           calloc), so only the defined elements are written
+ *
+ * The program also expands the decoded chunks in memory, without the reads and the decoding, with
+ * regular stores, with non-temporal stores and with the defined elements only (sc_fill_scatter_runs
+ * and sc_scatter_runs).  The files are read from the page cache.  Each pass is repeated R times (option
+ * -r) and the best time is reported with the bandwidth of the dense buffer in GB/s.  With the option
+ * -k 1 the buffers of the structured reads are compared with the buffer of the dense read.
+ *
+ * To compile the program, please use h5cc.  The -h option lists all the command line options:
+ *
+ *   [-h] [-c --dimsChunk] [-g --gridChunks] [-m --mPercent] [-s --spaceSelect] [-f --fillValue]
+ *   [-r --rRepeat] [-k --kVerify] [-v --Verbose]
+ *
+ * Example: The commands
+ *
+ *           h5cc fill_read.c -o fill_read
+ *           ./fill_read -c 2048x2048 -g 4x4 -m 20 -s 1 -k 1
+ *
+ * read 16 chunks of 4 MiB (64 MiB) at densities from 1 to 20 percent from the dense dataset and
+ * from the structured chunks with and without the fill elided.
+ */
+
+#include "hdf5.h"
+#include "structured_chunk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <time.h>
+#include <math.h>
+#include <string.h>
+#include <getopt.h>
+
+#define FILE_NAME                       "fill_file.h5"
+#define DSET_NAME                       "sparse"
+#define STRUCT_DSET_NAME                "structured"
+#define CHUNK_DIM1                      2048
+#define CHUNK_DIM2                      2048
+#define GRID_DIM1                       4
+#define GRID_DIM2                       4
+#define GROUP_NUM                       10
+#define MAX_PERCENT                     20
+#define REPEAT                          3
+#define RANK                            2
+
+/* Reads into the dense buffer */
+#define READ_DENSE                      0
+#define READ_FILL                       1
+#define READ_ELIDE                      2
+#define NUM_READS                       3
+
+/* Expansions of the decoded chunks */
+#define EXPAND_REGULAR                  0
+#define EXPAND_STREAM                   1
+#define EXPAND_ELIDE                    2
+#define NUM_EXPANDS                     3
+
+typedef struct {
+    long long int   chunk_dim1;
+    long long int   chunk_dim2;
+    long long int   grid_dim1;
+    long long int   grid_dim2;
+    int             max_percent;
+    int             space_select;
+    int             fill;            /* fill value */
+    int             repeat;
+    int             k;               /* compares the buffers */
+    int             v;               /* prints progress messages */
+} handler_t;
+
+/* Decoded structured chunk */
+typedef struct {
+    size_t          nruns;
+    sc_run_t       *runs;
+    uint8_t        *data;
+} decoded_t;
+
+typedef struct {
+    long long int   nelemts;         /* number of defined elements */
+    double          t_read[NUM_READS];     /* best times */
+    double          t_expand[NUM_EXPANDS];
+    int             verified;        /* -1 not verified, 0 failed, 1 passed */
+} result_t;
+
+handler_t    hand;
+result_t     res[MAX_PERCENT];
+
+/*------------------------------------------------------------
+ * Display command line usage
+ *------------------------------------------------------------
+ */
+void
+usage(void)
+{
+    printf("    [-h] [-c --dimsChunk] [-g --gridChunks] [-m --mPercent] [-s --spaceSelect] [-f --fillValue]\n");
+    printf("    [-r --rRepeat] [-k --kVerify] [-v --Verbose]\n");
+    printf("    [-h --help]: this help page\n");
+    printf("    [-c --dimsChunk]: the chunk dimensions (default %dx%d)\n", CHUNK_DIM1, CHUNK_DIM2);
+    printf("    [-g --gridChunks]: the number of chunks in each dimension (default %dx%d)\n", GRID_DIM1, GRID_DIM2);
+    printf("    [-m --mPercent]: the maximal percentage of data density, e.g., a value of 5 means the data density will be from 1 to 5 percent (default %d)\n", GROUP_NUM);
+    printf("    [-s --spaceSelect]: the selection of the defined elements in each chunk: random points in each row (1, default),\n");
+    printf("	    a randomly placed rectangle (2) or continuous points in each row with random position (3)\n");
+    printf("    [-f --fillValue]: the fill value between 0 and %d (default 0)\n", UCHAR_MAX);
+    printf("    [-r --rRepeat]: the number of reads of each pass (default %d)\n", REPEAT);
+    printf("    [-k --kVerify]: compare the buffers of the structured reads with the dense read (1) or not (0, default)\n");
+    printf("    [-v --Verbose]: Print progress messages(1); default no messages displayed (0) \n");
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Parse a string of the form AxB; missing dimensions are set
+ * to 0
+ *------------------------------------------------------------
+ */
+void
+parse_dims(const char *str, int ndims, long long int *dims[])
+{
+    char *dims_str, *dim_str;
+    int   i;
+
+    dims_str = strdup(str);
+    dim_str  = strtok(dims_str, "x");
+    for (i = 0; i < ndims; i++) {
+        *dims[i] = dim_str ? atoll(dim_str) : 0;
+        dim_str  = strtok(NULL, "x");
+    }
+    free(dims_str);
+}
+
+/*------------------------------------------------------------
+ * Parse command line option
+ *------------------------------------------------------------
+ */
+void
+parse_command_line(int argc, char *argv[])
+{
+    int            opt;
+    long long int *chunk_dims[2] = {&hand.chunk_dim1, &hand.chunk_dim2};
+    long long int *grid_dims[2]  = {&hand.grid_dim1, &hand.grid_dim2};
+    struct option  long_options[] = {
+                                    {"help", no_argument, NULL, 'h'},
+                                    {"dimsChunk=", required_argument, NULL, 'c'},
+                                    {"gridChunks=", required_argument, NULL, 'g'},
+                                    {"mPercent=", required_argument, NULL, 'm'},
+                                    {"spaceSelect=", required_argument, NULL, 's'},
+                                    {"fillValue=", required_argument, NULL, 'f'},
+                                    {"rRepeat=", required_argument, NULL, 'r'},
+                                    {"kVerify=", required_argument, NULL, 'k'},
+                                    {"Verbose=", required_argument, NULL, 'v'},
+                                    {NULL, 0, NULL, 0}};
+
+    /* Initialize the command line options */
+    hand.chunk_dim1   = CHUNK_DIM1;
+    hand.chunk_dim2   = CHUNK_DIM2;
+    hand.grid_dim1    = GRID_DIM1;
+    hand.grid_dim2    = GRID_DIM2;
+    hand.max_percent  = GROUP_NUM;
+    hand.space_select = 1;
+    hand.fill         = 0;
+    hand.repeat       = REPEAT;
+    hand.k            = 0;
+    hand.v            = 0;
+
+    while ((opt = getopt_long(argc, argv, "hc:g:m:s:f:r:k:v:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'h':
+                fprintf(stdout, "Help page:\n");
+                usage();
+
+                exit(0);
+
+                break;
+            case 'c':
+                if (optarg) {
+                    fprintf(stdout, "Chunk dimensions:\t\t\t\t\t%s\n", optarg);
+                    parse_dims(optarg, 2, chunk_dims);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'g':
+                if (optarg) {
+                    fprintf(stdout, "Chunks in each dimension:\t\t\t\t%s\n", optarg);
+                    parse_dims(optarg, 2, grid_dims);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'm':
+                if (optarg) {
+                    fprintf(stdout, "Maximal percentage of data density:\t\t\t%s\n", optarg);
+                    hand.max_percent = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 's':
+                if (optarg) {
+                    hand.space_select = atoi(optarg);
+
+                    if (hand.space_select == 1)
+                        fprintf(stdout, "Options of data space selection:\t\t\trandomly selected locations in each row\n");
+                    else if (hand.space_select == 2)
+                        fprintf(stdout, "Options of data space selection:\t\t\trandomly selected rectangular in the whole chunk\n");
+                    else if (hand.space_select == 3)
+                        fprintf(stdout, "Options of data space selection:\t\t\trandomly selected continuous locations in each row\n");
+                    else
+                        fprintf(stdout, "Options of data space selection:\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'f':
+                if (optarg) {
+                    fprintf(stdout, "Fill value:\t\t\t\t\t\t%s\n", optarg);
+                    hand.fill = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'r':
+                if (optarg) {
+                    fprintf(stdout, "Number of reads of each pass:\t\t\t\t%s\n", optarg);
+                    hand.repeat = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'k':
+                if (optarg) {
+                    hand.k = atoi(optarg);
+                    if (hand.k == 1)
+                        fprintf(stdout, "Verify: \t\t\t\t\t\ton\n");
+                    else if (hand.k == 0)
+                        fprintf(stdout, "Verify: \t\t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Verify:\t\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'v':
+                if (optarg) {
+                    hand.v = atoi(optarg);
+                    if (hand.v == 1)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\ton\n");
+                    else if (hand.v == 0)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Verbose mode:\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case ':':
+                printf("Option needs a value\n");
+                break;
+            case '?':
+                printf("Unknown option: %c\n", optopt);
+                break;
+        }
+    }
+
+    /* optind is for the extra arguments which are not parsed */
+    for (; optind < argc; optind++) {
+        printf("extra arguments not parsed: %s\n", argv[optind]);
+    }
+
+    /* Make sure the command line options are valid */
+    if (hand.chunk_dim1 < 1 || hand.chunk_dim2 < 1 || hand.grid_dim1 < 1 || hand.grid_dim2 < 1) {
+        printf("The chunk dimensions and the number of chunks must be positive\n");
+        exit(1);
+    }
+
+    if (hand.max_percent < 1 || hand.max_percent > MAX_PERCENT) {
+        printf("The maximal percentage of the data density isn't valid\n");
+        exit(1);
+    }
+
+    if (hand.space_select < 1 || hand.space_select > 3) {
+        printf("The option of hyperslab selection can only be 1, 2, or 3\n");
+        exit(1);
+    }
+
+    if (hand.fill < 0 || hand.fill > UCHAR_MAX) {
+        printf("The fill value must be between 0 and %d\n", UCHAR_MAX);
+        exit(1);
+    }
+
+    if (hand.repeat < 1) {
+        printf("The number of reads must be positive\n");
+        exit(1);
+    }
+
+    if (hand.k < 0 || hand.k > 1) {
+        printf("Verify flag can only be 0 or 1 \n");
+        exit(1);
+    }
+
+    if (hand.v < 0 || hand.v > 1) {
+        printf("Verbose flag can only be 0 or 1 \n");
+        exit(1);
+    }
+}
+
+/*------------------------------------------------------------
+ * Elapsed time
+ *------------------------------------------------------------
+ */
+double elapsed(struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*------------------------------------------------------------
+ * Print the results
+ *------------------------------------------------------------
+ */
+void print_results(int index)
+{
+    double size = (double)hand.chunk_dim1 * hand.chunk_dim2 * hand.grid_dim1 * hand.grid_dim2;
+    int    i, j;
+
+    printf("\n");
+    printf("Printing percentage, number of defined elements (NE), time to read the dense dataset (TD), the structured\n");
+    printf("chunks with the fill (TF) and with the fill elided (TE) in seconds, their bandwidth in GB/s of the dense\n");
+    printf("buffer (BD, BF, BE) and the result of the comparison of the buffers (OK, FAILED or - if not compared)\n");
+    printf("\n");
+    printf("         %%         NE         TD         TF         TE         BD         BF         BE   VERIFIED\n");
+    printf("\n");
+
+    for (i = 0; i < index; i++) {
+        printf("%10d %10lli", i + 1, res[i].nelemts);
+        for (j = 0; j < NUM_READS; j++)
+            printf(" %10.4f", res[i].t_read[j]);
+        for (j = 0; j < NUM_READS; j++)
+            printf(" %10.2f", size / res[i].t_read[j] / 1e9);
+        printf(" %10s \n", res[i].verified < 0 ? "-" : res[i].verified ? "OK" : "FAILED");
+    }
+
+    printf("\n");
+    printf("Printing percentage, time to expand the decoded chunks into the dense buffer with regular stores (XR),\n");
+    printf("with non-temporal stores (XN) and with the defined elements only (XE) in seconds, and their bandwidth\n");
+    printf("in GB/s of the dense buffer (BR, BN, BE)\n");
+    printf("\n");
+    printf("         %%         XR         XN         XE         BR         BN         BE\n");
+    printf("\n");
+
+    for (i = 0; i < index; i++) {
+        printf("%10d", i + 1);
+        for (j = 0; j < NUM_EXPANDS; j++)
+            printf(" %10.4f", res[i].t_expand[j]);
+        for (j = 0; j < NUM_EXPANDS; j++)
+            printf(" %10.2f", size / res[i].t_expand[j] / 1e9);
+        printf(" \n");
+    }
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Mark the defined elements of a chunk as in create_hyperslab
+ * of sparse.c
+ *------------------------------------------------------------
+ */
+void generate_mask(int percent, uint8_t *mask)
+{
+    uint64_t dim1 = hand.chunk_dim1, dim2 = hand.chunk_dim2;
+    uint64_t i, j;
+
+    memset(mask, 0, dim1 * dim2);
+
+    if (hand.space_select == 1) {
+        uint64_t num_selections = dim2 * percent / 100;
+        uint64_t sections       = 100 / percent;
+
+        /* One random point in each section of the row */
+        for (i = 0; i < dim1; i++)
+            for (j = 0; j < num_selections; j++)
+                mask[i * dim2 + j * sections + rand() % sections] = 1;
+    }
+    else if (hand.space_select == 2) {
+        /* A rectangle of the shape of the chunk with its upper-left corner in the upper-left quadrant */
+        uint64_t start1 = rand() % (dim1 / 2 ? dim1 / 2 : 1);
+        uint64_t start2 = rand() % (dim2 / 2 ? dim2 / 2 : 1);
+        uint64_t block1 = dim1 * sqrt(percent) / 10;
+        uint64_t block2 = dim2 * sqrt(percent) / 10;
+
+        for (i = start1; i < start1 + block1; i++)
+            memset(mask + i * dim2 + start2, 1, block2);
+    }
+    else {
+        /* Continuous points with a random position in each row */
+        uint64_t block = dim2 * percent / 100;
+
+        for (i = 0; i < dim1; i++)
+            memset(mask + i * dim2 + rand() % (dim2 - block), 1, block);
+    }
+}
+
+/*------------------------------------------------------------
+ * Create the file with the dense and the structured datasets
+ * of one percentage
+ *------------------------------------------------------------
+ */
+int create_file(int percent, long long int *nelemts)
+{
+    hid_t           file, space, dcpl, struct_dcpl, dset, struct_dset, mem_space, file_space;
+    hsize_t         dims[RANK], chunk_dims[RANK], offset[RANK];
+    uint64_t        size = hand.chunk_dim1 * hand.chunk_dim2;
+    uint8_t        *mask, *dense, *sel, *data, fill = (uint8_t)hand.fill;
+    sc_run_t       *runs;
+    sc_chunk_info_t info;
+    const void     *buf[2];
+    size_t          nruns, n;
+    uint64_t        e, c, ndefined;
+    int             ret_value = 0;
+
+    chunk_dims[0] = hand.chunk_dim1;
+    chunk_dims[1] = hand.chunk_dim2;
+    dims[0]       = hand.chunk_dim1 * hand.grid_dim1;
+    dims[1]       = hand.chunk_dim2 * hand.grid_dim2;
+
+    file  = H5Fcreate(FILE_NAME, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    space = H5Screate_simple(RANK, dims, NULL);
+
+    dcpl = H5Pcreate(H5P_DATASET_CREATE);
+    H5Pset_chunk(dcpl, RANK, chunk_dims);
+    H5Pset_fill_value(dcpl, H5T_NATIVE_UCHAR, &fill);
+    dset = H5Dcreate2(file, DSET_NAME, H5T_STD_U8LE, space, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+
+    struct_dcpl = sc_create_dcpl(RANK, chunk_dims);
+    H5Pset_fill_value(struct_dcpl, H5T_NATIVE_UCHAR, &fill);
+    struct_dset = H5Dcreate2(file, STRUCT_DSET_NAME, H5T_STD_U8LE, space, H5P_DEFAULT, struct_dcpl, H5P_DEFAULT);
+
+    mem_space  = H5Screate_simple(RANK, chunk_dims, NULL);
+    file_space = H5Scopy(space);
+
+    mask  = (uint8_t *)malloc(size);
+    dense = (uint8_t *)malloc(size);
+    data  = (uint8_t *)malloc(size);
+    runs  = (sc_run_t *)malloc(size * sizeof(sc_run_t));
+    sel   = (uint8_t *)malloc(sc_encode_runs(RANK, chunk_dims, size, NULL, NULL));
+
+    *nelemts = 0;
+    for (c = 0; c < (uint64_t)(hand.grid_dim1 * hand.grid_dim2); c++) {
+        offset[0] = (c / hand.grid_dim2) * chunk_dims[0];
+        offset[1] = (c % hand.grid_dim2) * chunk_dims[1];
+
+        generate_mask(percent, mask);
+        for (e = 0; e < size; e++)
+            dense[e] = mask[e] ? rand() % UCHAR_MAX + 1 : fill;
+
+        /* The dense chunk */
+        H5Sselect_hyperslab(file_space, H5S_SELECT_SET, offset, NULL, chunk_dims, NULL);
+        if (H5Dwrite(dset, H5T_NATIVE_UCHAR, mem_space, file_space, H5P_DEFAULT, dense) < 0)
+            goto error;
+
+        /* The structured chunk */
+        nruns = sc_mask_to_runs(mask, size, chunk_dims[1], runs);
+        if (nruns == 0)
+            continue;
+        for (n = 0, ndefined = 0; n < nruns; n++)
+            ndefined += runs[n].len;
+        *nelemts += ndefined;
+
+        memset(&info, 0, sizeof(info));
+        info.type                                    = SC_SPARSE_CHUNK;
+        info.num_sections                            = 2;
+        info.nelemts                                 = ndefined;
+        info.section_orig_size[SC_SECTION_SELECTION] = sc_encode_runs(RANK, chunk_dims, nruns, runs, sel);
+        info.section_orig_size[SC_SECTION_FIXED]     = ndefined;
+        sc_gather_runs(dense, 1, nruns, runs, data);
+
+        buf[SC_SECTION_SELECTION] = sel;
+        buf[SC_SECTION_FIXED]     = data;
+        if (sc_write_struct_chunk(struct_dset, H5P_DEFAULT, &info, offset, buf) < 0)
+            goto error;
+    }
+
+done:
+    free(mask);
+    free(dense);
+    free(data);
+    free(runs);
+    free(sel);
+    H5Sclose(file_space);
+    H5Sclose(mem_space);
+    H5Dclose(struct_dset);
+    H5Dclose(dset);
+    H5Pclose(struct_dcpl);
+    H5Pclose(dcpl);
+    H5Sclose(space);
+    H5Fclose(file);
+
+    return ret_value;
+
+error:
+    printf("Failed to write the datasets\n");
+    ret_value = -1;
+    goto done;
+}
+
+/*------------------------------------------------------------
+ * Read the whole dataset chunk by chunk into a buffer of dense
+ * chunks
+ *------------------------------------------------------------
+ */
+int read_dense(hid_t file, uint8_t *buffer, double *t)
+{
+    hid_t           dset, mem_space, file_space;
+    hsize_t         chunk_dims[RANK], offset[RANK];
+    uint64_t        size = hand.chunk_dim1 * hand.chunk_dim2, c;
+    struct timespec start;
+    int             ret_value = 0;
+
+    chunk_dims[0] = hand.chunk_dim1;
+    chunk_dims[1] = hand.chunk_dim2;
+
+    dset       = H5Dopen2(file, DSET_NAME, H5P_DEFAULT);
+    file_space = H5Dget_space(dset);
+    mem_space  = H5Screate_simple(RANK, chunk_dims, NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (c = 0; c < (uint64_t)(hand.grid_dim1 * hand.grid_dim2); c++) {
+        offset[0] = (c / hand.grid_dim2) * chunk_dims[0];
+        offset[1] = (c % hand.grid_dim2) * chunk_dims[1];
+        H5Sselect_hyperslab(file_space, H5S_SELECT_SET, offset, NULL, chunk_dims, NULL);
+        if (H5Dread(dset, H5T_NATIVE_UCHAR, mem_space, file_space, H5P_DEFAULT, buffer + c * size) < 0) {
+            ret_value = -1;
+            break;
+        }
+    }
+    *t = elapsed(&start);
+
+    H5Sclose(mem_space);
+    H5Sclose(file_space);
+    H5Dclose(dset);
+
+    return ret_value;
+}
+
+/*------------------------------------------------------------
+ * Read the whole structured chunk dataset chunk by chunk into
+ * a buffer of dense chunks.  With "elide" the buffer is set to
+ * the fill value before the timer starts and the read writes
+ * the defined elements only.
+ *------------------------------------------------------------
+ */
+int read_structured(hid_t file, int elide, uint8_t *buffer, double *t)
+{
+    hid_t           dset, dxpl;
+    hsize_t         offset[RANK];
+    uint64_t        size = hand.chunk_dim1 * hand.chunk_dim2, c;
+    uint8_t         fill[sizeof(double)];     /* fill value buffer, as wide as any native type */
+    struct timespec start;
+    int             ret_value = 0;
+
+    memset(fill, hand.fill, sizeof(fill));
+    dset = H5Dopen2(file, STRUCT_DSET_NAME, H5P_DEFAULT);
+    dxpl = H5Pcreate(H5P_DATASET_XFER);
+    if (elide) {
+        sc_set_fill_initialized(dxpl, 1);
+        memset(buffer, hand.fill, size * hand.grid_dim1 * hand.grid_dim2);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (c = 0; c < (uint64_t)(hand.grid_dim1 * hand.grid_dim2); c++) {
+        offset[0] = (c / hand.grid_dim2) * hand.chunk_dim1;
+        offset[1] = (c % hand.grid_dim2) * hand.chunk_dim2;
+        if (sc_read_dense_chunk(dset, H5T_NATIVE_UCHAR, dxpl, offset, fill, buffer + c * size) < 0) {
+            ret_value = -1;
+            break;
+        }
+    }
+    *t = elapsed(&start);
+
+    H5Pclose(dxpl);
+    H5Dclose(dset);
+
+    return ret_value;
+}
+
+/*------------------------------------------------------------
+ * Read and decode all structured chunks for the expansions in
+ * memory
+ *------------------------------------------------------------
+ */
+int decode_chunks(hid_t file, decoded_t *chunks)
+{
+    hid_t           dset;
+    hsize_t         offset[RANK], dims[RANK];
+    sc_chunk_info_t info;
+    void           *buf[2];
+    uint64_t        c;
+    int             rank;
+
+    dset = H5Dopen2(file, STRUCT_DSET_NAME, H5P_DEFAULT);
+
+    for (c = 0; c < (uint64_t)(hand.grid_dim1 * hand.grid_dim2); c++) {
+        offset[0] = (c / hand.grid_dim2) * hand.chunk_dim1;
+        offset[1] = (c % hand.grid_dim2) * hand.chunk_dim2;
+
+        if (sc_read_struct_chunk(dset, H5P_DEFAULT, offset, &info, NULL) < 0)
+            continue;
+        buf[SC_SECTION_SELECTION] = malloc(info.section_orig_size[SC_SECTION_SELECTION]);
+        buf[SC_SECTION_FIXED]     = malloc(info.section_orig_size[SC_SECTION_FIXED] + 1);
+        if (sc_read_struct_chunk(dset, H5P_DEFAULT, offset, &info, buf) < 0 ||
+            sc_decode_runs(buf[SC_SECTION_SELECTION], info.section_orig_size[SC_SECTION_SELECTION], &rank, dims,
+                           &chunks[c].nruns, NULL) < 0)
+            goto error;
+        chunks[c].runs = (sc_run_t *)malloc((chunks[c].nruns + 1) * sizeof(sc_run_t));
+        sc_decode_runs(buf[SC_SECTION_SELECTION], info.section_orig_size[SC_SECTION_SELECTION], &rank, dims,
+                       &chunks[c].nruns, chunks[c].runs);
+        chunks[c].data = (uint8_t *)buf[SC_SECTION_FIXED];
+        free(buf[SC_SECTION_SELECTION]);
+    }
+
+    H5Dclose(dset);
+    return 0;
+
+error:
+    printf("Failed to decode the structured chunks\n");
+    H5Dclose(dset);
+    return -1;
+}
+
+/*------------------------------------------------------------
+ * Expand the decoded chunks into a buffer of dense chunks
+ *------------------------------------------------------------
+ */
+double expand_chunks(const decoded_t *chunks, int expand, uint8_t *buffer)
+{
+    uint64_t        size = hand.chunk_dim1 * hand.chunk_dim2, c;
+    uint8_t         fill = (uint8_t)hand.fill;
+    struct timespec start;
+
+    if (expand == EXPAND_ELIDE)
+        memset(buffer, fill, size * hand.grid_dim1 * hand.grid_dim2);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (c = 0; c < (uint64_t)(hand.grid_dim1 * hand.grid_dim2); c++) {
+        if (expand == EXPAND_ELIDE)
+            sc_scatter_runs(chunks[c].data, 1, chunks[c].nruns, chunks[c].runs, buffer + c * size);
+        else
+            sc_fill_scatter_runs(chunks[c].data, 1, chunks[c].nruns, chunks[c].runs, &fill, size,
+                                 expand == EXPAND_STREAM, buffer + c * size);
+    }
+    return elapsed(&start);
+}
+
+/*------------------------------------------------------------
+ * Main function
+ *------------------------------------------------------------
+ */
+int
+main(int argc, char **argv)
+{
+    hid_t      file;
+    uint64_t   nchunks, size, c;
+    uint8_t   *buffer, *expected = NULL;
+    decoded_t *chunks;
+    double     t;
+    int        n, i, j;
+
+    parse_command_line(argc, argv);
+
+    srand(2);
+
+    nchunks = hand.grid_dim1 * hand.grid_dim2;
+    size    = hand.chunk_dim1 * hand.chunk_dim2 * nchunks;
+
+    /* The buffers are touched before the reads so that the page faults are not timed */
+    buffer = (uint8_t *)malloc(size);
+    memset(buffer, 0, size);
+    if (hand.k)
+        expected = (uint8_t *)malloc(size);
+    chunks = (decoded_t *)calloc(nchunks, sizeof(decoded_t));
+
+    for (n = 0; n < hand.max_percent; n++) {
+        if (hand.v) printf("Generating file for %d percent\n", n + 1);
+        if (create_file(n + 1, &res[n].nelemts) < 0)
+            return 1;
+
+        file = H5Fopen(FILE_NAME, H5F_ACC_RDONLY, H5P_DEFAULT);
+        res[n].verified = hand.k ? 1 : -1;
+
+        for (j = 0; j < NUM_READS; j++) {
+            for (i = 0; i < hand.repeat; i++) {
+                int ret;
+
+                /* Make sure a pass that writes the fill value does not find the expected result in place */
+                if (hand.k && j == READ_FILL)
+                    memset(buffer, ~hand.fill, size);
+                ret = j == READ_DENSE ? read_dense(file, buffer, &t)
+                                      : read_structured(file, j == READ_ELIDE, buffer, &t);
+
+                if (ret < 0) {
+                    printf("Failed to read the dataset\n");
+                    return 1;
+                }
+                if (i == 0 || t < res[n].t_read[j])
+                    res[n].t_read[j] = t;
+            }
+
+            if (hand.k) {
+                if (j == READ_DENSE)
+                    memcpy(expected, buffer, size);
+                else if (memcmp(expected, buffer, size) != 0)
+                    res[n].verified = 0;
+            }
+        }
+
+        if (decode_chunks(file, chunks) < 0)
+            return 1;
+        for (j = 0; j < NUM_EXPANDS; j++) {
+            for (i = 0; i < hand.repeat; i++) {
+                if (hand.k && j != EXPAND_ELIDE)
+                    memset(buffer, ~hand.fill, size);
+                t = expand_chunks(chunks, j, buffer);
+                if (i == 0 || t < res[n].t_expand[j])
+                    res[n].t_expand[j] = t;
+            }
+            if (hand.k && memcmp(expected, buffer, size) != 0)
+                res[n].verified = 0;
+        }
+        for (c = 0; c < nchunks; c++) {
+            free(chunks[c].runs);
+            free(chunks[c].data);
+        }
+        memset(chunks, 0, nchunks * sizeof(decoded_t));
+
+        H5Fclose(file);
+    }
+
+    print_results(hand.max_percent);
+
+    free(chunks);
+    free(expected);
+    free(buffer);
+
+    return 0;
+}
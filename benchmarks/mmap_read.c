@@ -0,0 +1,545 @@
+/*
+ * This program compares reading the Encoded Selection and Data sections of sparse data through the
+ * HDF5 POSIX (sec2) driver with a memory-mapped read path that hands out zero-copy views of the
+ * sections stored in the file.
+ *
+ * Two kinds of files can be read (command line option -t):
+ *
+ *  1 - default; the file generated by sparse.c.  For each group "percent_X" the unfiltered datasets
+ *      "selection" and "data" that emulate the two sections of a structured chunk are read.  The POSIX
+ *      path reads them with H5Dread; the mmap path finds the address of their single chunk with
+ *      H5Dget_chunk_info and uses the mapped bytes directly.  The compressed datasets are skipped:
+ *      filtered sections always have to be read and decompressed.
+ *  2 - a file with a dataset stored with structured chunks (see structured_chunk.h), e.g. the files
+ *      generated by alloc.c and compact.c.  The POSIX path reads every chunk with H5Dread_chunk and
+ *      copies its sections out; the mmap path gets views with sc_mmap_struct_chunk.  Filtered sections
+ *      fall back to sc_read_struct_chunk.
+ *
+ * For each section pair both paths sum the bytes of the Encoded Selection and the values of the
+ * defined elements, so that all bytes are touched.  With the option -s 1 the selection is also decoded
+ * with H5Sdecode; decoding usually takes much longer than reading and hides the difference between the
+ * read paths.  Each pass is repeated R times (option -r) with a warm page cache and the best time is
+ * reported.
+ *
+ * To compile the program, please use h5cc.  The -h option lists all the command line options:
+ *
+ *   [-h] [-i --inFile] [-t --tFile] [-n --nameDset] [-r --rRepeat] [-s --sDecode] [-k --kChecksum]
+ *   [-v --Verbose]
+ *
+ * Example: The commands
+ *
+ *           h5cc sparse.c -o sparse
+ *           h5cc -O2 mmap_read.c -o mmap_read
+ *           ./sparse -c 1x1 -m 5
+ *           ./mmap_read -i sparse_file.h5 -r 20
+ *
+ * compare both read paths on the datasets generated with 1 to 5 percent of defined elements.  Please
+ * compile with optimization, otherwise the loops that touch the data take most of the time.
+ */
+
+#include "hdf5.h"
+#include "structured_chunk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <getopt.h>
+
+#define FILE_NAME                       "sparse_file.h5"
+#define DSET_NAME                       "sparse"
+#define DATA_DSET_NAME                  "data"
+#define SELECTION_DSET_NAME             "selection"
+#define GROUP_NAME                      "percent_"
+#define MAX_PERCENT                     20
+#define REPEAT                          10
+
+typedef struct {
+    char           *in_file;
+    int             type;            /* layout of the file: sparse.c datasets (1) or structured chunks (2) */
+    char           *dset_name;
+    int             repeat;
+    int             s;               /* flag to decode the selections with H5Sdecode */
+    int             k;               /* flag to verify the checksums on the mmap path */
+    int             v;               /* prints progress messages */
+} handler_t;
+
+typedef struct {
+    long long int   sel;             /* size of the Encoded Selection sections */
+    long long int   data;            /* size of the Data sections */
+    long long int   npoints;         /* number of defined elements */
+    double          posix;           /* best time of the POSIX path */
+    double          mmap;            /* best time of the mmap path */
+} result_t;
+
+handler_t    hand;
+result_t     res[MAX_PERCENT];
+
+/*------------------------------------------------------------
+ * Display command line usage
+ *------------------------------------------------------------
+ */
+void
+usage(void)
+{
+    printf("    [-h] [-i --inFile] [-t --tFile] [-n --nameDset] [-r --rRepeat] [-s --sDecode] [-k --kChecksum]\n");
+    printf("    [-v --Verbose]\n");
+    printf("    [-h --help]: this help page\n");
+    printf("    [-i --inFile]: the file to read (default %s)\n", FILE_NAME);
+    printf("    [-t --tFile]: file generated by sparse.c (1) or a dataset stored with structured chunks (2)\n");
+    printf("    [-n --nameDset]: the name of the structured chunk dataset for -t 2 (default %s)\n", DSET_NAME);
+    printf("    [-r --rRepeat]: the number of passes over the data for each read path\n");
+    printf("    [-s --sDecode]: decode the selections with H5Sdecode (1); default only touch the encoded bytes (0)\n");
+    printf("    [-k --kChecksum]: verify the checksums of the Encoded Selection sections on the mmap path (1)\n");
+    printf("    [-v --Verbose]: Print progress messages(1); default no messages displayed (0) \n");
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Parse command line option
+ *------------------------------------------------------------
+ */
+void
+parse_command_line(int argc, char *argv[])
+{
+    int           opt;
+    struct option long_options[] = {
+                                    {"help", no_argument, NULL, 'h'},
+                                    {"inFile=", required_argument, NULL, 'i'},
+                                    {"tFile=", required_argument, NULL, 't'},
+                                    {"nameDset=", required_argument, NULL, 'n'},
+                                    {"rRepeat=", required_argument, NULL, 'r'},
+                                    {"sDecode=", required_argument, NULL, 's'},
+                                    {"kChecksum=", required_argument, NULL, 'k'},
+                                    {"Verbose=", required_argument, NULL, 'v'},
+                                    {NULL, 0, NULL, 0}};
+
+    /* Initialize the command line options */
+    hand.in_file   = FILE_NAME;
+    hand.type      = 1;
+    hand.dset_name = DSET_NAME;
+    hand.repeat    = REPEAT;
+    hand.s         = 0;
+    hand.k         = 0;
+    hand.v         = 0;
+
+    while ((opt = getopt_long(argc, argv, "hi:t:n:r:s:k:v:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'h':
+                fprintf(stdout, "Help page:\n");
+                usage();
+
+                exit(0);
+
+                break;
+            case 'i':
+                if (optarg) {
+                    fprintf(stdout, "Input file:\t\t\t\t\t\t%s\n", optarg);
+                    hand.in_file = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 't':
+                if (optarg) {
+                    hand.type = atoi(optarg);
+                    if (hand.type == 1)
+                        fprintf(stdout, "Type of file:\t\t\t\t\t\tsparse.c selection and data datasets\n");
+                    else if (hand.type == 2)
+                        fprintf(stdout, "Type of file:\t\t\t\t\t\tstructured chunk dataset\n");
+                    else
+                        fprintf(stdout, "Type of file:\t\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'n':
+                if (optarg) {
+                    fprintf(stdout, "Dataset:\t\t\t\t\t\t%s\n", optarg);
+                    hand.dset_name = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'r':
+                if (optarg) {
+                    fprintf(stdout, "Number of passes:\t\t\t\t\t%s\n", optarg);
+                    hand.repeat = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 's':
+                if (optarg) {
+                    hand.s = atoi(optarg);
+                    if (hand.s == 1)
+                        fprintf(stdout, "Selection decoding: \t\t\t\t\ton\n");
+                    else if (hand.s == 0)
+                        fprintf(stdout, "Selection decoding: \t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Selection decoding:\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'k':
+                if (optarg) {
+                    hand.k = atoi(optarg);
+                    if (hand.k == 1)
+                        fprintf(stdout, "Checksum verification: \t\t\t\t\ton\n");
+                    else if (hand.k == 0)
+                        fprintf(stdout, "Checksum verification: \t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Checksum verification:\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'v':
+                if (optarg) {
+                    hand.v = atoi(optarg);
+                    if (hand.v == 1)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\ton\n");
+                    else if (hand.v == 0)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Verbose mode:\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case ':':
+                printf("Option needs a value\n");
+                break;
+            case '?':
+                printf("Unknown option: %c\n", optopt);
+                break;
+        }
+    }
+
+    /* optind is for the extra arguments which are not parsed */
+    for (; optind < argc; optind++) {
+        printf("extra arguments not parsed: %s\n", argv[optind]);
+    }
+
+    /* Make sure the command line options are valid */
+    if (hand.type < 1 || hand.type > 2) {
+        printf("The type of file can only be 1 or 2\n");
+        exit(1);
+    }
+
+    if (hand.repeat < 1) {
+        printf("The number of passes must be positive\n");
+        exit(1);
+    }
+
+    if (hand.s < 0 || hand.s > 1) {
+        printf("Selection decoding flag can only be 0 or 1 \n");
+        exit(1);
+    }
+
+    if (hand.k < 0 || hand.k > 1) {
+        printf("Checksum flag can only be 0 or 1 \n");
+        exit(1);
+    }
+
+    if (hand.v < 0 || hand.v > 1) {
+        printf("Verbose flag can only be 0 or 1 \n");
+        exit(1);
+    }
+}
+
+/*------------------------------------------------------------
+ * Print section sizes and the time of both read paths
+ *------------------------------------------------------------
+ */
+void print_results(int index, const char *label)
+{
+    int   i;
+    float mb;
+
+    printf("\n");
+    printf("Printing %s, encoded selection size (ES), data size (DS), number of defined elements (NP),\n", label);
+    printf("read throughput in MiB/s of the POSIX driver (PRT) and of the mmap views (MRT), and speedup (SU)\n");
+    printf("\n");
+    printf("%10s         ES         DS         NP        PRT        MRT         SU\n", hand.type == 1 ? "%" : "dataset");
+    printf("\n");
+
+    for (i = 0; i < index; i++) {
+        mb = (float)(res[i].sel + res[i].data) / (1024 * 1024);
+        printf("%10d %10lli %10lli %10lli %10.1f %10.1f %10.1f \n", i + 1, res[i].sel, res[i].data, res[i].npoints,
+               mb / res[i].posix, mb / res[i].mmap, res[i].posix / res[i].mmap);
+    }
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Elapsed time
+ *------------------------------------------------------------
+ */
+double elapsed(struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*------------------------------------------------------------
+ * Use the sections as an application does: touch or decode the
+ * selection and sum the values of the defined elements
+ *------------------------------------------------------------
+ */
+uint64_t use_sections(const uint8_t *sel, size_t sel_size, const uint8_t *data, size_t data_size,
+                      long long int *npoints)
+{
+    uint64_t sum = 0, sel_sum = 0;
+    size_t   i;
+
+    if (hand.s) {
+        hid_t space = H5Sdecode(sel);
+
+        *npoints = (long long int)H5Sget_select_npoints(space);
+        H5Sclose(space);
+    }
+    else {
+        for (i = 0; i < sel_size; i++)
+            sel_sum += sel[i];
+        *npoints = (long long int)data_size;
+    }
+
+    for (i = 0; i < data_size; i++)
+        sum += data[i];
+
+    return sum + sel_sum;
+}
+
+/*------------------------------------------------------------
+ * Read the "selection" and "data" datasets of a sparse.c group
+ * with both read paths
+ *------------------------------------------------------------
+ */
+int read_group(hid_t file, const sc_mmap_t *map, hid_t group, result_t *r)
+{
+    hid_t           sel_dset, data_dset, space;
+    haddr_t         sel_addr, data_addr;
+    hsize_t         sel_size, data_size, offset[1];
+    unsigned        filter_mask;
+    uint8_t        *sel_buf, *data_buf;
+    uint64_t        sum_posix = 0, sum_mmap = 0;
+    struct timespec start;
+    double          t;
+    int             n;
+
+    (void)file;
+
+    sel_dset  = H5Dopen2(group, SELECTION_DSET_NAME, H5P_DEFAULT);
+    data_dset = H5Dopen2(group, DATA_DSET_NAME, H5P_DEFAULT);
+
+    /* Each dataset is stored in a single chunk */
+    space = H5Dget_space(sel_dset);
+    H5Dget_chunk_info(sel_dset, space, 0, offset, &filter_mask, &sel_addr, &sel_size);
+    H5Sclose(space);
+    space = H5Dget_space(data_dset);
+    H5Dget_chunk_info(data_dset, space, 0, offset, &filter_mask, &data_addr, &data_size);
+    H5Sclose(space);
+
+    r->sel   = (long long int)sel_size;
+    r->data  = (long long int)data_size;
+    r->posix = r->mmap = 1e30;
+
+    sel_buf  = (uint8_t *)malloc(sel_size);
+    data_buf = (uint8_t *)malloc(data_size);
+
+    for (n = 0; n < hand.repeat; n++) {
+        /* POSIX driver: the library reads the sections into the application buffers */
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        H5Dread(sel_dset, H5T_NATIVE_UCHAR, H5S_ALL, H5S_ALL, H5P_DEFAULT, sel_buf);
+        H5Dread(data_dset, H5T_NATIVE_UCHAR, H5S_ALL, H5S_ALL, H5P_DEFAULT, data_buf);
+        sum_posix = use_sections(sel_buf, sel_size, data_buf, data_size, &r->npoints);
+        if ((t = elapsed(&start)) < r->posix)
+            r->posix = t;
+
+        /* mmap: the sections are used where they are stored */
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        sum_mmap = use_sections(map->base + sel_addr, sel_size, map->base + data_addr, data_size, &r->npoints);
+        if ((t = elapsed(&start)) < r->mmap)
+            r->mmap = t;
+    }
+
+    if (sum_posix != sum_mmap)
+        printf("Values read with the POSIX driver and with mmap differ\n");
+
+    free(sel_buf);
+    free(data_buf);
+    H5Dclose(sel_dset);
+    H5Dclose(data_dset);
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Read all chunks of a structured chunk dataset with both
+ * read paths
+ *------------------------------------------------------------
+ */
+int read_struct_chunks(hid_t dset, const sc_mmap_t *map, result_t *r)
+{
+    sc_chunk_loc_t *locs;
+    size_t          nchunks, c;
+    hsize_t         max_size = 0;
+    uint8_t        *image;
+    uint64_t        sum_posix = 0, sum_mmap = 0;
+    struct timespec start;
+    double          t;
+    int             n;
+
+    if (sc_get_chunk_locations(dset, &nchunks, &locs) < 0)
+        return -1;
+    for (c = 0; c < nchunks; c++)
+        if (locs[c].size > max_size)
+            max_size = locs[c].size;
+    image = (uint8_t *)malloc(max_size ? max_size : 1);
+
+    r->sel = r->data = r->npoints = 0;
+    r->posix = r->mmap = 1e30;
+
+    for (n = 0; n < hand.repeat; n++) {
+        long long int npoints = 0;
+
+        /* POSIX driver: read the chunk and copy its sections out */
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        sum_posix = 0;
+        for (c = 0; c < nchunks; c++) {
+            sc_chunk_info_t info;
+            void           *buf[SC_MAX_SECTIONS] = {NULL};
+            uint32_t        filters;
+            long long int   np;
+            unsigned        i;
+
+            H5Dread_chunk(dset, H5P_DEFAULT, locs[c].offset, &filters, image);
+            sc_disassemble_chunk(image, (size_t)locs[c].size, &info, NULL);
+            for (i = 0; i < info.num_sections; i++)
+                buf[i] = malloc(info.section_orig_size[i] ? info.section_orig_size[i] : 1);
+            if (sc_disassemble_chunk(image, (size_t)locs[c].size, &info, buf) < 0) {
+                printf("Failed to decode chunk %zu\n", c);
+                exit(1);
+            }
+            sum_posix += use_sections((const uint8_t *)buf[SC_SECTION_SELECTION],
+                                      (size_t)info.section_orig_size[SC_SECTION_SELECTION],
+                                      (const uint8_t *)buf[SC_SECTION_FIXED],
+                                      (size_t)info.section_orig_size[SC_SECTION_FIXED], &np);
+            npoints += np;
+            for (i = 0; i < info.num_sections; i++)
+                free(buf[i]);
+
+            if (n == 0) {
+                r->sel += (long long int)info.section_orig_size[SC_SECTION_SELECTION];
+                r->data += (long long int)info.section_orig_size[SC_SECTION_FIXED];
+            }
+        }
+        r->npoints = npoints;
+        if ((t = elapsed(&start)) < r->posix)
+            r->posix = t;
+
+        /* mmap: use zero-copy views, read filtered sections */
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        sum_mmap = 0;
+        for (c = 0; c < nchunks; c++) {
+            sc_chunk_info_t info;
+            sc_view_t       views[SC_MAX_SECTIONS] = {{NULL, 0}};
+            void           *buf[SC_MAX_SECTIONS]   = {NULL};
+            const void     *sel, *data;
+            long long int   np;
+            unsigned        i;
+
+            if (sc_mmap_struct_chunk(map, locs[c].addr, locs[c].size, hand.k, &info, views) < 0 ||
+                info.num_sections < 2) {
+                printf("Failed to map chunk %zu\n", c);
+                exit(1);
+            }
+            if (views[SC_SECTION_SELECTION].ptr == NULL || views[SC_SECTION_FIXED].ptr == NULL) {
+                for (i = 0; i < info.num_sections; i++)
+                    buf[i] = malloc(info.section_orig_size[i] ? info.section_orig_size[i] : 1);
+                sc_read_struct_chunk(dset, H5P_DEFAULT, locs[c].offset, &info, buf);
+            }
+            sel  = views[SC_SECTION_SELECTION].ptr ? (const void *)views[SC_SECTION_SELECTION].ptr : buf[SC_SECTION_SELECTION];
+            data = views[SC_SECTION_FIXED].ptr ? (const void *)views[SC_SECTION_FIXED].ptr : buf[SC_SECTION_FIXED];
+            sum_mmap += use_sections((const uint8_t *)sel, views[SC_SECTION_SELECTION].size, (const uint8_t *)data,
+                                     views[SC_SECTION_FIXED].size, &np);
+            for (i = 0; i < info.num_sections; i++)
+                free(buf[i]);
+        }
+        if ((t = elapsed(&start)) < r->mmap)
+            r->mmap = t;
+    }
+
+    if (sum_posix != sum_mmap)
+        printf("Values read with the POSIX driver and with mmap differ\n");
+
+    free(image);
+    free(locs);
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Main function
+ *------------------------------------------------------------
+ */
+int
+main(int argc, char **argv)
+{
+    char      group_name[32];
+    hid_t     fapl, file, group, dset;
+    sc_mmap_t map;
+    int       n = 0;
+
+    parse_command_line(argc, argv);
+
+    /* The library reads through the POSIX driver */
+    fapl = H5Pcreate(H5P_FILE_ACCESS);
+    H5Pset_fapl_sec2(fapl);
+    if ((file = H5Fopen(hand.in_file, H5F_ACC_RDONLY, fapl)) < 0) {
+        printf("Failed to open %s\n", hand.in_file);
+        return 1;
+    }
+
+    if (sc_mmap_open(hand.in_file, &map) < 0) {
+        printf("Failed to map %s\n", hand.in_file);
+        return 1;
+    }
+
+    if (hand.type == 1) {
+        for (n = 0; n < MAX_PERCENT; n++) {
+            sprintf(group_name, "%s%d", GROUP_NAME, n + 1);
+            if (H5Lexists(file, group_name, H5P_DEFAULT) <= 0)
+                break;
+
+            if (hand.v) printf("Reading group %s\n", group_name);
+            group = H5Gopen2(file, group_name, H5P_DEFAULT);
+            read_group(file, &map, group, &res[n]);
+            H5Gclose(group);
+        }
+    }
+    else {
+        if (hand.v) printf("Reading dataset %s\n", hand.dset_name);
+        dset = H5Dopen2(file, hand.dset_name, H5P_DEFAULT);
+        if (dset < 0 || read_struct_chunks(dset, &map, &res[0]) < 0) {
+            printf("Failed to read dataset %s\n", hand.dset_name);
+            return 1;
+        }
+        H5Dclose(dset);
+        n = 1;
+    }
+
+    if (hand.v) printf("Done! \n");
+
+    sc_mmap_close(&map);
+    H5Fclose(file);
+    H5Pclose(fapl);
+
+    /* Print results */
+    print_results(n, hand.type == 1 ? "percentage" : "dataset");
+
+    return 0;
+}
@@ -0,0 +1,615 @@
+/*
+ * This program measures how the processes of an MPI job get the metadata of a sparse dataset before
+ * they read their part of the data.  It reads the packed storage of structured chunks written by
+ * par_write.c (see structured_chunk.h): the chunk index "<name>.index" and the chunks.
+ *
+ * The chunks are divided into P blocks of consecutive chunks, one for each of the P processes.  The
+ * metadata of the dataset is the chunk index and, with the option -s 1, the prefixes and the Encoded
+ * Selections of all chunks (e.g. to build the occupancy map of the dataset at the start of the job).
+ * Three ways to get the metadata are compared:
+ *
+ *  storm - every process opens the file with the library, reads the index and reads the selections
+ *          itself, as independent readers do today;
+ *  bcast - process 0 reads the metadata and broadcasts it with MPI_Bcast;
+ *  shm   - one process per node reads the metadata into an MPI shared memory window
+ *          (MPI_Win_allocate_shared) that the other processes of the node use without a copy; the
+ *          node leaders get it with MPI_Bcast.
+ *
+ * The selections are read with sc_read_coalesced(), merging reads that are less than G bytes apart
+ * (option -g).  Then each process reads its chunks: only the Data sections when the selections are
+ * known, the whole chunks otherwise.  With the option -c 1 the file pages are dropped from the page
+ * cache before each pass.  The time of the metadata step (TM) and of the data step (TD) of the
+ * slowest process, and the number of metadata bytes read by all processes (MB) are reported.  Each
+ * way is repeated R times (option -r) and the best time is reported.
+ *
+ * To compile the program, please use the MPI compiler wrapper with the HDF5 flags, e.g. with Open MPI
+ * and the serial library:
+ *
+ *           OMPI_CC=h5cc mpicc par_read.c -o par_read
+ *
+ * The -h option lists all the command line options:
+ *
+ *   [-h] [-i --inFile] [-n --nameDset] [-s --sSelections] [-g --gMaxGap] [-c --cCold] [-r --rRepeat]
+ *   [-v --Verbose]
+ *
+ * Example: The commands
+ *
+ *           mpirun -np 8 ./par_write -g 256
+ *           for np in 1 2 4 8 16 32 64 128; do mpirun -np $np ./par_read -s 1; done
+ *
+ * read the 2048 chunks written by 8 processes with 1 to 128 processes.
+ */
+
+#include "hdf5.h"
+#include "structured_chunk.h"
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <string.h>
+#include <getopt.h>
+
+#define FILE_NAME                       "par_file.h5"
+#define DSET_NAME                       "sparse"
+#define MAX_GAP                         (64 * 1024)
+#define REPEAT                          3
+#define NMODES                          3
+
+/* Ways to get the metadata */
+#define MODE_STORM                      0
+#define MODE_BCAST                      1
+#define MODE_SHM                        2
+
+typedef struct {
+    char           *in_file;
+    char           *dset_name;
+    int             s;               /* flag to read the selections of all chunks */
+    long long int   max_gap;
+    int             c;               /* flag to drop the page cache before each pass */
+    int             repeat;
+    int             v;               /* prints progress messages */
+} handler_t;
+
+/*
+ * Metadata of the dataset in one buffer that can be broadcast:
+ *   number of chunks, size of the selections (8 bytes each)
+ *   index: SC_INDEX_FIELDS values for each chunk
+ *   with the selections: the offset of each chunk's prefix and Encoded Selection in the buffer,
+ *   followed by the prefixes and Encoded Selections
+ */
+#define META_NCHUNKS(m)                 (((const uint64_t *)(m))[0])
+#define META_SEL_SIZE(m)                (((const uint64_t *)(m))[1])
+#define META_INDEX(m)                   ((const uint64_t *)(m) + 2)
+#define META_SEL_OFFSETS(m)             (META_INDEX(m) + META_NCHUNKS(m) * SC_INDEX_FIELDS)
+#define META_SIZE(nchunks, sel_size, s) \
+    ((2 + (nchunks) * SC_INDEX_FIELDS + ((s) ? (nchunks) : 0)) * sizeof(uint64_t) + (sel_size))
+
+typedef struct {
+    double          meta;            /* best time of the metadata step */
+    double          data;            /* best time of the data step */
+    double          total;           /* best total time */
+    long long int   meta_bytes;      /* metadata bytes read by all processes */
+    long long int   nelemts;         /* defined elements read by all processes */
+    uint64_t        sum;             /* sum of the values read by all processes */
+} result_t;
+
+handler_t    hand;
+result_t     res[NMODES];
+int          mpi_rank, mpi_size;
+const char  *mode_names[NMODES] = {"storm", "bcast", "shm"};
+
+/*------------------------------------------------------------
+ * Display command line usage
+ *------------------------------------------------------------
+ */
+void
+usage(void)
+{
+    printf("    [-h] [-i --inFile] [-n --nameDset] [-s --sSelections] [-g --gMaxGap] [-c --cCold] [-r --rRepeat]\n");
+    printf("    [-v --Verbose]\n");
+    printf("    [-h --help]: this help page\n");
+    printf("    [-i --inFile]: the file written by par_write.c (default %s)\n", FILE_NAME);
+    printf("    [-n --nameDset]: the name of the packed dataset (default %s)\n", DSET_NAME);
+    printf("    [-s --sSelections]: the metadata includes the selections of all chunks (1); default index only (0)\n");
+    printf("    [-g --gMaxGap]: the maximum gap in bytes between merged reads of selections (default %d)\n", MAX_GAP);
+    printf("    [-c --cCold]: drop the page cache before each pass (1); default warm cache (0)\n");
+    printf("    [-r --rRepeat]: the number of passes for each way\n");
+    printf("    [-v --Verbose]: Print progress messages(1); default no messages displayed (0) \n");
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Parse command line option; only process 0 echoes the options
+ *------------------------------------------------------------
+ */
+void
+parse_command_line(int argc, char *argv[])
+{
+    int           opt;
+    FILE         *out = mpi_rank == 0 ? stdout : NULL;
+    struct option long_options[] = {
+                                    {"help", no_argument, NULL, 'h'},
+                                    {"inFile=", required_argument, NULL, 'i'},
+                                    {"nameDset=", required_argument, NULL, 'n'},
+                                    {"sSelections=", required_argument, NULL, 's'},
+                                    {"gMaxGap=", required_argument, NULL, 'g'},
+                                    {"cCold=", required_argument, NULL, 'c'},
+                                    {"rRepeat=", required_argument, NULL, 'r'},
+                                    {"Verbose=", required_argument, NULL, 'v'},
+                                    {NULL, 0, NULL, 0}};
+
+    /* Initialize the command line options */
+    hand.in_file   = FILE_NAME;
+    hand.dset_name = DSET_NAME;
+    hand.s         = 0;
+    hand.max_gap   = MAX_GAP;
+    hand.c         = 0;
+    hand.repeat    = REPEAT;
+    hand.v         = 0;
+
+    while ((opt = getopt_long(argc, argv, "hi:n:s:g:c:r:v:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'h':
+                if (out) {
+                    fprintf(out, "Help page:\n");
+                    usage();
+                }
+                MPI_Finalize();
+
+                exit(0);
+
+                break;
+            case 'i':
+                if (optarg) {
+                    if (out) fprintf(out, "Input file:\t\t\t\t\t\t%s\n", optarg);
+                    hand.in_file = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'n':
+                if (optarg) {
+                    if (out) fprintf(out, "Dataset:\t\t\t\t\t\t%s\n", optarg);
+                    hand.dset_name = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 's':
+                if (optarg) {
+                    hand.s = atoi(optarg);
+                    if (out) fprintf(out, "Read the selections: \t\t\t\t\t%s\n", hand.s == 1 ? "on" : "off");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'g':
+                if (optarg) {
+                    if (out) fprintf(out, "Maximum gap:\t\t\t\t\t\t%s\n", optarg);
+                    hand.max_gap = atoll(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'c':
+                if (optarg) {
+                    hand.c = atoi(optarg);
+                    if (out) fprintf(out, "Cold page cache: \t\t\t\t\t%s\n", hand.c == 1 ? "on" : "off");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'r':
+                if (optarg) {
+                    if (out) fprintf(out, "Number of passes:\t\t\t\t\t%s\n", optarg);
+                    hand.repeat = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'v':
+                if (optarg) {
+                    hand.v = atoi(optarg);
+                    if (out) fprintf(out, "Verbose mode: \t\t\t\t\t\t%s\n", hand.v == 1 ? "on" : "off");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case ':':
+                printf("Option needs a value\n");
+                break;
+            case '?':
+                printf("Unknown option: %c\n", optopt);
+                break;
+        }
+    }
+
+    /* optind is for the extra arguments which are not parsed */
+    for (; optind < argc; optind++) {
+        if (out) printf("extra arguments not parsed: %s\n", argv[optind]);
+    }
+
+    /* Make sure the command line options are valid */
+    if (hand.s < 0 || hand.s > 1 || hand.c < 0 || hand.c > 1 || hand.v < 0 || hand.v > 1) {
+        if (out) printf("Selection, cold cache and verbose flags can only be 0 or 1 \n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    if (hand.max_gap < 0) {
+        if (out) printf("The maximum gap can't be negative\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    if (hand.repeat < 1) {
+        if (out) printf("The number of passes must be positive\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+}
+
+/*------------------------------------------------------------
+ * Print the time of each way to get the metadata
+ *------------------------------------------------------------
+ */
+void print_results(size_t nchunks)
+{
+    int i;
+
+    printf("\n");
+    printf("%d processes read %zu chunks with %lli defined elements; metadata %s\n", mpi_size, nchunks,
+           res[0].nelemts, hand.s ? "with the selections" : "is the index only");
+    printf("\n");
+    printf("Printing the way to get the metadata, time in seconds of the metadata step (TM), of the data step\n");
+    printf("(TD) and in total (T), metadata bytes read by all processes (MB) and speedup over the storm (SU)\n");
+    printf("\n");
+    printf("       way         TM         TD          T         MB         SU\n");
+    printf("\n");
+
+    for (i = 0; i < NMODES; i++)
+        printf("%10s %10.4f %10.4f %10.4f %10lli %10.2f \n", mode_names[i], res[i].meta, res[i].data, res[i].total,
+               res[i].meta_bytes, res[MODE_STORM].total / res[i].total);
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Drop the pages of a file from the page cache
+ *------------------------------------------------------------
+ */
+void drop_cache(const char *file_name)
+{
+    int fd;
+
+    if ((fd = open(file_name, O_RDONLY)) < 0)
+        return;
+    fsync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+/*------------------------------------------------------------
+ * Read the metadata of the dataset into one buffer; returns the
+ * buffer and the number of bytes read from the file
+ *------------------------------------------------------------
+ */
+uint8_t *read_metadata(int fd, size_t *meta_size, long long int *bytes_read)
+{
+    hid_t           file;
+    hsize_t         index_size = 0;
+    sc_chunk_loc_t *locs = NULL;
+    sc_io_t        *reqs = NULL;
+    uint8_t        *meta, *prefixes = NULL;
+    uint64_t       *p, sel_size = 0, nbytes;
+    size_t          nchunks = 0, nios, c;
+    int             i;
+
+    if ((file = H5Fopen(hand.in_file, H5F_ACC_RDONLY, H5P_DEFAULT)) < 0 ||
+        sc_read_packed_index(file, hand.dset_name, &nchunks, &locs) < 0) {
+        printf("Failed to read the chunk index of %s\n", hand.dset_name);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    {
+        char  index_name[256];
+        hid_t dset;
+
+        snprintf(index_name, sizeof(index_name), "%s%s", hand.dset_name, SC_INDEX_SUFFIX);
+        dset       = H5Dopen2(file, index_name, H5P_DEFAULT);
+        index_size = H5Dget_storage_size(dset);
+        H5Dclose(dset);
+    }
+    H5Fclose(file);
+    *bytes_read = (long long int)index_size;
+
+    /* The prefixes, then the Encoded Selections of all chunks */
+    if (hand.s) {
+        reqs     = (sc_io_t *)malloc((nchunks ? nchunks : 1) * sizeof(sc_io_t));
+        prefixes = (uint8_t *)malloc((nchunks ? nchunks : 1) * SC_PREFIX_SIZE);
+        for (c = 0; c < nchunks; c++) {
+            reqs[c].addr = locs[c].addr;
+            reqs[c].size = SC_PREFIX_SIZE;
+            reqs[c].buf  = prefixes + c * SC_PREFIX_SIZE;
+        }
+        if (sc_read_coalesced(nchunks, reqs, (size_t)hand.max_gap, 0, sc_pread_op, &fd, &nios, &nbytes) < 0)
+            goto error;
+        *bytes_read += (long long int)nbytes;
+        for (c = 0; c < nchunks; c++) {
+            sc_chunk_info_t info;
+
+            if (sc_decode_prefix(prefixes + c * SC_PREFIX_SIZE, &info) < 0)
+                goto error;
+            sel_size += SC_PREFIX_SIZE + info.section_size[SC_SECTION_SELECTION];
+        }
+    }
+
+    *meta_size = META_SIZE(nchunks, sel_size, hand.s);
+    meta       = (uint8_t *)malloc(*meta_size);
+    p          = (uint64_t *)meta;
+    *p++       = (uint64_t)nchunks;
+    *p++       = sel_size;
+    for (c = 0; c < nchunks; c++) {
+        for (i = 0; i < SC_MAX_RANK; i++)
+            *p++ = locs[c].offset[i];
+        *p++ = locs[c].addr;
+        *p++ = locs[c].size;
+    }
+
+    if (hand.s) {
+        uint64_t *offsets = p;
+        uint8_t  *sel     = (uint8_t *)(p + nchunks);
+        uint64_t  pos     = (uint64_t)(sel - meta);
+
+        for (c = 0; c < nchunks; c++) {
+            sc_chunk_info_t info;
+
+            if (sc_decode_prefix(prefixes + c * SC_PREFIX_SIZE, &info) < 0)
+                goto error;
+            offsets[c] = pos;
+            memcpy(meta + pos, prefixes + c * SC_PREFIX_SIZE, SC_PREFIX_SIZE);
+            reqs[c].addr = locs[c].addr + SC_PREFIX_SIZE;
+            reqs[c].size = (size_t)info.section_size[SC_SECTION_SELECTION];
+            reqs[c].buf  = meta + pos + SC_PREFIX_SIZE;
+            pos += SC_PREFIX_SIZE + reqs[c].size;
+        }
+        if (sc_read_coalesced(nchunks, reqs, (size_t)hand.max_gap, 0, sc_pread_op, &fd, &nios, &nbytes) < 0)
+            goto error;
+        *bytes_read += (long long int)nbytes;
+
+        /* Verify the checksums of the selections */
+        for (c = 0; c < nchunks; c++) {
+            sc_chunk_info_t info;
+
+            if (sc_decode_prefix(meta + offsets[c], &info) < 0)
+                goto error;
+            if (sc_decode_section(&info, SC_SECTION_SELECTION, meta + offsets[c] + SC_PREFIX_SIZE, NULL) < 0)
+                goto error;
+        }
+    }
+
+    free(prefixes);
+    free(reqs);
+    free(locs);
+
+    return meta;
+
+error:
+    printf("Failed to read the selections of %s\n", hand.dset_name);
+    MPI_Abort(MPI_COMM_WORLD, 1);
+    return NULL;
+}
+
+/*------------------------------------------------------------
+ * Read the chunks of this process; returns the number of
+ * defined elements and adds the values to the sum
+ *------------------------------------------------------------
+ */
+long long int read_data(int fd, const uint8_t *meta, uint64_t *sum)
+{
+    size_t          nchunks = (size_t)META_NCHUNKS(meta);
+    size_t          first   = nchunks * (size_t)mpi_rank / (size_t)mpi_size;
+    size_t          last    = nchunks * (size_t)(mpi_rank + 1) / (size_t)mpi_size;
+    const uint64_t *index   = META_INDEX(meta);
+    long long int   nelemts = 0;
+    uint8_t        *buf     = NULL;
+    size_t          buf_size = 0, c;
+
+    for (c = first; c < last; c++) {
+        const uint64_t *e    = index + c * SC_INDEX_FIELDS;
+        uint64_t        addr = e[SC_MAX_RANK];
+        size_t          size = (size_t)e[SC_MAX_RANK + 1];
+        sc_chunk_info_t info;
+        const int      *values;
+        uint64_t        i;
+        void           *bufs[SC_MAX_SECTIONS] = {NULL};
+
+        if (size > buf_size) {
+            free(buf);
+            buf_size = size;
+            buf      = (uint8_t *)malloc(buf_size);
+        }
+
+        if (hand.s) {
+            /* Only the Data section */
+            const uint8_t *prefix = meta + META_SEL_OFFSETS(meta)[c];
+            size_t         data_size;
+
+            if (sc_decode_prefix(prefix, &info) < 0)
+                goto error;
+            addr += SC_PREFIX_SIZE + info.section_size[SC_SECTION_SELECTION];
+            data_size = (size_t)info.section_size[SC_SECTION_FIXED];
+            if (pread(fd, buf, data_size, (off_t)addr) != (ssize_t)data_size)
+                goto error;
+            if (info.section_orig_size[SC_SECTION_FIXED] != info.section_size[SC_SECTION_FIXED])
+                goto error;
+            values = (const int *)buf;
+        }
+        else {
+            /* The whole chunk */
+            if (pread(fd, buf, size, (off_t)addr) != (ssize_t)size)
+                goto error;
+            if (sc_disassemble_chunk(buf, size, &info, bufs) < 0)
+                goto error;
+            if (info.section_orig_size[SC_SECTION_FIXED] != info.section_size[SC_SECTION_FIXED])
+                goto error;
+            values = (const int *)(buf + SC_PREFIX_SIZE + info.section_size[SC_SECTION_SELECTION]);
+        }
+
+        for (i = 0; i < info.nelemts; i++)
+            *sum += (uint64_t)values[i];
+        nelemts += (long long int)info.nelemts;
+    }
+    free(buf);
+
+    return nelemts;
+
+error:
+    printf("Failed to read chunk %zu (filtered Data sections are not supported)\n", c);
+    MPI_Abort(MPI_COMM_WORLD, 1);
+    return -1;
+}
+
+/*------------------------------------------------------------
+ * Get the metadata with one of the ways and read the data
+ *------------------------------------------------------------
+ */
+void read_pass(int mode, int fd, double *t_meta, double *t_data, long long int *meta_bytes, long long int *nelemts,
+               uint64_t *sum, size_t *nchunks)
+{
+    uint8_t      *meta = NULL;
+    unsigned long meta_size = 0;
+    size_t        size;
+    MPI_Win       win = MPI_WIN_NULL;
+    double        start;
+
+    *meta_bytes = 0;
+    *sum        = 0;
+    if (hand.c && mpi_rank == 0)
+        drop_cache(hand.in_file);
+    MPI_Barrier(MPI_COMM_WORLD);
+    start = MPI_Wtime();
+
+    if (mode == MODE_STORM) {
+        meta = read_metadata(fd, &size, meta_bytes);
+    }
+    else if (mode == MODE_BCAST) {
+        if (mpi_rank == 0) {
+            meta      = read_metadata(fd, &size, meta_bytes);
+            meta_size = (unsigned long)size;
+        }
+        MPI_Bcast(&meta_size, 1, MPI_UNSIGNED_LONG, 0, MPI_COMM_WORLD);
+        if (meta_size > INT_MAX) {
+            printf("The metadata is too large to be broadcast\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        if (mpi_rank != 0)
+            meta = (uint8_t *)malloc(meta_size);
+        MPI_Bcast(meta, (int)meta_size, MPI_BYTE, 0, MPI_COMM_WORLD);
+    }
+    else {
+        /* The node leaders read or receive the metadata into the shared window of their node */
+        MPI_Comm  node, leaders;
+        MPI_Aint  win_size;
+        int       node_rank, disp_unit;
+        uint8_t  *tmp = NULL;
+
+        MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, mpi_rank, MPI_INFO_NULL, &node);
+        MPI_Comm_rank(node, &node_rank);
+        MPI_Comm_split(MPI_COMM_WORLD, node_rank == 0 ? 0 : MPI_UNDEFINED, mpi_rank, &leaders);
+
+        if (mpi_rank == 0) {
+            tmp       = read_metadata(fd, &size, meta_bytes);
+            meta_size = (unsigned long)size;
+        }
+        if (node_rank == 0)
+            MPI_Bcast(&meta_size, 1, MPI_UNSIGNED_LONG, 0, leaders);
+        MPI_Bcast(&meta_size, 1, MPI_UNSIGNED_LONG, 0, node);
+
+        MPI_Win_allocate_shared(node_rank == 0 ? (MPI_Aint)meta_size : 0, 1, MPI_INFO_NULL, node, &meta, &win);
+        MPI_Win_shared_query(win, 0, &win_size, &disp_unit, &meta);
+        if (node_rank == 0) {
+            if (mpi_rank == 0)
+                memcpy(meta, tmp, meta_size);
+            if (meta_size > INT_MAX) {
+                printf("The metadata is too large to be broadcast\n");
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            MPI_Bcast(meta, (int)meta_size, MPI_BYTE, 0, leaders);
+            MPI_Comm_free(&leaders);
+        }
+        MPI_Barrier(node);
+        MPI_Comm_free(&node);
+        free(tmp);
+    }
+    *t_meta = MPI_Wtime() - start;
+
+    start    = MPI_Wtime();
+    *nchunks = (size_t)META_NCHUNKS(meta);
+    *nelemts = read_data(fd, meta, sum);
+    MPI_Barrier(MPI_COMM_WORLD);
+    *t_data = MPI_Wtime() - start;
+
+    if (win != MPI_WIN_NULL)
+        MPI_Win_free(&win);
+    else
+        free(meta);
+}
+
+/*------------------------------------------------------------
+ * Main function
+ *------------------------------------------------------------
+ */
+int
+main(int argc, char **argv)
+{
+    long long int meta_bytes, nelemts, sums[2], totals[2];
+    uint64_t      sum;
+    size_t        nchunks = 0;
+    double        t[2], tmax[2];
+    int           fd, mode, n;
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &mpi_rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &mpi_size);
+
+    parse_command_line(argc, argv);
+
+    if ((fd = open(hand.in_file, O_RDONLY)) < 0) {
+        printf("Failed to open %s\n", hand.in_file);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    for (mode = 0; mode < NMODES; mode++) {
+        if (hand.v && mpi_rank == 0) printf("Reading the metadata: %s\n", mode_names[mode]);
+
+        res[mode].meta = res[mode].data = res[mode].total = 1e30;
+        for (n = 0; n < hand.repeat; n++) {
+            read_pass(mode, fd, &t[0], &t[1], &meta_bytes, &nelemts, &sum, &nchunks);
+
+            /* The slowest process determines the time */
+            MPI_Reduce(t, tmax, 2, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+            sums[0] = meta_bytes;
+            sums[1] = nelemts;
+            MPI_Reduce(sums, totals, 2, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+            MPI_Reduce(&sum, &res[mode].sum, 1, MPI_UINT64_T, MPI_SUM, 0, MPI_COMM_WORLD);
+            if (mpi_rank == 0 && tmax[0] + tmax[1] < res[mode].total) {
+                res[mode].meta  = tmax[0];
+                res[mode].data  = tmax[1];
+                res[mode].total = tmax[0] + tmax[1];
+            }
+            res[mode].meta_bytes = totals[0];
+            res[mode].nelemts    = totals[1];
+        }
+    }
+
+    if (mpi_rank == 0)
+        for (mode = 1; mode < NMODES; mode++)
+            if (res[mode].sum != res[MODE_STORM].sum || res[mode].nelemts != res[MODE_STORM].nelemts)
+                printf("Values read with %s differ from the storm\n", mode_names[mode]);
+
+    if (hand.v && mpi_rank == 0) printf("Done! \n");
+
+    if (mpi_rank == 0)
+        print_results(nchunks);
+
+    close(fd);
+    MPI_Finalize();
+
+    return 0;
+}
@@ -0,0 +1,712 @@
+/*
+ * This program measures parallel writes of sparse structured chunks of variable size by the processes
+ * of an MPI job.  Structured chunks are emulated as described in structured_chunk.h.
+ *
+ * Each of the P processes generates K chunks (option -g) of C1 x C2 integers (option -c).  The
+ * density of each chunk is drawn between 50% and 150% of the density specified with the option -m,
+ * so that the encoded chunks have different sizes.  The chunks of process p form row p of the chunk
+ * grid of a P*C1 x K*C2 dataset.  Four ways to write them to "par_file.h5" are compared:
+ *
+ *  funnel - the chunks are gathered on process 0 that writes them with H5Dwrite_chunk to a chunked
+ *           dataset.  This is the only way to write structured chunks with the serial library.
+ *  independent, collective, aggregated - the packed storage of structured_chunk.h:
+ *           1. the processes exchange the sizes of their encoded chunks (MPI_Exscan) and the entries
+ *              of the chunk index (MPI_Gather);
+ *           2. process 0 allocates the file space for all chunks at once with sc_create_packed(),
+ *              writes the index with sc_write_packed_index() and broadcasts the address of the space;
+ *           3. the processes write their chunks at their offsets with MPI-IO, either with one
+ *              independent write each (MPI_File_write_at), one collective write (MPI_File_write_at_all),
+ *              or through A aggregators (option -a) that gather the chunks of P/A consecutive
+ *              processes and write them as one contiguous block.
+ *
+ * The library is not used by more than one process at a time; the packed storage only needs the
+ * serial library.  The time of the exchange and allocation (TA), of the write of the data (TW) and
+ * the write throughput are reported.  Each way is repeated R times (option -r) and the best time is
+ * reported.  With the option -k 1 process 0 reads all chunks back and verifies their checksums.
+ * The file written last (aggregated) can be read with par_read.c.
+ *
+ * To compile the program, please use the MPI compiler wrapper with the HDF5 flags, e.g. with Open MPI
+ * and the serial library:
+ *
+ *           OMPI_CC=h5cc mpicc par_write.c -o par_write
+ *
+ * The -h option lists all the command line options:
+ *
+ *   [-h] [-c --dimsChunk] [-g --gChunks] [-m --mPercent] [-a --aAggregators] [-o --outFile]
+ *   [-r --rRepeat] [-k --kVerify] [-v --Verbose]
+ *
+ * Example: The command
+ *
+ *           mpirun -np 8 ./par_write -c 128x128 -g 64 -m 5 -a 2
+ *
+ * writes 512 chunks of 128x128 elements with about 5% defined elements from 8 processes.
+ */
+
+#include "hdf5.h"
+#include "structured_chunk.h"
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <string.h>
+#include <getopt.h>
+
+#define FILE_NAME                       "par_file.h5"
+#define DSET_NAME                       "sparse"
+#define RANK                            2
+#define CHUNK_DIM1                      128
+#define CHUNK_DIM2                      128
+#define CHUNKS_PER_PROC                 64
+#define PERCENT                         5
+#define REPEAT                          3
+#define NMODES                          4
+
+/* Ways to write the chunks */
+#define MODE_FUNNEL                     0
+#define MODE_INDEPENDENT                1
+#define MODE_COLLECTIVE                 2
+#define MODE_AGGREGATED                 3
+
+typedef struct {
+    long long int   chunk_dim1;
+    long long int   chunk_dim2;
+    int             nchunks;         /* chunks per process */
+    int             percent;
+    int             naggr;           /* number of aggregators; 0 for one per 4 processes */
+    char           *out_file;
+    int             repeat;
+    int             k;               /* flag to verify the chunks */
+    int             v;               /* prints progress messages */
+} handler_t;
+
+/* Encoded chunks of a process */
+typedef struct {
+    uint8_t        *buf;             /* images of the chunks, one after another */
+    size_t          size;            /* total size */
+    size_t         *sizes;           /* size of each image */
+    hsize_t        *offsets;         /* logical offset of each chunk, RANK values per chunk */
+    long long int   nelemts;         /* number of defined elements */
+} local_t;
+
+typedef struct {
+    double          alloc;           /* best time of the exchange and allocation */
+    double          write;           /* best time of the write of the data */
+    double          total;           /* best total time */
+} result_t;
+
+handler_t    hand;
+result_t     res[NMODES];
+int          mpi_rank, mpi_size;
+const char  *mode_names[NMODES] = {"funnel", "independent", "collective", "aggregated"};
+
+/*------------------------------------------------------------
+ * Display command line usage
+ *------------------------------------------------------------
+ */
+void
+usage(void)
+{
+    printf("    [-h] [-c --dimsChunk] [-g --gChunks] [-m --mPercent] [-a --aAggregators] [-o --outFile]\n");
+    printf("    [-r --rRepeat] [-k --kVerify] [-v --Verbose]\n");
+    printf("    [-h --help]: this help page\n");
+    printf("    [-c --dimsChunk]: the 2D dimensions of the chunks, e.g. 128x128\n");
+    printf("    [-g --gChunks]: the number of chunks written by each process (default %d)\n", CHUNKS_PER_PROC);
+    printf("    [-m --mPercent]: the average percentage of defined elements in a chunk (default %d)\n", PERCENT);
+    printf("    [-a --aAggregators]: the number of aggregators; default one for every 4 processes (0)\n");
+    printf("    [-o --outFile]: the file to write (default %s)\n", FILE_NAME);
+    printf("    [-r --rRepeat]: the number of writes for each way\n");
+    printf("    [-k --kVerify]: read the chunks back and verify their checksums (1)\n");
+    printf("    [-v --Verbose]: Print progress messages(1); default no messages displayed (0) \n");
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Parse dimensions given as "D1xD2"
+ *------------------------------------------------------------
+ */
+void
+parse_dims(const char *str, long long int *dim1, long long int *dim2)
+{
+    char *dims_str, *dim1_str, *dim2_str;
+
+    dims_str = strdup(str);
+    dim1_str = strtok(dims_str, "x");
+    dim2_str = strtok(NULL, "x");
+    *dim1    = dim1_str ? atoll(dim1_str) : 0;
+    *dim2    = dim2_str ? atoll(dim2_str) : 0;
+    free(dims_str);
+}
+
+/*------------------------------------------------------------
+ * Parse command line option; only process 0 echoes the options
+ *------------------------------------------------------------
+ */
+void
+parse_command_line(int argc, char *argv[])
+{
+    int           opt;
+    FILE         *out = mpi_rank == 0 ? stdout : NULL;
+    struct option long_options[] = {
+                                    {"dimsChunk=", required_argument, NULL, 'c'},
+                                    {"gChunks=", required_argument, NULL, 'g'},
+                                    {"help", no_argument, NULL, 'h'},
+                                    {"mPercent=", required_argument, NULL, 'm'},
+                                    {"aAggregators=", required_argument, NULL, 'a'},
+                                    {"outFile=", required_argument, NULL, 'o'},
+                                    {"rRepeat=", required_argument, NULL, 'r'},
+                                    {"kVerify=", required_argument, NULL, 'k'},
+                                    {"Verbose=", required_argument, NULL, 'v'},
+                                    {NULL, 0, NULL, 0}};
+
+    /* Initialize the command line options */
+    hand.chunk_dim1 = CHUNK_DIM1;
+    hand.chunk_dim2 = CHUNK_DIM2;
+    hand.nchunks    = CHUNKS_PER_PROC;
+    hand.percent    = PERCENT;
+    hand.naggr      = 0;
+    hand.out_file   = FILE_NAME;
+    hand.repeat     = REPEAT;
+    hand.k          = 0;
+    hand.v          = 0;
+
+    while ((opt = getopt_long(argc, argv, "c:g:hm:a:o:r:k:v:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'c':
+                /* The dimensions of the chunks */
+                if (optarg) {
+                    parse_dims(optarg, &hand.chunk_dim1, &hand.chunk_dim2);
+                    if (out) fprintf(out, "Chunk dimensions:\t\t\t\t\t%lld x %lld\n", hand.chunk_dim1, hand.chunk_dim2);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'g':
+                if (optarg) {
+                    if (out) fprintf(out, "Chunks per process:\t\t\t\t\t%s\n", optarg);
+                    hand.nchunks = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'h':
+                if (out) {
+                    fprintf(out, "Help page:\n");
+                    usage();
+                }
+                MPI_Finalize();
+
+                exit(0);
+
+                break;
+            case 'm':
+                if (optarg) {
+                    if (out) fprintf(out, "Percentage of defined elements:\t\t\t\t%s\n", optarg);
+                    hand.percent = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'a':
+                if (optarg) {
+                    if (out) fprintf(out, "Number of aggregators:\t\t\t\t\t%s\n", optarg);
+                    hand.naggr = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'o':
+                if (optarg) {
+                    if (out) fprintf(out, "Output file:\t\t\t\t\t\t%s\n", optarg);
+                    hand.out_file = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'r':
+                if (optarg) {
+                    if (out) fprintf(out, "Number of writes:\t\t\t\t\t%s\n", optarg);
+                    hand.repeat = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'k':
+                if (optarg) {
+                    hand.k = atoi(optarg);
+                    if (out) fprintf(out, "Verify the chunks: \t\t\t\t\t%s\n", hand.k == 1 ? "on" : "off");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'v':
+                if (optarg) {
+                    hand.v = atoi(optarg);
+                    if (out) fprintf(out, "Verbose mode: \t\t\t\t\t\t%s\n", hand.v == 1 ? "on" : "off");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case ':':
+                printf("Option needs a value\n");
+                break;
+            case '?':
+                printf("Unknown option: %c\n", optopt);
+                break;
+        }
+    }
+
+    /* optind is for the extra arguments which are not parsed */
+    for (; optind < argc; optind++) {
+        if (out) printf("extra arguments not parsed: %s\n", argv[optind]);
+    }
+
+    /* Make sure the command line options are valid */
+    if (hand.chunk_dim1 <= 0 || hand.chunk_dim2 <= 0 || hand.nchunks <= 0) {
+        if (out) printf("The chunk dimensions and the number of chunks must be positive\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    if (hand.percent < 0 || hand.percent > 66) {
+        if (out) printf("The percentage of defined elements must be between 0 and 66\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    if (hand.naggr < 0 || hand.naggr > mpi_size) {
+        if (out) printf("The number of aggregators must be between 0 and the number of processes\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    if (hand.naggr == 0)
+        hand.naggr = mpi_size >= 4 ? mpi_size / 4 : 1;
+
+    if (hand.repeat < 1) {
+        if (out) printf("The number of writes must be positive\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    if (hand.k < 0 || hand.k > 1 || hand.v < 0 || hand.v > 1) {
+        if (out) printf("Verify and verbose flags can only be 0 or 1 \n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+}
+
+/*------------------------------------------------------------
+ * Print the time and throughput of each way to write
+ *------------------------------------------------------------
+ */
+void print_results(long long int bytes, long long int nelemts)
+{
+    int   i;
+    float mb = (float)bytes / (1024 * 1024);
+
+    printf("\n");
+    printf("%d processes wrote %d chunks with %lli defined elements, %lli bytes, %d aggregators\n", mpi_size,
+           mpi_size * hand.nchunks, nelemts, bytes, hand.naggr);
+    printf("\n");
+    printf("Printing the way to write, time in seconds of the exchange and allocation (TA), of the write of\n");
+    printf("the data (TW) and in total (T), write throughput in MiB/s (WT) and speedup over the funnel (SU)\n");
+    printf("\n");
+    printf("       way         TA         TW          T         WT         SU\n");
+    printf("\n");
+
+    for (i = 0; i < NMODES; i++)
+        printf("%11s %10.4f %10.4f %10.4f %10.1f %10.2f \n", mode_names[i], res[i].alloc, res[i].write,
+               res[i].total, mb / res[i].total, res[MODE_FUNNEL].total / res[i].total);
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Generate and encode the chunks of this process
+ *------------------------------------------------------------
+ */
+void generate_chunks(local_t *local)
+{
+    uint64_t      size = (uint64_t)(hand.chunk_dim1 * hand.chunk_dim2);
+    hsize_t       chunk_dims[RANK];
+    uint8_t      *mask   = (uint8_t *)malloc(size);
+    int          *values = (int *)malloc(size * sizeof(int));
+    sc_run_t     *runs   = (sc_run_t *)malloc((size / 2 + 1) * sizeof(sc_run_t));
+    size_t        cap    = 0;
+    unsigned int  seed;
+    int           c;
+
+    chunk_dims[0] = (hsize_t)hand.chunk_dim1;
+    chunk_dims[1] = (hsize_t)hand.chunk_dim2;
+
+    memset(local, 0, sizeof(*local));
+    local->sizes   = (size_t *)malloc((size_t)hand.nchunks * sizeof(size_t));
+    local->offsets = (hsize_t *)malloc((size_t)hand.nchunks * RANK * sizeof(hsize_t));
+
+    for (c = 0; c < hand.nchunks; c++) {
+        sc_chunk_info_t info;
+        const void     *buf[2];
+        uint8_t        *sel, *data, *image;
+        size_t          nruns, image_size = 0, n;
+        uint64_t        i, nelemts = 0;
+        int             threshold;
+
+        /* The density of the chunk is between 50% and 150% of the requested density */
+        seed      = (unsigned int)(mpi_rank * hand.nchunks + c + 1);
+        threshold = (int)((double)RAND_MAX / 100.0 * hand.percent * (0.5 + (double)rand_r(&seed) / RAND_MAX));
+        for (i = 0; i < size; i++) {
+            mask[i]   = rand_r(&seed) < threshold;
+            values[i] = (int)i;
+        }
+
+        nruns = sc_mask_to_runs(mask, size, (uint64_t)hand.chunk_dim2, runs);
+        for (n = 0; n < nruns; n++)
+            nelemts += runs[n].len;
+
+        memset(&info, 0, sizeof(info));
+        info.type                                    = SC_SPARSE_CHUNK;
+        info.num_sections                            = 2;
+        info.nelemts                                 = nelemts;
+        info.section_orig_size[SC_SECTION_SELECTION] = sc_encode_runs(RANK, chunk_dims, nruns, runs, NULL);
+        info.section_orig_size[SC_SECTION_FIXED]     = nelemts * sizeof(int);
+
+        sel  = (uint8_t *)malloc(info.section_orig_size[SC_SECTION_SELECTION]);
+        data = (uint8_t *)malloc(nelemts ? nelemts * sizeof(int) : 1);
+        sc_encode_runs(RANK, chunk_dims, nruns, runs, sel);
+        sc_gather_runs(values, sizeof(int), nruns, runs, data);
+        buf[SC_SECTION_SELECTION] = sel;
+        buf[SC_SECTION_FIXED]     = data;
+        if (sc_assemble_chunk(&info, buf, 0, &image, &image_size) < 0) {
+            printf("Failed to encode chunk %d on process %d\n", c, mpi_rank);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+
+        if (local->size + image_size > cap) {
+            cap        = 2 * (local->size + image_size);
+            local->buf = (uint8_t *)realloc(local->buf, cap);
+        }
+        memcpy(local->buf + local->size, image, image_size);
+        local->size += image_size;
+        local->sizes[c]              = image_size;
+        local->offsets[c * RANK]     = (hsize_t)(mpi_rank * hand.chunk_dim1);
+        local->offsets[c * RANK + 1] = (hsize_t)(c * hand.chunk_dim2);
+        local->nelemts += (long long int)nelemts;
+
+        free(sel);
+        free(data);
+        free(image);
+    }
+
+    free(mask);
+    free(values);
+    free(runs);
+}
+
+/*------------------------------------------------------------
+ * Gather the chunks on process 0 that writes them with
+ * H5Dwrite_chunk
+ *------------------------------------------------------------
+ */
+void write_funnel(const local_t *local, double *t_alloc, double *t_write)
+{
+    int     *counts = NULL, *displs = NULL, *sizes = NULL, count = (int)local->size;
+    int      c, i, nchunks = mpi_size * hand.nchunks;
+    uint8_t *all = NULL;
+    double   start = MPI_Wtime();
+
+    if (local->size > INT_MAX) {
+        printf("The chunks of process %d are too large for the funnel\n", mpi_rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    for (c = 0; c < hand.nchunks; c++)
+        if (local->sizes[c] > INT_MAX)
+            MPI_Abort(MPI_COMM_WORLD, 1);
+
+    /* Exchange of the sizes and of the chunks */
+    if (mpi_rank == 0) {
+        counts = (int *)malloc((size_t)mpi_size * sizeof(int));
+        displs = (int *)malloc((size_t)mpi_size * sizeof(int));
+        sizes  = (int *)malloc((size_t)nchunks * sizeof(int));
+    }
+    {
+        int *my_sizes = (int *)malloc((size_t)hand.nchunks * sizeof(int));
+
+        for (c = 0; c < hand.nchunks; c++)
+            my_sizes[c] = (int)local->sizes[c];
+        MPI_Gather(my_sizes, hand.nchunks, MPI_INT, sizes, hand.nchunks, MPI_INT, 0, MPI_COMM_WORLD);
+        free(my_sizes);
+    }
+    MPI_Gather(&count, 1, MPI_INT, counts, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (mpi_rank == 0) {
+        long long int total = 0;
+
+        for (i = 0; i < mpi_size; i++) {
+            displs[i] = (int)total;
+            total += counts[i];
+        }
+        if (total > INT_MAX) {
+            printf("The chunks are too large for the funnel\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        all = (uint8_t *)malloc(total ? (size_t)total : 1);
+    }
+    MPI_Gatherv(local->buf, count, MPI_BYTE, all, counts, displs, MPI_BYTE, 0, MPI_COMM_WORLD);
+    *t_alloc = MPI_Wtime() - start;
+
+    /* Process 0 writes all chunks */
+    if (mpi_rank == 0) {
+        hid_t    file, dcpl, space, dset;
+        hsize_t  dims[RANK], chunk_dims[RANK], offset[RANK];
+        uint8_t *p = all;
+
+        chunk_dims[0] = (hsize_t)hand.chunk_dim1;
+        chunk_dims[1] = (hsize_t)hand.chunk_dim2;
+        dims[0]       = (hsize_t)(mpi_size * hand.chunk_dim1);
+        dims[1]       = (hsize_t)(hand.nchunks * hand.chunk_dim2);
+
+        file  = H5Fcreate(hand.out_file, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+        dcpl  = sc_create_dcpl(RANK, chunk_dims);
+        space = H5Screate_simple(RANK, dims, NULL);
+        dset  = H5Dcreate2(file, DSET_NAME, H5T_STD_I32LE, space, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+        for (c = 0; c < nchunks; c++) {
+            offset[0] = (hsize_t)(c / hand.nchunks) * chunk_dims[0];
+            offset[1] = (hsize_t)(c % hand.nchunks) * chunk_dims[1];
+            if (H5Dwrite_chunk(dset, H5P_DEFAULT, 0, offset, (size_t)sizes[c], p) < 0) {
+                printf("Failed to write chunk %d\n", c);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            p += sizes[c];
+        }
+        H5Dclose(dset);
+        H5Sclose(space);
+        H5Pclose(dcpl);
+        H5Fclose(file);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    *t_write = MPI_Wtime() - start - *t_alloc;
+
+    free(all);
+    free(sizes);
+    free(counts);
+    free(displs);
+}
+
+/*------------------------------------------------------------
+ * Write the chunks to the packed storage with MPI-IO
+ *------------------------------------------------------------
+ */
+void write_packed(const local_t *local, int mode, double *t_alloc, double *t_write)
+{
+    long long int my_size = (long long int)local->size, my_off = 0, total = 0;
+    uint64_t     *entries, *all_entries = NULL;
+    haddr_t       base = 0;
+    MPI_File      fh;
+    MPI_Status    status;
+    size_t        pos = 0;
+    int           c, i;
+    double        start = MPI_Wtime();
+
+    /* Offsets of the chunks of each process in the packed storage */
+    MPI_Exscan(&my_size, &my_off, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    if (mpi_rank == 0)
+        my_off = 0;
+    MPI_Reduce(&my_size, &total, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    /* Index entries with offsets relative to the packed storage */
+    entries = (uint64_t *)calloc((size_t)hand.nchunks * SC_INDEX_FIELDS, sizeof(uint64_t));
+    for (c = 0; c < hand.nchunks; c++) {
+        for (i = 0; i < RANK; i++)
+            entries[c * SC_INDEX_FIELDS + i] = local->offsets[c * RANK + i];
+        entries[c * SC_INDEX_FIELDS + SC_MAX_RANK]     = (uint64_t)my_off + pos;
+        entries[c * SC_INDEX_FIELDS + SC_MAX_RANK + 1] = local->sizes[c];
+        pos += local->sizes[c];
+    }
+    if (mpi_rank == 0)
+        all_entries = (uint64_t *)malloc((size_t)mpi_size * hand.nchunks * SC_INDEX_FIELDS * sizeof(uint64_t));
+    MPI_Gather(entries, hand.nchunks * SC_INDEX_FIELDS, MPI_UINT64_T, all_entries, hand.nchunks * SC_INDEX_FIELDS,
+               MPI_UINT64_T, 0, MPI_COMM_WORLD);
+
+    /* Process 0 allocates the space of all chunks and writes the index */
+    if (mpi_rank == 0) {
+        hid_t           file;
+        hsize_t         dims[RANK], chunk_dims[RANK];
+        sc_chunk_loc_t *locs;
+        size_t          n, nchunks = (size_t)mpi_size * hand.nchunks;
+
+        chunk_dims[0] = (hsize_t)hand.chunk_dim1;
+        chunk_dims[1] = (hsize_t)hand.chunk_dim2;
+        dims[0]       = (hsize_t)(mpi_size * hand.chunk_dim1);
+        dims[1]       = (hsize_t)(hand.nchunks * hand.chunk_dim2);
+
+        file = H5Fcreate(hand.out_file, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+        if (sc_create_packed(file, DSET_NAME, RANK, dims, chunk_dims, (hsize_t)total, &base) < 0) {
+            printf("Failed to allocate the packed storage\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        locs = (sc_chunk_loc_t *)calloc(nchunks, sizeof(sc_chunk_loc_t));
+        for (n = 0; n < nchunks; n++) {
+            for (i = 0; i < RANK; i++)
+                locs[n].offset[i] = all_entries[n * SC_INDEX_FIELDS + i];
+            locs[n].addr = base + all_entries[n * SC_INDEX_FIELDS + SC_MAX_RANK];
+            locs[n].size = all_entries[n * SC_INDEX_FIELDS + SC_MAX_RANK + 1];
+        }
+        if (sc_write_packed_index(file, DSET_NAME, nchunks, locs) < 0) {
+            printf("Failed to write the chunk index\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        H5Fclose(file);
+        free(locs);
+    }
+    MPI_Bcast(&base, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+    *t_alloc = MPI_Wtime() - start;
+
+    /* Write the data */
+    MPI_File_open(MPI_COMM_WORLD, hand.out_file, MPI_MODE_WRONLY, MPI_INFO_NULL, &fh);
+    if (mode == MODE_INDEPENDENT)
+        MPI_File_write_at(fh, (MPI_Offset)(base + my_off), local->buf, (int)local->size, MPI_BYTE, &status);
+    else if (mode == MODE_COLLECTIVE)
+        MPI_File_write_at_all(fh, (MPI_Offset)(base + my_off), local->buf, (int)local->size, MPI_BYTE, &status);
+    else {
+        /* The aggregator of a group of consecutive processes writes their chunks as one block */
+        MPI_Comm group;
+        int      group_size = (mpi_size + hand.naggr - 1) / hand.naggr;
+        int      group_rank, nmembers, count = (int)local->size;
+        int     *counts = NULL, *displs = NULL;
+        uint8_t *block = NULL;
+
+        MPI_Comm_split(MPI_COMM_WORLD, mpi_rank / group_size, mpi_rank, &group);
+        MPI_Comm_rank(group, &group_rank);
+        MPI_Comm_size(group, &nmembers);
+        if (group_rank == 0) {
+            long long int block_size = 0;
+
+            counts = (int *)malloc((size_t)nmembers * sizeof(int));
+            displs = (int *)malloc((size_t)nmembers * sizeof(int));
+            MPI_Gather(&count, 1, MPI_INT, counts, 1, MPI_INT, 0, group);
+            for (i = 0; i < nmembers; i++) {
+                displs[i] = (int)block_size;
+                block_size += counts[i];
+            }
+            if (block_size > INT_MAX) {
+                printf("The block of aggregator %d is too large\n", mpi_rank);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            block = (uint8_t *)malloc(block_size ? (size_t)block_size : 1);
+            MPI_Gatherv(local->buf, count, MPI_BYTE, block, counts, displs, MPI_BYTE, 0, group);
+            MPI_File_write_at(fh, (MPI_Offset)(base + my_off), block, (int)block_size, MPI_BYTE, &status);
+        }
+        else {
+            MPI_Gather(&count, 1, MPI_INT, NULL, 1, MPI_INT, 0, group);
+            MPI_Gatherv(local->buf, count, MPI_BYTE, NULL, NULL, NULL, MPI_BYTE, 0, group);
+        }
+        MPI_Comm_free(&group);
+        free(block);
+        free(counts);
+        free(displs);
+    }
+    MPI_File_close(&fh);
+    MPI_Barrier(MPI_COMM_WORLD);
+    *t_write = MPI_Wtime() - start - *t_alloc;
+
+    free(entries);
+    free(all_entries);
+}
+
+/*------------------------------------------------------------
+ * Read all chunks of the file back on process 0 and verify
+ * their checksums; returns the number of defined elements
+ *------------------------------------------------------------
+ */
+long long int verify_chunks(int mode)
+{
+    hid_t           file, dset;
+    sc_chunk_loc_t *locs;
+    sc_mmap_t       map;
+    size_t          nchunks, c;
+    long long int   nelemts = 0;
+    int             status;
+
+    file = H5Fopen(hand.out_file, H5F_ACC_RDONLY, H5P_DEFAULT);
+    if (mode == MODE_FUNNEL) {
+        dset   = H5Dopen2(file, DSET_NAME, H5P_DEFAULT);
+        status = sc_get_chunk_locations(dset, &nchunks, &locs);
+        H5Dclose(dset);
+    }
+    else
+        status = sc_read_packed_index(file, DSET_NAME, &nchunks, &locs);
+    H5Fclose(file);
+    if (status < 0 || sc_mmap_open(hand.out_file, &map) < 0)
+        return -1;
+
+    for (c = 0; c < nchunks; c++) {
+        sc_chunk_info_t info;
+        sc_view_t       views[SC_MAX_SECTIONS];
+
+        if (sc_mmap_struct_chunk(&map, locs[c].addr, locs[c].size, 1, &info, views) < 0) {
+            nelemts = -1;
+            break;
+        }
+        nelemts += (long long int)info.nelemts;
+    }
+
+    sc_mmap_close(&map);
+    free(locs);
+
+    return nelemts;
+}
+
+/*------------------------------------------------------------
+ * Main function
+ *------------------------------------------------------------
+ */
+int
+main(int argc, char **argv)
+{
+    local_t       local;
+    long long int bytes = 0, nelemts = 0, my_bytes;
+    double        t_alloc, t_write, t[2], tmax[2];
+    int           mode, n;
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &mpi_rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &mpi_size);
+
+    parse_command_line(argc, argv);
+
+    if (hand.v && mpi_rank == 0) printf("Generating the chunks\n");
+    generate_chunks(&local);
+    my_bytes = (long long int)local.size;
+    MPI_Reduce(&my_bytes, &bytes, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&local.nelemts, &nelemts, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    for (mode = 0; mode < NMODES; mode++) {
+        if (hand.v && mpi_rank == 0) printf("Writing the chunks: %s\n", mode_names[mode]);
+
+        res[mode].alloc = res[mode].write = res[mode].total = 1e30;
+        for (n = 0; n < hand.repeat; n++) {
+            MPI_Barrier(MPI_COMM_WORLD);
+            if (mode == MODE_FUNNEL)
+                write_funnel(&local, &t_alloc, &t_write);
+            else
+                write_packed(&local, mode, &t_alloc, &t_write);
+
+            /* The slowest process determines the time */
+            t[0] = t_alloc;
+            t[1] = t_write;
+            MPI_Reduce(t, tmax, 2, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+            if (mpi_rank == 0 && tmax[0] + tmax[1] < res[mode].total) {
+                res[mode].alloc = tmax[0];
+                res[mode].write = tmax[1];
+                res[mode].total = tmax[0] + tmax[1];
+            }
+        }
+
+        if (hand.k && mpi_rank == 0 && verify_chunks(mode) != nelemts)
+            printf("The chunks written by %s are not valid\n", mode_names[mode]);
+    }
+
+    if (hand.v && mpi_rank == 0) printf("Done! \n");
+
+    if (mpi_rank == 0)
+        print_results(bytes, nelemts);
+
+    free(local.buf);
+    free(local.sizes);
+    free(local.offsets);
+    MPI_Finalize();
+
+    return 0;
+}
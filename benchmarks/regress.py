@@ -0,0 +1,298 @@
+#!/usr/bin/env python3
+"""
+Performance regression suite for the structured chunk benchmarks.
+
+The suite runs a fixed set of cases built on the benchmarks of this directory: selection build and encode
+and the dataset writes of sparse.c, the VL writes of vl.c, the reads of the Encoded Selection and Data
+sections of mmap_read.c and the decode of the structured chunks by sparse_dump.c.  The benchmarks seed
+their random generators with constants (srand(2), srand(20)), so the files and sizes are the same in every
+run and only the timings vary.  The results are taken from the JSON lines of sparse.c and vl.c (-j) and
+from the result tables of the other benchmarks.
+
+    ./regress.py record -B baseline.json     runs the suite and stores every sample as the baseline
+    ./regress.py check -B baseline.json      runs the suite again and compares it with the baseline
+
+Each metric of a case has a kind and a threshold: times and sizes regress when they grow, rates when they
+drop.  A metric fails when the one-sided Mann-Whitney U test finds the current samples worse than the
+baseline at the significance level (-a, exact permutation test for small samples) and the median moved
+in the bad direction by more than the threshold.  Sizes use a threshold of 0: any growth fails.  The
+change of the median is reported with a bootstrap confidence interval (fixed seed).  check exits with 1
+if a metric failed.
+
+The baseline is only meaningful on the machine where it was recorded: check warns if the host or the
+HDF5 version differ.  Pin the runs to one CPU with -C on a shared machine.
+
+Example: compile the benchmarks with h5cc into this directory, then
+
+    ./regress.py record -B baseline.json -r 9
+    ... change the code and compile ...
+    ./regress.py check -B baseline.json -r 9
+"""
+
+import argparse
+import itertools
+import json
+import math
+import os
+import random
+import re
+import shutil
+import socket
+import subprocess
+import sys
+import tempfile
+import time
+
+import sweep
+
+# Kinds of metrics: times and sizes regress when they grow, rates when they drop
+TIME, SIZE, RATE = "time", "size", "rate"
+THRESHOLDS = {TIME: 0.10, SIZE: 0.0, RATE: 0.10}
+
+SUITE = [
+    {"name": "sparse_points", "cmd": ["sparse", "-c", "1x1", "-s", "1", "-m", "3"], "parse": "json",
+     "key": "percent",
+     "metrics": {"t_select": TIME, "t_encode": TIME, "t_sparse": TIME, "t_data": TIME, "sel": SIZE,
+                 "sel_comp": SIZE, "sparse_comp": SIZE}},
+    {"name": "sparse_rows", "cmd": ["sparse", "-c", "1x1", "-s", "3", "-m", "3"], "parse": "json",
+     "key": "percent",
+     "metrics": {"t_select": TIME, "t_encode": TIME, "t_sparse": TIME, "t_data": TIME, "sel": SIZE,
+                 "sel_comp": SIZE}},
+    {"name": "vl_write", "cmd": ["vl", "-n", "20000", "-m", "100"], "parse": "json",
+     "metrics": {"t_vl": TIME, "t_vl_comp": TIME, "t_struct": TIME, "t_struct_comp": TIME, "file1": SIZE,
+                 "file3": SIZE}},
+    {"name": "mmap_read", "setup": [["sparse", "-c", "1x1", "-m", "3"]], "cmd": ["mmap_read", "-r", "5"],
+     "parse": "table", "metrics": {"PRT": RATE, "MRT": RATE}},
+    {"name": "dump_decode", "setup": [["alloc", "-c", "64x64", "-g", "32x32", "-n", "1"]],
+     "cmd": ["sparse_dump", "-b", "1", "-o", os.devnull], "parse": "table", "metrics": {"T": TIME, "MBS": RATE}},
+]
+
+
+def parse_tables(text):
+    """Rows of the result tables of a benchmark: a header of column names followed by a blank line and
+    rows with as many fields; the first field of a row is its key.  Returns {(column, key): value}."""
+    values = {}
+    lines = text.splitlines()
+    for i, line in enumerate(lines):
+        header = line.split()
+        if len(header) < 2 or not all(re.fullmatch(r"[A-Za-z%]+", h) for h in header):
+            continue
+        for row in itertools.takewhile(lambda l: l.strip(), lines[i + 2:]):
+            fields = row.split()
+            if len(fields) != len(header):
+                break
+            for column, field in zip(header[1:], fields[1:]):
+                try:
+                    values[(column, fields[0])] = float(field)
+                except ValueError:
+                    pass
+    return values
+
+
+def run_case(case, bindir, workdir, cpu=None):
+    """Run a case once; returns {"metric[key]": value}."""
+    def command(args):
+        cmd = [os.path.join(bindir, args[0])] + args[1:]
+        return (["taskset", "-c", str(cpu)] if cpu is not None else []) + cmd
+
+    for setup in case.get("setup", []):
+        subprocess.run(command(setup), cwd=workdir, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL, check=True)
+
+    samples = {}
+    if case["parse"] == "json":
+        results = os.path.join(workdir, "results.jsonl")
+        if os.path.exists(results):
+            os.remove(results)
+        subprocess.run(command(case["cmd"] + ["-j", results]), cwd=workdir, stdout=subprocess.DEVNULL,
+                       stderr=subprocess.DEVNULL, check=True)
+        with open(results) as f:
+            for line in (json.loads(l) for l in f if l.strip()):
+                key = "[%s]" % line[case["key"]] if "key" in case else ""
+                for metric in case["metrics"]:
+                    samples[metric + key] = line[metric]
+    else:
+        proc = subprocess.run(command(case["cmd"]), cwd=workdir, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                              text=True, check=True)
+        for (column, key), value in parse_tables(proc.stdout).items():
+            if column in case["metrics"]:
+                samples["%s[%s]" % (column, key)] = value
+    if not samples:
+        raise RuntimeError("case %s produced no results" % case["name"])
+    return samples
+
+
+def run_suite(bindir, repeats, warmup, cpu, cases, verbose):
+    """Run every case "warmup" + "repeats" times; returns {case: {metric: [samples]}}."""
+    bindir = os.path.abspath(bindir)
+    suite = {}
+    with tempfile.TemporaryDirectory(prefix="regress.") as workdir:
+        for case in SUITE:
+            if cases and case["name"] not in cases:
+                continue
+            samples = {}
+            for run in range(warmup + repeats):
+                if verbose:
+                    print("%s (%s %d)" % (case["name"], "warmup" if run < warmup else "run", run + 1), file=sys.stderr)
+                result = run_case(case, bindir, workdir, cpu)
+                if run >= warmup:
+                    for metric, value in result.items():
+                        samples.setdefault(metric, []).append(value)
+            suite[case["name"]] = samples
+    return suite
+
+
+def mann_whitney_p(base, cur):
+    """One-sided p-value of the Mann-Whitney U test that the current samples are larger than the baseline:
+    exact over all assignments of the pooled ranks when there are few, else the normal approximation with
+    the tie correction."""
+    pooled = sorted(base + cur)
+    n1, n2 = len(base), len(cur)
+    ranks = {}
+    i = 0
+    while i < len(pooled):
+        j = i
+        while j < len(pooled) and pooled[j] == pooled[i]:
+            j += 1
+        ranks[pooled[i]] = (i + j + 1) / 2
+        i = j
+    rank_sum = sum(ranks[v] for v in cur)
+    all_ranks = [ranks[v] for v in pooled]
+
+    if math.comb(n1 + n2, n2) <= 50000:
+        count = total = 0
+        for combo in itertools.combinations(range(n1 + n2), n2):
+            total += 1
+            if sum(all_ranks[k] for k in combo) >= rank_sum - 1e-9:
+                count += 1
+        return count / total
+
+    n = n1 + n2
+    u = rank_sum - n2 * (n2 + 1) / 2
+    ties = sum(c ** 3 - c for c in (pooled.count(v) for v in set(pooled)))
+    sigma = math.sqrt(n1 * n2 / 12 * ((n + 1) - ties / (n * (n - 1))))
+    if sigma == 0:
+        return 1.0
+    z = (u - n1 * n2 / 2 - 0.5) / sigma
+    return 0.5 * math.erfc(z / math.sqrt(2))
+
+
+def bootstrap_change(base, cur, confidence=0.95, nboot=2000, seed=2):
+    """Bootstrap interval of the relative change of the median."""
+    rng = random.Random(seed)
+    changes = []
+    for _ in range(nboot):
+        b = sweep.median([rng.choice(base) for _ in base])
+        c = sweep.median([rng.choice(cur) for _ in cur])
+        changes.append((c - b) / b if b else 0.0)
+    changes.sort()
+    alpha = (1 - confidence) / 2
+    return changes[int(alpha * nboot)], changes[min(nboot - 1, int((1 - alpha) * nboot))]
+
+
+def compare(baseline, current, alpha, thresholds):
+    """Compare the samples of every metric; returns the rows of the report and the number of failures."""
+    kinds = {case["name"]: case["metrics"] for case in SUITE}
+    rows, failures = [], 0
+    for name, metrics in current.items():
+        for metric, cur in sorted(metrics.items()):
+            base = baseline.get(name, {}).get(metric)
+            if not base:
+                rows.append((name, metric, None, sweep.median(cur), None, None, None, None, "NEW"))
+                continue
+            kind = kinds[name][metric.split("[")[0]]
+            sign = -1 if kind == RATE else 1
+            b, c = sweep.median(base), sweep.median(cur)
+            change = (c - b) / b if b else 0.0
+            low, high = bootstrap_change(base, cur)
+            p = mann_whitney_p([sign * v for v in base], [sign * v for v in cur])
+            if sign * change > thresholds[kind] and p < alpha:
+                result = "FAIL"
+                failures += 1
+            elif -sign * change > thresholds[kind] and mann_whitney_p([sign * v for v in cur],
+                                                                      [sign * v for v in base]) < alpha:
+                result = "BETTER"
+            else:
+                result = "ok"
+            rows.append((name, metric, b, c, change, low, high, p, result))
+    return rows, failures
+
+
+def print_report(rows):
+    def num(v, fmt):
+        return fmt % v if v is not None else "-"
+
+    print()
+    print("Printing the case, metric, median of the baseline (BASE) and of the current run (CUR), change of the")
+    print("median (CHG) with its bootstrap interval (LOW, HIGH), p-value of the Mann-Whitney test (P) and result")
+    print()
+    print("%-14s %-18s %12s %12s %8s %8s %8s %8s  %s" % ("CASE", "METRIC", "BASE", "CUR", "CHG", "LOW", "HIGH", "P",
+                                                        "RESULT"))
+    print()
+    for name, metric, b, c, change, low, high, p, result in rows:
+        print("%-14s %-18s %12s %12s %8s %8s %8s %8s  %s" % (name, metric, num(b, "%.6g"), num(c, "%.6g"),
+                                                            num(change, "%+.3f"),
+                                                            num(low, "%+.3f"), num(high, "%+.3f"), num(p, "%.4f"),
+                                                            result))
+    print()
+
+
+def environment():
+    proc = subprocess.run(["h5cc", "-showconfig"], stdout=subprocess.PIPE, stderr=subprocess.DEVNULL, text=True) \
+        if shutil.which("h5cc") else None
+    match = re.search(r"HDF5 Version:\s*(\S+)", proc.stdout) if proc else None
+    return {"host": socket.gethostname(), "hdf5": match.group(1) if match else "unknown",
+            "rev": sweep.git_revision(os.path.dirname(os.path.abspath(__file__))),
+            "date": time.strftime("%Y-%m-%dT%H:%M:%SZ", time.gmtime())}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Performance regression suite for the structured chunk benchmarks.")
+    parser.add_argument("action", choices=["record", "check"], help="store a baseline or compare with it")
+    parser.add_argument("-B", "--baseline", required=True, help="file of the baseline results")
+    parser.add_argument("-b", "--bindir", default=".", help="directory of the compiled benchmarks (default .)")
+    parser.add_argument("-r", "--repeats", type=int, default=7, help="runs of each case (default 7)")
+    parser.add_argument("-w", "--warmup", type=int, default=1, help="discarded runs of each case (default 1)")
+    parser.add_argument("-a", "--alpha", type=float, default=0.01, help="significance level (default 0.01)")
+    parser.add_argument("-t", "--threshold", action="append", default=[], metavar="KIND=FRACTION",
+                        help="threshold of a kind of metric, e.g. time=0.05 (defaults time=0.10 size=0 rate=0.10)")
+    parser.add_argument("-C", "--cpu", type=int, help="pin the benchmarks to this CPU with taskset")
+    parser.add_argument("-c", "--cases", help="comma-separated cases to run (default all: %s)" %
+                        ",".join(case["name"] for case in SUITE))
+    parser.add_argument("-v", "--verbose", action="store_true", help="print the runs")
+    args = parser.parse_args()
+
+    thresholds = dict(THRESHOLDS)
+    for t in args.threshold:
+        kind, _, value = t.partition("=")
+        if kind not in thresholds or not value:
+            parser.error("invalid threshold %s" % t)
+        thresholds[kind] = float(value)
+    if args.repeats < 1 or args.warmup < 0:
+        parser.error("the number of repeats must be positive")
+    cases = args.cases.split(",") if args.cases else None
+
+    current = run_suite(args.bindir, args.repeats, args.warmup, args.cpu, cases, args.verbose)
+    env = environment()
+
+    if args.action == "record":
+        with open(args.baseline, "w") as f:
+            json.dump({"environment": env, "repeats": args.repeats, "suite": current}, f, indent=1)
+        print("Recorded %d metrics of %d cases in %s" % (sum(len(m) for m in current.values()), len(current),
+                                                         args.baseline))
+        return 0
+
+    with open(args.baseline) as f:
+        baseline = json.load(f)
+    for field in ("host", "hdf5"):
+        if baseline["environment"].get(field) != env[field]:
+            print("Warning: the baseline was recorded with %s %s, this run uses %s" %
+                  (field, baseline["environment"].get(field), env[field]))
+    rows, failures = compare(baseline["suite"], current, args.alpha, thresholds)
+    print_report(rows)
+    print("%d of %d metrics regressed (baseline %s of %s)" % (failures, len(rows), baseline["environment"].get("rev"),
+                                                              baseline["environment"].get("date")))
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,1256 @@
+/*
+ * This program repacks a dataset between the library layouts and the structured chunk layouts (see
+ * structured_chunk.h) into a new file, as the h5repack changes of RFC-HDF5-Tools propose, and reports
+ * the throughput in GB/s.
+ *
+ * The kind of the input dataset is detected: a chunked dataset (dense), a structured chunk dataset
+ * (sparse), a dataset of a variable-length type with its elements in the global heap (VL), or a
+ * structured chunk dataset of a variable-length type (structured VL).  The option -l selects the layout
+ * of the output dataset and with it the conversion:
+ *
+ *  - 1 (structured, default): dense to sparse, the elements that differ from the fill value are the
+ *    defined elements; VL to structured VL, with a section of locations (the offset and the length of each
+ *    element in 8 bytes each) followed by the VL heap section;
+ *  - 0 (library): sparse to dense, the undefined elements get the fill value; structured VL to VL.
+ *
+ * A structured chunk dataset repacked with the structured layout is copied chunk by chunk: a chunk whose
+ * data sections already have the pipeline requested with the option -z is copied directly without
+ * decoding it, only its slack capacity is dropped; the other chunks are decoded and filtered again.
+ *
+ * The repack runs as a pipeline of stages that exchange the chunks through queues:
+ *
+ *  - read: one thread reads the stored chunks with pread at the addresses of the chunk index, or reads
+ *    the elements of a VL dataset chunk by chunk with H5Dread (the library unpacks the global heap);
+ *  - transform and filter: P worker threads (option -p) convert the chunks and apply the filters; the
+ *    chunks that are copied directly bypass this stage;
+ *  - write: one thread writes the chunks with H5Dwrite_chunk, or the VL elements with H5Dwrite.
+ *
+ * The library is not thread-safe: the calls of the stages into the library are serialized with a lock,
+ * and all decoding, encoding and compression runs outside of it.  The number of chunks in flight is
+ * bounded by a pool of Q jobs per worker (option -q).
+ *
+ * The program reports the number of chunks (NC), the chunks copied directly (DC), the bytes read (IB) and
+ * written (OB), the time (T) and the throughput of the input (GBS); for VL datasets the bytes are the
+ * data of the elements and the 16-byte global heap IDs.  The input file is dropped from the page cache
+ * before each of the R repeats (option -r) and the best time is reported.
+ *
+ * To compile the program, please use h5cc.  The -h option lists all the command line options:
+ *
+ *   [-h] [-i --inFile] [-n --nameDset] [-o --outFile] [-l --lLayout] [-z --zDeflate] [-p --pThreads]
+ *   [-q --qDepth] [-r --rRepeats] [-v --Verbose]
+ *
+ * Example: The commands
+ *
+ *           h5cc alloc.c -o alloc
+ *           h5cc -pthread repack.c -o repack
+ *           ./alloc -c 64x64 -g 64x64 -n 1
+ *           ./repack -i alloc_file.h5 -o dense_file.h5 -l 0 -z 1 -p 4
+ *           ./repack -i dense_file.h5 -o sparse_file.h5 -l 1 -p 4
+ *
+ * convert the dataset "sparse" to a dense dataset compressed with deflate, and convert it back.
+ */
+
+#include "hdf5.h"
+#include "structured_chunk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <getopt.h>
+#include <pthread.h>
+
+#define FILE_NAME                       "alloc_file.h5"
+#define DSET_NAME                       "sparse"
+#define OUT_FILE_NAME                   "repack_file.h5"
+#define MAX_THREADS                     256
+#define QUEUE_DEPTH                     4           /* Jobs in flight per worker */
+#define VL_CHUNK                        1024        /* Chunk size of the fastest dimension of contiguous VL datasets */
+#define VL_HEAP_ID_SIZE                 16          /* Size of a global heap ID in the dataset */
+#define VL_LOCATION_SIZE                16          /* Offset and length of an element in the locations section */
+
+/* Kinds of datasets */
+#define KIND_DENSE                      0
+#define KIND_SPARSE                     1
+#define KIND_VL                         2
+#define KIND_STRUCT_VL                  3
+
+typedef struct {
+    char           *in_file;
+    char           *dset_name;
+    char           *out_file;
+    int             layout;          /* 1 for the structured chunk layouts, 0 for the library layouts */
+    int             z;               /* deflate of the data sections: -1 keep, 0 none, 1 deflate */
+    int             threads;
+    int             q;               /* jobs in flight per worker */
+    int             r;               /* number of repeats */
+    int             v;               /* prints progress messages */
+} handler_t;
+
+/* A chunk on its way through the pipeline */
+typedef struct {
+    hsize_t         offset[SC_MAX_RANK];
+    uint8_t        *in;              /* stored input chunk, or the hvl_t elements of a VL chunk */
+    size_t          in_size;
+    size_t          in_max;
+    uint8_t        *out;             /* stored output chunk; allocated by the transform stage */
+    size_t          out_size;
+    hvl_t          *vl;              /* elements of the output VL chunk that point into "heap" */
+    uint8_t        *heap;
+    int             direct;          /* "in" is written as it is */
+    int             skip;            /* nothing to write: no defined elements */
+    int             failed;
+} job_t;
+
+/* Queue of jobs; it is closed when all its producers are done */
+typedef struct {
+    job_t         **items;
+    size_t          cap;
+    size_t          head;
+    size_t          count;
+    int             producers;
+    pthread_mutex_t lock;
+    pthread_cond_t  not_empty;
+} queue_t;
+
+/* State of one repack shared by the stages */
+typedef struct {
+    int             src_kind;
+    int             dst_kind;
+    hid_t           src;
+    hid_t           dst;
+    hid_t           vl_mem_type;     /* memory type of the VL elements */
+    hid_t           chunk_space;     /* memory dataspace of one chunk */
+    int             fd;
+    size_t          nchunks;
+    sc_chunk_loc_t *locs;            /* stored chunks of a dense or structured input */
+    int             rank;
+    hsize_t         dims[SC_MAX_RANK];
+    hsize_t         chunk_dims[SC_MAX_RANK];
+    hsize_t         grid[SC_MAX_RANK];
+    uint64_t        chunk_nelmts;
+    size_t          elmt_size;       /* size of the elements, or of the base type of VL elements */
+    uint8_t        *fill;
+    int             src_deflate;     /* the dense input is compressed with deflate */
+    int             dst_deflate;     /* the dense or VL output is compressed with deflate */
+    unsigned        pipeline;        /* pipeline of the data sections of the structured output */
+    int             keep;            /* keep the pipeline of the structured input chunks */
+    job_t          *jobs;
+    size_t          njobs;
+    queue_t         free_q;
+    queue_t         in_q;
+    queue_t         out_q;
+    long long int   ndirect;
+    long long int   nfailed;
+    long long int   in_bytes;
+    long long int   out_bytes;
+} repack_t;
+
+handler_t       hand;
+pthread_mutex_t h5_lock = PTHREAD_MUTEX_INITIALIZER;   /* serializes the calls into the library */
+
+const char *kind_name[4] = {"dense", "sparse", "VL", "structured VL"};
+
+/*------------------------------------------------------------
+ * Display command line usage
+ *------------------------------------------------------------
+ */
+void
+usage(void)
+{
+    printf("    [-h] [-i --inFile] [-n --nameDset] [-o --outFile] [-l --lLayout] [-z --zDeflate] [-p --pThreads]\n");
+    printf("    [-q --qDepth] [-r --rRepeats] [-v --Verbose]\n");
+    printf("    [-h --help]: this help page\n");
+    printf("    [-i --inFile]: the input file (default %s)\n", FILE_NAME);
+    printf("    [-n --nameDset]: the name of the dataset (default %s)\n", DSET_NAME);
+    printf("    [-o --outFile]: the output file (default %s)\n", OUT_FILE_NAME);
+    printf("    [-l --lLayout]: the layout of the output: structured chunks (1, default) or the library layouts (0)\n");
+    printf("    [-z --zDeflate]: the data of the output is compressed with deflate (1), not compressed (0), or\n");
+    printf("                     structured chunks keep their pipeline (-1, default)\n");
+    printf("    [-p --pThreads]: the number of transform threads (default the number of CPUs)\n");
+    printf("    [-q --qDepth]: the number of chunks in flight per transform thread (default %d)\n", QUEUE_DEPTH);
+    printf("    [-r --rRepeats]: the number of repeats; the best time is reported (default 1)\n");
+    printf("    [-v --Verbose]: Print progress messages(1); default no messages displayed (0) \n");
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Parse command line option
+ *------------------------------------------------------------
+ */
+void
+parse_command_line(int argc, char *argv[])
+{
+    int           opt;
+    struct option long_options[] = {
+                                    {"help", no_argument, NULL, 'h'},
+                                    {"inFile=", required_argument, NULL, 'i'},
+                                    {"nameDset=", required_argument, NULL, 'n'},
+                                    {"outFile=", required_argument, NULL, 'o'},
+                                    {"lLayout=", required_argument, NULL, 'l'},
+                                    {"zDeflate=", required_argument, NULL, 'z'},
+                                    {"pThreads=", required_argument, NULL, 'p'},
+                                    {"qDepth=", required_argument, NULL, 'q'},
+                                    {"rRepeats=", required_argument, NULL, 'r'},
+                                    {"Verbose=", required_argument, NULL, 'v'},
+                                    {NULL, 0, NULL, 0}};
+
+    /* Initialize the command line options */
+    hand.in_file   = FILE_NAME;
+    hand.dset_name = DSET_NAME;
+    hand.out_file  = OUT_FILE_NAME;
+    hand.layout    = 1;
+    hand.z         = -1;
+    hand.threads   = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    hand.q         = QUEUE_DEPTH;
+    hand.r         = 1;
+    hand.v         = 0;
+
+    while ((opt = getopt_long(argc, argv, "hi:n:o:l:z:p:q:r:v:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'h':
+                fprintf(stdout, "Help page:\n");
+                usage();
+
+                exit(0);
+
+                break;
+            case 'i':
+                if (optarg) {
+                    fprintf(stdout, "Input file:\t\t\t\t\t\t%s\n", optarg);
+                    hand.in_file = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'n':
+                if (optarg) {
+                    fprintf(stdout, "Dataset:\t\t\t\t\t\t%s\n", optarg);
+                    hand.dset_name = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'o':
+                if (optarg) {
+                    fprintf(stdout, "Output file:\t\t\t\t\t\t%s\n", optarg);
+                    hand.out_file = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'l':
+                if (optarg) {
+                    hand.layout = atoi(optarg);
+                    if (hand.layout == 1)
+                        fprintf(stdout, "Output layout: \t\t\t\t\t\tstructured chunks\n");
+                    else if (hand.layout == 0)
+                        fprintf(stdout, "Output layout: \t\t\t\t\t\tlibrary\n");
+                    else
+                        fprintf(stdout, "Output layout:\t\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'z':
+                if (optarg) {
+                    hand.z = atoi(optarg);
+                    if (hand.z == 1)
+                        fprintf(stdout, "Deflate: \t\t\t\t\t\ton\n");
+                    else if (hand.z == 0)
+                        fprintf(stdout, "Deflate: \t\t\t\t\t\toff\n");
+                    else if (hand.z == -1)
+                        fprintf(stdout, "Deflate: \t\t\t\t\t\tkeep\n");
+                    else
+                        fprintf(stdout, "Deflate:\t\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'p':
+                if (optarg) {
+                    fprintf(stdout, "Number of transform threads:\t\t\t\t%s\n", optarg);
+                    hand.threads = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'q':
+                if (optarg) {
+                    fprintf(stdout, "Chunks in flight per thread:\t\t\t\t%s\n", optarg);
+                    hand.q = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'r':
+                if (optarg) {
+                    fprintf(stdout, "Number of repeats:\t\t\t\t\t%s\n", optarg);
+                    hand.r = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'v':
+                if (optarg) {
+                    hand.v = atoi(optarg);
+                    if (hand.v == 1)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\ton\n");
+                    else if (hand.v == 0)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Verbose mode:\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case ':':
+                printf("Option needs a value\n");
+                break;
+            case '?':
+                printf("Unknown option: %c\n", optopt);
+                break;
+        }
+    }
+
+    /* optind is for the extra arguments which are not parsed */
+    for (; optind < argc; optind++) {
+        printf("extra arguments not parsed: %s\n", argv[optind]);
+    }
+
+    /* Make sure the command line options are valid */
+    if (hand.layout < 0 || hand.layout > 1) {
+        printf("Output layout can only be 0 or 1 \n");
+        exit(1);
+    }
+
+    if (hand.z < -1 || hand.z > 1) {
+        printf("Deflate flag can only be -1, 0 or 1 \n");
+        exit(1);
+    }
+
+    if (hand.threads < 1 || hand.threads > MAX_THREADS) {
+        printf("The number of threads must be between 1 and %d\n", MAX_THREADS);
+        exit(1);
+    }
+
+    if (hand.q < 1) {
+        printf("The number of chunks in flight must be positive\n");
+        exit(1);
+    }
+
+    if (hand.r < 1) {
+        printf("The number of repeats must be positive\n");
+        exit(1);
+    }
+
+    if (hand.v < 0 || hand.v > 1) {
+        printf("Verbose flag can only be 0 or 1 \n");
+        exit(1);
+    }
+}
+
+/*------------------------------------------------------------
+ * Print the results
+ *------------------------------------------------------------
+ */
+void print_results(const repack_t *rp, double time)
+{
+    printf("\n");
+    printf("Printing the number of chunks (NC), chunks copied directly (DC), chunks that failed (NF),\n");
+    printf("bytes read (IB), bytes written (OB), time in seconds (T) and throughput of the input in GB/s (GBS)\n");
+    printf("\n");
+    printf("        NC         DC         NF         IB         OB          T        GBS\n");
+    printf("\n");
+    printf("%10lli %10lli %10lli %10lli %10lli %10.4f %10.3f \n", (long long int)rp->nchunks, rp->ndirect,
+           rp->nfailed, rp->in_bytes, rp->out_bytes, time,
+           time > 0 ? (double)rp->in_bytes / time / (1024.0 * 1024.0 * 1024.0) : 0.0);
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Elapsed time
+ *------------------------------------------------------------
+ */
+double elapsed(struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*------------------------------------------------------------
+ * Drop the pages of a file from the page cache
+ *------------------------------------------------------------
+ */
+void drop_cache(const char *file_name)
+{
+    int fd;
+
+    if ((fd = open(file_name, O_RDONLY)) < 0)
+        return;
+    fsync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+/*------------------------------------------------------------
+ * Queue of jobs
+ *------------------------------------------------------------
+ */
+void queue_init(queue_t *q, size_t cap, int producers)
+{
+    q->items     = (job_t **)malloc(cap * sizeof(job_t *));
+    q->cap       = cap;
+    q->head      = 0;
+    q->count     = 0;
+    q->producers = producers;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->not_empty, NULL);
+}
+
+void queue_destroy(queue_t *q)
+{
+    free(q->items);
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->not_empty);
+}
+
+/* The queues hold all jobs of the pool, so they never overflow */
+void queue_push(queue_t *q, job_t *job)
+{
+    pthread_mutex_lock(&q->lock);
+    q->items[(q->head + q->count) % q->cap] = job;
+    q->count++;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+}
+
+/* Returns NULL when the queue is empty and all its producers are done */
+job_t *queue_pop(queue_t *q)
+{
+    job_t *job = NULL;
+
+    pthread_mutex_lock(&q->lock);
+    while (q->count == 0 && q->producers > 0)
+        pthread_cond_wait(&q->not_empty, &q->lock);
+    if (q->count > 0) {
+        job     = q->items[q->head];
+        q->head = (q->head + 1) % q->cap;
+        q->count--;
+    }
+    pthread_mutex_unlock(&q->lock);
+
+    return job;
+}
+
+void queue_done(queue_t *q)
+{
+    pthread_mutex_lock(&q->lock);
+    q->producers--;
+    pthread_cond_broadcast(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+}
+
+/*------------------------------------------------------------
+ * Make sure a buffer holds "size" bytes
+ *------------------------------------------------------------
+ */
+int reserve(uint8_t **buf, size_t *max, size_t size)
+{
+    uint8_t *tmp;
+
+    if (size <= *max)
+        return 0;
+    if (NULL == (tmp = (uint8_t *)realloc(*buf, size)))
+        return -1;
+    *buf = tmp;
+    *max = size;
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Read a stored chunk at "addr" of the file
+ *------------------------------------------------------------
+ */
+int read_full(int fd, void *buf, size_t size, haddr_t addr)
+{
+    size_t done = 0;
+
+    while (done < size) {
+        ssize_t n = pread(fd, (uint8_t *)buf + done, size - done, (off_t)(addr + done));
+
+        if (n <= 0)
+            return -1;
+        done += (size_t)n;
+    }
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Select the part of a chunk inside the extent of the dataset
+ * in the file and in the memory dataspace of the chunk
+ *------------------------------------------------------------
+ */
+void select_chunk(const repack_t *rp, const hsize_t *offset, hid_t file_space)
+{
+    hsize_t zero[SC_MAX_RANK] = {0};
+    hsize_t count[SC_MAX_RANK];
+    int     i;
+
+    for (i = 0; i < rp->rank; i++)
+        count[i] = offset[i] + rp->chunk_dims[i] > rp->dims[i] ? rp->dims[i] - offset[i] : rp->chunk_dims[i];
+    H5Sselect_hyperslab(file_space, H5S_SELECT_SET, offset, NULL, count, NULL);
+    H5Sselect_hyperslab(rp->chunk_space, H5S_SELECT_SET, zero, NULL, count, NULL);
+}
+
+/*------------------------------------------------------------
+ * Read stage: reads the chunks into the jobs of the pool and
+ * passes them to the transform stage, or directly to the
+ * write stage when no transformation is needed
+ *------------------------------------------------------------
+ */
+void *read_stage(void *arg)
+{
+    repack_t *rp = (repack_t *)arg;
+    hid_t     file_space = H5I_INVALID_HID;
+    size_t    n;
+    int       i;
+
+    if (rp->src_kind == KIND_VL) {
+        pthread_mutex_lock(&h5_lock);
+        file_space = H5Dget_space(rp->src);
+        pthread_mutex_unlock(&h5_lock);
+    }
+
+    for (n = 0; n < rp->nchunks; n++) {
+        job_t *job = queue_pop(&rp->free_q);
+
+        job->direct = 0;
+        job->skip   = 0;
+        job->failed = 0;
+
+        if (rp->src_kind == KIND_VL) {
+            hvl_t   *elmts;
+            uint64_t e;
+            size_t   rem = n;
+
+            /* The chunks of a VL dataset are visited in the logical order */
+            for (i = rp->rank - 1; i >= 0; i--) {
+                job->offset[i] = (rem % rp->grid[i]) * rp->chunk_dims[i];
+                rem /= rp->grid[i];
+            }
+            job->in_size = rp->chunk_nelmts * sizeof(hvl_t);
+            if (reserve(&job->in, &job->in_max, job->in_size) < 0) {
+                job->failed = 1;
+                queue_push(&rp->out_q, job);
+                continue;
+            }
+            memset(job->in, 0, job->in_size);
+
+            pthread_mutex_lock(&h5_lock);
+            select_chunk(rp, job->offset, file_space);
+            if (H5Dread(rp->src, rp->vl_mem_type, rp->chunk_space, file_space, H5P_DEFAULT, job->in) < 0)
+                job->failed = 1;
+            pthread_mutex_unlock(&h5_lock);
+
+            elmts = (hvl_t *)job->in;
+            for (e = 0; e < rp->chunk_nelmts; e++)
+                rp->in_bytes += (long long int)(elmts[e].len * rp->elmt_size);
+            rp->in_bytes += (long long int)(rp->chunk_nelmts * VL_HEAP_ID_SIZE);
+        }
+        else {
+            sc_chunk_info_t info;
+
+            memcpy(job->offset, rp->locs[n].offset, sizeof(job->offset));
+            job->in_size = (size_t)rp->locs[n].size;
+            if (reserve(&job->in, &job->in_max, job->in_size) < 0 ||
+                read_full(rp->fd, job->in, job->in_size, rp->locs[n].addr) < 0)
+                job->failed = 1;
+            rp->in_bytes += (long long int)job->in_size;
+
+            /* A structured chunk is copied directly if its data sections keep their pipeline */
+            if (!job->failed && rp->src_kind == rp->dst_kind &&
+                sc_disassemble_chunk(job->in, job->in_size, &info, NULL) == 0) {
+                job->direct = 1;
+                for (i = 1; i < (int)info.num_sections; i++)
+                    if (!sc_section_has_checksum(info.type, (unsigned)i) && !rp->keep && info.pipeline[i] != rp->pipeline)
+                        job->direct = 0;
+                if (job->direct)
+                    job->in_size = sc_image_size(&info);
+            }
+        }
+
+        if (job->failed || job->direct) {
+            if (job->direct)
+                rp->ndirect++;
+            queue_push(&rp->out_q, job);
+        }
+        else
+            queue_push(&rp->in_q, job);
+    }
+
+    if (file_space >= 0) {
+        pthread_mutex_lock(&h5_lock);
+        H5Sclose(file_space);
+        pthread_mutex_unlock(&h5_lock);
+    }
+
+    queue_done(&rp->in_q);
+    queue_done(&rp->out_q);
+
+    return NULL;
+}
+
+/*------------------------------------------------------------
+ * Buffers of a transform thread, reused for all its chunks
+ *------------------------------------------------------------
+ */
+typedef struct {
+    uint8_t  *dense;
+    size_t    dense_max;
+    uint8_t  *sections[SC_MAX_SECTIONS];
+    size_t    section_max[SC_MAX_SECTIONS];
+    sc_run_t *runs;
+    size_t    max_runs;
+} scratch_t;
+
+/*------------------------------------------------------------
+ * Transform a dense chunk into a sparse chunk
+ *------------------------------------------------------------
+ */
+int dense_to_sparse(repack_t *rp, job_t *job, scratch_t *s)
+{
+    sc_chunk_info_t info;
+    const void     *buf[2];
+    const uint8_t  *dense = job->in;
+    size_t          size  = rp->chunk_nelmts * rp->elmt_size;
+    size_t          nruns, n;
+    uint64_t        e, nelemts = 0;
+
+    if (rp->src_deflate) {
+        uLongf dense_size = (uLongf)size;
+
+        if (reserve(&s->dense, &s->dense_max, size) < 0 ||
+            uncompress(s->dense, &dense_size, job->in, (uLong)job->in_size) != Z_OK || dense_size != size)
+            return -1;
+        dense = s->dense;
+    }
+    else if (job->in_size != size)
+        return -1;
+
+    /* The mask of the defined elements is kept in the first section buffer */
+    if (reserve(&s->sections[SC_SECTION_SELECTION], &s->section_max[SC_SECTION_SELECTION], rp->chunk_nelmts) < 0)
+        return -1;
+    for (e = 0; e < rp->chunk_nelmts; e++)
+        s->sections[SC_SECTION_SELECTION][e] = memcmp(dense + e * rp->elmt_size, rp->fill, rp->elmt_size) != 0;
+
+    nruns = sc_mask_to_runs(s->sections[SC_SECTION_SELECTION], rp->chunk_nelmts, rp->chunk_dims[rp->rank - 1], NULL);
+    if (nruns == 0) {
+        job->skip = 1;
+        return 0;
+    }
+    if (nruns > s->max_runs) {
+        sc_run_t *tmp;
+
+        if (NULL == (tmp = (sc_run_t *)realloc(s->runs, nruns * sizeof(sc_run_t))))
+            return -1;
+        s->runs     = tmp;
+        s->max_runs = nruns;
+    }
+    sc_mask_to_runs(s->sections[SC_SECTION_SELECTION], rp->chunk_nelmts, rp->chunk_dims[rp->rank - 1], s->runs);
+    for (n = 0; n < nruns; n++)
+        nelemts += s->runs[n].len;
+
+    memset(&info, 0, sizeof(info));
+    info.type                                    = SC_SPARSE_CHUNK;
+    info.num_sections                            = 2;
+    info.nelemts                                 = nelemts;
+    info.pipeline[SC_SECTION_FIXED]              = rp->pipeline;
+    info.section_orig_size[SC_SECTION_SELECTION] = sc_encode_runs(rp->rank, rp->chunk_dims, nruns, s->runs, NULL);
+    info.section_orig_size[SC_SECTION_FIXED]     = nelemts * rp->elmt_size;
+
+    if (reserve(&s->sections[SC_SECTION_SELECTION], &s->section_max[SC_SECTION_SELECTION],
+                info.section_orig_size[SC_SECTION_SELECTION]) < 0 ||
+        reserve(&s->sections[SC_SECTION_FIXED], &s->section_max[SC_SECTION_FIXED],
+                info.section_orig_size[SC_SECTION_FIXED]) < 0)
+        return -1;
+    sc_encode_runs(rp->rank, rp->chunk_dims, nruns, s->runs, s->sections[SC_SECTION_SELECTION]);
+    sc_gather_runs(dense, rp->elmt_size, nruns, s->runs, s->sections[SC_SECTION_FIXED]);
+
+    buf[SC_SECTION_SELECTION] = s->sections[SC_SECTION_SELECTION];
+    buf[SC_SECTION_FIXED]     = s->sections[SC_SECTION_FIXED];
+    return sc_assemble_chunk(&info, buf, 0, &job->out, &job->out_size);
+}
+
+/*------------------------------------------------------------
+ * Decode the sections of a structured chunk into the scratch
+ * buffers
+ *------------------------------------------------------------
+ */
+int decode_chunk(job_t *job, scratch_t *s, sc_chunk_info_t *info)
+{
+    void    *buf[SC_MAX_SECTIONS] = {NULL};
+    unsigned i;
+
+    if (sc_disassemble_chunk(job->in, job->in_size, info, NULL) < 0)
+        return -1;
+    for (i = 0; i < info->num_sections; i++) {
+        if (reserve(&s->sections[i], &s->section_max[i], (size_t)info->section_orig_size[i] + 1) < 0)
+            return -1;
+        buf[i] = s->sections[i];
+    }
+    return sc_disassemble_chunk(job->in, job->in_size, info, buf);
+}
+
+/*------------------------------------------------------------
+ * Transform a sparse chunk into a dense chunk
+ *------------------------------------------------------------
+ */
+int sparse_to_dense(repack_t *rp, job_t *job, scratch_t *s)
+{
+    sc_chunk_info_t info;
+    hsize_t         sel_dims[SC_MAX_RANK];
+    size_t          size = rp->chunk_nelmts * rp->elmt_size;
+    size_t          nruns, n;
+    uint64_t        e;
+    const uint8_t  *src;
+    int             rank;
+
+    if (decode_chunk(job, s, &info) < 0 || !(info.type & SC_SPARSE_CHUNK) || (info.type & SC_VL_CHUNK) ||
+        info.section_orig_size[SC_SECTION_FIXED] != info.nelemts * rp->elmt_size)
+        return -1;
+    if (sc_decode_runs(s->sections[SC_SECTION_SELECTION], (size_t)info.section_orig_size[SC_SECTION_SELECTION],
+                       &rank, sel_dims, &nruns, NULL) < 0)
+        return -1;
+    if (nruns > s->max_runs) {
+        sc_run_t *tmp;
+
+        if (NULL == (tmp = (sc_run_t *)realloc(s->runs, nruns * sizeof(sc_run_t))))
+            return -1;
+        s->runs     = tmp;
+        s->max_runs = nruns;
+    }
+    if (sc_decode_runs(s->sections[SC_SECTION_SELECTION], (size_t)info.section_orig_size[SC_SECTION_SELECTION],
+                       &rank, sel_dims, &nruns, s->runs) < 0)
+        return -1;
+
+    /* Scatter the packed values over the fill value */
+    if (reserve(&s->dense, &s->dense_max, size) < 0)
+        return -1;
+    for (e = 0; e < rp->chunk_nelmts; e++)
+        memcpy(s->dense + e * rp->elmt_size, rp->fill, rp->elmt_size);
+    src = s->sections[SC_SECTION_FIXED];
+    for (n = 0; n < nruns; n++) {
+        if ((s->runs[n].start + s->runs[n].len) > rp->chunk_nelmts)
+            return -1;
+        memcpy(s->dense + s->runs[n].start * rp->elmt_size, src, s->runs[n].len * rp->elmt_size);
+        src += s->runs[n].len * rp->elmt_size;
+    }
+
+    if (rp->dst_deflate) {
+        uLongf comp_size = compressBound((uLong)size);
+
+        if (NULL == (job->out = (uint8_t *)malloc(comp_size)) ||
+            compress2(job->out, &comp_size, s->dense, (uLong)size, SC_DEFLATE_LEVEL) != Z_OK)
+            return -1;
+        job->out_size = comp_size;
+    }
+    else {
+        /* The dense chunk is handed over to the write stage */
+        job->out      = s->dense;
+        job->out_size = size;
+        s->dense      = NULL;
+        s->dense_max  = 0;
+    }
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Transform the elements of a VL chunk into a structured VL
+ * chunk: the locations section followed by the VL heap
+ *------------------------------------------------------------
+ */
+int vl_to_struct(repack_t *rp, job_t *job, scratch_t *s)
+{
+    sc_chunk_info_t info;
+    const void     *buf[2];
+    hvl_t          *elmts = (hvl_t *)job->in;
+    uint64_t        e, heap_size = 0;
+    uint8_t        *p, *heap;
+    int             ret;
+
+    for (e = 0; e < rp->chunk_nelmts; e++)
+        heap_size += elmts[e].len * rp->elmt_size;
+
+    memset(&info, 0, sizeof(info));
+    info.type                 = SC_VL_CHUNK;
+    info.num_sections         = 2;
+    info.nelemts              = rp->chunk_nelmts;
+    info.pipeline[1]          = rp->pipeline;
+    info.section_orig_size[0] = rp->chunk_nelmts * VL_LOCATION_SIZE;
+    info.section_orig_size[1] = heap_size;
+
+    if (reserve(&s->sections[0], &s->section_max[0], (size_t)info.section_orig_size[0]) < 0 ||
+        reserve(&s->sections[1], &s->section_max[1], (size_t)heap_size + 1) < 0)
+        return -1;
+    p    = s->sections[0];
+    heap = s->sections[1];
+    for (e = 0, heap_size = 0; e < rp->chunk_nelmts; e++) {
+        size_t len = elmts[e].len * rp->elmt_size;
+
+        sc_encode64(&p, heap_size);
+        sc_encode64(&p, (uint64_t)elmts[e].len);
+        if (len)
+            memcpy(heap + heap_size, elmts[e].p, len);
+        heap_size += len;
+    }
+
+    /* The elements were allocated by the library */
+    pthread_mutex_lock(&h5_lock);
+    H5Sselect_all(rp->chunk_space);
+    H5Dvlen_reclaim(rp->vl_mem_type, rp->chunk_space, H5P_DEFAULT, job->in);
+    pthread_mutex_unlock(&h5_lock);
+
+    buf[0] = s->sections[0];
+    buf[1] = s->sections[1];
+    ret    = sc_assemble_chunk(&info, buf, 0, &job->out, &job->out_size);
+
+    return ret;
+}
+
+/*------------------------------------------------------------
+ * Transform a structured VL chunk into VL elements that point
+ * into the VL heap of the job
+ *------------------------------------------------------------
+ */
+int struct_to_vl(repack_t *rp, job_t *job, scratch_t *s)
+{
+    sc_chunk_info_t info;
+    const uint8_t  *p;
+    uint64_t        e;
+
+    if (decode_chunk(job, s, &info) < 0 || info.type != SC_VL_CHUNK || info.num_sections != 2 ||
+        info.nelemts != rp->chunk_nelmts || info.section_orig_size[0] != rp->chunk_nelmts * VL_LOCATION_SIZE)
+        return -1;
+
+    if (NULL == (job->vl = (hvl_t *)malloc(rp->chunk_nelmts * sizeof(hvl_t))) ||
+        NULL == (job->heap = (uint8_t *)malloc((size_t)info.section_orig_size[1] + 1)))
+        return -1;
+    memcpy(job->heap, s->sections[1], (size_t)info.section_orig_size[1]);
+
+    p = s->sections[0];
+    for (e = 0; e < rp->chunk_nelmts; e++) {
+        uint64_t offset = sc_decode64(&p);
+        uint64_t len    = sc_decode64(&p);
+
+        if (offset + len * rp->elmt_size > info.section_orig_size[1])
+            return -1;
+        job->vl[e].len = (size_t)len;
+        job->vl[e].p   = job->heap + offset;
+    }
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Transform a structured chunk whose data sections get another
+ * pipeline
+ *------------------------------------------------------------
+ */
+int refilter(repack_t *rp, job_t *job, scratch_t *s)
+{
+    sc_chunk_info_t info;
+    const void     *buf[SC_MAX_SECTIONS];
+    unsigned        i;
+
+    if (decode_chunk(job, s, &info) < 0)
+        return -1;
+    for (i = 0; i < info.num_sections; i++) {
+        buf[i] = s->sections[i];
+        if (i > 0 && !sc_section_has_checksum(info.type, i))
+            info.pipeline[i] = rp->pipeline;
+    }
+    return sc_assemble_chunk(&info, buf, 0, &job->out, &job->out_size);
+}
+
+/*------------------------------------------------------------
+ * Transform stage: converts and filters the chunks
+ *------------------------------------------------------------
+ */
+void *transform_stage(void *arg)
+{
+    repack_t *rp = (repack_t *)arg;
+    scratch_t s;
+    job_t    *job;
+    unsigned  i;
+    int       ret;
+
+    memset(&s, 0, sizeof(s));
+
+    while (NULL != (job = queue_pop(&rp->in_q))) {
+        if (rp->src_kind == KIND_DENSE)
+            ret = dense_to_sparse(rp, job, &s);
+        else if (rp->src_kind == KIND_SPARSE && rp->dst_kind == KIND_DENSE)
+            ret = sparse_to_dense(rp, job, &s);
+        else if (rp->src_kind == KIND_VL)
+            ret = vl_to_struct(rp, job, &s);
+        else if (rp->src_kind == KIND_STRUCT_VL && rp->dst_kind == KIND_VL)
+            ret = struct_to_vl(rp, job, &s);
+        else
+            ret = refilter(rp, job, &s);
+        if (ret < 0)
+            job->failed = 1;
+        queue_push(&rp->out_q, job);
+    }
+
+    free(s.dense);
+    for (i = 0; i < SC_MAX_SECTIONS; i++)
+        free(s.sections[i]);
+    free(s.runs);
+
+    queue_done(&rp->out_q);
+
+    return NULL;
+}
+
+/*------------------------------------------------------------
+ * Write stage: writes the chunks and returns the jobs to the
+ * pool
+ *------------------------------------------------------------
+ */
+void *write_stage(void *arg)
+{
+    repack_t *rp = (repack_t *)arg;
+    hid_t     file_space = H5I_INVALID_HID;
+    job_t    *job;
+
+    if (rp->dst_kind == KIND_VL) {
+        pthread_mutex_lock(&h5_lock);
+        file_space = H5Dget_space(rp->dst);
+        pthread_mutex_unlock(&h5_lock);
+    }
+
+    while (NULL != (job = queue_pop(&rp->out_q))) {
+        if (job->failed)
+            rp->nfailed++;
+        else if (!job->skip) {
+            pthread_mutex_lock(&h5_lock);
+            if (rp->dst_kind == KIND_VL) {
+                select_chunk(rp, job->offset, file_space);
+                if (H5Dwrite(rp->dst, rp->vl_mem_type, rp->chunk_space, file_space, H5P_DEFAULT, job->vl) < 0)
+                    rp->nfailed++;
+            }
+            else if (H5Dwrite_chunk(rp->dst, H5P_DEFAULT, 0, job->offset, job->direct ? job->in_size : job->out_size,
+                                    job->direct ? job->in : job->out) < 0)
+                rp->nfailed++;
+            pthread_mutex_unlock(&h5_lock);
+
+            if (rp->dst_kind == KIND_VL) {
+                hvl_t   *elmts = job->vl;
+                uint64_t e;
+
+                for (e = 0; e < rp->chunk_nelmts; e++)
+                    rp->out_bytes += (long long int)(elmts[e].len * rp->elmt_size);
+                rp->out_bytes += (long long int)(rp->chunk_nelmts * VL_HEAP_ID_SIZE);
+            }
+            else
+                rp->out_bytes += (long long int)(job->direct ? job->in_size : job->out_size);
+        }
+
+        free(job->out);
+        free(job->vl);
+        free(job->heap);
+        job->out  = NULL;
+        job->vl   = NULL;
+        job->heap = NULL;
+        queue_push(&rp->free_q, job);
+    }
+
+    if (file_space >= 0) {
+        pthread_mutex_lock(&h5_lock);
+        H5Sclose(file_space);
+        pthread_mutex_unlock(&h5_lock);
+    }
+
+    return NULL;
+}
+
+/*------------------------------------------------------------
+ * Check if a dataset uses the structured chunk emulation
+ *------------------------------------------------------------
+ */
+int is_structured(hid_t dcpl)
+{
+    int n, i;
+
+    if (H5Pget_layout(dcpl) != H5D_CHUNKED)
+        return 0;
+    n = H5Pget_nfilters(dcpl);
+    for (i = 0; i < n; i++) {
+        unsigned flags, filter_config;
+        size_t   cd_nelmts = 0;
+
+        if (H5Pget_filter2(dcpl, (unsigned)i, &flags, &cd_nelmts, NULL, 0, NULL, &filter_config) == SC_FILTER_ID)
+            return 1;
+    }
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Get the filters of a dense dataset: none or deflate only
+ *------------------------------------------------------------
+ */
+int get_deflate(hid_t dcpl)
+{
+    int n = H5Pget_nfilters(dcpl);
+
+    if (n == 0)
+        return 0;
+    if (n == 1) {
+        unsigned flags, filter_config;
+        size_t   cd_nelmts = 0;
+
+        if (H5Pget_filter2(dcpl, 0, &flags, &cd_nelmts, NULL, 0, NULL, &filter_config) == H5Z_FILTER_DEFLATE)
+            return 1;
+    }
+    return -1;
+}
+
+/*------------------------------------------------------------
+ * Repack the dataset into a new file
+ *------------------------------------------------------------
+ */
+int repack(repack_t *rp, double *time)
+{
+    struct timespec start;
+    pthread_t       threads[MAX_THREADS + 2];
+    hid_t           in_file = H5I_INVALID_HID, out_file = H5I_INVALID_HID;
+    hid_t           src_dcpl = H5I_INVALID_HID, dst_dcpl = H5I_INVALID_HID;
+    hid_t           dtype = H5I_INVALID_HID, space = H5I_INVALID_HID;
+    hsize_t         maxdims[SC_MAX_RANK];
+    int             vl, structured, deflate, i;
+    size_t          n;
+    int             ret = -1;
+
+    memset(rp, 0, sizeof(*rp));
+    rp->fd          = -1;
+    rp->vl_mem_type = H5I_INVALID_HID;
+    rp->chunk_space = H5I_INVALID_HID;
+    rp->dst         = H5I_INVALID_HID;
+
+    drop_cache(hand.in_file);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if ((in_file = H5Fopen(hand.in_file, H5F_ACC_RDONLY, H5P_DEFAULT)) < 0 ||
+        (rp->src = H5Dopen2(in_file, hand.dset_name, H5P_DEFAULT)) < 0) {
+        printf("Failed to open the dataset %s of %s\n", hand.dset_name, hand.in_file);
+        goto done;
+    }
+    src_dcpl = H5Dget_create_plist(rp->src);
+    dtype    = H5Dget_type(rp->src);
+    space    = H5Dget_space(rp->src);
+    rp->rank = H5Sget_simple_extent_dims(space, rp->dims, maxdims);
+
+    /* Kinds of the input and the output */
+    vl         = H5Tget_class(dtype) == H5T_VLEN;
+    structured = is_structured(src_dcpl);
+    if (vl)
+        rp->src_kind = structured ? KIND_STRUCT_VL : KIND_VL;
+    else
+        rp->src_kind = structured ? KIND_SPARSE : KIND_DENSE;
+    if (vl)
+        rp->dst_kind = hand.layout ? KIND_STRUCT_VL : KIND_VL;
+    else
+        rp->dst_kind = hand.layout ? KIND_SPARSE : KIND_DENSE;
+    if (hand.v)
+        printf("Repacking the %s dataset %s into a %s dataset\n", kind_name[rp->src_kind], hand.dset_name,
+               kind_name[rp->dst_kind]);
+
+    if (rp->src_kind == rp->dst_kind && !structured) {
+        printf("The dataset %s already has the library layout; please use h5repack\n", hand.dset_name);
+        goto done;
+    }
+    if (rp->rank < 1 || rp->rank > SC_MAX_RANK) {
+        printf("The rank of the dataset must be between 1 and %d\n", SC_MAX_RANK);
+        goto done;
+    }
+    if (H5Pget_layout(src_dcpl) == H5D_CHUNKED)
+        H5Pget_chunk(src_dcpl, rp->rank, rp->chunk_dims);
+    else if (rp->src_kind == KIND_VL) {
+        for (i = 0; i < rp->rank; i++)
+            rp->chunk_dims[i] = 1;
+        rp->chunk_dims[rp->rank - 1] = rp->dims[rp->rank - 1] < VL_CHUNK ? rp->dims[rp->rank - 1] : VL_CHUNK;
+    }
+    else {
+        printf("The dataset %s must be chunked\n", hand.dset_name);
+        goto done;
+    }
+    if (rp->src_kind == KIND_DENSE && (rp->src_deflate = get_deflate(src_dcpl)) < 0) {
+        printf("Only dense datasets without filters or with deflate are supported\n");
+        goto done;
+    }
+
+    rp->chunk_nelmts = 1;
+    for (i = 0; i < rp->rank; i++) {
+        if (rp->dims[i] == 0 || rp->chunk_dims[i] == 0) {
+            printf("The dataset %s is empty\n", hand.dset_name);
+            goto done;
+        }
+        rp->grid[i] = (rp->dims[i] + rp->chunk_dims[i] - 1) / rp->chunk_dims[i];
+        rp->chunk_nelmts *= rp->chunk_dims[i];
+    }
+    rp->chunk_space = H5Screate_simple(rp->rank, rp->chunk_dims, NULL);
+
+    if (vl) {
+        hid_t super = H5Tget_super(dtype);
+        hid_t base  = H5Tget_native_type(super, H5T_DIR_ASCEND);
+
+        rp->elmt_size   = H5Tget_size(base);
+        rp->vl_mem_type = H5Tvlen_create(base);
+        H5Tclose(base);
+        H5Tclose(super);
+    }
+    else {
+        rp->elmt_size = H5Tget_size(dtype);
+        rp->fill      = (uint8_t *)calloc(1, rp->elmt_size);
+        H5Pget_fill_value(src_dcpl, dtype, rp->fill);
+    }
+
+    /* Pipeline of the output */
+    deflate          = hand.z == 1;
+    rp->keep         = hand.z == -1 && structured;
+    rp->pipeline     = deflate ? SC_PIPELINE_DEFLATE : SC_PIPELINE_NONE;
+    rp->dst_deflate  = deflate && !hand.layout;
+
+    /* The output dataset has the dataspace, the datatype and the attributes of the input */
+    if ((out_file = H5Fcreate(hand.out_file, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT)) < 0) {
+        printf("Failed to create %s\n", hand.out_file);
+        goto done;
+    }
+    if (hand.layout)
+        dst_dcpl = sc_create_dcpl(rp->rank, rp->chunk_dims);
+    else {
+        dst_dcpl = H5Pcreate(H5P_DATASET_CREATE);
+        H5Pset_chunk(dst_dcpl, rp->rank, rp->chunk_dims);
+        if (rp->dst_deflate)
+            H5Pset_deflate(dst_dcpl, SC_DEFLATE_LEVEL);
+    }
+    if (!vl)
+        H5Pset_fill_value(dst_dcpl, dtype, rp->fill);
+    if ((rp->dst = H5Dcreate2(out_file, hand.dset_name, dtype, space, H5P_DEFAULT, dst_dcpl, H5P_DEFAULT)) < 0 ||
+        H5Aiterate2(rp->src, H5_INDEX_NAME, H5_ITER_INC, NULL, sc_copy_attribute, &rp->dst) < 0) {
+        printf("Failed to create the dataset %s in %s\n", hand.dset_name, hand.out_file);
+        goto done;
+    }
+
+    /* Chunks to read */
+    if (rp->src_kind == KIND_VL) {
+        rp->nchunks = 1;
+        for (i = 0; i < rp->rank; i++)
+            rp->nchunks *= rp->grid[i];
+    }
+    else {
+        if (sc_get_chunk_locations(rp->src, &rp->nchunks, &rp->locs) < 0) {
+            printf("Failed to get the chunks of %s\n", hand.dset_name);
+            goto done;
+        }
+        if ((rp->fd = open(hand.in_file, O_RDONLY)) < 0) {
+            printf("Failed to open %s\n", hand.in_file);
+            goto done;
+        }
+    }
+
+    /* Pool of jobs; the queues can hold all of them.  The write stage returns the jobs to the pool. */
+    rp->njobs = (size_t)hand.threads * (size_t)hand.q;
+    rp->jobs  = (job_t *)calloc(rp->njobs, sizeof(job_t));
+    queue_init(&rp->free_q, rp->njobs, 1);
+    queue_init(&rp->in_q, rp->njobs, 1);
+    queue_init(&rp->out_q, rp->njobs, 1 + hand.threads);
+    for (n = 0; n < rp->njobs; n++)
+        queue_push(&rp->free_q, &rp->jobs[n]);
+
+    if (hand.v)
+        printf("Repacking %zu chunks with %d transform threads\n", rp->nchunks, hand.threads);
+    pthread_create(&threads[0], NULL, read_stage, rp);
+    for (i = 0; i < hand.threads; i++)
+        pthread_create(&threads[1 + i], NULL, transform_stage, rp);
+    pthread_create(&threads[1 + hand.threads], NULL, write_stage, rp);
+    for (i = 0; i < hand.threads + 2; i++)
+        pthread_join(threads[i], NULL);
+
+    H5Dclose(rp->dst);
+    rp->dst = H5I_INVALID_HID;
+    H5Fclose(out_file);
+    out_file = H5I_INVALID_HID;
+    *time    = elapsed(&start);
+
+    ret = rp->nfailed ? -1 : 0;
+    if (rp->nfailed)
+        printf("Failed to repack %lli chunks\n", rp->nfailed);
+
+    for (n = 0; n < rp->njobs; n++)
+        free(rp->jobs[n].in);
+    free(rp->jobs);
+    queue_destroy(&rp->free_q);
+    queue_destroy(&rp->in_q);
+    queue_destroy(&rp->out_q);
+
+done:
+    if (rp->fd >= 0)
+        close(rp->fd);
+    free(rp->locs);
+    free(rp->fill);
+    if (rp->dst >= 0)
+        H5Dclose(rp->dst);
+    if (out_file >= 0)
+        H5Fclose(out_file);
+    if (rp->chunk_space >= 0)
+        H5Sclose(rp->chunk_space);
+    if (rp->vl_mem_type >= 0)
+        H5Tclose(rp->vl_mem_type);
+    if (dst_dcpl >= 0)
+        H5Pclose(dst_dcpl);
+    if (space >= 0)
+        H5Sclose(space);
+    if (dtype >= 0)
+        H5Tclose(dtype);
+    if (src_dcpl >= 0)
+        H5Pclose(src_dcpl);
+    if (rp->src > 0)
+        H5Dclose(rp->src);
+    if (in_file >= 0)
+        H5Fclose(in_file);
+
+    return ret;
+}
+
+/*------------------------------------------------------------
+ * Main function
+ *------------------------------------------------------------
+ */
+int
+main(int argc, char **argv)
+{
+    repack_t rp, best;
+    double   time, best_time = 0;
+    int      r;
+
+    parse_command_line(argc, argv);
+
+    for (r = 0; r < hand.r; r++) {
+        if (repack(&rp, &time) < 0)
+            return 1;
+        if (r == 0 || time < best_time) {
+            best      = rp;
+            best_time = time;
+        }
+    }
+
+    print_results(&best, best_time);
+
+    if (hand.v) printf("Done! \n");
+
+    return 0;
+}
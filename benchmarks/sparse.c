@@ -22,15 +22,65 @@
  *  2 - random placed rectangular in the entire chunk
  *  3 - randomly placed continuous locations in each row
  *
+ * The selection of the defined elements is also stored with a jittered-stride codec in the datasets
+ * "selection_jitter" and "selection_jitter_comp".  The locations of type 1 are quasi-regular: the j-th
+ * point of every row lies in the j-th window of 100/X elements, which H5Sencode stores as a list of
+ * single-element blocks (8 bytes per point for a 2-dim selection).  The codec detects selections with
+ * the same number of points K in every row and stores a base B, a stride S and, for each point, its
+ * jitter p - B - j*S bit-packed with the fewest bits that hold the largest jitter (log2(100/X) bits
+ * per point for type 1).  Other selections, and selections that H5Sencode stores in fewer bytes (e.g.
+ * the runs of type 3), are stored as a flag byte followed by the H5Sencode encoding.  The encoding is
+ * decoded back and compared with the selection.
+ *
  * The values of the defined elements of the sparse array are generated based on a command line option -d:
  *
  *  1 - default; the program will generate and initialize data with random values between 1 and UCHAR_MAX
  *  0 - the program will initialize data with the sequences 1,2,...,N, where N =< UCHAR_MAX making it
  *      compressible
  *
+ * The program prints the storage sizes and the time to build the selection and to write the datasets for
+ * each percentage.  With a command line option -j the results are also appended to the given file as JSON
+ * lines, one object per percentage with the parameters, sizes, timings and the environment (host, HDF5
+ * version and date), for the sweep driver sweep.py and other scripts.
+ *
+ * With a command line option -p 1 the program reads the hardware performance counters of the CPU with
+ * perf_event_open (cycles, instructions, cache misses and branch misses, and the page faults) around the
+ * hot loops of each percentage:
+ *
+ *  select  - construction of the hyperslab selection (create_hyperslab)
+ *  encode  - H5Sencode of the selection
+ *  decode  - H5Sdecode of the encoded selection
+ *  scatter - H5Dwrite of the defined elements from a 1-dim buffer into the selection of the chunk,
+ *            including the write of the chunk to the file
+ *  gather  - H5Dread of the defined elements of the chunk into a 1-dim buffer, including the read
+ *            of the chunk (from the chunk cache of the library)
+ *  deflate - compression of the defined data with deflate level 9 (compress2)
+ *
+ * and reports them per defined element with the instructions per cycle (IPC): a low IPC with many cache
+ * misses points to a memory-bound loop, a high IPC to a compute-bound one.  The decode, gather and deflate
+ * phases only run with -p 1, after the timed writes of each percentage.  Counters that the kernel or
+ * the machine do not provide (e.g. in a virtual machine without a PMU, or with kernel.perf_event_paranoid
+ * > 2) are reported as n/a.
+ *
+ * With a command line option -a 1 the program reports the memory used by the phases of each percentage:
+ *
+ *  select  - construction of the hyperslab selection (create_hyperslab)
+ *  encode  - H5Sencode of the selection
+ *  write   - H5Dwrite of the defined data as a 1-dim dataset (structured storage)
+ *  read    - H5Dread of the defined data and of the encoded selection, and H5Sdecode (structured storage)
+ *  scatter - H5Dread of the defined elements into a dense buffer of the chunk (dense in-memory storage)
+ *
+ * The allocations of the program and of the HDF5 library are counted by interposing malloc, calloc,
+ * realloc, free and the aligned allocations of the C library; the peak RSS of each phase is sampled from
+ * VmHWM after resetting it through /proc/self/clear_refs.  The peak of allocated bytes and the peak RSS
+ * growth are reported per defined element.  The read and scatter phases only run with -a 1.  The
+ * interposer relies on glibc and is only built with -DSC_COUNT_ALLOC (h5cc -DSC_COUNT_ALLOC sparse.c),
+ * which -a 1 requires; it counts all the blocks from the start of the program.
+ *
  * To compile the program, please use h5cc.  The -h option lists all the command line options:
  *
- *   [-h] [-c --dimsChunk] [-m --mPercent] [-s --spaceSelect] [-d --dRandom] [-v --Verbose]
+ *   [-h] [-c --dimsChunk] [-m --mPercent] [-s --spaceSelect] [-d --dRandom] [-j --jsonFile] [-p --pCounters]
+ *   [-a --aMemory] [-v --Verbose]
  * 
  * Example: The commands
  *
@@ -48,6 +98,8 @@
  *	 dataset    /percent_1/data_comp
  *	 dataset    /percent_1/selection
  *	 dataset    /percent_1/selection_comp
+ *	 dataset    /percent_1/selection_jitter
+ *	 dataset    /percent_1/selection_jitter_comp
  *	 dataset    /percent_1/sparse
  *	 dataset    /percent_1/sparse_comp
  *	 group      /percent_2
@@ -55,6 +107,8 @@
  *	 dataset    /percent_2/data_comp
  *	 dataset    /percent_2/selection
  *	 dataset    /percent_2/selection_comp
+ *	 dataset    /percent_2/selection_jitter
+ *	 dataset    /percent_2/selection_jitter_comp
  *	 dataset    /percent_2/sparse
  *	 dataset    /percent_2/sparse_comp
  *	 group      /percent_3
@@ -62,6 +116,8 @@
  *	 dataset    /percent_3/data_comp
  *	 dataset    /percent_3/selection
  *	 dataset    /percent_3/selection_comp
+ *	 dataset    /percent_3/selection_jitter
+ *	 dataset    /percent_3/selection_jitter_comp
  *	 dataset    /percent_3/sparse
  *	 dataset    /percent_3/sparse_comp
  *	 }
@@ -81,6 +137,13 @@
 #include <math.h>
 #include <string.h>
 #include <getopt.h>
+#include <unistd.h>
+#include <errno.h>
+#include <malloc.h>
+#include <zlib.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
 
 #define FILE_NAME                 	"sparse_file"
 #define DSET_NAME	            	"sparse"
@@ -89,12 +152,38 @@
 #define DATA_DSET_COMPRESSED_NAME	"data_comp"
 #define SELECTION_DSET_NAME         	"selection"
 #define SELECTION_DSET_COMPRESSED_NAME	"selection_comp"
+#define JITTER_DSET_NAME                "selection_jitter"
+#define JITTER_DSET_COMPRESSED_NAME     "selection_jitter_comp"
 #define GROUP_NAME                	"percent_"
 #define GROUP_NUM                 	10
 #define CHUNK_DIM1     			10
 #define CHUNK_DIM2     			100
 #define RANK           			2
 #define MAX_PERCENT                     20
+#define NCOUNTERS                       5
+
+/* Formats of the jittered-stride selection codec */
+#define JITTER_FORMAT_H5S               0           /* A flag byte followed by the H5Sencode encoding */
+#define JITTER_FORMAT_STRIDE            1           /* Base, stride and bit-packed jitter of each point */
+#define JITTER_HEADER_SIZE              22
+#define JITTER_MAX_STRIDE_TRIES         5           /* Strides tried around the mean distance of the points */
+
+/* Phases measured with the performance counters */
+#define PHASE_SELECT                    0
+#define PHASE_ENCODE                    1
+#define PHASE_DECODE                    2
+#define PHASE_SCATTER                   3
+#define PHASE_GATHER                    4
+#define PHASE_DEFLATE                   5
+#define NPHASES                         6
+
+/* Phases measured with the allocation accounting */
+#define MEM_SELECT                      0
+#define MEM_ENCODE                      1
+#define MEM_WRITE                       2
+#define MEM_READ                        3
+#define MEM_SCATTER                     4
+#define MEM_NPHASES                     5
 
 typedef struct {
     long long int   chunk_dim1;
@@ -102,9 +191,24 @@ typedef struct {
     int             space_select;
     int             max_percent;
     int             d;               /* flag to generate random or compressible data values */
+    char           *json_file;       /* file to append the results to as JSON lines */
+    int             p;               /* reads the performance counters */
+    int             a;               /* reports the memory of the phases */
     int             v;               /* prints progress messages */
 } handler_t;
 
+typedef struct {
+    long long int   count[NCOUNTERS]; /* counter values; -1 if the counter is not available */
+    double          time;
+} perf_t;
+
+typedef struct {
+    long long int   peak;            /* peak of the allocated bytes above the start of the phase */
+    long long int   allocated;       /* bytes allocated */
+    long long int   nallocs;         /* number of allocations */
+    long long int   rss;             /* growth of the peak RSS */
+} mem_t;
+
 typedef struct {
     long long int   sparse;          /* size of sparse dataset */
     long long int   sparse_comp;     /* size of compressed sparse data set */
@@ -112,10 +216,229 @@ typedef struct {
     long long int   data_comp;       /* size of comporessed dataste with raw data */
     long long int   sel;             /* size of dataset with encoded selection */
     long long int   sel_comp;        /* size of compressed dataste with encoded selection */
+    long long int   jit;             /* size of dataset with the jittered-stride encoded selection */
+    long long int   jit_comp;        /* size of compressed dataset with the jittered-stride encoded selection */
+    int             jit_format;      /* format chosen by the jittered-stride codec */
+    unsigned        jit_bits;        /* bits of the jitter of each point */
+    double          t_jit_encode;    /* time of the jittered-stride encoding */
+    double          t_jit_decode;    /* time of the jittered-stride decoding */
+    long long int   nelemts;         /* number of defined elements */
+    double          t_select;        /* time to build the hyperslab selection */
+    double          t_sparse;        /* time to write the sparse datasets */
+    double          t_encode;        /* time to encode and write the selection */
+    double          t_data;          /* time to write the defined data */
+    perf_t          perf[NPHASES];   /* performance counters of the phases */
+    mem_t           mem[MEM_NPHASES]; /* memory of the phases */
 } storage_t;
 
 handler_t    hand;
 storage_t    st[MAX_PERCENT];
+
+const char  *phase_names[NPHASES]  = {"select", "encode", "decode", "scatter", "gather", "deflate"};
+const char  *counter_names[NCOUNTERS] = {"cycles", "instructions", "cache_misses", "branch_misses", "page_faults"};
+const char  *mem_phase_names[MEM_NPHASES] = {"select", "encode", "write", "read", "scatter"};
+int          perf_fd[NCOUNTERS];
+struct timespec perf_start_time;
+
+/*------------------------------------------------------------
+ * Allocation accounting: when compiled with -DSC_COUNT_ALLOC
+ * on glibc, the program interposes the allocator of the C
+ * library for itself and the HDF5 library, and counts the
+ * usable sizes of all the blocks from the start of the
+ * program, so that a block is only subtracted when it is
+ * freed if it was added when it was allocated
+ *------------------------------------------------------------
+ */
+#if defined(SC_COUNT_ALLOC) && defined(__GLIBC__)
+#define MEM_COUNT_ALLOC                 1
+#else
+#define MEM_COUNT_ALLOC                 0
+#endif
+
+long long int mem_current;           /* bytes allocated now */
+long long int mem_peak;              /* peak of mem_current since the last reset */
+long long int mem_allocated;         /* bytes allocated in total */
+long long int mem_nallocs;           /* number of allocations */
+long long int mem_start_bytes, mem_start_alloc, mem_start_count, mem_rss_start;
+
+#if MEM_COUNT_ALLOC
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void *__libc_valloc(size_t size);
+extern void *__libc_pvalloc(size_t size);
+extern void  __libc_free(void *ptr);
+
+void mem_add(void *ptr)
+{
+    long long int size = (long long int)malloc_usable_size(ptr);
+    long long int cur  = __sync_add_and_fetch(&mem_current, size);
+    long long int peak;
+
+    __sync_fetch_and_add(&mem_allocated, size);
+    __sync_fetch_and_add(&mem_nallocs, 1);
+    while (cur > (peak = mem_peak) && !__sync_bool_compare_and_swap(&mem_peak, peak, cur))
+        ;
+}
+
+void mem_sub(void *ptr)
+{
+    __sync_fetch_and_sub(&mem_current, (long long int)malloc_usable_size(ptr));
+}
+
+void *malloc(size_t size)
+{
+    void *ptr = __libc_malloc(size);
+
+    if (ptr)
+        mem_add(ptr);
+    return ptr;
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    void *ptr = __libc_calloc(nmemb, size);
+
+    if (ptr)
+        mem_add(ptr);
+    return ptr;
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    void *new_ptr;
+
+    if (ptr)
+        mem_sub(ptr);
+    new_ptr = __libc_realloc(ptr, size);
+    if (new_ptr)
+        mem_add(new_ptr);
+    else if (ptr && size)
+        mem_add(ptr);
+    return new_ptr;
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+    void *mem;
+
+    /* The alignment must be a power of two multiple of sizeof(void *) */
+    if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0 || alignment == 0)
+        return EINVAL;
+    if (NULL == (mem = __libc_memalign(alignment, size)))
+        return ENOMEM;
+    mem_add(mem);
+    *ptr = mem;
+    return 0;
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    void *ptr = __libc_memalign(alignment, size);
+
+    if (ptr)
+        mem_add(ptr);
+    return ptr;
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    void *ptr = __libc_memalign(alignment, size);
+
+    if (ptr)
+        mem_add(ptr);
+    return ptr;
+}
+
+void *valloc(size_t size)
+{
+    void *ptr = __libc_valloc(size);
+
+    if (ptr)
+        mem_add(ptr);
+    return ptr;
+}
+
+void *pvalloc(size_t size)
+{
+    void *ptr = __libc_pvalloc(size);
+
+    if (ptr)
+        mem_add(ptr);
+    return ptr;
+}
+
+void free(void *ptr)
+{
+    if (ptr) {
+        mem_sub(ptr);
+        __libc_free(ptr);
+    }
+}
+#endif
+
+/*------------------------------------------------------------
+ * Read a field of /proc/self/status in bytes
+ *------------------------------------------------------------
+ */
+long long int proc_status(const char *field)
+{
+    char          line[256];
+    long long int kb = 0;
+    size_t        len = strlen(field);
+    FILE         *f;
+
+    if (NULL == (f = fopen("/proc/self/status", "r")))
+        return 0;
+    while (fgets(line, sizeof(line), f))
+        if (!strncmp(line, field, len) && line[len] == ':') {
+            kb = atoll(line + len + 1);
+            break;
+        }
+    fclose(f);
+    return kb * 1024;
+}
+
+/*------------------------------------------------------------
+ * Start measuring the memory of a phase: resets the peak of
+ * the allocations and the peak RSS (VmHWM) of the process
+ *------------------------------------------------------------
+ */
+void mem_start(void)
+{
+    FILE *f;
+
+    if (!hand.a)
+        return;
+
+    /* Writing 5 to clear_refs resets VmHWM to the current RSS (Linux 4.0 and later) */
+    if (NULL != (f = fopen("/proc/self/clear_refs", "w"))) {
+        fputs("5", f);
+        fclose(f);
+    }
+    mem_rss_start   = proc_status("VmRSS");
+    mem_start_bytes = mem_current;
+    mem_start_alloc = mem_allocated;
+    mem_start_count = mem_nallocs;
+    mem_peak        = mem_current;
+}
+
+/* Stop measuring a phase and add its memory to "m" */
+void mem_stop(mem_t *m)
+{
+    long long int rss;
+
+    if (!hand.a)
+        return;
+
+    /* The counters are read before /proc is opened, which allocates */
+    m->peak      += mem_peak - mem_start_bytes;
+    m->allocated += mem_allocated - mem_start_alloc;
+    m->nallocs   += mem_nallocs - mem_start_count;
+    rss           = proc_status("VmHWM") - mem_rss_start;
+    m->rss       += rss > 0 ? rss : 0;
+}
   
 
 /*------------------------------------------------------------
@@ -125,7 +448,8 @@ storage_t    st[MAX_PERCENT];
 void
 usage(void)
 {
-    printf("    [-h] [-c --dimsChunk] [-m --mPercent] [-s --spaceSelect] [-d --dRandom] \n");
+    printf("    [-h] [-c --dimsChunk] [-m --mPercent] [-s --spaceSelect] [-d --dRandom] [-j --jsonFile] [-p --pCounters]\n");
+    printf("    [-a --aMemory] [-v --Verbose]\n");
     printf("    [-h --help]: this help page\n");
     printf("    [-c --dimsChunk]: the 2D dimensions of the chunks in KB. e.g. 10x20 means the chunk size is 10KB X 20KB.\n");
     printf("    [-m --mPercent]: the maximal percentage of data density, e.g., a value of 5 means the data density will be from 1 to 5 percent.\n");
@@ -134,6 +458,9 @@ usage(void)
     printf("	    The other option is an rectangular-shaped selection randomly positioned in the chunk (value 2).\n");
     printf("	    The third option is continuous points in each row with random position (value 3)\n");
     printf("    [-d --dRandom]: Use random data values (1) or compressible data values (0) \n");
+    printf("    [-j --jsonFile]: append the results to this file as JSON lines (default none)\n");
+    printf("    [-p --pCounters]: read the performance counters around the hot loops (1); default no counters (0)\n");
+    printf("    [-a --aMemory]: report the allocations and the peak RSS of the phases (1), needs -DSC_COUNT_ALLOC; default no report (0)\n");
     printf("    [-v --Verbose]: Print progress messages(1); default no messages displayed (0) \n");
     printf("\n");
 }
@@ -152,6 +479,9 @@ parse_command_line(int argc, char *argv[])
                                     {"mPercent=", required_argument, NULL, 'm'},
                                     {"spaceSelect=", required_argument, NULL, 's'},
                                     {"dRandom=", required_argument, NULL, 'd'},
+                                    {"jsonFile=", required_argument, NULL, 'j'},
+                                    {"pCounters=", required_argument, NULL, 'p'},
+                                    {"aMemory=", required_argument, NULL, 'a'},
                                     {"Verbose=", required_argument, NULL, 'v'},
                                     {NULL, 0, NULL, 0}};
 
@@ -161,9 +491,12 @@ parse_command_line(int argc, char *argv[])
     hand.space_select             = 1;
     hand.max_percent              = GROUP_NUM;
     hand.d                        = 1;
+    hand.json_file                = NULL;
+    hand.p                        = 0;
+    hand.a                        = 0;
     hand.v                        = 0;
 
-    while ((opt = getopt_long(argc, argv, "c:hm:s:d:v:", long_options, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "c:hm:s:d:j:p:a:v:", long_options, NULL)) != -1) {
         switch (opt) {
             case 'c':
                 /* The dimensions of the chunks */
@@ -231,6 +564,43 @@ parse_command_line(int argc, char *argv[])
                 else
                     printf("optarg is null\n");
                 break;
+           case 'j':
+                /* The file for the results as JSON lines */
+                if (optarg) {
+                    fprintf(stdout, "JSON results file:\t\t\t\t\t%s\n", optarg);
+                    hand.json_file = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+           case 'p':
+                /* The performance counters */
+                if (optarg) {
+                    hand.p = atoi(optarg);
+                    if (hand.p == 1)
+                        fprintf(stdout, "Performance counters: \t\t\t\t\ton\n");
+                    else if (hand.p == 0)
+                        fprintf(stdout, "Performance counters: \t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Performance counters:\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+           case 'a':
+                /* The memory accounting */
+                if (optarg) {
+                    hand.a = atoi(optarg);
+                    if (hand.a == 1)
+                        fprintf(stdout, "Memory accounting: \t\t\t\t\ton\n");
+                    else if (hand.a == 0)
+                        fprintf(stdout, "Memory accounting: \t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Memory accounting:\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
            case 'v':
                 /* The options of data space selection */
                 if (optarg) {
@@ -275,11 +645,86 @@ parse_command_line(int argc, char *argv[])
         exit(1);
     }
     
+    if (hand.p < 0 || hand.p > 1) {
+        printf("Performance counters flag can only be 0 or 1 \n");
+        exit(1);
+    }
+
+    if (hand.a < 0 || hand.a > 1) {
+        printf("Memory accounting flag can only be 0 or 1 \n");
+        exit(1);
+    }
+
+    if (hand.a && !MEM_COUNT_ALLOC) {
+        printf("Memory accounting needs the program compiled with -DSC_COUNT_ALLOC on glibc \n");
+        exit(1);
+    }
+
     if (hand.v < 0 || hand.v > 1) {
         printf("Verbose flag can only be 0 or 1 \n");
         exit(1);
     }
 }
+/*------------------------------------------------------------
+ * Print the performance counters of the phases
+ *------------------------------------------------------------
+ */
+void print_counters(int index)
+{
+   int i;
+
+   printf("Printing percentage, phase, cycles (CYC), instructions (INS), cache misses (CM), branch misses (BM), page faults (PF)\n");
+   printf("and time in nanoseconds (NS) per defined element, and instructions per cycle (IPC); n/a if a counter is not available\n");
+   printf("\n");
+   printf("         %%      phase        CYC        INS         CM         BM         PF         NS        IPC\n");
+   printf("\n");
+
+   for (i=0; i < index; i++) {
+       int j, k;
+
+       for (j = 0; j < NPHASES; j++) {
+           const perf_t *pf = &st[i].perf[j];
+
+           printf ("%10d %10s", i+1, phase_names[j]);
+           for (k = 0; k < NCOUNTERS; k++)
+               if (pf->count[k] >= 0)
+                   printf (" %10.3f", (double)pf->count[k] / st[i].nelemts);
+               else
+                   printf (" %10s", "n/a");
+           printf (" %10.3f", pf->time * 1e9 / st[i].nelemts);
+           if (pf->count[0] > 0 && pf->count[1] >= 0)
+               printf (" %10.2f \n", (double)pf->count[1] / pf->count[0]);
+           else
+               printf (" %10s \n", "n/a");
+       }
+   }
+   printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Print the memory of the phases
+ *------------------------------------------------------------
+ */
+void print_memory(int index)
+{
+   int i, j;
+
+   printf("Printing percentage, phase, peak of allocated bytes (PA), bytes allocated (BA), number of allocations (NA),\n");
+   printf("growth of the peak RSS in bytes (PR), and PA and PR per defined element (PAE, PRE)\n");
+   printf("\n");
+   printf("         %%      phase         PA         BA         NA         PR        PAE        PRE\n");
+   printf("\n");
+
+   for (i=0; i < index; i++)
+       for (j = 0; j < MEM_NPHASES; j++) {
+           const mem_t *m = &st[i].mem[j];
+
+           printf ("%10d %10s %10lli %10lli %10lli %10lli %10.2f %10.2f \n", i+1, mem_phase_names[j], m->peak,
+                   m->allocated, m->nallocs, m->rss, (double)m->peak / st[i].nelemts, (double)m->rss / st[i].nelemts);
+       }
+   printf("\n");
+}
+
 /*------------------------------------------------------------
  * Print used storage
  *------------------------------------------------------------
@@ -306,6 +751,26 @@ void print_results(int index)
        printf ("%10d %10lli %10lli %10.1f \n", i+1, a, b, d);
    }
 
+   printf("\n");
+   printf("Printing percentage, encoded selection size with H5Sencode (ES) and with the jittered-stride codec (JES),\n");
+   printf("their compressed sizes (CES, CJES), the storage ratios ES/JES (SR) and CES/CJES (CSR), the jitter bits per\n");
+   printf("point (JB; - when the codec falls back to H5Sencode) and the time to encode and decode (TJE, TJD) in seconds\n");
+   printf("\n");
+   printf("         %%         ES        JES        CES       CJES         SR        CSR         JB        TJE        TJD\n");
+   printf("\n");
+
+   for (i=0; i < index; i++) {
+       char bits[16];
+
+       if (st[i].jit_format == JITTER_FORMAT_STRIDE)
+           sprintf(bits, "%u", st[i].jit_bits);
+       else
+           strcpy(bits, "-");
+       printf ("%10d %10lli %10lli %10lli %10lli %10.1f %10.1f %10s %10.6f %10.6f \n", i+1, st[i].sel, st[i].jit,
+               st[i].sel_comp, st[i].jit_comp, (float)st[i].sel/st[i].jit, (float)st[i].sel_comp/st[i].jit_comp, bits,
+               st[i].t_jit_encode, st[i].t_jit_decode);
+   }
+
    printf("\n");
    printf("Printing percentage, sparse storage size (SPS), structured storage size (STS), and storage ratio (SR) \n");
    printf("\n");
@@ -333,8 +798,184 @@ void print_results(int index)
        d = (float)a/(b+c);
        printf ("%10d %10lli %10lli %10.1f \n", i+1, a, b+c, d);
    }
+
+   printf("\n");
+   printf("Printing percentage, number of defined elements (NE), time to build the selection (TB), to write the sparse datasets (TSP),\n");
+   printf("to encode and write the selection (TES) and to write the defined data (TD) in seconds\n");
+   printf("\n");
+   printf("         %%         NE         TB        TSP        TES         TD\n");
+   printf("\n");
+
+   for (i=0; i < index; i++)
+       printf ("%10d %10lli %10.4f %10.4f %10.4f %10.4f \n", i+1, st[i].nelemts, st[i].t_select, st[i].t_sparse,
+               st[i].t_encode, st[i].t_data);
    printf("\n");
+
+   if (hand.p)
+       print_counters(index);
+
+   if (hand.a)
+       print_memory(index);
 }    
+
+/*------------------------------------------------------------
+ * Elapsed time
+ *------------------------------------------------------------
+ */
+double elapsed(struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*------------------------------------------------------------
+ * Open the performance counters of this thread; each counter
+ * is opened on its own so that the available ones are read
+ * if others are not supported
+ *------------------------------------------------------------
+ */
+void perf_open(void)
+{
+    struct perf_event_attr attr;
+    unsigned int           type[NCOUNTERS]   = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+                                                PERF_TYPE_HARDWARE, PERF_TYPE_SOFTWARE};
+    unsigned long long     config[NCOUNTERS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES,
+                                                PERF_COUNT_SW_PAGE_FAULTS};
+    int                    i, nopen = 0;
+
+    for (i = 0; i < NCOUNTERS; i++) {
+        memset(&attr, 0, sizeof(attr));
+        attr.size           = sizeof(attr);
+        attr.type           = type[i];
+        attr.config         = config[i];
+        attr.disabled       = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        perf_fd[i] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        if (perf_fd[i] >= 0)
+            nopen++;
+        else if (hand.v)
+            printf("Performance counter %s is not available\n", counter_names[i]);
+    }
+
+    if (nopen == 0)
+        printf("No performance counters are available; check kernel.perf_event_paranoid\n");
+    else if (perf_fd[0] < 0)
+        printf("The hardware performance counters are not available; check kernel.perf_event_paranoid\n");
+}
+
+void perf_close(void)
+{
+    int i;
+
+    for (i = 0; i < NCOUNTERS; i++)
+        if (perf_fd[i] >= 0)
+            close(perf_fd[i]);
+}
+
+/* Start counting a phase */
+void perf_start(void)
+{
+    int i;
+
+    if (!hand.p)
+        return;
+
+    for (i = 0; i < NCOUNTERS; i++)
+        if (perf_fd[i] >= 0) {
+            ioctl(perf_fd[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(perf_fd[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    clock_gettime(CLOCK_MONOTONIC, &perf_start_time);
+}
+
+/* Stop counting a phase and add the counts to "pf"; counts are scaled if the counters were multiplexed */
+void perf_stop(perf_t *pf)
+{
+    uint64_t values[3];
+    int      i;
+
+    if (!hand.p)
+        return;
+
+    pf->time += elapsed(&perf_start_time);
+    for (i = 0; i < NCOUNTERS; i++) {
+        if (perf_fd[i] < 0 || pf->count[i] < 0) {
+            pf->count[i] = -1;
+            continue;
+        }
+        ioctl(perf_fd[i], PERF_EVENT_IOC_DISABLE, 0);
+        if (read(perf_fd[i], values, sizeof(values)) != sizeof(values))
+            pf->count[i] = -1;
+        else if (values[2] > 0)
+            pf->count[i] += (long long int)((double)values[0] * values[1] / values[2]);
+    }
+}
+
+/*------------------------------------------------------------
+ * Append the results to the JSON lines file: one object per
+ * percentage with the parameters, sizes, timings and the
+ * environment
+ *------------------------------------------------------------
+ */
+int print_json(int index)
+{
+   FILE     *f;
+   char      host[256] = "unknown";
+   char      date[32];
+   time_t    now = time(NULL);
+   unsigned  major, minor, release;
+   int       i;
+
+   if (NULL == (f = fopen(hand.json_file, "a"))) {
+       printf("Failed to open %s\n", hand.json_file);
+       return -1;
+   }
+
+   gethostname(host, sizeof(host) - 1);
+   strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+   H5get_libversion(&major, &minor, &release);
+
+   for (i=0; i < index; i++) {
+       fprintf(f, "{\"benchmark\": \"sparse\", \"chunk_dim1\": %lld, \"chunk_dim2\": %lld, \"space_select\": %d, "
+                  "\"d\": %d, \"percent\": %d, ", hand.chunk_dim1, hand.chunk_dim2, hand.space_select, hand.d, i+1);
+       fprintf(f, "\"nelemts\": %lld, \"sparse\": %lld, \"sparse_comp\": %lld, \"data\": %lld, \"data_comp\": %lld, "
+                  "\"sel\": %lld, \"sel_comp\": %lld, ", st[i].nelemts, st[i].sparse, st[i].sparse_comp, st[i].data,
+               st[i].data_comp, st[i].sel, st[i].sel_comp);
+       fprintf(f, "\"sel_jitter\": %lld, \"sel_jitter_comp\": %lld, \"jitter_format\": %d, \"jitter_bits\": %u, "
+                  "\"t_jitter_encode\": %.6f, \"t_jitter_decode\": %.6f, ", st[i].jit, st[i].jit_comp,
+               st[i].jit_format, st[i].jit_bits, st[i].t_jit_encode, st[i].t_jit_decode);
+       fprintf(f, "\"t_select\": %.6f, \"t_sparse\": %.6f, \"t_encode\": %.6f, \"t_data\": %.6f, ", st[i].t_select,
+               st[i].t_sparse, st[i].t_encode, st[i].t_data);
+       if (hand.p) {
+           int j, k;
+
+           for (j = 0; j < NPHASES; j++) {
+               for (k = 0; k < NCOUNTERS; k++)
+                   fprintf(f, "\"%s_%s\": %lld, ", phase_names[j], counter_names[k], st[i].perf[j].count[k]);
+               fprintf(f, "\"%s_time\": %.6f, ", phase_names[j], st[i].perf[j].time);
+           }
+       }
+       if (hand.a) {
+           int j;
+
+           for (j = 0; j < MEM_NPHASES; j++)
+               fprintf(f, "\"mem_%s_peak\": %lld, \"mem_%s_allocated\": %lld, \"mem_%s_nallocs\": %lld, "
+                          "\"mem_%s_rss\": %lld, ", mem_phase_names[j], st[i].mem[j].peak, mem_phase_names[j],
+                       st[i].mem[j].allocated, mem_phase_names[j], st[i].mem[j].nallocs, mem_phase_names[j],
+                       st[i].mem[j].rss);
+       }
+       fprintf(f, "\"host\": \"%s\", \"hdf5\": \"%u.%u.%u\", \"date\": \"%s\"}\n", host, major, minor, release, date);
+   }
+
+   fclose(f);
+   return 0;
+}
    
 
 /*------------------------------------------------------------
@@ -354,10 +995,14 @@ int create_encoded_dspace(hid_t group, hid_t dataspace, int index)
     hsize_t chunk_bytes=0;
     hsize_t compressed_chunk_bytes=0;
 
+    mem_start();
+    perf_start();
     H5Sencode(dataspace, NULL, &nalloc, H5P_DEFAULT);
     buf = (void *)malloc(nalloc);
 
     H5Sencode(dataspace, buf, &nalloc, H5P_DEFAULT);
+    perf_stop(&st[index].perf[PHASE_ENCODE]);
+    mem_stop(&st[index].mem[MEM_ENCODE]);
 
     dim[0] = nalloc; 
     dcpl = H5Pcreate(H5P_DATASET_CREATE);
@@ -399,6 +1044,325 @@ error:
     return -1;
 }
 
+/*------------------------------------------------------------
+ * Little-endian integers and bit-packing of the jittered-stride
+ * selection codec
+ *------------------------------------------------------------
+ */
+void jitter_put32(uint8_t **p, uint32_t v)
+{
+    int i;
+
+    for (i = 0; i < 4; i++)
+        *(*p)++ = (uint8_t)(v >> (8 * i));
+}
+
+uint32_t jitter_get32(const uint8_t **p)
+{
+    uint32_t v = 0;
+    int      i;
+
+    for (i = 0; i < 4; i++)
+        v |= (uint32_t)*(*p)++ << (8 * i);
+    return v;
+}
+
+void jitter_put_bits(uint8_t *buf, uint64_t pos, unsigned nbits, uint32_t v)
+{
+    unsigned i;
+
+    for (i = 0; i < nbits; i++, pos++)
+        if (v >> i & 1)
+            buf[pos >> 3] |= (uint8_t)(1 << (pos & 7));
+}
+
+uint32_t jitter_get_bits(const uint8_t *buf, uint64_t pos, unsigned nbits)
+{
+    uint32_t v = 0;
+    unsigned i;
+
+    for (i = 0; i < nbits; i++, pos++)
+        v |= (uint32_t)(buf[pos >> 3] >> (pos & 7) & 1) << i;
+    return v;
+}
+
+/*------------------------------------------------------------
+ * Mark the selected elements of a hyperslab selection of a
+ * chunk (dims[0] x dims[1]) in a mask
+ *------------------------------------------------------------
+ */
+void selection_mask(hid_t dataspace, const hsize_t *dims, uint8_t *mask)
+{
+    hssize_t nblocks, b;
+    hsize_t *blocks;
+    hsize_t  r;
+
+    memset(mask, 0, dims[0] * dims[1]);
+    if (H5Sget_select_type(dataspace) != H5S_SEL_HYPERSLABS)
+        return;
+
+    nblocks = H5Sget_select_hyper_nblocks(dataspace);
+    blocks  = (hsize_t *)malloc(nblocks * 2 * RANK * sizeof(hsize_t));
+    H5Sget_select_hyper_blocklist(dataspace, 0, (hsize_t)nblocks, blocks);
+    for (b = 0; b < nblocks; b++) {
+        hsize_t *block = blocks + b * 2 * RANK;
+
+        for (r = block[0]; r <= block[2]; r++)
+            memset(mask + r * dims[1] + block[1], 1, block[3] - block[1] + 1);
+    }
+    free(blocks);
+}
+
+/*------------------------------------------------------------
+ * Encode the selection of a chunk with the jittered-stride
+ * codec.  The selected points are taken from the blocks of the
+ * hyperslab selection.  When every row has the same number of
+ * points K, the j-th point p of a row is stored as its jitter
+ * p - B - j*S, where the base B is the smallest p - j*S of all
+ * rows and the stride S is the one of the strides around the
+ * mean distance of consecutive points that needs the fewest
+ * bits for the largest jitter:
+ *
+ *   format (1 byte), rows, columns, K, B, S (4 bytes each),
+ *   bits per jitter (1 byte), jitters (bit-packed, row-major)
+ *
+ * Otherwise, or when the H5Sencode encoding is smaller (e.g.
+ * for runs of points), the encoding is the format byte followed
+ * by the H5Sencode encoding.  The buffer is allocated and has to be
+ * freed by the caller.
+ *------------------------------------------------------------
+ */
+int jitter_encode(hid_t dataspace, uint8_t **buf, size_t *size, unsigned *nbits)
+{
+    hsize_t   dims[RANK];
+    uint32_t *cols = NULL;
+    uint8_t  *mask = NULL;
+    uint8_t  *p;
+    uint64_t  nrows, ncols, k = 0, r, c, j;
+    int64_t   base = 0, stride = 0, s, s_min, s_max;
+    uint64_t  best_jitter = UINT64_MAX;
+    unsigned  bits = 0;
+    size_t    nalloc = 0;
+
+    H5Sget_simple_extent_dims(dataspace, dims, NULL);
+    nrows = dims[0];
+    ncols = dims[1];
+
+    /* The points of the selection in the row-major order */
+    if (H5Sget_select_type(dataspace) == H5S_SEL_HYPERSLABS) {
+        mask = (uint8_t *)malloc(nrows * ncols);
+        selection_mask(dataspace, dims, mask);
+
+        /* The number of points in the first row; all rows must have it */
+        for (c = 0; c < ncols; c++)
+            k += mask[c];
+        if (k > 0) {
+            cols = (uint32_t *)malloc(nrows * k * sizeof(uint32_t));
+            for (r = 0; r < nrows; r++) {
+                j = 0;
+                for (c = 0; c < ncols; c++)
+                    if (mask[r * ncols + c]) {
+                        if (j == k)
+                            break;
+                        cols[r * k + j++] = (uint32_t)c;
+                    }
+                if (j != k || c < ncols)
+                    break;
+            }
+            if (r < nrows)
+                k = 0;
+        }
+    }
+
+    if (k == 0 || nrows > UINT32_MAX || ncols > UINT32_MAX)
+        goto fallback;
+
+    /* Try the strides around the mean distance of consecutive points */
+    s_min = s_max = 0;
+    if (k > 1) {
+        uint64_t span = 0;
+
+        for (r = 0; r < nrows; r++)
+            span += cols[r * k + k - 1] - cols[r * k];
+        s_min = (int64_t)(span / (nrows * (k - 1))) - JITTER_MAX_STRIDE_TRIES / 2;
+        s_max = s_min + JITTER_MAX_STRIDE_TRIES - 1;
+        if (s_min < 0)
+            s_min = 0;
+    }
+    for (s = s_min; s <= s_max; s++) {
+        int64_t  lo = INT64_MAX, hi = INT64_MIN;
+
+        for (r = 0; r < nrows; r++)
+            for (j = 0; j < k; j++) {
+                int64_t v = (int64_t)cols[r * k + j] - (int64_t)j * s;
+
+                if (v < lo) lo = v;
+                if (v > hi) hi = v;
+            }
+        if (lo >= 0 && (uint64_t)(hi - lo) < best_jitter) {
+            best_jitter = (uint64_t)(hi - lo);
+            base        = lo;
+            stride      = s;
+        }
+    }
+    while (bits < 32 && (best_jitter >> bits) != 0)
+        bits++;
+
+    /* Runs of consecutive points are smaller as H5Sencode blocks */
+    H5Sencode(dataspace, NULL, &nalloc, H5P_DEFAULT);
+    if (best_jitter == UINT64_MAX || JITTER_HEADER_SIZE + (nrows * k * bits + 7) / 8 > nalloc + 1)
+        goto fallback;
+
+    *size = JITTER_HEADER_SIZE + (nrows * k * bits + 7) / 8;
+    *buf  = (uint8_t *)calloc(*size, 1);
+    p     = *buf;
+    *p++  = JITTER_FORMAT_STRIDE;
+    jitter_put32(&p, (uint32_t)nrows);
+    jitter_put32(&p, (uint32_t)ncols);
+    jitter_put32(&p, (uint32_t)k);
+    jitter_put32(&p, (uint32_t)base);
+    jitter_put32(&p, (uint32_t)stride);
+    *p++ = (uint8_t)bits;
+    for (r = 0; r < nrows; r++)
+        for (j = 0; j < k; j++)
+            jitter_put_bits(p, (r * k + j) * bits, bits, (uint32_t)(cols[r * k + j] - base - j * stride));
+    *nbits = bits;
+    goto done;
+
+fallback:
+    /* A flag byte followed by the H5Sencode encoding */
+    H5Sencode(dataspace, NULL, &nalloc, H5P_DEFAULT);
+    *buf      = (uint8_t *)malloc(nalloc + 1);
+    (*buf)[0] = JITTER_FORMAT_H5S;
+    H5Sencode(dataspace, *buf + 1, &nalloc, H5P_DEFAULT);
+    *size     = nalloc + 1;
+    *nbits    = 0;
+
+done:
+    free(mask);
+    free(cols);
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Decode a selection encoded by jitter_encode into a mask of
+ * the selected elements of the chunk (dims[0] x dims[1])
+ *------------------------------------------------------------
+ */
+int jitter_decode(const uint8_t *buf, size_t size, const hsize_t *dims, uint8_t *mask)
+{
+    const uint8_t *p = buf + 1;
+    uint64_t       nrows, ncols, k, base, stride, r, j;
+    unsigned       bits;
+
+    memset(mask, 0, dims[0] * dims[1]);
+
+    if (buf[0] == JITTER_FORMAT_H5S) {
+        hid_t space = H5Sdecode(buf + 1);
+
+        if (space < 0)
+            return -1;
+        selection_mask(space, dims, mask);
+        H5Sclose(space);
+        return 0;
+    }
+
+    if (buf[0] != JITTER_FORMAT_STRIDE || size < JITTER_HEADER_SIZE)
+        return -1;
+    nrows  = jitter_get32(&p);
+    ncols  = jitter_get32(&p);
+    k      = jitter_get32(&p);
+    base   = jitter_get32(&p);
+    stride = jitter_get32(&p);
+    bits   = *p++;
+    if (nrows != dims[0] || ncols != dims[1] || size < JITTER_HEADER_SIZE + (nrows * k * bits + 7) / 8)
+        return -1;
+
+    for (r = 0; r < nrows; r++)
+        for (j = 0; j < k; j++) {
+            uint64_t c = base + j * stride + jitter_get_bits(p, (r * k + j) * bits, bits);
+
+            if (c >= ncols)
+                return -1;
+            mask[r * ncols + c] = 1;
+        }
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Create compressed and uncompressed datasets to store the
+ * selection encoded with the jittered-stride codec, and check
+ * that the encoding decodes to the selection
+ *------------------------------------------------------------
+ */
+int create_jitter_dspace(hid_t group, hid_t dataspace, int index)
+{
+    hid_t           dset, dset_compressed;
+    hid_t           dspace;
+    hid_t           dcpl;
+    hsize_t         dim[1];
+    hsize_t         dims[RANK];
+    hsize_t         offset[1] = {0};
+    hsize_t         chunk_bytes = 0;
+    uint8_t        *buf, *mask, *orig;
+    size_t          size;
+    struct timespec start;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    jitter_encode(dataspace, &buf, &size, &st[index].jit_bits);
+    st[index].t_jit_encode = elapsed(&start);
+    st[index].jit_format   = buf[0];
+
+    /* Decode the selection and compare it with the original one */
+    H5Sget_simple_extent_dims(dataspace, dims, NULL);
+    mask = (uint8_t *)malloc(dims[0] * dims[1]);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (jitter_decode(buf, size, dims, mask) < 0)
+        printf("Failed to decode the jittered-stride selection of percentage %d\n", index + 1);
+    st[index].t_jit_decode = elapsed(&start);
+
+    orig = (uint8_t *)malloc(dims[0] * dims[1]);
+    selection_mask(dataspace, dims, orig);
+    if (memcmp(mask, orig, dims[0] * dims[1]))
+        printf("The jittered-stride selection of percentage %d does not decode to the selection\n", index + 1);
+    free(orig);
+    free(mask);
+
+    dim[0] = size;
+    dcpl   = H5Pcreate(H5P_DATASET_CREATE);
+    H5Pset_chunk(dcpl, 1, dim);
+    dspace = H5Screate_simple(1, dim, NULL);
+
+    /* Create a new dataset without compression */
+    dset = H5Dcreate2(group, JITTER_DSET_NAME, H5T_NATIVE_UCHAR, dspace, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+
+    /* Set gzip compression */
+    H5Pset_deflate(dcpl, 9);
+
+    /* Create a new dataset with compression */
+    dset_compressed = H5Dcreate2(group, JITTER_DSET_COMPRESSED_NAME, H5T_NATIVE_UCHAR, dspace, H5P_DEFAULT, dcpl,
+                                 H5P_DEFAULT);
+
+    /* Write the encoded selection and calculate storage */
+    H5Dwrite(dset, H5T_NATIVE_UCHAR, H5S_ALL, H5S_ALL, H5P_DEFAULT, buf);
+    H5Dget_chunk_storage_size(dset, offset, &chunk_bytes);
+    st[index].jit = chunk_bytes;
+
+    H5Dwrite(dset_compressed, H5T_NATIVE_UCHAR, H5S_ALL, H5S_ALL, H5P_DEFAULT, buf);
+    H5Dget_chunk_storage_size(dset_compressed, offset, &chunk_bytes);
+    st[index].jit_comp = chunk_bytes;
+
+    H5Dclose(dset);
+    H5Dclose(dset_compressed);
+    H5Pclose(dcpl);
+    H5Sclose(dspace);
+
+    free(buf);
+
+    return 0;
+}
+
 /*------------------------------------------------------------
  * Create compressed and uncompressed datasets to store the 
  * defined data as a one-dimensional array
@@ -432,7 +1396,9 @@ int create_structured_dsets(hid_t group, uint64_t nelemts, uint8_t *data, int in
     dset_compressed = H5Dcreate2(group, DATA_DSET_COMPRESSED_NAME, H5T_STD_U8LE, dataspace, H5P_DEFAULT, dcpl, H5P_DEFAULT);
 
     /* Write the data to the dataset  and calculate storage*/
+    mem_start();
     H5Dwrite(dset, H5T_NATIVE_UCHAR, H5S_ALL, H5S_ALL, H5P_DEFAULT, data);
+    mem_stop(&st[index].mem[MEM_WRITE]);
     H5Dget_chunk_storage_size(dset, offset, &chunk_bytes);
     st[index].data = chunk_bytes;
 
@@ -451,6 +1417,113 @@ error:
     return -1;
 }
 
+/*------------------------------------------------------------
+ * Read the defined data and the encoded selection back and
+ * decode the selection: the structured storage in memory
+ *------------------------------------------------------------
+ */
+int read_structured(hid_t group, uint64_t nelemts, int index)
+{
+    hid_t    dset, sel_dset, sel_space, space;
+    hssize_t nalloc;
+    uint8_t *data, *sel;
+
+    dset      = H5Dopen2(group, DATA_DSET_NAME, H5P_DEFAULT);
+    sel_dset  = H5Dopen2(group, SELECTION_DSET_NAME, H5P_DEFAULT);
+    sel_space = H5Dget_space(sel_dset);
+    nalloc    = H5Sget_simple_extent_npoints(sel_space);
+
+    mem_start();
+    data = (uint8_t *)malloc(nelemts);
+    sel  = (uint8_t *)malloc((size_t)nalloc);
+    H5Dread(dset, H5T_NATIVE_UCHAR, H5S_ALL, H5S_ALL, H5P_DEFAULT, data);
+    H5Dread(sel_dset, H5T_NATIVE_UCHAR, H5S_ALL, H5S_ALL, H5P_DEFAULT, sel);
+    space = H5Sdecode(sel);
+    mem_stop(&st[index].mem[MEM_READ]);
+
+    H5Sclose(space);
+    free(data);
+    free(sel);
+    H5Sclose(sel_space);
+    H5Dclose(sel_dset);
+    H5Dclose(dset);
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Measure the phases that only run with -p 1 (decode, gather
+ * and deflate) on the datasets written by the timed phases,
+ * so that they are not counted in the write times
+ *------------------------------------------------------------
+ */
+int measure_phases(hid_t group, hid_t dataspace, uint64_t nelemts, uint8_t *data, int index)
+{
+    hid_t    dset, sel_dset, sel_space, mem_space, decoded;
+    hsize_t  mem_dim[1] = {nelemts};
+    hssize_t nalloc;
+    uint8_t *sel, *gathered;
+    uLongf   comp_size = compressBound((uLong)nelemts);
+    Bytef   *comp;
+
+    /* Decode the encoded selection */
+    sel_dset  = H5Dopen2(group, SELECTION_DSET_NAME, H5P_DEFAULT);
+    sel_space = H5Dget_space(sel_dset);
+    nalloc    = H5Sget_simple_extent_npoints(sel_space);
+    sel       = (uint8_t *)malloc((size_t)nalloc);
+    H5Dread(sel_dset, H5T_NATIVE_UCHAR, H5S_ALL, H5S_ALL, H5P_DEFAULT, sel);
+    perf_start();
+    decoded = H5Sdecode(sel);
+    perf_stop(&st[index].perf[PHASE_DECODE]);
+    H5Sclose(decoded);
+    free(sel);
+    H5Sclose(sel_space);
+    H5Dclose(sel_dset);
+
+    /* Read the defined elements of the sparse dataset into a 1-dim buffer */
+    dset      = H5Dopen2(group, DSET_NAME, H5P_DEFAULT);
+    mem_space = H5Screate_simple(1, mem_dim, NULL);
+    gathered  = (uint8_t *)malloc(nelemts);
+    perf_start();
+    H5Dread(dset, H5T_NATIVE_UCHAR, mem_space, dataspace, H5P_DEFAULT, gathered);
+    perf_stop(&st[index].perf[PHASE_GATHER]);
+    free(gathered);
+    H5Sclose(mem_space);
+    H5Dclose(dset);
+
+    /* Compress the data with deflate outside of the library to measure the filter */
+    comp = (Bytef *)malloc(comp_size);
+    perf_start();
+    compress2(comp, &comp_size, data, (uLong)nelemts, 9);
+    perf_stop(&st[index].perf[PHASE_DEFLATE]);
+    free(comp);
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Read the defined elements of the sparse dataset into a
+ * dense buffer of the chunk: the dense storage in memory
+ *------------------------------------------------------------
+ */
+int scatter_dense(hid_t group, hid_t dataspace, int index)
+{
+    hid_t    dset;
+    uint8_t *dense;
+
+    dset = H5Dopen2(group, DSET_NAME, H5P_DEFAULT);
+
+    mem_start();
+    dense = (uint8_t *)calloc(hand.chunk_dim1 * hand.chunk_dim2, 1);
+    H5Dread(dset, H5T_NATIVE_UCHAR, dataspace, dataspace, H5P_DEFAULT, dense);
+    mem_stop(&st[index].mem[MEM_SCATTER]);
+
+    free(dense);
+    H5Dclose(dset);
+
+    return 0;
+}
+
 /*------------------------------------------------------------
  * Create sparse datasets
  *------------------------------------------------------------
@@ -483,7 +1556,9 @@ int create_hdf5_dsets(hid_t group, hid_t dcpl, hid_t dataspace, uint64_t nelemts
     mem_space = H5Screate_simple(1, mem_dim, NULL);
 
     /* Write the data to the dataset and calculate storage */
+    perf_start();
     status = H5Dwrite(hdf5_dset, H5T_NATIVE_UCHAR, mem_space, dataspace, H5P_DEFAULT, data);
+    perf_stop(&st[st_index].perf[PHASE_SCATTER]);
     H5Dget_chunk_storage_size(hdf5_dset, chunk_offset, &chunk_bytes);
     st[st_index].sparse = chunk_bytes; 
 
@@ -590,6 +1665,7 @@ main(int argc, char **argv)
     hid_t   dcpl, dataspace;
     hsize_t chunk_dims[2];
     time_t  t;
+    struct timespec start;
     int     n;
     uint8_t *data, *p;
     uint64_t nelemts = 0;
@@ -616,6 +1692,9 @@ main(int argc, char **argv)
     /* Create the dataspace of one chunk size */
     dataspace = H5Screate_simple(RANK, chunk_dims, NULL);
 
+    if (hand.p)
+        perf_open();
+
     if (hand.v) printf("Generating file\n");
 
     for (n = 0; n < hand.max_percent; n++) {
@@ -625,7 +1704,14 @@ main(int argc, char **argv)
         group = H5Gcreate(file, group_name, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
 
         /* Generate hyperslab selection and sparse data to store */
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        mem_start();
+        perf_start();
         nelemts = create_hyperslab ((n+1), &dataspace);
+        perf_stop(&st[n].perf[PHASE_SELECT]);
+        mem_stop(&st[n].mem[MEM_SELECT]);
+        st[n].t_select = elapsed(&start);
+        st[n].nelemts  = nelemts;
 
         /* Generate data */
          p = data = (uint8_t *)malloc(nelemts);
@@ -639,13 +1725,32 @@ main(int argc, char **argv)
         }
 
         /* Create datasets in the group */
+        clock_gettime(CLOCK_MONOTONIC, &start);
         create_hdf5_dsets(group, dcpl, dataspace, nelemts, data, n);
+        st[n].t_sparse = elapsed(&start);
 
         /* Create datasets with encoded selection */
+        clock_gettime(CLOCK_MONOTONIC, &start);
         create_encoded_dspace(group, dataspace, n);
+        st[n].t_encode = elapsed(&start);
+
+        /* Create datasets with the selection encoded by the jittered-stride codec */
+        create_jitter_dspace(group, dataspace, n);
 
         /* Create datasets with defined values */
+        clock_gettime(CLOCK_MONOTONIC, &start);
         create_structured_dsets(group, nelemts, data, n);
+        st[n].t_data = elapsed(&start);
+
+        /* Measure the phases that only run with the performance counters */
+        if (hand.p)
+            measure_phases(group, dataspace, nelemts, data, n);
+
+        /* Read the structured and the dense storage back */
+        if (hand.a) {
+            read_structured(group, nelemts, n);
+            scatter_dense(group, dataspace, n);
+        }
 
         /* Reset hyperslab selection and free data buffer before going to the next iteration*/
         H5Sselect_none(dataspace);
@@ -662,8 +1767,14 @@ main(int argc, char **argv)
     H5Pclose(dcpl);
     H5Fclose(file);
 
+    if (hand.p)
+        perf_close();
+
     /* Print results */
     print_results(hand.max_percent);    
 
+    if (hand.json_file)
+        print_json(hand.max_percent);
+
     return 0;
 }
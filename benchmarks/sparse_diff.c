@@ -0,0 +1,1275 @@
+/*
+ * This program compares two sparse datasets stored with structured chunks (see structured_chunk.h) as
+ * h5diff does, with a sparse mode that compares the sets of defined elements before their values.
+ *
+ * There are two modes selected by the command line option -m:
+ *
+ *  0 - sparse (default): the chunks of the two datasets are matched by their logical position.  A chunk
+ *      stored in only one of the datasets contributes all its defined elements as differences without
+ *      reading its data.  For a pair of chunks the Encoded Selections are compared first, as stored
+ *      bytes when the sections have the same pipeline: if the selections match, the stored data sections
+ *      are compared in the same way and only a mismatch decodes the packed values, which are then
+ *      compared element by element.  If the selections differ, the defined elements of the two chunks
+ *      are merged by their position and the elements defined in only one chunk are differences;
+ *  1 - dense: every element of the chunks is compared, with the fill value for the undefined elements
+ *      and for the chunks that are not stored, as h5diff compares dense datasets.
+ *
+ * The chunk indexes of both datasets are fetched with sc_get_chunk_locations().  The pairs of chunks are
+ * then compared by P threads (option -p) that read the chunks with pread; the library is not used by the
+ * threads.  The values are compared bytewise or, with the option -d, as numbers that differ by more
+ * than the delta; the option -d supports the predefined integer and floating-point types.
+ *
+ * With the option -g 1 the program first generates the two files: a dataset of 32-bit integers with the
+ * density given by the option -e (in percent) and a copy with K changes (option -k): half of the changes
+ * modify values of defined elements, the other half undefine defined elements or define undefined ones.
+ * Each element is changed at most once, so that the changes do not cancel out.
+ *
+ * The program prints the first differences, in the logical order of the chunks, in the h5diff form and
+ * reports the number of chunks compared (NC), the chunks stored in one file only (N1), the chunks with
+ * the same selection (SS) and the same data (SD), the elements defined in one file only (E1), the values
+ * that differ (ND), the bytes read (IB), the time of the index lookup (TI) and of the comparison (TC) in
+ * seconds, and the throughput of the comparison in MB/s (MBS).  The files are dropped from the page cache before each comparison.  As
+ * h5diff does, the program exits with 0 if no differences are found, 1 if some are found and 2 on errors.
+ *
+ * To compile the program, please use h5cc.  The -h option lists all the command line options:
+ *
+ *   [-h] [-i --inFile] [-j --jFile] [-n --nameDset] [-m --mode] [-d --delta] [-p --pThreads]
+ *   [-g --generate] [-s --dimsDset] [-c --dimsChunk] [-e --ePercent] [-k --kChanges] [-v --Verbose]
+ *
+ * Example: The commands
+ *
+ *           h5cc -pthread sparse_diff.c -o sparse_diff
+ *           ./sparse_diff -g 1 -e 1 -k 0
+ *           ./sparse_diff -m 1
+ *           ./sparse_diff -g 1 -e 1 -k 100
+ *           ./sparse_diff -m 1
+ *
+ * compare identical and nearly identical files with 1% of defined elements in the sparse mode and in
+ * the dense mode.
+ */
+
+#include "hdf5.h"
+#include "structured_chunk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <getopt.h>
+#include <pthread.h>
+
+#define FILE_NAME1                      "diff_a.h5"
+#define FILE_NAME2                      "diff_b.h5"
+#define DSET_NAME                       "sparse"
+#define DSET_DIM1                       4096
+#define DSET_DIM2                       4096
+#define CHUNK_DIM1                      64
+#define CHUNK_DIM2                      64
+#define PERCENT                         1
+#define MAX_THREADS                     256
+#define BATCH_CHUNKS                    16          /* Pairs of chunks taken by a thread at a time */
+#define MAX_REPORT                      10          /* Differences printed */
+#define RANK                            2
+
+#define MODE_SPARSE                     0
+#define MODE_DENSE                      1
+
+/* Kinds of differences */
+#define DIFF_VALUE                      0
+#define DIFF_ONLY_1                     1
+#define DIFF_ONLY_2                     2
+
+typedef struct {
+    char           *file1;
+    char           *file2;
+    char           *dset_name;
+    int             mode;
+    double          delta;           /* 0 for a bytewise comparison */
+    int             threads;
+    int             g;               /* generate the files */
+    long long int   dset_dim1;
+    long long int   dset_dim2;
+    long long int   chunk_dim1;
+    long long int   chunk_dim2;
+    double          percent;
+    long long int   changes;
+    int             v;               /* prints progress messages */
+} handler_t;
+
+/* A difference found in the chunks of the pair "pair" */
+typedef struct {
+    size_t          pair;
+    uint64_t        elem;            /* position of the element in the chunk */
+    int             kind;
+    uint8_t         value1[8];
+    uint8_t         value2[8];
+} diff_t;
+
+/* Statistics gathered by one thread and merged at the end */
+typedef struct {
+    long long int   nchunks;
+    long long int   nonly;           /* chunks stored in one file only */
+    long long int   nsame_sel;
+    long long int   nsame_data;
+    long long int   nelmts_only;     /* elements defined in one file only */
+    long long int   ndiff;           /* values that differ */
+    long long int   ninvalid;
+    long long int   read_bytes;
+    int             nreport;
+    diff_t          report[MAX_REPORT];
+} stats_t;
+
+/* Chunk of one dataset; NULL if it is not stored */
+typedef struct {
+    const sc_chunk_loc_t *loc[2];
+} pair_t;
+
+/* Buffers of a thread, reused for all its pairs */
+typedef struct {
+    uint8_t        *image[2];
+    size_t          image_max[2];
+    uint8_t        *sections[2][SC_MAX_SECTIONS];
+    size_t          section_max[2][SC_MAX_SECTIONS];
+    sc_run_t       *runs[2];
+    size_t          max_runs[2];
+    uint64_t       *elems[2];
+    size_t          max_elems[2];
+    uint8_t        *dense[2];
+} scratch_t;
+
+/* Work shared by the threads */
+typedef struct {
+    int             fd[2];
+    size_t          npairs;
+    pair_t         *pairs;
+    int             rank;
+    hsize_t         dims[SC_MAX_RANK];
+    hsize_t         chunk_dims[SC_MAX_RANK];
+    uint64_t        chunk_nelmts;
+    size_t          elmt_size;
+    H5T_class_t     type_class;
+    H5T_sign_t      sign;
+    uint8_t        *fill;
+    size_t          next;            /* next pair to take; taken atomically */
+    stats_t         stats[MAX_THREADS];
+} diff_pass_t;
+
+handler_t hand;
+
+/*------------------------------------------------------------
+ * Display command line usage
+ *------------------------------------------------------------
+ */
+void
+usage(void)
+{
+    printf("    [-h] [-i --inFile] [-j --jFile] [-n --nameDset] [-m --mode] [-d --delta] [-p --pThreads]\n");
+    printf("    [-g --generate] [-s --dimsDset] [-c --dimsChunk] [-e --ePercent] [-k --kChanges] [-v --Verbose]\n");
+    printf("    [-h --help]: this help page\n");
+    printf("    [-i --inFile]: the first file (default %s)\n", FILE_NAME1);
+    printf("    [-j --jFile]: the second file (default %s)\n", FILE_NAME2);
+    printf("    [-n --nameDset]: the name of the dataset in both files (default %s)\n", DSET_NAME);
+    printf("    [-m --mode]: 0 - sparse (default), 1 - dense\n");
+    printf("    [-d --delta]: values differ if they differ by more than the delta (default 0, bytewise)\n");
+    printf("    [-p --pThreads]: the number of threads comparing the chunks (default the number of CPUs)\n");
+    printf("    [-g --generate]: generate the two files before the comparison (1) or not (0, default)\n");
+    printf("    [-s --dimsDset]: the dimensions of the generated dataset (default %dx%d)\n", DSET_DIM1, DSET_DIM2);
+    printf("    [-c --dimsChunk]: the chunk dimensions of the generated dataset (default %dx%d)\n", CHUNK_DIM1,
+           CHUNK_DIM2);
+    printf("    [-e --ePercent]: the percentage of the defined elements of the generated dataset (default %d)\n",
+           PERCENT);
+    printf("    [-k --kChanges]: the number of changes in the second generated file (default 0)\n");
+    printf("    [-v --Verbose]: Print progress messages(1); default no messages displayed (0) \n");
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Parse a string of the form AxB; missing dimensions are set
+ * to 0
+ *------------------------------------------------------------
+ */
+void
+parse_dims(const char *str, int ndims, long long int *dims[])
+{
+    char *dims_str, *dim_str;
+    int   i;
+
+    dims_str = strdup(str);
+    dim_str  = strtok(dims_str, "x");
+    for (i = 0; i < ndims; i++) {
+        *dims[i] = dim_str ? atoll(dim_str) : 0;
+        dim_str  = strtok(NULL, "x");
+    }
+    free(dims_str);
+}
+
+/*------------------------------------------------------------
+ * Parse command line option
+ *------------------------------------------------------------
+ */
+void
+parse_command_line(int argc, char *argv[])
+{
+    int            opt;
+    long long int *dset_dims[2]  = {&hand.dset_dim1, &hand.dset_dim2};
+    long long int *chunk_dims[2] = {&hand.chunk_dim1, &hand.chunk_dim2};
+    struct option  long_options[] = {
+                                    {"help", no_argument, NULL, 'h'},
+                                    {"inFile=", required_argument, NULL, 'i'},
+                                    {"jFile=", required_argument, NULL, 'j'},
+                                    {"nameDset=", required_argument, NULL, 'n'},
+                                    {"mode=", required_argument, NULL, 'm'},
+                                    {"delta=", required_argument, NULL, 'd'},
+                                    {"pThreads=", required_argument, NULL, 'p'},
+                                    {"generate=", required_argument, NULL, 'g'},
+                                    {"dimsDset=", required_argument, NULL, 's'},
+                                    {"dimsChunk=", required_argument, NULL, 'c'},
+                                    {"ePercent=", required_argument, NULL, 'e'},
+                                    {"kChanges=", required_argument, NULL, 'k'},
+                                    {"Verbose=", required_argument, NULL, 'v'},
+                                    {NULL, 0, NULL, 0}};
+
+    /* Initialize the command line options */
+    hand.file1      = FILE_NAME1;
+    hand.file2      = FILE_NAME2;
+    hand.dset_name  = DSET_NAME;
+    hand.mode       = MODE_SPARSE;
+    hand.delta      = 0;
+    hand.threads    = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    hand.g          = 0;
+    hand.dset_dim1  = DSET_DIM1;
+    hand.dset_dim2  = DSET_DIM2;
+    hand.chunk_dim1 = CHUNK_DIM1;
+    hand.chunk_dim2 = CHUNK_DIM2;
+    hand.percent    = PERCENT;
+    hand.changes    = 0;
+    hand.v          = 0;
+
+    while ((opt = getopt_long(argc, argv, "hi:j:n:m:d:p:g:s:c:e:k:v:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'h':
+                fprintf(stdout, "Help page:\n");
+                usage();
+
+                exit(0);
+
+                break;
+            case 'i':
+                if (optarg) {
+                    fprintf(stdout, "First file:\t\t\t\t\t\t%s\n", optarg);
+                    hand.file1 = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'j':
+                if (optarg) {
+                    fprintf(stdout, "Second file:\t\t\t\t\t\t%s\n", optarg);
+                    hand.file2 = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'n':
+                if (optarg) {
+                    fprintf(stdout, "Dataset:\t\t\t\t\t\t%s\n", optarg);
+                    hand.dset_name = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'm':
+                if (optarg) {
+                    hand.mode = atoi(optarg);
+                    if (hand.mode == MODE_SPARSE)
+                        fprintf(stdout, "Mode: \t\t\t\t\t\t\tsparse\n");
+                    else if (hand.mode == MODE_DENSE)
+                        fprintf(stdout, "Mode: \t\t\t\t\t\t\tdense\n");
+                    else
+                        fprintf(stdout, "Mode:\t\t\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'd':
+                if (optarg) {
+                    fprintf(stdout, "Delta:\t\t\t\t\t\t\t%s\n", optarg);
+                    hand.delta = atof(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'p':
+                if (optarg) {
+                    fprintf(stdout, "Number of threads:\t\t\t\t\t%s\n", optarg);
+                    hand.threads = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'g':
+                if (optarg) {
+                    hand.g = atoi(optarg);
+                    if (hand.g == 1)
+                        fprintf(stdout, "Generate the files: \t\t\t\t\ton\n");
+                    else if (hand.g == 0)
+                        fprintf(stdout, "Generate the files: \t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Generate the files:\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 's':
+                if (optarg) {
+                    fprintf(stdout, "Dataset dimensions:\t\t\t\t\t%s\n", optarg);
+                    parse_dims(optarg, 2, dset_dims);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'c':
+                if (optarg) {
+                    fprintf(stdout, "Chunk dimensions:\t\t\t\t\t%s\n", optarg);
+                    parse_dims(optarg, 2, chunk_dims);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'e':
+                if (optarg) {
+                    fprintf(stdout, "Percentage of defined elements:\t\t\t\t%s\n", optarg);
+                    hand.percent = atof(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'k':
+                if (optarg) {
+                    fprintf(stdout, "Number of changes:\t\t\t\t\t%s\n", optarg);
+                    hand.changes = atoll(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'v':
+                if (optarg) {
+                    hand.v = atoi(optarg);
+                    if (hand.v == 1)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\ton\n");
+                    else if (hand.v == 0)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Verbose mode:\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case ':':
+                printf("Option needs a value\n");
+                break;
+            case '?':
+                printf("Unknown option: %c\n", optopt);
+                break;
+        }
+    }
+
+    /* optind is for the extra arguments which are not parsed */
+    for (; optind < argc; optind++) {
+        printf("extra arguments not parsed: %s\n", argv[optind]);
+    }
+
+    /* Make sure the command line options are valid */
+    if (hand.mode < MODE_SPARSE || hand.mode > MODE_DENSE) {
+        printf("Mode can only be 0 or 1\n");
+        exit(2);
+    }
+
+    if (hand.delta < 0) {
+        printf("Delta can not be negative\n");
+        exit(2);
+    }
+
+    if (hand.threads < 1 || hand.threads > MAX_THREADS) {
+        printf("The number of threads must be between 1 and %d\n", MAX_THREADS);
+        exit(2);
+    }
+
+    if (hand.g < 0 || hand.g > 1) {
+        printf("Generate flag can only be 0 or 1 \n");
+        exit(2);
+    }
+
+    if (hand.dset_dim1 <= 0 || hand.dset_dim2 <= 0 || hand.chunk_dim1 <= 0 || hand.chunk_dim2 <= 0) {
+        printf("The dataset and chunk dimensions must be positive\n");
+        exit(2);
+    }
+
+    if (hand.percent <= 0 || hand.percent > 100) {
+        printf("The percentage of defined elements must be between 0 and 100\n");
+        exit(2);
+    }
+
+    if (hand.changes < 0) {
+        printf("The number of changes can not be negative\n");
+        exit(2);
+    }
+
+    if (hand.v < 0 || hand.v > 1) {
+        printf("Verbose flag can only be 0 or 1 \n");
+        exit(2);
+    }
+}
+
+/*------------------------------------------------------------
+ * Elapsed time
+ *------------------------------------------------------------
+ */
+double elapsed(struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*------------------------------------------------------------
+ * Drop the pages of a file from the page cache
+ *------------------------------------------------------------
+ */
+void drop_cache(const char *file_name)
+{
+    int fd;
+
+    if ((fd = open(file_name, O_RDONLY)) < 0)
+        return;
+    fsync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+/*------------------------------------------------------------
+ * Write one chunk of a generated dataset from its mask and
+ * values
+ *------------------------------------------------------------
+ */
+int write_chunk(hid_t dset, const hsize_t *offset, const hsize_t *chunk_dims, const uint8_t *mask,
+                const int *values, sc_run_t *runs, uint8_t *sel, int *data)
+{
+    sc_chunk_info_t info;
+    const void     *buf[2];
+    uint64_t        size = chunk_dims[0] * chunk_dims[1];
+    size_t          nruns, n;
+    uint64_t        nelemts = 0;
+
+    nruns = sc_mask_to_runs(mask, size, chunk_dims[1], runs);
+    if (nruns == 0)
+        return 0;
+    for (n = 0; n < nruns; n++)
+        nelemts += runs[n].len;
+
+    memset(&info, 0, sizeof(info));
+    info.type                                    = SC_SPARSE_CHUNK;
+    info.num_sections                            = 2;
+    info.nelemts                                 = nelemts;
+    info.section_orig_size[SC_SECTION_SELECTION] = sc_encode_runs(RANK, chunk_dims, nruns, runs, sel);
+    info.section_orig_size[SC_SECTION_FIXED]     = nelemts * sizeof(int);
+    sc_gather_runs(values, sizeof(int), nruns, runs, data);
+
+    buf[SC_SECTION_SELECTION] = sel;
+    buf[SC_SECTION_FIXED]     = data;
+    return sc_write_struct_chunk(dset, H5P_DEFAULT, &info, offset, buf) < 0 ? -1 : 0;
+}
+
+/*------------------------------------------------------------
+ * Sort the changes by their position
+ *------------------------------------------------------------
+ */
+int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+/*------------------------------------------------------------
+ * Generate the two files: the second one is a copy of the
+ * first one with "changes" changes
+ *------------------------------------------------------------
+ */
+int generate_files(void)
+{
+    hid_t     file[2], dset[2], space, dcpl;
+    hsize_t   dims[RANK], chunk_dims[RANK], offset[RANK];
+    uint64_t  size = hand.chunk_dim1 * hand.chunk_dim2;
+    uint64_t  grid1, grid2, nchunks, c, e, n, ndefined, *changes, *defined;
+    uint64_t  threshold = (uint64_t)(hand.percent / 100.0 * RAND_MAX);
+    uint8_t  *mask, *touched, *sel;
+    int      *values, *data, fill = 0;
+    sc_run_t *runs;
+    long long int k, first, nchanges, next = 0;
+    int       f;
+
+    srand(2);
+
+    dims[0]       = hand.dset_dim1;
+    dims[1]       = hand.dset_dim2;
+    chunk_dims[0] = hand.chunk_dim1;
+    chunk_dims[1] = hand.chunk_dim2;
+    grid1         = (dims[0] + chunk_dims[0] - 1) / chunk_dims[0];
+    grid2         = (dims[1] + chunk_dims[1] - 1) / chunk_dims[1];
+    nchunks       = grid1 * grid2;
+
+    space = H5Screate_simple(RANK, dims, NULL);
+    dcpl  = sc_create_dcpl(RANK, chunk_dims);
+    H5Pset_fill_value(dcpl, H5T_NATIVE_INT, &fill);
+    for (f = 0; f < 2; f++) {
+        file[f] = H5Fcreate(f ? hand.file2 : hand.file1, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+        dset[f] = H5Dcreate2(file[f], hand.dset_name, H5T_NATIVE_INT, space, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+        if (dset[f] < 0) {
+            printf("Failed to create the dataset %s\n", hand.dset_name);
+            return -1;
+        }
+    }
+    H5Pclose(dcpl);
+    H5Sclose(space);
+
+    /* The changes as positions in the chunks in the logical order of the chunks */
+    changes = (uint64_t *)malloc((hand.changes ? hand.changes : 1) * sizeof(uint64_t));
+    for (k = 0; k < hand.changes; k++)
+        changes[k] = (((uint64_t)rand() * RAND_MAX + rand()) % nchunks) * size + (uint64_t)rand() % size;
+    qsort(changes, (size_t)hand.changes, sizeof(uint64_t), cmp_u64);
+
+    /* A position is changed once: two changes of it would cancel out */
+    for (k = nchanges = 0; k < hand.changes; k++)
+        if (nchanges == 0 || changes[k] != changes[nchanges - 1])
+            changes[nchanges++] = changes[k];
+
+    mask    = (uint8_t *)malloc(size);
+    touched = (uint8_t *)calloc(size, 1);
+    defined = (uint64_t *)malloc(size * sizeof(uint64_t));
+    values = (int *)malloc(size * sizeof(int));
+    data   = (int *)malloc(size * sizeof(int));
+    runs   = (sc_run_t *)malloc(size * sizeof(sc_run_t));
+    sel    = (uint8_t *)malloc(sc_encode_runs(RANK, chunk_dims, size, NULL, NULL));
+
+    for (c = 0; c < nchunks; c++) {
+        offset[0] = (c / grid2) * chunk_dims[0];
+        offset[1] = (c % grid2) * chunk_dims[1];
+
+        for (e = 0; e < size; e++) {
+            mask[e]   = (uint64_t)rand() <= threshold;
+            values[e] = mask[e] ? rand() % 1000000 + 1 : 0;
+        }
+        if (write_chunk(dset[0], offset, chunk_dims, mask, values, runs, sel, data) < 0)
+            goto error;
+
+        /* Half of the changes modify the value of a defined element drawn from the elements that no
+           other change touches; the others toggle the definition of the element at their position,
+           which the value changes also do when the chunk has no such defined element left */
+        for (first = next; next < nchanges && changes[next] / size == c; next++)
+            touched[changes[next] % size] = 1;
+        ndefined = 0;
+        if (first < next)
+            for (e = 0; e < size; e++)
+                if (mask[e] && !touched[e])
+                    defined[ndefined++] = e;
+        for (k = first; k < next; k++) {
+            e          = changes[k] % size;
+            touched[e] = 0;
+            if (k % 2 == 0 && ndefined > 0) {
+                n = (uint64_t)rand() % ndefined;
+                values[defined[n]]++;
+                defined[n] = defined[--ndefined];
+            }
+            else {
+                mask[e]   = !mask[e];
+                values[e] = mask[e] ? rand() % 1000000 + 1 : 0;
+            }
+        }
+        if (write_chunk(dset[1], offset, chunk_dims, mask, values, runs, sel, data) < 0)
+            goto error;
+    }
+
+    free(changes);
+    free(mask);
+    free(touched);
+    free(defined);
+    free(values);
+    free(data);
+    free(runs);
+    free(sel);
+    for (f = 0; f < 2; f++) {
+        H5Dclose(dset[f]);
+        H5Fclose(file[f]);
+    }
+
+    return 0;
+
+error:
+    printf("Failed to write the generated chunks\n");
+    return -1;
+}
+
+/*------------------------------------------------------------
+ * Value of an element of a predefined integer or floating-point
+ * type as a double
+ *------------------------------------------------------------
+ */
+double value_of(const diff_pass_t *pass, const uint8_t *p)
+{
+    if (pass->type_class == H5T_FLOAT)
+        return pass->elmt_size == sizeof(float) ? (double)*(const float *)p : *(const double *)p;
+
+    if (pass->sign == H5T_SGN_NONE)
+        switch (pass->elmt_size) {
+            case 1: return (double)*(const uint8_t *)p;
+            case 2: return (double)*(const uint16_t *)p;
+            case 4: return (double)*(const uint32_t *)p;
+            default: return (double)*(const uint64_t *)p;
+        }
+    switch (pass->elmt_size) {
+        case 1: return (double)*(const int8_t *)p;
+        case 2: return (double)*(const int16_t *)p;
+        case 4: return (double)*(const int32_t *)p;
+        default: return (double)*(const int64_t *)p;
+    }
+}
+
+/*------------------------------------------------------------
+ * Compare the values of two elements
+ *------------------------------------------------------------
+ */
+int values_differ(const diff_pass_t *pass, const uint8_t *a, const uint8_t *b)
+{
+    double d;
+
+    if (hand.delta == 0)
+        return memcmp(a, b, pass->elmt_size) != 0;
+    d = value_of(pass, a) - value_of(pass, b);
+    return d > hand.delta || d < -hand.delta;
+}
+
+/*------------------------------------------------------------
+ * Record a difference for the report
+ *------------------------------------------------------------
+ */
+void add_diff(const diff_pass_t *pass, stats_t *st, size_t pair, uint64_t elem, int kind, const uint8_t *a,
+              const uint8_t *b)
+{
+    diff_t *d;
+
+    if (st->nreport == MAX_REPORT)
+        return;
+    d       = &st->report[st->nreport++];
+    d->pair = pair;
+    d->elem = elem;
+    d->kind = kind;
+    memcpy(d->value1, a ? a : pass->fill, pass->elmt_size);
+    memcpy(d->value2, b ? b : pass->fill, pass->elmt_size);
+}
+
+/*------------------------------------------------------------
+ * Read a stored chunk and decode its prefix
+ *------------------------------------------------------------
+ */
+int read_chunk(diff_pass_t *pass, int f, const sc_chunk_loc_t *loc, scratch_t *s, sc_chunk_info_t *info,
+               stats_t *st)
+{
+    size_t done = 0, size = (size_t)loc->size;
+
+    if (size > s->image_max[f]) {
+        uint8_t *tmp;
+
+        if (NULL == (tmp = (uint8_t *)realloc(s->image[f], size)))
+            return -1;
+        s->image[f]     = tmp;
+        s->image_max[f] = size;
+    }
+    while (done < size) {
+        ssize_t n = pread(pass->fd[f], s->image[f] + done, size - done, (off_t)(loc->addr + done));
+
+        if (n <= 0)
+            return -1;
+        done += (size_t)n;
+    }
+    st->read_bytes += (long long int)size;
+
+    if (sc_disassemble_chunk(s->image[f], size, info, NULL) < 0 || info->type != SC_SPARSE_CHUNK ||
+        info->num_sections != 2 || info->section_orig_size[SC_SECTION_FIXED] != info->nelemts * pass->elmt_size)
+        return -1;
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Stored bytes of a section of a chunk read with read_chunk
+ *------------------------------------------------------------
+ */
+const uint8_t *stored_section(const scratch_t *s, int f, const sc_chunk_info_t *info, unsigned i)
+{
+    const uint8_t *p = s->image[f] + SC_PREFIX_SIZE;
+    unsigned       j;
+
+    for (j = 0; j < i; j++)
+        p += info->section_size[j];
+    return p;
+}
+
+/*------------------------------------------------------------
+ * Check if a section of two chunks is stored with the same
+ * bytes; the checksums of the selections are compared too
+ *------------------------------------------------------------
+ */
+int same_stored(const scratch_t *s, const sc_chunk_info_t info[2], unsigned i)
+{
+    return info[0].section_size[i] == info[1].section_size[i] &&
+           info[0].section_orig_size[i] == info[1].section_orig_size[i] &&
+           info[0].pipeline[i] == info[1].pipeline[i] && info[0].filter_mask[i] == info[1].filter_mask[i] &&
+           memcmp(stored_section(s, 0, &info[0], i), stored_section(s, 1, &info[1], i),
+                  (size_t)info[0].section_size[i]) == 0;
+}
+
+/*------------------------------------------------------------
+ * Decode a section of a chunk read with read_chunk into the
+ * scratch buffers
+ *------------------------------------------------------------
+ */
+int decode_section(scratch_t *s, int f, const sc_chunk_info_t *info, unsigned i)
+{
+    size_t size = (size_t)info->section_orig_size[i] + 1;
+
+    if (size > s->section_max[f][i]) {
+        uint8_t *tmp;
+
+        if (NULL == (tmp = (uint8_t *)realloc(s->sections[f][i], size)))
+            return -1;
+        s->sections[f][i]    = tmp;
+        s->section_max[f][i] = size;
+    }
+    return sc_decode_section(info, i, stored_section(s, f, info, i), s->sections[f][i]);
+}
+
+/*------------------------------------------------------------
+ * Positions of the defined elements of a chunk from its
+ * decoded selection
+ *------------------------------------------------------------
+ */
+int defined_elements(scratch_t *s, int f, const sc_chunk_info_t *info)
+{
+    hsize_t  dims[SC_MAX_RANK];
+    size_t   nruns, n;
+    uint64_t k = 0, e;
+    int      rank;
+
+    if (sc_decode_runs(s->sections[f][SC_SECTION_SELECTION], (size_t)info->section_orig_size[SC_SECTION_SELECTION],
+                       &rank, dims, &nruns, NULL) < 0)
+        return -1;
+    if (nruns > s->max_runs[f]) {
+        sc_run_t *tmp;
+
+        if (NULL == (tmp = (sc_run_t *)realloc(s->runs[f], nruns * sizeof(sc_run_t))))
+            return -1;
+        s->runs[f]     = tmp;
+        s->max_runs[f] = nruns;
+    }
+    if (sc_decode_runs(s->sections[f][SC_SECTION_SELECTION], (size_t)info->section_orig_size[SC_SECTION_SELECTION],
+                       &rank, dims, &nruns, s->runs[f]) < 0)
+        return -1;
+
+    if (info->nelemts > s->max_elems[f]) {
+        uint64_t *tmp;
+
+        if (NULL == (tmp = (uint64_t *)realloc(s->elems[f], info->nelemts * sizeof(uint64_t))))
+            return -1;
+        s->elems[f]     = tmp;
+        s->max_elems[f] = (size_t)info->nelemts;
+    }
+    for (n = 0; n < nruns; n++)
+        for (e = s->runs[f][n].start; e < s->runs[f][n].start + s->runs[f][n].len; e++) {
+            if (k == info->nelemts)
+                return -1;
+            s->elems[f][k++] = e;
+        }
+
+    return k == info->nelemts ? 0 : -1;
+}
+
+/*------------------------------------------------------------
+ * Sparse mode: compare the selections, then the data
+ *------------------------------------------------------------
+ */
+int diff_sparse(diff_pass_t *pass, size_t pair, scratch_t *s, stats_t *st)
+{
+    const pair_t   *p = &pass->pairs[pair];
+    sc_chunk_info_t info[2];
+    uint64_t        i, j;
+    int             have_elems = 0;
+    int             f;
+
+    /* A chunk stored in one file only: all its defined elements differ */
+    if (!p->loc[0] || !p->loc[1]) {
+        f = p->loc[0] ? 0 : 1;
+        if (read_chunk(pass, f, p->loc[f], s, &info[f], st) < 0)
+            return -1;
+        st->nonly++;
+        st->nelmts_only += (long long int)info[f].nelemts;
+        if (st->nreport < MAX_REPORT) {
+            if (decode_section(s, f, &info[f], SC_SECTION_SELECTION) < 0 ||
+                decode_section(s, f, &info[f], SC_SECTION_FIXED) < 0 || defined_elements(s, f, &info[f]) < 0)
+                return -1;
+            for (i = 0; i < info[f].nelemts && st->nreport < MAX_REPORT; i++) {
+                const uint8_t *v = s->sections[f][SC_SECTION_FIXED] + i * pass->elmt_size;
+
+                add_diff(pass, st, pair, s->elems[f][i], f ? DIFF_ONLY_2 : DIFF_ONLY_1, f ? NULL : v, f ? v : NULL);
+            }
+        }
+        return 0;
+    }
+
+    for (f = 0; f < 2; f++)
+        if (read_chunk(pass, f, p->loc[f], s, &info[f], st) < 0)
+            return -1;
+
+    if (same_stored(s, info, SC_SECTION_SELECTION)) {
+        st->nsame_sel++;
+        if (same_stored(s, info, SC_SECTION_FIXED)) {
+            st->nsame_data++;
+            return 0;
+        }
+
+        /* The same defined elements: the packed values are compared in place; the positions of the
+           elements are decoded only for the report */
+        for (f = 0; f < 2; f++)
+            if (decode_section(s, f, &info[f], SC_SECTION_FIXED) < 0)
+                return -1;
+        for (i = 0; i < info[0].nelemts; i++) {
+            const uint8_t *a = s->sections[0][SC_SECTION_FIXED] + i * pass->elmt_size;
+            const uint8_t *b = s->sections[1][SC_SECTION_FIXED] + i * pass->elmt_size;
+
+            if (!values_differ(pass, a, b))
+                continue;
+            st->ndiff++;
+            if (st->nreport < MAX_REPORT) {
+                if (!have_elems && (decode_section(s, 0, &info[0], SC_SECTION_SELECTION) < 0 ||
+                                    defined_elements(s, 0, &info[0]) < 0))
+                    return -1;
+                have_elems = 1;
+                add_diff(pass, st, pair, s->elems[0][i], DIFF_VALUE, a, b);
+            }
+        }
+        return 0;
+    }
+
+    /* Different selections: merge the defined elements by their position */
+    for (f = 0; f < 2; f++)
+        if (decode_section(s, f, &info[f], SC_SECTION_SELECTION) < 0 ||
+            decode_section(s, f, &info[f], SC_SECTION_FIXED) < 0 || defined_elements(s, f, &info[f]) < 0)
+            return -1;
+
+    i = j = 0;
+    while (i < info[0].nelemts || j < info[1].nelemts) {
+        const uint8_t *a = s->sections[0][SC_SECTION_FIXED] + i * pass->elmt_size;
+        const uint8_t *b = s->sections[1][SC_SECTION_FIXED] + j * pass->elmt_size;
+
+        if (j == info[1].nelemts || (i < info[0].nelemts && s->elems[0][i] < s->elems[1][j])) {
+            st->nelmts_only++;
+            add_diff(pass, st, pair, s->elems[0][i], DIFF_ONLY_1, a, NULL);
+            i++;
+        }
+        else if (i == info[0].nelemts || s->elems[1][j] < s->elems[0][i]) {
+            st->nelmts_only++;
+            add_diff(pass, st, pair, s->elems[1][j], DIFF_ONLY_2, NULL, b);
+            j++;
+        }
+        else {
+            if (values_differ(pass, a, b)) {
+                st->ndiff++;
+                add_diff(pass, st, pair, s->elems[0][i], DIFF_VALUE, a, b);
+            }
+            i++;
+            j++;
+        }
+    }
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Dense mode: expand both chunks with the fill value and
+ * compare all their elements
+ *------------------------------------------------------------
+ */
+int diff_dense(diff_pass_t *pass, size_t pair, scratch_t *s, stats_t *st)
+{
+    const pair_t   *p = &pass->pairs[pair];
+    sc_chunk_info_t info;
+    uint64_t        e;
+    size_t          n;
+    int             f;
+
+    for (f = 0; f < 2; f++) {
+        uint8_t       *dense = s->dense[f];
+        const uint8_t *src;
+
+        for (e = 0; e < pass->chunk_nelmts; e++)
+            memcpy(dense + e * pass->elmt_size, pass->fill, pass->elmt_size);
+        if (!p->loc[f])
+            continue;
+
+        if (read_chunk(pass, f, p->loc[f], s, &info, st) < 0 ||
+            decode_section(s, f, &info, SC_SECTION_SELECTION) < 0 || decode_section(s, f, &info, SC_SECTION_FIXED) < 0 ||
+            defined_elements(s, f, &info) < 0)
+            return -1;
+        src = s->sections[f][SC_SECTION_FIXED];
+        for (n = 0; n < info.nelemts; n++)
+            memcpy(dense + s->elems[f][n] * pass->elmt_size, src + n * pass->elmt_size, pass->elmt_size);
+    }
+    if (!p->loc[0] || !p->loc[1])
+        st->nonly++;
+
+    for (e = 0; e < pass->chunk_nelmts; e++) {
+        const uint8_t *a = s->dense[0] + e * pass->elmt_size;
+        const uint8_t *b = s->dense[1] + e * pass->elmt_size;
+
+        if (values_differ(pass, a, b)) {
+            st->ndiff++;
+            add_diff(pass, st, pair, e, DIFF_VALUE, a, b);
+        }
+    }
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Thread of the comparison: takes batches of pairs of chunks
+ * until all pairs have been taken
+ *------------------------------------------------------------
+ */
+void *diff_thread(void *arg)
+{
+    diff_pass_t *pass = ((void **)arg)[0];
+    stats_t     *st   = ((void **)arg)[1];
+    scratch_t    s;
+    size_t       first, n;
+    int          f, i, ret;
+
+    memset(&s, 0, sizeof(s));
+    if (hand.mode == MODE_DENSE)
+        for (f = 0; f < 2; f++)
+            s.dense[f] = (uint8_t *)malloc(pass->chunk_nelmts * pass->elmt_size);
+
+    while ((first = __sync_fetch_and_add(&pass->next, BATCH_CHUNKS)) < pass->npairs)
+        for (n = first; n < first + BATCH_CHUNKS && n < pass->npairs; n++) {
+            st->nchunks++;
+            ret = hand.mode == MODE_DENSE ? diff_dense(pass, n, &s, st) : diff_sparse(pass, n, &s, st);
+            if (ret < 0)
+                st->ninvalid++;
+        }
+
+    for (f = 0; f < 2; f++) {
+        free(s.image[f]);
+        for (i = 0; i < SC_MAX_SECTIONS; i++)
+            free(s.sections[f][i]);
+        free(s.runs[f]);
+        free(s.elems[f]);
+        free(s.dense[f]);
+    }
+
+    return NULL;
+}
+
+/*------------------------------------------------------------
+ * Compare two chunk offsets in the logical order of the chunks
+ *------------------------------------------------------------
+ */
+int cmp_offset(const hsize_t *a, const hsize_t *b, int rank)
+{
+    int i;
+
+    for (i = 0; i < rank; i++)
+        if (a[i] != b[i])
+            return a[i] < b[i] ? -1 : 1;
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Sort the reported differences by their position
+ *------------------------------------------------------------
+ */
+int cmp_diff(const void *a, const void *b)
+{
+    const diff_t *x = (const diff_t *)a, *y = (const diff_t *)b;
+
+    if (x->pair != y->pair)
+        return x->pair < y->pair ? -1 : 1;
+    return x->elem < y->elem ? -1 : x->elem > y->elem;
+}
+
+/*------------------------------------------------------------
+ * Print the first differences in the h5diff form
+ *------------------------------------------------------------
+ */
+void print_diffs(const diff_pass_t *pass, diff_t *report, int nreport)
+{
+    const char *kind_name[3] = {"", "(only in first)", "(only in second)"};
+    int         n, i;
+
+    if (nreport == 0)
+        return;
+
+    printf("\n");
+    printf("dataset: </%s> and </%s>\n", hand.dset_name, hand.dset_name);
+    printf("size:           [");
+    for (i = 0; i < pass->rank; i++)
+        printf(i ? "x%llu" : "%llu", (unsigned long long)pass->dims[i]);
+    printf("]           [");
+    for (i = 0; i < pass->rank; i++)
+        printf(i ? "x%llu" : "%llu", (unsigned long long)pass->dims[i]);
+    printf("]\n");
+    printf("position        %-15s %-15s difference\n", hand.dset_name, hand.dset_name);
+    printf("------------------------------------------------------------\n");
+    for (n = 0; n < nreport; n++) {
+        const pair_t *p   = &pass->pairs[report[n].pair];
+        const hsize_t *off = (p->loc[0] ? p->loc[0] : p->loc[1])->offset;
+        hsize_t        coords[SC_MAX_RANK];
+        uint64_t       rem = report[n].elem;
+        double         a   = 0, b = 0;
+
+        for (i = pass->rank - 1; i >= 0; i--) {
+            coords[i] = off[i] + rem % pass->chunk_dims[i];
+            rem /= pass->chunk_dims[i];
+        }
+        printf("[ ");
+        for (i = 0; i < pass->rank; i++)
+            printf("%llu ", (unsigned long long)coords[i]);
+        printf("]");
+        if (pass->type_class == H5T_INTEGER || pass->type_class == H5T_FLOAT) {
+            a = value_of(pass, report[n].value1);
+            b = value_of(pass, report[n].value2);
+            printf("  %-15g %-15g %-15g %s\n", a, b, a > b ? a - b : b - a, kind_name[report[n].kind]);
+        }
+        else
+            printf("  %s\n", report[n].kind == DIFF_VALUE ? "(values differ)" : kind_name[report[n].kind]);
+    }
+}
+
+/*------------------------------------------------------------
+ * Print the results
+ *------------------------------------------------------------
+ */
+void print_results(const stats_t *st, double index_time, double diff_time)
+{
+    long long int ndiffs = st->nelmts_only + st->ndiff;
+
+    printf("%lli differences found\n", ndiffs);
+    printf("\n");
+    printf("Printing the number of chunks compared (NC), chunks in one file only (N1), chunks with the same\n");
+    printf("selection (SS) and data (SD), elements defined in one file only (E1), values that differ (ND),\n");
+    printf("bytes read (IB), time of the index lookup (TI) and of the comparison (TC) in seconds, and MB/s (MBS)\n");
+    printf("\n");
+    printf("      mode         NC         N1         SS         SD         E1         ND         IB         TI         TC        MBS\n");
+    printf("\n");
+    printf("%10s %10lli %10lli %10lli %10lli %10lli %10lli %10lli %10.4f %10.4f %10.2f \n",
+           hand.mode == MODE_DENSE ? "dense" : "sparse", st->nchunks, st->nonly, st->nsame_sel, st->nsame_data,
+           st->nelmts_only, st->ndiff, st->read_bytes, index_time, diff_time,
+           diff_time > 0 ? (double)st->read_bytes / diff_time / (1024.0 * 1024.0) : 0.0);
+    if (st->ninvalid)
+        printf("\n%lli pairs of chunks could not be compared\n", st->ninvalid);
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Compare the datasets
+ *------------------------------------------------------------
+ */
+int diff_datasets(void)
+{
+    struct timespec start;
+    pthread_t       threads[MAX_THREADS];
+    void           *args[MAX_THREADS][2];
+    diff_pass_t    *pass;
+    stats_t         total;
+    diff_t          report[MAX_THREADS * MAX_REPORT];
+    hid_t           file[2] = {H5I_INVALID_HID, H5I_INVALID_HID}, dset[2] = {H5I_INVALID_HID, H5I_INVALID_HID};
+    hid_t           dtype = H5I_INVALID_HID, dcpl = H5I_INVALID_HID;
+    hsize_t         dims[2][SC_MAX_RANK], chunk_dims[2][SC_MAX_RANK];
+    sc_chunk_loc_t *locs[2] = {NULL, NULL};
+    size_t          nlocs[2], k[2] = {0, 0};
+    double          index_time, diff_time;
+    int             rank[2], nreport = 0, f, i;
+    int             ret = 2;
+
+    pass = (diff_pass_t *)calloc(1, sizeof(diff_pass_t));
+    pass->fd[0] = pass->fd[1] = -1;
+
+    for (f = 0; f < 2; f++) {
+        const char *name = f ? hand.file2 : hand.file1;
+        hid_t       space;
+
+        drop_cache(name);
+        if ((file[f] = H5Fopen(name, H5F_ACC_RDONLY, H5P_DEFAULT)) < 0 ||
+            (dset[f] = H5Dopen2(file[f], hand.dset_name, H5P_DEFAULT)) < 0) {
+            printf("Failed to open the dataset %s of %s\n", hand.dset_name, name);
+            goto done;
+        }
+        space   = H5Dget_space(dset[f]);
+        rank[f] = H5Sget_simple_extent_dims(space, dims[f], NULL);
+        H5Sclose(space);
+        dcpl = H5Dget_create_plist(dset[f]);
+        if (rank[f] < 1 || rank[f] > SC_MAX_RANK || H5Pget_chunk(dcpl, rank[f], chunk_dims[f]) != rank[f]) {
+            printf("The dataset %s of %s is not a structured chunk dataset\n", hand.dset_name, name);
+            goto done;
+        }
+        if (f == 0) {
+            dtype            = H5Dget_type(dset[f]);
+            pass->elmt_size  = H5Tget_size(dtype);
+            pass->type_class = H5Tget_class(dtype);
+            pass->sign       = pass->type_class == H5T_INTEGER ? H5Tget_sign(dtype) : H5T_SGN_NONE;
+            pass->fill       = (uint8_t *)calloc(1, pass->elmt_size);
+            H5Pget_fill_value(dcpl, dtype, pass->fill);
+        }
+        H5Pclose(dcpl);
+        dcpl = H5I_INVALID_HID;
+    }
+
+    /* The datasets are comparable if they have the same shape, chunks and type */
+    if (rank[0] != rank[1] || memcmp(dims[0], dims[1], (size_t)rank[0] * sizeof(hsize_t)) ||
+        memcmp(chunk_dims[0], chunk_dims[1], (size_t)rank[0] * sizeof(hsize_t))) {
+        printf("Not comparable: the datasets have different dimensions or chunk dimensions\n");
+        goto done;
+    }
+    {
+        hid_t dtype2 = H5Dget_type(dset[1]);
+        int   equal  = H5Tequal(dtype, dtype2) > 0;
+
+        H5Tclose(dtype2);
+        if (!equal) {
+            printf("Not comparable: the datasets have different datatypes\n");
+            goto done;
+        }
+    }
+    if (hand.delta > 0 && ((pass->type_class != H5T_INTEGER && pass->type_class != H5T_FLOAT) ||
+                           H5Tget_order(dtype) != H5Tget_order(H5T_NATIVE_INT) ||
+                           (pass->type_class == H5T_FLOAT && pass->elmt_size != sizeof(float) &&
+                            pass->elmt_size != sizeof(double)))) {
+        printf("The delta is supported for the predefined integer and floating-point types only\n");
+        goto done;
+    }
+    pass->rank         = rank[0];
+    pass->chunk_nelmts = 1;
+    for (i = 0; i < rank[0]; i++) {
+        pass->dims[i]       = dims[0][i];
+        pass->chunk_dims[i] = chunk_dims[0][i];
+        pass->chunk_nelmts *= chunk_dims[0][i];
+    }
+
+    /* The chunk indexes are matched in the logical order of the chunks */
+    if (hand.v) printf("Getting the chunk indexes\n");
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (f = 0; f < 2; f++)
+        if (sc_get_chunk_locations(dset[f], &nlocs[f], &locs[f]) < 0) {
+            printf("Failed to get the chunks of %s\n", f ? hand.file2 : hand.file1);
+            goto done;
+        }
+    pass->pairs = (pair_t *)malloc((nlocs[0] + nlocs[1] + 1) * sizeof(pair_t));
+    while (k[0] < nlocs[0] || k[1] < nlocs[1]) {
+        pair_t *p = &pass->pairs[pass->npairs++];
+        int     c;
+
+        if (k[1] == nlocs[1])
+            c = -1;
+        else if (k[0] == nlocs[0])
+            c = 1;
+        else
+            c = cmp_offset(locs[0][k[0]].offset, locs[1][k[1]].offset, pass->rank);
+        p->loc[0] = c <= 0 ? &locs[0][k[0]++] : NULL;
+        p->loc[1] = c >= 0 ? &locs[1][k[1]++] : NULL;
+    }
+    index_time = elapsed(&start);
+
+    for (f = 0; f < 2; f++)
+        if ((pass->fd[f] = open(f ? hand.file2 : hand.file1, O_RDONLY)) < 0) {
+            printf("Failed to open %s\n", f ? hand.file2 : hand.file1);
+            goto done;
+        }
+
+    if (hand.v) printf("Comparing %zu pairs of chunks with %d threads\n", pass->npairs, hand.threads);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < hand.threads; i++) {
+        args[i][0] = pass;
+        args[i][1] = &pass->stats[i];
+        pthread_create(&threads[i], NULL, diff_thread, args[i]);
+    }
+    for (i = 0; i < hand.threads; i++)
+        pthread_join(threads[i], NULL);
+    diff_time = elapsed(&start);
+
+    /* Merge the statistics and the first differences of the threads */
+    memset(&total, 0, sizeof(total));
+    for (i = 0; i < hand.threads; i++) {
+        const stats_t *st = &pass->stats[i];
+
+        total.nchunks += st->nchunks;
+        total.nonly += st->nonly;
+        total.nsame_sel += st->nsame_sel;
+        total.nsame_data += st->nsame_data;
+        total.nelmts_only += st->nelmts_only;
+        total.ndiff += st->ndiff;
+        total.ninvalid += st->ninvalid;
+        total.read_bytes += st->read_bytes;
+        memcpy(&report[nreport], st->report, (size_t)st->nreport * sizeof(diff_t));
+        nreport += st->nreport;
+    }
+    qsort(report, (size_t)nreport, sizeof(diff_t), cmp_diff);
+
+    print_diffs(pass, report, nreport < MAX_REPORT ? nreport : MAX_REPORT);
+    print_results(&total, index_time, diff_time);
+
+    if (total.ninvalid)
+        ret = 2;
+    else
+        ret = total.nelmts_only + total.ndiff ? 1 : 0;
+
+done:
+    for (f = 0; f < 2; f++) {
+        if (pass->fd[f] >= 0)
+            close(pass->fd[f]);
+        free(locs[f]);
+        if (dset[f] >= 0)
+            H5Dclose(dset[f]);
+        if (file[f] >= 0)
+            H5Fclose(file[f]);
+    }
+    if (dcpl >= 0)
+        H5Pclose(dcpl);
+    if (dtype >= 0)
+        H5Tclose(dtype);
+    free(pass->pairs);
+    free(pass->fill);
+    free(pass);
+
+    return ret;
+}
+
+/*------------------------------------------------------------
+ * Main function
+ *------------------------------------------------------------
+ */
+int
+main(int argc, char **argv)
+{
+    int ret;
+
+    parse_command_line(argc, argv);
+
+    if (hand.g) {
+        if (hand.v) printf("Generating %s and %s\n", hand.file1, hand.file2);
+        if (generate_files() < 0)
+            return 2;
+    }
+
+    ret = diff_datasets();
+
+    if (hand.v) printf("Done! \n");
+
+    return ret;
+}
@@ -0,0 +1,730 @@
+/*
+ * This program dumps the defined elements of a sparse structured chunk dataset in the DDL proposed for
+ * h5dump in RFC-HDF5-Tools (STRUCTURED_CHUNK layout, DEFINED_SPARSE_DATA).  Structured chunks are
+ * emulated as described in structured_chunk.h.
+ *
+ * The dataset is dumped chunk by chunk: sc_iterate_chunks() visits the stored chunks in the logical
+ * order without building a list of the chunks, and each chunk is read with H5Dread_chunk, its Encoded
+ * Selection is verified and decoded into runs, and the runs are printed with their coordinates in the
+ * dataset.  The memory used does not depend on the size of the dataset; it is bounded by the buffers
+ * of the largest chunk.  Three output modes are available (option -m):
+ *
+ *  0 - locations; one line per run of defined elements, BLOCK (r,c)-(r,c') or POINT (r,c), as with the
+ *      --sparse-locations option of the RFC
+ *  1 - data (default); the locations followed by the values of the defined elements, as with the
+ *      --sparse-data option of the RFC
+ *  2 - dense; every element of the stored chunks with the fill value for undefined elements, as a dump
+ *      that is not aware of sparse storage prints them
+ *
+ * The dump is written to the file specified with the option -o or to the standard output.  With the
+ * option -b 1 the three modes are run one after the other with a cold page cache, the output goes to
+ * /dev/null unless -o is given, and the program reports for each mode the number of chunks (NC), the
+ * number of elements printed (NE), the bytes of chunks read (IB), the bytes printed (OB), the largest
+ * memory used by the chunk buffers (MEM), the time (T) and the read throughput in MB/s (MBS).
+ *
+ * To compile the program, please use h5cc.  The -h option lists all the command line options:
+ *
+ *   [-h] [-i --inFile] [-n --nameDset] [-m --mMode] [-o --outFile] [-b --bBenchmark] [-v --Verbose]
+ *
+ * Example: The commands
+ *
+ *           h5cc alloc.c -o alloc
+ *           h5cc sparse_dump.c -o sparse_dump
+ *           ./alloc -c 64x64 -g 64x64 -n 1
+ *           ./sparse_dump -i alloc_file.h5 -n sparse -o sparse.ddl
+ *           ./sparse_dump -i alloc_file.h5 -n sparse -b 1
+ *
+ * write the defined elements of the dataset "sparse" to sparse.ddl and compare the three modes.
+ */
+
+#include "hdf5.h"
+#include "structured_chunk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <getopt.h>
+
+#define FILE_NAME                       "alloc_file.h5"
+#define DSET_NAME                       "sparse"
+#define MODE_LOCATIONS                  0
+#define MODE_DATA                       1
+#define MODE_DENSE                      2
+#define NUM_MODES                       3
+#define INDENT                          "      "
+
+typedef struct {
+    char           *in_file;
+    char           *dset_name;
+    int             mode;
+    char           *out_file;        /* NULL for the standard output */
+    int             b;               /* flag to run the benchmark of all modes */
+    int             v;               /* prints progress messages */
+} handler_t;
+
+/* State of the dump of one dataset */
+typedef struct {
+    FILE           *out;
+    hid_t           dset;
+    hid_t           file_type;
+    hid_t           mem_type;
+    size_t          file_size;       /* size of an element in the file */
+    size_t          mem_size;        /* size of an element in memory */
+    H5T_class_t     type_class;
+    H5T_sign_t      sign;
+    int             rank;
+    hsize_t         dims[SC_MAX_RANK];
+    hsize_t         chunk_dims[SC_MAX_RANK];
+    int             mode;
+    uint8_t        *fill;            /* fill value in the memory type */
+    uint8_t        *image;           /* buffers sized for the largest chunk so far */
+    uint8_t        *sel;
+    uint8_t        *data;
+    uint8_t        *dense;
+    sc_run_t       *runs;
+    size_t          image_max, sel_max, data_max, runs_max;
+    long long int   nchunks;
+    long long int   nelemts;         /* elements printed */
+    long long int   in_bytes;        /* bytes of chunks read */
+    long long int   out_bytes;       /* bytes printed */
+} dump_t;
+
+typedef struct {
+    const char     *mode;
+    long long int   nchunks;
+    long long int   nelemts;
+    long long int   in_bytes;
+    long long int   out_bytes;
+    long long int   mem;             /* memory used by the chunk buffers */
+    double          time;
+} result_t;
+
+handler_t    hand;
+result_t     res[NUM_MODES];
+
+/*------------------------------------------------------------
+ * Display command line usage
+ *------------------------------------------------------------
+ */
+void
+usage(void)
+{
+    printf("    [-h] [-i --inFile] [-n --nameDset] [-m --mMode] [-o --outFile] [-b --bBenchmark] [-v --Verbose]\n");
+    printf("    [-h --help]: this help page\n");
+    printf("    [-i --inFile]: the file with the structured chunk dataset (default %s)\n", FILE_NAME);
+    printf("    [-n --nameDset]: the name of the dataset (default %s)\n", DSET_NAME);
+    printf("    [-m --mMode]: print the locations (0), the locations and the values (1, default) or all elements (2)\n");
+    printf("    [-o --outFile]: the file the dump is written to (default the standard output)\n");
+    printf("    [-b --bBenchmark]: compare the three modes (1); default dump with one mode (0)\n");
+    printf("    [-v --Verbose]: Print progress messages(1); default no messages displayed (0) \n");
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Parse command line option
+ *------------------------------------------------------------
+ */
+void
+parse_command_line(int argc, char *argv[])
+{
+    int           opt;
+    struct option long_options[] = {
+                                    {"help", no_argument, NULL, 'h'},
+                                    {"inFile=", required_argument, NULL, 'i'},
+                                    {"nameDset=", required_argument, NULL, 'n'},
+                                    {"mMode=", required_argument, NULL, 'm'},
+                                    {"outFile=", required_argument, NULL, 'o'},
+                                    {"bBenchmark=", required_argument, NULL, 'b'},
+                                    {"Verbose=", required_argument, NULL, 'v'},
+                                    {NULL, 0, NULL, 0}};
+
+    /* Initialize the command line options */
+    hand.in_file   = FILE_NAME;
+    hand.dset_name = DSET_NAME;
+    hand.mode      = MODE_DATA;
+    hand.out_file  = NULL;
+    hand.b         = 0;
+    hand.v         = 0;
+
+    while ((opt = getopt_long(argc, argv, "hi:n:m:o:b:v:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'h':
+                fprintf(stdout, "Help page:\n");
+                usage();
+
+                exit(0);
+
+                break;
+            case 'i':
+                if (optarg) {
+                    fprintf(stdout, "Input file:\t\t\t\t\t\t%s\n", optarg);
+                    hand.in_file = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'n':
+                if (optarg) {
+                    fprintf(stdout, "Dataset:\t\t\t\t\t\t%s\n", optarg);
+                    hand.dset_name = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'm':
+                if (optarg) {
+                    hand.mode = atoi(optarg);
+                    if (hand.mode == MODE_LOCATIONS)
+                        fprintf(stdout, "Dump mode:\t\t\t\t\t\tlocations\n");
+                    else if (hand.mode == MODE_DATA)
+                        fprintf(stdout, "Dump mode:\t\t\t\t\t\tdata\n");
+                    else if (hand.mode == MODE_DENSE)
+                        fprintf(stdout, "Dump mode:\t\t\t\t\t\tdense\n");
+                    else
+                        fprintf(stdout, "Dump mode:\t\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'o':
+                if (optarg) {
+                    fprintf(stdout, "Output file:\t\t\t\t\t\t%s\n", optarg);
+                    hand.out_file = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'b':
+                if (optarg) {
+                    hand.b = atoi(optarg);
+                    if (hand.b == 1)
+                        fprintf(stdout, "Benchmark of the modes: \t\t\t\ton\n");
+                    else if (hand.b == 0)
+                        fprintf(stdout, "Benchmark of the modes: \t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Benchmark of the modes:\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'v':
+                if (optarg) {
+                    hand.v = atoi(optarg);
+                    if (hand.v == 1)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\ton\n");
+                    else if (hand.v == 0)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Verbose mode:\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case ':':
+                printf("Option needs a value\n");
+                break;
+            case '?':
+                printf("Unknown option: %c\n", optopt);
+                break;
+        }
+    }
+
+    /* optind is for the extra arguments which are not parsed */
+    for (; optind < argc; optind++) {
+        printf("extra arguments not parsed: %s\n", argv[optind]);
+    }
+
+    /* Make sure the command line options are valid */
+    if (hand.mode < MODE_LOCATIONS || hand.mode > MODE_DENSE) {
+        printf("Dump mode can only be 0, 1 or 2 \n");
+        exit(1);
+    }
+
+    if (hand.b < 0 || hand.b > 1) {
+        printf("Benchmark flag can only be 0 or 1 \n");
+        exit(1);
+    }
+
+    if (hand.v < 0 || hand.v > 1) {
+        printf("Verbose flag can only be 0 or 1 \n");
+        exit(1);
+    }
+}
+
+/*------------------------------------------------------------
+ * Print the counts and the time of each mode
+ *------------------------------------------------------------
+ */
+void print_results(void)
+{
+    int i;
+
+    printf("\n");
+    printf("Printing the mode, number of chunks (NC), elements printed (NE), bytes of chunks read (IB),\n");
+    printf("bytes printed (OB), memory of the chunk buffers in bytes (MEM), time in seconds (T) and\n");
+    printf("MB of chunks read per second (MBS)\n");
+    printf("\n");
+    printf("      mode         NC         NE         IB         OB        MEM          T        MBS\n");
+    printf("\n");
+
+    for (i = 0; i < NUM_MODES; i++)
+        printf("%10s %10lli %10lli %10lli %10lli %10lli %10.4f %10.2f \n", res[i].mode, res[i].nchunks,
+               res[i].nelemts, res[i].in_bytes, res[i].out_bytes, res[i].mem, res[i].time,
+               res[i].in_bytes / res[i].time / 1e6);
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Elapsed time
+ *------------------------------------------------------------
+ */
+double elapsed(struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*------------------------------------------------------------
+ * Drop the pages of a file from the page cache
+ *------------------------------------------------------------
+ */
+void drop_cache(const char *file_name)
+{
+    int fd;
+
+    if ((fd = open(file_name, O_RDONLY)) < 0)
+        return;
+    fsync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+/*------------------------------------------------------------
+ * Name of a predefined datatype in the DDL
+ *------------------------------------------------------------
+ */
+const char *type_name(hid_t type)
+{
+    struct {
+        hid_t       id;
+        const char *name;
+    } types[] = {{H5T_STD_I8LE, "H5T_STD_I8LE"},       {H5T_STD_I8BE, "H5T_STD_I8BE"},
+                 {H5T_STD_U8LE, "H5T_STD_U8LE"},       {H5T_STD_U8BE, "H5T_STD_U8BE"},
+                 {H5T_STD_I16LE, "H5T_STD_I16LE"},     {H5T_STD_I16BE, "H5T_STD_I16BE"},
+                 {H5T_STD_U16LE, "H5T_STD_U16LE"},     {H5T_STD_U16BE, "H5T_STD_U16BE"},
+                 {H5T_STD_I32LE, "H5T_STD_I32LE"},     {H5T_STD_I32BE, "H5T_STD_I32BE"},
+                 {H5T_STD_U32LE, "H5T_STD_U32LE"},     {H5T_STD_U32BE, "H5T_STD_U32BE"},
+                 {H5T_STD_I64LE, "H5T_STD_I64LE"},     {H5T_STD_I64BE, "H5T_STD_I64BE"},
+                 {H5T_STD_U64LE, "H5T_STD_U64LE"},     {H5T_STD_U64BE, "H5T_STD_U64BE"},
+                 {H5T_IEEE_F32LE, "H5T_IEEE_F32LE"},   {H5T_IEEE_F32BE, "H5T_IEEE_F32BE"},
+                 {H5T_IEEE_F64LE, "H5T_IEEE_F64LE"},   {H5T_IEEE_F64BE, "H5T_IEEE_F64BE"}};
+    size_t i;
+
+    for (i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+        if (H5Tequal(type, types[i].id) > 0)
+            return types[i].name;
+    return NULL;
+}
+
+/*------------------------------------------------------------
+ * Print one value in the memory type; returns the number of
+ * bytes printed
+ *------------------------------------------------------------
+ */
+int print_value(dump_t *d, const uint8_t *p)
+{
+    if (d->type_class == H5T_FLOAT) {
+        if (d->mem_size == sizeof(float))
+            return fprintf(d->out, "%g", (double)*(const float *)p);
+        return fprintf(d->out, "%g", *(const double *)p);
+    }
+
+    if (d->sign == H5T_SGN_NONE) {
+        unsigned long long int v;
+
+        switch (d->mem_size) {
+            case 1: v = *(const uint8_t *)p; break;
+            case 2: v = *(const uint16_t *)p; break;
+            case 4: v = *(const uint32_t *)p; break;
+            default: v = *(const uint64_t *)p; break;
+        }
+        return fprintf(d->out, "%llu", v);
+    }
+    else {
+        long long int v;
+
+        switch (d->mem_size) {
+            case 1: v = *(const int8_t *)p; break;
+            case 2: v = *(const int16_t *)p; break;
+            case 4: v = *(const int32_t *)p; break;
+            default: v = *(const int64_t *)p; break;
+        }
+        return fprintf(d->out, "%lli", v);
+    }
+}
+
+/*------------------------------------------------------------
+ * Print the coordinates of an element; returns the number of
+ * bytes printed
+ *------------------------------------------------------------
+ */
+int print_coords(dump_t *d, const hsize_t *coords)
+{
+    int n = 0, i;
+
+    n += fprintf(d->out, "(");
+    for (i = 0; i < d->rank; i++)
+        n += fprintf(d->out, i ? ",%llu" : "%llu", (unsigned long long)coords[i]);
+    n += fprintf(d->out, ")");
+
+    return n;
+}
+
+/*------------------------------------------------------------
+ * Grow a buffer to "size" bytes
+ *------------------------------------------------------------
+ */
+int grow(uint8_t **buf, size_t *max, size_t size)
+{
+    uint8_t *tmp;
+
+    if (size <= *max)
+        return 0;
+    if (NULL == (tmp = (uint8_t *)realloc(*buf, size)))
+        return -1;
+    *buf = tmp;
+    *max = size;
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Print the runs of defined elements of a chunk in the
+ * locations or data mode
+ *------------------------------------------------------------
+ */
+void print_runs(dump_t *d, const hsize_t *offset, size_t nruns)
+{
+    const uint8_t *value = d->data;
+    hsize_t        start[SC_MAX_RANK];
+    size_t         n;
+    uint64_t       k;
+    int            i;
+
+    for (n = 0; n < nruns; n++) {
+        hsize_t rem = d->runs[n].start;
+
+        for (i = d->rank - 1; i >= 0; i--) {
+            start[i] = offset[i] + rem % d->chunk_dims[i];
+            rem /= d->chunk_dims[i];
+        }
+
+        if (d->runs[n].len == 1) {
+            d->out_bytes += fprintf(d->out, INDENT "DEFINED_SPARSE_DATA POINT ");
+            d->out_bytes += print_coords(d, start);
+        }
+        else {
+            d->out_bytes += fprintf(d->out, INDENT "DEFINED_SPARSE_DATA BLOCK ");
+            d->out_bytes += print_coords(d, start);
+            d->out_bytes += fprintf(d->out, "-");
+            start[d->rank - 1] += d->runs[n].len - 1;
+            d->out_bytes += print_coords(d, start);
+        }
+
+        if (d->mode == MODE_DATA) {
+            d->out_bytes += fprintf(d->out, ":");
+            for (k = 0; k < d->runs[n].len; k++) {
+                d->out_bytes += fprintf(d->out, k ? ", " : " ");
+                d->out_bytes += print_value(d, value);
+                value += d->mem_size;
+            }
+        }
+        d->out_bytes += fprintf(d->out, "\n");
+        d->nelemts += (long long int)d->runs[n].len;
+    }
+}
+
+/*------------------------------------------------------------
+ * Print all elements of a chunk that are in the dataset, one
+ * row of the chunk per line, with the fill value for the
+ * undefined elements
+ *------------------------------------------------------------
+ */
+void print_dense(dump_t *d, const hsize_t *offset, size_t nruns)
+{
+    hsize_t  coords[SC_MAX_RANK];
+    uint64_t chunk_nelmts = 1, row_len = d->chunk_dims[d->rank - 1], e, k;
+    size_t   n;
+    int      i;
+
+    for (i = 0; i < d->rank; i++)
+        chunk_nelmts *= d->chunk_dims[i];
+    for (e = 0; e < chunk_nelmts; e++)
+        memcpy(d->dense + e * d->mem_size, d->fill, d->mem_size);
+
+    e = 0;
+    for (n = 0; n < nruns; n++) {
+        memcpy(d->dense + d->runs[n].start * d->mem_size, d->data + e * d->mem_size, d->runs[n].len * d->mem_size);
+        e += d->runs[n].len;
+    }
+
+    for (e = 0; e < chunk_nelmts; e += row_len) {
+        hsize_t rem = e;
+        int     inside = 1;
+
+        for (i = d->rank - 1; i >= 0; i--) {
+            coords[i] = offset[i] + rem % d->chunk_dims[i];
+            rem /= d->chunk_dims[i];
+            if (coords[i] >= d->dims[i])
+                inside = 0;
+        }
+        if (!inside)
+            continue;
+
+        d->out_bytes += fprintf(d->out, INDENT);
+        d->out_bytes += print_coords(d, coords);
+        d->out_bytes += fprintf(d->out, ":");
+        for (k = 0; k < row_len && coords[d->rank - 1] + k < d->dims[d->rank - 1]; k++) {
+            d->out_bytes += fprintf(d->out, k ? ", " : " ");
+            d->out_bytes += print_value(d, d->dense + (e + k) * d->mem_size);
+            d->nelemts++;
+        }
+        d->out_bytes += fprintf(d->out, "\n");
+    }
+}
+
+/*------------------------------------------------------------
+ * Read, verify, decode and print one chunk (callback for
+ * sc_iterate_chunks)
+ *------------------------------------------------------------
+ */
+herr_t dump_chunk(const hsize_t *offset, hsize_t size, void *op_data)
+{
+    dump_t         *d = (dump_t *)op_data;
+    sc_chunk_info_t info;
+    hsize_t         sel_dims[H5S_MAX_RANK];
+    uint32_t        filters;
+    size_t          nruns, n, elmt_size;
+    uint64_t        nelemts = 0;
+    int             sel_rank;
+    void           *buf[2];
+
+    if (grow(&d->image, &d->image_max, (size_t)size) < 0)
+        return -1;
+    if (H5Dread_chunk(d->dset, H5P_DEFAULT, offset, &filters, d->image) < 0)
+        return -1;
+    if (sc_disassemble_chunk(d->image, (size_t)size, &info, NULL) < 0 || info.type != SC_SPARSE_CHUNK) {
+        fprintf(stderr, "The chunk at %llu is not a sparse structured chunk\n", (unsigned long long)offset[0]);
+        return -1;
+    }
+
+    /* The Data section is converted in place, so it has room for the larger of the two element sizes */
+    elmt_size = d->mem_size > d->file_size ? d->mem_size : d->file_size;
+    if (grow(&d->sel, &d->sel_max, (size_t)info.section_orig_size[SC_SECTION_SELECTION]) < 0 ||
+        grow(&d->data, &d->data_max, (size_t)info.nelemts * elmt_size + 1) < 0)
+        return -1;
+    buf[SC_SECTION_SELECTION] = d->sel;
+    buf[SC_SECTION_FIXED]     = d->data;
+    if (sc_disassemble_chunk(d->image, (size_t)size, &info, buf) < 0) {
+        fprintf(stderr, "The chunk at %llu is corrupted\n", (unsigned long long)offset[0]);
+        return -1;
+    }
+
+    if (sc_decode_runs(d->sel, (size_t)info.section_orig_size[SC_SECTION_SELECTION], &sel_rank, sel_dims, &nruns,
+                       NULL) < 0)
+        return -1;
+    if (nruns > d->runs_max) {
+        sc_run_t *tmp;
+
+        if (NULL == (tmp = (sc_run_t *)realloc(d->runs, nruns * sizeof(sc_run_t))))
+            return -1;
+        d->runs     = tmp;
+        d->runs_max = nruns;
+    }
+    sc_decode_runs(d->sel, (size_t)info.section_orig_size[SC_SECTION_SELECTION], &sel_rank, sel_dims, &nruns,
+                   d->runs);
+    for (n = 0; n < nruns; n++)
+        nelemts += d->runs[n].len;
+    if (nelemts != info.nelemts || info.section_orig_size[SC_SECTION_FIXED] != nelemts * d->file_size) {
+        fprintf(stderr, "The selection of the chunk at %llu does not match its data\n", (unsigned long long)offset[0]);
+        return -1;
+    }
+
+    if (d->mode != MODE_LOCATIONS && nelemts > 0 &&
+        H5Tconvert(d->file_type, d->mem_type, (size_t)nelemts, d->data, NULL, H5P_DEFAULT) < 0)
+        return -1;
+
+    if (d->mode == MODE_DENSE)
+        print_dense(d, offset, nruns);
+    else
+        print_runs(d, offset, nruns);
+
+    d->nchunks++;
+    d->in_bytes += (long long int)size;
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Dump the dataset with one mode
+ *------------------------------------------------------------
+ */
+int dump_dataset(int mode, FILE *out, result_t *r)
+{
+    dump_t          d;
+    struct timespec start;
+    hid_t           file, space, dcpl;
+    hsize_t         maxdims[SC_MAX_RANK];
+    uint64_t        chunk_nelmts = 1;
+    const char     *name;
+    int             i, ret = -1;
+
+    memset(&d, 0, sizeof(d));
+    d.out  = out;
+    d.mode = mode;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if ((file = H5Fopen(hand.in_file, H5F_ACC_RDONLY, H5P_DEFAULT)) < 0) {
+        printf("Failed to open %s\n", hand.in_file);
+        return -1;
+    }
+    if ((d.dset = H5Dopen2(file, hand.dset_name, H5P_DEFAULT)) < 0) {
+        printf("Failed to open the dataset %s\n", hand.dset_name);
+        H5Fclose(file);
+        return -1;
+    }
+
+    d.file_type  = H5Dget_type(d.dset);
+    d.mem_type   = H5Tget_native_type(d.file_type, H5T_DIR_ASCEND);
+    d.file_size  = H5Tget_size(d.file_type);
+    d.mem_size   = H5Tget_size(d.mem_type);
+    d.type_class = H5Tget_class(d.file_type);
+    d.sign       = d.type_class == H5T_INTEGER ? H5Tget_sign(d.file_type) : H5T_SGN_NONE;
+    if ((d.type_class != H5T_INTEGER && d.type_class != H5T_FLOAT) || NULL == (name = type_name(d.file_type))) {
+        printf("Only predefined integer and floating-point types are supported\n");
+        goto done;
+    }
+
+    space  = H5Dget_space(d.dset);
+    d.rank = H5Sget_simple_extent_dims(space, d.dims, maxdims);
+    H5Sclose(space);
+    dcpl = H5Dget_create_plist(d.dset);
+    if (d.rank < 1 || d.rank > SC_MAX_RANK || H5Pget_chunk(dcpl, d.rank, d.chunk_dims) != d.rank) {
+        printf("The dataset %s is not a structured chunk dataset\n", hand.dset_name);
+        H5Pclose(dcpl);
+        goto done;
+    }
+    d.fill = (uint8_t *)calloc(1, d.mem_size);
+    H5Pget_fill_value(dcpl, d.mem_type, d.fill);
+    H5Pclose(dcpl);
+
+    /* Only the dense mode needs the whole chunk in memory */
+    if (mode == MODE_DENSE) {
+        for (i = 0; i < d.rank; i++)
+            chunk_nelmts *= d.chunk_dims[i];
+        d.dense = (uint8_t *)malloc(chunk_nelmts * d.mem_size);
+    }
+
+    /* DDL header of the dataset */
+    d.out_bytes += fprintf(out, "HDF5 \"%s\" {\n", hand.in_file);
+    d.out_bytes += fprintf(out, "DATASET \"%s\" {\n", hand.dset_name);
+    d.out_bytes += fprintf(out, "   DATATYPE  %s\n", name);
+    d.out_bytes += fprintf(out, "   DATASPACE  SIMPLE { ( ");
+    for (i = 0; i < d.rank; i++)
+        d.out_bytes += fprintf(out, i ? ", %llu" : "%llu", (unsigned long long)d.dims[i]);
+    d.out_bytes += fprintf(out, " ) / ( ");
+    for (i = 0; i < d.rank; i++) {
+        if (maxdims[i] == H5S_UNLIMITED)
+            d.out_bytes += fprintf(out, i ? ", H5S_UNLIMITED" : "H5S_UNLIMITED");
+        else
+            d.out_bytes += fprintf(out, i ? ", %llu" : "%llu", (unsigned long long)maxdims[i]);
+    }
+    d.out_bytes += fprintf(out, " ) }\n");
+    d.out_bytes += fprintf(out, "   STORAGE_LAYOUT {\n      STRUCTURED_CHUNK ( ");
+    for (i = 0; i < d.rank; i++)
+        d.out_bytes += fprintf(out, i ? ", %llu" : "%llu", (unsigned long long)d.chunk_dims[i]);
+    d.out_bytes += fprintf(out, " ) {\n         SPARSE_CHUNK\n      }\n   }\n");
+    d.out_bytes += fprintf(out, "   DATA {\n");
+
+    if (sc_iterate_chunks(d.dset, dump_chunk, &d) != 0) {
+        printf("Failed to dump the dataset %s\n", hand.dset_name);
+        goto done;
+    }
+
+    d.out_bytes += fprintf(out, "   }\n}\n}\n");
+    fflush(out);
+
+    r->time      = elapsed(&start);
+    r->nchunks   = d.nchunks;
+    r->nelemts   = d.nelemts;
+    r->in_bytes  = d.in_bytes;
+    r->out_bytes = d.out_bytes;
+    r->mem       = (long long int)(d.image_max + d.sel_max + d.data_max + d.runs_max * sizeof(sc_run_t) +
+                             (d.dense ? chunk_nelmts * d.mem_size : 0));
+    ret = 0;
+
+done:
+    free(d.fill);
+    free(d.image);
+    free(d.sel);
+    free(d.data);
+    free(d.dense);
+    free(d.runs);
+    H5Tclose(d.mem_type);
+    H5Tclose(d.file_type);
+    H5Dclose(d.dset);
+    H5Fclose(file);
+
+    return ret;
+}
+
+/*------------------------------------------------------------
+ * Main function
+ *------------------------------------------------------------
+ */
+int
+main(int argc, char **argv)
+{
+    const char *mode_names[NUM_MODES] = {"locations", "data", "dense"};
+    const char *out_file;
+    FILE       *out;
+    int         i;
+
+    parse_command_line(argc, argv);
+
+    if (!hand.b) {
+        out = hand.out_file ? fopen(hand.out_file, "w") : stdout;
+        if (!out) {
+            printf("Failed to create %s\n", hand.out_file);
+            return 1;
+        }
+        if (dump_dataset(hand.mode, out, &res[0]) < 0)
+            return 1;
+        if (out != stdout)
+            fclose(out);
+        return 0;
+    }
+
+    out_file = hand.out_file ? hand.out_file : "/dev/null";
+    for (i = 0; i < NUM_MODES; i++) {
+        if (hand.v) printf("Dumping the dataset in the %s mode\n", mode_names[i]);
+        res[i].mode = mode_names[i];
+
+        if (NULL == (out = fopen(out_file, "w"))) {
+            printf("Failed to create %s\n", out_file);
+            return 1;
+        }
+        drop_cache(hand.in_file);
+        if (dump_dataset(i, out, &res[i]) < 0)
+            return 1;
+        fclose(out);
+    }
+
+    if (hand.v) printf("Done! \n");
+
+    print_results();
+
+    return 0;
+}
@@ -0,0 +1,1383 @@
+/*
+ * This program imports a sparse matrix given as COO triplets or in the CSR format into a 2-dim dataset
+ * of doubles stored with sparse structured chunks (see structured_chunk.h), as the h5import changes of
+ * RFC-HDF5-Tools propose, and reports the number of entries imported per second and the peak memory.
+ *
+ * The input formats are selected with the command line option -f:
+ *
+ *  0 - COO text: the Matrix Market coordinate format; comment lines start with '%', the first other line
+ *      has the number of rows, the number of columns and the number of entries, and each entry is a line
+ *      "row column value" with 1-based indices;
+ *  1 - COO binary (default): 0-based entries of 24 bytes: the row and the column as 64-bit unsigned
+ *      integers and the value as a double, in the byte order of the machine;
+ *  2 - CSR text: the number of rows, of columns and of entries, followed by the nrows+1 row pointers, the
+ *      nnz 0-based column indices and the nnz values, separated by white space;
+ *  3 - CSR binary: a header of three 64-bit unsigned integers (rows, columns, entries) followed by the
+ *      row pointers and the column indices as 64-bit unsigned integers and the values as doubles.
+ *
+ * The input is mapped to memory and the import runs in two passes:
+ *
+ *  1 - parse and bucket: the input is split into segments (byte ranges of text aligned to lines, or ranges
+ *      of entries) that P threads (option -p) take one at a time.  Each entry is turned into a 16-byte
+ *      record with the position of its chunk and of the element in the chunk as the key, and the record
+ *      is added to the buffer of the thread for the band of chunk rows of the entry.  The bands are sized
+ *      so that the records of one band fit into the memory budget (option -M).  Full buffers are copied
+ *      into the band in memory if there is only one band, or written to a spill file of the band in the
+ *      directory given with the option -T.  The positions are reserved with atomic additions, so the
+ *      threads never wait for each other.  The text of the CSR columns and values is located in
+ *      parallel by counting the numbers in segments first;
+ *  2 - sort and write: the bands are processed one after another.  The records of a band are bucketed
+ *      into the chunks with a parallel counting sort (sc_bucket_starts); then the threads take the chunks
+ *      and assemble them with sc_assemble_sparse_chunk, which sorts the records of each chunk, sums
+ *      duplicate entries, and builds the runs of defined elements, the Encoded Selection and the packed
+ *      data.  The main thread writes the assembled chunks of the band with H5Dwrite_chunk.
+ *
+ * The peak memory is therefore bounded by about twice the budget plus the assembled chunks of one band,
+ * independently of the number of entries, as long as the entries are spread over the bands (the largest
+ * band sets the peak).  The program reports the number of entries (NE), duplicates summed (ND), invalid
+ * entries skipped (NI), chunks written (NC), bands (NB), bytes spilled (SB), the time of both passes
+ * (T1, T2) and in total (T) in seconds, the millions of entries per second (MEPS) and the peak resident
+ * memory in MB (PM).
+ *
+ * With the option -g N the program first generates an input of N random entries in the selected format
+ * for a matrix with the dimensions given by the option -s.  With the option -k 1 the dataset is read
+ * back and the positions and the values are compared with the input: the sum of the values weighted by
+ * a hash of their position, taken as the input is parsed, must match the same sum over the dataset, and
+ * the program exits with 1 if it does not.
+ *
+ * To compile the program, please use h5cc.  The -h option lists all the command line options:
+ *
+ *   [-h] [-i --inFile] [-f --format] [-o --outFile] [-n --nameDset] [-c --dimsChunk] [-p --pThreads]
+ *   [-M --Memory] [-T --Tmpdir] [-z --zDeflate] [-g --generate] [-s --dimsMatrix] [-k --kVerify]
+ *   [-v --Verbose]
+ *
+ * Example: The commands
+ *
+ *           h5cc -pthread sparse_import.c -o sparse_import
+ *           ./sparse_import -g 100000000 -s 1000000x1000000 -f 1 -M 256 -k 1
+ *           ./sparse_import -g 10000000 -f 0 -i coo.mtx
+ *
+ * generate and import 10^8 binary COO entries with a budget of 256 MB, and 10^7 entries of a Matrix
+ * Market file.  For a 10^10-entry input use a budget that keeps the number of bands small, e.g. -M 8192
+ * (20 bands of 8 GB for 160 GB of records), and a spill directory on a fast file system.
+ */
+
+#include "hdf5.h"
+#include "structured_chunk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sys/resource.h>
+
+#define FILE_NAME                       "coo.bin"
+#define OUT_FILE_NAME                   "import_file.h5"
+#define DSET_NAME                       "sparse"
+#define CHUNK_DIM1                      256
+#define CHUNK_DIM2                      256
+#define MATRIX_DIM1                     100000
+#define MATRIX_DIM2                     100000
+#define MEMORY_MB                       1024        /* Memory budget for the records of a band */
+#define MAX_THREADS                     256
+#define SEGMENT_SIZE                    (16 << 20)  /* Bytes of text or of entries in a segment */
+#define FLUSH_RECORDS                   (1 << 14)   /* Records buffered per thread and band */
+#define MAX_NUMBER                      64          /* Characters of a number in text */
+#define RANK                            2
+
+/* Input formats */
+#define FORMAT_COO_TEXT                 0
+#define FORMAT_COO_BINARY               1
+#define FORMAT_CSR_TEXT                 2
+#define FORMAT_CSR_BINARY               3
+
+typedef struct {
+    char           *in_file;
+    int             format;
+    char           *out_file;
+    char           *dset_name;
+    long long int   chunk_dim1;
+    long long int   chunk_dim2;
+    int             threads;
+    long long int   memory;          /* memory budget in MB */
+    char           *tmp_dir;
+    int             z;               /* deflate of the data sections */
+    long long int   generate;        /* number of entries to generate; 0 to import an existing input */
+    long long int   matrix_dim1;
+    long long int   matrix_dim2;
+    int             k;               /* verify the dataset */
+    int             v;               /* prints progress messages */
+} handler_t;
+
+/* Entry of a band: the key is the position of the chunk in the band and of the element in the chunk;
+ * the scatter to the chunks keeps the position in the chunk only */
+typedef sc_sparse_entry_t record_t;
+
+/* Records of a band: in memory, or in a spill file */
+typedef struct {
+    record_t       *records;
+    int             fd;
+    uint64_t        count;           /* reserved atomically */
+} band_t;
+
+/* Range of text (byte offsets) or of entries taken by a thread */
+typedef struct {
+    uint64_t        begin;
+    uint64_t        end;
+} segment_t;
+
+/* State of the import shared by the threads */
+typedef struct {
+    sc_mmap_t       map;
+    uint64_t        nrows;
+    uint64_t        ncols;
+    uint64_t        nnz;
+    const uint8_t  *body;            /* text after the header, or the entries */
+    size_t          body_size;
+    const uint64_t *row_ptr;         /* CSR binary */
+    const uint64_t *col_idx;
+    const double   *values;
+    uint64_t       *row_ptr_text;    /* CSR text: the parsed row pointers */
+    const uint8_t  *col_text;        /* CSR text: the first column index */
+    uint64_t       *token_counts;    /* CSR text: numbers before each text segment */
+    size_t          ntoken_segments;
+    segment_t      *segments;
+    size_t          nsegments;
+    size_t          next;            /* next segment or chunk to take; taken atomically */
+    hsize_t         chunk_dims[RANK];
+    uint64_t        grid[RANK];
+    uint64_t        chunk_nelmts;
+    uint64_t        band_rows;       /* chunk rows per band */
+    uint64_t        band_chunks;     /* chunks per band */
+    int             nbands;
+    band_t         *bands;
+    /* Pass 2 of the current band */
+    record_t       *sorted;
+    uint64_t       *chunk_start;     /* first record of each chunk of the band, and the end */
+    uint64_t      **thread_counts;   /* records per chunk of the band for each thread */
+    record_t       *band_records;
+    uint64_t        band_count;
+    uint8_t       **images;
+    size_t         *image_sizes;
+    /* Statistics */
+    long long int   nentries;
+    long long int   ninvalid;
+    long long int   nduplicates;
+    long long int   nchunks;
+    long long int   spilled;
+    double          in_sum;
+    double          in_hash;         /* sum of the values weighted by a hash of their position (-k) */
+    double          in_scale;        /* same sum of the absolute values, for the tolerance */
+    int             failed;
+    pthread_mutex_t lock;            /* protects the statistics merged by the threads */
+} import_t;
+
+handler_t hand;
+
+/*------------------------------------------------------------
+ * Display command line usage
+ *------------------------------------------------------------
+ */
+void
+usage(void)
+{
+    printf("    [-h] [-i --inFile] [-f --format] [-o --outFile] [-n --nameDset] [-c --dimsChunk] [-p --pThreads]\n");
+    printf("    [-M --Memory] [-T --Tmpdir] [-z --zDeflate] [-g --generate] [-s --dimsMatrix] [-k --kVerify]\n");
+    printf("    [-v --Verbose]\n");
+    printf("    [-h --help]: this help page\n");
+    printf("    [-i --inFile]: the input file (default %s)\n", FILE_NAME);
+    printf("    [-f --format]: 0 - COO text (Matrix Market), 1 - COO binary (default), 2 - CSR text, 3 - CSR binary\n");
+    printf("    [-o --outFile]: the output file (default %s)\n", OUT_FILE_NAME);
+    printf("    [-n --nameDset]: the name of the dataset (default %s)\n", DSET_NAME);
+    printf("    [-c --dimsChunk]: the chunk dimensions (default %dx%d)\n", CHUNK_DIM1, CHUNK_DIM2);
+    printf("    [-p --pThreads]: the number of threads (default the number of CPUs)\n");
+    printf("    [-M --Memory]: the memory budget for the records of a band in MB (default %d)\n", MEMORY_MB);
+    printf("    [-T --Tmpdir]: the directory of the spill files (default .)\n");
+    printf("    [-z --zDeflate]: the data sections are compressed with deflate (1) or not (0, default)\n");
+    printf("    [-g --generate]: generate an input with this number of random entries first (default 0)\n");
+    printf("    [-s --dimsMatrix]: the dimensions of the generated matrix (default %dx%d)\n", MATRIX_DIM1,
+           MATRIX_DIM2);
+    printf("    [-k --kVerify]: read the dataset back and compare it with the input (1) or not (0, default)\n");
+    printf("    [-v --Verbose]: Print progress messages(1); default no messages displayed (0) \n");
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Parse a string of the form AxB; missing dimensions are set
+ * to 0
+ *------------------------------------------------------------
+ */
+void
+parse_dims(const char *str, int ndims, long long int *dims[])
+{
+    char *dims_str, *dim_str;
+    int   i;
+
+    dims_str = strdup(str);
+    dim_str  = strtok(dims_str, "x");
+    for (i = 0; i < ndims; i++) {
+        *dims[i] = dim_str ? atoll(dim_str) : 0;
+        dim_str  = strtok(NULL, "x");
+    }
+    free(dims_str);
+}
+
+/*------------------------------------------------------------
+ * Parse command line option
+ *------------------------------------------------------------
+ */
+void
+parse_command_line(int argc, char *argv[])
+{
+    int            opt;
+    long long int *chunk_dims[2]  = {&hand.chunk_dim1, &hand.chunk_dim2};
+    long long int *matrix_dims[2] = {&hand.matrix_dim1, &hand.matrix_dim2};
+    struct option  long_options[] = {
+                                    {"help", no_argument, NULL, 'h'},
+                                    {"inFile=", required_argument, NULL, 'i'},
+                                    {"format=", required_argument, NULL, 'f'},
+                                    {"outFile=", required_argument, NULL, 'o'},
+                                    {"nameDset=", required_argument, NULL, 'n'},
+                                    {"dimsChunk=", required_argument, NULL, 'c'},
+                                    {"pThreads=", required_argument, NULL, 'p'},
+                                    {"Memory=", required_argument, NULL, 'M'},
+                                    {"Tmpdir=", required_argument, NULL, 'T'},
+                                    {"zDeflate=", required_argument, NULL, 'z'},
+                                    {"generate=", required_argument, NULL, 'g'},
+                                    {"dimsMatrix=", required_argument, NULL, 's'},
+                                    {"kVerify=", required_argument, NULL, 'k'},
+                                    {"Verbose=", required_argument, NULL, 'v'},
+                                    {NULL, 0, NULL, 0}};
+
+    /* Initialize the command line options */
+    hand.in_file     = FILE_NAME;
+    hand.format      = FORMAT_COO_BINARY;
+    hand.out_file    = OUT_FILE_NAME;
+    hand.dset_name   = DSET_NAME;
+    hand.chunk_dim1  = CHUNK_DIM1;
+    hand.chunk_dim2  = CHUNK_DIM2;
+    hand.threads     = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    hand.memory      = MEMORY_MB;
+    hand.tmp_dir     = ".";
+    hand.z           = 0;
+    hand.generate    = 0;
+    hand.matrix_dim1 = MATRIX_DIM1;
+    hand.matrix_dim2 = MATRIX_DIM2;
+    hand.k           = 0;
+    hand.v           = 0;
+
+    while ((opt = getopt_long(argc, argv, "hi:f:o:n:c:p:M:T:z:g:s:k:v:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'h':
+                fprintf(stdout, "Help page:\n");
+                usage();
+
+                exit(0);
+
+                break;
+            case 'i':
+                if (optarg) {
+                    fprintf(stdout, "Input file:\t\t\t\t\t\t%s\n", optarg);
+                    hand.in_file = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'f':
+                if (optarg) {
+                    hand.format = atoi(optarg);
+                    if (hand.format == FORMAT_COO_TEXT)
+                        fprintf(stdout, "Input format: \t\t\t\t\t\tCOO text\n");
+                    else if (hand.format == FORMAT_COO_BINARY)
+                        fprintf(stdout, "Input format: \t\t\t\t\t\tCOO binary\n");
+                    else if (hand.format == FORMAT_CSR_TEXT)
+                        fprintf(stdout, "Input format: \t\t\t\t\t\tCSR text\n");
+                    else if (hand.format == FORMAT_CSR_BINARY)
+                        fprintf(stdout, "Input format: \t\t\t\t\t\tCSR binary\n");
+                    else
+                        fprintf(stdout, "Input format:\t\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'o':
+                if (optarg) {
+                    fprintf(stdout, "Output file:\t\t\t\t\t\t%s\n", optarg);
+                    hand.out_file = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'n':
+                if (optarg) {
+                    fprintf(stdout, "Dataset:\t\t\t\t\t\t%s\n", optarg);
+                    hand.dset_name = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'c':
+                if (optarg) {
+                    fprintf(stdout, "Chunk dimensions:\t\t\t\t\t%s\n", optarg);
+                    parse_dims(optarg, 2, chunk_dims);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'p':
+                if (optarg) {
+                    fprintf(stdout, "Number of threads:\t\t\t\t\t%s\n", optarg);
+                    hand.threads = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'M':
+                if (optarg) {
+                    fprintf(stdout, "Memory budget in MB:\t\t\t\t\t%s\n", optarg);
+                    hand.memory = atoll(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'T':
+                if (optarg) {
+                    fprintf(stdout, "Spill directory:\t\t\t\t\t%s\n", optarg);
+                    hand.tmp_dir = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'z':
+                if (optarg) {
+                    hand.z = atoi(optarg);
+                    if (hand.z == 1)
+                        fprintf(stdout, "Deflate: \t\t\t\t\t\ton\n");
+                    else if (hand.z == 0)
+                        fprintf(stdout, "Deflate: \t\t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Deflate:\t\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'g':
+                if (optarg) {
+                    fprintf(stdout, "Number of generated entries:\t\t\t\t%s\n", optarg);
+                    hand.generate = atoll(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 's':
+                if (optarg) {
+                    fprintf(stdout, "Matrix dimensions:\t\t\t\t\t%s\n", optarg);
+                    parse_dims(optarg, 2, matrix_dims);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'k':
+                if (optarg) {
+                    hand.k = atoi(optarg);
+                    if (hand.k == 1)
+                        fprintf(stdout, "Verify: \t\t\t\t\t\ton\n");
+                    else if (hand.k == 0)
+                        fprintf(stdout, "Verify: \t\t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Verify:\t\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'v':
+                if (optarg) {
+                    hand.v = atoi(optarg);
+                    if (hand.v == 1)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\ton\n");
+                    else if (hand.v == 0)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Verbose mode:\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case ':':
+                printf("Option needs a value\n");
+                break;
+            case '?':
+                printf("Unknown option: %c\n", optopt);
+                break;
+        }
+    }
+
+    /* optind is for the extra arguments which are not parsed */
+    for (; optind < argc; optind++) {
+        printf("extra arguments not parsed: %s\n", argv[optind]);
+    }
+
+    /* Make sure the command line options are valid */
+    if (hand.format < FORMAT_COO_TEXT || hand.format > FORMAT_CSR_BINARY) {
+        printf("The input format can only be 0, 1, 2 or 3\n");
+        exit(1);
+    }
+
+    if (hand.chunk_dim1 <= 0 || hand.chunk_dim2 <= 0 || hand.matrix_dim1 <= 0 || hand.matrix_dim2 <= 0) {
+        printf("The chunk and matrix dimensions must be positive\n");
+        exit(1);
+    }
+
+    if (hand.threads < 1 || hand.threads > MAX_THREADS) {
+        printf("The number of threads must be between 1 and %d\n", MAX_THREADS);
+        exit(1);
+    }
+
+    if (hand.memory < 1) {
+        printf("The memory budget must be positive\n");
+        exit(1);
+    }
+
+    if (hand.z < 0 || hand.z > 1) {
+        printf("Deflate flag can only be 0 or 1 \n");
+        exit(1);
+    }
+
+    if (hand.generate < 0) {
+        printf("The number of generated entries can not be negative\n");
+        exit(1);
+    }
+
+    if (hand.k < 0 || hand.k > 1) {
+        printf("Verify flag can only be 0 or 1 \n");
+        exit(1);
+    }
+
+    if (hand.v < 0 || hand.v > 1) {
+        printf("Verbose flag can only be 0 or 1 \n");
+        exit(1);
+    }
+}
+
+/*------------------------------------------------------------
+ * Print the results
+ *------------------------------------------------------------
+ */
+void print_results(const import_t *im, double time1, double time2)
+{
+    struct rusage usage;
+    double        time = time1 + time2;
+
+    getrusage(RUSAGE_SELF, &usage);
+
+    printf("\n");
+    printf("Printing the number of entries (NE), duplicates summed (ND), invalid entries (NI), chunks (NC),\n");
+    printf("bands (NB), bytes spilled (SB), time of the passes (T1, T2) and in total (T) in seconds, millions\n");
+    printf("of entries per second (MEPS) and peak memory in MB (PM)\n");
+    printf("\n");
+    printf("        NE         ND         NI         NC         NB         SB         T1         T2          T       MEPS         PM\n");
+    printf("\n");
+    printf("%10lli %10lli %10lli %10lli %10d %10lli %10.4f %10.4f %10.4f %10.3f %10.1f \n", im->nentries,
+           im->nduplicates, im->ninvalid, im->nchunks, im->nbands, im->spilled, time1, time2, time,
+           time > 0 ? (double)im->nentries / time / 1e6 : 0.0, usage.ru_maxrss / 1024.0);
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Elapsed time
+ *------------------------------------------------------------
+ */
+double elapsed(struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*------------------------------------------------------------
+ * Generate a random input of "hand.generate" entries
+ *------------------------------------------------------------
+ */
+int generate_input(void)
+{
+    FILE         *f;
+    uint64_t      nrows = (uint64_t)hand.matrix_dim1, ncols = (uint64_t)hand.matrix_dim2;
+    uint64_t      nnz = (uint64_t)hand.generate, r, k;
+    int           text = hand.format == FORMAT_COO_TEXT || hand.format == FORMAT_CSR_TEXT;
+
+    srand(2);
+
+    if (NULL == (f = fopen(hand.in_file, text ? "w" : "wb"))) {
+        printf("Failed to create %s\n", hand.in_file);
+        return -1;
+    }
+
+    if (hand.format == FORMAT_COO_TEXT || hand.format == FORMAT_COO_BINARY) {
+        if (text)
+            fprintf(f, "%%%%MatrixMarket matrix coordinate real general\n%llu %llu %llu\n", (unsigned long long)nrows,
+                    (unsigned long long)ncols, (unsigned long long)nnz);
+        for (k = 0; k < nnz; k++) {
+            uint64_t row   = ((uint64_t)rand() * RAND_MAX + rand()) % nrows;
+            uint64_t col   = ((uint64_t)rand() * RAND_MAX + rand()) % ncols;
+            double   value = (double)(rand() % 1000000 + 1) / 1000;
+
+            if (text)
+                fprintf(f, "%llu %llu %g\n", (unsigned long long)row + 1, (unsigned long long)col + 1, value);
+            else {
+                fwrite(&row, sizeof(row), 1, f);
+                fwrite(&col, sizeof(col), 1, f);
+                fwrite(&value, sizeof(value), 1, f);
+            }
+        }
+    }
+    else {
+        uint64_t *cols = (uint64_t *)malloc((nnz / nrows + 1) * sizeof(uint64_t));
+        uint64_t  header[3] = {nrows, ncols, nnz}, ptr = 0;
+        int       pass;
+
+        /* The rows get the same number of entries; the columns of a row are sorted */
+        if (text)
+            fprintf(f, "%llu %llu %llu\n", (unsigned long long)nrows, (unsigned long long)ncols,
+                    (unsigned long long)nnz);
+        else
+            fwrite(header, sizeof(uint64_t), 3, f);
+        for (r = 0; r <= nrows; r++) {
+            if (text)
+                fprintf(f, "%llu\n", (unsigned long long)ptr);
+            else
+                fwrite(&ptr, sizeof(ptr), 1, f);
+            ptr += nnz / nrows + (r < nnz % nrows);
+        }
+        for (pass = 0; pass < 2; pass++) {
+            srand(3);
+            for (r = 0; r < nrows; r++) {
+                uint64_t n = nnz / nrows + (r < nnz % nrows);
+
+                for (k = 0; k < n; k++)
+                    cols[k] = ((uint64_t)rand() * RAND_MAX + rand()) % ncols;
+                qsort(cols, (size_t)n, sizeof(uint64_t), sc_cmp_offset);
+                for (k = 0; k < n; k++) {
+                    double value = (double)(cols[k] % 1000000 + 1) / 1000;
+
+                    if (pass == 0 && text)
+                        fprintf(f, "%llu\n", (unsigned long long)cols[k]);
+                    else if (pass == 0)
+                        fwrite(&cols[k], sizeof(uint64_t), 1, f);
+                    else if (text)
+                        fprintf(f, "%g\n", value);
+                    else
+                        fwrite(&value, sizeof(double), 1, f);
+                }
+            }
+        }
+        free(cols);
+    }
+
+    fclose(f);
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Parse numbers of the text in [p, end): skip white space and
+ * comment lines; return the position after the number or NULL
+ * at the end of the text
+ *------------------------------------------------------------
+ */
+const uint8_t *skip_space(const uint8_t *p, const uint8_t *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+        p++;
+    return p;
+}
+
+const uint8_t *parse_u64(const uint8_t *p, const uint8_t *end, uint64_t *v)
+{
+    p = skip_space(p, end);
+    if (p == end || *p < '0' || *p > '9')
+        return NULL;
+    *v = 0;
+    while (p < end && *p >= '0' && *p <= '9')
+        *v = *v * 10 + (uint64_t)(*p++ - '0');
+    return p;
+}
+
+const uint8_t *parse_double(const uint8_t *p, const uint8_t *end, double *v)
+{
+    char   number[MAX_NUMBER];
+    size_t n = 0;
+
+    /* The number is copied: the mapped text is not terminated */
+    p = skip_space(p, end);
+    while (p < end && n < MAX_NUMBER - 1 && !(*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+        number[n++] = (char)*p++;
+    if (n == 0)
+        return NULL;
+    number[n] = '\0';
+    *v        = strtod(number, NULL);
+    return p;
+}
+
+/*------------------------------------------------------------
+ * Buffers of the records of a thread for each band
+ *------------------------------------------------------------
+ */
+typedef struct {
+    record_t      **buf;
+    size_t         *count;
+    long long int   nentries;
+    long long int   ninvalid;
+    double          sum;
+    double          hash;
+    double          scale;
+} bucket_t;
+
+/* Move the buffered records of a band to the band */
+int flush_band(import_t *im, bucket_t *b, int band)
+{
+    band_t  *bd = &im->bands[band];
+    size_t   n  = b->count[band];
+    uint64_t first;
+
+    if (n == 0)
+        return 0;
+    first = __sync_fetch_and_add(&bd->count, (uint64_t)n);
+    if (im->nbands == 1) {
+        if (first + n > im->nnz)
+            return -1;
+        memcpy(bd->records + first, b->buf[band], n * sizeof(record_t));
+    }
+    else {
+        size_t size = n * sizeof(record_t), done = 0;
+
+        while (done < size) {
+            ssize_t w = pwrite(bd->fd, (uint8_t *)b->buf[band] + done, size - done,
+                               (off_t)(first * sizeof(record_t) + done));
+
+            if (w <= 0)
+                return -1;
+            done += (size_t)w;
+        }
+    }
+    b->count[band] = 0;
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Weight in [1, 2) of the element at a linear position of the
+ * matrix, from a hash of the position (splitmix64)
+ *------------------------------------------------------------
+ */
+double position_weight(uint64_t pos)
+{
+    uint64_t h = pos + 0x9e3779b97f4a7c15ULL;
+
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return 1.0 + (double)(h >> 11) / 9007199254740992.0;
+}
+
+/* Add an entry with 0-based indices */
+int add_entry(import_t *im, bucket_t *b, uint64_t row, uint64_t col, double value)
+{
+    uint64_t chunk_row, chunk;
+    int      band;
+
+    if (row >= im->nrows || col >= im->ncols) {
+        b->ninvalid++;
+        return 0;
+    }
+    chunk_row = row / im->chunk_dims[0];
+    band      = (int)(chunk_row / im->band_rows);
+    chunk     = (chunk_row - (uint64_t)band * im->band_rows) * im->grid[1] + col / im->chunk_dims[1];
+
+    b->buf[band][b->count[band]].key =
+        chunk * im->chunk_nelmts + (row % im->chunk_dims[0]) * im->chunk_dims[1] + col % im->chunk_dims[1];
+    b->buf[band][b->count[band]].value = value;
+    b->nentries++;
+    b->sum += value;
+    if (hand.k) {
+        double w = position_weight(row * im->ncols + col);
+
+        b->hash += value * w;
+        b->scale += (value < 0 ? -value : value) * w;
+    }
+    if (++b->count[band] == FLUSH_RECORDS)
+        return flush_band(im, b, band);
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Position of the number "t" of the CSR text after the row
+ * pointers; the numbers before each segment were counted
+ *------------------------------------------------------------
+ */
+const uint8_t *locate_number(const import_t *im, uint64_t t)
+{
+    const uint8_t *end = im->body + im->body_size;
+    const uint8_t *p;
+    size_t         lo = 0, hi = im->ntoken_segments;
+    uint64_t       n;
+
+    /* The last segment that starts before the number */
+    while (hi - lo > 1) {
+        size_t mid = (lo + hi) / 2;
+
+        if (im->token_counts[mid] <= t)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    p = im->col_text + (size_t)lo * SEGMENT_SIZE;
+    n = im->token_counts[lo];
+
+    /* A number that crosses the start of the segment was counted in the previous segment */
+    if (lo > 0 && !(p[-1] == ' ' || p[-1] == '\t' || p[-1] == '\n' || p[-1] == '\r'))
+        while (p < end && !(*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+            p++;
+    for (; n < t; n++) {
+        p = skip_space(p, end);
+        while (p < end && !(*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+            p++;
+    }
+    return p;
+}
+
+/*------------------------------------------------------------
+ * Count the numbers that start in a segment of the CSR text
+ *------------------------------------------------------------
+ */
+uint64_t count_numbers(const import_t *im, size_t segment)
+{
+    const uint8_t *text  = im->col_text;
+    const uint8_t *end   = im->body + im->body_size;
+    const uint8_t *p     = text + segment * SEGMENT_SIZE;
+    const uint8_t *s_end = p + SEGMENT_SIZE < end ? p + SEGMENT_SIZE : end;
+    int            prev_space = segment == 0 ? 1 : (p[-1] == ' ' || p[-1] == '\t' || p[-1] == '\n' || p[-1] == '\r');
+    uint64_t       n     = 0;
+
+    for (; p < s_end; p++) {
+        int space = *p == ' ' || *p == '\t' || *p == '\n' || *p == '\r';
+
+        n += prev_space && !space;
+        prev_space = space;
+    }
+    return n;
+}
+
+/*------------------------------------------------------------
+ * Pass 1 of a thread: parse the segments and bucket the entries
+ *------------------------------------------------------------
+ */
+void *parse_thread(void *arg)
+{
+    import_t *im = (import_t *)arg;
+    bucket_t  b;
+    size_t    s;
+    int       band, failed = 0;
+
+    memset(&b, 0, sizeof(b));
+    b.buf   = (record_t **)malloc((size_t)im->nbands * sizeof(record_t *));
+    b.count = (size_t *)calloc((size_t)im->nbands, sizeof(size_t));
+    for (band = 0; band < im->nbands; band++)
+        b.buf[band] = (record_t *)malloc(FLUSH_RECORDS * sizeof(record_t));
+
+    while (!failed && (s = __sync_fetch_and_add(&im->next, 1)) < im->nsegments) {
+        const segment_t *seg = &im->segments[s];
+        uint64_t         k, row;
+
+        switch (hand.format) {
+            case FORMAT_COO_TEXT: {
+                const uint8_t *end = im->body + im->body_size;
+                const uint8_t *p   = im->body + seg->begin;
+                const uint8_t *stop = im->body + seg->end;
+
+                /* A line that starts in the previous segment belongs to it */
+                if (seg->begin > 0 && p[-1] != '\n')
+                    while (p < end && *p++ != '\n')
+                        ;
+                while (!failed && p < stop) {
+                    uint64_t       r, c;
+                    double         v;
+                    const uint8_t *q;
+
+                    if (*p == '%' || *p == '\n' || *p == '\r') {
+                        while (p < end && *p++ != '\n')
+                            ;
+                        continue;
+                    }
+                    if (NULL == (q = parse_u64(p, end, &r)) || NULL == (q = parse_u64(q, end, &c)) ||
+                        NULL == (q = parse_double(q, end, &v)) || r == 0 || c == 0)
+                        b.ninvalid++;
+                    else if (add_entry(im, &b, r - 1, c - 1, v) < 0)
+                        failed = 1;
+                    while (p < end && *p++ != '\n')
+                        ;
+                }
+                break;
+            }
+            case FORMAT_COO_BINARY:
+                for (k = seg->begin; !failed && k < seg->end; k++) {
+                    const uint8_t *e = im->body + k * 24;
+                    uint64_t       r, c;
+                    double         v;
+
+                    memcpy(&r, e, 8);
+                    memcpy(&c, e + 8, 8);
+                    memcpy(&v, e + 16, 8);
+                    if (add_entry(im, &b, r, c, v) < 0)
+                        failed = 1;
+                }
+                break;
+            case FORMAT_CSR_TEXT: {
+                const uint8_t *end = im->body + im->body_size;
+                const uint8_t *pc  = locate_number(im, seg->begin);
+                const uint8_t *pv  = locate_number(im, im->nnz + seg->begin);
+
+                /* The row of the first entry */
+                for (row = 0; im->row_ptr_text[row + 1] <= seg->begin; row++)
+                    ;
+                for (k = seg->begin; !failed && k < seg->end; k++) {
+                    uint64_t c;
+                    double   v;
+
+                    while (im->row_ptr_text[row + 1] <= k)
+                        row++;
+                    if (NULL == (pc = parse_u64(pc, end, &c)) || NULL == (pv = parse_double(pv, end, &v))) {
+                        b.ninvalid += (long long int)(seg->end - k);
+                        break;
+                    }
+                    if (add_entry(im, &b, row, c, v) < 0)
+                        failed = 1;
+                }
+                break;
+            }
+            case FORMAT_CSR_BINARY:
+                for (row = 0; im->row_ptr[row + 1] <= seg->begin; row++)
+                    ;
+                for (k = seg->begin; !failed && k < seg->end; k++) {
+                    while (im->row_ptr[row + 1] <= k)
+                        row++;
+                    if (add_entry(im, &b, row, im->col_idx[k], im->values[k]) < 0)
+                        failed = 1;
+                }
+                break;
+        }
+    }
+
+    for (band = 0; band < im->nbands; band++) {
+        if (!failed && flush_band(im, &b, band) < 0)
+            failed = 1;
+        free(b.buf[band]);
+    }
+    free(b.buf);
+    free(b.count);
+
+    pthread_mutex_lock(&im->lock);
+    im->nentries += b.nentries;
+    im->ninvalid += b.ninvalid;
+    im->in_sum += b.sum;
+    im->in_hash += b.hash;
+    im->in_scale += b.scale;
+    if (failed)
+        im->failed = 1;
+    pthread_mutex_unlock(&im->lock);
+
+    return NULL;
+}
+
+/*------------------------------------------------------------
+ * Counting numbers of the CSR text (callback of the threads)
+ *------------------------------------------------------------
+ */
+void *count_thread(void *arg)
+{
+    import_t *im = (import_t *)arg;
+    size_t    s;
+
+    while ((s = __sync_fetch_and_add(&im->next, 1)) < im->ntoken_segments)
+        im->token_counts[s + 1] = count_numbers(im, s);
+    return NULL;
+}
+
+/*------------------------------------------------------------
+ * Run "func" on all threads
+ *------------------------------------------------------------
+ */
+void run_threads(import_t *im, void *(*func)(void *))
+{
+    pthread_t threads[MAX_THREADS];
+    int       i;
+
+    im->next = 0;
+    for (i = 0; i < hand.threads; i++)
+        pthread_create(&threads[i], NULL, func, im);
+    for (i = 0; i < hand.threads; i++)
+        pthread_join(threads[i], NULL);
+}
+
+/*------------------------------------------------------------
+ * Map the input, parse its header and split it into segments
+ *------------------------------------------------------------
+ */
+int open_input(import_t *im)
+{
+    const uint8_t *p, *end;
+    uint64_t       k, per_segment;
+    size_t         s;
+
+    if (sc_mmap_open(hand.in_file, &im->map) < 0) {
+        printf("Failed to map %s\n", hand.in_file);
+        return -1;
+    }
+    p   = im->map.base;
+    end = im->map.base + im->map.size;
+
+    switch (hand.format) {
+        case FORMAT_COO_TEXT:
+            /* Skip the comment lines before the size line */
+            while (p < end && *p == '%')
+                while (p < end && *p++ != '\n')
+                    ;
+            if (NULL == (p = parse_u64(p, end, &im->nrows)) || NULL == (p = parse_u64(p, end, &im->ncols)) ||
+                NULL == (p = parse_u64(p, end, &im->nnz)))
+                goto error;
+            while (p < end && *p++ != '\n')
+                ;
+            im->body      = p;
+            im->body_size = (size_t)(end - p);
+            im->nsegments = im->body_size / SEGMENT_SIZE + 1;
+            im->segments  = (segment_t *)malloc(im->nsegments * sizeof(segment_t));
+            for (s = 0; s < im->nsegments; s++) {
+                im->segments[s].begin = (uint64_t)s * SEGMENT_SIZE;
+                im->segments[s].end   = s + 1 < im->nsegments ? (uint64_t)(s + 1) * SEGMENT_SIZE : im->body_size;
+            }
+            return 0;
+        case FORMAT_COO_BINARY:
+            if (im->map.size % 24)
+                goto error;
+            im->nnz       = im->map.size / 24;
+            im->nrows     = (uint64_t)hand.matrix_dim1;
+            im->ncols     = (uint64_t)hand.matrix_dim2;
+            im->body      = p;
+            im->body_size = im->map.size;
+            break;
+        case FORMAT_CSR_TEXT:
+            if (NULL == (p = parse_u64(p, end, &im->nrows)) || NULL == (p = parse_u64(p, end, &im->ncols)) ||
+                NULL == (p = parse_u64(p, end, &im->nnz)))
+                goto error;
+            im->row_ptr_text = (uint64_t *)malloc((im->nrows + 1) * sizeof(uint64_t));
+            for (k = 0; k <= im->nrows; k++)
+                if (NULL == (p = parse_u64(p, end, &im->row_ptr_text[k])))
+                    goto error;
+            if (im->row_ptr_text[im->nrows] != im->nnz)
+                goto error;
+            im->body      = p;
+            im->body_size = (size_t)(end - p);
+            im->col_text  = p;
+            im->row_ptr   = im->row_ptr_text;
+
+            /* Count the numbers of the segments of the text in parallel */
+            im->ntoken_segments = im->body_size / SEGMENT_SIZE + 1;
+            im->token_counts    = (uint64_t *)calloc(im->ntoken_segments + 1, sizeof(uint64_t));
+            run_threads(im, count_thread);
+            for (s = 0; s < im->ntoken_segments; s++)
+                im->token_counts[s + 1] += im->token_counts[s];
+            if (im->token_counts[im->ntoken_segments] < 2 * im->nnz)
+                goto error;
+            break;
+        case FORMAT_CSR_BINARY: {
+            uint64_t header[3];
+
+            if (im->map.size < sizeof(header))
+                goto error;
+            memcpy(header, p, sizeof(header));
+            im->nrows = header[0];
+            im->ncols = header[1];
+            im->nnz   = header[2];
+            if (im->map.size != (3 + im->nrows + 1 + 2 * im->nnz) * 8)
+                goto error;
+            im->row_ptr = (const uint64_t *)(p + 24);
+            im->col_idx = im->row_ptr + im->nrows + 1;
+            im->values  = (const double *)(im->col_idx + im->nnz);
+            if (im->row_ptr[im->nrows] != im->nnz)
+                goto error;
+            break;
+        }
+    }
+
+    /* Ranges of entries */
+    per_segment   = SEGMENT_SIZE / 24;
+    im->nsegments = (size_t)((im->nnz + per_segment - 1) / per_segment);
+    im->segments  = (segment_t *)malloc((im->nsegments + 1) * sizeof(segment_t));
+    for (s = 0; s < im->nsegments; s++) {
+        im->segments[s].begin = (uint64_t)s * per_segment;
+        im->segments[s].end   = im->segments[s].begin + per_segment < im->nnz ? im->segments[s].begin + per_segment
+                                                                             : im->nnz;
+    }
+    return 0;
+
+error:
+    printf("The input %s is not in the selected format\n", hand.in_file);
+    return -1;
+}
+
+/*------------------------------------------------------------
+ * Pass 2: count the records of each chunk of a thread's slice
+ * of the band
+ *------------------------------------------------------------
+ */
+void *count_chunks_thread(void *arg)
+{
+    import_t *im = (import_t *)arg;
+    int       t  = (int)__sync_fetch_and_add(&im->next, 1);
+    uint64_t  first = im->band_count * (uint64_t)t / (uint64_t)hand.threads;
+    uint64_t  last  = im->band_count * (uint64_t)(t + 1) / (uint64_t)hand.threads;
+    uint64_t *counts = im->thread_counts[t];
+    uint64_t  k;
+
+    memset(counts, 0, im->band_chunks * sizeof(uint64_t));
+    for (k = first; k < last; k++)
+        counts[im->band_records[k].key / im->chunk_nelmts]++;
+    return NULL;
+}
+
+/* Scatter the records of the slice to their chunks; thread_counts hold the first position */
+void *scatter_thread(void *arg)
+{
+    import_t *im = (import_t *)arg;
+    int       t  = (int)__sync_fetch_and_add(&im->next, 1);
+    uint64_t  first = im->band_count * (uint64_t)t / (uint64_t)hand.threads;
+    uint64_t  last  = im->band_count * (uint64_t)(t + 1) / (uint64_t)hand.threads;
+    uint64_t *pos    = im->thread_counts[t];
+    uint64_t  k;
+
+    for (k = first; k < last; k++) {
+        record_t *rec = &im->sorted[pos[im->band_records[k].key / im->chunk_nelmts]++];
+
+        rec->key   = im->band_records[k].key % im->chunk_nelmts;
+        rec->value = im->band_records[k].value;
+    }
+    return NULL;
+}
+
+/*------------------------------------------------------------
+ * Pass 2: assemble the chunks of the band
+ *------------------------------------------------------------
+ */
+void *assemble_thread(void *arg)
+{
+    import_t           *im = (import_t *)arg;
+    sc_sparse_scratch_t scratch;
+    size_t              c;
+    long long int       ndup   = 0;
+    int                 failed = 0;
+
+    memset(&scratch, 0, sizeof(scratch));
+    while ((c = __sync_fetch_and_add(&im->next, 1)) < im->band_chunks)
+        if (failed || sc_assemble_sparse_chunk(RANK, im->chunk_dims, hand.z ? SC_PIPELINE_DEFLATE : SC_PIPELINE_NONE,
+                                               im->sorted + im->chunk_start[c],
+                                               (size_t)(im->chunk_start[c + 1] - im->chunk_start[c]), &scratch,
+                                               &ndup, &im->images[c], &im->image_sizes[c]) < 0) {
+            im->images[c] = NULL;
+            failed        = 1;
+        }
+    sc_free_sparse_scratch(&scratch);
+
+    pthread_mutex_lock(&im->lock);
+    im->nduplicates += ndup;
+    if (failed)
+        im->failed = 1;
+    pthread_mutex_unlock(&im->lock);
+
+    return NULL;
+}
+
+/*------------------------------------------------------------
+ * Pass 2 of one band: bucket, assemble and write its chunks
+ *------------------------------------------------------------
+ */
+int write_band(import_t *im, hid_t dset, int band)
+{
+    band_t  *bd = &im->bands[band];
+    uint64_t c;
+    hsize_t  offset[RANK];
+
+    im->band_count = bd->count;
+    if (im->band_count == 0)
+        return 0;
+
+    /* The records of the band */
+    if (im->nbands == 1)
+        im->band_records = bd->records;
+    else {
+        size_t size = (size_t)im->band_count * sizeof(record_t), done = 0;
+
+        if (NULL == (im->band_records = (record_t *)malloc(size)))
+            return -1;
+        while (done < size) {
+            ssize_t r = pread(bd->fd, (uint8_t *)im->band_records + done, size - done, (off_t)done);
+
+            if (r <= 0)
+                return -1;
+            done += (size_t)r;
+        }
+    }
+
+    /* Parallel counting sort by chunk */
+    if (NULL == (im->sorted = (record_t *)malloc((size_t)im->band_count * sizeof(record_t))))
+        return -1;
+    run_threads(im, count_chunks_thread);
+    sc_bucket_starts(hand.threads, im->band_chunks, im->thread_counts, im->chunk_start);
+    run_threads(im, scatter_thread);
+    if (im->nbands > 1)
+        free(im->band_records);
+    else {
+        free(bd->records);
+        bd->records = NULL;
+    }
+    im->band_records = NULL;
+
+    run_threads(im, assemble_thread);
+    free(im->sorted);
+    im->sorted = NULL;
+
+    /* The main thread writes the chunks in the logical order */
+    for (c = 0; c < im->band_chunks; c++) {
+        if (!im->images[c])
+            continue;
+        offset[0] = ((uint64_t)band * im->band_rows + c / im->grid[1]) * im->chunk_dims[0];
+        offset[1] = (c % im->grid[1]) * im->chunk_dims[1];
+        if (H5Dwrite_chunk(dset, H5P_DEFAULT, 0, offset, im->image_sizes[c], im->images[c]) < 0)
+            im->failed = 1;
+        free(im->images[c]);
+        im->images[c] = NULL;
+        im->nchunks++;
+    }
+
+    return im->failed ? -1 : 0;
+}
+
+/*------------------------------------------------------------
+ * Read the dataset back and compare the positions and the
+ * values with the input: the values weighted by a hash of
+ * their position must add up to the sum taken as the input
+ * was parsed, so a value at a wrong position, a wrong value
+ * or a missing or extra element makes the check fail
+ *------------------------------------------------------------
+ */
+int verify(hid_t dset, const import_t *im)
+{
+    sc_chunk_loc_t *locs;
+    size_t          nchunks, n;
+    uint64_t        nelemts = 0;
+    double          sum = 0, hash = 0, tolerance;
+    int             failed = 0;
+
+    if (sc_get_chunk_locations(dset, &nchunks, &locs) < 0)
+        return -1;
+    for (n = 0; n < nchunks && !failed; n++) {
+        sc_chunk_info_t info;
+        void           *buf[2] = {NULL, NULL};
+        double         *data;
+        sc_run_t       *runs = NULL;
+        hsize_t         dims[RANK];
+        size_t          nruns, r, size;
+        uint64_t        e = 0, k;
+        int             rank;
+
+        if (sc_read_struct_chunk(dset, H5P_DEFAULT, locs[n].offset, &info, NULL) < 0 || info.num_sections < 2) {
+            failed = 1;
+            break;
+        }
+        buf[0] = malloc(info.section_orig_size[SC_SECTION_SELECTION] + 1);
+        buf[1] = malloc(info.section_orig_size[SC_SECTION_FIXED] + 1);
+        data   = (double *)buf[1];
+        size   = (size_t)info.section_orig_size[SC_SECTION_SELECTION];
+        if (!buf[0] || !buf[1] || sc_read_struct_chunk(dset, H5P_DEFAULT, locs[n].offset, &info, buf) < 0 ||
+            sc_decode_runs(buf[0], size, &rank, dims, &nruns, NULL) < 0 ||
+            NULL == (runs = (sc_run_t *)malloc((nruns + 1) * sizeof(sc_run_t))) ||
+            sc_decode_runs(buf[0], size, &rank, dims, &nruns, runs) < 0)
+            failed = 1;
+
+        /* The runs lie along the rows of the chunk */
+        for (r = 0; !failed && r < nruns; r++) {
+            uint64_t row = locs[n].offset[0] + runs[r].start / im->chunk_dims[1];
+            uint64_t col = locs[n].offset[1] + runs[r].start % im->chunk_dims[1];
+
+            if (row >= im->nrows || col + runs[r].len > im->ncols || e + runs[r].len > info.nelemts) {
+                failed = 1;
+                break;
+            }
+            for (k = 0; k < runs[r].len; k++, e++) {
+                sum += data[e];
+                hash += data[e] * position_weight(row * im->ncols + col + k);
+            }
+        }
+        if (e != info.nelemts)
+            failed = 1;
+        nelemts += info.nelemts;
+        free(runs);
+        free(buf[0]);
+        free(buf[1]);
+    }
+    free(locs);
+
+    /* Each element comes from at least one entry */
+    tolerance = 1e-9 * im->in_scale + 1e-9;
+    if (nelemts > (uint64_t)im->nentries || (nelemts == 0) != (im->nentries == 0) || hash - im->in_hash > tolerance ||
+        im->in_hash - hash > tolerance)
+        failed = 1;
+
+    printf("Verification: %llu elements for %lli entries, sum %.6g of %.6g, position hash %.9g of %.9g: %s\n",
+           (unsigned long long)nelemts, im->nentries, sum, im->in_sum, hash, im->in_hash, failed ? "failed" : "passed");
+    return failed ? -1 : 0;
+}
+
+/*------------------------------------------------------------
+ * Main function
+ *------------------------------------------------------------
+ */
+int
+main(int argc, char **argv)
+{
+    struct timespec start;
+    import_t        im;
+    hid_t           file, dset, space, dcpl;
+    hsize_t         dims[RANK];
+    uint64_t        budget;
+    double          time1, time2, fill = 0;
+    int             band, t, ret = 1;
+
+    parse_command_line(argc, argv);
+
+    if (hand.generate > 0) {
+        if (hand.v) printf("Generating %lli entries in %s\n", hand.generate, hand.in_file);
+        if (generate_input() < 0)
+            return 1;
+    }
+
+    memset(&im, 0, sizeof(im));
+    pthread_mutex_init(&im.lock, NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (open_input(&im) < 0)
+        return 1;
+    if (im.nrows == 0 || im.ncols == 0) {
+        printf("The matrix is empty\n");
+        return 1;
+    }
+
+    /* Bands of chunk rows whose records fit into the budget */
+    im.chunk_dims[0] = (hsize_t)hand.chunk_dim1;
+    im.chunk_dims[1] = (hsize_t)hand.chunk_dim2;
+    im.grid[0]       = (im.nrows + im.chunk_dims[0] - 1) / im.chunk_dims[0];
+    im.grid[1]       = (im.ncols + im.chunk_dims[1] - 1) / im.chunk_dims[1];
+    im.chunk_nelmts  = im.chunk_dims[0] * im.chunk_dims[1];
+    budget           = (uint64_t)hand.memory << 20;
+    im.nbands        = (int)((im.nnz * sizeof(record_t) + budget - 1) / budget);
+    if (im.nbands < 1)
+        im.nbands = 1;
+    if ((uint64_t)im.nbands > im.grid[0])
+        im.nbands = (int)im.grid[0];
+    im.band_rows   = (im.grid[0] + (uint64_t)im.nbands - 1) / (uint64_t)im.nbands;
+    im.nbands      = (int)((im.grid[0] + im.band_rows - 1) / im.band_rows);
+    im.band_chunks = im.band_rows * im.grid[1];
+
+    im.bands = (band_t *)calloc((size_t)im.nbands, sizeof(band_t));
+    if (im.nbands == 1) {
+        im.bands[0].fd      = -1;
+        im.bands[0].records = (record_t *)malloc((im.nnz ? im.nnz : 1) * sizeof(record_t));
+    }
+    else
+        for (band = 0; band < im.nbands; band++) {
+            char name[1024];
+
+            /* The spill files are unlinked at once and disappear when they are closed */
+            snprintf(name, sizeof(name), "%s/sparse_import.%d.%d.spill", hand.tmp_dir, (int)getpid(), band);
+            if ((im.bands[band].fd = open(name, O_RDWR | O_CREAT | O_TRUNC, 0600)) < 0) {
+                printf("Failed to create the spill file %s\n", name);
+                return 1;
+            }
+            unlink(name);
+        }
+
+    if (hand.v)
+        printf("Importing %llu entries of a %llux%llu matrix in %d bands with %d threads\n",
+               (unsigned long long)im.nnz, (unsigned long long)im.nrows, (unsigned long long)im.ncols, im.nbands,
+               hand.threads);
+
+    /* Pass 1: parse and bucket */
+    run_threads(&im, parse_thread);
+    time1 = elapsed(&start);
+    if (im.failed) {
+        printf("Failed to bucket the entries\n");
+        return 1;
+    }
+    if (im.nbands > 1)
+        for (band = 0; band < im.nbands; band++)
+            im.spilled += (long long int)(im.bands[band].count * sizeof(record_t));
+
+    /* Pass 2: sort and write the bands */
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    dims[0] = im.nrows;
+    dims[1] = im.ncols;
+    file    = H5Fcreate(hand.out_file, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    space   = H5Screate_simple(RANK, dims, NULL);
+    dcpl    = sc_create_dcpl(RANK, im.chunk_dims);
+    H5Pset_fill_value(dcpl, H5T_NATIVE_DOUBLE, &fill);
+    if ((dset = H5Dcreate2(file, hand.dset_name, H5T_NATIVE_DOUBLE, space, H5P_DEFAULT, dcpl, H5P_DEFAULT)) < 0) {
+        printf("Failed to create the dataset %s\n", hand.dset_name);
+        return 1;
+    }
+    H5Pclose(dcpl);
+    H5Sclose(space);
+
+    im.chunk_start   = (uint64_t *)malloc((im.band_chunks + 1) * sizeof(uint64_t));
+    im.images        = (uint8_t **)calloc(im.band_chunks, sizeof(uint8_t *));
+    im.image_sizes   = (size_t *)calloc(im.band_chunks, sizeof(size_t));
+    im.thread_counts = (uint64_t **)malloc((size_t)hand.threads * sizeof(uint64_t *));
+    for (t = 0; t < hand.threads; t++)
+        im.thread_counts[t] = (uint64_t *)malloc(im.band_chunks * sizeof(uint64_t));
+
+    for (band = 0; band < im.nbands; band++) {
+        if (hand.v) printf("Writing band %d with %llu entries\n", band, (unsigned long long)im.bands[band].count);
+        if (write_band(&im, dset, band) < 0) {
+            printf("Failed to write band %d\n", band);
+            goto done;
+        }
+    }
+    H5Dflush(dset);
+    time2 = elapsed(&start);
+
+    print_results(&im, time1, time2);
+
+    ret = hand.k && verify(dset, &im) < 0 ? 1 : 0;
+
+done:
+    H5Dclose(dset);
+    H5Fclose(file);
+    for (band = 0; band < im.nbands; band++) {
+        if (im.nbands > 1)
+            close(im.bands[band].fd);
+        free(im.bands[band].records);
+    }
+    free(im.bands);
+    for (t = 0; t < hand.threads; t++)
+        free(im.thread_counts[t]);
+    free(im.thread_counts);
+    free(im.chunk_start);
+    free(im.images);
+    free(im.image_sizes);
+    free(im.segments);
+    free(im.row_ptr_text);
+    free(im.token_counts);
+    sc_mmap_close(&im.map);
+    pthread_mutex_destroy(&im.lock);
+
+    if (hand.v) printf("Done! \n");
+
+    return ret;
+}
@@ -0,0 +1,1295 @@
+/*
+ * This program reads a region of a 2-dim sparse dataset of doubles stored with structured chunks (see
+ * structured_chunk.h) directly into user buffers in the COO, CSR or CSC format, and compares it with the
+ * three steps an application takes today with the API of RFC-HDF5-Model-API-Sparse.
+ *
+ * The direct read is a small API on top of the chunk index:
+ *
+ *   sparse_open()   - gets the dimensions and the chunk index of the dataset and opens the file for pread;
+ *   sparse_query()  - the size query: returns the number of entries of the region, and the row pointers
+ *                     (CSR) or column pointers (CSC), so that the caller can allocate the buffers;
+ *   sparse_read()   - fills the buffers allocated by the caller: the row and column of each entry (COO),
+ *                     or the column (CSR) or row (CSC) of each entry, and the values;
+ *   sparse_close()  - frees the chunk index and closes the file.
+ *
+ * Both passes run on P threads (option -p) that read the chunks with pread; the library is not used by the
+ * threads.  The threads take units of work one at a time: a chunk for COO, a row of chunks for CSR and a
+ * column of chunks for CSC, so that every row (CSR) or column (CSC) of the region is filled by one thread
+ * in the order of the columns (rows) without sorting.  The size query reads the prefix and the Encoded
+ * Selection of each chunk that intersects the region and counts its defined elements for each row or
+ * column; a chunk inside the region is counted from its prefix for COO.  The fill reads the whole chunks
+ * and copies the coordinates and values of the defined elements straight from the runs of the Encoded
+ * Selection and the Data section.  The entries of COO are in the logical order of the chunks and in
+ * row-major order in each chunk; the rows of CSR and the columns of CSC are sorted.  The coordinates are
+ * relative to the first element of the region.
+ *
+ * The three-step path is:
+ *
+ *  1 - the defined elements of the dataset (sc_get_defined emulates H5Dget_defined with H5S_ALL); the
+ *      elements in the region are appended to a point selection of the dataspace;
+ *  2 - the number of elements of the selection with H5Sget_select_npoints;
+ *  3 - the read of the selection into a packed buffer.  H5Dread of a structured chunk dataset is emulated
+ *      by reading the chunks that intersect the region with H5Dread_chunk and gathering the values of the
+ *      elements of the selection in its order;
+ *  4 - the coordinates rebuilt from the selection with H5Sget_select_elem_pointlist and converted to the
+ *      format with a counting sort.
+ *
+ * The program reports for each format the number of entries (NNZ), the number of chunks read (NC), the
+ * time of the size query (TQ), of the allocation and the fill of the buffers (TF) and of the direct read
+ * (T1), the time of each of the four steps (TD, TN, TR, TC) and of the three-step path (T3) in seconds,
+ * the millions of entries per second of the direct read (MEPS) and the speedup (X).  Each read is
+ * repeated R times (option -r) with a warm page cache and the best time is reported.  With the option
+ * -k 1 the buffers of both paths are compared.
+ *
+ * To compile the program, please use h5cc.  The -h option lists all the command line options:
+ *
+ *   [-h] [-i --inFile] [-n --nameDset] [-f --format] [-o --oOffset] [-s --sSize] [-p --pThreads]
+ *   [-r --rRepeat] [-k --kVerify] [-v --Verbose]
+ *
+ * Example: The commands
+ *
+ *           h5cc -pthread sparse_import.c -o sparse_import
+ *           h5cc -O2 -pthread sparse_read.c -o sparse_read
+ *           ./sparse_import -g 10000000 -s 100000x100000
+ *           ./sparse_read -i import_file.h5 -k 1
+ *           ./sparse_read -i import_file.h5 -f 1 -o 25000x25000 -s 50000x50000
+ *
+ * read the whole 100000x100000 matrix with 10^7 entries in the three formats, and a quarter of it into
+ * CSR buffers.
+ */
+
+#include "hdf5.h"
+#include "structured_chunk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <getopt.h>
+#include <pthread.h>
+
+#define FILE_NAME                       "import_file.h5"
+#define DSET_NAME                       "sparse"
+#define MAX_THREADS                     256
+#define REPEAT                          3
+#define RANK                            2
+
+/* Formats of the user buffers */
+#define FORMAT_COO                      0
+#define FORMAT_CSR                      1
+#define FORMAT_CSC                      2
+#define FORMAT_ALL                      3
+#define NUM_FORMATS                     3
+
+typedef struct {
+    char           *in_file;
+    char           *dset_name;
+    int             format;
+    long long int   offset1;
+    long long int   offset2;
+    long long int   size1;           /* 0 up to the end of the dataset */
+    long long int   size2;
+    int             threads;
+    int             repeat;
+    int             k;               /* compare the buffers of both paths */
+    int             v;               /* prints progress messages */
+} handler_t;
+
+/* Sparse dataset opened for direct reads */
+typedef struct {
+    int             fd;
+    hsize_t         dims[RANK];
+    hsize_t         chunk_dims[RANK];
+    size_t          nchunks;
+    sc_chunk_loc_t *locs;            /* stored chunks in the logical order */
+    int             threads;
+} sparse_reader_t;
+
+/*
+ * User buffers of a region:
+ *   COO: rows and cols of the nnz entries
+ *   CSR: rows holds the nrows+1 row pointers, cols the column of each entry
+ *   CSC: cols holds the ncols+1 column pointers, rows the row of each entry
+ */
+typedef struct {
+    uint64_t       *rows;
+    uint64_t       *cols;
+    double         *values;
+} sparse_buffers_t;
+
+/* Read of a region planned by the size query */
+typedef struct {
+    const sparse_reader_t *rd;
+    int             format;
+    hsize_t         start[RANK];
+    hsize_t         count[RANK];
+    uint64_t        nnz;             /* entries of the region */
+    uint64_t        nptr;            /* row (CSR) or column (CSC) pointers; 0 for COO */
+    size_t          ntasks;          /* chunks that intersect the region */
+    size_t         *tasks;           /* index of each of these chunks in the chunk index, by unit */
+    size_t          nunits;          /* chunks, rows of chunks or columns of chunks */
+    size_t         *unit_start;      /* first task of each unit, and the end */
+    uint64_t       *ptr;             /* first entry of each chunk (COO), row (CSR) or column (CSC), and the end */
+    uint64_t       *cursor;          /* next entry of each row or column during the fill */
+    sparse_buffers_t *out;
+    size_t          next;            /* next unit to take; taken atomically */
+    long long int   read_bytes;
+    int             failed;
+    pthread_mutex_t lock;            /* protects the statistics merged by the threads */
+} sparse_plan_t;
+
+/* Buffers of a thread, grown as needed */
+typedef struct {
+    uint8_t        *image;
+    size_t          image_max;
+    uint8_t        *sel;
+    size_t          sel_max;
+    double         *data;
+    size_t          data_max;
+    sc_run_t       *runs;
+    size_t          runs_max;
+} scratch_t;
+
+/* Points of the region gathered from the defined elements of the dataset */
+typedef struct {
+    hsize_t         start[RANK];
+    hsize_t         count[RANK];
+    hsize_t         chunk_dims[RANK];
+    hsize_t        *coords;
+    size_t          npoints;
+    size_t          max_points;
+} defined_t;
+
+typedef struct {
+    uint64_t        nnz;
+    long long int   nchunks;
+    double          query;           /* best times of the direct read */
+    double          fill;
+    double          direct;
+    double          defined;         /* best times of the three-step path */
+    double          npoints;
+    double          read;
+    double          convert;
+    double          three_step;
+    int             verified;        /* -1 not compared, 0 failed, 1 passed */
+} result_t;
+
+handler_t    hand;
+result_t     res[NUM_FORMATS];
+const char  *format_names[NUM_FORMATS] = {"COO", "CSR", "CSC"};
+
+/*------------------------------------------------------------
+ * Display command line usage
+ *------------------------------------------------------------
+ */
+void
+usage(void)
+{
+    printf("    [-h] [-i --inFile] [-n --nameDset] [-f --format] [-o --oOffset] [-s --sSize] [-p --pThreads]\n");
+    printf("    [-r --rRepeat] [-k --kVerify] [-v --Verbose]\n");
+    printf("    [-h --help]: this help page\n");
+    printf("    [-i --inFile]: the file with the sparse dataset of doubles (default %s)\n", FILE_NAME);
+    printf("    [-n --nameDset]: the name of the dataset (default %s)\n", DSET_NAME);
+    printf("    [-f --format]: 0 - COO, 1 - CSR, 2 - CSC, 3 - all formats (default)\n");
+    printf("    [-o --oOffset]: the first element of the region (default 0x0)\n");
+    printf("    [-s --sSize]: the size of the region; 0 up to the end of the dataset (default 0x0)\n");
+    printf("    [-p --pThreads]: the number of threads of the direct read (default the number of CPUs)\n");
+    printf("    [-r --rRepeat]: the number of reads of each path (default %d)\n", REPEAT);
+    printf("    [-k --kVerify]: compare the buffers of both paths (1) or not (0, default)\n");
+    printf("    [-v --Verbose]: Print progress messages(1); default no messages displayed (0) \n");
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Parse a string of the form AxB; missing dimensions are set
+ * to 0
+ *------------------------------------------------------------
+ */
+void
+parse_dims(const char *str, int ndims, long long int *dims[])
+{
+    char *dims_str, *dim_str;
+    int   i;
+
+    dims_str = strdup(str);
+    dim_str  = strtok(dims_str, "x");
+    for (i = 0; i < ndims; i++) {
+        *dims[i] = dim_str ? atoll(dim_str) : 0;
+        dim_str  = strtok(NULL, "x");
+    }
+    free(dims_str);
+}
+
+/*------------------------------------------------------------
+ * Parse command line option
+ *------------------------------------------------------------
+ */
+void
+parse_command_line(int argc, char *argv[])
+{
+    int            opt;
+    long long int *offset[2] = {&hand.offset1, &hand.offset2};
+    long long int *size[2]   = {&hand.size1, &hand.size2};
+    struct option  long_options[] = {
+                                    {"help", no_argument, NULL, 'h'},
+                                    {"inFile=", required_argument, NULL, 'i'},
+                                    {"nameDset=", required_argument, NULL, 'n'},
+                                    {"format=", required_argument, NULL, 'f'},
+                                    {"oOffset=", required_argument, NULL, 'o'},
+                                    {"sSize=", required_argument, NULL, 's'},
+                                    {"pThreads=", required_argument, NULL, 'p'},
+                                    {"rRepeat=", required_argument, NULL, 'r'},
+                                    {"kVerify=", required_argument, NULL, 'k'},
+                                    {"Verbose=", required_argument, NULL, 'v'},
+                                    {NULL, 0, NULL, 0}};
+
+    /* Initialize the command line options */
+    hand.in_file   = FILE_NAME;
+    hand.dset_name = DSET_NAME;
+    hand.format    = FORMAT_ALL;
+    hand.offset1   = 0;
+    hand.offset2   = 0;
+    hand.size1     = 0;
+    hand.size2     = 0;
+    hand.threads   = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    hand.repeat    = REPEAT;
+    hand.k         = 0;
+    hand.v         = 0;
+
+    while ((opt = getopt_long(argc, argv, "hi:n:f:o:s:p:r:k:v:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'h':
+                fprintf(stdout, "Help page:\n");
+                usage();
+
+                exit(0);
+
+                break;
+            case 'i':
+                if (optarg) {
+                    fprintf(stdout, "Input file:\t\t\t\t\t\t%s\n", optarg);
+                    hand.in_file = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'n':
+                if (optarg) {
+                    fprintf(stdout, "Dataset:\t\t\t\t\t\t%s\n", optarg);
+                    hand.dset_name = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'f':
+                if (optarg) {
+                    hand.format = atoi(optarg);
+                    if (hand.format >= FORMAT_COO && hand.format < NUM_FORMATS)
+                        fprintf(stdout, "Format: \t\t\t\t\t\t%s\n", format_names[hand.format]);
+                    else if (hand.format == FORMAT_ALL)
+                        fprintf(stdout, "Format: \t\t\t\t\t\tall\n");
+                    else
+                        fprintf(stdout, "Format:\t\t\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'o':
+                if (optarg) {
+                    fprintf(stdout, "Offset of the region:\t\t\t\t\t%s\n", optarg);
+                    parse_dims(optarg, 2, offset);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 's':
+                if (optarg) {
+                    fprintf(stdout, "Size of the region:\t\t\t\t\t%s\n", optarg);
+                    parse_dims(optarg, 2, size);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'p':
+                if (optarg) {
+                    fprintf(stdout, "Number of threads:\t\t\t\t\t%s\n", optarg);
+                    hand.threads = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'r':
+                if (optarg) {
+                    fprintf(stdout, "Number of reads:\t\t\t\t\t%s\n", optarg);
+                    hand.repeat = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'k':
+                if (optarg) {
+                    hand.k = atoi(optarg);
+                    if (hand.k == 1)
+                        fprintf(stdout, "Verify: \t\t\t\t\t\ton\n");
+                    else if (hand.k == 0)
+                        fprintf(stdout, "Verify: \t\t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Verify:\t\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'v':
+                if (optarg) {
+                    hand.v = atoi(optarg);
+                    if (hand.v == 1)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\ton\n");
+                    else if (hand.v == 0)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Verbose mode:\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case ':':
+                printf("Option needs a value\n");
+                break;
+            case '?':
+                printf("Unknown option: %c\n", optopt);
+                break;
+        }
+    }
+
+    /* optind is for the extra arguments which are not parsed */
+    for (; optind < argc; optind++) {
+        printf("extra arguments not parsed: %s\n", argv[optind]);
+    }
+
+    /* Make sure the command line options are valid */
+    if (hand.format < FORMAT_COO || hand.format > FORMAT_ALL) {
+        printf("The format can only be 0, 1, 2 or 3\n");
+        exit(1);
+    }
+
+    if (hand.offset1 < 0 || hand.offset2 < 0 || hand.size1 < 0 || hand.size2 < 0) {
+        printf("The offset and the size of the region can not be negative\n");
+        exit(1);
+    }
+
+    if (hand.threads < 1 || hand.threads > MAX_THREADS) {
+        printf("The number of threads must be between 1 and %d\n", MAX_THREADS);
+        exit(1);
+    }
+
+    if (hand.repeat < 1) {
+        printf("The number of reads must be positive\n");
+        exit(1);
+    }
+
+    if (hand.k < 0 || hand.k > 1) {
+        printf("Verify flag can only be 0 or 1 \n");
+        exit(1);
+    }
+
+    if (hand.v < 0 || hand.v > 1) {
+        printf("Verbose flag can only be 0 or 1 \n");
+        exit(1);
+    }
+}
+
+/*------------------------------------------------------------
+ * Print the results
+ *------------------------------------------------------------
+ */
+void print_results(void)
+{
+    int f;
+
+    printf("\n");
+    printf("Printing for each format the number of entries (NNZ), chunks read (NC), the time of the size query\n");
+    printf("(TQ), of the allocation and fill (TF) and of the direct read (T1), the time of the defined elements\n");
+    printf("(TD), of the number of elements (TN), of the read (TR), of the conversion (TC) and of the three-step\n");
+    printf("path (T3) in seconds, millions of entries per second of the direct read (MEPS) and speedup (X)\n");
+    printf("\n");
+    printf("    format        NNZ         NC         TQ         TF         T1         TD         TN         TR         TC         T3       MEPS          X\n");
+    printf("\n");
+    for (f = 0; f < NUM_FORMATS; f++) {
+        if (hand.format != FORMAT_ALL && hand.format != f)
+            continue;
+        printf("%10s %10llu %10lli %10.4f %10.4f %10.4f %10.4f %10.4f %10.4f %10.4f %10.4f %10.3f %10.2f \n",
+               format_names[f], (unsigned long long)res[f].nnz, res[f].nchunks, res[f].query, res[f].fill,
+               res[f].direct, res[f].defined, res[f].npoints, res[f].read, res[f].convert, res[f].three_step,
+               res[f].direct > 0 ? (double)res[f].nnz / res[f].direct / 1e6 : 0.0,
+               res[f].direct > 0 ? res[f].three_step / res[f].direct : 0.0);
+    }
+    printf("\n");
+
+    for (f = 0; f < NUM_FORMATS; f++)
+        if (res[f].verified >= 0)
+            printf("Verification of %s: %s\n", format_names[f], res[f].verified ? "passed" : "failed");
+}
+
+/*------------------------------------------------------------
+ * Elapsed time
+ *------------------------------------------------------------
+ */
+double elapsed(struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*------------------------------------------------------------
+ * Read "size" bytes at "addr" of the file
+ *------------------------------------------------------------
+ */
+int read_full(int fd, void *buf, size_t size, haddr_t addr)
+{
+    size_t done = 0;
+
+    while (done < size) {
+        ssize_t n = pread(fd, (uint8_t *)buf + done, size - done, (off_t)(addr + done));
+
+        if (n <= 0)
+            return -1;
+        done += (size_t)n;
+    }
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Make sure a buffer holds "size" bytes
+ *------------------------------------------------------------
+ */
+int grow(void **buf, size_t *max, size_t size)
+{
+    void *tmp;
+
+    if (size <= *max)
+        return 0;
+    if (NULL == (tmp = realloc(*buf, size)))
+        return -1;
+    *buf = tmp;
+    *max = size;
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Decode the Encoded Selection (and, with "data", the Data
+ * section) of the chunk image in the scratch buffers into runs
+ * of defined elements
+ *------------------------------------------------------------
+ */
+int decode_chunk(scratch_t *s, const sc_chunk_info_t *info, int data, size_t *nruns)
+{
+    const uint8_t *p = s->image + SC_PREFIX_SIZE;
+    hsize_t        sel_dims[SC_MAX_RANK];
+    int            rank;
+
+    if (info->num_sections < 2 || !(info->type & SC_SPARSE_CHUNK))
+        return -1;
+    if (grow((void **)&s->sel, &s->sel_max, (size_t)info->section_orig_size[SC_SECTION_SELECTION]) < 0 ||
+        sc_decode_section(info, SC_SECTION_SELECTION, p, s->sel) < 0)
+        return -1;
+    if (sc_decode_runs(s->sel, (size_t)info->section_orig_size[SC_SECTION_SELECTION], &rank, sel_dims, nruns,
+                       NULL) < 0 || rank != RANK)
+        return -1;
+    if (grow((void **)&s->runs, &s->runs_max, (*nruns ? *nruns : 1) * sizeof(sc_run_t)) < 0 ||
+        sc_decode_runs(s->sel, (size_t)info->section_orig_size[SC_SECTION_SELECTION], &rank, sel_dims, nruns,
+                       s->runs) < 0)
+        return -1;
+
+    if (data) {
+        if (info->section_orig_size[SC_SECTION_FIXED] != info->nelemts * sizeof(double))
+            return -1;
+        p += info->section_size[SC_SECTION_SELECTION];
+        if (grow((void **)&s->data, &s->data_max, (size_t)info->section_orig_size[SC_SECTION_FIXED] + 1) < 0 ||
+            sc_decode_section(info, SC_SECTION_FIXED, p, s->data) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Read the prefix and the Encoded Selection of a chunk into the
+ * scratch buffers
+ *------------------------------------------------------------
+ */
+int read_selection(int fd, const sc_chunk_loc_t *loc, scratch_t *s, sc_chunk_info_t *info, long long int *bytes)
+{
+    size_t need = (size_t)loc->size < SC_PREFIX_SIZE + SC_SELECTION_READAHEAD ? (size_t)loc->size
+                                                                              : SC_PREFIX_SIZE + SC_SELECTION_READAHEAD;
+    size_t have = need;
+
+    if (need < SC_PREFIX_SIZE || grow((void **)&s->image, &s->image_max, need) < 0 ||
+        read_full(fd, s->image, need, loc->addr) < 0 || sc_decode_prefix(s->image, info) < 0)
+        return -1;
+    need = SC_PREFIX_SIZE + (size_t)info->section_size[SC_SECTION_SELECTION];
+    if (need > (size_t)loc->size)
+        return -1;
+    if (need > have) {
+        if (grow((void **)&s->image, &s->image_max, need) < 0 ||
+            read_full(fd, s->image + have, need - have, loc->addr + have) < 0)
+            return -1;
+        have = need;
+    }
+    *bytes += (long long int)have;
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Read a whole chunk into the scratch buffers
+ *------------------------------------------------------------
+ */
+int read_chunk(int fd, const sc_chunk_loc_t *loc, scratch_t *s, sc_chunk_info_t *info, long long int *bytes)
+{
+    if (grow((void **)&s->image, &s->image_max, (size_t)loc->size) < 0 ||
+        read_full(fd, s->image, (size_t)loc->size, loc->addr) < 0 ||
+        sc_disassemble_chunk(s->image, (size_t)loc->size, info, NULL) < 0)
+        return -1;
+    *bytes += (long long int)loc->size;
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Free the buffers of a thread
+ *------------------------------------------------------------
+ */
+void free_scratch(scratch_t *s)
+{
+    free(s->image);
+    free(s->sel);
+    free(s->data);
+    free(s->runs);
+}
+
+/*------------------------------------------------------------
+ * Open a 2-dim sparse dataset of doubles for direct reads
+ *------------------------------------------------------------
+ */
+int sparse_open(const char *file_name, const char *dset_name, int threads, sparse_reader_t *rd)
+{
+    hid_t file = H5I_INVALID_HID, dset = H5I_INVALID_HID, space = H5I_INVALID_HID;
+    hid_t dcpl = H5I_INVALID_HID, type = H5I_INVALID_HID;
+    int   ret = -1;
+
+    memset(rd, 0, sizeof(*rd));
+    rd->fd      = -1;
+    rd->threads = threads;
+
+    if ((file = H5Fopen(file_name, H5F_ACC_RDONLY, H5P_DEFAULT)) < 0 ||
+        (dset = H5Dopen2(file, dset_name, H5P_DEFAULT)) < 0)
+        goto done;
+    if ((space = H5Dget_space(dset)) < 0 || H5Sget_simple_extent_ndims(space) != RANK ||
+        H5Sget_simple_extent_dims(space, rd->dims, NULL) < 0)
+        goto done;
+    if ((dcpl = H5Dget_create_plist(dset)) < 0 || H5Pget_chunk(dcpl, RANK, rd->chunk_dims) != RANK)
+        goto done;
+    if ((type = H5Dget_type(dset)) < 0 || H5Tequal(type, H5T_NATIVE_DOUBLE) <= 0)
+        goto done;
+    if (sc_get_chunk_locations(dset, &rd->nchunks, &rd->locs) < 0)
+        goto done;
+    if ((rd->fd = open(file_name, O_RDONLY)) < 0)
+        goto done;
+    ret = 0;
+
+done:
+    if (type >= 0)
+        H5Tclose(type);
+    if (dcpl >= 0)
+        H5Pclose(dcpl);
+    if (space >= 0)
+        H5Sclose(space);
+    if (dset >= 0)
+        H5Dclose(dset);
+    if (file >= 0)
+        H5Fclose(file);
+    if (ret < 0) {
+        free(rd->locs);
+        rd->locs = NULL;
+    }
+
+    return ret;
+}
+
+/*------------------------------------------------------------
+ * Close a dataset opened for direct reads
+ *------------------------------------------------------------
+ */
+void sparse_close(sparse_reader_t *rd)
+{
+    if (rd->fd >= 0)
+        close(rd->fd);
+    free(rd->locs);
+    rd->locs = NULL;
+}
+
+/*------------------------------------------------------------
+ * Free a plan
+ *------------------------------------------------------------
+ */
+void sparse_free_plan(sparse_plan_t *plan)
+{
+    free(plan->tasks);
+    free(plan->unit_start);
+    free(plan->ptr);
+    free(plan->cursor);
+    pthread_mutex_destroy(&plan->lock);
+    memset(plan, 0, sizeof(*plan));
+}
+
+/*------------------------------------------------------------
+ * Run "func" on the threads of the reader
+ *------------------------------------------------------------
+ */
+void run_threads(sparse_plan_t *plan, void *(*func)(void *))
+{
+    pthread_t threads[MAX_THREADS];
+    int       i;
+
+    plan->next = 0;
+    for (i = 0; i < plan->rd->threads; i++)
+        pthread_create(&threads[i], NULL, func, plan);
+    for (i = 0; i < plan->rd->threads; i++)
+        pthread_join(threads[i], NULL);
+}
+
+/*------------------------------------------------------------
+ * Size query: count the defined elements of the chunks of the
+ * units taken by the thread in the region
+ *------------------------------------------------------------
+ */
+void *query_thread(void *arg)
+{
+    sparse_plan_t         *plan = (sparse_plan_t *)arg;
+    const sparse_reader_t *rd   = plan->rd;
+    const hsize_t         *cd   = rd->chunk_dims;
+    scratch_t              s;
+    long long int          bytes = 0;
+    size_t                 u, t;
+    int                    failed = 0;
+
+    memset(&s, 0, sizeof(s));
+
+    while (!failed && (u = __sync_fetch_and_add(&plan->next, 1)) < plan->nunits)
+        for (t = plan->unit_start[u]; t < plan->unit_start[u + 1]; t++) {
+            const sc_chunk_loc_t *loc = &rd->locs[plan->tasks[t]];
+            sc_chunk_info_t       info;
+            uint64_t              n = 0;
+            size_t                nruns, r;
+
+            if (read_selection(rd->fd, loc, &s, &info, &bytes) < 0) {
+                failed = 1;
+                break;
+            }
+
+            /* A chunk inside the region is counted from its prefix for COO */
+            if (plan->format == FORMAT_COO && loc->offset[0] >= plan->start[0] && loc->offset[1] >= plan->start[1] &&
+                loc->offset[0] + cd[0] <= plan->start[0] + plan->count[0] &&
+                loc->offset[1] + cd[1] <= plan->start[1] + plan->count[1]) {
+                plan->ptr[t + 1] = info.nelemts;
+                continue;
+            }
+
+            if (decode_chunk(&s, &info, 0, &nruns) < 0) {
+                failed = 1;
+                break;
+            }
+            for (r = 0; r < nruns; r++) {
+                hsize_t row = loc->offset[0] + s.runs[r].start / cd[1];
+                hsize_t c0  = loc->offset[1] + s.runs[r].start % cd[1];
+                hsize_t c1  = c0 + s.runs[r].len;
+                hsize_t c;
+
+                if (row < plan->start[0] || row >= plan->start[0] + plan->count[0])
+                    continue;
+                if (c0 < plan->start[1])
+                    c0 = plan->start[1];
+                if (c1 > plan->start[1] + plan->count[1])
+                    c1 = plan->start[1] + plan->count[1];
+                if (c0 >= c1)
+                    continue;
+
+                if (plan->format == FORMAT_COO)
+                    n += c1 - c0;
+                else if (plan->format == FORMAT_CSR)
+                    plan->ptr[row - plan->start[0] + 1] += c1 - c0;
+                else
+                    for (c = c0; c < c1; c++)
+                        plan->ptr[c - plan->start[1] + 1]++;
+            }
+            if (plan->format == FORMAT_COO)
+                plan->ptr[t + 1] = n;
+        }
+
+    free_scratch(&s);
+
+    pthread_mutex_lock(&plan->lock);
+    plan->read_bytes += bytes;
+    if (failed)
+        plan->failed = 1;
+    pthread_mutex_unlock(&plan->lock);
+
+    return NULL;
+}
+
+/*------------------------------------------------------------
+ * Size query of a region: finds the chunks that intersect the
+ * region and counts the entries of each chunk (COO), row (CSR)
+ * or column (CSC).  "plan->nnz" is the number of entries and
+ * "plan->nptr" the number of row or column pointers that the
+ * buffers of sparse_read must hold.
+ *------------------------------------------------------------
+ */
+int sparse_query(const sparse_reader_t *rd, int format, const hsize_t *start, const hsize_t *count,
+                 sparse_plan_t *plan)
+{
+    size_t  *unit_of = NULL, *unit_count = NULL;
+    hsize_t  grid[RANK];
+    size_t   c, t, u;
+
+    for (c = 0; c < RANK; c++)
+        if (start[c] + count[c] > rd->dims[c])
+            return -1;
+
+    memset(plan, 0, sizeof(*plan));
+    pthread_mutex_init(&plan->lock, NULL);
+    plan->rd     = rd;
+    plan->format = format;
+    for (c = 0; c < RANK; c++) {
+        plan->start[c] = start[c];
+        plan->count[c] = count[c];
+        grid[c]        = (rd->dims[c] + rd->chunk_dims[c] - 1) / rd->chunk_dims[c];
+    }
+
+    /*
+     * The units are the chunks (COO), the rows of chunks (CSR) or the columns of chunks (CSC); the chunk
+     * index is in row-major order, so the tasks of a unit are bucketed by the unit in a stable way
+     */
+    plan->nunits = format == FORMAT_COO ? rd->nchunks : (size_t)(format == FORMAT_CSR ? grid[0] : grid[1]);
+    plan->nptr   = format == FORMAT_CSR ? count[0] + 1 : format == FORMAT_CSC ? count[1] + 1 : 0;
+    unit_of      = (size_t *)malloc((rd->nchunks ? rd->nchunks : 1) * sizeof(size_t));
+    unit_count   = (size_t *)calloc(plan->nunits + 1, sizeof(size_t));
+    plan->tasks  = (size_t *)malloc((rd->nchunks ? rd->nchunks : 1) * sizeof(size_t));
+    plan->unit_start = (size_t *)calloc(plan->nunits + 1, sizeof(size_t));
+    if (!unit_of || !unit_count || !plan->tasks || !plan->unit_start)
+        goto error;
+
+    for (c = 0; c < rd->nchunks; c++) {
+        const hsize_t *offset = rd->locs[c].offset;
+
+        unit_of[c] = (size_t)-1;
+        if (offset[0] >= start[0] + count[0] || offset[0] + rd->chunk_dims[0] <= start[0] ||
+            offset[1] >= start[1] + count[1] || offset[1] + rd->chunk_dims[1] <= start[1])
+            continue;
+        unit_of[c] = format == FORMAT_COO ? plan->ntasks
+                                          : (size_t)(offset[format == FORMAT_CSR ? 0 : 1] /
+                                                     rd->chunk_dims[format == FORMAT_CSR ? 0 : 1]);
+        unit_count[unit_of[c] + 1]++;
+        plan->ntasks++;
+    }
+    if (format == FORMAT_COO)
+        plan->nunits = plan->ntasks;
+    for (u = 0; u < plan->nunits; u++)
+        unit_count[u + 1] += unit_count[u];
+    memcpy(plan->unit_start, unit_count, (plan->nunits + 1) * sizeof(size_t));
+    for (c = 0; c < rd->nchunks; c++)
+        if (unit_of[c] != (size_t)-1)
+            plan->tasks[unit_count[unit_of[c]]++] = c;
+    free(unit_of);
+    free(unit_count);
+    unit_of    = NULL;
+    unit_count = NULL;
+
+    /* Count the entries in parallel; each unit owns its counters */
+    if (NULL == (plan->ptr = (uint64_t *)calloc((format == FORMAT_COO ? plan->ntasks : plan->nptr) + 1,
+                                                sizeof(uint64_t))))
+        goto error;
+    run_threads(plan, query_thread);
+    if (plan->failed)
+        goto error;
+
+    for (t = 0; t < (format == FORMAT_COO ? plan->ntasks : plan->nptr - 1); t++)
+        plan->ptr[t + 1] += plan->ptr[t];
+    plan->nnz = plan->ptr[format == FORMAT_COO ? plan->ntasks : plan->nptr - 1];
+
+    return 0;
+
+error:
+    free(unit_of);
+    free(unit_count);
+    sparse_free_plan(plan);
+    return -1;
+}
+
+/*------------------------------------------------------------
+ * Fill: copy the entries of the chunks of the units taken by
+ * the thread into the buffers
+ *------------------------------------------------------------
+ */
+void *fill_thread(void *arg)
+{
+    sparse_plan_t         *plan = (sparse_plan_t *)arg;
+    const sparse_reader_t *rd   = plan->rd;
+    const hsize_t         *cd   = rd->chunk_dims;
+    sparse_buffers_t      *out  = plan->out;
+    scratch_t              s;
+    long long int          bytes = 0;
+    size_t                 u, t;
+    int                    failed = 0;
+
+    memset(&s, 0, sizeof(s));
+
+    while (!failed && (u = __sync_fetch_and_add(&plan->next, 1)) < plan->nunits)
+        for (t = plan->unit_start[u]; t < plan->unit_start[u + 1]; t++) {
+            const sc_chunk_loc_t *loc = &rd->locs[plan->tasks[t]];
+            sc_chunk_info_t       info;
+            uint64_t              p = plan->format == FORMAT_COO ? plan->ptr[t] : 0, k = 0;
+            size_t                nruns, r;
+
+            if (read_chunk(rd->fd, loc, &s, &info, &bytes) < 0 || decode_chunk(&s, &info, 1, &nruns) < 0) {
+                failed = 1;
+                break;
+            }
+
+            /* The values of the runs follow each other in the Data section */
+            for (r = 0; r < nruns; k += s.runs[r].len, r++) {
+                hsize_t row = loc->offset[0] + s.runs[r].start / cd[1];
+                hsize_t c0  = loc->offset[1] + s.runs[r].start % cd[1];
+                hsize_t c1  = c0 + s.runs[r].len;
+                hsize_t first = c0, c;
+                const double *v;
+
+                if (row < plan->start[0] || row >= plan->start[0] + plan->count[0])
+                    continue;
+                if (c0 < plan->start[1])
+                    c0 = plan->start[1];
+                if (c1 > plan->start[1] + plan->count[1])
+                    c1 = plan->start[1] + plan->count[1];
+                if (c0 >= c1)
+                    continue;
+                v = s.data + k + (c0 - first);
+
+                switch (plan->format) {
+                    case FORMAT_COO:
+                        for (c = c0; c < c1; c++, p++) {
+                            out->rows[p]   = row - plan->start[0];
+                            out->cols[p]   = c - plan->start[1];
+                            out->values[p] = *v++;
+                        }
+                        break;
+                    case FORMAT_CSR:
+                        p = plan->cursor[row - plan->start[0]];
+                        plan->cursor[row - plan->start[0]] += c1 - c0;
+                        for (c = c0; c < c1; c++, p++) {
+                            out->cols[p]   = c - plan->start[1];
+                            out->values[p] = *v++;
+                        }
+                        break;
+                    case FORMAT_CSC:
+                        for (c = c0; c < c1; c++) {
+                            p              = plan->cursor[c - plan->start[1]]++;
+                            out->rows[p]   = row - plan->start[0];
+                            out->values[p] = *v++;
+                        }
+                        break;
+                }
+            }
+        }
+
+    free_scratch(&s);
+
+    pthread_mutex_lock(&plan->lock);
+    plan->read_bytes += bytes;
+    if (failed)
+        plan->failed = 1;
+    pthread_mutex_unlock(&plan->lock);
+
+    return NULL;
+}
+
+/*------------------------------------------------------------
+ * Fill the buffers of a region planned by sparse_query: the
+ * buffers of the entries hold plan->nnz elements and the row
+ * or column pointers plan->nptr elements
+ *------------------------------------------------------------
+ */
+int sparse_read(sparse_plan_t *plan, sparse_buffers_t *out)
+{
+    plan->out = out;
+    if (plan->format == FORMAT_CSR)
+        memcpy(out->rows, plan->ptr, plan->nptr * sizeof(uint64_t));
+    else if (plan->format == FORMAT_CSC)
+        memcpy(out->cols, plan->ptr, plan->nptr * sizeof(uint64_t));
+
+    /* The rows (CSR) or columns (CSC) are filled from their first entry on */
+    if (plan->format != FORMAT_COO) {
+        free(plan->cursor);
+        if (NULL == (plan->cursor = (uint64_t *)malloc(plan->nptr * sizeof(uint64_t))))
+            return -1;
+        memcpy(plan->cursor, plan->ptr, plan->nptr * sizeof(uint64_t));
+    }
+
+    plan->failed = 0;
+    run_threads(plan, fill_thread);
+
+    return plan->failed ? -1 : 0;
+}
+
+/*------------------------------------------------------------
+ * Allocate the buffers of a planned read
+ *------------------------------------------------------------
+ */
+int alloc_buffers(const sparse_plan_t *plan, sparse_buffers_t *out)
+{
+    size_t nnz = (size_t)(plan->nnz ? plan->nnz : 1);
+
+    out->rows   = (uint64_t *)malloc((plan->format == FORMAT_CSR ? (size_t)plan->nptr : nnz) * sizeof(uint64_t));
+    out->cols   = (uint64_t *)malloc((plan->format == FORMAT_CSC ? (size_t)plan->nptr : nnz) * sizeof(uint64_t));
+    out->values = (double *)malloc(nnz * sizeof(double));
+
+    return out->rows && out->cols && out->values ? 0 : -1;
+}
+
+/*------------------------------------------------------------
+ * Free the buffers
+ *------------------------------------------------------------
+ */
+void free_buffers(sparse_buffers_t *out)
+{
+    free(out->rows);
+    free(out->cols);
+    free(out->values);
+    memset(out, 0, sizeof(*out));
+}
+
+/*------------------------------------------------------------
+ * Callback of sc_get_defined: append the defined elements of a
+ * chunk that are in the region to the points
+ *------------------------------------------------------------
+ */
+herr_t defined_op(const hsize_t *offset, size_t nruns, const sc_run_t *runs, void *op_data)
+{
+    defined_t *d = (defined_t *)op_data;
+    size_t     r;
+
+    for (r = 0; r < nruns; r++) {
+        hsize_t row = offset[0] + runs[r].start / d->chunk_dims[1];
+        hsize_t c0  = offset[1] + runs[r].start % d->chunk_dims[1];
+        hsize_t c1  = c0 + runs[r].len;
+        hsize_t c;
+
+        if (row < d->start[0] || row >= d->start[0] + d->count[0])
+            continue;
+        if (c0 < d->start[1])
+            c0 = d->start[1];
+        if (c1 > d->start[1] + d->count[1])
+            c1 = d->start[1] + d->count[1];
+        if (c0 >= c1)
+            continue;
+
+        if (d->npoints + (c1 - c0) > d->max_points) {
+            size_t   max = 2 * d->max_points + (size_t)(c1 - c0) + 1024;
+            hsize_t *tmp;
+
+            if (NULL == (tmp = (hsize_t *)realloc(d->coords, max * RANK * sizeof(hsize_t))))
+                return -1;
+            d->coords     = tmp;
+            d->max_points = max;
+        }
+        for (c = c0; c < c1; c++) {
+            d->coords[RANK * d->npoints]     = row;
+            d->coords[RANK * d->npoints + 1] = c;
+            d->npoints++;
+        }
+    }
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * The three-step path: the defined elements of the region as a
+ * selection, the number of elements, the read of the selection
+ * and the conversion of its coordinates to the format
+ *------------------------------------------------------------
+ */
+int three_step_read(hid_t file, hid_t dset, const sparse_reader_t *rd, int format, const hsize_t *start,
+                    const hsize_t *count, sparse_buffers_t *out, uint64_t *nnz, double times[4])
+{
+    struct timespec t0;
+    defined_t       d;
+    scratch_t       s;
+    hid_t           space = H5I_INVALID_HID;
+    hsize_t        *coords = NULL;
+    hssize_t        npoints;
+    uint64_t        n, i, k = 0, *count_ptr = NULL, *ptr;
+    size_t          c;
+    int             ret = -1;
+
+    memset(&d, 0, sizeof(d));
+    memset(&s, 0, sizeof(s));
+    memcpy(d.start, start, sizeof(d.start));
+    memcpy(d.count, count, sizeof(d.count));
+    memcpy(d.chunk_dims, rd->chunk_dims, sizeof(d.chunk_dims));
+
+    /* 1: the defined elements of the region as a point selection */
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    if (sc_get_defined(file, hand.dset_name, 1, defined_op, &d) < 0 || (space = H5Dget_space(dset)) < 0)
+        goto done;
+    if (d.npoints > 0 ? H5Sselect_elements(space, H5S_SELECT_SET, d.npoints, d.coords) < 0
+                      : H5Sselect_none(space) < 0)
+        goto done;
+    free(d.coords);
+    d.coords = NULL;
+    times[0] = elapsed(&t0);
+
+    /* 2: the number of elements */
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    if ((npoints = H5Sget_select_npoints(space)) < 0)
+        goto done;
+    n        = (uint64_t)npoints;
+    *nnz     = n;
+    times[1] = elapsed(&t0);
+
+    /* 3: the read of the selection into a packed buffer (emulates H5Dread) */
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    if (NULL == (out->values = (double *)malloc((n ? n : 1) * sizeof(double))))
+        goto done;
+    for (c = 0; c < rd->nchunks; c++) {
+        const sc_chunk_loc_t *loc = &rd->locs[c];
+        sc_chunk_info_t       info;
+        uint32_t              filters;
+        size_t                nruns, r;
+        uint64_t              e = 0;
+
+        if (loc->offset[0] >= start[0] + count[0] || loc->offset[0] + rd->chunk_dims[0] <= start[0] ||
+            loc->offset[1] >= start[1] + count[1] || loc->offset[1] + rd->chunk_dims[1] <= start[1])
+            continue;
+        if (grow((void **)&s.image, &s.image_max, (size_t)loc->size) < 0 ||
+            H5Dread_chunk(dset, H5P_DEFAULT, loc->offset, &filters, s.image) < 0 ||
+            sc_disassemble_chunk(s.image, (size_t)loc->size, &info, NULL) < 0 ||
+            decode_chunk(&s, &info, 1, &nruns) < 0)
+            goto done;
+        for (r = 0; r < nruns; e += s.runs[r].len, r++) {
+            hsize_t row = loc->offset[0] + s.runs[r].start / rd->chunk_dims[1];
+            hsize_t c0  = loc->offset[1] + s.runs[r].start % rd->chunk_dims[1];
+            hsize_t c1  = c0 + s.runs[r].len;
+            hsize_t first = c0;
+
+            if (row < start[0] || row >= start[0] + count[0])
+                continue;
+            if (c0 < start[1])
+                c0 = start[1];
+            if (c1 > start[1] + count[1])
+                c1 = start[1] + count[1];
+            if (c0 >= c1)
+                continue;
+            if (k + (c1 - c0) > n)
+                goto done;
+            memcpy(out->values + k, s.data + e + (c0 - first), (size_t)(c1 - c0) * sizeof(double));
+            k += c1 - c0;
+        }
+    }
+    if (k != n)
+        goto done;
+    times[2] = elapsed(&t0);
+
+    /* 4: the coordinates of the selection converted to the format */
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    if (NULL == (coords = (hsize_t *)malloc((n ? n : 1) * RANK * sizeof(hsize_t))))
+        goto done;
+    if (n > 0 && H5Sget_select_elem_pointlist(space, 0, n, coords) < 0)
+        goto done;
+    if (format == FORMAT_COO) {
+        out->rows = (uint64_t *)malloc((n ? n : 1) * sizeof(uint64_t));
+        out->cols = (uint64_t *)malloc((n ? n : 1) * sizeof(uint64_t));
+        if (!out->rows || !out->cols)
+            goto done;
+        for (i = 0; i < n; i++) {
+            out->rows[i] = coords[RANK * i] - start[0];
+            out->cols[i] = coords[RANK * i + 1] - start[1];
+        }
+    }
+    else {
+        /* Stable counting sort by row (CSR) or column (CSC) */
+        int       d_major = format == FORMAT_CSR ? 0 : 1;
+        uint64_t  nptr    = count[d_major] + 1;
+        uint64_t *minor;
+        double   *values;
+
+        ptr       = (uint64_t *)calloc(nptr, sizeof(uint64_t));
+        count_ptr = (uint64_t *)malloc(nptr * sizeof(uint64_t));
+        minor     = (uint64_t *)malloc((n ? n : 1) * sizeof(uint64_t));
+        values    = (double *)malloc((n ? n : 1) * sizeof(double));
+        if (format == FORMAT_CSR) {
+            out->rows = ptr;
+            out->cols = minor;
+        }
+        else {
+            out->cols = ptr;
+            out->rows = minor;
+        }
+        if (!ptr || !count_ptr || !minor || !values) {
+            free(values);
+            goto done;
+        }
+        for (i = 0; i < n; i++)
+            ptr[coords[RANK * i + d_major] - start[d_major] + 1]++;
+        for (i = 0; i + 1 < nptr; i++)
+            ptr[i + 1] += ptr[i];
+        memcpy(count_ptr, ptr, nptr * sizeof(uint64_t));
+        for (i = 0; i < n; i++) {
+            uint64_t p = count_ptr[coords[RANK * i + d_major] - start[d_major]]++;
+
+            minor[p]  = coords[RANK * i + 1 - d_major] - start[1 - d_major];
+            values[p] = out->values[i];
+        }
+        free(out->values);
+        out->values = values;
+    }
+    times[3] = elapsed(&t0);
+    ret      = 0;
+
+done:
+    if (space >= 0)
+        H5Sclose(space);
+    free(d.coords);
+    free(coords);
+    free(count_ptr);
+    free_scratch(&s);
+
+    return ret;
+}
+
+/*------------------------------------------------------------
+ * Compare the buffers of both paths
+ *------------------------------------------------------------
+ */
+int same_buffers(int format, uint64_t nnz, uint64_t nptr, const sparse_buffers_t *a, const sparse_buffers_t *b)
+{
+    size_t rows = (size_t)(format == FORMAT_CSR ? nptr : nnz) * sizeof(uint64_t);
+    size_t cols = (size_t)(format == FORMAT_CSC ? nptr : nnz) * sizeof(uint64_t);
+
+    return memcmp(a->rows, b->rows, rows) == 0 && memcmp(a->cols, b->cols, cols) == 0 &&
+           memcmp(a->values, b->values, (size_t)nnz * sizeof(double)) == 0;
+}
+
+/*------------------------------------------------------------
+ * Main function
+ *------------------------------------------------------------
+ */
+int
+main(int argc, char **argv)
+{
+    struct timespec  t0;
+    sparse_reader_t  rd;
+    sparse_plan_t    plan;
+    sparse_buffers_t direct, three;
+    hid_t            file, dset;
+    hsize_t          start[RANK], count[RANK];
+    double           query, fill, times[4];
+    uint64_t         nnz;
+    int              f, r;
+
+    parse_command_line(argc, argv);
+
+    if (sparse_open(hand.in_file, hand.dset_name, hand.threads, &rd) < 0) {
+        printf("Failed to open the 2-dim dataset of doubles %s of %s\n", hand.dset_name, hand.in_file);
+        return 1;
+    }
+    start[0] = (hsize_t)hand.offset1;
+    start[1] = (hsize_t)hand.offset2;
+    count[0] = hand.size1 ? (hsize_t)hand.size1 : rd.dims[0] > start[0] ? rd.dims[0] - start[0] : 0;
+    count[1] = hand.size2 ? (hsize_t)hand.size2 : rd.dims[1] > start[1] ? rd.dims[1] - start[1] : 0;
+    if (start[0] + count[0] > rd.dims[0] || start[1] + count[1] > rd.dims[1]) {
+        printf("The region is outside of the %llux%llu dataset\n", (unsigned long long)rd.dims[0],
+               (unsigned long long)rd.dims[1]);
+        sparse_close(&rd);
+        return 1;
+    }
+
+    file = H5Fopen(hand.in_file, H5F_ACC_RDONLY, H5P_DEFAULT);
+    dset = H5Dopen2(file, hand.dset_name, H5P_DEFAULT);
+
+    if (hand.v)
+        printf("Reading the %llux%llu region at %llux%llu of %zu chunks with %d threads\n",
+               (unsigned long long)count[0], (unsigned long long)count[1], (unsigned long long)start[0],
+               (unsigned long long)start[1], rd.nchunks, hand.threads);
+
+    for (f = 0; f < NUM_FORMATS; f++) {
+        res[f].verified = -1;
+        if (hand.format != FORMAT_ALL && hand.format != f)
+            continue;
+
+        for (r = 0; r < hand.repeat; r++) {
+            int last = r == hand.repeat - 1;
+
+            /* Direct read: size query, allocation and fill */
+            memset(&direct, 0, sizeof(direct));
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            if (sparse_query(&rd, f, start, count, &plan) < 0) {
+                printf("Failed the size query of %s\n", format_names[f]);
+                goto error;
+            }
+            query = elapsed(&t0);
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            if (alloc_buffers(&plan, &direct) < 0 || sparse_read(&plan, &direct) < 0) {
+                printf("Failed the direct read of %s\n", format_names[f]);
+                goto error;
+            }
+            fill = elapsed(&t0);
+            if (r == 0 || query + fill < res[f].direct) {
+                res[f].query  = query;
+                res[f].fill   = fill;
+                res[f].direct = query + fill;
+            }
+            res[f].nnz     = plan.nnz;
+            res[f].nchunks = (long long int)plan.ntasks;
+
+            /* Three-step path */
+            memset(&three, 0, sizeof(three));
+            if (three_step_read(file, dset, &rd, f, start, count, &three, &nnz, times) < 0) {
+                printf("Failed the three-step read of %s\n", format_names[f]);
+                goto error;
+            }
+            if (r == 0 || times[0] + times[1] + times[2] + times[3] < res[f].three_step) {
+                res[f].defined    = times[0];
+                res[f].npoints    = times[1];
+                res[f].read       = times[2];
+                res[f].convert    = times[3];
+                res[f].three_step = times[0] + times[1] + times[2] + times[3];
+            }
+
+            if (last && hand.k)
+                res[f].verified = nnz == plan.nnz && same_buffers(f, plan.nnz, plan.nptr, &direct, &three);
+
+            if (hand.v)
+                printf("%s read %d: %llu entries, %lli bytes read directly\n", format_names[f], r,
+                       (unsigned long long)plan.nnz, plan.read_bytes);
+            sparse_free_plan(&plan);
+            free_buffers(&direct);
+            free_buffers(&three);
+        }
+    }
+
+    print_results();
+
+    H5Dclose(dset);
+    H5Fclose(file);
+    sparse_close(&rd);
+
+    if (hand.v) printf("Done! \n");
+
+    return 0;
+
+error:
+    H5Dclose(dset);
+    H5Fclose(file);
+    sparse_close(&rd);
+    return 1;
+}
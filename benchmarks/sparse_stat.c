@@ -0,0 +1,709 @@
+/*
+ * This program reports storage statistics of structured chunk datasets in the spirit of h5stat, with the
+ * structured chunk information proposed in RFC-HDF5-Tools.  Structured chunks are emulated as described
+ * in structured_chunk.h.
+ *
+ * The datasets of the input file (or only the dataset specified with the option -n) are visited and
+ * counted by layout, with structured chunk datasets counted as STRUCTURED CHUNK SPARSE or VL.  For each
+ * structured chunk dataset the program gets the chunk index with sc_get_chunk_locations() and then makes
+ * one parallel pass over the chunks with P threads (option -p).  The library is not used by the threads:
+ * each thread reads the prefix and the Encoded Selection of its chunks with pread, verifies the checksum
+ * of the selection and decodes it.  The statistics of the threads are merged at the end:
+ *
+ *  - the stored and the original bytes of each section type (Encoded Selection, fixed-size data, VL
+ *    heap; the fixed-size data of a VL chunk are the locations of its elements), the filter ratio and the number of chunks in which the section is filtered; the bytes of
+ *    the prefixes and of the slack capacity of the chunks are accounted separately, so all bytes of
+ *    the chunks are attributed;
+ *  - the histogram of the chunk densities (defined elements / elements of the chunk);
+ *  - the mix of selection encodings (none, all, hyperslab and point selections, other) with the number
+ *    of chunks, the bytes and the mean length of the runs of defined elements of each.
+ *
+ * The time of the index lookup (TI) and of the parallel pass (TP) is reported for each dataset; the pages
+ * of the file are dropped from the page cache before the pass unless the option -c 0 is used.
+ *
+ * To compile the program, please use h5cc.  The -h option lists all the command line options:
+ *
+ *   [-h] [-i --inFile] [-n --nameDset] [-p --pThreads] [-c --cCold] [-v --Verbose]
+ *
+ * Example: The commands
+ *
+ *           h5cc alloc.c -o alloc
+ *           h5cc -pthread sparse_stat.c -o sparse_stat
+ *           ./alloc -c 64x64 -g 64x64 -n 1
+ *           ./sparse_stat -i alloc_file.h5 -p 4
+ *
+ * print the statistics of the 4096 chunks of the dataset "sparse" gathered by 4 threads.
+ */
+
+#include "hdf5.h"
+#include "structured_chunk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <getopt.h>
+#include <pthread.h>
+
+#define FILE_NAME                       "alloc_file.h5"
+#define MAX_THREADS                     256
+#define BATCH_CHUNKS                    64          /* Chunks taken by a thread at a time */
+#define NUM_BUCKETS                     9
+#define NUM_FORMATS                     5
+
+/* Formats of the Encoded Selections */
+#define FORMAT_NONE                     0
+#define FORMAT_ALL                      1
+#define FORMAT_HYPERSLAB                2
+#define FORMAT_POINTS                   3
+#define FORMAT_OTHER                    4
+
+/* Dataset layouts counted as h5stat does, with the structured chunk layouts */
+#define LAYOUT_COMPACT                  0
+#define LAYOUT_CONTIG                   1
+#define LAYOUT_CHUNKED                  2
+#define LAYOUT_SPARSE                   3
+#define LAYOUT_VL                       4
+#define LAYOUT_VIRTUAL                  5
+#define NUM_LAYOUTS                     6
+
+typedef struct {
+    char           *in_file;
+    char           *dset_name;       /* NULL for all datasets */
+    int             threads;
+    int             c;               /* flag to drop the file from the page cache */
+    int             v;               /* prints progress messages */
+} handler_t;
+
+/* Statistics gathered by one thread and merged at the end of the pass */
+typedef struct {
+    long long int   nchunks;
+    long long int   ninvalid;        /* chunks without a valid prefix or selection */
+    long long int   nsparse;         /* chunks with SC_SPARSE_CHUNK */
+    long long int   nvl;             /* chunks with SC_VL_CHUNK */
+    long long int   stored[SC_MAX_SECTIONS];
+    long long int   orig[SC_MAX_SECTIONS];
+    long long int   nsection[SC_MAX_SECTIONS];
+    long long int   nfiltered[SC_MAX_SECTIONS];
+    long long int   prefix;
+    long long int   slack;
+    long long int   nelemts;
+    long long int   density[NUM_BUCKETS];
+    long long int   format_chunks[NUM_FORMATS];
+    long long int   format_bytes[NUM_FORMATS];
+    long long int   format_nelemts[NUM_FORMATS];
+    long long int   format_nruns[NUM_FORMATS];
+    long long int   read_bytes;
+} stats_t;
+
+/* Work shared by the threads of the pass */
+typedef struct {
+    int             fd;
+    size_t          nchunks;
+    sc_chunk_loc_t *locs;
+    uint64_t        chunk_nelmts;
+    size_t          next;            /* next chunk to take; taken atomically */
+    stats_t         stats[MAX_THREADS];
+} pass_t;
+
+handler_t    hand;
+long long int layout_counts[NUM_LAYOUTS];
+
+/* Upper bounds of the density buckets in percent */
+const double bucket_max[NUM_BUCKETS]  = {0.1, 1, 2, 5, 10, 25, 50, 75, 100};
+const char  *format_name[NUM_FORMATS] = {"none", "all", "hyperslab", "points", "other"};
+const char  *section_name[SC_MAX_SECTIONS] = {"selection", "fixed", "vl"};
+
+/*------------------------------------------------------------
+ * Display command line usage
+ *------------------------------------------------------------
+ */
+void
+usage(void)
+{
+    printf("    [-h] [-i --inFile] [-n --nameDset] [-p --pThreads] [-c --cCold] [-v --Verbose]\n");
+    printf("    [-h --help]: this help page\n");
+    printf("    [-i --inFile]: the file with the structured chunk datasets (default %s)\n", FILE_NAME);
+    printf("    [-n --nameDset]: the name of one dataset (default all datasets of the file)\n");
+    printf("    [-p --pThreads]: the number of threads of the pass over the chunks (default the number of CPUs)\n");
+    printf("    [-c --cCold]: Drop the file from the page cache before each pass (1, default) or not (0)\n");
+    printf("    [-v --Verbose]: Print progress messages(1); default no messages displayed (0) \n");
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Parse command line option
+ *------------------------------------------------------------
+ */
+void
+parse_command_line(int argc, char *argv[])
+{
+    int           opt;
+    struct option long_options[] = {
+                                    {"help", no_argument, NULL, 'h'},
+                                    {"inFile=", required_argument, NULL, 'i'},
+                                    {"nameDset=", required_argument, NULL, 'n'},
+                                    {"pThreads=", required_argument, NULL, 'p'},
+                                    {"cCold=", required_argument, NULL, 'c'},
+                                    {"Verbose=", required_argument, NULL, 'v'},
+                                    {NULL, 0, NULL, 0}};
+
+    /* Initialize the command line options */
+    hand.in_file   = FILE_NAME;
+    hand.dset_name = NULL;
+    hand.threads   = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    hand.c         = 1;
+    hand.v         = 0;
+
+    while ((opt = getopt_long(argc, argv, "hi:n:p:c:v:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'h':
+                fprintf(stdout, "Help page:\n");
+                usage();
+
+                exit(0);
+
+                break;
+            case 'i':
+                if (optarg) {
+                    fprintf(stdout, "Input file:\t\t\t\t\t\t%s\n", optarg);
+                    hand.in_file = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'n':
+                if (optarg) {
+                    fprintf(stdout, "Dataset:\t\t\t\t\t\t%s\n", optarg);
+                    hand.dset_name = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'p':
+                if (optarg) {
+                    fprintf(stdout, "Number of threads:\t\t\t\t\t%s\n", optarg);
+                    hand.threads = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'c':
+                if (optarg) {
+                    hand.c = atoi(optarg);
+                    if (hand.c == 1)
+                        fprintf(stdout, "Cold page cache: \t\t\t\t\ton\n");
+                    else if (hand.c == 0)
+                        fprintf(stdout, "Cold page cache: \t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Cold page cache:\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'v':
+                if (optarg) {
+                    hand.v = atoi(optarg);
+                    if (hand.v == 1)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\ton\n");
+                    else if (hand.v == 0)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Verbose mode:\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case ':':
+                printf("Option needs a value\n");
+                break;
+            case '?':
+                printf("Unknown option: %c\n", optopt);
+                break;
+        }
+    }
+
+    /* optind is for the extra arguments which are not parsed */
+    for (; optind < argc; optind++) {
+        printf("extra arguments not parsed: %s\n", argv[optind]);
+    }
+
+    /* Make sure the command line options are valid */
+    if (hand.threads < 1 || hand.threads > MAX_THREADS) {
+        printf("The number of threads must be between 1 and %d\n", MAX_THREADS);
+        exit(1);
+    }
+
+    if (hand.c < 0 || hand.c > 1) {
+        printf("Cold cache flag can only be 0 or 1 \n");
+        exit(1);
+    }
+
+    if (hand.v < 0 || hand.v > 1) {
+        printf("Verbose flag can only be 0 or 1 \n");
+        exit(1);
+    }
+}
+
+/*------------------------------------------------------------
+ * Print the statistics of one structured chunk dataset
+ *------------------------------------------------------------
+ */
+void print_results(const char *name, long long int grid_chunks, const stats_t *st, double index_time,
+                   double pass_time)
+{
+    long long int total = st->prefix + st->slack;
+    double        lower = 0;
+    int           i;
+
+    for (i = 0; i < SC_MAX_SECTIONS; i++)
+        total += st->stored[i];
+
+    printf("\n");
+    printf("Structured chunk dataset \"%s\":\n", name);
+    printf("Number of chunks stored:\t\t\t\t%lli of %lli\n", st->nchunks, grid_chunks);
+    printf("Number of sparse / VL / invalid chunks:\t\t\t%lli / %lli / %lli\n", st->nsparse, st->nvl,
+           st->ninvalid);
+    printf("Number of defined elements:\t\t\t\t%lli\n", st->nelemts);
+    printf("Bytes of the stored chunks:\t\t\t\t%lli\n", total);
+    printf("Time of the index lookup (TI) in seconds:\t\t%.4f\n", index_time);
+    printf("Time of the parallel pass (TP) in seconds:\t\t%.4f\n", pass_time);
+    printf("\n");
+    printf("Printing the section, number of chunks with it (NC), stored bytes (SB), original bytes (OB),\n");
+    printf("filter ratio (FR = OB/SB), chunks in which it is filtered (NF) and share of the stored bytes (%%)\n");
+    printf("\n");
+    printf("   section         NC         SB         OB         FR         NF          %%\n");
+    printf("\n");
+    for (i = 0; i < SC_MAX_SECTIONS; i++)
+        printf("%10s %10lli %10lli %10lli %10.2f %10lli %10.2f \n", section_name[i], st->nsection[i], st->stored[i],
+               st->orig[i], st->stored[i] ? (double)st->orig[i] / st->stored[i] : 0.0, st->nfiltered[i],
+               total ? 100.0 * st->stored[i] / total : 0.0);
+    printf("%10s %10lli %10lli %10lli %10s %10s %10.2f \n", "prefix", st->nchunks, st->prefix, st->prefix, "-", "-",
+           total ? 100.0 * st->prefix / total : 0.0);
+    printf("%10s %10lli %10lli %10s %10s %10s %10.2f \n", "slack", st->nchunks, st->slack, "-", "-", "-",
+           total ? 100.0 * st->slack / total : 0.0);
+    printf("\n");
+    printf("Printing the density of the chunks in percent of their elements and the number of chunks (NC)\n");
+    printf("\n");
+    printf("   density         NC\n");
+    printf("\n");
+    for (i = 0; i < NUM_BUCKETS; i++) {
+        char range[32];
+
+        snprintf(range, sizeof(range), "%g-%g", lower, bucket_max[i]);
+        printf("%10s %10lli \n", range, st->density[i]);
+        lower = bucket_max[i];
+    }
+    printf("\n");
+    printf("Printing the selection encoding, number of chunks (NC), bytes of the Encoded Selections (SB)\n");
+    printf("and mean number of elements per run of defined elements (RL)\n");
+    printf("\n");
+    printf("  encoding         NC         SB         RL\n");
+    printf("\n");
+    for (i = 0; i < NUM_FORMATS; i++)
+        printf("%10s %10lli %10lli %10.2f \n", format_name[i], st->format_chunks[i], st->format_bytes[i],
+               st->format_nruns[i] ? (double)st->format_nelemts[i] / st->format_nruns[i] : 0.0);
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Print the dataset layout counts
+ *------------------------------------------------------------
+ */
+void print_layouts(void)
+{
+    printf("\n");
+    printf("Dataset layout information:\n");
+    printf("\tDataset layout counts[COMPACT]: %lli\n", layout_counts[LAYOUT_COMPACT]);
+    printf("\tDataset layout counts[CONTIG]: %lli\n", layout_counts[LAYOUT_CONTIG]);
+    printf("\tDataset layout counts[CHUNKED]: %lli\n", layout_counts[LAYOUT_CHUNKED]);
+    printf("\tDataset layout counts[STRUCTURED CHUNK SPARSE]: %lli\n", layout_counts[LAYOUT_SPARSE]);
+    printf("\tDataset layout counts[STRUCTURED CHUNK VL]: %lli\n", layout_counts[LAYOUT_VL]);
+    printf("\tDataset layout counts[VIRTUAL]: %lli\n", layout_counts[LAYOUT_VIRTUAL]);
+}
+
+/*------------------------------------------------------------
+ * Elapsed time
+ *------------------------------------------------------------
+ */
+double elapsed(struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*------------------------------------------------------------
+ * Drop the pages of a file from the page cache
+ *------------------------------------------------------------
+ */
+void drop_cache(const char *file_name)
+{
+    int fd;
+
+    if ((fd = open(file_name, O_RDONLY)) < 0)
+        return;
+    fsync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+/*------------------------------------------------------------
+ * Read "size" bytes at "addr" of the file
+ *------------------------------------------------------------
+ */
+int read_full(int fd, void *buf, size_t size, haddr_t addr)
+{
+    size_t done = 0;
+
+    while (done < size) {
+        ssize_t n = pread(fd, (uint8_t *)buf + done, size - done, (off_t)(addr + done));
+
+        if (n <= 0)
+            return -1;
+        done += (size_t)n;
+    }
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Gather the statistics of one chunk
+ *------------------------------------------------------------
+ */
+void stat_chunk(pass_t *pass, const sc_chunk_loc_t *loc, uint8_t **buf, size_t *buf_max, uint8_t **sel,
+                size_t *sel_max, stats_t *st)
+{
+    sc_chunk_info_t info;
+    hsize_t         sel_dims[H5S_MAX_RANK];
+    uint32_t        sel_type, version;
+    size_t          used, need, nruns;
+    double          density;
+    int             rank, format, b;
+    unsigned        i;
+
+    st->nchunks++;
+
+    /* The prefix and the first bytes of the Encoded Selection are read at once */
+    need = (size_t)loc->size < SC_PREFIX_SIZE + SC_SELECTION_READAHEAD ? (size_t)loc->size
+                                                                        : SC_PREFIX_SIZE + SC_SELECTION_READAHEAD;
+    if (need < SC_PREFIX_SIZE || read_full(pass->fd, *buf, need, loc->addr) < 0 ||
+        sc_decode_prefix(*buf, &info) < 0 || (used = sc_image_size(&info)) > (size_t)loc->size) {
+        st->ninvalid++;
+        return;
+    }
+    st->read_bytes += (long long int)need;
+
+    st->prefix += SC_PREFIX_SIZE;
+    st->slack += (long long int)(loc->size - used);
+    /* A VL chunk without a selection starts with the section of the locations (fixed-size data) */
+    for (i = 0; i < info.num_sections; i++) {
+        unsigned t = (info.type & SC_SPARSE_CHUNK) ? i : i + 1;
+
+        if (t >= SC_MAX_SECTIONS)
+            break;
+        st->nsection[t]++;
+        st->stored[t] += (long long int)info.section_size[i];
+        st->orig[t] += (long long int)info.section_orig_size[i];
+        if ((info.pipeline[i] & SC_PIPELINE_DEFLATE) && !(info.filter_mask[i] & 0x1))
+            st->nfiltered[t]++;
+    }
+    if (info.type & SC_VL_CHUNK)
+        st->nvl++;
+    if (!(info.type & SC_SPARSE_CHUNK))
+        return;
+    st->nsparse++;
+
+    st->nelemts += (long long int)info.nelemts;
+    density = 100.0 * (double)info.nelemts / (double)pass->chunk_nelmts;
+    for (b = 0; b < NUM_BUCKETS - 1 && density > bucket_max[b]; b++)
+        ;
+    st->density[b]++;
+
+    /* The rest of a large Encoded Selection */
+    need = SC_PREFIX_SIZE + (size_t)info.section_size[SC_SECTION_SELECTION];
+    if (need > *buf_max) {
+        uint8_t *tmp = (uint8_t *)realloc(*buf, need);
+
+        if (!tmp) {
+            st->ninvalid++;
+            return;
+        }
+        *buf     = tmp;
+        *buf_max = need;
+    }
+    if (need > SC_PREFIX_SIZE + SC_SELECTION_READAHEAD) {
+        if (read_full(pass->fd, *buf + SC_PREFIX_SIZE + SC_SELECTION_READAHEAD,
+                      need - SC_PREFIX_SIZE - SC_SELECTION_READAHEAD,
+                      loc->addr + SC_PREFIX_SIZE + SC_SELECTION_READAHEAD) < 0) {
+            st->ninvalid++;
+            return;
+        }
+        st->read_bytes += (long long int)(need - SC_PREFIX_SIZE - SC_SELECTION_READAHEAD);
+    }
+
+    if (info.section_orig_size[SC_SECTION_SELECTION] > *sel_max) {
+        uint8_t *tmp = (uint8_t *)realloc(*sel, (size_t)info.section_orig_size[SC_SECTION_SELECTION]);
+
+        if (!tmp) {
+            st->ninvalid++;
+            return;
+        }
+        *sel     = tmp;
+        *sel_max = (size_t)info.section_orig_size[SC_SECTION_SELECTION];
+    }
+    if (sc_decode_section(&info, SC_SECTION_SELECTION, *buf + SC_PREFIX_SIZE, *sel) < 0 ||
+        sc_selection_format(*sel, (size_t)info.section_orig_size[SC_SECTION_SELECTION], &sel_type, &version) < 0) {
+        st->ninvalid++;
+        return;
+    }
+
+    if (sel_type == (uint32_t)H5S_SEL_NONE)
+        format = FORMAT_NONE;
+    else if (sel_type == (uint32_t)H5S_SEL_ALL)
+        format = FORMAT_ALL;
+    else if (sel_type == (uint32_t)H5S_SEL_HYPERSLABS && version == 1)
+        format = FORMAT_HYPERSLAB;
+    else if (sel_type == (uint32_t)H5S_SEL_POINTS && version == 1)
+        format = FORMAT_POINTS;
+    else
+        format = FORMAT_OTHER;
+
+    st->format_chunks[format]++;
+    st->format_bytes[format] += (long long int)info.section_size[SC_SECTION_SELECTION];
+    if (format != FORMAT_OTHER &&
+        sc_decode_runs(*sel, (size_t)info.section_orig_size[SC_SECTION_SELECTION], &rank, sel_dims, &nruns, NULL) == 0) {
+        st->format_nruns[format] += (long long int)nruns;
+        st->format_nelemts[format] += (long long int)info.nelemts;
+    }
+}
+
+/*------------------------------------------------------------
+ * Thread of the pass: takes batches of chunks until all chunks
+ * have been taken
+ *------------------------------------------------------------
+ */
+void *stat_thread(void *arg)
+{
+    pass_t  *pass = ((void **)arg)[0];
+    stats_t *st   = ((void **)arg)[1];
+    uint8_t *buf, *sel = NULL;
+    size_t   buf_max = SC_PREFIX_SIZE + SC_SELECTION_READAHEAD, sel_max = 0;
+    size_t   first, c;
+
+    buf = (uint8_t *)malloc(buf_max);
+
+    while ((first = __sync_fetch_and_add(&pass->next, BATCH_CHUNKS)) < pass->nchunks)
+        for (c = first; c < first + BATCH_CHUNKS && c < pass->nchunks; c++)
+            stat_chunk(pass, &pass->locs[c], &buf, &buf_max, &sel, &sel_max, st);
+
+    free(buf);
+    free(sel);
+
+    return NULL;
+}
+
+/*------------------------------------------------------------
+ * Gather and print the statistics of a structured chunk
+ * dataset
+ *------------------------------------------------------------
+ */
+int stat_dataset(hid_t dset, const char *name)
+{
+    struct timespec start;
+    pthread_t       threads[MAX_THREADS];
+    void           *args[MAX_THREADS][2];
+    pass_t         *pass;
+    stats_t         total;
+    hid_t           space, dcpl;
+    hsize_t         dims[SC_MAX_RANK], chunk_dims[SC_MAX_RANK];
+    long long int   grid_chunks = 1;
+    double          index_time, pass_time;
+    long long int  *sum, *part;
+    size_t          f, nfields = sizeof(stats_t) / sizeof(long long int);
+    int             rank, i;
+
+    pass = (pass_t *)calloc(1, sizeof(pass_t));
+
+    space = H5Dget_space(dset);
+    rank  = H5Sget_simple_extent_dims(space, dims, NULL);
+    H5Sclose(space);
+    dcpl = H5Dget_create_plist(dset);
+    H5Pget_chunk(dcpl, rank, chunk_dims);
+    H5Pclose(dcpl);
+    pass->chunk_nelmts = 1;
+    for (i = 0; i < rank; i++) {
+        pass->chunk_nelmts *= chunk_dims[i];
+        grid_chunks *= (long long int)((dims[i] + chunk_dims[i] - 1) / chunk_dims[i]);
+    }
+
+    if (hand.v) printf("Getting the chunk index of %s\n", name);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (sc_get_chunk_locations(dset, &pass->nchunks, &pass->locs) < 0) {
+        printf("Failed to get the chunks of %s\n", name);
+        free(pass);
+        return -1;
+    }
+    index_time = elapsed(&start);
+
+    if (hand.c)
+        drop_cache(hand.in_file);
+    if ((pass->fd = open(hand.in_file, O_RDONLY)) < 0) {
+        printf("Failed to open %s\n", hand.in_file);
+        free(pass->locs);
+        free(pass);
+        return -1;
+    }
+
+    if (hand.v) printf("Reading the chunks of %s with %d threads\n", name, hand.threads);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < hand.threads; i++) {
+        args[i][0] = pass;
+        args[i][1] = &pass->stats[i];
+        pthread_create(&threads[i], NULL, stat_thread, args[i]);
+    }
+    for (i = 0; i < hand.threads; i++)
+        pthread_join(threads[i], NULL);
+    pass_time = elapsed(&start);
+    close(pass->fd);
+
+    /* All fields of the statistics are counters that add up */
+    memset(&total, 0, sizeof(total));
+    sum = (long long int *)&total;
+    for (i = 0; i < hand.threads; i++) {
+        part = (long long int *)&pass->stats[i];
+        for (f = 0; f < nfields; f++)
+            sum[f] += part[f];
+    }
+
+    if (total.nvl > 0)
+        layout_counts[LAYOUT_VL]++;
+    else
+        layout_counts[LAYOUT_SPARSE]++;
+
+    print_results(name, grid_chunks, &total, index_time, pass_time);
+
+    free(pass->locs);
+    free(pass);
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Check if a dataset uses the structured chunk emulation
+ *------------------------------------------------------------
+ */
+int is_structured(hid_t dcpl)
+{
+    int n, i;
+
+    if (H5Pget_layout(dcpl) != H5D_CHUNKED)
+        return 0;
+    n = H5Pget_nfilters(dcpl);
+    for (i = 0; i < n; i++) {
+        unsigned flags, filter_config;
+        size_t   cd_nelmts = 0;
+
+        if (H5Pget_filter2(dcpl, (unsigned)i, &flags, &cd_nelmts, NULL, 0, NULL, &filter_config) == SC_FILTER_ID)
+            return 1;
+    }
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Count the layout of a dataset and gather the statistics of
+ * a structured chunk dataset
+ *------------------------------------------------------------
+ */
+int visit_dataset(hid_t dset, const char *name)
+{
+    hid_t dcpl = H5Dget_create_plist(dset);
+    int   ret  = 0;
+
+    if (is_structured(dcpl))
+        ret = stat_dataset(dset, name);
+    else
+        switch (H5Pget_layout(dcpl)) {
+            case H5D_COMPACT:
+                layout_counts[LAYOUT_COMPACT]++;
+                break;
+            case H5D_CONTIGUOUS:
+                layout_counts[LAYOUT_CONTIG]++;
+                break;
+            case H5D_CHUNKED:
+                layout_counts[LAYOUT_CHUNKED]++;
+                break;
+            case H5D_VIRTUAL:
+                layout_counts[LAYOUT_VIRTUAL]++;
+                break;
+            default:
+                break;
+        }
+    H5Pclose(dcpl);
+
+    return ret;
+}
+
+/*------------------------------------------------------------
+ * Visit the datasets of a group recursively (callback for
+ * H5Literate2)
+ *------------------------------------------------------------
+ */
+herr_t visit_link(hid_t group, const char *name, const H5L_info2_t *info, void *op_data)
+{
+    const char *parent = (const char *)op_data;
+    char        path[1024];
+    hid_t       obj;
+    herr_t      ret = 0;
+
+    if (info->type != H5L_TYPE_HARD)
+        return 0;
+
+    snprintf(path, sizeof(path), "%s/%s", parent, name);
+    if ((obj = H5Oopen(group, name, H5P_DEFAULT)) < 0)
+        return 0;
+
+    if (H5Iget_type(obj) == H5I_GROUP)
+        ret = H5Literate2(obj, H5_INDEX_NAME, H5_ITER_INC, NULL, visit_link, path);
+    else if (H5Iget_type(obj) == H5I_DATASET && visit_dataset(obj, path) < 0)
+        ret = -1;
+    H5Oclose(obj);
+
+    return ret;
+}
+
+/*------------------------------------------------------------
+ * Main function
+ *------------------------------------------------------------
+ */
+int
+main(int argc, char **argv)
+{
+    hid_t file, dset;
+    int   ret = 0;
+
+    parse_command_line(argc, argv);
+
+    if ((file = H5Fopen(hand.in_file, H5F_ACC_RDONLY, H5P_DEFAULT)) < 0) {
+        printf("Failed to open %s\n", hand.in_file);
+        return 1;
+    }
+
+    printf("Filename: %s\n", hand.in_file);
+    if (hand.dset_name) {
+        if ((dset = H5Dopen2(file, hand.dset_name, H5P_DEFAULT)) < 0) {
+            printf("Failed to open the dataset %s\n", hand.dset_name);
+            return 1;
+        }
+        ret = visit_dataset(dset, hand.dset_name);
+        H5Dclose(dset);
+    }
+    else
+        ret = H5Literate2(file, H5_INDEX_NAME, H5_ITER_INC, NULL, visit_link, "");
+
+    print_layouts();
+    H5Fclose(file);
+
+    if (hand.v) printf("Done! \n");
+
+    return ret < 0 ? 1 : 0;
+}
@@ -0,0 +1,1129 @@
+/*
+ * This program writes a 2-dim sparse matrix of doubles held by the application in the COO or the CSR format
+ * into a dataset stored with sparse structured chunks (see structured_chunk.h), and compares it with the way
+ * sparse.c writes the defined elements today: a hyperslab selection of the dataspace built point by point
+ * with H5Sselect_hyperslab(H5S_SELECT_OR) as create_hyperslab() does, and an H5Dwrite of the values from a
+ * 1-dim memory dataspace into this selection of a chunked dataset as create_hdf5_dsets() does.
+ *
+ * The direct write is a small API:
+ *
+ *   sparse_writer_open()  - creates the dataset with the dimensions and the chunk dimensions;
+ *   sparse_write_coo()    - writes "nnz" entries given by their row, their column and their value;
+ *   sparse_write_csr()    - writes the entries of the rows given by the row pointers, the column of each
+ *                           entry and its value;
+ *   sparse_writer_close() - closes the dataset.
+ *
+ * No dataspace selection is built.  The write runs in four steps on P threads (option -p):
+ *
+ *  1 - count: the entries are divided into P equal ranges and each thread counts the entries of its range
+ *      for each chunk; with CSR a thread finds the row of its first entry in the row pointers;
+ *  2 - bucket: the counts give each thread the positions of its entries in the array of the chunk, where
+ *      it copies the position of each entry in the chunk and its value;
+ *  3 - assemble: the threads take the chunks one at a time and assemble them with sc_assemble_sparse_chunk.
+ *      The entries of a chunk that are sorted and distinct, e.g. the entries of CSR with sorted columns,
+ *      give the runs of defined elements with sc_offsets_to_runs and are packed as they are; other chunks
+ *      are sorted, or scattered into a dense chunk with a mask when they have more than
+ *      1/SC_APPEND_SORT_RATIO of the elements of the chunk.  Duplicate entries are summed.  The Encoded
+ *      Selection is built from the runs with sc_encode_runs and the chunk is assembled with the packed
+ *      values as the Data section;
+ *  4 - write: the main thread writes the chunks with H5Dwrite_chunk in the logical order.
+ *
+ * The program generates a matrix with the density given by the option -e (in percent): the points of each
+ * row are placed at random in consecutive windows of 100/e elements, as the selection of type 1 of
+ * sparse.c.  The CSR entries are in the order of the rows with sorted columns; the COO entries are the
+ * same entries in a random order.  The hyperslab path writes the entries in the order of the rows.
+ *
+ * The program reports for each path the number of entries (NE) and of chunks written (NC), the time of
+ * the count and bucket steps or of the construction of the hyperslab selection (T1), of the assembly
+ * of the chunks (T2), of the writes (T3) and in total (T) in seconds, the millions of entries per second
+ * (MEPS) and the speedup over the hyperslab path (X).  Each write is repeated R times (option -r) into a
+ * new file and the best time is reported.  The hyperslab path is slow for large numbers of entries and
+ * can be skipped with the option -b 0.  With the option -k 1 the written datasets are read back and the
+ * number of entries and an order-independent checksum of their positions and values are compared with
+ * the matrix.
+ *
+ * To compile the program, please use h5cc.  The -h option lists all the command line options:
+ *
+ *   [-h] [-o --outFile] [-f --format] [-s --dimsMatrix] [-c --dimsChunk] [-e --ePercent] [-p --pThreads]
+ *   [-z --zDeflate] [-b --bHyperslab] [-r --rRepeat] [-k --kVerify] [-v --Verbose]
+ *
+ * Example: The commands
+ *
+ *           h5cc -O2 -pthread sparse_write.c -o sparse_write
+ *           ./sparse_write -s 4096x4096 -c 256x256 -e 1 -k 1
+ *           ./sparse_write -s 100000x100000 -e 0.1 -b 0
+ *
+ * compare both paths for 167,936 entries, and write 10^7 entries from COO and CSR buffers directly.
+ */
+
+#include "hdf5.h"
+#include "structured_chunk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <getopt.h>
+#include <pthread.h>
+
+#define OUT_FILE_NAME                   "write_file.h5"
+#define COO_DSET_NAME                   "sparse_coo"
+#define CSR_DSET_NAME                   "sparse_csr"
+#define DENSE_DSET_NAME                 "dense"
+#define MATRIX_DIM1                     4096
+#define MATRIX_DIM2                     4096
+#define CHUNK_DIM1                      256
+#define CHUNK_DIM2                      256
+#define PERCENT                         1
+#define MAX_THREADS                     256
+#define REPEAT                          3
+#define RANK                            2
+
+/* Formats of the user buffers */
+#define FORMAT_COO                      0
+#define FORMAT_CSR                      1
+#define FORMAT_ALL                      2
+#define NUM_FORMATS                     2
+
+/* Paths compared */
+#define PATH_COO                        0
+#define PATH_CSR                        1
+#define PATH_HYPERSLAB                  2
+#define NUM_PATHS                       3
+
+typedef struct {
+    char           *out_file;
+    int             format;
+    long long int   matrix_dim1;
+    long long int   matrix_dim2;
+    long long int   chunk_dim1;
+    long long int   chunk_dim2;
+    double          percent;
+    int             threads;
+    int             z;               /* deflate of the data sections */
+    int             b;               /* runs the hyperslab path */
+    int             repeat;
+    int             k;               /* verify the datasets */
+    int             v;               /* prints progress messages */
+} handler_t;
+
+/* Dataset written from COO or CSR buffers */
+typedef struct {
+    hid_t           dset;
+    int             threads;
+    unsigned        pipeline;        /* filters of the Data sections */
+    hsize_t         dims[RANK];
+    hsize_t         chunk_dims[RANK];
+    uint64_t        grid[RANK];
+    uint64_t        nchunks;         /* chunks of the grid */
+    uint64_t        chunk_nelmts;
+} sparse_writer_t;
+
+/* Write of the entries shared by the threads */
+typedef struct {
+    sparse_writer_t *wr;
+    int             format;
+    uint64_t        nnz;
+    const uint64_t *rows;            /* COO: row of each entry; CSR: the row pointers */
+    const uint64_t *cols;
+    const double   *values;
+    uint64_t        range_start[MAX_THREADS + 1]; /* first entry of the range of each thread, and the end */
+    uint64_t       *counts[MAX_THREADS];          /* entries of each chunk, then their positions, per thread */
+    sc_sparse_entry_t *records;      /* entries bucketed by chunk */
+    uint64_t       *chunk_start;     /* first record of each chunk, and the end */
+    uint8_t       **images;
+    size_t         *image_sizes;
+    size_t          next;            /* next chunk to take; taken atomically */
+    int             thread;          /* next thread index; taken atomically */
+    long long int   nduplicates;
+    long long int   nchunks;         /* chunks written */
+    int             failed;
+    pthread_mutex_t lock;            /* protects the statistics merged by the threads */
+} write_job_t;
+
+/* Generated matrix */
+typedef struct {
+    uint64_t        nnz;
+    uint64_t       *row_ptr;         /* CSR */
+    uint64_t       *csr_cols;
+    double         *csr_values;
+    uint64_t       *coo_rows;        /* COO: the entries in a random order */
+    uint64_t       *coo_cols;
+    double         *coo_values;
+    uint64_t        checksum;
+} matrix_t;
+
+typedef struct {
+    long long int   nentries;
+    long long int   nchunks;
+    double          t1;              /* best times */
+    double          t2;
+    double          t3;
+    double          total;
+    int             done;
+    int             verified;        /* -1 not verified, 0 failed, 1 passed */
+} result_t;
+
+handler_t    hand;
+result_t     res[NUM_PATHS];
+const char  *path_names[NUM_PATHS] = {"COO", "CSR", "hyperslab"};
+
+/*------------------------------------------------------------
+ * Display command line usage
+ *------------------------------------------------------------
+ */
+void
+usage(void)
+{
+    printf("    [-h] [-o --outFile] [-f --format] [-s --dimsMatrix] [-c --dimsChunk] [-e --ePercent] [-p --pThreads]\n");
+    printf("    [-z --zDeflate] [-b --bHyperslab] [-r --rRepeat] [-k --kVerify] [-v --Verbose]\n");
+    printf("    [-h --help]: this help page\n");
+    printf("    [-o --outFile]: the output file (default %s)\n", OUT_FILE_NAME);
+    printf("    [-f --format]: 0 - COO, 1 - CSR, 2 - both formats (default)\n");
+    printf("    [-s --dimsMatrix]: the dimensions of the matrix (default %dx%d)\n", MATRIX_DIM1, MATRIX_DIM2);
+    printf("    [-c --dimsChunk]: the chunk dimensions (default %dx%d)\n", CHUNK_DIM1, CHUNK_DIM2);
+    printf("    [-e --ePercent]: the percentage of the defined elements (default %d)\n", PERCENT);
+    printf("    [-p --pThreads]: the number of threads of the direct write (default the number of CPUs)\n");
+    printf("    [-z --zDeflate]: the data is compressed with deflate (1) or not (0, default)\n");
+    printf("    [-b --bHyperslab]: run the hyperslab path (1, default) or not (0)\n");
+    printf("    [-r --rRepeat]: the number of writes of each path (default %d)\n", REPEAT);
+    printf("    [-k --kVerify]: read the datasets back and compare them with the matrix (1) or not (0, default)\n");
+    printf("    [-v --Verbose]: Print progress messages(1); default no messages displayed (0) \n");
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Parse a string of the form AxB; missing dimensions are set
+ * to 0
+ *------------------------------------------------------------
+ */
+void
+parse_dims(const char *str, int ndims, long long int *dims[])
+{
+    char *dims_str, *dim_str;
+    int   i;
+
+    dims_str = strdup(str);
+    dim_str  = strtok(dims_str, "x");
+    for (i = 0; i < ndims; i++) {
+        *dims[i] = dim_str ? atoll(dim_str) : 0;
+        dim_str  = strtok(NULL, "x");
+    }
+    free(dims_str);
+}
+
+/*------------------------------------------------------------
+ * Parse command line option
+ *------------------------------------------------------------
+ */
+void
+parse_command_line(int argc, char *argv[])
+{
+    int            opt;
+    long long int *matrix_dims[2] = {&hand.matrix_dim1, &hand.matrix_dim2};
+    long long int *chunk_dims[2]  = {&hand.chunk_dim1, &hand.chunk_dim2};
+    struct option  long_options[] = {
+                                    {"help", no_argument, NULL, 'h'},
+                                    {"outFile=", required_argument, NULL, 'o'},
+                                    {"format=", required_argument, NULL, 'f'},
+                                    {"dimsMatrix=", required_argument, NULL, 's'},
+                                    {"dimsChunk=", required_argument, NULL, 'c'},
+                                    {"ePercent=", required_argument, NULL, 'e'},
+                                    {"pThreads=", required_argument, NULL, 'p'},
+                                    {"zDeflate=", required_argument, NULL, 'z'},
+                                    {"bHyperslab=", required_argument, NULL, 'b'},
+                                    {"rRepeat=", required_argument, NULL, 'r'},
+                                    {"kVerify=", required_argument, NULL, 'k'},
+                                    {"Verbose=", required_argument, NULL, 'v'},
+                                    {NULL, 0, NULL, 0}};
+
+    /* Initialize the command line options */
+    hand.out_file    = OUT_FILE_NAME;
+    hand.format      = FORMAT_ALL;
+    hand.matrix_dim1 = MATRIX_DIM1;
+    hand.matrix_dim2 = MATRIX_DIM2;
+    hand.chunk_dim1  = CHUNK_DIM1;
+    hand.chunk_dim2  = CHUNK_DIM2;
+    hand.percent     = PERCENT;
+    hand.threads     = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    hand.z           = 0;
+    hand.b           = 1;
+    hand.repeat      = REPEAT;
+    hand.k           = 0;
+    hand.v           = 0;
+
+    while ((opt = getopt_long(argc, argv, "ho:f:s:c:e:p:z:b:r:k:v:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'h':
+                fprintf(stdout, "Help page:\n");
+                usage();
+
+                exit(0);
+
+                break;
+            case 'o':
+                if (optarg) {
+                    fprintf(stdout, "Output file:\t\t\t\t\t\t%s\n", optarg);
+                    hand.out_file = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'f':
+                if (optarg) {
+                    hand.format = atoi(optarg);
+                    if (hand.format == FORMAT_COO)
+                        fprintf(stdout, "Format: \t\t\t\t\t\tCOO\n");
+                    else if (hand.format == FORMAT_CSR)
+                        fprintf(stdout, "Format: \t\t\t\t\t\tCSR\n");
+                    else if (hand.format == FORMAT_ALL)
+                        fprintf(stdout, "Format: \t\t\t\t\t\tCOO and CSR\n");
+                    else
+                        fprintf(stdout, "Format:\t\t\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 's':
+                if (optarg) {
+                    fprintf(stdout, "Matrix dimensions:\t\t\t\t\t%s\n", optarg);
+                    parse_dims(optarg, 2, matrix_dims);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'c':
+                if (optarg) {
+                    fprintf(stdout, "Chunk dimensions:\t\t\t\t\t%s\n", optarg);
+                    parse_dims(optarg, 2, chunk_dims);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'e':
+                if (optarg) {
+                    fprintf(stdout, "Percentage of defined elements:\t\t\t\t%s\n", optarg);
+                    hand.percent = atof(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'p':
+                if (optarg) {
+                    fprintf(stdout, "Number of threads:\t\t\t\t\t%s\n", optarg);
+                    hand.threads = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'z':
+                if (optarg) {
+                    hand.z = atoi(optarg);
+                    if (hand.z == 1)
+                        fprintf(stdout, "Deflate: \t\t\t\t\t\ton\n");
+                    else if (hand.z == 0)
+                        fprintf(stdout, "Deflate: \t\t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Deflate:\t\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'b':
+                if (optarg) {
+                    hand.b = atoi(optarg);
+                    if (hand.b == 1)
+                        fprintf(stdout, "Hyperslab path: \t\t\t\t\ton\n");
+                    else if (hand.b == 0)
+                        fprintf(stdout, "Hyperslab path: \t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Hyperslab path:\t\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'r':
+                if (optarg) {
+                    fprintf(stdout, "Number of writes:\t\t\t\t\t%s\n", optarg);
+                    hand.repeat = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'k':
+                if (optarg) {
+                    hand.k = atoi(optarg);
+                    if (hand.k == 1)
+                        fprintf(stdout, "Verify: \t\t\t\t\t\ton\n");
+                    else if (hand.k == 0)
+                        fprintf(stdout, "Verify: \t\t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Verify:\t\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'v':
+                if (optarg) {
+                    hand.v = atoi(optarg);
+                    if (hand.v == 1)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\ton\n");
+                    else if (hand.v == 0)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Verbose mode:\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case ':':
+                printf("Option needs a value\n");
+                break;
+            case '?':
+                printf("Unknown option: %c\n", optopt);
+                break;
+        }
+    }
+
+    /* optind is for the extra arguments which are not parsed */
+    for (; optind < argc; optind++) {
+        printf("extra arguments not parsed: %s\n", argv[optind]);
+    }
+
+    /* Make sure the command line options are valid */
+    if (hand.format < FORMAT_COO || hand.format > FORMAT_ALL) {
+        printf("The format can only be 0, 1 or 2\n");
+        exit(1);
+    }
+
+    if (hand.chunk_dim1 <= 0 || hand.chunk_dim2 <= 0 || hand.matrix_dim1 <= 0 || hand.matrix_dim2 <= 0) {
+        printf("The chunk and matrix dimensions must be positive\n");
+        exit(1);
+    }
+
+    if (hand.percent <= 0 || hand.percent > 100) {
+        printf("The percentage of defined elements must be between 0 and 100\n");
+        exit(1);
+    }
+
+    if (hand.threads < 1 || hand.threads > MAX_THREADS) {
+        printf("The number of threads must be between 1 and %d\n", MAX_THREADS);
+        exit(1);
+    }
+
+    if (hand.z < 0 || hand.z > 1) {
+        printf("Deflate flag can only be 0 or 1 \n");
+        exit(1);
+    }
+
+    if (hand.b < 0 || hand.b > 1) {
+        printf("Hyperslab flag can only be 0 or 1 \n");
+        exit(1);
+    }
+
+    if (hand.repeat < 1) {
+        printf("The number of writes must be positive\n");
+        exit(1);
+    }
+
+    if (hand.k < 0 || hand.k > 1) {
+        printf("Verify flag can only be 0 or 1 \n");
+        exit(1);
+    }
+
+    if (hand.v < 0 || hand.v > 1) {
+        printf("Verbose flag can only be 0 or 1 \n");
+        exit(1);
+    }
+}
+
+/*------------------------------------------------------------
+ * Print the results
+ *------------------------------------------------------------
+ */
+void print_results(void)
+{
+    double base = res[PATH_HYPERSLAB].done ? res[PATH_HYPERSLAB].total : 0;
+    int    p;
+
+    printf("\n");
+    printf("Printing for each path the number of entries (NE) and of chunks written (NC), the time of the count\n");
+    printf("and bucket steps or of the hyperslab selection (T1), of the assembly (T2), of the writes (T3) and in\n");
+    printf("total (T) in seconds, millions of entries per second (MEPS) and speedup over the hyperslab path (X)\n");
+    printf("\n");
+    printf("      path         NE         NC         T1         T2         T3          T       MEPS          X\n");
+    printf("\n");
+    for (p = 0; p < NUM_PATHS; p++) {
+        if (!res[p].done)
+            continue;
+        printf("%10s %10lli %10lli %10.4f %10.4f %10.4f %10.4f %10.3f %10.2f \n", path_names[p], res[p].nentries,
+               res[p].nchunks, res[p].t1, res[p].t2, res[p].t3, res[p].total,
+               res[p].total > 0 ? (double)res[p].nentries / res[p].total / 1e6 : 0.0,
+               base > 0 && res[p].total > 0 ? base / res[p].total : 0.0);
+    }
+    printf("\n");
+
+    for (p = 0; p < NUM_PATHS; p++)
+        if (res[p].verified >= 0)
+            printf("Verification of %s: %s\n", path_names[p], res[p].verified ? "passed" : "failed");
+}
+
+/*------------------------------------------------------------
+ * Elapsed time
+ *------------------------------------------------------------
+ */
+double elapsed(struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*------------------------------------------------------------
+ * Order-independent checksum of an entry
+ *------------------------------------------------------------
+ */
+uint64_t entry_checksum(uint64_t row, uint64_t col, double value)
+{
+    uint64_t h, bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+    h = (row * 0x9E3779B97F4A7C15ULL) ^ (col + 0x632BE59BD9B4E019ULL) ^ bits;
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    return h ^ (h >> 32);
+}
+
+/*------------------------------------------------------------
+ * Generate the matrix in the CSR and COO formats
+ *------------------------------------------------------------
+ */
+int generate_matrix(matrix_t *m)
+{
+    uint64_t nrows = (uint64_t)hand.matrix_dim1, ncols = (uint64_t)hand.matrix_dim2;
+    uint64_t per_row = (uint64_t)(ncols * hand.percent / 100.0 + 0.5), window, r, j, e = 0;
+
+    srand(2);
+
+    if (per_row == 0)
+        per_row = 1;
+    window = ncols / per_row;
+    m->nnz = nrows * per_row;
+
+    m->row_ptr    = (uint64_t *)malloc((nrows + 1) * sizeof(uint64_t));
+    m->csr_cols   = (uint64_t *)malloc(m->nnz * sizeof(uint64_t));
+    m->csr_values = (double *)malloc(m->nnz * sizeof(double));
+    m->coo_rows   = (uint64_t *)malloc(m->nnz * sizeof(uint64_t));
+    m->coo_cols   = (uint64_t *)malloc(m->nnz * sizeof(uint64_t));
+    m->coo_values = (double *)malloc(m->nnz * sizeof(double));
+    if (!m->row_ptr || !m->csr_cols || !m->csr_values || !m->coo_rows || !m->coo_cols || !m->coo_values)
+        return -1;
+
+    /* One point at random in each window of the row */
+    for (r = 0; r < nrows; r++) {
+        m->row_ptr[r] = e;
+        for (j = 0; j < per_row; j++, e++) {
+            m->csr_cols[e]   = j * window + (uint64_t)rand() % window;
+            m->csr_values[e] = 1.0 + (double)rand() / RAND_MAX;
+            m->coo_rows[e]   = r;
+            m->coo_cols[e]   = m->csr_cols[e];
+            m->coo_values[e] = m->csr_values[e];
+            m->checksum += entry_checksum(r, m->csr_cols[e], m->csr_values[e]);
+        }
+    }
+    m->row_ptr[nrows] = e;
+
+    /* The COO entries in a random order */
+    for (e = m->nnz; e > 1; e--) {
+        uint64_t k = ((uint64_t)rand() * RAND_MAX + (uint64_t)rand()) % e, t;
+        double   v;
+
+        t = m->coo_rows[e - 1], m->coo_rows[e - 1] = m->coo_rows[k], m->coo_rows[k] = t;
+        t = m->coo_cols[e - 1], m->coo_cols[e - 1] = m->coo_cols[k], m->coo_cols[k] = t;
+        v = m->coo_values[e - 1], m->coo_values[e - 1] = m->coo_values[k], m->coo_values[k] = v;
+    }
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Free the matrix
+ *------------------------------------------------------------
+ */
+void free_matrix(matrix_t *m)
+{
+    free(m->row_ptr);
+    free(m->csr_cols);
+    free(m->csr_values);
+    free(m->coo_rows);
+    free(m->coo_cols);
+    free(m->coo_values);
+}
+
+/*------------------------------------------------------------
+ * Create a 2-dim sparse dataset of doubles "name" to write
+ * from COO or CSR buffers
+ *------------------------------------------------------------
+ */
+int sparse_writer_open(hid_t loc_id, const char *name, const hsize_t *dims, const hsize_t *chunk_dims,
+                       unsigned pipeline, int threads, sparse_writer_t *wr)
+{
+    hid_t  space, dcpl;
+    double fill = 0;
+    int    i;
+
+    memset(wr, 0, sizeof(*wr));
+    wr->threads      = threads;
+    wr->pipeline     = pipeline;
+    wr->nchunks      = 1;
+    wr->chunk_nelmts = 1;
+    for (i = 0; i < RANK; i++) {
+        wr->dims[i]       = dims[i];
+        wr->chunk_dims[i] = chunk_dims[i];
+        wr->grid[i]       = (dims[i] + chunk_dims[i] - 1) / chunk_dims[i];
+        wr->nchunks *= wr->grid[i];
+        wr->chunk_nelmts *= chunk_dims[i];
+    }
+
+    space = H5Screate_simple(RANK, dims, NULL);
+    dcpl  = sc_create_dcpl(RANK, chunk_dims);
+    H5Pset_fill_value(dcpl, H5T_NATIVE_DOUBLE, &fill);
+    wr->dset = H5Dcreate2(loc_id, name, H5T_NATIVE_DOUBLE, space, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+    H5Pclose(dcpl);
+    H5Sclose(space);
+
+    return wr->dset < 0 ? -1 : 0;
+}
+
+/*------------------------------------------------------------
+ * Close a dataset written from COO or CSR buffers
+ *------------------------------------------------------------
+ */
+int sparse_writer_close(sparse_writer_t *wr)
+{
+    return H5Dclose(wr->dset) < 0 ? -1 : 0;
+}
+
+/*------------------------------------------------------------
+ * Row of the first entry of a thread's range of CSR entries:
+ * the last row whose pointer is not after the entry
+ *------------------------------------------------------------
+ */
+uint64_t csr_first_row(const uint64_t *row_ptr, uint64_t nrows, uint64_t e)
+{
+    uint64_t lo = 0, hi = nrows;
+
+    while (lo < hi) {
+        uint64_t mid = (lo + hi + 1) / 2;
+
+        if (row_ptr[mid] <= e)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return lo;
+}
+
+/*------------------------------------------------------------
+ * Steps 1 and 2 of a thread: count the entries of its range
+ * for each chunk, or copy them to their positions in the
+ * chunks ("bucket")
+ *------------------------------------------------------------
+ */
+void bucket_range(write_job_t *job, int t, int bucket)
+{
+    const sparse_writer_t *wr     = job->wr;
+    uint64_t              *counts = job->counts[t];
+    uint64_t               e      = job->range_start[t], end = job->range_start[t + 1], row = 0;
+
+    if (job->format == FORMAT_CSR)
+        row = csr_first_row(job->rows, wr->dims[0], e);
+
+    for (; e < end; e++) {
+        uint64_t col = job->cols[e], chunk;
+
+        if (job->format == FORMAT_CSR)
+            while (job->rows[row + 1] <= e)
+                row++;
+        else
+            row = job->rows[e];
+        if (row >= wr->dims[0] || col >= wr->dims[1]) {
+            job->failed = 1;
+            return;
+        }
+
+        chunk = row / wr->chunk_dims[0] * wr->grid[1] + col / wr->chunk_dims[1];
+        if (bucket) {
+            sc_sparse_entry_t *rec = &job->records[counts[chunk]++];
+
+            rec->key   = row % wr->chunk_dims[0] * wr->chunk_dims[1] + col % wr->chunk_dims[1];
+            rec->value = job->values[e];
+        }
+        else
+            counts[chunk]++;
+    }
+}
+
+/*------------------------------------------------------------
+ * Step 1 (callback of the threads)
+ *------------------------------------------------------------
+ */
+void *count_thread(void *arg)
+{
+    write_job_t *job = (write_job_t *)arg;
+
+    bucket_range(job, __sync_fetch_and_add(&job->thread, 1), 0);
+    return NULL;
+}
+
+/*------------------------------------------------------------
+ * Step 2 (callback of the threads)
+ *------------------------------------------------------------
+ */
+void *scatter_thread(void *arg)
+{
+    write_job_t *job = (write_job_t *)arg;
+
+    bucket_range(job, __sync_fetch_and_add(&job->thread, 1), 1);
+    return NULL;
+}
+
+/*------------------------------------------------------------
+ * Step 3: assemble the chunks taken by the thread
+ *------------------------------------------------------------
+ */
+void *assemble_thread(void *arg)
+{
+    write_job_t           *job = (write_job_t *)arg;
+    const sparse_writer_t *wr  = job->wr;
+    sc_sparse_scratch_t    scratch;
+    size_t                 c;
+    long long int          ndup   = 0;
+    int                    failed = 0;
+
+    memset(&scratch, 0, sizeof(scratch));
+    while (!failed && (c = __sync_fetch_and_add(&job->next, 1)) < wr->nchunks)
+        if (sc_assemble_sparse_chunk(RANK, wr->chunk_dims, wr->pipeline, job->records + job->chunk_start[c],
+                                     (size_t)(job->chunk_start[c + 1] - job->chunk_start[c]), &scratch, &ndup,
+                                     &job->images[c], &job->image_sizes[c]) < 0)
+            failed = 1;
+    sc_free_sparse_scratch(&scratch);
+
+    pthread_mutex_lock(&job->lock);
+    job->nduplicates += ndup;
+    if (failed)
+        job->failed = 1;
+    pthread_mutex_unlock(&job->lock);
+
+    return NULL;
+}
+
+/*------------------------------------------------------------
+ * Run "func" on the threads of the writer
+ *------------------------------------------------------------
+ */
+void run_threads(write_job_t *job, void *(*func)(void *))
+{
+    pthread_t threads[MAX_THREADS];
+    int       i;
+
+    job->next   = 0;
+    job->thread = 0;
+    for (i = 0; i < job->wr->threads; i++)
+        pthread_create(&threads[i], NULL, func, job);
+    for (i = 0; i < job->wr->threads; i++)
+        pthread_join(threads[i], NULL);
+}
+
+/*------------------------------------------------------------
+ * Write the entries of a job: bucket them into the chunks,
+ * assemble and write the chunks.  "times" gets the time of the
+ * count and bucket steps, of the assembly and of the writes.
+ *------------------------------------------------------------
+ */
+int write_entries(write_job_t *job, double times[3])
+{
+    sparse_writer_t *wr = job->wr;
+    struct timespec  t0;
+    uint64_t         c;
+    hsize_t          offset[RANK];
+    int              t, nthreads = wr->threads;
+    int              ret = -1;
+
+    pthread_mutex_init(&job->lock, NULL);
+
+    /* Ranges of entries; the CSR ranges are cut at the entries, the rows are found by the threads */
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (t = 0; t <= nthreads; t++)
+        job->range_start[t] = job->nnz * (uint64_t)t / (uint64_t)nthreads;
+
+    for (t = 0; t < nthreads; t++)
+        if (NULL == (job->counts[t] = (uint64_t *)calloc(wr->nchunks, sizeof(uint64_t))))
+            goto done;
+    job->chunk_start = (uint64_t *)malloc((wr->nchunks + 1) * sizeof(uint64_t));
+    job->records     = (sc_sparse_entry_t *)malloc((job->nnz ? job->nnz : 1) * sizeof(sc_sparse_entry_t));
+    job->images      = (uint8_t **)calloc(wr->nchunks, sizeof(uint8_t *));
+    job->image_sizes = (size_t *)calloc(wr->nchunks, sizeof(size_t));
+    if (!job->chunk_start || !job->records || !job->images || !job->image_sizes)
+        goto done;
+
+    /* 1 and 2: parallel counting sort by chunk */
+    run_threads(job, count_thread);
+    if (job->failed)
+        goto done;
+    sc_bucket_starts(nthreads, wr->nchunks, job->counts, job->chunk_start);
+    run_threads(job, scatter_thread);
+    times[0] = elapsed(&t0);
+
+    /* 3: assemble the chunks */
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    run_threads(job, assemble_thread);
+    if (job->failed)
+        goto done;
+    times[1] = elapsed(&t0);
+
+    /* 4: the main thread writes the chunks in the logical order */
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (c = 0; c < wr->nchunks; c++) {
+        if (!job->images[c])
+            continue;
+        offset[0] = c / wr->grid[1] * wr->chunk_dims[0];
+        offset[1] = c % wr->grid[1] * wr->chunk_dims[1];
+        if (H5Dwrite_chunk(wr->dset, H5P_DEFAULT, 0, offset, job->image_sizes[c], job->images[c]) < 0)
+            goto done;
+        job->nchunks++;
+    }
+    if (H5Dflush(wr->dset) < 0)
+        goto done;
+    times[2] = elapsed(&t0);
+    ret      = 0;
+
+done:
+    for (t = 0; t < nthreads; t++)
+        free(job->counts[t]);
+    if (job->images)
+        for (c = 0; c < wr->nchunks; c++)
+            free(job->images[c]);
+    free(job->images);
+    free(job->image_sizes);
+    free(job->records);
+    free(job->chunk_start);
+    pthread_mutex_destroy(&job->lock);
+
+    return ret;
+}
+
+/*------------------------------------------------------------
+ * Write "nnz" entries given by their rows, their columns and
+ * their values; duplicate entries are summed
+ *------------------------------------------------------------
+ */
+int sparse_write_coo(sparse_writer_t *wr, uint64_t nnz, const uint64_t *rows, const uint64_t *cols,
+                     const double *values, long long int *nchunks, double times[3])
+{
+    write_job_t job;
+    int         ret;
+
+    memset(&job, 0, sizeof(job));
+    job.wr     = wr;
+    job.format = FORMAT_COO;
+    job.nnz    = nnz;
+    job.rows   = rows;
+    job.cols   = cols;
+    job.values = values;
+    ret        = write_entries(&job, times);
+    *nchunks   = job.nchunks;
+
+    return ret;
+}
+
+/*------------------------------------------------------------
+ * Write the entries of the dims[0] rows given by the row
+ * pointers, the column of each entry and its value; duplicate
+ * entries are summed
+ *------------------------------------------------------------
+ */
+int sparse_write_csr(sparse_writer_t *wr, const uint64_t *row_ptr, const uint64_t *cols, const double *values,
+                     long long int *nchunks, double times[3])
+{
+    write_job_t job;
+    int         ret;
+
+    memset(&job, 0, sizeof(job));
+    job.wr     = wr;
+    job.format = FORMAT_CSR;
+    job.nnz    = row_ptr[wr->dims[0]] - row_ptr[0];
+    job.rows   = row_ptr;
+    job.cols   = cols;
+    job.values = values;
+    if (row_ptr[0] != 0)
+        return -1;
+    ret      = write_entries(&job, times);
+    *nchunks = job.nchunks;
+
+    return ret;
+}
+
+/*------------------------------------------------------------
+ * The hyperslab path: build the selection of the entries
+ * point by point (create_hyperslab) and write the values from
+ * a 1-dim buffer into the selection (create_hdf5_dsets)
+ *------------------------------------------------------------
+ */
+int hyperslab_write(hid_t file, const matrix_t *m, long long int *nchunks, double times[3])
+{
+    struct timespec t0;
+    hid_t           space, mem_space, dcpl, dset;
+    hsize_t         dims[RANK], chunk_dims[RANK], offset[RANK], block[RANK] = {1, 1}, mem_dim[1], nstored;
+    uint64_t        r, e;
+    double          fill = 0;
+    int             ret = -1;
+
+    dims[0]       = (hsize_t)hand.matrix_dim1;
+    dims[1]       = (hsize_t)hand.matrix_dim2;
+    chunk_dims[0] = (hsize_t)hand.chunk_dim1;
+    chunk_dims[1] = (hsize_t)hand.chunk_dim2;
+    space         = H5Screate_simple(RANK, dims, NULL);
+    dcpl          = H5Pcreate(H5P_DATASET_CREATE);
+    H5Pset_chunk(dcpl, RANK, chunk_dims);
+    H5Pset_fill_value(dcpl, H5T_NATIVE_DOUBLE, &fill);
+    if (hand.z)
+        H5Pset_deflate(dcpl, SC_DEFLATE_LEVEL);
+    dset = H5Dcreate2(file, DENSE_DSET_NAME, H5T_NATIVE_DOUBLE, space, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+    H5Pclose(dcpl);
+
+    /* The selection of the entries, one point at a time */
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    H5Sselect_none(space);
+    for (r = 0; r < (uint64_t)hand.matrix_dim1; r++)
+        for (e = m->row_ptr[r]; e < m->row_ptr[r + 1]; e++) {
+            offset[0] = r;
+            offset[1] = m->csr_cols[e];
+            H5Sselect_hyperslab(space, e == 0 ? H5S_SELECT_SET : H5S_SELECT_OR, offset, NULL, block, NULL);
+        }
+    times[0] = elapsed(&t0);
+    times[1] = 0;
+
+    /* The values from a 1-dim buffer */
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    mem_dim[0] = m->nnz;
+    mem_space  = H5Screate_simple(1, mem_dim, NULL);
+    if (H5Dwrite(dset, H5T_NATIVE_DOUBLE, mem_space, space, H5P_DEFAULT, m->csr_values) >= 0 &&
+        H5Dflush(dset) >= 0)
+        ret = 0;
+    times[2] = elapsed(&t0);
+
+    H5Sselect_all(space);
+    H5Dget_num_chunks(dset, space, &nstored);
+    *nchunks = (long long int)nstored;
+
+    H5Sclose(mem_space);
+    H5Sclose(space);
+    H5Dclose(dset);
+
+    return ret;
+}
+
+/*------------------------------------------------------------
+ * Read a sparse dataset back and compare the number of
+ * entries and their checksum with the matrix
+ *------------------------------------------------------------
+ */
+int verify_sparse(hid_t file, const char *name, const matrix_t *m)
+{
+    sc_chunk_loc_t *locs = NULL;
+    sc_run_t       *runs = NULL;
+    hid_t           dset;
+    hsize_t         chunk_dims[RANK] = {(hsize_t)hand.chunk_dim1, (hsize_t)hand.chunk_dim2};
+    size_t          nchunks, c;
+    uint64_t        nelemts = 0, checksum = 0;
+    int             ok = 0;
+
+    if ((dset = H5Dopen2(file, name, H5P_DEFAULT)) < 0)
+        return 0;
+    if (sc_get_chunk_locations(dset, &nchunks, &locs) < 0)
+        goto done;
+    for (c = 0; c < nchunks; c++) {
+        sc_chunk_info_t info;
+        void           *buf[2] = {NULL, NULL};
+        hsize_t         sel_dims[SC_MAX_RANK];
+        size_t          nruns, r;
+        uint64_t        k = 0, i;
+        int             rank;
+
+        if (sc_read_struct_chunk(dset, H5P_DEFAULT, locs[c].offset, &info, NULL) < 0)
+            goto done;
+        buf[0] = malloc(info.section_orig_size[SC_SECTION_SELECTION]);
+        buf[1] = malloc(info.section_orig_size[SC_SECTION_FIXED] + 1);
+        if (sc_read_struct_chunk(dset, H5P_DEFAULT, locs[c].offset, &info, buf) < 0 ||
+            sc_decode_runs(buf[0], info.section_orig_size[SC_SECTION_SELECTION], &rank, sel_dims, &nruns, NULL) < 0 ||
+            NULL == (runs = (sc_run_t *)realloc(runs, (nruns + 1) * sizeof(sc_run_t))) ||
+            sc_decode_runs(buf[0], info.section_orig_size[SC_SECTION_SELECTION], &rank, sel_dims, &nruns, runs) < 0) {
+            free(buf[0]);
+            free(buf[1]);
+            goto done;
+        }
+        for (r = 0; r < nruns; r++)
+            for (i = 0; i < runs[r].len; i++, k++) {
+                uint64_t pos = runs[r].start + i;
+
+                checksum += entry_checksum(locs[c].offset[0] + pos / chunk_dims[1],
+                                           locs[c].offset[1] + pos % chunk_dims[1], ((double *)buf[1])[k]);
+            }
+        nelemts += k;
+        free(buf[0]);
+        free(buf[1]);
+    }
+    ok = nelemts == m->nnz && checksum == m->checksum;
+
+done:
+    free(runs);
+    free(locs);
+    H5Dclose(dset);
+    return ok;
+}
+
+/*------------------------------------------------------------
+ * Read the dense dataset back and compare the number of
+ * entries and their checksum with the matrix
+ *------------------------------------------------------------
+ */
+int verify_dense(hid_t file, const matrix_t *m)
+{
+    hid_t    dset;
+    hsize_t  ncols = (hsize_t)hand.matrix_dim2, start[RANK] = {0, 0}, count[RANK] = {1, ncols};
+    hid_t    space, mem_space;
+    double  *row;
+    uint64_t nelemts = 0, checksum = 0, r, c;
+
+    if ((dset = H5Dopen2(file, DENSE_DSET_NAME, H5P_DEFAULT)) < 0)
+        return 0;
+    space     = H5Dget_space(dset);
+    mem_space = H5Screate_simple(1, &ncols, NULL);
+    row       = (double *)malloc(ncols * sizeof(double));
+    for (r = 0; r < (uint64_t)hand.matrix_dim1; r++) {
+        start[0] = r;
+        H5Sselect_hyperslab(space, H5S_SELECT_SET, start, NULL, count, NULL);
+        if (H5Dread(dset, H5T_NATIVE_DOUBLE, mem_space, space, H5P_DEFAULT, row) < 0)
+            break;
+        for (c = 0; c < ncols; c++)
+            if (row[c] != 0) {
+                checksum += entry_checksum(r, c, row[c]);
+                nelemts++;
+            }
+    }
+    free(row);
+    H5Sclose(mem_space);
+    H5Sclose(space);
+    H5Dclose(dset);
+
+    return nelemts == m->nnz && checksum == m->checksum;
+}
+
+/*------------------------------------------------------------
+ * Keep the best times of a path
+ *------------------------------------------------------------
+ */
+void add_result(int path, long long int nentries, long long int nchunks, const double times[3])
+{
+    double total = times[0] + times[1] + times[2];
+
+    if (!res[path].done || total < res[path].total) {
+        res[path].t1    = times[0];
+        res[path].t2    = times[1];
+        res[path].t3    = times[2];
+        res[path].total = total;
+    }
+    res[path].nentries = nentries;
+    res[path].nchunks  = nchunks;
+    res[path].done     = 1;
+}
+
+/*------------------------------------------------------------
+ * Main function
+ *------------------------------------------------------------
+ */
+int
+main(int argc, char **argv)
+{
+    sparse_writer_t wr;
+    matrix_t        m;
+    hid_t           file;
+    hsize_t         dims[RANK], chunk_dims[RANK];
+    double          times[3];
+    long long int   nchunks;
+    int             p, r;
+
+    parse_command_line(argc, argv);
+
+    memset(&m, 0, sizeof(m));
+    if (generate_matrix(&m) < 0) {
+        printf("Failed to allocate the matrix\n");
+        return 1;
+    }
+    if (hand.v)
+        printf("Generated %llu entries of a %llix%lli matrix\n", (unsigned long long)m.nnz, hand.matrix_dim1,
+               hand.matrix_dim2);
+
+    dims[0]       = (hsize_t)hand.matrix_dim1;
+    dims[1]       = (hsize_t)hand.matrix_dim2;
+    chunk_dims[0] = (hsize_t)hand.chunk_dim1;
+    chunk_dims[1] = (hsize_t)hand.chunk_dim2;
+    for (p = 0; p < NUM_PATHS; p++)
+        res[p].verified = -1;
+
+    for (r = 0; r < hand.repeat; r++) {
+        int last = r == hand.repeat - 1;
+
+        if ((file = H5Fcreate(hand.out_file, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT)) < 0) {
+            printf("Failed to create %s\n", hand.out_file);
+            return 1;
+        }
+
+        for (p = PATH_COO; p <= PATH_CSR; p++) {
+            const char *name = p == PATH_COO ? COO_DSET_NAME : CSR_DSET_NAME;
+            int         ret;
+
+            if (hand.format != FORMAT_ALL && hand.format != p)
+                continue;
+            if (hand.v) printf("Writing %s from %s buffers with %d threads\n", name, path_names[p], hand.threads);
+            if (sparse_writer_open(file, name, dims, chunk_dims, hand.z ? SC_PIPELINE_DEFLATE : SC_PIPELINE_NONE,
+                                   hand.threads, &wr) < 0) {
+                printf("Failed to create the dataset %s\n", name);
+                return 1;
+            }
+            if (p == PATH_COO)
+                ret = sparse_write_coo(&wr, m.nnz, m.coo_rows, m.coo_cols, m.coo_values, &nchunks, times);
+            else
+                ret = sparse_write_csr(&wr, m.row_ptr, m.csr_cols, m.csr_values, &nchunks, times);
+            sparse_writer_close(&wr);
+            if (ret < 0) {
+                printf("Failed to write %s from %s buffers\n", name, path_names[p]);
+                return 1;
+            }
+            add_result(p, (long long int)m.nnz, nchunks, times);
+            if (last && hand.k)
+                res[p].verified = verify_sparse(file, name, &m);
+        }
+
+        if (hand.b) {
+            if (hand.v) printf("Writing %s through a hyperslab selection\n", DENSE_DSET_NAME);
+            if (hyperslab_write(file, &m, &nchunks, times) < 0) {
+                printf("Failed to write %s\n", DENSE_DSET_NAME);
+                return 1;
+            }
+            add_result(PATH_HYPERSLAB, (long long int)m.nnz, nchunks, times);
+            if (last && hand.k)
+                res[PATH_HYPERSLAB].verified = verify_dense(file, &m);
+        }
+
+        H5Fclose(file);
+    }
+
+    print_results();
+    free_matrix(&m);
+
+    if (hand.v) printf("Done! \n");
+
+    return 0;
+}
@@ -0,0 +1,3359 @@
+/*
+ * Emulation of the structured chunk storage proposed in RFC-HDF5-Model-API-Sparse and in
+ * "Appendix E: Layout of Sectioned Chunk" of the File Format Specification 3.1 RFC.
+ *
+ * The benchmarks in this directory include this header to store structured chunks with the
+ * current HDF5 library.  A structured chunk is written as a regular chunk of a chunked dataset
+ * with H5Dwrite_chunk.  Because the chunk index of the current library cannot hold the structured
+ * chunk metadata (section sizes, unfiltered sizes and filter masks), the metadata is stored in a
+ * small prefix at the beginning of the chunk, followed by the sections:
+ *
+ *   Prefix (SC_PREFIX_SIZE bytes)
+ *   Section 0 (e.g., Encoded Selection) followed by its 4-byte checksum
+ *   Section 1 (e.g., values of the defined elements)
+ *   ...
+ *   Unused bytes (slack capacity kept by the allocation policy)
+ *
+ * A dummy optional filter (SC_FILTER_ID) is added to the dataset filter pipeline so that the
+ * library records the size of each chunk in the chunk index and allows chunks of any size.
+ * The filter is never applied; the chunks are always accessed with direct chunk I/O.
+ *
+ * The Encoded Selection section uses the format produced by H5Sencode for hyperslab selections
+ * (version 1 of the hyperslab selection encoding), so it can be decoded with H5Sdecode.
+ *
+ * The functions follow the signatures of H5Dwrite_struct_chunk and H5Dread_struct_chunk
+ * proposed in the RFC; sc_chunk_info_t mirrors H5D_struct_chunk_info_t.
+ */
+
+#ifndef STRUCTURED_CHUNK_H
+#define STRUCTURED_CHUNK_H
+
+#include "hdf5.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define SC_FILTER_ID                    256         /* First ID in the range reserved for testing */
+#define SC_MAGIC                        "SCHK"
+#define SC_VERSION                      1
+#define SC_MAX_SECTIONS                 3
+#define SC_PREFIX_SIZE                  (16 + 24 * SC_MAX_SECTIONS)
+#define SC_CHECKSUM_SIZE                4
+#define SC_MAX_RANK                     4
+
+/* Types of structured chunk (bit-field as in the Structured Chunk Storage Property Description) */
+#define SC_SPARSE_CHUNK                 0x1
+#define SC_VL_CHUNK                     0x2
+
+/* Sections of the sparse structured chunk */
+#define SC_SECTION_SELECTION            0
+#define SC_SECTION_FIXED                1
+#define SC_SECTION_VL                   2
+
+/* Filters that can be applied to a section */
+#define SC_PIPELINE_NONE                0x0
+#define SC_PIPELINE_DEFLATE             0x1
+#define SC_DEFLATE_LEVEL                9
+
+/* Allocation policies for rewritten chunks */
+#define SC_ALLOC_EXACT                  0           /* Store the chunk with its exact size (library default) */
+#define SC_ALLOC_SLACK                  1           /* Round up to a size class with slack and grow in place */
+#define SC_ALLOC_PROP_NAME              "sc_alloc_policy"
+#define SC_SLACK_PROP_NAME              "sc_alloc_slack"
+#define SC_MIN_SIZE_CLASS               256
+
+/* Selection cluster: the Encoded Selections of all chunks of a dataset stored together */
+#define SC_CLUSTER_SUFFIX               ".selections"
+#define SC_CLUSTER_MAGIC                "SCSL"
+#define SC_CLUSTER_VERSION              1
+#define SC_CLUSTER_HEADER_SIZE          16
+#define SC_SELECTION_READAHEAD          4096        /* Bytes read after the prefix to get the Encoded Selection */
+
+/* Packed storage: chunks written by several processes into one contiguous dataset with an index */
+#define SC_INDEX_SUFFIX                 ".index"
+#define SC_INDEX_FIELDS                 (SC_MAX_RANK + 2)   /* Offset of the chunk, address and size */
+#define SC_DIMS_ATTR                    "dims"
+#define SC_CHUNK_DIMS_ATTR              "chunk_dims"
+
+/* Append mode: chunks with fewer hits than 1/SC_APPEND_SORT_RATIO of their elements are sorted, not scanned */
+#define SC_APPEND_SORT_RATIO            16
+#define SC_FRAMES_SUFFIX                ".frames"   /* Dataset whose extent is the number of published frames */
+
+/* Reads of structured chunks into dense buffers */
+#define SC_FILL_INIT_PROP_NAME          "sc_fill_initialized"
+#define SC_STREAM_BLOCK                 4096        /* Bytes of a dense chunk assembled in cache before they are stored */
+#define SC_STREAM_MIN_SIZE              (1 << 20)   /* Dense chunks from this size are stored with non-temporal stores */
+
+typedef struct {
+    unsigned        type;                               /* SC_SPARSE_CHUNK and/or SC_VL_CHUNK */
+    unsigned        num_sections;                       /* Number of sections in the chunk */
+    uint64_t        nelemts;                            /* Number of defined elements in the chunk */
+    unsigned        pipeline[SC_MAX_SECTIONS];          /* Filters requested for each section */
+    uint32_t        filter_mask[SC_MAX_SECTIONS];       /* Filters skipped for each section; 0 if all were applied */
+    uint64_t        section_size[SC_MAX_SECTIONS];      /* Stored size of each section (with checksum) */
+    uint64_t        section_orig_size[SC_MAX_SECTIONS]; /* Original size of each section */
+} sc_chunk_info_t;
+
+/* Run of consecutive defined elements along the fastest changing dimension of a chunk */
+typedef struct {
+    uint64_t        start;                              /* Linear offset of the first element in the chunk */
+    uint64_t        len;                                /* Number of elements */
+} sc_run_t;
+
+/* Entry of a sparse chunk of doubles: the linear offset of the element in the chunk and its value */
+typedef struct {
+    uint64_t        key;
+    double          value;
+} sc_sparse_entry_t;
+
+/* Buffers of sc_assemble_sparse_chunk reused for the chunks of a thread; zero-initialized before the first */
+typedef struct {
+    size_t          max_n;                              /* Entries the buffers below hold */
+    uint64_t       *offsets;                            /* Distinct offsets of the entries */
+    double         *data;                               /* Values of the distinct offsets */
+    sc_run_t       *runs;
+    uint8_t        *sel;                                /* Encoded Selection */
+    double         *dense;                              /* Chunk of values for chunks with many entries */
+    uint8_t        *mask;                               /* Defined elements of "dense" */
+} sc_sparse_scratch_t;
+
+/* Location of a stored chunk in the file */
+typedef struct {
+    hsize_t         offset[SC_MAX_RANK];                /* Logical position of the chunk's first element */
+    haddr_t         addr;                               /* Address of the chunk in the file */
+    hsize_t         size;                               /* Stored size of the chunk */
+} sc_chunk_loc_t;
+
+/* Read-only memory map of a file */
+typedef struct {
+    int             fd;
+    uint8_t        *base;                               /* Address of the first byte of the file */
+    size_t          size;                               /* Size of the mapping */
+} sc_mmap_t;
+
+/* Zero-copy view of a section in a memory map */
+typedef struct {
+    const uint8_t  *ptr;                                /* NULL if the section is filtered */
+    size_t          size;                               /* Size of the section without its checksum */
+} sc_view_t;
+
+/* Called by sc_iterate_chunks with the logical position and the stored size of each stored chunk */
+typedef herr_t (*sc_chunk_op_t)(const hsize_t *offset, hsize_t size, void *op_data);
+
+/* Called by sc_get_defined with the defined elements of each stored chunk */
+typedef herr_t (*sc_defined_op_t)(const hsize_t *offset, size_t nruns, const sc_run_t *runs, void *op_data);
+
+/* Read of a range of bytes of the file into a buffer */
+typedef struct {
+    haddr_t         addr;                               /* Address of the first byte in the file */
+    size_t          size;                               /* Number of bytes */
+    void           *buf;
+} sc_io_t;
+
+/* Read "size" bytes at "offset" of a file; returns the number of bytes read or -1 */
+typedef ssize_t (*sc_read_op_t)(void *op_data, void *buf, size_t size, uint64_t offset);
+
+#define SC_NO_COALESCING                ((size_t)-1) /* Gap that disables the merging of reads */
+
+/* Chunk of the open time slab of an appender; the hits are buffered until the chunk is sealed */
+typedef struct {
+    size_t          nhits;                              /* Number of buffered hits */
+    size_t          max_hits;                           /* Capacity of the buffers */
+    uint64_t       *offsets;                            /* Linear offset of each hit in the chunk */
+    uint8_t        *values;                             /* Value of each hit */
+} sc_open_chunk_t;
+
+/* Appender of sparse hits along the unlimited first (time) dimension of a structured chunk dataset */
+typedef struct {
+    hid_t           dset_id;
+    hid_t           dxpl_id;
+    int             rank;
+    size_t          elmt_size;
+    unsigned        pipeline;                           /* Filters requested for the Data section */
+    hsize_t         dims[SC_MAX_RANK];                  /* Extent of the dataset; dims[0] may run ahead of the frames */
+    hsize_t         chunk_dims[SC_MAX_RANK];
+    hsize_t         grid[SC_MAX_RANK];                  /* Number of chunks in each dimension of a time slab */
+    hsize_t         extend_slabs;                       /* Number of time slabs added by each H5Dset_extent */
+    hsize_t         slab;                               /* Index of the open time slab */
+    hsize_t         nframes;                            /* Length of the time dimension with hits */
+    size_t          nspatial;                           /* Number of chunks in a time slab */
+    sc_open_chunk_t *open;                              /* Open chunks of the time slab */
+    uint8_t        *mask;                               /* Mask and dense values of the chunk being sealed */
+    uint8_t        *dense;
+    sc_run_t       *runs;
+    size_t          max_runs;
+    size_t          nsealed;                            /* Number of chunks sealed and written */
+    size_t          nextends;                           /* Number of calls to H5Dset_extent */
+    hid_t           frames_id;                          /* "<name>.frames" or H5I_INVALID_HID */
+    hsize_t         published;                          /* Frames published to readers */
+    int             swmr;                               /* The file is open for SWMR writing */
+} sc_append_t;
+
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+#define SC_HAVE_URING                   1
+
+/* Submission and completion rings of an io_uring instance (used without liburing) */
+typedef struct {
+    int                  fd;
+    unsigned             depth;                         /* Number of submission queue entries */
+    unsigned            *sq_head, *sq_tail, *sq_mask, *sq_array;
+    struct io_uring_sqe *sqes;
+    unsigned            *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+    void                *sq_ring, *cq_ring;
+    size_t               sq_ring_size, cq_ring_size, sqes_size;
+    unsigned             to_submit;                     /* Entries queued since the last submission */
+} sc_uring_t;
+
+/* Called by sc_uring_read_chunks for each chunk as soon as it has been read */
+typedef int (*sc_uring_op_t)(size_t chunk, const uint8_t *image, size_t size, void *op_data);
+#endif
+
+/*------------------------------------------------------------
+ * Little-endian encoding of integers in the prefix and in
+ * encoded selections
+ *------------------------------------------------------------
+ */
+static inline void sc_encode32(uint8_t **p, uint32_t v)
+{
+    int i;
+
+    for (i = 0; i < 4; i++)
+        *(*p)++ = (uint8_t)(v >> (8 * i));
+}
+
+static inline void sc_encode64(uint8_t **p, uint64_t v)
+{
+    int i;
+
+    for (i = 0; i < 8; i++)
+        *(*p)++ = (uint8_t)(v >> (8 * i));
+}
+
+static inline uint32_t sc_decode32(const uint8_t **p)
+{
+    uint32_t v = 0;
+    int      i;
+
+    for (i = 0; i < 4; i++)
+        v |= (uint32_t)(*(*p)++) << (8 * i);
+    return v;
+}
+
+static inline uint64_t sc_decode64(const uint8_t **p)
+{
+    uint64_t v = 0;
+    int      i;
+
+    for (i = 0; i < 8; i++)
+        v |= (uint64_t)(*(*p)++) << (8 * i);
+    return v;
+}
+
+/*------------------------------------------------------------
+ * Sections that contain metadata carry a checksum: the encoded
+ * selection of the sparse chunk and the section with the
+ * locations of variable-length elements
+ *------------------------------------------------------------
+ */
+static inline int sc_section_has_checksum(unsigned type, unsigned section)
+{
+    if (section == 0)
+        return 1;
+    if ((type & SC_SPARSE_CHUNK) && (type & SC_VL_CHUNK) && section == 1)
+        return 1;
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Create a dataset creation property list for structured
+ * chunk storage (emulates H5Pset_struct_chunk)
+ *------------------------------------------------------------
+ */
+static inline hid_t sc_create_dcpl(int rank, const hsize_t *chunk_dims)
+{
+    hid_t dcpl;
+
+    if ((dcpl = H5Pcreate(H5P_DATASET_CREATE)) < 0)
+        goto error;
+    if (H5Pset_chunk(dcpl, rank, chunk_dims) < 0)
+        goto error;
+
+    /* The filter is optional and is never registered; it only makes the chunk sizes variable */
+    if (H5Pset_filter(dcpl, SC_FILTER_ID, H5Z_FLAG_OPTIONAL, 0, NULL) < 0)
+        goto error;
+
+    return dcpl;
+
+error:
+    return H5I_INVALID_HID;
+}
+
+/*------------------------------------------------------------
+ * Find runs of defined elements in a mask of a chunk with
+ * "nelmts" elements and "row_len" elements in the fastest
+ * changing dimension.  Runs never cross a row.  Returns the
+ * number of runs; "runs" may be NULL to count them.
+ *------------------------------------------------------------
+ */
+static inline size_t sc_mask_to_runs(const uint8_t *mask, uint64_t nelmts, uint64_t row_len, sc_run_t *runs)
+{
+    size_t   nruns = 0;
+    uint64_t i = 0;
+
+    while (i < nelmts) {
+        uint64_t row_end;
+        uint64_t start;
+
+        if (!mask[i]) {
+            i++;
+            continue;
+        }
+
+        start   = i;
+        row_end = (i / row_len + 1) * row_len;
+        while (i < row_end && mask[i])
+            i++;
+
+        if (runs) {
+            runs[nruns].start = start;
+            runs[nruns].len   = i - start;
+        }
+        nruns++;
+    }
+
+    return nruns;
+}
+
+/*------------------------------------------------------------
+ * Encode runs of a chunk as H5Sencode does for a hyperslab
+ * selection of the chunk dataspace: returns the size of the
+ * encoding; "buf" may be NULL to query the size.
+ *------------------------------------------------------------
+ */
+static inline size_t sc_encode_runs(int rank, const hsize_t *dims, size_t nruns, const sc_run_t *runs, void *buf)
+{
+    size_t   extent_size = 8 + 16 * (size_t)rank;
+    size_t   sel_size    = nruns ? 24 + 8 * (size_t)rank * nruns : 16;
+    size_t   size        = 7 + extent_size + sel_size;
+    uint8_t *p           = (uint8_t *)buf;
+    size_t   n;
+    int      i;
+
+    if (!buf)
+        return size;
+
+    /* Header: dataspace object, encoding version and size of lengths */
+    *p++ = 1;
+    *p++ = 0;
+    *p++ = 8;
+    sc_encode32(&p, (uint32_t)extent_size);
+
+    /* Simple dataspace message (version 1) with the maximum dimensions */
+    *p++ = 1;
+    *p++ = (uint8_t)rank;
+    *p++ = 1;
+    *p++ = 0;
+    sc_encode32(&p, 0);
+    for (i = 0; i < rank; i++)
+        sc_encode64(&p, dims[i]);
+    for (i = 0; i < rank; i++)
+        sc_encode64(&p, dims[i]);
+
+    /* Empty selection */
+    if (nruns == 0) {
+        sc_encode32(&p, (uint32_t)H5S_SEL_NONE);
+        sc_encode32(&p, 1);
+        sc_encode32(&p, 0);
+        sc_encode32(&p, 0);
+        return size;
+    }
+
+    /* Hyperslab selection (version 1): a list of blocks given by their start and end coordinates */
+    sc_encode32(&p, (uint32_t)H5S_SEL_HYPERSLABS);
+    sc_encode32(&p, 1);
+    sc_encode32(&p, 0);
+    sc_encode32(&p, (uint32_t)(8 + 8 * rank * nruns));
+    sc_encode32(&p, (uint32_t)rank);
+    sc_encode32(&p, (uint32_t)nruns);
+    for (n = 0; n < nruns; n++) {
+        hsize_t coords[H5S_MAX_RANK];
+        hsize_t rem = runs[n].start;
+
+        for (i = rank - 1; i >= 0; i--) {
+            coords[i] = rem % dims[i];
+            rem /= dims[i];
+        }
+        for (i = 0; i < rank; i++)
+            sc_encode32(&p, (uint32_t)coords[i]);
+        for (i = 0; i < rank - 1; i++)
+            sc_encode32(&p, (uint32_t)coords[i]);
+        sc_encode32(&p, (uint32_t)(coords[rank - 1] + runs[n].len - 1));
+    }
+
+    return size;
+}
+
+/*------------------------------------------------------------
+ * Get the selection type (H5S_sel_type) and the version of the
+ * selection encoding of a selection encoded by H5Sencode
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_selection_format(const void *buf, size_t size, uint32_t *sel_type, uint32_t *version)
+{
+    const uint8_t *p = (const uint8_t *)buf;
+    uint32_t       extent_size;
+
+    if (size < 7 || p[0] != 1 || p[1] != 0 || p[2] != 8)
+        return -1;
+    p += 3;
+    extent_size = sc_decode32(&p);
+    if (size < 7 + (size_t)extent_size + 8)
+        return -1;
+    p += extent_size;
+    *sel_type = sc_decode32(&p);
+    *version  = sc_decode32(&p);
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Decode a selection encoded by H5Sencode (version 1 of the
+ * selection encoding, as written by sc_encode_runs) into runs
+ * along the fastest changing dimension.  "none", "all", and
+ * hyperslab and point selections are supported.  "runs"
+ * may be NULL to count the runs.  Returns the rank and the
+ * dimensions of the dataspace.
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_decode_runs(const void *buf, size_t size, int *rank, hsize_t *dims, size_t *nruns, sc_run_t *runs)
+{
+    const uint8_t *p   = (const uint8_t *)buf;
+    const uint8_t *end = p + size;
+    const uint8_t *q;
+    uint32_t       extent_size, sel_type, version, count, n;
+    hsize_t        start[SC_MAX_RANK], stop[SC_MAX_RANK], pos[SC_MAX_RANK];
+    int            r, i;
+
+    *nruns = 0;
+    if (size < 7 || p[0] != 1 || p[1] != 0 || p[2] != 8)
+        return -1;
+    p += 3;
+    extent_size = sc_decode32(&p);
+    if (extent_size < 8 || (size_t)(end - p) < (size_t)extent_size + 16)
+        return -1;
+
+    /* Simple dataspace message (version 1) */
+    q = p;
+    if (q[0] != 1 || (r = q[1]) < 1 || r > SC_MAX_RANK || extent_size < 8 + 8 * (uint32_t)r)
+        return -1;
+    q += 8;
+    for (i = 0; i < r; i++)
+        dims[i] = sc_decode64(&q);
+    *rank = r;
+    p += extent_size;
+
+    sel_type = sc_decode32(&p);
+    version  = sc_decode32(&p);
+    p += 8;
+
+    if (sel_type == (uint32_t)H5S_SEL_NONE)
+        return 0;
+
+    if (sel_type == (uint32_t)H5S_SEL_ALL) {
+        hsize_t nrows = 1;
+
+        for (i = 0; i < r - 1; i++)
+            nrows *= dims[i];
+        for (n = 0; n < nrows; n++) {
+            if (runs) {
+                runs[*nruns].start = n * dims[r - 1];
+                runs[*nruns].len   = dims[r - 1];
+            }
+            (*nruns)++;
+        }
+        return 0;
+    }
+
+    if (version != 1 || (sel_type != (uint32_t)H5S_SEL_POINTS && sel_type != (uint32_t)H5S_SEL_HYPERSLABS))
+        return -1;
+    if (end - p < 8 || sc_decode32(&p) != (uint32_t)r)
+        return -1;
+    count = sc_decode32(&p);
+    if ((size_t)(end - p) < (size_t)count * 4 * (size_t)r * (sel_type == (uint32_t)H5S_SEL_POINTS ? 1 : 2))
+        return -1;
+
+    for (n = 0; n < count; n++) {
+        for (i = 0; i < r; i++)
+            start[i] = sc_decode32(&p);
+        if (sel_type == (uint32_t)H5S_SEL_POINTS)
+            memcpy(stop, start, sizeof(hsize_t) * (size_t)r);
+        else
+            for (i = 0; i < r; i++)
+                stop[i] = sc_decode32(&p);
+
+        /* One run for each row of the block */
+        memcpy(pos, start, sizeof(hsize_t) * (size_t)r);
+        for (;;) {
+            if (runs) {
+                hsize_t linear = 0;
+
+                for (i = 0; i < r; i++)
+                    linear = linear * dims[i] + pos[i];
+                runs[*nruns].start = linear;
+                runs[*nruns].len   = stop[r - 1] - start[r - 1] + 1;
+            }
+            (*nruns)++;
+
+            for (i = r - 2; i >= 0; i--) {
+                if (pos[i] < stop[i]) {
+                    pos[i]++;
+                    break;
+                }
+                pos[i] = start[i];
+            }
+            if (i < 0)
+                break;
+        }
+    }
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Gather values of the defined elements of a dense chunk into
+ * the packed Data section
+ *------------------------------------------------------------
+ */
+static inline void sc_gather_runs(const void *dense, size_t elmt_size, size_t nruns, const sc_run_t *runs, void *packed)
+{
+    uint8_t *dst = (uint8_t *)packed;
+    size_t   n;
+
+    for (n = 0; n < nruns; n++) {
+        memcpy(dst, (const uint8_t *)dense + runs[n].start * elmt_size, runs[n].len * elmt_size);
+        dst += runs[n].len * elmt_size;
+    }
+}
+
+/*------------------------------------------------------------
+ * Scatter the packed Data section into the defined elements of
+ * a dense chunk; the other elements are not written
+ *------------------------------------------------------------
+ */
+static inline void sc_scatter_runs(const void *packed, size_t elmt_size, size_t nruns, const sc_run_t *runs, void *dense)
+{
+    const uint8_t *src = (const uint8_t *)packed;
+    size_t         n;
+
+    for (n = 0; n < nruns; n++) {
+        memcpy((uint8_t *)dense + runs[n].start * elmt_size, src, runs[n].len * elmt_size);
+        src += runs[n].len * elmt_size;
+    }
+}
+
+/*------------------------------------------------------------
+ * Set "nelmts" elements to the fill value; a NULL fill value
+ * is zero
+ *------------------------------------------------------------
+ */
+static inline void sc_fill_elements(void *buf, size_t nelmts, size_t elmt_size, const void *fill)
+{
+    uint8_t *p    = (uint8_t *)buf;
+    size_t   size = nelmts * elmt_size;
+    size_t   done;
+
+    if (!fill || elmt_size == 1) {
+        memset(p, fill ? *(const uint8_t *)fill : 0, size);
+        return;
+    }
+    if (size == 0)
+        return;
+
+    /* Double the filled part until the buffer is full */
+    memcpy(p, fill, elmt_size);
+    for (done = elmt_size; done < size; done *= 2)
+        memcpy(p + done, p, done < size - done ? done : size - done);
+}
+
+/*------------------------------------------------------------
+ * Copy a block assembled in cache to the dense buffer with
+ * non-temporal stores, which do not read the destination lines
+ * into the cache and do not evict the data of the caller
+ *------------------------------------------------------------
+ */
+static inline void sc_stream_copy(void *dst, const void *src, size_t size)
+{
+#ifdef __SSE2__
+    uint8_t       *d    = (uint8_t *)dst;
+    const uint8_t *s    = (const uint8_t *)src;
+    size_t         head = (16 - ((uintptr_t)d & 15)) & 15;
+
+    if (head > size)
+        head = size;
+    memcpy(d, s, head);
+    d += head;
+    s += head;
+    size -= head;
+    for (; size >= 64; size -= 64, d += 64, s += 64) {
+        __m128i a = _mm_loadu_si128((const __m128i *)s);
+        __m128i b = _mm_loadu_si128((const __m128i *)(s + 16));
+        __m128i c = _mm_loadu_si128((const __m128i *)(s + 32));
+        __m128i e = _mm_loadu_si128((const __m128i *)(s + 48));
+
+        _mm_stream_si128((__m128i *)d, a);
+        _mm_stream_si128((__m128i *)(d + 16), b);
+        _mm_stream_si128((__m128i *)(d + 32), c);
+        _mm_stream_si128((__m128i *)(d + 48), e);
+    }
+    for (; size >= 16; size -= 16, d += 16, s += 16)
+        _mm_stream_si128((__m128i *)d, _mm_loadu_si128((const __m128i *)s));
+    memcpy(d, s, size);
+#else
+    memcpy(dst, src, size);
+#endif
+}
+
+/*------------------------------------------------------------
+ * Expand the packed Data section into a dense chunk of
+ * "nelmts" elements: the undefined elements get the fill value
+ * (zero if NULL).  The runs must be in increasing order of
+ * their start, as produced by sc_mask_to_runs.
+ *
+ * Without "streaming" the gaps between the runs are filled and
+ * the runs copied in place.  With "streaming" the chunk is
+ * assembled in blocks of SC_STREAM_BLOCK bytes in cache and
+ * every block is stored once with non-temporal stores, so each
+ * line of the chunk is written without being read first.
+ *------------------------------------------------------------
+ */
+static inline void sc_fill_scatter_runs(const void *packed, size_t elmt_size, size_t nruns, const sc_run_t *runs,
+                                        const void *fill, uint64_t nelmts, int streaming, void *dense)
+{
+    const uint8_t *src = (const uint8_t *)packed;
+    uint8_t       *dst = (uint8_t *)dense;
+    uint8_t        block[SC_STREAM_BLOCK], pattern[SC_STREAM_BLOCK];
+    uint64_t       block_nelmts = SC_STREAM_BLOCK / elmt_size;
+    uint64_t       first, count, end, pos = 0;
+    size_t         n;
+
+    if (!streaming || block_nelmts == 0) {
+        for (n = 0; n < nruns; n++) {
+            sc_fill_elements(dst + pos * elmt_size, runs[n].start - pos, elmt_size, fill);
+            memcpy(dst + runs[n].start * elmt_size, src, runs[n].len * elmt_size);
+            src += runs[n].len * elmt_size;
+            pos = runs[n].start + runs[n].len;
+        }
+        sc_fill_elements(dst + pos * elmt_size, nelmts - pos, elmt_size, fill);
+        return;
+    }
+
+    sc_fill_elements(pattern, block_nelmts, elmt_size, fill);
+
+    /* "pos" is the next element of run n to copy */
+    n = 0;
+    if (nruns > 0)
+        pos = runs[0].start;
+    for (first = 0; first < nelmts; first += count) {
+        count = nelmts - first < block_nelmts ? nelmts - first : block_nelmts;
+        memcpy(block, pattern, count * elmt_size);
+
+        /* Copy the parts of the runs in the block */
+        while (n < nruns && pos < first + count) {
+            end = runs[n].start + runs[n].len;
+            if (end > first + count)
+                end = first + count;
+            memcpy(block + (pos - first) * elmt_size, src, (end - pos) * elmt_size);
+            src += (end - pos) * elmt_size;
+            pos = end;
+            if (pos == runs[n].start + runs[n].len && ++n < nruns)
+                pos = runs[n].start;
+        }
+
+        sc_stream_copy(dst + first * elmt_size, block, count * elmt_size);
+    }
+#ifdef __SSE2__
+    /* Order the non-temporal stores before the stores that follow */
+    _mm_sfence();
+#endif
+}
+
+/*------------------------------------------------------------
+ * Size of the used part of the stored chunk
+ *------------------------------------------------------------
+ */
+static inline size_t sc_image_size(const sc_chunk_info_t *info)
+{
+    size_t   size = SC_PREFIX_SIZE;
+    unsigned i;
+
+    for (i = 0; i < info->num_sections; i++)
+        size += info->section_size[i];
+    return size;
+}
+
+/*------------------------------------------------------------
+ * Assemble the stored chunk from the sections: applies the
+ * section pipelines, adds the checksums and the prefix.  Sets
+ * the section sizes and filter masks in "info".  The image
+ * is allocated with "capacity" bytes (at least the used size)
+ * and has to be freed by the caller.
+ *------------------------------------------------------------
+ */
+static inline int sc_assemble_chunk(sc_chunk_info_t *info, const void *buf[], size_t capacity, uint8_t **image, size_t *image_size)
+{
+    uint8_t *sections[SC_MAX_SECTIONS] = {NULL};
+    uint8_t *p;
+    size_t   used;
+    unsigned i;
+
+    if (info->num_sections > SC_MAX_SECTIONS)
+        goto error;
+
+    /* Apply the filters; a filter that does not reduce the size is skipped as an optional filter */
+    for (i = 0; i < info->num_sections; i++) {
+        info->filter_mask[i]  = 0;
+        info->section_size[i] = info->section_orig_size[i];
+
+        if ((info->pipeline[i] & SC_PIPELINE_DEFLATE) && info->section_orig_size[i] > 0) {
+            uLongf comp_size = compressBound((uLong)info->section_orig_size[i]);
+
+            if (NULL == (sections[i] = (uint8_t *)malloc(comp_size)))
+                goto error;
+            if (compress2(sections[i], &comp_size, (const Bytef *)buf[i], (uLong)info->section_orig_size[i],
+                          SC_DEFLATE_LEVEL) == Z_OK &&
+                comp_size < info->section_orig_size[i])
+                info->section_size[i] = comp_size;
+            else {
+                free(sections[i]);
+                sections[i]          = NULL;
+                info->filter_mask[i] = 0x1;
+            }
+        }
+        else if (info->pipeline[i] != SC_PIPELINE_NONE)
+            info->filter_mask[i] = 0x1;
+
+        if (sc_section_has_checksum(info->type, i))
+            info->section_size[i] += SC_CHECKSUM_SIZE;
+    }
+
+    used = sc_image_size(info);
+    if (capacity < used)
+        capacity = used;
+    if (NULL == (*image = (uint8_t *)calloc(1, capacity)))
+        goto error;
+    *image_size = capacity;
+
+    /* Prefix with the metadata the proposed format keeps in the chunk index record */
+    p = *image;
+    memcpy(p, SC_MAGIC, 4);
+    p += 4;
+    *p++ = SC_VERSION;
+    *p++ = (uint8_t)info->type;
+    *p++ = (uint8_t)info->num_sections;
+    *p++ = 0;
+    sc_encode64(&p, info->nelemts);
+    for (i = 0; i < SC_MAX_SECTIONS; i++) {
+        int in_use = i < info->num_sections;
+
+        sc_encode64(&p, in_use ? info->section_size[i] : 0);
+        sc_encode64(&p, in_use ? info->section_orig_size[i] : 0);
+        sc_encode32(&p, in_use ? info->filter_mask[i] : 0);
+        sc_encode32(&p, in_use ? info->pipeline[i] : 0);
+    }
+
+    /* Sections followed by their checksums */
+    for (i = 0; i < info->num_sections; i++) {
+        size_t data_size = info->section_size[i];
+
+        if (sc_section_has_checksum(info->type, i))
+            data_size -= SC_CHECKSUM_SIZE;
+        if (data_size > 0)
+            memcpy(p, sections[i] ? sections[i] : (const uint8_t *)buf[i], data_size);
+        if (sc_section_has_checksum(info->type, i)) {
+            uint32_t sum = (uint32_t)crc32(0L, p, (uInt)data_size);
+
+            p += data_size;
+            sc_encode32(&p, sum);
+        }
+        else
+            p += data_size;
+        free(sections[i]);
+        sections[i] = NULL;
+    }
+
+    return 0;
+
+error:
+    for (i = 0; i < SC_MAX_SECTIONS; i++)
+        free(sections[i]);
+    return -1;
+}
+
+/*------------------------------------------------------------
+ * Parse the SC_PREFIX_SIZE bytes of the prefix of a stored
+ * chunk into "info"
+ *------------------------------------------------------------
+ */
+static inline int sc_decode_prefix(const uint8_t *prefix, sc_chunk_info_t *info)
+{
+    const uint8_t *p = prefix;
+    unsigned       i;
+
+    if (memcmp(p, SC_MAGIC, 4) != 0 || p[4] != SC_VERSION)
+        return -1;
+    p += 5;
+    info->type         = *p++;
+    info->num_sections = *p++;
+    p++;
+    info->nelemts = sc_decode64(&p);
+    for (i = 0; i < SC_MAX_SECTIONS; i++) {
+        info->section_size[i]      = sc_decode64(&p);
+        info->section_orig_size[i] = sc_decode64(&p);
+        info->filter_mask[i]       = sc_decode32(&p);
+        info->pipeline[i]          = sc_decode32(&p);
+    }
+
+    return info->num_sections > SC_MAX_SECTIONS ? -1 : 0;
+}
+
+/*------------------------------------------------------------
+ * Verify the checksum of the stored section "i" at "p" and, if
+ * "buf" is not NULL, unfilter it into "buf" that must hold
+ * section_orig_size[i] bytes
+ *------------------------------------------------------------
+ */
+static inline int sc_decode_section(const sc_chunk_info_t *info, unsigned i, const uint8_t *p, void *buf)
+{
+    size_t data_size = info->section_size[i];
+
+    if (sc_section_has_checksum(info->type, i)) {
+        const uint8_t *q;
+
+        data_size -= SC_CHECKSUM_SIZE;
+        q = p + data_size;
+        if (sc_decode32(&q) != (uint32_t)crc32(0L, p, (uInt)data_size))
+            return -1;
+    }
+
+    if (buf) {
+        if ((info->pipeline[i] & SC_PIPELINE_DEFLATE) && !(info->filter_mask[i] & 0x1) && data_size > 0) {
+            uLongf orig_size = (uLongf)info->section_orig_size[i];
+
+            if (uncompress((Bytef *)buf, &orig_size, p, (uLong)data_size) != Z_OK ||
+                orig_size != info->section_orig_size[i])
+                return -1;
+        }
+        else if (data_size > 0)
+            memcpy(buf, p, data_size);
+    }
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Parse the prefix of a stored chunk into "info" and, if "buf"
+ * is not NULL, verify the checksums and unfilter the sections
+ * into the buffers buf[i] that are not NULL.  The buffers must
+ * hold section_orig_size[i] bytes.
+ *------------------------------------------------------------
+ */
+static inline int sc_disassemble_chunk(const uint8_t *image, size_t image_size, sc_chunk_info_t *info, void *buf[])
+{
+    const uint8_t *p = image + SC_PREFIX_SIZE;
+    unsigned       i;
+
+    if (image_size < SC_PREFIX_SIZE || sc_decode_prefix(image, info) < 0 || sc_image_size(info) > image_size)
+        goto error;
+
+    if (!buf)
+        return 0;
+
+    for (i = 0; i < info->num_sections; i++) {
+        if (sc_decode_section(info, i, p, buf[i]) < 0)
+            goto error;
+        p += info->section_size[i];
+    }
+
+    return 0;
+
+error:
+    return -1;
+}
+
+/*------------------------------------------------------------
+ * Set and get the chunk allocation policy on a data transfer
+ * property list
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_set_alloc_policy(hid_t dxpl_id, int policy, unsigned slack_percent)
+{
+    if (H5Pexist(dxpl_id, SC_ALLOC_PROP_NAME) <= 0) {
+        int      def_policy = SC_ALLOC_EXACT;
+        unsigned def_slack  = 0;
+
+        if (H5Pinsert2(dxpl_id, SC_ALLOC_PROP_NAME, sizeof(int), &def_policy, NULL, NULL, NULL, NULL, NULL, NULL) < 0)
+            return -1;
+        if (H5Pinsert2(dxpl_id, SC_SLACK_PROP_NAME, sizeof(unsigned), &def_slack, NULL, NULL, NULL, NULL, NULL, NULL) < 0)
+            return -1;
+    }
+    if (H5Pset(dxpl_id, SC_ALLOC_PROP_NAME, &policy) < 0)
+        return -1;
+    return H5Pset(dxpl_id, SC_SLACK_PROP_NAME, &slack_percent);
+}
+
+static inline void sc_get_alloc_policy(hid_t dxpl_id, int *policy, unsigned *slack_percent)
+{
+    *policy        = SC_ALLOC_EXACT;
+    *slack_percent = 0;
+    if (dxpl_id != H5P_DEFAULT && H5Pexist(dxpl_id, SC_ALLOC_PROP_NAME) > 0) {
+        H5Pget(dxpl_id, SC_ALLOC_PROP_NAME, policy);
+        H5Pget(dxpl_id, SC_SLACK_PROP_NAME, slack_percent);
+    }
+}
+
+/*------------------------------------------------------------
+ * Set and get the fill-initialized flag on a data transfer
+ * property list.  The flag tells sc_read_dense_chunk that the
+ * destination buffer already holds the fill value (e.g., it was
+ * allocated with calloc for a zero fill value), so only the
+ * defined elements are written.
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_set_fill_initialized(hid_t dxpl_id, int initialized)
+{
+    if (H5Pexist(dxpl_id, SC_FILL_INIT_PROP_NAME) <= 0) {
+        int def_initialized = 0;
+
+        if (H5Pinsert2(dxpl_id, SC_FILL_INIT_PROP_NAME, sizeof(int), &def_initialized, NULL, NULL, NULL, NULL, NULL,
+                       NULL) < 0)
+            return -1;
+    }
+    return H5Pset(dxpl_id, SC_FILL_INIT_PROP_NAME, &initialized);
+}
+
+static inline int sc_get_fill_initialized(hid_t dxpl_id)
+{
+    int initialized = 0;
+
+    if (dxpl_id != H5P_DEFAULT && H5Pexist(dxpl_id, SC_FILL_INIT_PROP_NAME) > 0)
+        H5Pget(dxpl_id, SC_FILL_INIT_PROP_NAME, &initialized);
+    return initialized;
+}
+
+/*------------------------------------------------------------
+ * Parse a data transform expression (H5Pset_data_transform)
+ * into "scale" * x + "offset".  The expression is a sum of
+ * terms of numbers, the variable (any name) and parentheses;
+ * expressions that are not linear in the variable, e.g. x*x,
+ * are not supported.
+ *------------------------------------------------------------
+ */
+static inline int sc_parse_linear_expr(const char **p, double *scale, double *offset);
+
+static inline void sc_skip_spaces(const char **p)
+{
+    while (**p == ' ' || **p == '\t')
+        (*p)++;
+}
+
+static inline int sc_parse_linear_factor(const char **p, double *scale, double *offset)
+{
+    char *end;
+
+    sc_skip_spaces(p);
+    if (**p == '-' || **p == '+') {
+        int neg = *(*p)++ == '-';
+
+        if (sc_parse_linear_factor(p, scale, offset) < 0)
+            return -1;
+        if (neg) {
+            *scale  = -*scale;
+            *offset = -*offset;
+        }
+        return 0;
+    }
+    if (**p == '(') {
+        (*p)++;
+        if (sc_parse_linear_expr(p, scale, offset) < 0)
+            return -1;
+        sc_skip_spaces(p);
+        if (**p != ')')
+            return -1;
+        (*p)++;
+        return 0;
+    }
+    if ((**p >= 'a' && **p <= 'z') || (**p >= 'A' && **p <= 'Z') || **p == '_') {
+        while ((**p >= 'a' && **p <= 'z') || (**p >= 'A' && **p <= 'Z') || (**p >= '0' && **p <= '9') ||
+               **p == '_')
+            (*p)++;
+        *scale  = 1;
+        *offset = 0;
+        return 0;
+    }
+
+    *scale  = 0;
+    *offset = strtod(*p, &end);
+    if (end == *p)
+        return -1;
+    *p = end;
+    return 0;
+}
+
+static inline int sc_parse_linear_term(const char **p, double *scale, double *offset)
+{
+    double a, b;
+    char   op;
+
+    if (sc_parse_linear_factor(p, scale, offset) < 0)
+        return -1;
+    for (;;) {
+        sc_skip_spaces(p);
+        if (**p != '*' && **p != '/')
+            return 0;
+        op = *(*p)++;
+        if (sc_parse_linear_factor(p, &a, &b) < 0)
+            return -1;
+        if (op == '*') {
+            if (*scale != 0 && a != 0)
+                return -1;
+            *scale  = *scale * b + a * *offset;
+            *offset = *offset * b;
+        }
+        else {
+            if (a != 0)
+                return -1;
+            *scale /= b;
+            *offset /= b;
+        }
+    }
+}
+
+static inline int sc_parse_linear_expr(const char **p, double *scale, double *offset)
+{
+    double a, b;
+    char   op;
+
+    if (sc_parse_linear_term(p, scale, offset) < 0)
+        return -1;
+    for (;;) {
+        sc_skip_spaces(p);
+        if (**p != '+' && **p != '-')
+            return 0;
+        op = *(*p)++;
+        if (sc_parse_linear_term(p, &a, &b) < 0)
+            return -1;
+        *scale += op == '+' ? a : -a;
+        *offset += op == '+' ? b : -b;
+    }
+}
+
+/*------------------------------------------------------------
+ * Get the data transform of a transfer property list as scale
+ * and offset; "has_transform" is 0 if there is none
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_get_transform(hid_t dxpl_id, int *has_transform, double *scale, double *offset)
+{
+    const char *p;
+    char       *expr;
+    ssize_t     len;
+    int         ret;
+
+    *has_transform = 0;
+    *scale         = 1;
+    *offset        = 0;
+    if (dxpl_id == H5P_DEFAULT)
+        return 0;
+    H5E_BEGIN_TRY {
+        len = H5Pget_data_transform(dxpl_id, NULL, 0);
+    } H5E_END_TRY;
+    if (len <= 0)
+        return 0;
+
+    if (NULL == (expr = (char *)malloc((size_t)len + 1)))
+        return -1;
+    H5Pget_data_transform(dxpl_id, expr, (size_t)len + 1);
+    p   = expr;
+    ret = sc_parse_linear_expr(&p, scale, offset);
+    sc_skip_spaces(&p);
+    if (*p != '\0')
+        ret = -1;
+    free(expr);
+
+    *has_transform = ret == 0;
+    return ret;
+}
+
+/*------------------------------------------------------------
+ * Apply scale * x + offset in place to "nelmts" values of a
+ * native floating-point type; the operations are done in the
+ * precision of the type, two doubles or four floats at a time
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_transform_values(void *buf, size_t nelmts, hid_t type_id, double scale, double offset)
+{
+    size_t i = 0;
+
+    if (H5Tequal(type_id, H5T_NATIVE_DOUBLE) > 0) {
+        double *v = (double *)buf;
+
+#ifdef __SSE2__
+        __m128d a = _mm_set1_pd(scale), b = _mm_set1_pd(offset);
+
+        for (; i + 2 <= nelmts; i += 2)
+            _mm_storeu_pd(v + i, _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(v + i), a), b));
+#endif
+        for (; i < nelmts; i++)
+            v[i] = v[i] * scale + offset;
+    }
+    else if (H5Tequal(type_id, H5T_NATIVE_FLOAT) > 0) {
+        float *v = (float *)buf;
+        float  fa = (float)scale, fb = (float)offset;
+
+#ifdef __SSE2__
+        __m128 a = _mm_set1_ps(fa), b = _mm_set1_ps(fb);
+
+        for (; i + 4 <= nelmts; i += 4)
+            _mm_storeu_ps(v + i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(v + i), a), b));
+#endif
+        for (; i < nelmts; i++)
+            v[i] = v[i] * fa + fb;
+    }
+    else
+        return -1;
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Convert "nelmts" packed values in place from "src_type_id" to
+ * "dst_type_id" and apply the data transform of the transfer
+ * property list.  "buf" must hold "nelmts" values of the larger
+ * of the two types.  Doubles are converted to floats with SSE2
+ * unless a conversion exception callback is set; the result is
+ * the same as the hard conversion of the library (overflows
+ * become infinities).  Other types are converted by H5Tconvert.
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_convert_values(hid_t src_type_id, hid_t dst_type_id, size_t nelmts, void *buf, hid_t dxpl_id)
+{
+    H5T_conv_except_func_t conv_cb = NULL;
+    void                  *cb_data;
+    double                 scale, offset;
+    int                    has_transform;
+
+    if (dxpl_id != H5P_DEFAULT)
+        H5Pget_type_conv_cb(dxpl_id, &conv_cb, &cb_data);
+
+    if (H5Tequal(src_type_id, dst_type_id) > 0)
+        ;
+    else if (!conv_cb && H5Tequal(src_type_id, H5T_NATIVE_DOUBLE) > 0 && H5Tequal(dst_type_id, H5T_NATIVE_FLOAT) > 0) {
+        const double *s = (const double *)buf;
+        float        *d = (float *)buf;
+        size_t        i = 0;
+
+        /* The floats are stored at or before the doubles that are still to be read */
+#ifdef __SSE2__
+        for (; i + 4 <= nelmts; i += 4) {
+            __m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(s + i));
+            __m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(s + i + 2));
+
+            _mm_storeu_ps(d + i, _mm_movelh_ps(lo, hi));
+        }
+#endif
+        for (; i < nelmts; i++)
+            d[i] = (float)s[i];
+    }
+    else if (H5Tconvert(src_type_id, dst_type_id, nelmts, buf, NULL, dxpl_id) < 0)
+        return -1;
+
+    if (sc_get_transform(dxpl_id, &has_transform, &scale, &offset) < 0)
+        return -1;
+    if (has_transform)
+        return sc_transform_values(buf, nelmts, dst_type_id, scale, offset);
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Round a size up to its size class.  There are four classes
+ * between consecutive powers of two, so that freed space of a
+ * class can be reused by chunks of the same class.
+ *------------------------------------------------------------
+ */
+static inline size_t sc_size_class(size_t size)
+{
+    size_t pow2 = SC_MIN_SIZE_CLASS;
+
+    if (size <= SC_MIN_SIZE_CLASS)
+        return SC_MIN_SIZE_CLASS;
+    while (pow2 * 2 < size)
+        pow2 *= 2;
+    return ((size - pow2 + pow2 / 4 - 1) / (pow2 / 4)) * (pow2 / 4) + pow2;
+}
+
+/*------------------------------------------------------------
+ * Stored size of a chunk with "used" bytes that currently
+ * occupies "old_size" bytes in the file (0 if not allocated)
+ *------------------------------------------------------------
+ */
+static inline size_t sc_chunk_capacity(int policy, unsigned slack_percent, size_t old_size, size_t used)
+{
+    if (policy == SC_ALLOC_EXACT)
+        return used;
+
+    /* Grow in place when the chunk still fits into its allocation */
+    if (used <= old_size)
+        return old_size;
+
+    return sc_size_class(used + used * slack_percent / 100);
+}
+
+/*------------------------------------------------------------
+ * Check if the file of an object is open for SWMR writing
+ *------------------------------------------------------------
+ */
+static inline int sc_is_swmr_write(hid_t obj_id)
+{
+    hid_t    file_id;
+    unsigned intent = 0;
+
+    if ((file_id = H5Iget_file_id(obj_id)) < 0)
+        return 0;
+    if (H5Fget_intent(file_id, &intent) < 0)
+        intent = 0;
+    H5Fclose(file_id);
+
+    return (intent & H5F_ACC_SWMR_WRITE) != 0;
+}
+
+/*------------------------------------------------------------
+ * Write a structured chunk (emulates H5Dwrite_struct_chunk).
+ * The image is written with one H5Dwrite_chunk and its index
+ * entry is updated after it, so a SWMR reader that finds the
+ * chunk in the index reads the selection and the data of the
+ * same write.  A chunk rewritten in place could be read while
+ * it is half written: when the file is open for SWMR writing,
+ * chunks are written once and with their exact size.
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_write_struct_chunk(hid_t dset_id, hid_t dxpl_id, sc_chunk_info_t *chunk_info, const hsize_t *offset,
+                                           const void *buf[])
+{
+    uint8_t *image = NULL;
+    size_t   image_size;
+    size_t   capacity;
+    hsize_t  old_size = 0;
+    unsigned slack_percent;
+    int      policy;
+
+    sc_get_alloc_policy(dxpl_id, &policy, &slack_percent);
+
+    if (sc_assemble_chunk(chunk_info, buf, 0, &image, &image_size) < 0)
+        goto error;
+
+    if (sc_is_swmr_write(dset_id)) {
+        herr_t status;
+
+        /* The size of a missing chunk is 0; the lookup fails until the first chunk is written */
+        H5E_BEGIN_TRY {
+            status = H5Dget_chunk_storage_size(dset_id, offset, &old_size);
+        } H5E_END_TRY;
+        if (status >= 0 && old_size > 0)
+            goto error;
+        old_size = 0;
+        policy   = SC_ALLOC_EXACT;
+    }
+    else if (policy != SC_ALLOC_EXACT) {
+        unsigned filter_mask;
+        haddr_t  addr;
+
+        if (H5Dget_chunk_info_by_coord(dset_id, offset, &filter_mask, &addr, &old_size) < 0)
+            goto error;
+    }
+
+    capacity = sc_chunk_capacity(policy, slack_percent, (size_t)old_size, image_size);
+    if (capacity > image_size) {
+        uint8_t *tmp;
+
+        if (NULL == (tmp = (uint8_t *)realloc(image, capacity)))
+            goto error;
+        image = tmp;
+        memset(image + image_size, 0, capacity - image_size);
+        image_size = capacity;
+    }
+
+    if (H5Dwrite_chunk(dset_id, dxpl_id, 0, offset, image_size, image) < 0)
+        goto error;
+
+    free(image);
+    return 0;
+
+error:
+    free(image);
+    return -1;
+}
+
+/*------------------------------------------------------------
+ * Read a structured chunk (emulates H5Dread_struct_chunk).
+ * "buf" may be NULL to retrieve the chunk information only.
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_read_struct_chunk(hid_t dset_id, hid_t dxpl_id, const hsize_t *offset, sc_chunk_info_t *chunk_info,
+                                          void *buf[])
+{
+    uint8_t *image = NULL;
+    hsize_t  image_size;
+    uint32_t filters;
+
+    if (H5Dget_chunk_storage_size(dset_id, offset, &image_size) < 0 || image_size == 0)
+        goto error;
+    if (NULL == (image = (uint8_t *)malloc(image_size)))
+        goto error;
+    if (H5Dread_chunk(dset_id, dxpl_id, offset, &filters, image) < 0)
+        goto error;
+    if (sc_disassemble_chunk(image, (size_t)image_size, chunk_info, buf) < 0)
+        goto error;
+
+    free(image);
+    return 0;
+
+error:
+    free(image);
+    return -1;
+}
+
+/*------------------------------------------------------------
+ * Read a structured chunk (emulates H5Dread_struct_chunk) with
+ * the values of the defined elements in the memory type: only
+ * the packed Data section is converted and transformed.  The
+ * buffer of the Data section must hold nelemts values of the
+ * larger of the dataset and memory types.
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_read_struct_chunk_mem(hid_t dset_id, hid_t mem_type_id, hid_t dxpl_id, const hsize_t *offset,
+                                              sc_chunk_info_t *chunk_info, void *buf[])
+{
+    hid_t  file_type;
+    size_t file_size;
+    herr_t ret_value = 0;
+
+    if (sc_read_struct_chunk(dset_id, dxpl_id, offset, chunk_info, buf) < 0)
+        return -1;
+    if (!buf || !buf[SC_SECTION_FIXED] || chunk_info->num_sections < 2)
+        return 0;
+
+    if ((file_type = H5Dget_type(dset_id)) < 0)
+        return -1;
+    file_size = H5Tget_size(file_type);
+    if (sc_convert_values(file_type, mem_type_id, chunk_info->section_orig_size[SC_SECTION_FIXED] / file_size,
+                          buf[SC_SECTION_FIXED], dxpl_id) < 0)
+        ret_value = -1;
+    H5Tclose(file_type);
+
+    return ret_value;
+}
+
+/*------------------------------------------------------------
+ * Read a structured chunk into a dense buffer of the whole chunk
+ * in the memory type (emulates H5Dread of one chunk of a sparse
+ * dataset).  Only the packed values of the defined elements are
+ * converted and transformed.  The undefined elements get the
+ * fill value in the memory type; if "fill" is NULL it is the
+ * fill value of the dataset, converted and transformed once.
+ * If the fill-initialized flag is set on the transfer property
+ * list, only the defined elements are written.  Chunks from
+ * SC_STREAM_MIN_SIZE bytes are filled with non-temporal stores.
+ * A chunk that is not stored has no defined elements.
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_read_dense_chunk(hid_t dset_id, hid_t mem_type_id, hid_t dxpl_id, const hsize_t *offset,
+                                         const void *fill, void *dense)
+{
+    sc_chunk_info_t info;
+    hid_t           dcpl = H5I_INVALID_HID, file_type = H5I_INVALID_HID;
+    hsize_t         chunk_dims[SC_MAX_RANK], dims[SC_MAX_RANK], image_size = 0;
+    uint64_t        nelmts = 1;
+    uint8_t        *image = NULL, *fill_buf = NULL;
+    void           *buf[SC_MAX_SECTIONS] = {NULL, NULL, NULL};
+    sc_run_t       *runs = NULL;
+    size_t          nruns = 0, n, elmt_size, file_size;
+    uint32_t        filters;
+    double          scale, fill_offset;
+    int             rank, i, has_transform, initialized = sc_get_fill_initialized(dxpl_id);
+
+    if ((dcpl = H5Dget_create_plist(dset_id)) < 0 || (rank = H5Pget_chunk(dcpl, SC_MAX_RANK, chunk_dims)) < 0)
+        goto error;
+    for (i = 0; i < rank; i++)
+        nelmts *= chunk_dims[i];
+    if ((file_type = H5Dget_type(dset_id)) < 0)
+        goto error;
+    elmt_size = H5Tget_size(mem_type_id);
+    file_size = H5Tget_size(file_type);
+
+    /* The fill value of the dataset is converted and transformed once */
+    if (!fill && !initialized) {
+        if (NULL == (fill_buf = (uint8_t *)calloc(1, elmt_size > sizeof(double) ? elmt_size : sizeof(double))))
+            goto error;
+        if (H5Pget_fill_value(dcpl, mem_type_id, fill_buf) < 0)
+            goto error;
+        if (sc_get_transform(dxpl_id, &has_transform, &scale, &fill_offset) < 0)
+            goto error;
+        if (has_transform && sc_transform_values(fill_buf, 1, mem_type_id, scale, fill_offset) < 0)
+            goto error;
+        fill = fill_buf;
+    }
+
+    H5E_BEGIN_TRY {
+        if (H5Dget_chunk_storage_size(dset_id, offset, &image_size) < 0)
+            image_size = 0;
+    } H5E_END_TRY;
+
+    if (image_size > 0) {
+        if (NULL == (image = (uint8_t *)malloc(image_size)))
+            goto error;
+        if (H5Dread_chunk(dset_id, dxpl_id, offset, &filters, image) < 0)
+            goto error;
+        if (sc_disassemble_chunk(image, (size_t)image_size, &info, NULL) < 0 || info.num_sections < 2)
+            goto error;
+        if (NULL == (buf[SC_SECTION_SELECTION] = malloc(info.section_orig_size[SC_SECTION_SELECTION] + 1)))
+            goto error;
+        if (NULL == (buf[SC_SECTION_FIXED] = malloc(info.nelemts * (elmt_size > file_size ? elmt_size : file_size) + 1)))
+            goto error;
+        if (sc_disassemble_chunk(image, (size_t)image_size, &info, buf) < 0)
+            goto error;
+        free(image);
+        image = NULL;
+
+        /* Only the packed values are converted */
+        if (sc_convert_values(file_type, mem_type_id, info.nelemts, buf[SC_SECTION_FIXED], dxpl_id) < 0)
+            goto error;
+
+        if (sc_decode_runs(buf[SC_SECTION_SELECTION], info.section_orig_size[SC_SECTION_SELECTION], &rank, dims,
+                           &nruns, NULL) < 0)
+            goto error;
+        if (NULL == (runs = (sc_run_t *)malloc((nruns ? nruns : 1) * sizeof(sc_run_t))))
+            goto error;
+        if (sc_decode_runs(buf[SC_SECTION_SELECTION], info.section_orig_size[SC_SECTION_SELECTION], &rank, dims,
+                           &nruns, runs) < 0)
+            goto error;
+    }
+
+    if (initialized)
+        sc_scatter_runs(buf[SC_SECTION_FIXED], elmt_size, nruns, runs, dense);
+    else {
+        /* Runs of a point selection may be in any order; they are scattered after the fill */
+        for (n = 1; n < nruns; n++)
+            if (runs[n].start < runs[n - 1].start + runs[n - 1].len)
+                break;
+        if (n < nruns) {
+            sc_fill_elements(dense, nelmts, elmt_size, fill);
+            sc_scatter_runs(buf[SC_SECTION_FIXED], elmt_size, nruns, runs, dense);
+        }
+        else
+            sc_fill_scatter_runs(buf[SC_SECTION_FIXED], elmt_size, nruns, runs, fill, nelmts,
+                                 nelmts * elmt_size >= SC_STREAM_MIN_SIZE, dense);
+    }
+
+    free(runs);
+    free(fill_buf);
+    for (i = 0; i < 2; i++)
+        free(buf[i]);
+    H5Tclose(file_type);
+    H5Pclose(dcpl);
+    return 0;
+
+error:
+    free(image);
+    free(runs);
+    free(fill_buf);
+    for (i = 0; i < 2; i++)
+        free(buf[i]);
+    if (file_type >= 0)
+        H5Tclose(file_type);
+    if (dcpl >= 0)
+        H5Pclose(dcpl);
+    return -1;
+}
+
+/*------------------------------------------------------------
+ * Get the locations of all stored chunks of a dataset in the
+ * logical (row-major) order of the chunks.  The array is
+ * allocated and has to be freed by the caller.
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_get_chunk_locations(hid_t dset_id, size_t *nchunks, sc_chunk_loc_t **locs)
+{
+    hid_t   dspace = H5I_INVALID_HID;
+    hid_t   dcpl   = H5I_INVALID_HID;
+    hsize_t dims[SC_MAX_RANK], chunk_dims[SC_MAX_RANK], grid[SC_MAX_RANK];
+    hsize_t scaled[SC_MAX_RANK];
+    hsize_t nstored, total = 1, n;
+    size_t  count = 0;
+    int     rank, i;
+
+    *locs    = NULL;
+    *nchunks = 0;
+
+    if ((dspace = H5Dget_space(dset_id)) < 0)
+        goto error;
+    if ((rank = H5Sget_simple_extent_dims(dspace, dims, NULL)) < 0 || rank > SC_MAX_RANK)
+        goto error;
+    if ((dcpl = H5Dget_create_plist(dset_id)) < 0)
+        goto error;
+    if (H5Pget_chunk(dcpl, rank, chunk_dims) != rank)
+        goto error;
+    if (H5Dget_num_chunks(dset_id, dspace, &nstored) < 0)
+        goto error;
+
+    for (i = 0; i < rank; i++) {
+        grid[i] = (dims[i] + chunk_dims[i] - 1) / chunk_dims[i];
+        total *= grid[i];
+    }
+
+    if (NULL == (*locs = (sc_chunk_loc_t *)calloc(nstored ? nstored : 1, sizeof(sc_chunk_loc_t))))
+        goto error;
+
+    /* Look up every chunk of the grid; the lookup is cheap for all chunk indexes */
+    memset(scaled, 0, sizeof(scaled));
+    for (n = 0; n < total && count < nstored; n++) {
+        sc_chunk_loc_t *loc = &(*locs)[count];
+        unsigned        filter_mask;
+
+        for (i = 0; i < rank; i++)
+            loc->offset[i] = scaled[i] * chunk_dims[i];
+        if (H5Dget_chunk_info_by_coord(dset_id, loc->offset, &filter_mask, &loc->addr, &loc->size) < 0)
+            goto error;
+        if (loc->addr != HADDR_UNDEF && loc->size > 0)
+            count++;
+
+        /* Next chunk in row-major order */
+        for (i = rank - 1; i >= 0; i--) {
+            if (++scaled[i] < grid[i])
+                break;
+            scaled[i] = 0;
+        }
+    }
+    *nchunks = count;
+
+    H5Pclose(dcpl);
+    H5Sclose(dspace);
+    return 0;
+
+error:
+    free(*locs);
+    *locs = NULL;
+    if (dcpl >= 0)
+        H5Pclose(dcpl);
+    if (dspace >= 0)
+        H5Sclose(dspace);
+    return -1;
+}
+
+/*------------------------------------------------------------
+ * Call "op" for each stored chunk of a dataset in the logical
+ * (row-major) order of the chunks.  Unlike
+ * sc_get_chunk_locations, no array of the chunks is built, so
+ * the memory does not grow with the number of chunks.  A
+ * nonzero return value of "op" stops the iteration and is
+ * returned.
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_iterate_chunks(hid_t dset_id, sc_chunk_op_t op, void *op_data)
+{
+    hid_t   dspace = H5I_INVALID_HID;
+    hid_t   dcpl   = H5I_INVALID_HID;
+    hsize_t dims[SC_MAX_RANK], chunk_dims[SC_MAX_RANK], grid[SC_MAX_RANK];
+    hsize_t scaled[SC_MAX_RANK], offset[SC_MAX_RANK];
+    hsize_t nstored, total = 1, count = 0, n;
+    herr_t  ret_value = -1;
+    int     rank, i;
+
+    if ((dspace = H5Dget_space(dset_id)) < 0)
+        goto done;
+    if ((rank = H5Sget_simple_extent_dims(dspace, dims, NULL)) < 0 || rank > SC_MAX_RANK)
+        goto done;
+    if ((dcpl = H5Dget_create_plist(dset_id)) < 0)
+        goto done;
+    if (H5Pget_chunk(dcpl, rank, chunk_dims) != rank)
+        goto done;
+    if (H5Dget_num_chunks(dset_id, dspace, &nstored) < 0)
+        goto done;
+
+    for (i = 0; i < rank; i++) {
+        grid[i] = (dims[i] + chunk_dims[i] - 1) / chunk_dims[i];
+        total *= grid[i];
+    }
+
+    /* The stored size is found with a lookup in the chunk index; it is 0 for a chunk that is not stored */
+    memset(scaled, 0, sizeof(scaled));
+    for (n = 0; n < total && count < nstored; n++) {
+        hsize_t size = 0;
+        herr_t  status;
+
+        for (i = 0; i < rank; i++)
+            offset[i] = scaled[i] * chunk_dims[i];
+        H5E_BEGIN_TRY {
+            status = H5Dget_chunk_storage_size(dset_id, offset, &size);
+        } H5E_END_TRY;
+        if (status >= 0 && size > 0) {
+            herr_t ret;
+
+            count++;
+            if ((ret = op(offset, size, op_data)) != 0) {
+                ret_value = ret;
+                goto done;
+            }
+        }
+
+        /* Next chunk in row-major order */
+        for (i = rank - 1; i >= 0; i--) {
+            if (++scaled[i] < grid[i])
+                break;
+            scaled[i] = 0;
+        }
+    }
+
+    ret_value = 0;
+
+done:
+    if (dcpl >= 0)
+        H5Pclose(dcpl);
+    if (dspace >= 0)
+        H5Sclose(dspace);
+    return ret_value;
+}
+
+/*------------------------------------------------------------
+ * Copy the stored chunks of one dataset to another dataset in
+ * the logical order of the chunks without decoding them.  The
+ * slack capacity of the chunks is dropped unless the allocation
+ * policy on "dxpl_id" asks to keep it.
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_copy_struct_chunks(hid_t src_dset_id, hid_t dst_dset_id, hid_t dxpl_id)
+{
+    sc_chunk_loc_t *locs  = NULL;
+    uint8_t        *image = NULL;
+    size_t          image_alloc = 0;
+    size_t          nchunks, n;
+    unsigned        slack_percent;
+    int             policy;
+
+    sc_get_alloc_policy(dxpl_id, &policy, &slack_percent);
+
+    if (sc_get_chunk_locations(src_dset_id, &nchunks, &locs) < 0)
+        goto error;
+
+    for (n = 0; n < nchunks; n++) {
+        sc_chunk_info_t info;
+        uint32_t        filters;
+        size_t          used, capacity;
+
+        if (locs[n].size > image_alloc) {
+            free(image);
+            image_alloc = (size_t)locs[n].size;
+            if (NULL == (image = (uint8_t *)malloc(image_alloc)))
+                goto error;
+        }
+        if (H5Dread_chunk(src_dset_id, H5P_DEFAULT, locs[n].offset, &filters, image) < 0)
+            goto error;
+        if (sc_disassemble_chunk(image, (size_t)locs[n].size, &info, NULL) < 0)
+            goto error;
+
+        used     = sc_image_size(&info);
+        capacity = sc_chunk_capacity(policy, slack_percent, 0, used);
+        if (capacity > image_alloc) {
+            uint8_t *tmp;
+
+            if (NULL == (tmp = (uint8_t *)realloc(image, capacity)))
+                goto error;
+            image       = tmp;
+            image_alloc = capacity;
+        }
+        if (capacity > used)
+            memset(image + used, 0, capacity - used);
+
+        if (H5Dwrite_chunk(dst_dset_id, dxpl_id, filters, locs[n].offset, capacity, image) < 0)
+            goto error;
+    }
+
+    free(image);
+    free(locs);
+    return 0;
+
+error:
+    free(image);
+    free(locs);
+    return -1;
+}
+
+/*------------------------------------------------------------
+ * Copy an attribute (callback for H5Aiterate2)
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_copy_attribute(hid_t loc_id, const char *name, const H5A_info_t *ainfo, void *op_data)
+{
+    hid_t  dst_id = *(hid_t *)op_data;
+    hid_t  attr, dst_attr, atype, aspace;
+    size_t size;
+    void  *buf;
+    herr_t ret = -1;
+
+    (void)ainfo;
+
+    attr   = H5Aopen(loc_id, name, H5P_DEFAULT);
+    atype  = H5Aget_type(attr);
+    aspace = H5Aget_space(attr);
+    size   = H5Tget_size(atype) * (size_t)H5Sget_simple_extent_npoints(aspace);
+    if (NULL != (buf = malloc(size ? size : 1))) {
+        if (H5Aread(attr, atype, buf) >= 0 &&
+            (dst_attr = H5Acreate2(dst_id, name, atype, aspace, H5P_DEFAULT, H5P_DEFAULT)) >= 0) {
+            ret = H5Awrite(dst_attr, atype, buf);
+            H5Aclose(dst_attr);
+        }
+        free(buf);
+    }
+    H5Sclose(aspace);
+    H5Tclose(atype);
+    H5Aclose(attr);
+
+    return ret;
+}
+
+/*------------------------------------------------------------
+ * Check whether the file of "loc_id" keeps its free space
+ * across sessions (H5F_FSPACE_STRATEGY_FSM_AGGR or PAGE with
+ * persistence); the strategy can only be chosen when the file
+ * is created.  Returns 1 if it does, 0 if not, -1 on error.
+ *------------------------------------------------------------
+ */
+static inline int sc_file_persists_free_space(hid_t loc_id)
+{
+    hid_t                 file, fcpl;
+    H5F_fspace_strategy_t strategy;
+    hbool_t               persist = 0;
+    hsize_t               threshold;
+    herr_t                status;
+
+    if ((file = H5Iget_file_id(loc_id)) < 0)
+        return -1;
+    if ((fcpl = H5Fget_create_plist(file)) < 0) {
+        H5Fclose(file);
+        return -1;
+    }
+    status = H5Pget_file_space_strategy(fcpl, &strategy, &persist, &threshold);
+    H5Pclose(fcpl);
+    H5Fclose(file);
+
+    return status < 0 ? -1 : persist ? 1 : 0;
+}
+
+/*------------------------------------------------------------
+ * Rewrite a structured chunk dataset in place: the chunks are
+ * copied in the logical order of the chunks, without their slack
+ * capacity, into a new dataset that replaces the original one.
+ * The library places each copy in the first free-space hole
+ * that fits it, so the copies are not contiguous and the file
+ * does not shrink; only a copy into a new file makes the chunks
+ * contiguous.  The file must keep its free space across
+ * sessions, otherwise the space of the original chunks,
+ * released when the dataset is deleted, would be lost when the
+ * file is closed.
+ *
+ * The compacted dataset is a new object at a new address: the
+ * link "name" is moved to it, but other hard links to the
+ * original and object references to it are not updated, and
+ * they keep the original and its space alive.  Readers in this
+ * process that keep the original open continue to read their
+ * snapshot, whose space is released when the last of them
+ * closes it; readers in other processes are not protected and
+ * must not have the file open.
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_compact_dataset(hid_t loc_id, const char *name, hid_t dxpl_id)
+{
+    hid_t  src = H5I_INVALID_HID, dst = H5I_INVALID_HID;
+    hid_t  dcpl = H5I_INVALID_HID, dtype = H5I_INVALID_HID, dspace = H5I_INVALID_HID;
+    char  *tmp_name = NULL;
+
+    if (sc_file_persists_free_space(loc_id) != 1)
+        return -1;
+    if (NULL == (tmp_name = (char *)malloc(strlen(name) + 16)))
+        goto error;
+    sprintf(tmp_name, "%s.compacting", name);
+
+    if ((src = H5Dopen2(loc_id, name, H5P_DEFAULT)) < 0)
+        goto error;
+    if ((dcpl = H5Dget_create_plist(src)) < 0 || (dtype = H5Dget_type(src)) < 0 || (dspace = H5Dget_space(src)) < 0)
+        goto error;
+    if ((dst = H5Dcreate2(loc_id, tmp_name, dtype, dspace, H5P_DEFAULT, dcpl, H5P_DEFAULT)) < 0)
+        goto error;
+
+    if (sc_copy_struct_chunks(src, dst, dxpl_id) < 0)
+        goto error;
+    if (H5Aiterate2(src, H5_INDEX_NAME, H5_ITER_INC, NULL, sc_copy_attribute, &dst) < 0)
+        goto error;
+    if (H5Dflush(dst) < 0)
+        goto error;
+
+    H5Dclose(dst);
+    dst = H5I_INVALID_HID;
+    H5Dclose(src);
+    src = H5I_INVALID_HID;
+
+    /* Replace the original dataset */
+    if (H5Ldelete(loc_id, name, H5P_DEFAULT) < 0)
+        goto error;
+    if (H5Lmove(loc_id, tmp_name, loc_id, name, H5P_DEFAULT, H5P_DEFAULT) < 0)
+        goto error;
+
+    H5Sclose(dspace);
+    H5Tclose(dtype);
+    H5Pclose(dcpl);
+    free(tmp_name);
+    return 0;
+
+error:
+    if (dst >= 0) {
+        H5Dclose(dst);
+        H5Ldelete(loc_id, tmp_name, H5P_DEFAULT);
+    }
+    if (src >= 0)
+        H5Dclose(src);
+    if (dspace >= 0)
+        H5Sclose(dspace);
+    if (dtype >= 0)
+        H5Tclose(dtype);
+    if (dcpl >= 0)
+        H5Pclose(dcpl);
+    free(tmp_name);
+    return -1;
+}
+
+/*------------------------------------------------------------
+ * Store the Encoded Selections of all chunks of the dataset
+ * "name" together in the contiguous dataset "name.selections"
+ * (the selection cluster), so that the defined elements of the
+ * whole dataset can be read in one sequential pass.  The
+ * cluster is a snapshot; it has to be built again after chunks
+ * of the dataset are rewritten.  Layout of the cluster:
+ *
+ *   Header: magic, version, rank, 2 reserved bytes, number of
+ *           chunks (8 bytes)
+ *   For each chunk in the logical order: offset of the chunk
+ *           (8 bytes per dimension), number of defined elements
+ *           (8), size of the Encoded Selection (8), the Encoded
+ *           Selection and its checksum (4)
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_build_selection_cluster(hid_t loc_id, const char *name)
+{
+    char           *cluster_name = NULL;
+    hid_t           dset = H5I_INVALID_HID, space = H5I_INVALID_HID, cluster = H5I_INVALID_HID;
+    hid_t           dcpl = H5I_INVALID_HID;
+    sc_chunk_loc_t *locs = NULL;
+    uint8_t        *image = NULL, *buf = NULL, *p;
+    size_t          nchunks = 0, c, max_size = 0, buf_size, used;
+    hsize_t         dims[1];
+    int             rank, i;
+    herr_t          ret_value = -1;
+
+    if (NULL == (cluster_name = (char *)malloc(strlen(name) + sizeof(SC_CLUSTER_SUFFIX))))
+        goto done;
+    sprintf(cluster_name, "%s%s", name, SC_CLUSTER_SUFFIX);
+
+    if ((dset = H5Dopen2(loc_id, name, H5P_DEFAULT)) < 0)
+        goto done;
+    if ((space = H5Dget_space(dset)) < 0 || (rank = H5Sget_simple_extent_ndims(space)) < 0)
+        goto done;
+    if (sc_get_chunk_locations(dset, &nchunks, &locs) < 0)
+        goto done;
+    for (c = 0; c < nchunks; c++)
+        if (locs[c].size > max_size)
+            max_size = (size_t)locs[c].size;
+    if (NULL == (image = (uint8_t *)malloc(max_size ? max_size : 1)))
+        goto done;
+
+    buf_size = SC_CLUSTER_HEADER_SIZE + nchunks * (16 + 8 * (size_t)rank + SC_CHECKSUM_SIZE) + max_size;
+    if (NULL == (buf = (uint8_t *)malloc(buf_size)))
+        goto done;
+    p = buf;
+    memcpy(p, SC_CLUSTER_MAGIC, 4);
+    p += 4;
+    *p++ = SC_CLUSTER_VERSION;
+    *p++ = (uint8_t)rank;
+    *p++ = 0;
+    *p++ = 0;
+    sc_encode64(&p, (uint64_t)nchunks);
+
+    for (c = 0; c < nchunks; c++) {
+        sc_chunk_info_t info;
+        uint32_t        filters;
+        size_t          sel_size;
+        uint8_t        *sel;
+
+        if (H5Dread_chunk(dset, H5P_DEFAULT, locs[c].offset, &filters, image) < 0)
+            goto done;
+        if (sc_disassemble_chunk(image, (size_t)locs[c].size, &info, NULL) < 0)
+            goto done;
+        sel_size = (size_t)info.section_orig_size[SC_SECTION_SELECTION];
+
+        /* Make room for the entry and for the header of the next one */
+        used = (size_t)(p - buf);
+        if (used + 20 + 8 * (size_t)rank + sel_size + SC_CHECKSUM_SIZE > buf_size) {
+            uint8_t *tmp;
+
+            buf_size = 2 * buf_size + sel_size;
+            if (NULL == (tmp = (uint8_t *)realloc(buf, buf_size)))
+                goto done;
+            buf = tmp;
+            p   = buf + used;
+        }
+
+        for (i = 0; i < rank; i++)
+            sc_encode64(&p, locs[c].offset[i]);
+        sc_encode64(&p, info.nelemts);
+        sc_encode64(&p, (uint64_t)sel_size);
+        sel = p;
+        if (sc_decode_section(&info, SC_SECTION_SELECTION, image + SC_PREFIX_SIZE, sel) < 0)
+            goto done;
+        p += sel_size;
+        sc_encode32(&p, (uint32_t)crc32(0L, sel, (uInt)sel_size));
+    }
+
+    /* Replace the previous cluster */
+    if (H5Lexists(loc_id, cluster_name, H5P_DEFAULT) > 0 && H5Ldelete(loc_id, cluster_name, H5P_DEFAULT) < 0)
+        goto done;
+    dims[0] = (hsize_t)(p - buf);
+    H5Sclose(space);
+    if ((space = H5Screate_simple(1, dims, NULL)) < 0)
+        goto done;
+    if ((dcpl = H5Pcreate(H5P_DATASET_CREATE)) < 0 || H5Pset_layout(dcpl, H5D_CONTIGUOUS) < 0)
+        goto done;
+    if ((cluster = H5Dcreate2(loc_id, cluster_name, H5T_STD_U8LE, space, H5P_DEFAULT, dcpl, H5P_DEFAULT)) < 0)
+        goto done;
+    if (H5Dwrite(cluster, H5T_NATIVE_UCHAR, H5S_ALL, H5S_ALL, H5P_DEFAULT, buf) < 0)
+        goto done;
+
+    ret_value = 0;
+
+done:
+    if (cluster >= 0)
+        H5Dclose(cluster);
+    if (dcpl >= 0)
+        H5Pclose(dcpl);
+    if (space >= 0)
+        H5Sclose(space);
+    if (dset >= 0)
+        H5Dclose(dset);
+    free(buf);
+    free(image);
+    free(locs);
+    free(cluster_name);
+
+    return ret_value;
+}
+
+/*------------------------------------------------------------
+ * Decode an Encoded Selection into "runs" (grown as needed)
+ * and pass it to the callback of sc_get_defined
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_defined_chunk(const hsize_t *offset, const uint8_t *sel, size_t sel_size, sc_run_t **runs,
+                                      size_t *max_runs, sc_defined_op_t op, void *op_data)
+{
+    hsize_t dims[SC_MAX_RANK];
+    size_t  nruns;
+    int     rank;
+
+    if (sc_decode_runs(sel, sel_size, &rank, dims, &nruns, NULL) < 0)
+        return -1;
+    if (nruns > *max_runs) {
+        sc_run_t *tmp;
+
+        if (NULL == (tmp = (sc_run_t *)realloc(*runs, nruns * sizeof(sc_run_t))))
+            return -1;
+        *runs     = tmp;
+        *max_runs = nruns;
+    }
+    if (sc_decode_runs(sel, sel_size, &rank, dims, &nruns, *runs) < 0)
+        return -1;
+
+    return op(offset, nruns, *runs, op_data);
+}
+
+/*------------------------------------------------------------
+ * Get the defined elements of the whole structured chunk
+ * dataset "name" (emulates H5Dget_defined with H5S_ALL): "op"
+ * is called with the runs of defined elements of each stored
+ * chunk in the logical order of the chunks.  With "use_cluster"
+ * the selection cluster is read if the dataset has one;
+ * otherwise the prefix and the Encoded Selection of every chunk
+ * are read, with one read per chunk for selections shorter
+ * than SC_SELECTION_READAHEAD bytes.
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_get_defined(hid_t loc_id, const char *name, int use_cluster, sc_defined_op_t op, void *op_data)
+{
+    char           *cluster_name = NULL;
+    hid_t           dset = H5I_INVALID_HID, space = H5I_INVALID_HID, file = H5I_INVALID_HID;
+    hid_t           fapl = H5I_INVALID_HID;
+    sc_chunk_loc_t *locs = NULL;
+    sc_run_t       *runs = NULL;
+    uint8_t        *buf = NULL, *sel = NULL;
+    size_t          max_runs = 0, nchunks, c;
+    herr_t          ret_value = -1;
+
+    if (NULL == (cluster_name = (char *)malloc(strlen(name) + sizeof(SC_CLUSTER_SUFFIX))))
+        goto done;
+    sprintf(cluster_name, "%s%s", name, SC_CLUSTER_SUFFIX);
+
+    if (use_cluster && H5Lexists(loc_id, cluster_name, H5P_DEFAULT) > 0) {
+        const uint8_t *p, *end;
+        hsize_t        size, offset[SC_MAX_RANK];
+        int            rank, i;
+
+        /* One sequential read of the cluster */
+        if ((dset = H5Dopen2(loc_id, cluster_name, H5P_DEFAULT)) < 0 || (space = H5Dget_space(dset)) < 0)
+            goto done;
+        size = (hsize_t)H5Sget_simple_extent_npoints(space);
+        if (size < SC_CLUSTER_HEADER_SIZE || NULL == (buf = (uint8_t *)malloc(size)))
+            goto done;
+        if (H5Dread(dset, H5T_NATIVE_UCHAR, H5S_ALL, H5S_ALL, H5P_DEFAULT, buf) < 0)
+            goto done;
+
+        p   = buf;
+        end = buf + size;
+        if (memcmp(p, SC_CLUSTER_MAGIC, 4) != 0 || p[4] != SC_CLUSTER_VERSION || (rank = p[5]) > SC_MAX_RANK)
+            goto done;
+        p += 8;
+        nchunks = (size_t)sc_decode64(&p);
+
+        for (c = 0; c < nchunks; c++) {
+            const uint8_t *q;
+            size_t         sel_size;
+
+            if ((size_t)(end - p) < 16 + 8 * (size_t)rank)
+                goto done;
+            for (i = 0; i < rank; i++)
+                offset[i] = sc_decode64(&p);
+            sc_decode64(&p);
+            sel_size = (size_t)sc_decode64(&p);
+            if ((size_t)(end - p) < sel_size + SC_CHECKSUM_SIZE)
+                goto done;
+            q = p + sel_size;
+            if (sc_decode32(&q) != (uint32_t)crc32(0L, p, (uInt)sel_size))
+                goto done;
+            if (sc_defined_chunk(offset, p, sel_size, &runs, &max_runs, op, op_data) < 0)
+                goto done;
+            p = q;
+        }
+    }
+    else {
+        int     *fdp = NULL;
+        size_t   buf_size = 0, sel_max = 0;
+
+        if ((dset = H5Dopen2(loc_id, name, H5P_DEFAULT)) < 0)
+            goto done;
+        if (sc_get_chunk_locations(dset, &nchunks, &locs) < 0)
+            goto done;
+
+        /* Read the sections at their addresses with the sec2 driver; other drivers read whole chunks */
+        if ((file = H5Iget_file_id(dset)) < 0 || (fapl = H5Fget_access_plist(file)) < 0)
+            goto done;
+        if (H5Pget_driver(fapl) == H5FD_SEC2 && H5Fget_vfd_handle(file, fapl, (void **)&fdp) < 0)
+            goto done;
+
+        for (c = 0; c < nchunks; c++) {
+            sc_chunk_info_t info;
+            size_t          need, have;
+
+            need = fdp ? SC_PREFIX_SIZE + SC_SELECTION_READAHEAD : (size_t)locs[c].size;
+            if (need > locs[c].size)
+                need = (size_t)locs[c].size;
+            if (buf_size < locs[c].size) {
+                free(buf);
+                buf_size = (size_t)locs[c].size;
+                if (NULL == (buf = (uint8_t *)malloc(buf_size)))
+                    goto done;
+            }
+
+            if (fdp) {
+                if (pread(*fdp, buf, need, (off_t)locs[c].addr) != (ssize_t)need)
+                    goto done;
+            }
+            else {
+                uint32_t filters;
+
+                if (H5Dread_chunk(dset, H5P_DEFAULT, locs[c].offset, &filters, buf) < 0)
+                    goto done;
+            }
+            have = need;
+
+            if (sc_decode_prefix(buf, &info) < 0)
+                goto done;
+            need = SC_PREFIX_SIZE + (size_t)info.section_size[SC_SECTION_SELECTION];
+            if (need > locs[c].size)
+                goto done;
+            if (need > have && pread(*fdp, buf + have, need - have, (off_t)(locs[c].addr + have)) != (ssize_t)(need - have))
+                goto done;
+
+            if (info.section_orig_size[SC_SECTION_SELECTION] > sel_max) {
+                free(sel);
+                sel_max = (size_t)info.section_orig_size[SC_SECTION_SELECTION];
+                if (NULL == (sel = (uint8_t *)malloc(sel_max)))
+                    goto done;
+            }
+            if (sc_decode_section(&info, SC_SECTION_SELECTION, buf + SC_PREFIX_SIZE, sel) < 0)
+                goto done;
+            if (sc_defined_chunk(locs[c].offset, sel, (size_t)info.section_orig_size[SC_SECTION_SELECTION], &runs,
+                                 &max_runs, op, op_data) < 0)
+                goto done;
+        }
+    }
+
+    ret_value = 0;
+
+done:
+    if (fapl >= 0)
+        H5Pclose(fapl);
+    if (file >= 0)
+        H5Fclose(file);
+    if (space >= 0)
+        H5Sclose(space);
+    if (dset >= 0)
+        H5Dclose(dset);
+    free(sel);
+    free(buf);
+    free(runs);
+    free(locs);
+    free(cluster_name);
+
+    return ret_value;
+}
+
+/*------------------------------------------------------------
+ * Create the contiguous dataset "name" of "size" bytes that
+ * holds the packed storage of a structured chunk dataset with
+ * the given dimensions and chunk dimensions.  The space is
+ * allocated at creation and never filled, so that processes
+ * can write the chunks at "addr" without the library.
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_create_packed(hid_t loc_id, const char *name, int rank, const hsize_t *dims,
+                                      const hsize_t *chunk_dims, hsize_t size, haddr_t *addr)
+{
+    hid_t   dset = H5I_INVALID_HID, space = H5I_INVALID_HID, dcpl = H5I_INVALID_HID;
+    hid_t   attr_space = H5I_INVALID_HID, attr = H5I_INVALID_HID;
+    hsize_t attr_dims[1];
+    herr_t  ret_value = -1;
+
+    if (size == 0)
+        size = 1;
+    if ((space = H5Screate_simple(1, &size, NULL)) < 0)
+        goto done;
+    if ((dcpl = H5Pcreate(H5P_DATASET_CREATE)) < 0 || H5Pset_layout(dcpl, H5D_CONTIGUOUS) < 0 ||
+        H5Pset_alloc_time(dcpl, H5D_ALLOC_TIME_EARLY) < 0 || H5Pset_fill_time(dcpl, H5D_FILL_TIME_NEVER) < 0)
+        goto done;
+    if ((dset = H5Dcreate2(loc_id, name, H5T_STD_U8LE, space, H5P_DEFAULT, dcpl, H5P_DEFAULT)) < 0)
+        goto done;
+    if ((*addr = H5Dget_offset(dset)) == HADDR_UNDEF)
+        goto done;
+
+    /* The logical dimensions of the dataset */
+    attr_dims[0] = (hsize_t)rank;
+    if ((attr_space = H5Screate_simple(1, attr_dims, NULL)) < 0)
+        goto done;
+    if ((attr = H5Acreate2(dset, SC_DIMS_ATTR, H5T_STD_U64LE, attr_space, H5P_DEFAULT, H5P_DEFAULT)) < 0 ||
+        H5Awrite(attr, H5T_NATIVE_HSIZE, dims) < 0 || H5Aclose(attr) < 0)
+        goto done;
+    if ((attr = H5Acreate2(dset, SC_CHUNK_DIMS_ATTR, H5T_STD_U64LE, attr_space, H5P_DEFAULT, H5P_DEFAULT)) < 0 ||
+        H5Awrite(attr, H5T_NATIVE_HSIZE, chunk_dims) < 0)
+        goto done;
+
+    ret_value = 0;
+
+done:
+    if (attr >= 0)
+        H5Aclose(attr);
+    if (attr_space >= 0)
+        H5Sclose(attr_space);
+    if (dset >= 0)
+        H5Dclose(dset);
+    if (dcpl >= 0)
+        H5Pclose(dcpl);
+    if (space >= 0)
+        H5Sclose(space);
+
+    return ret_value;
+}
+
+/*------------------------------------------------------------
+ * Write the index "name.index" of a packed storage: for each
+ * chunk, SC_INDEX_FIELDS values with the offset of the chunk,
+ * its address in the file and its size
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_write_packed_index(hid_t loc_id, const char *name, size_t nchunks, const sc_chunk_loc_t *locs)
+{
+    char     *index_name = NULL;
+    uint64_t *entries = NULL;
+    hid_t     dset = H5I_INVALID_HID, space = H5I_INVALID_HID;
+    hsize_t   dims[2];
+    size_t    c;
+    int       i;
+    herr_t    ret_value = -1;
+
+    if (NULL == (index_name = (char *)malloc(strlen(name) + sizeof(SC_INDEX_SUFFIX))))
+        goto done;
+    sprintf(index_name, "%s%s", name, SC_INDEX_SUFFIX);
+    if (NULL == (entries = (uint64_t *)malloc((nchunks ? nchunks : 1) * SC_INDEX_FIELDS * sizeof(uint64_t))))
+        goto done;
+    for (c = 0; c < nchunks; c++) {
+        for (i = 0; i < SC_MAX_RANK; i++)
+            entries[c * SC_INDEX_FIELDS + i] = locs[c].offset[i];
+        entries[c * SC_INDEX_FIELDS + SC_MAX_RANK]     = locs[c].addr;
+        entries[c * SC_INDEX_FIELDS + SC_MAX_RANK + 1] = locs[c].size;
+    }
+
+    dims[0] = (hsize_t)nchunks;
+    dims[1] = SC_INDEX_FIELDS;
+    if ((space = H5Screate_simple(2, dims, NULL)) < 0)
+        goto done;
+    if ((dset = H5Dcreate2(loc_id, index_name, H5T_STD_U64LE, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT)) < 0)
+        goto done;
+    if (nchunks > 0 && H5Dwrite(dset, H5T_NATIVE_UINT64, H5S_ALL, H5S_ALL, H5P_DEFAULT, entries) < 0)
+        goto done;
+
+    ret_value = 0;
+
+done:
+    if (dset >= 0)
+        H5Dclose(dset);
+    if (space >= 0)
+        H5Sclose(space);
+    free(entries);
+    free(index_name);
+
+    return ret_value;
+}
+
+/*------------------------------------------------------------
+ * Read the index of a packed storage.  The array is allocated
+ * and has to be freed by the caller.
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_read_packed_index(hid_t loc_id, const char *name, size_t *nchunks, sc_chunk_loc_t **locs)
+{
+    char     *index_name = NULL;
+    uint64_t *entries = NULL;
+    hid_t     dset = H5I_INVALID_HID, space = H5I_INVALID_HID;
+    hsize_t   dims[2];
+    size_t    c;
+    int       i;
+    herr_t    ret_value = -1;
+
+    *nchunks = 0;
+    *locs    = NULL;
+
+    if (NULL == (index_name = (char *)malloc(strlen(name) + sizeof(SC_INDEX_SUFFIX))))
+        goto done;
+    sprintf(index_name, "%s%s", name, SC_INDEX_SUFFIX);
+    if ((dset = H5Dopen2(loc_id, index_name, H5P_DEFAULT)) < 0 || (space = H5Dget_space(dset)) < 0)
+        goto done;
+    if (H5Sget_simple_extent_ndims(space) != 2 || H5Sget_simple_extent_dims(space, dims, NULL) < 0 ||
+        dims[1] != SC_INDEX_FIELDS)
+        goto done;
+
+    if (NULL == (entries = (uint64_t *)malloc((dims[0] ? dims[0] : 1) * SC_INDEX_FIELDS * sizeof(uint64_t))) ||
+        NULL == (*locs = (sc_chunk_loc_t *)calloc(dims[0] ? dims[0] : 1, sizeof(sc_chunk_loc_t))))
+        goto done;
+    if (dims[0] > 0 && H5Dread(dset, H5T_NATIVE_UINT64, H5S_ALL, H5S_ALL, H5P_DEFAULT, entries) < 0)
+        goto done;
+    for (c = 0; c < dims[0]; c++) {
+        for (i = 0; i < SC_MAX_RANK; i++)
+            (*locs)[c].offset[i] = entries[c * SC_INDEX_FIELDS + i];
+        (*locs)[c].addr = entries[c * SC_INDEX_FIELDS + SC_MAX_RANK];
+        (*locs)[c].size = entries[c * SC_INDEX_FIELDS + SC_MAX_RANK + 1];
+    }
+    *nchunks = (size_t)dims[0];
+
+    ret_value = 0;
+
+done:
+    if (ret_value < 0) {
+        free(*locs);
+        *locs = NULL;
+    }
+    if (dset >= 0)
+        H5Dclose(dset);
+    if (space >= 0)
+        H5Sclose(space);
+    free(entries);
+    free(index_name);
+
+    return ret_value;
+}
+
+/*------------------------------------------------------------
+ * Map a file for reading
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_mmap_open(const char *name, sc_mmap_t *map)
+{
+    struct stat sb;
+
+    map->base = NULL;
+    if ((map->fd = open(name, O_RDONLY)) < 0)
+        return -1;
+    if (fstat(map->fd, &sb) < 0 || sb.st_size == 0)
+        goto error;
+    map->size = (size_t)sb.st_size;
+    if (MAP_FAILED == (map->base = (uint8_t *)mmap(NULL, map->size, PROT_READ, MAP_SHARED, map->fd, 0))) {
+        map->base = NULL;
+        goto error;
+    }
+
+    return 0;
+
+error:
+    close(map->fd);
+    map->fd = -1;
+    return -1;
+}
+
+static inline void sc_mmap_close(sc_mmap_t *map)
+{
+    if (map->base)
+        munmap(map->base, map->size);
+    if (map->fd >= 0)
+        close(map->fd);
+    map->base = NULL;
+    map->fd   = -1;
+}
+
+/*------------------------------------------------------------
+ * Get zero-copy views of the sections of a structured chunk
+ * stored at "addr" in a mapped file.  Filtered sections get a
+ * NULL view and have to be read with sc_read_struct_chunk.
+ * The checksums are verified when "verify" is set.
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_mmap_struct_chunk(const sc_mmap_t *map, haddr_t addr, hsize_t size, int verify,
+                                          sc_chunk_info_t *chunk_info, sc_view_t views[])
+{
+    const uint8_t *p;
+    unsigned       i;
+
+    if (addr == HADDR_UNDEF || addr + size > map->size)
+        return -1;
+    if (sc_disassemble_chunk(map->base + addr, (size_t)size, chunk_info, NULL) < 0)
+        return -1;
+
+    p = map->base + addr + SC_PREFIX_SIZE;
+    for (i = 0; i < chunk_info->num_sections; i++) {
+        size_t data_size = chunk_info->section_size[i];
+        int    filtered  = (chunk_info->pipeline[i] & SC_PIPELINE_DEFLATE) && !(chunk_info->filter_mask[i] & 0x1);
+
+        if (sc_section_has_checksum(chunk_info->type, i)) {
+            data_size -= SC_CHECKSUM_SIZE;
+            if (verify) {
+                const uint8_t *q = p + data_size;
+
+                if (sc_decode32(&q) != (uint32_t)crc32(0L, p, (uInt)data_size))
+                    return -1;
+            }
+        }
+        views[i].ptr  = filtered ? NULL : p;
+        views[i].size = filtered ? (size_t)chunk_info->section_orig_size[i] : data_size;
+        p += chunk_info->section_size[i];
+    }
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Read operation for a file descriptor (op_data points to it)
+ *------------------------------------------------------------
+ */
+static inline ssize_t sc_pread_op(void *op_data, void *buf, size_t size, uint64_t offset)
+{
+    return pread(*(int *)op_data, buf, size, (off_t)offset);
+}
+
+static inline int sc_cmp_io(const void *a, const void *b)
+{
+    haddr_t x = (*(const sc_io_t *const *)a)->addr;
+    haddr_t y = (*(const sc_io_t *const *)b)->addr;
+
+    return x < y ? -1 : x > y;
+}
+
+/*------------------------------------------------------------
+ * Perform the reads "reqs" with as few I/Os as possible: reads
+ * that are at most "max_gap" bytes apart in the file are merged
+ * into one read of the whole range, up to "max_io" bytes (0 for
+ * no limit), and the result is sliced back into the buffers of
+ * the requests.  The bytes in the gaps are read and discarded.
+ * With SC_NO_COALESCING every request is read alone.  Returns
+ * the number of I/Os and of bytes read.
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_read_coalesced(size_t nreqs, const sc_io_t reqs[], size_t max_gap, size_t max_io,
+                                       sc_read_op_t read_op, void *op_data, size_t *nios, uint64_t *nbytes)
+{
+    const sc_io_t **order = NULL;
+    uint8_t        *tmp   = NULL;
+    size_t          tmp_size = 0, i, j, k;
+    herr_t          ret_value = -1;
+
+    *nios   = 0;
+    *nbytes = 0;
+    if (nreqs == 0)
+        return 0;
+
+    if (NULL == (order = (const sc_io_t **)malloc(nreqs * sizeof(sc_io_t *))))
+        goto done;
+    for (i = 0; i < nreqs; i++)
+        order[i] = &reqs[i];
+    qsort(order, nreqs, sizeof(sc_io_t *), sc_cmp_io);
+
+    for (i = 0; i < nreqs; i = j) {
+        haddr_t start = order[i]->addr;
+        haddr_t end   = start + order[i]->size;
+        size_t  len;
+
+        /* Extend the I/O with the following requests while the gaps are small */
+        for (j = i + 1; j < nreqs && max_gap != SC_NO_COALESCING; j++) {
+            haddr_t next_end = order[j]->addr + order[j]->size;
+
+            if (order[j]->addr > end + max_gap)
+                break;
+            if (next_end < end)
+                next_end = end;
+            if (max_io > 0 && next_end - start > max_io)
+                break;
+            end = next_end;
+        }
+        len = (size_t)(end - start);
+
+        if (j == i + 1) {
+            /* A single request is read directly into its buffer */
+            if (read_op(op_data, order[i]->buf, len, start) != (ssize_t)len)
+                goto done;
+        }
+        else {
+            if (len > tmp_size) {
+                uint8_t *t;
+
+                if (NULL == (t = (uint8_t *)realloc(tmp, len)))
+                    goto done;
+                tmp      = t;
+                tmp_size = len;
+            }
+            if (read_op(op_data, tmp, len, start) != (ssize_t)len)
+                goto done;
+            for (k = i; k < j; k++)
+                memcpy(order[k]->buf, tmp + (order[k]->addr - start), order[k]->size);
+        }
+        (*nios)++;
+        *nbytes += len;
+    }
+
+    ret_value = 0;
+
+done:
+    free(tmp);
+    free(order);
+
+    return ret_value;
+}
+
+/*------------------------------------------------------------
+ * Compare two linear offsets (qsort callback)
+ *------------------------------------------------------------
+ */
+static inline int sc_cmp_offset(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+/*------------------------------------------------------------
+ * Find runs of defined elements from the sorted and distinct
+ * linear offsets of the defined elements of a chunk with
+ * "row_len" elements in the fastest changing dimension; runs
+ * never cross a row.  Returns the number of runs.
+ *------------------------------------------------------------
+ */
+static inline size_t sc_offsets_to_runs(const uint64_t *offsets, size_t n, uint64_t row_len, sc_run_t *runs)
+{
+    size_t nruns = 0;
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        if (nruns > 0 && offsets[i] == runs[nruns - 1].start + runs[nruns - 1].len && offsets[i] % row_len != 0)
+            runs[nruns - 1].len++;
+        else {
+            runs[nruns].start = offsets[i];
+            runs[nruns].len   = 1;
+            nruns++;
+        }
+    }
+
+    return nruns;
+}
+
+/*------------------------------------------------------------
+ * Bucket entries by chunk with a counting sort: "counts[t]"
+ * holds the entries of each of the "nchunks" chunks found by
+ * thread t and is turned into the position of the first
+ * entry of the thread in the chunk; "chunk_start" gets the
+ * first entry of each chunk and the end.  Returns the number
+ * of entries.
+ *------------------------------------------------------------
+ */
+static inline uint64_t sc_bucket_starts(int nthreads, uint64_t nchunks, uint64_t **counts, uint64_t *chunk_start)
+{
+    uint64_t pos = 0, c;
+    int      t;
+
+    for (c = 0; c < nchunks; c++) {
+        chunk_start[c] = pos;
+        for (t = 0; t < nthreads; t++) {
+            uint64_t n = counts[t][c];
+
+            counts[t][c] = pos;
+            pos += n;
+        }
+    }
+    chunk_start[nchunks] = pos;
+
+    return pos;
+}
+
+static inline int sc_cmp_sparse_entry(const void *a, const void *b)
+{
+    uint64_t x = ((const sc_sparse_entry_t *)a)->key;
+    uint64_t y = ((const sc_sparse_entry_t *)b)->key;
+
+    return x < y ? -1 : x > y;
+}
+
+/*------------------------------------------------------------
+ * Assemble the sparse chunk of doubles with the "n" entries
+ * bucketed into it; the values of duplicate entries are
+ * summed and the duplicates are added to "nduplicates".
+ * Entries that are sorted and distinct (CSR) are packed as
+ * they are; others are sorted, or scattered into the chunk
+ * and the mask scanned when they have more than
+ * 1/SC_APPEND_SORT_RATIO of its elements.  The entries may
+ * be reordered.  The image is allocated; NULL if n is 0.
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_assemble_sparse_chunk(int rank, const hsize_t *chunk_dims, unsigned pipeline,
+                                              sc_sparse_entry_t *entries, size_t n, sc_sparse_scratch_t *scratch,
+                                              long long int *nduplicates, uint8_t **image, size_t *image_size)
+{
+    sc_chunk_info_t info;
+    const void     *buf[2];
+    uint64_t        chunk_nelmts = 1;
+    size_t          nruns, m = 0, i;
+    int             d;
+
+    *image      = NULL;
+    *image_size = 0;
+    if (n == 0)
+        return 0;
+    for (d = 0; d < rank; d++)
+        chunk_nelmts *= chunk_dims[d];
+
+    if (n > scratch->max_n) {
+        free(scratch->offsets);
+        free(scratch->data);
+        free(scratch->runs);
+        free(scratch->sel);
+        scratch->max_n   = 0;
+        scratch->offsets = (uint64_t *)malloc(n * sizeof(uint64_t));
+        scratch->data    = (double *)malloc(n * sizeof(double));
+        scratch->runs    = (sc_run_t *)malloc(n * sizeof(sc_run_t));
+        scratch->sel     = (uint8_t *)malloc(sc_encode_runs(rank, chunk_dims, n, NULL, NULL));
+        if (!scratch->offsets || !scratch->data || !scratch->runs || !scratch->sel)
+            return -1;
+        scratch->max_n = n;
+    }
+
+    for (i = 1; i < n && entries[i - 1].key < entries[i].key; i++)
+        ;
+    if (i == n || n * SC_APPEND_SORT_RATIO < chunk_nelmts) {
+        if (i < n)
+            qsort(entries, n, sizeof(sc_sparse_entry_t), sc_cmp_sparse_entry);
+        for (i = 0; i < n; i++) {
+            if (m > 0 && scratch->offsets[m - 1] == entries[i].key) {
+                scratch->data[m - 1] += entries[i].value;
+                (*nduplicates)++;
+            }
+            else {
+                scratch->offsets[m] = entries[i].key;
+                scratch->data[m++]  = entries[i].value;
+            }
+        }
+        nruns = sc_offsets_to_runs(scratch->offsets, m, chunk_dims[rank - 1], scratch->runs);
+    }
+    else {
+        if (!scratch->dense) {
+            scratch->dense = (double *)calloc(chunk_nelmts, sizeof(double));
+            scratch->mask  = (uint8_t *)calloc(chunk_nelmts, 1);
+            if (!scratch->dense || !scratch->mask)
+                return -1;
+        }
+        for (i = 0; i < n; i++) {
+            if (scratch->mask[entries[i].key])
+                (*nduplicates)++;
+            else
+                m++;
+            scratch->mask[entries[i].key] = 1;
+            scratch->dense[entries[i].key] += entries[i].value;
+        }
+        nruns = sc_mask_to_runs(scratch->mask, chunk_nelmts, chunk_dims[rank - 1], scratch->runs);
+        sc_gather_runs(scratch->dense, sizeof(double), nruns, scratch->runs, scratch->data);
+
+        /* Only the elements with entries are cleared */
+        for (i = 0; i < n; i++) {
+            scratch->mask[entries[i].key]  = 0;
+            scratch->dense[entries[i].key] = 0;
+        }
+    }
+
+    memset(&info, 0, sizeof(info));
+    info.type                                    = SC_SPARSE_CHUNK;
+    info.num_sections                            = 2;
+    info.nelemts                                 = m;
+    info.pipeline[SC_SECTION_FIXED]              = pipeline;
+    info.section_orig_size[SC_SECTION_SELECTION] = sc_encode_runs(rank, chunk_dims, nruns, scratch->runs, scratch->sel);
+    info.section_orig_size[SC_SECTION_FIXED]     = m * sizeof(double);
+    buf[SC_SECTION_SELECTION]                    = scratch->sel;
+    buf[SC_SECTION_FIXED]                        = scratch->data;
+    if (sc_assemble_chunk(&info, buf, 0, image, image_size) < 0) {
+        *image = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Free the buffers of sc_assemble_sparse_chunk */
+static inline void sc_free_sparse_scratch(sc_sparse_scratch_t *scratch)
+{
+    free(scratch->offsets);
+    free(scratch->data);
+    free(scratch->runs);
+    free(scratch->sel);
+    free(scratch->dense);
+    free(scratch->mask);
+    memset(scratch, 0, sizeof(*scratch));
+}
+
+/*------------------------------------------------------------
+ * Create the dataset "name.frames" that publishes the frames
+ * of the appended dataset "name" to SWMR readers: its extent
+ * is the number of frames whose chunks are in the file.  The
+ * extent of "name" cannot be used because it has to cover a
+ * time slab before its chunks are written.  Objects cannot be
+ * created in SWMR mode, so this is called before
+ * H5Fstart_swmr_write.
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_create_frames(hid_t loc_id, const char *name)
+{
+    char   *frames_name = NULL;
+    hid_t   dset = H5I_INVALID_HID, space = H5I_INVALID_HID, dcpl = H5I_INVALID_HID;
+    hsize_t dims[1] = {0}, maxdims[1] = {H5S_UNLIMITED}, chunk_dims[1] = {1};
+    herr_t  ret_value = -1;
+
+    if (NULL == (frames_name = (char *)malloc(strlen(name) + sizeof(SC_FRAMES_SUFFIX))))
+        goto done;
+    sprintf(frames_name, "%s%s", name, SC_FRAMES_SUFFIX);
+
+    if ((space = H5Screate_simple(1, dims, maxdims)) < 0)
+        goto done;
+    if ((dcpl = H5Pcreate(H5P_DATASET_CREATE)) < 0 || H5Pset_chunk(dcpl, 1, chunk_dims) < 0)
+        goto done;
+    if ((dset = H5Dcreate2(loc_id, frames_name, H5T_STD_U8LE, space, H5P_DEFAULT, dcpl, H5P_DEFAULT)) < 0)
+        goto done;
+
+    ret_value = 0;
+
+done:
+    if (dset >= 0)
+        H5Dclose(dset);
+    if (dcpl >= 0)
+        H5Pclose(dcpl);
+    if (space >= 0)
+        H5Sclose(space);
+    free(frames_name);
+
+    return ret_value;
+}
+
+/*------------------------------------------------------------
+ * Open the dataset "name.frames" of the dataset "dset_id";
+ * returns H5I_INVALID_HID if it does not exist
+ *------------------------------------------------------------
+ */
+static inline hid_t sc_open_frames(hid_t dset_id)
+{
+    char   *frames_name = NULL;
+    ssize_t len;
+    hid_t   file_id, frames_id = H5I_INVALID_HID;
+
+    if ((file_id = H5Iget_file_id(dset_id)) < 0)
+        return H5I_INVALID_HID;
+    if ((len = H5Iget_name(dset_id, NULL, 0)) <= 0)
+        goto done;
+    if (NULL == (frames_name = (char *)malloc((size_t)len + sizeof(SC_FRAMES_SUFFIX))))
+        goto done;
+    H5Iget_name(dset_id, frames_name, (size_t)len + 1);
+    strcat(frames_name, SC_FRAMES_SUFFIX);
+
+    if (H5Lexists(file_id, frames_name, H5P_DEFAULT) > 0)
+        frames_id = H5Dopen2(file_id, frames_name, H5P_DEFAULT);
+
+done:
+    free(frames_name);
+    H5Fclose(file_id);
+
+    return frames_id;
+}
+
+/*------------------------------------------------------------
+ * Get the number of frames published by a SWMR writer.  The
+ * frames are refreshed before the dataset, so the chunk index
+ * of the dataset is at least as recent as the frames and all
+ * chunks of the frames are found.
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_refresh_frames(hid_t dset_id, hid_t frames_id, hsize_t *nframes)
+{
+    hid_t space;
+
+    if (H5Drefresh(frames_id) < 0)
+        return -1;
+    if ((space = H5Dget_space(frames_id)) < 0)
+        return -1;
+    if (H5Sget_simple_extent_dims(space, nframes, NULL) < 0) {
+        H5Sclose(space);
+        return -1;
+    }
+    H5Sclose(space);
+
+    return H5Drefresh(dset_id);
+}
+
+/*------------------------------------------------------------
+ * Publish the frames appended so far to SWMR readers.  The
+ * chunks and their index entries are flushed before the
+ * extent of "name.frames" is, so a reader never sees a frame
+ * whose chunks have not landed.
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_append_publish(sc_append_t *app)
+{
+    if (app->frames_id < 0 || app->published == app->nframes)
+        return 0;
+
+    if (H5Dflush(app->dset_id) < 0)
+        return -1;
+    if (H5Dset_extent(app->frames_id, &app->nframes) < 0 || H5Dflush(app->frames_id) < 0)
+        return -1;
+    app->published = app->nframes;
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Start appending hits to the chunked dataset "dset_id" with
+ * an unlimited first (time) dimension.  The hits of the open
+ * time slab are kept in memory; "extend_slabs" time slabs are
+ * added each time the dataset is extended.  Appending to an
+ * existing dataset starts at the next time slab.  If the file
+ * is open for SWMR writing and the dataset has "name.frames",
+ * the frames are published each time a time slab is sealed.
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_append_open(hid_t dset_id, hid_t dxpl_id, size_t elmt_size, unsigned pipeline,
+                                    hsize_t extend_slabs, sc_append_t *app)
+{
+    hid_t   space = H5I_INVALID_HID, dcpl = H5I_INVALID_HID;
+    hsize_t maxdims[SC_MAX_RANK];
+    hsize_t chunk_nelmts = 1;
+    int     i;
+
+    memset(app, 0, sizeof(*app));
+    app->frames_id    = H5I_INVALID_HID;
+    app->dset_id      = dset_id;
+    app->dxpl_id      = dxpl_id;
+    app->elmt_size    = elmt_size;
+    app->pipeline     = pipeline;
+    app->extend_slabs = extend_slabs ? extend_slabs : 1;
+
+    if ((space = H5Dget_space(dset_id)) < 0)
+        goto error;
+    if ((app->rank = H5Sget_simple_extent_ndims(space)) < 1 || app->rank > SC_MAX_RANK)
+        goto error;
+    if (H5Sget_simple_extent_dims(space, app->dims, maxdims) < 0 || maxdims[0] != H5S_UNLIMITED)
+        goto error;
+    if ((dcpl = H5Dget_create_plist(dset_id)) < 0 || H5Pget_chunk(dcpl, app->rank, app->chunk_dims) < 0)
+        goto error;
+
+    app->nspatial = 1;
+    for (i = 0; i < app->rank; i++) {
+        chunk_nelmts *= app->chunk_dims[i];
+        if (i > 0) {
+            app->grid[i] = (app->dims[i] + app->chunk_dims[i] - 1) / app->chunk_dims[i];
+            app->nspatial *= (size_t)app->grid[i];
+        }
+    }
+    app->nframes = app->dims[0];
+
+    /* The extent may run ahead of the frames if the appender was not closed */
+    app->swmr = sc_is_swmr_write(dset_id);
+    if ((app->frames_id = sc_open_frames(dset_id)) >= 0) {
+        hid_t frames_space;
+
+        if ((frames_space = H5Dget_space(app->frames_id)) < 0)
+            goto error;
+        H5Sget_simple_extent_dims(frames_space, &app->nframes, NULL);
+        H5Sclose(frames_space);
+    }
+    app->published = app->nframes;
+    app->slab      = (app->nframes + app->chunk_dims[0] - 1) / app->chunk_dims[0];
+
+    if (NULL == (app->open = (sc_open_chunk_t *)calloc(app->nspatial, sizeof(sc_open_chunk_t))))
+        goto error;
+    if (NULL == (app->mask = (uint8_t *)calloc((size_t)chunk_nelmts, 1)))
+        goto error;
+    if (NULL == (app->dense = (uint8_t *)malloc((size_t)chunk_nelmts * elmt_size)))
+        goto error;
+
+    H5Pclose(dcpl);
+    H5Sclose(space);
+    return 0;
+
+error:
+    free(app->open);
+    free(app->mask);
+    free(app->dense);
+    app->open = NULL;
+    app->mask = app->dense = NULL;
+    if (app->frames_id >= 0)
+        H5Dclose(app->frames_id);
+    app->frames_id = H5I_INVALID_HID;
+    if (dcpl >= 0)
+        H5Pclose(dcpl);
+    if (space >= 0)
+        H5Sclose(space);
+    return -1;
+}
+
+/*------------------------------------------------------------
+ * Seal the open time slab: encode the selection and the
+ * values of each chunk with hits and write the chunks.  The
+ * time dimension is extended ahead of the frames, so most
+ * slabs are sealed without H5Dset_extent.  In SWMR mode the
+ * frames are then published.
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_append_seal(sc_append_t *app)
+{
+    sc_chunk_info_t info;
+    hsize_t         offset[SC_MAX_RANK];
+    hsize_t         chunk_nelmts = 1;
+    hsize_t         slab_end = (app->slab + 1) * app->chunk_dims[0];
+    uint8_t        *sel = NULL, *data = NULL;
+    const void     *buf[2];
+    size_t          c, h, nruns, n;
+    int             i;
+
+    for (c = 0; c < app->nspatial; c++)
+        if (app->open[c].nhits > 0)
+            break;
+    if (c == app->nspatial)
+        return app->swmr ? sc_append_publish(app) : 0;
+
+    if (app->dims[0] < slab_end) {
+        app->dims[0] = slab_end + (app->extend_slabs - 1) * app->chunk_dims[0];
+        if (H5Dset_extent(app->dset_id, app->dims) < 0)
+            return -1;
+        app->nextends++;
+    }
+
+    for (i = 0; i < app->rank; i++)
+        chunk_nelmts *= app->chunk_dims[i];
+
+    for (; c < app->nspatial; c++) {
+        sc_open_chunk_t *chunk = &app->open[c];
+        uint64_t         nelemts = 0;
+        size_t           rem = c;
+
+        if (chunk->nhits == 0)
+            continue;
+
+        /* Scatter the hits into the dense chunk; a later hit of the same element replaces the value */
+        for (h = 0; h < chunk->nhits; h++) {
+            app->mask[chunk->offsets[h]] = 1;
+            memcpy(app->dense + chunk->offsets[h] * app->elmt_size, chunk->values + h * app->elmt_size,
+                   app->elmt_size);
+        }
+
+        if (chunk->nhits > app->max_runs) {
+            sc_run_t *tmp;
+
+            if (NULL == (tmp = (sc_run_t *)realloc(app->runs, chunk->nhits * sizeof(sc_run_t))))
+                goto error;
+            app->runs     = tmp;
+            app->max_runs = chunk->nhits;
+        }
+
+        /* A chunk with few hits is encoded from its sorted offsets instead of a scan of the whole mask */
+        if (chunk->nhits * SC_APPEND_SORT_RATIO < chunk_nelmts) {
+            size_t nunique = 0;
+
+            for (h = 0; h < chunk->nhits; h++)
+                if (app->mask[chunk->offsets[h]] == 1) {
+                    app->mask[chunk->offsets[h]] = 2;
+                    chunk->offsets[nunique++]    = chunk->offsets[h];
+                }
+            chunk->nhits = nunique;
+            qsort(chunk->offsets, nunique, sizeof(uint64_t), sc_cmp_offset);
+            nruns = sc_offsets_to_runs(chunk->offsets, nunique, app->chunk_dims[app->rank - 1], app->runs);
+        }
+        else
+            nruns = sc_mask_to_runs(app->mask, chunk_nelmts, app->chunk_dims[app->rank - 1], app->runs);
+        for (n = 0; n < nruns; n++)
+            nelemts += app->runs[n].len;
+
+        memset(&info, 0, sizeof(info));
+        info.type                                    = SC_SPARSE_CHUNK;
+        info.num_sections                            = 2;
+        info.nelemts                                 = nelemts;
+        info.pipeline[SC_SECTION_FIXED]              = app->pipeline;
+        info.section_orig_size[SC_SECTION_SELECTION] = sc_encode_runs(app->rank, app->chunk_dims, nruns, app->runs, NULL);
+        info.section_orig_size[SC_SECTION_FIXED]     = nelemts * app->elmt_size;
+
+        if (NULL == (sel = (uint8_t *)malloc(info.section_orig_size[SC_SECTION_SELECTION])))
+            goto error;
+        if (NULL == (data = (uint8_t *)malloc(nelemts * app->elmt_size)))
+            goto error;
+        sc_encode_runs(app->rank, app->chunk_dims, nruns, app->runs, sel);
+        sc_gather_runs(app->dense, app->elmt_size, nruns, app->runs, data);
+
+        offset[0] = app->slab * app->chunk_dims[0];
+        for (i = app->rank - 1; i > 0; i--) {
+            offset[i] = (rem % app->grid[i]) * app->chunk_dims[i];
+            rem /= app->grid[i];
+        }
+
+        buf[SC_SECTION_SELECTION] = sel;
+        buf[SC_SECTION_FIXED]     = data;
+        if (sc_write_struct_chunk(app->dset_id, app->dxpl_id, &info, offset, buf) < 0)
+            goto error;
+        free(sel);
+        free(data);
+        sel  = NULL;
+        data = NULL;
+
+        /* Only the elements with hits are cleared, so sealing a chunk does not touch the whole mask */
+        for (h = 0; h < chunk->nhits; h++)
+            app->mask[chunk->offsets[h]] = 0;
+        chunk->nhits = 0;
+        app->nsealed++;
+    }
+
+    return app->swmr ? sc_append_publish(app) : 0;
+
+error:
+    free(sel);
+    free(data);
+    return -1;
+}
+
+/*------------------------------------------------------------
+ * Append "nhits" hits with "rank" coordinates each in
+ * "coords" and their values in "values".  The time of the
+ * hits may not go back to a sealed time slab; a hit in a
+ * later time slab seals the open one.
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_append_hits(sc_append_t *app, size_t nhits, const hsize_t *coords, const void *values)
+{
+    const hsize_t *chunk_dims = app->chunk_dims;
+    size_t         h;
+    int            i;
+
+    for (h = 0; h < nhits; h++) {
+        const hsize_t   *coord  = coords + h * (size_t)app->rank;
+        hsize_t          slab   = coord[0] / chunk_dims[0];
+        uint64_t         offset = coord[0] % chunk_dims[0];
+        size_t           index  = 0;
+        sc_open_chunk_t *chunk;
+
+        if (slab < app->slab)
+            return -1;
+        if (slab > app->slab) {
+            if (sc_append_seal(app) < 0)
+                return -1;
+            app->slab = slab;
+        }
+
+        for (i = 1; i < app->rank; i++) {
+            if (coord[i] >= app->dims[i])
+                return -1;
+            index  = index * (size_t)app->grid[i] + (size_t)(coord[i] / chunk_dims[i]);
+            offset = offset * chunk_dims[i] + coord[i] % chunk_dims[i];
+        }
+
+        chunk = &app->open[index];
+        if (chunk->nhits == chunk->max_hits) {
+            size_t    max_hits = chunk->max_hits ? 2 * chunk->max_hits : 64;
+            uint64_t *offsets;
+            uint8_t  *vals;
+
+            if (NULL == (offsets = (uint64_t *)realloc(chunk->offsets, max_hits * sizeof(uint64_t))))
+                return -1;
+            chunk->offsets = offsets;
+            if (NULL == (vals = (uint8_t *)realloc(chunk->values, max_hits * app->elmt_size)))
+                return -1;
+            chunk->values   = vals;
+            chunk->max_hits = max_hits;
+        }
+        chunk->offsets[chunk->nhits] = offset;
+        memcpy(chunk->values + chunk->nhits * app->elmt_size, (const uint8_t *)values + h * app->elmt_size,
+               app->elmt_size);
+        chunk->nhits++;
+
+        if (coord[0] >= app->nframes)
+            app->nframes = coord[0] + 1;
+    }
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Seal the open time slab, set the time dimension to the
+ * frames with hits, publish them and free the appender
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_append_close(sc_append_t *app)
+{
+    herr_t ret_value = 0;
+    size_t c;
+
+    if (sc_append_seal(app) < 0)
+        ret_value = -1;
+
+    /* Drop the time slabs added ahead of the frames */
+    if (ret_value == 0 && app->dims[0] != app->nframes) {
+        app->dims[0] = app->nframes;
+        if (H5Dset_extent(app->dset_id, app->dims) < 0)
+            ret_value = -1;
+    }
+    if (ret_value == 0 && sc_append_publish(app) < 0)
+        ret_value = -1;
+    if (app->frames_id >= 0)
+        H5Dclose(app->frames_id);
+    app->frames_id = H5I_INVALID_HID;
+
+    for (c = 0; c < app->nspatial; c++) {
+        free(app->open[c].offsets);
+        free(app->open[c].values);
+    }
+    free(app->open);
+    free(app->mask);
+    free(app->dense);
+    free(app->runs);
+    app->open = NULL;
+    app->mask = app->dense = NULL;
+    app->runs = NULL;
+
+    return ret_value;
+}
+
+#ifdef SC_HAVE_URING
+/*------------------------------------------------------------
+ * Create an io_uring instance with "depth" submission queue
+ * entries and map its rings
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_uring_init(sc_uring_t *ring, unsigned depth)
+{
+    struct io_uring_params p;
+    uint8_t               *sq, *cq;
+
+    memset(ring, 0, sizeof(*ring));
+    memset(&p, 0, sizeof(p));
+    ring->sq_ring = ring->cq_ring = MAP_FAILED;
+    ring->sqes    = MAP_FAILED;
+    if ((ring->fd = (int)syscall(__NR_io_uring_setup, depth, &p)) < 0)
+        return -1;
+
+    ring->depth        = p.sq_entries;
+    ring->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_size    = p.sq_entries * sizeof(struct io_uring_sqe);
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                         IORING_OFF_SQ_RING);
+    ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                         IORING_OFF_CQ_RING);
+    ring->sqes    = (struct io_uring_sqe *)mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                                                MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED)
+        goto error;
+
+    sq             = (uint8_t *)ring->sq_ring;
+    cq             = (uint8_t *)ring->cq_ring;
+    ring->sq_head  = (unsigned *)(sq + p.sq_off.head);
+    ring->sq_tail  = (unsigned *)(sq + p.sq_off.tail);
+    ring->sq_mask  = (unsigned *)(sq + p.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + p.sq_off.array);
+    ring->cq_head  = (unsigned *)(cq + p.cq_off.head);
+    ring->cq_tail  = (unsigned *)(cq + p.cq_off.tail);
+    ring->cq_mask  = (unsigned *)(cq + p.cq_off.ring_mask);
+    ring->cqes     = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+    return 0;
+
+error:
+    if (ring->sq_ring != MAP_FAILED)
+        munmap(ring->sq_ring, ring->sq_ring_size);
+    if (ring->cq_ring != MAP_FAILED)
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    if (ring->sqes != MAP_FAILED)
+        munmap(ring->sqes, ring->sqes_size);
+    close(ring->fd);
+    ring->fd = -1;
+    return -1;
+}
+
+static inline void sc_uring_close(sc_uring_t *ring)
+{
+    if (ring->fd < 0)
+        return;
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    munmap(ring->cq_ring, ring->cq_ring_size);
+    munmap(ring->sqes, ring->sqes_size);
+    close(ring->fd);
+    ring->fd = -1;
+}
+
+/*------------------------------------------------------------
+ * Queue a read of "len" bytes at "offset" of "fd".  Returns -1
+ * if the submission queue is full.
+ *------------------------------------------------------------
+ */
+static inline int sc_uring_prep_read(sc_uring_t *ring, int fd, void *buf, size_t len, uint64_t offset, uint64_t user_data)
+{
+    unsigned             tail = *ring->sq_tail;
+    unsigned             idx;
+    struct io_uring_sqe *sqe;
+
+    if (tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= ring->depth)
+        return -1;
+
+    idx = tail & *ring->sq_mask;
+    sqe = &ring->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode    = IORING_OP_READ;
+    sqe->fd        = fd;
+    sqe->addr      = (uint64_t)(uintptr_t)buf;
+    sqe->len       = (uint32_t)len;
+    sqe->off       = offset;
+    sqe->user_data = user_data;
+
+    ring->sq_array[idx] = idx;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->to_submit++;
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Submit the queued reads with one system call and wait until
+ * at least "wait_nr" reads have completed
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_uring_submit(sc_uring_t *ring, unsigned wait_nr)
+{
+    long ret;
+
+    do {
+        ret = syscall(__NR_io_uring_enter, ring->fd, ring->to_submit, wait_nr,
+                      wait_nr ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    } while (ret < 0 && errno == EINTR);
+    if (ret < 0)
+        return -1;
+    ring->to_submit -= (unsigned)ret;
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Retrieve a completed read without blocking: returns 1 and
+ * its user data and result, or 0 if no read has completed
+ *------------------------------------------------------------
+ */
+static inline int sc_uring_peek(sc_uring_t *ring, uint64_t *user_data, int *res)
+{
+    unsigned             head = *ring->cq_head;
+    struct io_uring_cqe *cqe;
+
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+        return 0;
+
+    cqe        = &ring->cqes[head & *ring->cq_mask];
+    *user_data = cqe->user_data;
+    *res       = cqe->res;
+    __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+
+    return 1;
+}
+
+/*------------------------------------------------------------
+ * Read the stored chunks "locs" of an open file in one batch:
+ * up to the queue depth of the ring reads are outstanding at
+ * any time, and "op" is called for each chunk as soon as it has
+ * been read, while the remaining reads are in progress.  The
+ * chunks may complete in any order.  With "align" > 0 (files
+ * opened with O_DIRECT) reads are extended to multiples of
+ * "align" and the buffers are aligned.
+ *------------------------------------------------------------
+ */
+static inline herr_t sc_uring_read_chunks(sc_uring_t *ring, int fd, size_t align, size_t nchunks, const sc_chunk_loc_t *locs,
+                                          sc_uring_op_t op, void *op_data)
+{
+    size_t    *slot_chunk = NULL, *free_slots = NULL;
+    uint8_t  **slot_buf   = NULL;
+    size_t     nslots = ring->depth, nfree, next = 0, done = 0, inflight = 0, buf_size = 0, c, s;
+    herr_t     ret_value = -1;
+
+    if (align == 0)
+        align = 1;
+    for (c = 0; c < nchunks; c++)
+        if (locs[c].size > buf_size)
+            buf_size = locs[c].size;
+    buf_size = (buf_size + 2 * align - 1) / align * align;
+
+    slot_chunk = (size_t *)malloc(nslots * sizeof(size_t));
+    free_slots = (size_t *)malloc(nslots * sizeof(size_t));
+    slot_buf   = (uint8_t **)calloc(nslots, sizeof(uint8_t *));
+    if (!slot_chunk || !free_slots || !slot_buf)
+        goto done;
+    for (s = 0; s < nslots; s++) {
+        if (posix_memalign((void **)&slot_buf[s], align < 64 ? 64 : align, buf_size) != 0) {
+            slot_buf[s] = NULL;
+            goto done;
+        }
+        free_slots[s] = nslots - 1 - s;
+    }
+    nfree = nslots;
+
+    while (done < nchunks) {
+        uint64_t user_data;
+        int      res;
+
+        /* Keep the queue full */
+        while (next < nchunks && nfree > 0) {
+            uint64_t start = locs[next].addr / align * align;
+            uint64_t end   = (locs[next].addr + locs[next].size + align - 1) / align * align;
+
+            s = free_slots[--nfree];
+            slot_chunk[s] = next;
+            if (sc_uring_prep_read(ring, fd, slot_buf[s], (size_t)(end - start), start, (uint64_t)s) < 0) {
+                nfree++;
+                break;
+            }
+            next++;
+            inflight++;
+        }
+
+        /* Submit the new reads; block only if no read has completed yet */
+        if (sc_uring_submit(ring, 0) < 0)
+            goto done;
+        if (!sc_uring_peek(ring, &user_data, &res)) {
+            if (sc_uring_submit(ring, 1) < 0)
+                goto done;
+            if (!sc_uring_peek(ring, &user_data, &res))
+                continue;
+        }
+
+        /* Decode the completed chunks while the other reads are in progress */
+        do {
+            size_t  chunk = slot_chunk[(size_t)user_data];
+            uint8_t *buf  = slot_buf[(size_t)user_data];
+            size_t  skip  = (size_t)(locs[chunk].addr % align);
+            size_t  need  = skip + (size_t)locs[chunk].size;
+
+            inflight--;
+            if (res < 0) {
+                errno = -res;
+                goto done;
+            }
+
+            /* Complete a short read synchronously */
+            while ((size_t)res < need) {
+                ssize_t n = pread(fd, buf + res, buf_size - (size_t)res, (off_t)(locs[chunk].addr - skip + (size_t)res));
+
+                if (n <= 0)
+                    goto done;
+                res += (int)n;
+            }
+
+            if (op(chunk, buf + skip, (size_t)locs[chunk].size, op_data) < 0)
+                goto done;
+            free_slots[nfree++] = (size_t)user_data;
+            done++;
+        } while (sc_uring_peek(ring, &user_data, &res));
+    }
+
+    ret_value = 0;
+
+done:
+    /* Wait for outstanding reads before their buffers are freed */
+    while (inflight > 0) {
+        uint64_t user_data;
+        int      res;
+
+        if (sc_uring_peek(ring, &user_data, &res))
+            inflight--;
+        else if (sc_uring_submit(ring, 1) < 0)
+            break;
+    }
+    if (slot_buf)
+        for (s = 0; s < nslots; s++)
+            free(slot_buf[s]);
+    free(slot_buf);
+    free(slot_chunk);
+    free(free_slots);
+
+    return ret_value;
+}
+#endif /* SC_HAVE_URING */
+
+#endif /* STRUCTURED_CHUNK_H */
@@ -0,0 +1,224 @@
+#!/usr/bin/env python3
+"""
+Sweep driver for the sparse.c, vl.c and vl_uint.c benchmarks.
+
+The driver runs each benchmark over a grid of command line options, repeats every point of the grid,
+collects the JSON lines that the benchmarks append with their -j option and aggregates every numeric
+result into its median and a distribution-free confidence interval of the median (order statistics of
+the binomial distribution).  Sizes do not vary between repeats because the benchmarks seed the random
+generator with a constant; the timings do.
+
+A grid is given per benchmark as option letters with comma-separated values; all combinations are run:
+
+    --sparse "c=1x1,2x2 s=1,2,3 m=10"
+    --vl "n=1000,100000 m=10,100 d=0,1"
+    --vl_uint "n=1000,100000"
+
+A benchmark without a grid option is not run; "all" runs the default grid of every benchmark.  The runs
+take place in a scratch directory because the benchmarks create their HDF5 files in the current directory.
+
+Outputs:
+    -o FILE   all runs as JSON lines, each with the grid point ("params") and the repeat ("run")
+    -c FILE   the summary as CSV: benchmark, grid point, percent, metric, n, median, CI low, CI high
+    stdout    the summary table
+
+Example: compile the benchmarks with h5cc into this directory, then
+
+    ./sweep.py --sparse "c=1x1,4x4 s=1,2,3 m=5" --vl "n=1000,10000" -r 7 -o runs.jsonl -c summary.csv
+
+runs 6 sparse.c and 2 vl.c grid points 7 times each.
+"""
+
+import argparse
+import csv
+import itertools
+import json
+import math
+import os
+import shlex
+import subprocess
+import sys
+import tempfile
+
+BENCHMARKS = ("sparse", "vl", "vl_uint")
+
+DEFAULT_GRIDS = {
+    "sparse": "c=1x1 s=1,2,3 d=0,1 m=10",
+    "vl": "n=1000,10000 m=10,100 d=0,1",
+    "vl_uint": "n=1000,10000 m=10,100 d=0,1",
+}
+
+# Keys of a result line that identify it rather than measure something
+ID_KEYS = {"benchmark", "params", "run", "percent", "host", "hdf5", "date", "rev", "chunk_dim1", "chunk_dim2",
+           "space_select", "d", "max_len"}
+
+
+def parse_grid(spec):
+    """Parse "a=1,2 b=x" into [("-a", ["1", "2"]), ("-b", ["x"])]."""
+    grid = []
+    for token in shlex.split(spec):
+        opt, sep, values = token.partition("=")
+        if not sep or not opt or not values:
+            raise ValueError("grid '%s' must be options with values, e.g. s=1,2" % spec)
+        grid.append(("-" + opt.lstrip("-"), values.split(",")))
+    return grid
+
+
+def grid_points(spec):
+    """All combinations of a grid as lists of command line arguments."""
+    grid = parse_grid(spec)
+    for values in itertools.product(*[v for _, v in grid]):
+        args = []
+        for (opt, _), value in zip(grid, values):
+            args += [opt, value]
+        yield args
+
+
+def git_revision(path):
+    try:
+        return subprocess.run(["git", "-C", path, "rev-parse", "--short", "HEAD"], capture_output=True,
+                              text=True, check=True).stdout.strip()
+    except (OSError, subprocess.CalledProcessError):
+        return "unknown"
+
+
+def run_benchmark(binary, args, workdir, timeout=None):
+    """Run a benchmark once and return its JSON result lines."""
+    results = os.path.join(workdir, "results.jsonl")
+    if os.path.exists(results):
+        os.remove(results)
+    proc = subprocess.run([binary] + args + ["-j", results], cwd=workdir, stdout=subprocess.PIPE,
+                          stderr=subprocess.STDOUT, text=True, timeout=timeout)
+    if proc.returncode != 0 or not os.path.exists(results):
+        raise RuntimeError("%s %s failed:\n%s" % (binary, " ".join(args), proc.stdout))
+    with open(results) as f:
+        return [json.loads(line) for line in f if line.strip()]
+
+
+def run_sweep(bindir, grids, repeats, verbose=False, timeout=None):
+    """Run every grid point "repeats" times; returns the result lines of all runs."""
+    rev = git_revision(os.path.dirname(os.path.abspath(__file__)))
+    lines = []
+    with tempfile.TemporaryDirectory(prefix="sweep.") as workdir:
+        for name, spec in grids.items():
+            binary = os.path.abspath(os.path.join(bindir, name))
+            for args in grid_points(spec):
+                params = " ".join(args)
+                for run in range(repeats):
+                    if verbose:
+                        print("%s %s (run %d)" % (name, params, run + 1), file=sys.stderr)
+                    for line in run_benchmark(binary, args, workdir, timeout):
+                        line.update({"params": params, "run": run, "rev": rev})
+                        lines.append(line)
+    return lines
+
+
+def median(values):
+    v = sorted(values)
+    n = len(v)
+    return v[n // 2] if n % 2 else (v[n // 2 - 1] + v[n // 2]) / 2
+
+
+def median_ci(values, confidence=0.95):
+    """Distribution-free interval of the median: the order statistics x(k) and x(n-k+1) with the
+    largest k such that P(Bin(n, 1/2) < k) <= (1 - confidence) / 2.  With too few values to reach
+    the confidence the interval is the range."""
+    v = sorted(values)
+    n = len(v)
+    alpha = (1 - confidence) / 2
+    k, cdf = 0, 0.0
+    while k < n:
+        p = math.comb(n, k) / 2 ** n
+        if cdf + p > alpha:
+            break
+        cdf += p
+        k += 1
+    if k == 0:
+        return v[0], v[-1]
+    return v[k - 1], v[n - k]
+
+
+def group_key(line):
+    return (line["benchmark"], line["params"], line.get("percent", ""))
+
+
+def aggregate(lines, confidence=0.95):
+    """Median and confidence interval of every numeric metric of every grid point (and percentage)."""
+    groups = {}
+    for line in lines:
+        groups.setdefault(group_key(line), []).append(line)
+    summary = []
+    for key, group in groups.items():
+        metrics = [k for k, v in group[0].items()
+                   if k not in ID_KEYS and isinstance(v, (int, float)) and not isinstance(v, bool)]
+        for metric in metrics:
+            values = [g[metric] for g in group if metric in g]
+            low, high = median_ci(values, confidence)
+            summary.append({"benchmark": key[0], "params": key[1], "percent": key[2], "metric": metric,
+                            "n": len(values), "median": median(values), "ci_low": low, "ci_high": high})
+    return summary
+
+
+def write_csv(summary, path):
+    with open(path, "w", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=["benchmark", "params", "percent", "metric", "n", "median", "ci_low",
+                                               "ci_high"])
+        writer.writeheader()
+        writer.writerows(summary)
+
+
+def print_summary(summary, metrics=None):
+    print()
+    print("Printing the median and the confidence interval of the median (LOW, HIGH) of each metric")
+    print()
+    print("%-10s %-28s %5s %-14s %4s %12s %12s %12s" % ("BENCH", "PARAMS", "%", "METRIC", "N", "MEDIAN", "LOW",
+                                                     "HIGH"))
+    print()
+    for s in summary:
+        if metrics and s["metric"] not in metrics:
+            continue
+        print("%-10s %-28s %5s %-14s %4d %12.6g %12.6g %12.6g" % (s["benchmark"], s["params"], s["percent"],
+                                                                s["metric"], s["n"], s["median"], s["ci_low"],
+                                                                s["ci_high"]))
+    print()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Run the sparse and VL benchmarks over parameter grids.")
+    parser.add_argument("-b", "--bindir", default=".", help="directory of the compiled benchmarks (default .)")
+    parser.add_argument("-r", "--repeats", type=int, default=5, help="runs of each grid point (default 5)")
+    parser.add_argument("-o", "--output", help="file for all runs as JSON lines")
+    parser.add_argument("-c", "--csv", help="file for the summary as CSV")
+    parser.add_argument("-p", "--confidence", type=float, default=0.95, help="confidence level (default 0.95)")
+    parser.add_argument("-t", "--timeout", type=float, help="timeout of a run in seconds")
+    parser.add_argument("-m", "--metrics", help="comma-separated metrics to print (default all)")
+    parser.add_argument("-v", "--verbose", action="store_true", help="print the runs")
+    for name in BENCHMARKS:
+        parser.add_argument("--" + name, metavar="GRID", help="grid of %s, e.g. \"%s\"" % (name, DEFAULT_GRIDS[name]))
+    parser.add_argument("--all", action="store_true", help="run the default grid of every benchmark")
+    args = parser.parse_args()
+
+    grids = {}
+    for name in BENCHMARKS:
+        spec = getattr(args, name)
+        if spec or args.all:
+            grids[name] = spec or DEFAULT_GRIDS[name]
+    if not grids:
+        parser.error("no grid given; use --sparse, --vl, --vl_uint or --all")
+    if args.repeats < 1:
+        parser.error("the number of repeats must be positive")
+
+    lines = run_sweep(args.bindir, grids, args.repeats, args.verbose, args.timeout)
+    if args.output:
+        with open(args.output, "w") as f:
+            for line in lines:
+                f.write(json.dumps(line) + "\n")
+
+    summary = aggregate(lines, args.confidence)
+    if args.csv:
+        write_csv(summary, args.csv)
+    print_summary(summary, args.metrics.split(",") if args.metrics else None)
+
+
+if __name__ == "__main__":
+    main()
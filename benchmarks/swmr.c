@@ -0,0 +1,680 @@
+/*
+ * This program measures how fast a live reader sees sparse frames that a SWMR (single-writer/multiple-
+ * reader) writer appends to a structured chunk dataset.  Structured chunks are emulated as described in
+ * structured_chunk.h.
+ *
+ * The program forks into two processes that share the file "swmr_file.h5":
+ *
+ *  - the writer creates a 3-dim dataset "hits" of 16-bit values with an unlimited time dimension (frames
+ *    of Y x X elements, option -f) and its dataset "hits.frames" (sc_create_frames), starts SWMR writing
+ *    and appends T frames (option -t) of N hits each (option -n) with the appender of structured_chunk.h,
+ *    optionally at a fixed rate of F frames per second (option -s).  Each time a time slab of C1 frames
+ *    (the first chunk dimension of option -c) is sealed, its chunks are written, the dataset is flushed
+ *    and only then the extent of "hits.frames" is set to the number of frames and flushed;
+ *  - the reader opens the file for SWMR reading and polls "hits.frames" every P microseconds (option -p)
+ *    with sc_refresh_frames.  For each new time slab it reads all chunks with H5Dread_chunk, verifies
+ *    the checksum of the Encoded Selection, decodes it and checks that it matches the Data section and
+ *    that the slab has all its hits.
+ *
+ * Because a structured chunk holds the selection and the values in one image written with one
+ * H5Dwrite_chunk, and the frames are published after the chunk index is flushed, the reader never sees
+ * a selection without its data, unlike the separate "selection" and "data" datasets of sparse.c.
+ *
+ * The program reports the time and the hits per second of the writer and the reader, the number of
+ * polls and errors, and the lag of the reader: the time from the arrival of the frame that completes a
+ * time slab at the writer until the reader has read all chunks of the slab.
+ *
+ * To compile the program, please use h5cc.  The -h option lists all the command line options:
+ *
+ *   [-h] [-f --dimsFrame] [-c --dimsChunk] [-t --tFrames] [-n --nHits] [-s --sRate] [-p --pPoll]
+ *   [-v --Verbose]
+ *
+ * Example: The commands
+ *
+ *           h5cc swmr.c -o swmr
+ *           ./swmr -f 1024x1024 -c 16x64x64 -t 4096 -n 4096 -s 1000
+ *
+ * append 4096 frames with 4096 hits each at 1000 frames per second while a second process reads them.
+ */
+
+#include "hdf5.h"
+#include "structured_chunk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <getopt.h>
+#include <sys/wait.h>
+
+#define FILE_NAME                       "swmr_file.h5"
+#define DSET_NAME                       "hits"
+#define RANK                            3
+#define FRAME_DIM1                      1024
+#define FRAME_DIM2                      1024
+#define CHUNK_DIM0                      16
+#define CHUNK_DIM1                      64
+#define CHUNK_DIM2                      64
+#define FRAMES                          4096
+#define HITS                            4096
+#define EXTEND_SLABS                    64
+#define POLL_USEC                       1000
+#define POOL_FRAMES                     16          /* Frames of hits generated before the run */
+
+typedef struct {
+    long long int   frame_dim1;
+    long long int   frame_dim2;
+    long long int   chunk_dim0;
+    long long int   chunk_dim1;
+    long long int   chunk_dim2;
+    long long int   frames;
+    long long int   hits;            /* number of hits per frame */
+    long long int   rate;            /* frames per second of the writer; 0 for no limit */
+    long long int   poll;            /* poll interval of the reader in microseconds */
+    int             v;               /* prints progress messages */
+} handler_t;
+
+/* State shared by the writer and the reader */
+typedef struct {
+    volatile int    ready;           /* the writer has started SWMR writing */
+    volatile int    failed;          /* the writer has failed */
+    long long int   write_hits;
+    double          write_time;
+    long long int   read_hits;
+    double          read_time;       /* time spent reading slabs, without the polls */
+    long long int   npolls;
+    long long int   nerrors;         /* chunks that failed verification and incomplete slabs */
+    double         *complete;        /* time at which each slab was complete at the writer */
+    double         *read_done;       /* time at which the reader had read each slab */
+} shared_t;
+
+handler_t    hand;
+shared_t    *sh;
+hsize_t     *pool_coords;
+uint16_t    *pool_values;
+
+/*------------------------------------------------------------
+ * Display command line usage
+ *------------------------------------------------------------
+ */
+void
+usage(void)
+{
+    printf("    [-h] [-f --dimsFrame] [-c --dimsChunk] [-t --tFrames] [-n --nHits] [-s --sRate] [-p --pPoll]\n");
+    printf("    [-v --Verbose]\n");
+    printf("    [-h --help]: this help page\n");
+    printf("    [-f --dimsFrame]: the 2D dimensions of a frame in elements, e.g. 1024x1024\n");
+    printf("    [-c --dimsChunk]: the 3D dimensions of the chunks in frames and elements, e.g. 16x64x64\n");
+    printf("    [-t --tFrames]: the number of frames appended\n");
+    printf("    [-n --nHits]: the number of hits in each frame\n");
+    printf("    [-s --sRate]: the number of frames per second appended by the writer; 0 (default) for no limit\n");
+    printf("    [-p --pPoll]: the poll interval of the reader in microseconds\n");
+    printf("    [-v --Verbose]: Print progress messages(1); default no messages displayed (0) \n");
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Parse a string of the form AxB or AxBxC; missing dimensions
+ * are set to 0
+ *------------------------------------------------------------
+ */
+void
+parse_dims(const char *str, int ndims, long long int *dims[])
+{
+    char *dims_str, *dim_str;
+    int   i;
+
+    dims_str = strdup(str);
+    dim_str  = strtok(dims_str, "x");
+    for (i = 0; i < ndims; i++) {
+        *dims[i] = dim_str ? atoll(dim_str) : 0;
+        dim_str  = strtok(NULL, "x");
+    }
+    free(dims_str);
+}
+
+/*------------------------------------------------------------
+ * Parse command line option
+ *------------------------------------------------------------
+ */
+void
+parse_command_line(int argc, char *argv[])
+{
+    int            opt;
+    long long int *frame_dims[2] = {&hand.frame_dim1, &hand.frame_dim2};
+    long long int *chunk_dims[3] = {&hand.chunk_dim0, &hand.chunk_dim1, &hand.chunk_dim2};
+    struct option  long_options[] = {
+                                    {"help", no_argument, NULL, 'h'},
+                                    {"dimsFrame=", required_argument, NULL, 'f'},
+                                    {"dimsChunk=", required_argument, NULL, 'c'},
+                                    {"tFrames=", required_argument, NULL, 't'},
+                                    {"nHits=", required_argument, NULL, 'n'},
+                                    {"sRate=", required_argument, NULL, 's'},
+                                    {"pPoll=", required_argument, NULL, 'p'},
+                                    {"Verbose=", required_argument, NULL, 'v'},
+                                    {NULL, 0, NULL, 0}};
+
+    /* Initialize the command line options */
+    hand.frame_dim1 = FRAME_DIM1;
+    hand.frame_dim2 = FRAME_DIM2;
+    hand.chunk_dim0 = CHUNK_DIM0;
+    hand.chunk_dim1 = CHUNK_DIM1;
+    hand.chunk_dim2 = CHUNK_DIM2;
+    hand.frames     = FRAMES;
+    hand.hits       = HITS;
+    hand.rate       = 0;
+    hand.poll       = POLL_USEC;
+    hand.v          = 0;
+
+    while ((opt = getopt_long(argc, argv, "hf:c:t:n:s:p:v:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'h':
+                fprintf(stdout, "Help page:\n");
+                usage();
+
+                exit(0);
+
+                break;
+            case 'f':
+                if (optarg) {
+                    fprintf(stdout, "Frame dimensions:\t\t\t\t\t%s\n", optarg);
+                    parse_dims(optarg, 2, frame_dims);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'c':
+                if (optarg) {
+                    fprintf(stdout, "Chunk dimensions:\t\t\t\t\t%s\n", optarg);
+                    parse_dims(optarg, 3, chunk_dims);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 't':
+                if (optarg) {
+                    fprintf(stdout, "Number of frames:\t\t\t\t\t%s\n", optarg);
+                    hand.frames = atoll(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'n':
+                if (optarg) {
+                    fprintf(stdout, "Hits per frame:\t\t\t\t\t\t%s\n", optarg);
+                    hand.hits = atoll(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 's':
+                if (optarg) {
+                    fprintf(stdout, "Frames per second:\t\t\t\t\t%s\n", optarg);
+                    hand.rate = atoll(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'p':
+                if (optarg) {
+                    fprintf(stdout, "Poll interval in microseconds:\t\t\t\t%s\n", optarg);
+                    hand.poll = atoll(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'v':
+                if (optarg) {
+                    hand.v = atoi(optarg);
+                    if (hand.v == 1)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\ton\n");
+                    else if (hand.v == 0)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Verbose mode:\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case ':':
+                printf("Option needs a value\n");
+                break;
+            case '?':
+                printf("Unknown option: %c\n", optopt);
+                break;
+        }
+    }
+
+    /* optind is for the extra arguments which are not parsed */
+    for (; optind < argc; optind++) {
+        printf("extra arguments not parsed: %s\n", argv[optind]);
+    }
+
+    /* Make sure the command line options are valid */
+    if (hand.frame_dim1 <= 0 || hand.frame_dim2 <= 0) {
+        printf("Invalid frame dimensions\n");
+        exit(1);
+    }
+
+    if (hand.chunk_dim0 <= 0 || hand.chunk_dim1 <= 0 || hand.chunk_dim2 <= 0 ||
+        hand.chunk_dim1 > hand.frame_dim1 || hand.chunk_dim2 > hand.frame_dim2) {
+        printf("Invalid chunk dimensions\n");
+        exit(1);
+    }
+
+    if (hand.frames < 1) {
+        printf("The number of frames must be positive\n");
+        exit(1);
+    }
+
+    if (hand.hits < 1 || hand.hits > hand.frame_dim1 * hand.frame_dim2) {
+        printf("The number of hits per frame must be between 1 and the number of elements of a frame\n");
+        exit(1);
+    }
+
+    if (hand.rate < 0) {
+        printf("The number of frames per second cannot be negative\n");
+        exit(1);
+    }
+
+    if (hand.poll < 0) {
+        printf("The poll interval cannot be negative\n");
+        exit(1);
+    }
+
+    if (hand.v < 0 || hand.v > 1) {
+        printf("Verbose flag can only be 0 or 1 \n");
+        exit(1);
+    }
+}
+
+/*------------------------------------------------------------
+ * Compare two times (qsort callback)
+ *------------------------------------------------------------
+ */
+int cmp_time(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+/*------------------------------------------------------------
+ * Print the throughput of the writer and the reader and the
+ * lag of the reader
+ *------------------------------------------------------------
+ */
+void print_results(long long int nslabs)
+{
+    double       *lag = (double *)malloc(nslabs * sizeof(double));
+    double        sum = 0;
+    long long int s;
+
+    for (s = 0; s < nslabs; s++) {
+        lag[s] = (sh->read_done[s] - sh->complete[s]) * 1e3;
+        sum += lag[s];
+    }
+    qsort(lag, nslabs, sizeof(double), cmp_time);
+
+    printf("\n");
+    printf("Number of time slabs:\t\t\t\t\t%lli\n", nslabs);
+    printf("Number of polls of the reader:\t\t\t\t%lli\n", sh->npolls);
+    printf("Number of errors of the reader:\t\t\t\t%lli\n", sh->nerrors);
+    printf("\n");
+    printf("Printing the process, number of hits (NH), time in seconds (T) and million hits per second (MHPS)\n");
+    printf("\n");
+    printf("   process         NH          T       MHPS\n");
+    printf("\n");
+    printf("%10s %10lli %10.4f %10.2f \n", "writer", sh->write_hits, sh->write_time,
+           sh->write_hits / sh->write_time / 1e6);
+    printf("%10s %10lli %10.4f %10.2f \n", "reader", sh->read_hits, sh->read_time,
+           sh->read_hits / sh->read_time / 1e6);
+    printf("\n");
+    printf("Printing the lag of the reader in milliseconds: mean, median, 99th percentile and maximum\n");
+    printf("\n");
+    printf("      mean     median        p99        max\n");
+    printf("\n");
+    printf("%10.3f %10.3f %10.3f %10.3f \n", sum / nslabs, lag[nslabs / 2], lag[(nslabs * 99) / 100],
+           lag[nslabs - 1]);
+    printf("\n");
+
+    free(lag);
+}
+
+/*------------------------------------------------------------
+ * Current time
+ *------------------------------------------------------------
+ */
+double now(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/*------------------------------------------------------------
+ * Generate POOL_FRAMES frames of hits at distinct random
+ * positions; the time coordinate is set when a frame is
+ * appended
+ *------------------------------------------------------------
+ */
+void generate_hits(void)
+{
+    long long int frame_size = hand.frame_dim1 * hand.frame_dim2;
+    uint8_t      *mark;
+    long long int f, h;
+
+    pool_coords = (hsize_t *)malloc(POOL_FRAMES * hand.hits * RANK * sizeof(hsize_t));
+    pool_values = (uint16_t *)malloc(POOL_FRAMES * hand.hits * sizeof(uint16_t));
+    mark        = (uint8_t *)malloc(frame_size);
+
+    for (f = 0; f < POOL_FRAMES; f++) {
+        memset(mark, 0, frame_size);
+        for (h = 0; h < hand.hits; h++) {
+            hsize_t      *coord = pool_coords + (f * hand.hits + h) * RANK;
+            long long int k;
+
+            do
+                k = ((long long int)rand() * RAND_MAX + rand()) % frame_size;
+            while (mark[k]);
+            mark[k] = 1;
+
+            coord[0] = 0;
+            coord[1] = k / hand.frame_dim2;
+            coord[2] = k % hand.frame_dim2;
+            pool_values[f * hand.hits + h] = (uint16_t)(rand() % 65535 + 1);
+        }
+    }
+
+    free(mark);
+}
+
+/*------------------------------------------------------------
+ * Writer: create the file, start SWMR writing and append the
+ * frames
+ *------------------------------------------------------------
+ */
+int run_writer(void)
+{
+    sc_append_t   app;
+    hid_t         fapl, file, dcpl, space, dset;
+    hsize_t       dims[RANK], maxdims[RANK], chunk_dims[RANK];
+    long long int t, h;
+    double        start;
+
+    dims[0]       = 0;
+    dims[1]       = hand.frame_dim1;
+    dims[2]       = hand.frame_dim2;
+    maxdims[0]    = H5S_UNLIMITED;
+    maxdims[1]    = hand.frame_dim1;
+    maxdims[2]    = hand.frame_dim2;
+    chunk_dims[0] = hand.chunk_dim0;
+    chunk_dims[1] = hand.chunk_dim1;
+    chunk_dims[2] = hand.chunk_dim2;
+
+    /* SWMR needs the latest file format */
+    fapl = H5Pcreate(H5P_FILE_ACCESS);
+    H5Pset_libver_bounds(fapl, H5F_LIBVER_LATEST, H5F_LIBVER_LATEST);
+    file = H5Fcreate(FILE_NAME, H5F_ACC_TRUNC, H5P_DEFAULT, fapl);
+
+    dcpl  = sc_create_dcpl(RANK, chunk_dims);
+    space = H5Screate_simple(RANK, dims, maxdims);
+    dset  = H5Dcreate2(file, DSET_NAME, H5T_STD_U16LE, space, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+    if (dset < 0 || sc_create_frames(file, DSET_NAME) < 0) {
+        printf("Failed to create the dataset %s\n", DSET_NAME);
+        return -1;
+    }
+
+    if (H5Fstart_swmr_write(file) < 0) {
+        printf("Failed to start SWMR writing\n");
+        return -1;
+    }
+    if (sc_append_open(dset, H5P_DEFAULT, sizeof(uint16_t), SC_PIPELINE_NONE, EXTEND_SLABS, &app) < 0) {
+        printf("Failed to open the appender\n");
+        return -1;
+    }
+    sh->ready = 1;
+
+    start = now();
+    for (t = 0; t < hand.frames; t++) {
+        long long int f      = t % POOL_FRAMES;
+        hsize_t      *coords = pool_coords + f * hand.hits * RANK;
+
+        if (hand.rate > 0) {
+            double wait = start + (double)t / hand.rate - now();
+
+            if (wait > 0) {
+                struct timespec ts;
+
+                ts.tv_sec  = (time_t)wait;
+                ts.tv_nsec = (long)((wait - ts.tv_sec) * 1e9);
+                nanosleep(&ts, NULL);
+            }
+        }
+
+        /* The first frame of a time slab completes the previous slab, which is sealed and published */
+        if (t > 0 && t % hand.chunk_dim0 == 0)
+            sh->complete[t / hand.chunk_dim0 - 1] = now();
+
+        for (h = 0; h < hand.hits; h++)
+            coords[h * RANK] = (hsize_t)t;
+        if (sc_append_hits(&app, (size_t)hand.hits, coords, pool_values + f * hand.hits) < 0) {
+            printf("Failed to append frame %lli\n", t);
+            return -1;
+        }
+    }
+
+    sh->complete[(hand.frames - 1) / hand.chunk_dim0] = now();
+    if (sc_append_close(&app) < 0) {
+        printf("Failed to close the appender\n");
+        return -1;
+    }
+    sh->write_time = now() - start;
+    sh->write_hits = hand.frames * hand.hits;
+
+    H5Dclose(dset);
+    H5Sclose(space);
+    H5Pclose(dcpl);
+    H5Fclose(file);
+    H5Pclose(fapl);
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Read and verify the chunks of a time slab; returns the
+ * number of hits
+ *------------------------------------------------------------
+ */
+long long int read_slab(hid_t dset, long long int slab)
+{
+    static uint8_t  *image = NULL, *sel = NULL, *data = NULL;
+    static size_t    image_max = 0, sel_max = 0, data_max = 0;
+    sc_chunk_info_t  info;
+    hsize_t          offset[RANK], size, sel_dims[H5S_MAX_RANK];
+    long long int    nhits = 0;
+    long long int    grid1 = (hand.frame_dim1 + hand.chunk_dim1 - 1) / hand.chunk_dim1;
+    long long int    grid2 = (hand.frame_dim2 + hand.chunk_dim2 - 1) / hand.chunk_dim2;
+    long long int    c;
+    uint32_t         filters;
+    size_t           nruns;
+    int              rank;
+    void            *buf[2];
+
+    offset[0] = slab * hand.chunk_dim0;
+    for (c = 0; c < grid1 * grid2; c++) {
+        offset[1] = (c / grid2) * hand.chunk_dim1;
+        offset[2] = (c % grid2) * hand.chunk_dim2;
+
+        /* Chunks without hits are not stored */
+        if (H5Dget_chunk_storage_size(dset, offset, &size) < 0 || size == 0)
+            continue;
+        if (size > image_max) {
+            image_max = size;
+            image     = (uint8_t *)realloc(image, image_max);
+        }
+        if (H5Dread_chunk(dset, H5P_DEFAULT, offset, &filters, image) < 0 ||
+            sc_disassemble_chunk(image, size, &info, NULL) < 0) {
+            sh->nerrors++;
+            continue;
+        }
+
+        if (info.section_orig_size[SC_SECTION_SELECTION] > sel_max) {
+            sel_max = info.section_orig_size[SC_SECTION_SELECTION];
+            sel     = (uint8_t *)realloc(sel, sel_max);
+        }
+        if (info.section_orig_size[SC_SECTION_FIXED] > data_max) {
+            data_max = info.section_orig_size[SC_SECTION_FIXED];
+            data     = (uint8_t *)realloc(data, data_max);
+        }
+        buf[SC_SECTION_SELECTION] = sel;
+        buf[SC_SECTION_FIXED]     = data;
+
+        /* The selection must be intact and describe exactly the values of the Data section */
+        if (sc_disassemble_chunk(image, size, &info, buf) < 0 ||
+            sc_decode_runs(sel, info.section_orig_size[SC_SECTION_SELECTION], &rank, sel_dims, &nruns, NULL) < 0 ||
+            info.section_orig_size[SC_SECTION_FIXED] != info.nelemts * sizeof(uint16_t)) {
+            sh->nerrors++;
+            continue;
+        }
+        nhits += (long long int)info.nelemts;
+    }
+
+    return nhits;
+}
+
+/*------------------------------------------------------------
+ * Reader: poll the published frames and read each new time
+ * slab
+ *------------------------------------------------------------
+ */
+int run_reader(void)
+{
+    hid_t         file, dset, frames;
+    hsize_t       nframes;
+    long long int nslabs = (hand.frames + hand.chunk_dim0 - 1) / hand.chunk_dim0;
+    long long int next = 0, avail, s, nhits;
+    double        start;
+
+    while (!sh->ready) {
+        if (sh->failed)
+            return -1;
+        usleep(1000);
+    }
+
+    if ((file = H5Fopen(FILE_NAME, H5F_ACC_RDONLY | H5F_ACC_SWMR_READ, H5P_DEFAULT)) < 0) {
+        printf("Failed to open %s for SWMR reading\n", FILE_NAME);
+        return -1;
+    }
+    dset = H5Dopen2(file, DSET_NAME, H5P_DEFAULT);
+    if ((frames = sc_open_frames(dset)) < 0) {
+        printf("The dataset %s has no published frames\n", DSET_NAME);
+        return -1;
+    }
+
+    while (next < nslabs) {
+        if (sc_refresh_frames(dset, frames, &nframes) < 0) {
+            printf("Failed to refresh the frames\n");
+            return -1;
+        }
+
+        /* The last time slab may be incomplete */
+        avail = (long long int)nframes == hand.frames ? nslabs : (long long int)nframes / hand.chunk_dim0;
+        if (avail <= next) {
+            if (sh->failed)
+                return -1;
+            sh->npolls++;
+            usleep((useconds_t)hand.poll);
+            continue;
+        }
+
+        for (s = next; s < avail; s++) {
+            long long int nslab_frames = s < nslabs - 1 ? hand.chunk_dim0 : hand.frames - s * hand.chunk_dim0;
+
+            start = now();
+            nhits = read_slab(dset, s);
+            sh->read_done[s] = now();
+            sh->read_time += sh->read_done[s] - start;
+            sh->read_hits += nhits;
+            if (nhits != nslab_frames * hand.hits)
+                sh->nerrors++;
+        }
+        next = avail;
+    }
+
+    H5Dclose(frames);
+    H5Dclose(dset);
+    H5Fclose(file);
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Main function
+ *------------------------------------------------------------
+ */
+int
+main(int argc, char **argv)
+{
+    long long int nslabs;
+    size_t        shared_size;
+    uint8_t      *shared;
+    pid_t         pid;
+    int           status;
+
+    parse_command_line(argc, argv);
+
+    /* Use the same seed for reproducibility of the results */
+    srand(2);
+
+    if (hand.v) printf("Generating the hits\n");
+    generate_hits();
+
+    /* The shared state is mapped before the fork, so both processes see it */
+    nslabs      = (hand.frames + hand.chunk_dim0 - 1) / hand.chunk_dim0;
+    shared_size = sizeof(shared_t) + 2 * nslabs * sizeof(double);
+    shared      = (uint8_t *)mmap(NULL, shared_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        printf("Failed to map the shared state\n");
+        return 1;
+    }
+    sh            = (shared_t *)shared;
+    sh->complete  = (double *)(shared + sizeof(shared_t));
+    sh->read_done = sh->complete + nslabs;
+
+    /* The processes are forked before the library is initialized */
+    fflush(stdout);
+    if ((pid = fork()) < 0) {
+        printf("Failed to fork the reader\n");
+        return 1;
+    }
+    if (pid == 0) {
+        if (hand.v) printf("Starting the reader\n");
+        exit(run_reader() < 0 ? 1 : 0);
+    }
+
+    if (hand.v) printf("Starting the writer\n");
+    if (run_writer() < 0) {
+        sh->failed = 1;
+        waitpid(pid, &status, 0);
+        return 1;
+    }
+
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        printf("The reader failed\n");
+        return 1;
+    }
+
+    if (hand.v) printf("Done! \n");
+
+    free(pool_coords);
+    free(pool_values);
+
+    print_results(nslabs);
+
+    munmap(shared, shared_size);
+
+    return 0;
+}
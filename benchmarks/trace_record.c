@@ -0,0 +1,180 @@
+/*
+ * This file is a tracer of the dataset accesses of an HDF5 application.  It is linked into the application
+ * and records every H5Dread, H5Dwrite, H5Dread_chunk and H5Dwrite_chunk call as one line of a trace that
+ * trace_replay.c replays against dense, sparse-emulated and structured chunk layouts:
+ *
+ *   <seconds> <R|W> <dataset> <offset> <count>
+ *
+ * e.g. "0.002315 R /sparse 128x0 16x512".  The time is taken with CLOCK_MONOTONIC when the call starts,
+ * relative to the first recorded call; a call of another thread that started before it is recorded at 0.
+ * The offset and count are the bounding box of the file selection
+ * (H5Sget_select_bounds), the whole extent of the dataset for H5S_ALL, and the chunk for the direct chunk
+ * calls.  Calls with an empty selection are not recorded.  Point and irregular hyperslab selections are
+ * recorded as their bounding box, so traces of such applications replay more elements than they accessed.
+ *
+ * The calls are intercepted with the --wrap option of the GNU linker, which only works when the application
+ * is linked with the static HDF5 library, as h5cc does by default: calls into a shared library are not
+ * wrapped.  HDF5 1.12 and later can instead trace an unmodified application with a pass-through VOL
+ * connector such as H5VLpassthru, loaded through the HDF5_VOL_CONNECTOR environment variable; the
+ * benchmarks build against HDF5 1.10, which has no VOL layer.  The trace is written to the file given by the environment variable H5_TRACE_FILE (default h5_trace.txt); writes
+ * are serialized with a mutex for multi-threaded applications.
+ *
+ * To record a trace, please compile the application with h5cc and this file, wrapping the four calls:
+ *
+ *           h5cc app.c trace_record.c -o app -Wl,--wrap=H5Dread,--wrap=H5Dwrite,--wrap=H5Dread_chunk,--wrap=H5Dwrite_chunk
+ *           H5_TRACE_FILE=app_trace.txt ./app
+ *           ./trace_replay -i app_trace.txt
+ */
+
+#include "hdf5.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <pthread.h>
+
+#define TRACE_FILE_ENV                  "H5_TRACE_FILE"
+#define TRACE_FILE_NAME                 "h5_trace.txt"
+#define MAX_NAME                        1024
+
+herr_t __real_H5Dread(hid_t dset_id, hid_t mem_type_id, hid_t mem_space_id, hid_t file_space_id, hid_t dxpl_id,
+                      void *buf);
+herr_t __real_H5Dwrite(hid_t dset_id, hid_t mem_type_id, hid_t mem_space_id, hid_t file_space_id, hid_t dxpl_id,
+                       const void *buf);
+herr_t __real_H5Dread_chunk(hid_t dset_id, hid_t dxpl_id, const hsize_t *offset, uint32_t *filters, void *buf);
+herr_t __real_H5Dwrite_chunk(hid_t dset_id, hid_t dxpl_id, uint32_t filters, const hsize_t *offset, size_t data_size,
+                             const void *buf);
+
+static FILE            *trace_file;
+static struct timespec  trace_start;
+static pthread_mutex_t  trace_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*------------------------------------------------------------
+ * Append one access to the trace; the trace is opened by the
+ * first call
+ *------------------------------------------------------------
+ */
+static void trace_access(const struct timespec *now, char op, hid_t dset_id, int rank, const hsize_t *offset,
+                         const hsize_t *count)
+{
+    char    name[MAX_NAME];
+    ssize_t len;
+    double  seconds;
+    int     i;
+
+    H5E_BEGIN_TRY {
+        len = H5Iget_name(dset_id, name, sizeof(name));
+    } H5E_END_TRY;
+    if (len <= 0)
+        strcpy(name, "-");
+    for (i = 0; name[i]; i++)
+        if (name[i] == ' ' || name[i] == '\t')
+            name[i] = '_';
+
+    pthread_mutex_lock(&trace_lock);
+    if (!trace_file) {
+        const char *file_name = getenv(TRACE_FILE_ENV);
+
+        if (NULL == (trace_file = fopen(file_name ? file_name : TRACE_FILE_NAME, "w"))) {
+            pthread_mutex_unlock(&trace_lock);
+            return;
+        }
+        trace_start = *now;
+        fprintf(trace_file, "# seconds op dataset offset count\n");
+    }
+
+    /* Another thread may have taken the lock first with a later start */
+    seconds = (now->tv_sec - trace_start.tv_sec) + (now->tv_nsec - trace_start.tv_nsec) / 1e9;
+    fprintf(trace_file, "%.6f %c %s ", seconds < 0 ? 0 : seconds, op, name);
+    for (i = 0; i < rank; i++)
+        fprintf(trace_file, i ? "x%llu" : "%llu", (unsigned long long)offset[i]);
+    fprintf(trace_file, " ");
+    for (i = 0; i < rank; i++)
+        fprintf(trace_file, i ? "x%llu" : "%llu", (unsigned long long)count[i]);
+    fprintf(trace_file, "\n");
+    fflush(trace_file);
+    pthread_mutex_unlock(&trace_lock);
+}
+
+/*------------------------------------------------------------
+ * Trace the bounding box of the file selection of a read or
+ * a write
+ *------------------------------------------------------------
+ */
+static void trace_selection(const struct timespec *now, char op, hid_t dset_id, hid_t file_space_id)
+{
+    hid_t    space;
+    hsize_t  start[H5S_MAX_RANK], end[H5S_MAX_RANK], count[H5S_MAX_RANK];
+    hssize_t npoints;
+    int      rank, i;
+
+    space = file_space_id == H5S_ALL ? H5Dget_space(dset_id) : H5Scopy(file_space_id);
+    if (space < 0)
+        return;
+
+    rank    = H5Sget_simple_extent_ndims(space);
+    npoints = H5Sget_select_npoints(space);
+    if (rank > 0 && npoints > 0 && H5Sget_select_bounds(space, start, end) >= 0) {
+        for (i = 0; i < rank; i++)
+            count[i] = end[i] - start[i] + 1;
+        trace_access(now, op, dset_id, rank, start, count);
+    }
+
+    H5Sclose(space);
+}
+
+/*------------------------------------------------------------
+ * Trace a direct chunk read or write
+ *------------------------------------------------------------
+ */
+static void trace_chunk(const struct timespec *now, char op, hid_t dset_id, const hsize_t *offset)
+{
+    hid_t   dcpl;
+    hsize_t chunk_dims[H5S_MAX_RANK];
+    int     rank;
+
+    if ((dcpl = H5Dget_create_plist(dset_id)) < 0)
+        return;
+    if ((rank = H5Pget_chunk(dcpl, H5S_MAX_RANK, chunk_dims)) > 0)
+        trace_access(now, op, dset_id, rank, offset, chunk_dims);
+    H5Pclose(dcpl);
+}
+
+herr_t __wrap_H5Dread(hid_t dset_id, hid_t mem_type_id, hid_t mem_space_id, hid_t file_space_id, hid_t dxpl_id,
+                      void *buf)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    trace_selection(&now, 'R', dset_id, file_space_id);
+    return __real_H5Dread(dset_id, mem_type_id, mem_space_id, file_space_id, dxpl_id, buf);
+}
+
+herr_t __wrap_H5Dwrite(hid_t dset_id, hid_t mem_type_id, hid_t mem_space_id, hid_t file_space_id, hid_t dxpl_id,
+                       const void *buf)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    trace_selection(&now, 'W', dset_id, file_space_id);
+    return __real_H5Dwrite(dset_id, mem_type_id, mem_space_id, file_space_id, dxpl_id, buf);
+}
+
+herr_t __wrap_H5Dread_chunk(hid_t dset_id, hid_t dxpl_id, const hsize_t *offset, uint32_t *filters, void *buf)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    trace_chunk(&now, 'R', dset_id, offset);
+    return __real_H5Dread_chunk(dset_id, dxpl_id, offset, filters, buf);
+}
+
+herr_t __wrap_H5Dwrite_chunk(hid_t dset_id, hid_t dxpl_id, uint32_t filters, const hsize_t *offset, size_t data_size,
+                             const void *buf)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    trace_chunk(&now, 'W', dset_id, offset);
+    return __real_H5Dwrite_chunk(dset_id, dxpl_id, filters, offset, data_size, buf);
+}
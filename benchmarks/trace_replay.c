@@ -0,0 +1,1202 @@
+/*
+ * This program replays a recorded trace of dataset reads and writes against three layouts of the same
+ * sparse 2-dim dataset and reports the latency percentiles of the accesses, so that the storage can be
+ * tuned for the access behaviour of a real application instead of the synthetic patterns of sparse.c.
+ *
+ * A trace is a text file with one access per line (lines starting with # are comments):
+ *
+ *   <seconds> <R|W> <dataset> <offset> <count>
+ *
+ * e.g. "0.002315 R /sparse 128x0 16x512" reads the hyperslab of 16 x 512 elements at (128, 0) 2.3 ms
+ * after the start of the trace.  trace_record.c records such traces from an application.  The accesses
+ * of one dataset are replayed with the option -n (default all lines); 1-dim accesses are replayed as
+ * one row and accesses of a higher rank are skipped.  The extent of the replayed dataset is the bounding
+ * box of the accesses rounded up to the chunk dimensions (option -c).
+ *
+ * Each chunk starts with the density specified with the option -m (percent of defined elements).  A write
+ * defines each element of its hyperslab with the probability -m and undefines the others.  The dataset is
+ * stored in three files with the layouts (option -l, default all):
+ *
+ *  1 - trace_dense.h5; a chunked dataset "dense" in which undefined elements are 0 (the fill value), read
+ *      and written with H5Dread and H5Dwrite of the hyperslab;
+ *  2 - trace_sparse.h5; the emulation of sparse.c for each chunk: the datasets "selection_<i>" with the
+ *      selection of the defined elements encoded with H5Sencode and "data_<i>" with their values.  An
+ *      access reads the selection, decodes it and scatters the data into the chunk with H5Dread; a write
+ *      rebuilds the selection with H5Sselect_hyperslab and rewrites both datasets;
+ *  3 - trace_struct.h5; the structured chunks of structured_chunk.h in a dataset "structured".  A read
+ *      decodes the Encoded Selection into runs and copies only the runs that intersect the hyperslab; a
+ *      write re-encodes the runs of the chunk and rewrites it with direct chunk I/O.
+ *
+ * With the option -t 0 (default) the accesses are replayed one after the other as fast as possible and the
+ * latency of an access is its service time.  With -t 1 they are issued at the times of the trace divided
+ * by the speed-up of the option -x, and the latency is measured from the scheduled time, so that it also
+ * includes the queueing delay when the storage cannot keep up with the application.  The datasets are
+ * opened before the replay; the files are reopened between the layouts.
+ *
+ * The program reports for each layout the storage of the dataset, the file size, the time of the replay
+ * and a checksum of the data read, which is the same for all layouts when they return the same data.  The
+ * latency percentiles P50, P90, P99, P99.9 and the maximum are reported in microseconds for the reads, the
+ * writes and all accesses, with the number of elements accessed per second of latency.
+ *
+ * To compile the program, please use h5cc.  The -h option lists all the command line options:
+ *
+ *   [-h] [-i --inTrace] [-n --nameDset] [-c --dimsChunk] [-m --mPercent] [-l --lLayout] [-t --tTimed]
+ *   [-x --xSpeedup] [-d --dRandom] [-v --Verbose]
+ *
+ * Example: The commands
+ *
+ *           h5cc app.c trace_record.c -o app -Wl,--wrap=H5Dread,--wrap=H5Dwrite,--wrap=H5Dread_chunk,--wrap=H5Dwrite_chunk
+ *           H5_TRACE_FILE=app_trace.txt ./app
+ *           h5cc trace_replay.c -o trace_replay
+ *           ./trace_replay -i app_trace.txt -n /sparse -c 128x128 -m 2
+ *
+ * record the accesses of an application and replay those of its dataset "/sparse" with 128 x 128 chunks
+ * and 2% of defined elements.
+ */
+
+#include "hdf5.h"
+#include "structured_chunk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <time.h>
+#include <string.h>
+#include <getopt.h>
+
+#define TRACE_NAME                      "h5_trace.txt"
+#define DENSE_FILE_NAME                 "trace_dense.h5"
+#define SPARSE_FILE_NAME                "trace_sparse.h5"
+#define STRUCT_FILE_NAME                "trace_struct.h5"
+#define DENSE_DSET_NAME                 "dense"
+#define STRUCT_DSET_NAME                "structured"
+#define SELECTION_PREFIX                "selection_"
+#define DATA_PREFIX                     "data_"
+#define SELECTION_CHUNK_SIZE            4096
+#define CHUNK_DIM1                      64
+#define CHUNK_DIM2                      64
+#define RANK                            2
+#define PERCENT                         5
+#define MAX_LINE                        4096
+#define LAYOUT_DENSE                    1
+#define LAYOUT_SPARSE                   2
+#define LAYOUT_STRUCT                   3
+#define NUM_LAYOUTS                     3
+
+typedef struct {
+    char           *in_trace;
+    char           *dset_name;       /* NULL for the accesses of all datasets */
+    long long int   chunk_dim1;
+    long long int   chunk_dim2;
+    int             percent;
+    int             layout;          /* layout to replay; 0 for all layouts */
+    int             t;               /* flag to issue the accesses at the times of the trace */
+    double          speedup;         /* divides the times of the trace */
+    int             d;               /* flag to generate random or compressible data values */
+    int             v;               /* prints progress messages */
+} handler_t;
+
+/* An access of the trace */
+typedef struct {
+    double          time;            /* seconds since the start of the trace */
+    int             write;
+    hsize_t         offset[RANK];
+    hsize_t         count[RANK];
+} access_t;
+
+typedef struct {
+    uint8_t        *mask;            /* defined elements of the chunk */
+    uint8_t        *values;          /* values of the elements of the chunk */
+} chunk_t;
+
+typedef struct {
+    double         *latency;         /* latency of each access in seconds */
+    long long int   storage;         /* storage of the dataset(s) after the replay */
+    long long int   file;            /* size of the file after the replay */
+    double          seconds;         /* time of the replay */
+    uint64_t        checksum;        /* checksum of the data read */
+} result_t;
+
+handler_t    hand;
+access_t    *accesses;
+size_t       naccesses;
+size_t       nskipped;
+hsize_t      dims[RANK];
+hsize_t      grid[RANK];
+chunk_t     *chunks;
+result_t     res[NUM_LAYOUTS];
+const char  *layout_names[NUM_LAYOUTS] = {"dense", "sparse", "structured"};
+
+/* Datasets and buffers of the replay */
+hid_t        dense_dset, struct_dset;
+hid_t       *sel_dsets, *data_dsets;
+uint8_t     *block_mask, *block_values, *read_buf;
+uint8_t     *chunk_mask, *chunk_values;
+uint8_t     *sel_buf, *data_buf, *image_buf;
+size_t       sel_buf_size, data_buf_size, image_buf_size;
+sc_run_t    *runs;
+
+/*------------------------------------------------------------
+ * Display command line usage
+ *------------------------------------------------------------
+ */
+void
+usage(void)
+{
+    printf("    [-h] [-i --inTrace] [-n --nameDset] [-c --dimsChunk] [-m --mPercent] [-l --lLayout] [-t --tTimed]\n");
+    printf("    [-x --xSpeedup] [-d --dRandom] [-v --Verbose]\n");
+    printf("    [-h --help]: this help page\n");
+    printf("    [-i --inTrace]: the trace to replay (default %s)\n", TRACE_NAME);
+    printf("    [-n --nameDset]: replay the accesses of this dataset only; default all accesses\n");
+    printf("    [-c --dimsChunk]: the 2D dimensions of the chunks in elements, e.g. 64x64\n");
+    printf("    [-m --mPercent]: the percentage of defined elements in the chunks and in the written hyperslabs\n");
+    printf("    [-l --lLayout]: dense (1), sparse-emulated (2) or structured (3) layout; default all layouts (0)\n");
+    printf("    [-t --tTimed]: issue the accesses at the times of the trace (1); default back to back (0)\n");
+    printf("    [-x --xSpeedup]: divide the times of the trace by this factor for -t 1 (default 1)\n");
+    printf("    [-d --dRandom]: Use random data values (1) or compressible data values (0) \n");
+    printf("    [-v --Verbose]: Print progress messages(1); default no messages displayed (0) \n");
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Parse a string of the form AxB
+ *------------------------------------------------------------
+ */
+void
+parse_dims(const char *str, long long int *dim1, long long int *dim2)
+{
+    char *dims_str, *dim1_str, *dim2_str;
+
+    dims_str = strdup(str);
+    dim1_str = strtok(dims_str, "x");
+    dim2_str = strtok(NULL, "x");
+    *dim1    = dim1_str ? atoll(dim1_str) : 0;
+    *dim2    = dim2_str ? atoll(dim2_str) : 0;
+    free(dims_str);
+}
+
+/*------------------------------------------------------------
+ * Parse command line option
+ *------------------------------------------------------------
+ */
+void
+parse_command_line(int argc, char *argv[])
+{
+    int           opt;
+    struct option long_options[] = {
+                                    {"help", no_argument, NULL, 'h'},
+                                    {"inTrace=", required_argument, NULL, 'i'},
+                                    {"nameDset=", required_argument, NULL, 'n'},
+                                    {"dimsChunk=", required_argument, NULL, 'c'},
+                                    {"mPercent=", required_argument, NULL, 'm'},
+                                    {"lLayout=", required_argument, NULL, 'l'},
+                                    {"tTimed=", required_argument, NULL, 't'},
+                                    {"xSpeedup=", required_argument, NULL, 'x'},
+                                    {"dRandom=", required_argument, NULL, 'd'},
+                                    {"Verbose=", required_argument, NULL, 'v'},
+                                    {NULL, 0, NULL, 0}};
+
+    /* Initialize the command line options */
+    hand.in_trace   = TRACE_NAME;
+    hand.dset_name  = NULL;
+    hand.chunk_dim1 = CHUNK_DIM1;
+    hand.chunk_dim2 = CHUNK_DIM2;
+    hand.percent    = PERCENT;
+    hand.layout     = 0;
+    hand.t          = 0;
+    hand.speedup    = 1.0;
+    hand.d          = 1;
+    hand.v          = 0;
+
+    while ((opt = getopt_long(argc, argv, "hi:n:c:m:l:t:x:d:v:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'h':
+                fprintf(stdout, "Help page:\n");
+                usage();
+
+                exit(0);
+
+                break;
+            case 'i':
+                if (optarg) {
+                    fprintf(stdout, "Trace:\t\t\t\t\t\t\t%s\n", optarg);
+                    hand.in_trace = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'n':
+                if (optarg) {
+                    fprintf(stdout, "Dataset of the accesses:\t\t\t\t%s\n", optarg);
+                    hand.dset_name = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'c':
+                /* The dimensions of the chunks */
+                if (optarg) {
+                    parse_dims(optarg, &hand.chunk_dim1, &hand.chunk_dim2);
+                    fprintf(stdout, "Chunk dimensions:\t\t\t\t\t%lld x %lld\n", hand.chunk_dim1, hand.chunk_dim2);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'm':
+                if (optarg) {
+                    fprintf(stdout, "Percentage of data density:\t\t\t\t%s\n", optarg);
+                    hand.percent = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'l':
+                if (optarg) {
+                    hand.layout = atoi(optarg);
+                    if (hand.layout == 0)
+                        fprintf(stdout, "Layout:\t\t\t\t\t\t\tall layouts\n");
+                    else if (hand.layout >= LAYOUT_DENSE && hand.layout <= LAYOUT_STRUCT)
+                        fprintf(stdout, "Layout:\t\t\t\t\t\t\t%s\n", layout_names[hand.layout - 1]);
+                    else
+                        fprintf(stdout, "Layout:\t\t\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 't':
+                if (optarg) {
+                    hand.t = atoi(optarg);
+                    if (hand.t == 1)
+                        fprintf(stdout, "Timing of the accesses:\t\t\t\t\ttimes of the trace\n");
+                    else if (hand.t == 0)
+                        fprintf(stdout, "Timing of the accesses:\t\t\t\t\tback to back\n");
+                    else
+                        fprintf(stdout, "Timing of the accesses:\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'x':
+                if (optarg) {
+                    fprintf(stdout, "Speed-up of the trace:\t\t\t\t\t%s\n", optarg);
+                    hand.speedup = atof(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'd':
+                if (optarg) {
+                    hand.d = atoi(optarg);
+                    if (hand.d == 1)
+                        fprintf(stdout, "Options of data generation:\t\t\t\trandom values\n");
+                    else if (hand.d == 0)
+                        fprintf(stdout, "Options of data generation:\t\t\t\tcompressible values\n");
+                    else
+                        fprintf(stdout, "Options of data generation:\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'v':
+                if (optarg) {
+                    hand.v = atoi(optarg);
+                    if (hand.v == 1)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\ton\n");
+                    else if (hand.v == 0)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Verbose mode:\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case ':':
+                printf("Option needs a value\n");
+                break;
+            case '?':
+                printf("Unknown option: %c\n", optopt);
+                break;
+        }
+    }
+
+    /* optind is for the extra arguments which are not parsed */
+    for (; optind < argc; optind++) {
+        printf("extra arguments not parsed: %s\n", argv[optind]);
+    }
+
+    /* Make sure the command line options are valid */
+    if (hand.chunk_dim1 < 1 || hand.chunk_dim2 < 1) {
+        printf("The dimensions of the chunks must be positive\n");
+        exit(1);
+    }
+
+    if (hand.percent < 0 || hand.percent > 100) {
+        printf("The percentage of the data density isn't valid\n");
+        exit(1);
+    }
+
+    if (hand.layout < 0 || hand.layout > NUM_LAYOUTS) {
+        printf("The layout can only be 0 (all), 1 (dense), 2 (sparse-emulated) or 3 (structured)\n");
+        exit(1);
+    }
+
+    if (hand.t < 0 || hand.t > 1) {
+        printf("Timing flag can only be 0 (back to back) or 1 (times of the trace)\n");
+        exit(1);
+    }
+
+    if (hand.speedup <= 0) {
+        printf("The speed-up of the trace must be positive\n");
+        exit(1);
+    }
+
+    if (hand.d < 0 || hand.d > 1) {
+        printf("Data generation flag can only be 0 (compressible data) or 1 (random)\n");
+        exit(1);
+    }
+
+    if (hand.v < 0 || hand.v > 1) {
+        printf("Verbose flag can only be 0 or 1 \n");
+        exit(1);
+    }
+}
+
+/*------------------------------------------------------------
+ * Elapsed time
+ *------------------------------------------------------------
+ */
+double elapsed(struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*------------------------------------------------------------
+ * Parse the coordinates of the form AxBx... of an access;
+ * returns the rank or -1
+ *------------------------------------------------------------
+ */
+int parse_coords(char *str, hsize_t *coords)
+{
+    char *tok, *save;
+    int   rank = 0;
+
+    for (tok = strtok_r(str, "x", &save); tok; tok = strtok_r(NULL, "x", &save)) {
+        if (rank == SC_MAX_RANK)
+            return -1;
+        coords[rank++] = (hsize_t)strtoull(tok, NULL, 10);
+    }
+
+    return rank ? rank : -1;
+}
+
+/*------------------------------------------------------------
+ * Read the accesses of the trace and set the extent of the
+ * dataset
+ *------------------------------------------------------------
+ */
+int load_trace(void)
+{
+    FILE    *f;
+    char     line[MAX_LINE];
+    size_t   max_accesses = 1024;
+    int      i;
+
+    if (NULL == (f = fopen(hand.in_trace, "r"))) {
+        printf("Failed to open %s\n", hand.in_trace);
+        return -1;
+    }
+
+    accesses = (access_t *)malloc(max_accesses * sizeof(access_t));
+    dims[0]  = dims[1] = 0;
+
+    while (fgets(line, sizeof(line), f)) {
+        char      op[8], name[MAX_LINE], offset_str[MAX_LINE], count_str[MAX_LINE];
+        hsize_t   offset[SC_MAX_RANK], count[SC_MAX_RANK];
+        double    time;
+        int       rank, count_rank;
+        access_t *a;
+
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+        if (sscanf(line, "%lf %7s %s %s %s", &time, op, name, offset_str, count_str) != 5 ||
+            (op[0] != 'R' && op[0] != 'W')) {
+            printf("Invalid line in the trace: %s", line);
+            fclose(f);
+            return -1;
+        }
+        if (hand.dset_name && strcmp(name, hand.dset_name))
+            continue;
+
+        rank       = parse_coords(offset_str, offset);
+        count_rank = parse_coords(count_str, count);
+        if (rank < 1 || rank > RANK || rank != count_rank) {
+            nskipped++;
+            continue;
+        }
+
+        if (naccesses == max_accesses) {
+            max_accesses *= 2;
+            accesses = (access_t *)realloc(accesses, max_accesses * sizeof(access_t));
+        }
+        a        = &accesses[naccesses++];
+        a->time  = time;
+        a->write = op[0] == 'W';
+
+        /* A 1-dim access is replayed as one row */
+        if (rank == 1) {
+            a->offset[0] = 0;
+            a->count[0]  = 1;
+            a->offset[1] = offset[0];
+            a->count[1]  = count[0];
+        }
+        else
+            for (i = 0; i < RANK; i++) {
+                a->offset[i] = offset[i];
+                a->count[i]  = count[i];
+            }
+
+        for (i = 0; i < RANK; i++)
+            if (a->offset[i] + a->count[i] > dims[i])
+                dims[i] = a->offset[i] + a->count[i];
+    }
+    fclose(f);
+
+    if (naccesses == 0) {
+        printf("No accesses to replay in %s\n", hand.in_trace);
+        return -1;
+    }
+
+    /* The extent is a whole number of chunks */
+    grid[0] = (dims[0] + hand.chunk_dim1 - 1) / hand.chunk_dim1;
+    grid[1] = (dims[1] + hand.chunk_dim2 - 1) / hand.chunk_dim2;
+    dims[0] = grid[0] * hand.chunk_dim1;
+    dims[1] = grid[1] * hand.chunk_dim2;
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Value of the element "k" of a chunk or a hyperslab
+ *------------------------------------------------------------
+ */
+uint8_t element_value(uint64_t k)
+{
+    if (hand.d)
+        return (uint8_t)(rand() % UCHAR_MAX + 1);
+    return (uint8_t)((k + 1) % UCHAR_MAX);
+}
+
+/*------------------------------------------------------------
+ * Generate the initial elements of the chunks
+ *------------------------------------------------------------
+ */
+void generate_chunks(void)
+{
+    uint64_t size    = hand.chunk_dim1 * hand.chunk_dim2;
+    uint64_t nelemts = size * hand.percent / 100;
+    size_t   nchunks = grid[0] * grid[1];
+    size_t   i;
+    uint64_t n;
+
+    chunks = (chunk_t *)calloc(nchunks, sizeof(chunk_t));
+    for (i = 0; i < nchunks; i++) {
+        chunks[i].mask   = (uint8_t *)calloc(size, 1);
+        chunks[i].values = (uint8_t *)calloc(size, 1);
+        for (n = 0; n < nelemts; n++) {
+            uint64_t k = ((uint64_t)rand() * RAND_MAX + rand()) % size;
+
+            chunks[i].mask[k]   = 1;
+            chunks[i].values[k] = element_value(k);
+        }
+    }
+}
+
+/*------------------------------------------------------------
+ * Generate the elements of the hyperslab of a write
+ *------------------------------------------------------------
+ */
+void generate_block(const access_t *a)
+{
+    uint64_t size = a->count[0] * a->count[1];
+    uint64_t k;
+
+    for (k = 0; k < size; k++) {
+        block_mask[k]   = rand() % 100 < hand.percent;
+        block_values[k] = block_mask[k] ? element_value(k) : 0;
+    }
+}
+
+/*------------------------------------------------------------
+ * Grow a buffer to at least "size" bytes
+ *------------------------------------------------------------
+ */
+uint8_t *grow_buffer(uint8_t *buf, size_t *buf_size, size_t size)
+{
+    if (size > *buf_size) {
+        *buf_size = size;
+        buf       = (uint8_t *)realloc(buf, size);
+    }
+    return buf;
+}
+
+/*------------------------------------------------------------
+ * Copy the part of a dense chunk (or of the hyperslab buffer)
+ * that intersects the hyperslab into the hyperslab buffer (or
+ * into the chunk).  "c_off" is the offset of the chunk.
+ *------------------------------------------------------------
+ */
+void copy_intersection(const access_t *a, const hsize_t *c_off, uint8_t *chunk, uint8_t *block, int to_block)
+{
+    hsize_t r0 = a->offset[0] > c_off[0] ? a->offset[0] : c_off[0];
+    hsize_t r1 = a->offset[0] + a->count[0] < c_off[0] + hand.chunk_dim1 ? a->offset[0] + a->count[0]
+                                                                          : c_off[0] + hand.chunk_dim1;
+    hsize_t c0 = a->offset[1] > c_off[1] ? a->offset[1] : c_off[1];
+    hsize_t c1 = a->offset[1] + a->count[1] < c_off[1] + hand.chunk_dim2 ? a->offset[1] + a->count[1]
+                                                                          : c_off[1] + hand.chunk_dim2;
+    hsize_t r;
+
+    for (r = r0; r < r1; r++) {
+        uint8_t *c = chunk + (r - c_off[0]) * hand.chunk_dim2 + (c0 - c_off[1]);
+        uint8_t *b = block + (r - a->offset[0]) * a->count[1] + (c0 - a->offset[1]);
+
+        if (to_block)
+            memcpy(b, c, c1 - c0);
+        else
+            memcpy(c, b, c1 - c0);
+    }
+}
+
+/*------------------------------------------------------------
+ * Dense layout
+ *------------------------------------------------------------
+ */
+int dense_access(const access_t *a)
+{
+    hid_t  file_space, mem_space;
+    herr_t status;
+
+    file_space = H5Dget_space(dense_dset);
+    mem_space  = H5Screate_simple(RANK, a->count, NULL);
+    H5Sselect_hyperslab(file_space, H5S_SELECT_SET, a->offset, NULL, a->count, NULL);
+
+    if (a->write)
+        status = H5Dwrite(dense_dset, H5T_NATIVE_UCHAR, mem_space, file_space, H5P_DEFAULT, block_values);
+    else
+        status = H5Dread(dense_dset, H5T_NATIVE_UCHAR, mem_space, file_space, H5P_DEFAULT, read_buf);
+
+    H5Sclose(mem_space);
+    H5Sclose(file_space);
+
+    return status < 0 ? -1 : 0;
+}
+
+/*------------------------------------------------------------
+ * Sparse-emulated layout: read the selection and the data of
+ * a chunk into chunk_values and, if "with_mask", the defined
+ * elements into chunk_mask
+ *------------------------------------------------------------
+ */
+int sparse_read_chunk(size_t index, int with_mask)
+{
+    hid_t    space;
+    hsize_t  sel_size;
+    hssize_t npoints;
+    size_t   size = hand.chunk_dim1 * hand.chunk_dim2;
+
+    space = H5Dget_space(sel_dsets[index]);
+    H5Sget_simple_extent_dims(space, &sel_size, NULL);
+    H5Sclose(space);
+
+    sel_buf = grow_buffer(sel_buf, &sel_buf_size, sel_size);
+    if (H5Dread(sel_dsets[index], H5T_NATIVE_UCHAR, H5S_ALL, H5S_ALL, H5P_DEFAULT, sel_buf) < 0)
+        return -1;
+    if ((space = H5Sdecode(sel_buf)) < 0)
+        return -1;
+
+    /* Scatter the defined elements into the chunk */
+    memset(chunk_values, 0, size);
+    npoints = H5Sget_select_npoints(space);
+    if (npoints > 0 && H5Dread(data_dsets[index], H5T_NATIVE_UCHAR, space, H5S_ALL, H5P_DEFAULT, chunk_values) < 0)
+        goto error;
+
+    if (with_mask) {
+        memset(chunk_mask, 0, size);
+        if (npoints > 0 && H5Sget_select_type(space) == H5S_SEL_HYPERSLABS) {
+            hssize_t nblocks = H5Sget_select_hyper_nblocks(space);
+            hsize_t *blocks  = (hsize_t *)malloc(nblocks * 2 * RANK * sizeof(hsize_t));
+            hssize_t b;
+            hsize_t  r;
+
+            H5Sget_select_hyper_blocklist(space, 0, (hsize_t)nblocks, blocks);
+            for (b = 0; b < nblocks; b++) {
+                hsize_t *block = blocks + b * 2 * RANK;
+
+                for (r = block[0]; r <= block[2]; r++)
+                    memset(chunk_mask + r * hand.chunk_dim2 + block[1], 1, block[3] - block[1] + 1);
+            }
+            free(blocks);
+        }
+    }
+
+    H5Sclose(space);
+    return 0;
+
+error:
+    H5Sclose(space);
+    return -1;
+}
+
+/*------------------------------------------------------------
+ * Sparse-emulated layout: build the selection of the defined
+ * elements of a chunk and rewrite its selection and data
+ *------------------------------------------------------------
+ */
+int sparse_write_chunk(size_t index, const uint8_t *mask, const uint8_t *values)
+{
+    hid_t   space;
+    hsize_t chunk_dims[RANK];
+    hsize_t offset[RANK], block[RANK];
+    hsize_t nelemts = 0;
+    size_t  nalloc  = 0;
+    size_t  size    = hand.chunk_dim1 * hand.chunk_dim2;
+    size_t  nruns, n;
+
+    chunk_dims[0] = hand.chunk_dim1;
+    chunk_dims[1] = hand.chunk_dim2;
+    space         = H5Screate_simple(RANK, chunk_dims, NULL);
+    H5Sselect_none(space);
+
+    nruns = sc_mask_to_runs(mask, size, hand.chunk_dim2, runs);
+    for (n = 0; n < nruns; n++) {
+        offset[0] = runs[n].start / hand.chunk_dim2;
+        offset[1] = runs[n].start % hand.chunk_dim2;
+        block[0]  = 1;
+        block[1]  = runs[n].len;
+        H5Sselect_hyperslab(space, H5S_SELECT_OR, offset, NULL, block, NULL);
+        nelemts += runs[n].len;
+    }
+
+    H5Sencode(space, NULL, &nalloc, H5P_DEFAULT);
+    sel_buf = grow_buffer(sel_buf, &sel_buf_size, nalloc);
+    H5Sencode(space, sel_buf, &nalloc, H5P_DEFAULT);
+
+    block[0] = (hsize_t)nalloc;
+    if (H5Dset_extent(sel_dsets[index], block) < 0 ||
+        H5Dwrite(sel_dsets[index], H5T_NATIVE_UCHAR, H5S_ALL, H5S_ALL, H5P_DEFAULT, sel_buf) < 0)
+        goto error;
+    if (H5Dset_extent(data_dsets[index], &nelemts) < 0)
+        goto error;
+    if (nelemts > 0 && H5Dwrite(data_dsets[index], H5T_NATIVE_UCHAR, space, H5S_ALL, H5P_DEFAULT, values) < 0)
+        goto error;
+
+    H5Sclose(space);
+    return 0;
+
+error:
+    H5Sclose(space);
+    return -1;
+}
+
+/*------------------------------------------------------------
+ * Structured layout: read a chunk and decode its Encoded
+ * Selection into runs; the packed values are in data_buf
+ *------------------------------------------------------------
+ */
+int struct_read_chunk(const hsize_t *offset, size_t *nruns)
+{
+    sc_chunk_info_t info;
+    hsize_t         image_size;
+    hsize_t         chunk_dims[SC_MAX_RANK];
+    uint32_t        filters;
+    void           *buf[2];
+    int             rank;
+
+    if (H5Dget_chunk_storage_size(struct_dset, offset, &image_size) < 0)
+        return -1;
+    image_buf = grow_buffer(image_buf, &image_buf_size, image_size);
+    if (H5Dread_chunk(struct_dset, H5P_DEFAULT, offset, &filters, image_buf) < 0)
+        return -1;
+
+    if (sc_disassemble_chunk(image_buf, image_size, &info, NULL) < 0)
+        return -1;
+    sel_buf                   = grow_buffer(sel_buf, &sel_buf_size, info.section_orig_size[SC_SECTION_SELECTION]);
+    data_buf                  = grow_buffer(data_buf, &data_buf_size, info.section_orig_size[SC_SECTION_FIXED] + 1);
+    buf[SC_SECTION_SELECTION] = sel_buf;
+    buf[SC_SECTION_FIXED]     = data_buf;
+    if (sc_disassemble_chunk(image_buf, image_size, &info, buf) < 0)
+        return -1;
+
+    return sc_decode_runs(sel_buf, info.section_orig_size[SC_SECTION_SELECTION], &rank, chunk_dims, nruns, runs);
+}
+
+/*------------------------------------------------------------
+ * Structured layout: encode the runs of the defined elements
+ * of a chunk and rewrite the chunk
+ *------------------------------------------------------------
+ */
+int struct_write_chunk(const hsize_t *offset, const uint8_t *mask, const uint8_t *values)
+{
+    sc_chunk_info_t info;
+    hsize_t         chunk_dims[RANK];
+    uint64_t        size    = hand.chunk_dim1 * hand.chunk_dim2;
+    uint64_t        nelemts = 0;
+    size_t          nruns, n;
+    const void     *buf[2];
+
+    chunk_dims[0] = hand.chunk_dim1;
+    chunk_dims[1] = hand.chunk_dim2;
+
+    nruns = sc_mask_to_runs(mask, size, hand.chunk_dim2, runs);
+    for (n = 0; n < nruns; n++)
+        nelemts += runs[n].len;
+
+    memset(&info, 0, sizeof(info));
+    info.type                                    = SC_SPARSE_CHUNK;
+    info.num_sections                            = 2;
+    info.nelemts                                 = nelemts;
+    info.section_orig_size[SC_SECTION_SELECTION] = sc_encode_runs(RANK, chunk_dims, nruns, runs, NULL);
+    info.section_orig_size[SC_SECTION_FIXED]     = nelemts;
+
+    sel_buf  = grow_buffer(sel_buf, &sel_buf_size, info.section_orig_size[SC_SECTION_SELECTION]);
+    data_buf = grow_buffer(data_buf, &data_buf_size, nelemts + 1);
+    sc_encode_runs(RANK, chunk_dims, nruns, runs, sel_buf);
+    sc_gather_runs(values, 1, nruns, runs, data_buf);
+
+    buf[SC_SECTION_SELECTION] = sel_buf;
+    buf[SC_SECTION_FIXED]     = data_buf;
+
+    return sc_write_struct_chunk(struct_dset, H5P_DEFAULT, &info, offset, buf);
+}
+
+/*------------------------------------------------------------
+ * Sparse-emulated and structured layouts: an access visits
+ * the chunks that intersect the hyperslab.  A read copies the
+ * intersection into read_buf; a write reads the chunk, merges
+ * the hyperslab and rewrites the chunk.
+ *------------------------------------------------------------
+ */
+int chunked_access(int layout, const access_t *a)
+{
+    hsize_t g0, g1;
+    hsize_t c_off[RANK];
+    size_t  size = hand.chunk_dim1 * hand.chunk_dim2;
+
+    if (!a->write)
+        memset(read_buf, 0, a->count[0] * a->count[1]);
+
+    for (g0 = a->offset[0] / hand.chunk_dim1; g0 <= (a->offset[0] + a->count[0] - 1) / hand.chunk_dim1; g0++)
+        for (g1 = a->offset[1] / hand.chunk_dim2; g1 <= (a->offset[1] + a->count[1] - 1) / hand.chunk_dim2; g1++) {
+            size_t index = g0 * grid[1] + g1;
+
+            c_off[0] = g0 * hand.chunk_dim1;
+            c_off[1] = g1 * hand.chunk_dim2;
+
+            if (layout == LAYOUT_SPARSE) {
+                if (sparse_read_chunk(index, a->write) < 0)
+                    return -1;
+                if (!a->write) {
+                    copy_intersection(a, c_off, chunk_values, read_buf, 1);
+                    continue;
+                }
+            }
+            else {
+                size_t   nruns, n;
+                uint64_t pos = 0;
+
+                if (struct_read_chunk(c_off, &nruns) < 0)
+                    return -1;
+
+                if (!a->write) {
+                    /* Copy the parts of the runs in the hyperslab from the packed values */
+                    for (n = 0; n < nruns; n++) {
+                        hsize_t r  = c_off[0] + runs[n].start / hand.chunk_dim2;
+                        hsize_t c0 = c_off[1] + runs[n].start % hand.chunk_dim2;
+                        hsize_t c1 = c0 + runs[n].len;
+                        hsize_t lo = c0 > a->offset[1] ? c0 : a->offset[1];
+                        hsize_t hi = c1 < a->offset[1] + a->count[1] ? c1 : a->offset[1] + a->count[1];
+
+                        if (r >= a->offset[0] && r < a->offset[0] + a->count[0] && lo < hi)
+                            memcpy(read_buf + (r - a->offset[0]) * a->count[1] + (lo - a->offset[1]),
+                                   data_buf + pos + (lo - c0), hi - lo);
+                        pos += runs[n].len;
+                    }
+                    continue;
+                }
+
+                /* Scatter the runs into the chunk */
+                memset(chunk_mask, 0, size);
+                memset(chunk_values, 0, size);
+                for (n = 0; n < nruns; n++) {
+                    memset(chunk_mask + runs[n].start, 1, runs[n].len);
+                    memcpy(chunk_values + runs[n].start, data_buf + pos, runs[n].len);
+                    pos += runs[n].len;
+                }
+            }
+
+            /* Merge the written hyperslab and rewrite the chunk */
+            copy_intersection(a, c_off, chunk_mask, block_mask, 0);
+            copy_intersection(a, c_off, chunk_values, block_values, 0);
+            if (layout == LAYOUT_SPARSE) {
+                if (sparse_write_chunk(index, chunk_mask, chunk_values) < 0)
+                    return -1;
+            }
+            else if (struct_write_chunk(c_off, chunk_mask, chunk_values) < 0)
+                return -1;
+        }
+
+    return 0;
+}
+
+/*------------------------------------------------------------
+ * Create the file of a layout with the initial chunks
+ *------------------------------------------------------------
+ */
+int create_layout(int layout, const char *file_name)
+{
+    hid_t   file, dcpl, dataspace;
+    hsize_t chunk_dims[RANK], c_off[RANK], count[RANK];
+    hsize_t zero = 0, unlimited = H5S_UNLIMITED, sel_chunk = SELECTION_CHUNK_SIZE;
+    hsize_t data_chunk = hand.chunk_dim1 * hand.chunk_dim2;
+    size_t  nchunks    = grid[0] * grid[1];
+    size_t  i;
+    char    name[64];
+    int     status = 0;
+
+    file          = H5Fcreate(file_name, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    chunk_dims[0] = count[0] = hand.chunk_dim1;
+    chunk_dims[1] = count[1] = hand.chunk_dim2;
+
+    if (layout == LAYOUT_DENSE) {
+        hid_t mem_space = H5Screate_simple(RANK, chunk_dims, NULL);
+
+        dcpl       = H5Pcreate(H5P_DATASET_CREATE);
+        H5Pset_chunk(dcpl, RANK, chunk_dims);
+        dataspace  = H5Screate_simple(RANK, dims, NULL);
+        dense_dset = H5Dcreate2(file, DENSE_DSET_NAME, H5T_STD_U8LE, dataspace, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+
+        for (i = 0; i < nchunks && status == 0; i++) {
+            c_off[0] = (i / grid[1]) * hand.chunk_dim1;
+            c_off[1] = (i % grid[1]) * hand.chunk_dim2;
+            H5Sselect_hyperslab(dataspace, H5S_SELECT_SET, c_off, NULL, count, NULL);
+            status = H5Dwrite(dense_dset, H5T_NATIVE_UCHAR, mem_space, dataspace, H5P_DEFAULT, chunks[i].values);
+        }
+
+        H5Sclose(mem_space);
+        H5Dclose(dense_dset);
+    }
+    else if (layout == LAYOUT_SPARSE) {
+        hid_t sel_dcpl;
+
+        sel_dsets  = (hid_t *)malloc(nchunks * sizeof(hid_t));
+        data_dsets = (hid_t *)malloc(nchunks * sizeof(hid_t));
+        dataspace  = H5Screate_simple(1, &zero, &unlimited);
+        sel_dcpl   = H5Pcreate(H5P_DATASET_CREATE);
+        dcpl       = H5Pcreate(H5P_DATASET_CREATE);
+        H5Pset_chunk(sel_dcpl, 1, &sel_chunk);
+        H5Pset_chunk(dcpl, 1, &data_chunk);
+
+        for (i = 0; i < nchunks && status == 0; i++) {
+            sprintf(name, "%s%zu", SELECTION_PREFIX, i);
+            sel_dsets[i] = H5Dcreate2(file, name, H5T_STD_U8LE, dataspace, H5P_DEFAULT, sel_dcpl, H5P_DEFAULT);
+            sprintf(name, "%s%zu", DATA_PREFIX, i);
+            data_dsets[i] = H5Dcreate2(file, name, H5T_STD_U8LE, dataspace, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+            status        = sparse_write_chunk(i, chunks[i].mask, chunks[i].values);
+            H5Dclose(sel_dsets[i]);
+            H5Dclose(data_dsets[i]);
+        }
+
+        H5Pclose(sel_dcpl);
+    }
+    else {
+        dcpl        = sc_create_dcpl(RANK, chunk_dims);
+        dataspace   = H5Screate_simple(RANK, dims, NULL);
+        struct_dset = H5Dcreate2(file, STRUCT_DSET_NAME, H5T_STD_U8LE, dataspace, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+
+        for (i = 0; i < nchunks && status == 0; i++) {
+            c_off[0] = (i / grid[1]) * hand.chunk_dim1;
+            c_off[1] = (i % grid[1]) * hand.chunk_dim2;
+            status   = struct_write_chunk(c_off, chunks[i].mask, chunks[i].values);
+        }
+
+        H5Dclose(struct_dset);
+    }
+
+    H5Sclose(dataspace);
+    H5Pclose(dcpl);
+    H5Fclose(file);
+
+    return status < 0 ? -1 : 0;
+}
+
+/*------------------------------------------------------------
+ * Replay the trace against the file of a layout
+ *------------------------------------------------------------
+ */
+int replay_layout(int layout, const char *file_name)
+{
+    result_t       *r       = &res[layout - 1];
+    size_t          nchunks = grid[0] * grid[1];
+    hid_t           file;
+    hsize_t         size;
+    size_t          i;
+    char            name[64];
+    int             status  = 0;
+    struct timespec base, start;
+
+    file = H5Fopen(file_name, H5F_ACC_RDWR, H5P_DEFAULT);
+    if (layout == LAYOUT_DENSE)
+        dense_dset = H5Dopen2(file, DENSE_DSET_NAME, H5P_DEFAULT);
+    else if (layout == LAYOUT_SPARSE)
+        for (i = 0; i < nchunks; i++) {
+            sprintf(name, "%s%zu", SELECTION_PREFIX, i);
+            sel_dsets[i] = H5Dopen2(file, name, H5P_DEFAULT);
+            sprintf(name, "%s%zu", DATA_PREFIX, i);
+            data_dsets[i] = H5Dopen2(file, name, H5P_DEFAULT);
+        }
+    else
+        struct_dset = H5Dopen2(file, STRUCT_DSET_NAME, H5P_DEFAULT);
+
+    /* The writes generate the same elements for all layouts */
+    srand(3);
+    r->latency  = (double *)malloc(naccesses * sizeof(double));
+    r->checksum = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &base);
+    for (i = 0; i < naccesses && status == 0; i++) {
+        const access_t *a = &accesses[i];
+
+        if (a->write)
+            generate_block(a);
+
+        if (hand.t) {
+            double scheduled = (a->time - accesses[0].time) / hand.speedup;
+
+            /* Wait for the time of the access; a late access starts now and its latency includes the delay */
+            start.tv_sec  = base.tv_sec + (time_t)scheduled;
+            start.tv_nsec = base.tv_nsec + (long)((scheduled - (time_t)scheduled) * 1e9);
+            if (start.tv_nsec >= 1000000000L) {
+                start.tv_sec++;
+                start.tv_nsec -= 1000000000L;
+            }
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &start, NULL);
+        }
+        else
+            clock_gettime(CLOCK_MONOTONIC, &start);
+
+        if (layout == LAYOUT_DENSE)
+            status = dense_access(a);
+        else
+            status = chunked_access(layout, a);
+        r->latency[i] = elapsed(&start);
+
+        if (!a->write) {
+            uint64_t k, n = a->count[0] * a->count[1];
+
+            for (k = 0; k < n; k++)
+                r->checksum += (k + 1) * read_buf[k];
+        }
+    }
+    r->seconds = elapsed(&base);
+
+    if (status < 0)
+        printf("Failed to replay access %zu with the %s layout\n", i, layout_names[layout - 1]);
+
+    /* Storage of the dataset(s) */
+    r->storage = 0;
+    if (layout == LAYOUT_DENSE) {
+        r->storage = (long long int)H5Dget_storage_size(dense_dset);
+        H5Dclose(dense_dset);
+    }
+    else if (layout == LAYOUT_SPARSE)
+        for (i = 0; i < nchunks; i++) {
+            r->storage += (long long int)(H5Dget_storage_size(sel_dsets[i]) + H5Dget_storage_size(data_dsets[i]));
+            H5Dclose(sel_dsets[i]);
+            H5Dclose(data_dsets[i]);
+        }
+    else {
+        r->storage = (long long int)H5Dget_storage_size(struct_dset);
+        H5Dclose(struct_dset);
+    }
+    H5Fclose(file);
+
+    /* The file size is measured after closing to include the metadata */
+    file = H5Fopen(file_name, H5F_ACC_RDONLY, H5P_DEFAULT);
+    H5Fget_filesize(file, &size);
+    r->file = (long long int)size;
+    H5Fclose(file);
+
+    return status < 0 ? -1 : 0;
+}
+
+int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+/*------------------------------------------------------------
+ * Print the latency percentiles of the reads (op 0), writes
+ * (op 1) or all accesses (op 2) of a layout
+ *------------------------------------------------------------
+ */
+void print_latencies(int layout, int op)
+{
+    result_t     *r       = &res[layout - 1];
+    double       *lat     = (double *)malloc(naccesses * sizeof(double));
+    double        sum     = 0;
+    long long int elemts  = 0;
+    size_t        n       = 0;
+    size_t        i;
+    double        p[4]    = {0.5, 0.9, 0.99, 0.999};
+    double        q[4];
+    const char   *ops[3]  = {"R", "W", "A"};
+    int           j;
+
+    for (i = 0; i < naccesses; i++)
+        if (op == 2 || accesses[i].write == op) {
+            lat[n++] = r->latency[i];
+            sum += r->latency[i];
+            elemts += accesses[i].count[0] * accesses[i].count[1];
+        }
+
+    if (n > 0) {
+        qsort(lat, n, sizeof(double), cmp_double);
+
+        /* Nearest-rank percentiles */
+        for (j = 0; j < 4; j++) {
+            size_t rank = (size_t)(p[j] * n + 0.999999);
+
+            q[j] = lat[(rank ? rank : 1) - 1] * 1e6;
+        }
+        printf("%10s %10s %10zu %10.1f %10.1f %10.1f %10.1f %10.1f %10.3g \n", layout_names[layout - 1], ops[op], n,
+               q[0], q[1], q[2], q[3], lat[n - 1] * 1e6, sum > 0 ? elemts / sum : 0.0);
+    }
+
+    free(lat);
+}
+
+/*------------------------------------------------------------
+ * Print storage and latencies
+ *------------------------------------------------------------
+ */
+void print_results(void)
+{
+    size_t nreads = 0;
+    size_t i;
+    int    layout, op;
+
+    for (i = 0; i < naccesses; i++)
+        nreads += !accesses[i].write;
+
+    printf("\n");
+    printf("Printing the number of accesses replayed (NA), reads (NR), writes (NW), accesses skipped (NS), the extent\n");
+    printf("of the dataset (D1, D2) and the duration of the trace in seconds (TT)\n");
+    printf("\n");
+    printf("        NA         NR         NW         NS         D1         D2         TT\n");
+    printf("\n");
+    printf("%10zu %10zu %10zu %10zu %10llu %10llu %10.4f \n", naccesses, nreads, naccesses - nreads, nskipped,
+           (unsigned long long)dims[0], (unsigned long long)dims[1], accesses[naccesses - 1].time - accesses[0].time);
+
+    printf("\n");
+    printf("Printing the storage of the dataset(s) (SS) and the file size (FS) in bytes after the replay, the time of\n");
+    printf("the replay in seconds (T) and the checksum of the data read (CHK) of each layout\n");
+    printf("\n");
+    printf("    layout         SS         FS          T                  CHK\n");
+    printf("\n");
+    for (layout = LAYOUT_DENSE; layout <= LAYOUT_STRUCT; layout++)
+        if (hand.layout == 0 || hand.layout == layout)
+            printf("%10s %10lli %10lli %10.4f %20llu \n", layout_names[layout - 1], res[layout - 1].storage,
+                   res[layout - 1].file, res[layout - 1].seconds, (unsigned long long)res[layout - 1].checksum);
+
+    printf("\n");
+    printf("Printing the latency percentiles P50, P90, P99, P99.9 and the maximum (MAX) in microseconds of the\n");
+    printf("reads (R), writes (W) and all accesses (A) of each layout, their number (N) and the elements accessed\n");
+    printf("per second of latency (EPS)\n");
+    printf("\n");
+    printf("    layout         op          N        P50        P90        P99      P99.9        MAX        EPS\n");
+    printf("\n");
+    for (layout = LAYOUT_DENSE; layout <= LAYOUT_STRUCT; layout++)
+        if (hand.layout == 0 || hand.layout == layout)
+            for (op = 0; op < 3; op++)
+                print_latencies(layout, op);
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Main function
+ *------------------------------------------------------------
+ */
+int
+main(int argc, char **argv)
+{
+    const char *file_names[NUM_LAYOUTS] = {DENSE_FILE_NAME, SPARSE_FILE_NAME, STRUCT_FILE_NAME};
+    size_t      size, max_block = 1;
+    size_t      i;
+    int         layout;
+
+    parse_command_line(argc, argv);
+
+    if (load_trace() < 0)
+        return 1;
+
+    /* Use the same seed for reproducibility of the results */
+    srand(2);
+    generate_chunks();
+
+    size = hand.chunk_dim1 * hand.chunk_dim2;
+    for (i = 0; i < naccesses; i++)
+        if (accesses[i].count[0] * accesses[i].count[1] > max_block)
+            max_block = accesses[i].count[0] * accesses[i].count[1];
+    block_mask   = (uint8_t *)malloc(max_block);
+    block_values = (uint8_t *)malloc(max_block);
+    read_buf     = (uint8_t *)malloc(max_block);
+    chunk_mask   = (uint8_t *)malloc(size);
+    chunk_values = (uint8_t *)malloc(size);
+    runs         = (sc_run_t *)malloc(size * sizeof(sc_run_t));
+
+    for (layout = LAYOUT_DENSE; layout <= LAYOUT_STRUCT; layout++) {
+        if (hand.layout != 0 && hand.layout != layout)
+            continue;
+
+        if (hand.v) printf("Creating %s with the %s layout\n", file_names[layout - 1], layout_names[layout - 1]);
+        if (create_layout(layout, file_names[layout - 1]) < 0) {
+            printf("Failed to create %s\n", file_names[layout - 1]);
+            return 1;
+        }
+
+        if (hand.v) printf("Replaying %zu accesses\n", naccesses);
+        if (replay_layout(layout, file_names[layout - 1]) < 0)
+            return 1;
+    }
+
+    if (hand.v) printf("Done! \n");
+
+    /* Print results */
+    print_results();
+
+    for (i = 0; i < grid[0] * grid[1]; i++) {
+        free(chunks[i].mask);
+        free(chunks[i].values);
+    }
+    free(chunks);
+    for (layout = 0; layout < NUM_LAYOUTS; layout++)
+        free(res[layout].latency);
+    free(accesses);
+    free(sel_dsets);
+    free(data_dsets);
+    free(block_mask);
+    free(block_values);
+    free(read_buf);
+    free(chunk_mask);
+    free(chunk_values);
+    free(sel_buf);
+    free(data_buf);
+    free(image_buf);
+    free(runs);
+
+    return 0;
+}
@@ -0,0 +1,495 @@
+/*
+ * This program compares blocking chunk-at-a-time reads of a structured chunk dataset with an io_uring
+ * engine that submits the reads of all chunks in one batch (sc_uring_read_chunks in structured_chunk.h).
+ *
+ * The chunks of the dataset (option -n) are read in their logical order and each chunk is decoded as
+ * soon as it has been read: the checksum of the Encoded Selection is verified, filtered sections are
+ * decompressed and the values of the defined elements are summed.  Three read engines are compared:
+ *
+ *  - sec2: H5Dread_chunk through the HDF5 POSIX driver, one blocking read per chunk;
+ *  - pread: one blocking pread per chunk at the address of the chunk in the file;
+ *  - io_uring: up to QD reads are outstanding at any time; the chunks are decoded while the other
+ *    reads are in progress.  The queue depths 1, 2, 4, ... up to the option -q are measured.
+ *
+ * The file pages are dropped from the page cache with posix_fadvise before each pass (option -c), so
+ * that every read goes to the device.  With the option -o 1 the pread and io_uring engines open the
+ * file with O_DIRECT and read whole blocks around each chunk; the file system has to support it.  Each
+ * pass is repeated R times (option -r) and the best time is reported.  The speedups are relative to
+ * the sec2 driver.  The io_uring engine needs Linux 5.6 or later and is used without liburing.
+ *
+ * Use small chunks to see the cost of the system call per read, e.g. a file generated by alloc.c with
+ * chunks of 64x64 elements.
+ *
+ * To compile the program, please use h5cc.  The -h option lists all the command line options:
+ *
+ *   [-h] [-i --inFile] [-n --nameDset] [-q --qDepth] [-o --oDirect] [-c --cCold] [-r --rRepeat]
+ *   [-v --Verbose]
+ *
+ * Example: The commands
+ *
+ *           h5cc alloc.c -o alloc
+ *           h5cc -O2 uring_read.c -o uring_read
+ *           ./alloc -c 64x64 -g 64x64 -n 1
+ *           ./uring_read -i alloc_file.h5 -q 64
+ *
+ * read the 4096 chunks of 64x64 elements with the three engines and queue depths from 1 to 64.
+ */
+
+#define _GNU_SOURCE                     /* O_DIRECT */
+
+#include "hdf5.h"
+#include "structured_chunk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <getopt.h>
+
+#ifndef SC_HAVE_URING
+#error "uring_read.c needs Linux with io_uring"
+#endif
+
+#define FILE_NAME                       "alloc_file.h5"
+#define DSET_NAME                       "sparse"
+#define QUEUE_DEPTH                     32
+#define MAX_QUEUE_DEPTH                 4096
+#define MAX_ENGINES                     16
+#define REPEAT                          3
+#define DIRECT_ALIGN                    4096        /* Alignment of O_DIRECT reads */
+
+typedef struct {
+    char           *in_file;
+    char           *dset_name;
+    int             depth;           /* maximum queue depth of the io_uring engine */
+    int             o;               /* flag to open the file with O_DIRECT */
+    int             c;               /* flag to drop the page cache before each pass */
+    int             repeat;
+    int             v;               /* prints progress messages */
+} handler_t;
+
+typedef struct {
+    const char     *engine;
+    int             depth;           /* number of outstanding reads */
+    double          time;            /* best time of a pass */
+    uint64_t        sum;             /* sum of the decoded values */
+} result_t;
+
+/* Buffers for the sections of the chunk being decoded */
+typedef struct {
+    void           *buf[SC_MAX_SECTIONS];
+    size_t          cap[SC_MAX_SECTIONS];
+    uint64_t        sum;
+} decode_t;
+
+handler_t    hand;
+result_t     res[MAX_ENGINES];
+
+/*------------------------------------------------------------
+ * Display command line usage
+ *------------------------------------------------------------
+ */
+void
+usage(void)
+{
+    printf("    [-h] [-i --inFile] [-n --nameDset] [-q --qDepth] [-o --oDirect] [-c --cCold] [-r --rRepeat]\n");
+    printf("    [-v --Verbose]\n");
+    printf("    [-h --help]: this help page\n");
+    printf("    [-i --inFile]: the file to read (default %s)\n", FILE_NAME);
+    printf("    [-n --nameDset]: the name of the structured chunk dataset (default %s)\n", DSET_NAME);
+    printf("    [-q --qDepth]: the maximum number of outstanding io_uring reads (default %d)\n", QUEUE_DEPTH);
+    printf("    [-o --oDirect]: read with O_DIRECT (1); default read through the page cache (0)\n");
+    printf("    [-c --cCold]: drop the page cache before each pass (1, default) or read with a warm cache (0)\n");
+    printf("    [-r --rRepeat]: the number of passes over the data for each engine\n");
+    printf("    [-v --Verbose]: Print progress messages(1); default no messages displayed (0) \n");
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Parse command line option
+ *------------------------------------------------------------
+ */
+void
+parse_command_line(int argc, char *argv[])
+{
+    int           opt;
+    struct option long_options[] = {
+                                    {"help", no_argument, NULL, 'h'},
+                                    {"inFile=", required_argument, NULL, 'i'},
+                                    {"nameDset=", required_argument, NULL, 'n'},
+                                    {"qDepth=", required_argument, NULL, 'q'},
+                                    {"oDirect=", required_argument, NULL, 'o'},
+                                    {"cCold=", required_argument, NULL, 'c'},
+                                    {"rRepeat=", required_argument, NULL, 'r'},
+                                    {"Verbose=", required_argument, NULL, 'v'},
+                                    {NULL, 0, NULL, 0}};
+
+    /* Initialize the command line options */
+    hand.in_file   = FILE_NAME;
+    hand.dset_name = DSET_NAME;
+    hand.depth     = QUEUE_DEPTH;
+    hand.o         = 0;
+    hand.c         = 1;
+    hand.repeat    = REPEAT;
+    hand.v         = 0;
+
+    while ((opt = getopt_long(argc, argv, "hi:n:q:o:c:r:v:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'h':
+                fprintf(stdout, "Help page:\n");
+                usage();
+
+                exit(0);
+
+                break;
+            case 'i':
+                if (optarg) {
+                    fprintf(stdout, "Input file:\t\t\t\t\t\t%s\n", optarg);
+                    hand.in_file = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'n':
+                if (optarg) {
+                    fprintf(stdout, "Dataset:\t\t\t\t\t\t%s\n", optarg);
+                    hand.dset_name = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'q':
+                if (optarg) {
+                    fprintf(stdout, "Maximum queue depth:\t\t\t\t\t%s\n", optarg);
+                    hand.depth = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'o':
+                if (optarg) {
+                    hand.o = atoi(optarg);
+                    if (hand.o == 1)
+                        fprintf(stdout, "O_DIRECT: \t\t\t\t\t\ton\n");
+                    else if (hand.o == 0)
+                        fprintf(stdout, "O_DIRECT: \t\t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "O_DIRECT:\t\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'c':
+                if (optarg) {
+                    hand.c = atoi(optarg);
+                    if (hand.c == 1)
+                        fprintf(stdout, "Cold page cache: \t\t\t\t\ton\n");
+                    else if (hand.c == 0)
+                        fprintf(stdout, "Cold page cache: \t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Cold page cache:\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'r':
+                if (optarg) {
+                    fprintf(stdout, "Number of passes:\t\t\t\t\t%s\n", optarg);
+                    hand.repeat = atoi(optarg);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'v':
+                if (optarg) {
+                    hand.v = atoi(optarg);
+                    if (hand.v == 1)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\ton\n");
+                    else if (hand.v == 0)
+                        fprintf(stdout, "Verbose mode: \t\t\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "Verbose mode:\t\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case ':':
+                printf("Option needs a value\n");
+                break;
+            case '?':
+                printf("Unknown option: %c\n", optopt);
+                break;
+        }
+    }
+
+    /* optind is for the extra arguments which are not parsed */
+    for (; optind < argc; optind++) {
+        printf("extra arguments not parsed: %s\n", argv[optind]);
+    }
+
+    /* Make sure the command line options are valid */
+    if (hand.depth < 1 || hand.depth > MAX_QUEUE_DEPTH) {
+        printf("The queue depth must be between 1 and %d\n", MAX_QUEUE_DEPTH);
+        exit(1);
+    }
+
+    if (hand.o < 0 || hand.o > 1) {
+        printf("O_DIRECT flag can only be 0 or 1 \n");
+        exit(1);
+    }
+
+    if (hand.c < 0 || hand.c > 1) {
+        printf("Cold cache flag can only be 0 or 1 \n");
+        exit(1);
+    }
+
+    if (hand.repeat < 1) {
+        printf("The number of passes must be positive\n");
+        exit(1);
+    }
+
+    if (hand.v < 0 || hand.v > 1) {
+        printf("Verbose flag can only be 0 or 1 \n");
+        exit(1);
+    }
+}
+
+/*------------------------------------------------------------
+ * Print the time, IOPS, throughput and speedup of the engines
+ *------------------------------------------------------------
+ */
+void print_results(int nres, size_t nchunks, long long int bytes)
+{
+    int   i;
+    float mb = (float)bytes / (1024 * 1024);
+
+    printf("\n");
+    printf("Printing for %zu chunks of %lli bytes in total the read engine, number of outstanding reads (QD),\n",
+           nchunks, bytes);
+    printf("time in seconds (T), chunk reads per second (IOPS), read throughput in MiB/s (RT) and speedup\n");
+    printf("over the sec2 driver (SU)\n");
+    printf("\n");
+    printf("    engine         QD          T       IOPS         RT         SU\n");
+    printf("\n");
+
+    for (i = 0; i < nres; i++)
+        printf("%10s %10d %10.4f %10.0f %10.1f %10.2f \n", res[i].engine, res[i].depth, res[i].time,
+               (double)nchunks / res[i].time, mb / res[i].time, res[0].time / res[i].time);
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Elapsed time
+ *------------------------------------------------------------
+ */
+double elapsed(struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*------------------------------------------------------------
+ * Drop the pages of a file from the page cache
+ *------------------------------------------------------------
+ */
+void drop_cache(const char *file_name)
+{
+    int fd;
+
+    if ((fd = open(file_name, O_RDONLY)) < 0)
+        return;
+    fsync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+/*------------------------------------------------------------
+ * Decode a stored chunk and add the values of its defined
+ * elements to the sum (callback for sc_uring_read_chunks)
+ *------------------------------------------------------------
+ */
+int decode_chunk(size_t chunk, const uint8_t *image, size_t size, void *op_data)
+{
+    decode_t       *d = (decode_t *)op_data;
+    sc_chunk_info_t info;
+    const uint8_t  *data;
+    uint64_t        i;
+    unsigned        s;
+
+    if (sc_disassemble_chunk(image, size, &info, NULL) < 0)
+        goto error;
+    for (s = 0; s < info.num_sections; s++)
+        if (info.section_orig_size[s] > d->cap[s]) {
+            free(d->buf[s]);
+            d->cap[s] = (size_t)info.section_orig_size[s];
+            d->buf[s] = malloc(d->cap[s]);
+        }
+    if (sc_disassemble_chunk(image, size, &info, d->buf) < 0)
+        goto error;
+
+    data = (const uint8_t *)d->buf[SC_SECTION_FIXED];
+    for (i = 0; i < info.section_orig_size[SC_SECTION_FIXED]; i++)
+        d->sum += data[i];
+
+    return 0;
+
+error:
+    printf("Failed to decode chunk %zu\n", chunk);
+    return -1;
+}
+
+/*------------------------------------------------------------
+ * Read and decode all chunks with one of the engines; returns
+ * the time of the pass
+ *------------------------------------------------------------
+ */
+double read_pass(hid_t dset, int fd, size_t nchunks, const sc_chunk_loc_t *locs, uint8_t *image,
+                 sc_uring_t *ring, decode_t *d)
+{
+    struct timespec start;
+    size_t          align = hand.o ? DIRECT_ALIGN : 1;
+    size_t          c;
+
+    if (hand.c)
+        drop_cache(hand.in_file);
+    d->sum = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (ring) {
+        if (sc_uring_read_chunks(ring, fd, hand.o ? DIRECT_ALIGN : 0, nchunks, locs, decode_chunk, d) < 0) {
+            printf("io_uring read failed: %s\n", strerror(errno));
+            exit(1);
+        }
+    }
+    else if (fd >= 0) {
+        for (c = 0; c < nchunks; c++) {
+            uint64_t first = locs[c].addr / align * align;
+            uint64_t end   = (locs[c].addr + locs[c].size + align - 1) / align * align;
+
+            if (pread(fd, image, (size_t)(end - first), (off_t)first) < (ssize_t)(locs[c].addr - first + locs[c].size)) {
+                printf("pread failed: %s\n", strerror(errno));
+                exit(1);
+            }
+            if (decode_chunk(c, image + (locs[c].addr - first), (size_t)locs[c].size, d) < 0)
+                exit(1);
+        }
+    }
+    else {
+        for (c = 0; c < nchunks; c++) {
+            uint32_t filters;
+
+            if (H5Dread_chunk(dset, H5P_DEFAULT, locs[c].offset, &filters, image) < 0 ||
+                decode_chunk(c, image, (size_t)locs[c].size, d) < 0)
+                exit(1);
+        }
+    }
+
+    return elapsed(&start);
+}
+
+/*------------------------------------------------------------
+ * Measure one engine
+ *------------------------------------------------------------
+ */
+void measure(result_t *r, const char *engine, int depth, hid_t dset, int fd, size_t nchunks,
+             const sc_chunk_loc_t *locs, uint8_t *image, sc_uring_t *ring, decode_t *d)
+{
+    double t;
+    int    n;
+
+    if (hand.v) printf("Reading with %s, queue depth %d\n", engine, depth);
+
+    r->engine = engine;
+    r->depth  = depth;
+    r->time   = 1e30;
+    for (n = 0; n < hand.repeat; n++)
+        if ((t = read_pass(dset, fd, nchunks, locs, image, ring, d)) < r->time)
+            r->time = t;
+    r->sum = d->sum;
+}
+
+/*------------------------------------------------------------
+ * Main function
+ *------------------------------------------------------------
+ */
+int
+main(int argc, char **argv)
+{
+    hid_t           fapl, file, dset;
+    sc_chunk_loc_t *locs;
+    size_t          nchunks, c, image_size = 0;
+    long long int   bytes = 0;
+    uint8_t        *image;
+    decode_t        d;
+    sc_uring_t      ring;
+    int             fd, depth, nres = 0, i;
+
+    parse_command_line(argc, argv);
+
+    fapl = H5Pcreate(H5P_FILE_ACCESS);
+    H5Pset_fapl_sec2(fapl);
+    if ((file = H5Fopen(hand.in_file, H5F_ACC_RDONLY, fapl)) < 0) {
+        printf("Failed to open %s\n", hand.in_file);
+        return 1;
+    }
+    if ((dset = H5Dopen2(file, hand.dset_name, H5P_DEFAULT)) < 0 ||
+        sc_get_chunk_locations(dset, &nchunks, &locs) < 0) {
+        printf("Failed to read the chunk locations of %s\n", hand.dset_name);
+        return 1;
+    }
+
+    for (c = 0; c < nchunks; c++) {
+        bytes += (long long int)locs[c].size;
+        if (locs[c].size > image_size)
+            image_size = (size_t)locs[c].size;
+    }
+    image_size = (image_size + 2 * DIRECT_ALIGN - 1) / DIRECT_ALIGN * DIRECT_ALIGN;
+    if (posix_memalign((void **)&image, DIRECT_ALIGN, image_size) != 0) {
+        printf("Failed to allocate the read buffer\n");
+        return 1;
+    }
+    memset(&d, 0, sizeof(d));
+
+    if ((fd = open(hand.in_file, O_RDONLY | (hand.o ? O_DIRECT : 0))) < 0) {
+        printf("Failed to open %s%s: %s\n", hand.in_file, hand.o ? " with O_DIRECT" : "", strerror(errno));
+        return 1;
+    }
+
+    /* Blocking reads, one chunk at a time */
+    measure(&res[nres++], "sec2", 1, dset, -1, nchunks, locs, image, NULL, &d);
+    measure(&res[nres++], "pread", 1, dset, fd, nchunks, locs, image, NULL, &d);
+
+    /* Batched reads with increasing queue depth */
+    for (depth = 1; nres < MAX_ENGINES; depth *= 2) {
+        if (depth > hand.depth)
+            depth = hand.depth;
+        if (sc_uring_init(&ring, (unsigned)depth) < 0) {
+            printf("Failed to create an io_uring instance: %s\n", strerror(errno));
+            return 1;
+        }
+        measure(&res[nres++], "io_uring", (int)ring.depth, dset, fd, nchunks, locs, image, &ring, &d);
+        sc_uring_close(&ring);
+        if (depth == hand.depth)
+            break;
+    }
+
+    for (i = 1; i < nres; i++)
+        if (res[i].sum != res[0].sum)
+            printf("Values read with %s (queue depth %d) differ from the sec2 driver\n", res[i].engine, res[i].depth);
+
+    if (hand.v) printf("Done! \n");
+
+    for (i = 0; i < SC_MAX_SECTIONS; i++)
+        free(d.buf[i]);
+    free(image);
+    free(locs);
+    close(fd);
+    H5Dclose(dset);
+    H5Fclose(file);
+    H5Pclose(fapl);
+
+    print_results(nres, nchunks, bytes);
+
+    return 0;
+}
@@ -19,6 +19,32 @@
  * Please remember that for the current VL storage that dataset stores pointers to VL elements; 
  * the elements themselves are stored in the gloabl heap. The h5stat tool reports that space as
  * "Unaccountable space". The h5dump tool -p option will return the size of the dataset with pointers.  
+ *
+ * The program prints the storage of the datasets, the sizes of the four files (which include the global
+ * heap) and the time to write the datasets.  With the option -j the results are also appended to the
+ * given file as a JSON line with the parameters, sizes, timings and the environment (host, HDF5 version
+ * and date), for the sweep driver sweep.py and other scripts.
+ *
+ * With the option -a 1 the program also reports the memory used by the phases of the two approaches:
+ *
+ *  build        - generation of the VL elements in memory (hvl_t descriptors and element buffers)
+ *  encode       - packing of the offset/length pairs and the elements into the structured buffers
+ *  write_vl     - H5Dwrite of the VL dataset
+ *  write_struct - H5Dwrite of the offset/length and data datasets
+ *  read_vl      - H5Dread of the VL dataset (the library allocates a buffer for each element)
+ *  read_struct  - H5Dread of the offset/length and data datasets
+ *  scatter      - hvl_t descriptors of the elements pointing into the data read by read_struct
+ *
+ * The allocations of the program and of the HDF5 library are counted by interposing the allocator of the
+ * C library; the peak RSS of a phase is VmHWM after resetting it through /proc/self/clear_refs.  The peak
+ * of the allocated bytes and the peak RSS growth are also reported per VL element.  The read and scatter
+ * phases only run with -a 1.  The interposer relies on glibc and is only built with -DSC_COUNT_ALLOC
+ * (h5cc -DSC_COUNT_ALLOC vl.c), which -a 1 requires; it counts all the blocks from the start of the
+ * program.
+ *
+ * To compile the program, please use h5cc.  The -h option lists all the command line options:
+ *
+ *   [-h] [-m --maxLength] [-n --nElements] [-d --dRandom] [-j --jsonFile] [-a --aMemory]
  */
 
 #include "hdf5.h"
@@ -29,6 +55,9 @@
 #include <math.h>
 #include <string.h>
 #include <getopt.h>
+#include <unistd.h>
+#include <errno.h>
+#include <malloc.h>
 
 #define FILE_NAME1                 		"vltype.h5"
 #define FILE_NAME2                 		"vltype_comp.h5"
@@ -42,15 +71,255 @@
 #define VL_DATA_DSET_COMP_NAME  		"data_comp"
 #define NELEMTS     				1000
 #define RANK           				1
+#define BENCHMARK_NAME                  	"vl"
 #define MAX_VL_LEN                      	100
 
+/* Phases measured by the memory accounting */
+#define MEM_BUILD                       	0
+#define MEM_ENCODE                      	1
+#define MEM_WRITE_VL                    	2
+#define MEM_WRITE_STRUCT                	3
+#define MEM_READ_VL                     	4
+#define MEM_READ_STRUCT                 	5
+#define MEM_SCATTER                     	6
+#define MEM_NPHASES                     	7
+
 typedef struct {
     long long int   nelemts;
     long long int   max_len;
     int             d;
+    char           *json_file;       /* file to append the results to as JSON lines */
+    int             a;               /* reports the memory of the phases */
 } handler_t;
 
+typedef struct {
+    long long int   peak;            /* peak of the allocated bytes above the start of the phase */
+    long long int   allocated;       /* bytes allocated */
+    long long int   nallocs;         /* number of allocations */
+    long long int   rss;             /* growth of the peak RSS */
+} mem_t;
+
+typedef struct {
+    long long int   vl;              /* storage of the VL dataset (heap IDs) */
+    long long int   vl_comp;         /* storage of the compressed VL dataset */
+    long long int   pairs;           /* storage of the offset/length dataset */
+    long long int   pairs_comp;      /* storage of the compressed offset/length dataset */
+    long long int   blob;            /* storage of the dataset with the VL elements */
+    long long int   blob_comp;       /* storage of the compressed dataset with the VL elements */
+    long long int   file[4];         /* sizes of the four files */
+    long long int   total_len;       /* total length of the VL elements */
+    double          t_vl;            /* time to write the VL dataset */
+    double          t_vl_comp;       /* time to write the compressed VL dataset */
+    double          t_struct;        /* time to write the offset/length and data datasets */
+    double          t_struct_comp;   /* time to write the compressed offset/length and data datasets */
+    mem_t           mem[MEM_NPHASES]; /* memory of the phases */
+} storage_t;
+
 handler_t    hand;
+storage_t    st;
+
+const char  *mem_phase_names[MEM_NPHASES] = {"build", "encode", "write_vl", "write_struct", "read_vl", "read_struct",
+                                             "scatter"};
+
+/*------------------------------------------------------------
+ * Allocation accounting: when compiled with -DSC_COUNT_ALLOC
+ * on glibc, the program interposes the allocator of the C
+ * library for itself and the HDF5 library, and counts the
+ * usable sizes of all the blocks from the start of the
+ * program, so that a block is only subtracted when it is
+ * freed if it was added when it was allocated
+ *------------------------------------------------------------
+ */
+#if defined(SC_COUNT_ALLOC) && defined(__GLIBC__)
+#define MEM_COUNT_ALLOC                 1
+#else
+#define MEM_COUNT_ALLOC                 0
+#endif
+
+long long int mem_current;           /* bytes allocated now */
+long long int mem_peak;              /* peak of mem_current since the last reset */
+long long int mem_allocated;         /* bytes allocated in total */
+long long int mem_nallocs;           /* number of allocations */
+long long int mem_start_bytes, mem_start_alloc, mem_start_count, mem_rss_start;
+
+#if MEM_COUNT_ALLOC
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void *__libc_valloc(size_t size);
+extern void *__libc_pvalloc(size_t size);
+extern void  __libc_free(void *ptr);
+
+void mem_add(void *ptr)
+{
+    long long int size = (long long int)malloc_usable_size(ptr);
+    long long int cur  = __sync_add_and_fetch(&mem_current, size);
+    long long int peak;
+
+    __sync_fetch_and_add(&mem_allocated, size);
+    __sync_fetch_and_add(&mem_nallocs, 1);
+    while (cur > (peak = mem_peak) && !__sync_bool_compare_and_swap(&mem_peak, peak, cur))
+        ;
+}
+
+void mem_sub(void *ptr)
+{
+    __sync_fetch_and_sub(&mem_current, (long long int)malloc_usable_size(ptr));
+}
+
+void *malloc(size_t size)
+{
+    void *ptr = __libc_malloc(size);
+
+    if (ptr)
+        mem_add(ptr);
+    return ptr;
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    void *ptr = __libc_calloc(nmemb, size);
+
+    if (ptr)
+        mem_add(ptr);
+    return ptr;
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    void *new_ptr;
+
+    if (ptr)
+        mem_sub(ptr);
+    new_ptr = __libc_realloc(ptr, size);
+    if (new_ptr)
+        mem_add(new_ptr);
+    else if (ptr && size)
+        mem_add(ptr);
+    return new_ptr;
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+    void *mem;
+
+    /* The alignment must be a power of two multiple of sizeof(void *) */
+    if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0 || alignment == 0)
+        return EINVAL;
+    if (NULL == (mem = __libc_memalign(alignment, size)))
+        return ENOMEM;
+    mem_add(mem);
+    *ptr = mem;
+    return 0;
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    void *ptr = __libc_memalign(alignment, size);
+
+    if (ptr)
+        mem_add(ptr);
+    return ptr;
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    void *ptr = __libc_memalign(alignment, size);
+
+    if (ptr)
+        mem_add(ptr);
+    return ptr;
+}
+
+void *valloc(size_t size)
+{
+    void *ptr = __libc_valloc(size);
+
+    if (ptr)
+        mem_add(ptr);
+    return ptr;
+}
+
+void *pvalloc(size_t size)
+{
+    void *ptr = __libc_pvalloc(size);
+
+    if (ptr)
+        mem_add(ptr);
+    return ptr;
+}
+
+void free(void *ptr)
+{
+    if (ptr) {
+        mem_sub(ptr);
+        __libc_free(ptr);
+    }
+}
+#endif
+
+/*------------------------------------------------------------
+ * Read a field of /proc/self/status in bytes
+ *------------------------------------------------------------
+ */
+long long int proc_status(const char *field)
+{
+    char          line[256];
+    long long int kb = 0;
+    size_t        len = strlen(field);
+    FILE         *f;
+
+    if (NULL == (f = fopen("/proc/self/status", "r")))
+        return 0;
+    while (fgets(line, sizeof(line), f))
+        if (!strncmp(line, field, len) && line[len] == ':') {
+            kb = atoll(line + len + 1);
+            break;
+        }
+    fclose(f);
+    return kb * 1024;
+}
+
+/*------------------------------------------------------------
+ * Start measuring the memory of a phase: resets the peak of
+ * the allocations and the peak RSS (VmHWM) of the process
+ *------------------------------------------------------------
+ */
+void mem_start(void)
+{
+    FILE *f;
+
+    if (!hand.a)
+        return;
+
+    /* Writing 5 to clear_refs resets VmHWM to the current RSS (Linux 4.0 and later) */
+    if (NULL != (f = fopen("/proc/self/clear_refs", "w"))) {
+        fputs("5", f);
+        fclose(f);
+    }
+    mem_rss_start   = proc_status("VmRSS");
+    mem_start_bytes = mem_current;
+    mem_start_alloc = mem_allocated;
+    mem_start_count = mem_nallocs;
+    mem_peak        = mem_current;
+}
+
+/* Stop measuring a phase and add its memory to "m" */
+void mem_stop(mem_t *m)
+{
+    long long int rss;
+
+    if (!hand.a)
+        return;
+
+    /* The counters are read before /proc is opened, which allocates */
+    m->peak      += mem_peak - mem_start_bytes;
+    m->allocated += mem_allocated - mem_start_alloc;
+    m->nallocs   += mem_nallocs - mem_start_count;
+    rss           = proc_status("VmHWM") - mem_rss_start;
+    m->rss       += rss > 0 ? rss : 0;
+}
 
 /*------------------------------------------------------------
  * Display command line usage
@@ -59,11 +328,13 @@ handler_t    hand;
 void
 usage(void)
 {
-    printf("    [-h] [-m --maxLength] [-n --nElements]\n");
+    printf("    [-h] [-m --maxLength] [-n --nElements] [-d --dRandom] [-j --jsonFile] [-a --aMemory]\n");
     printf("    [-h --help]: this help page\n");
     printf("    [-m --maxLength]: the maximal length of a variable-length element\n");
     printf("    [-n --nElements]: the number of VL type elements in the chunk/dataset\n");
     printf("    [-d --dRandom]: generate random data (default 1) or compressible data (0)\n");
+    printf("    [-j --jsonFile]: append the results to this file as a JSON line (default none)\n");
+    printf("    [-a --aMemory]: report the allocations and the peak RSS of the phases (1), needs -DSC_COUNT_ALLOC; default no report (0)\n");
     printf("\n");
 }
 
@@ -81,14 +352,18 @@ parse_command_line(int argc, char *argv[])
                                     {"maxLength=", required_argument, NULL, 'm'},
                                     {"nElements=", required_argument, NULL, 'n'},
                                     {"dRandom=", required_argument, NULL, 'd'},
+                                    {"jsonFile=", required_argument, NULL, 'j'},
+                                    {"aMemory=", required_argument, NULL, 'a'},
                                     {NULL, 0, NULL, 0}};
 
     /* Initialize the command line options */
     hand.nelemts = NELEMTS;
     hand.max_len = MAX_VL_LEN;
     hand.d       = 1;
+    hand.json_file = NULL;
+    hand.a         = 0;
  
-    while ((opt = getopt_long(argc, argv, "hm:n:d:", long_options, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "hm:n:d:j:a:", long_options, NULL)) != -1) {
         switch (opt) {
             case 'h':
                 fprintf(stdout, "Help page:\n");
@@ -129,6 +404,29 @@ parse_command_line(int argc, char *argv[])
                 else
                     printf("optarg is null\n");
                 break;
+            case 'j':
+                /* The file for the results as JSON lines */
+                if (optarg) {
+                    fprintf(stdout, "JSON results file:\t\t\t\t%s\n", optarg);
+                    hand.json_file = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'a':
+                /* The memory accounting */
+                if (optarg) {
+                    hand.a = atoi(optarg);
+                    if (hand.a == 1)
+                        fprintf(stdout, "memory accounting:\t\t\t\ton\n");
+                    else if (hand.a == 0)
+                        fprintf(stdout, "memory accounting:\t\t\t\toff\n");
+                    else
+                        fprintf(stdout, "memory accounting:\t\t\t\tinvalid option\n");
+                }
+                else
+                    printf("optarg is null\n");
+                break;
             case ':':
                 printf("option needs a value\n");
                 break;
@@ -158,6 +456,124 @@ parse_command_line(int argc, char *argv[])
         printf("Data generation flag can only be 0 (compressible data) or 1 (random)\n");
         exit(1);
     }
+
+    if (hand.a < 0 || hand.a > 1) {
+        printf("Memory accounting flag can only be 0 or 1\n");
+        exit(1);
+    }
+
+    if (hand.a && !MEM_COUNT_ALLOC) {
+        printf("Memory accounting needs the program compiled with -DSC_COUNT_ALLOC on glibc\n");
+        exit(1);
+    }
+}
+
+/*------------------------------------------------------------
+ * Print used storage and timings
+ *------------------------------------------------------------
+ */
+void print_results(void)
+{
+    long long int structured      = st.pairs + st.blob;
+    long long int structured_comp = st.pairs_comp + st.blob_comp;
+
+    printf("\n");
+    printf("Printing the storage of the VL dataset (VS), of the structured datasets (STS) and of their compressed\n");
+    printf("counterparts (CVS, CSTS) in bytes; the VL storage does not include the global heap\n");
+    printf("\n");
+    printf("        VS        CVS        STS       CSTS\n");
+    printf("\n");
+    printf("%10lli %10lli %10lli %10lli \n", st.vl, st.vl_comp, structured, structured_comp);
+
+    printf("\n");
+    printf("Printing the sizes of the files %s (F1), %s (F2), %s (F3), %s (F4) in bytes and the\n",
+           FILE_NAME1, FILE_NAME2, FILE_NAME3, FILE_NAME4);
+    printf("storage ratios F1/F3 (SR) and F2/F4 (CSR)\n");
+    printf("\n");
+    printf("        F1         F2         F3         F4         SR        CSR\n");
+    printf("\n");
+    printf("%10lli %10lli %10lli %10lli %10.1f %10.1f \n", st.file[0], st.file[1], st.file[2], st.file[3],
+           (float)st.file[0] / st.file[2], (float)st.file[1] / st.file[3]);
+
+    printf("\n");
+    printf("Printing the time to write the VL dataset (TV), the structured datasets (TS) and their compressed\n");
+    printf("counterparts (TCV, TCS) in seconds\n");
+    printf("\n");
+    printf("        TV        TCV         TS        TCS\n");
+    printf("\n");
+    printf("%10.4f %10.4f %10.4f %10.4f \n", st.t_vl, st.t_vl_comp, st.t_struct, st.t_struct_comp);
+    printf("\n");
+
+    if (hand.a) {
+        int j;
+
+        printf("Printing the peak of the allocated bytes (PA), the bytes allocated (BA), the number of allocations (NA)\n");
+        printf("and the growth of the peak RSS in bytes (PR) of each phase, and PA and PR per VL element (PAE, PRE)\n");
+        printf("\n");
+        printf("       phase         PA         BA         NA         PR        PAE        PRE\n");
+        printf("\n");
+        for (j = 0; j < MEM_NPHASES; j++)
+            printf("%12s %10lli %10lli %10lli %10lli %10.2f %10.2f \n", mem_phase_names[j], st.mem[j].peak,
+                   st.mem[j].allocated, st.mem[j].nallocs, st.mem[j].rss, (double)st.mem[j].peak / hand.nelemts,
+                   (double)st.mem[j].rss / hand.nelemts);
+        printf("\n");
+    }
+}
+
+/*------------------------------------------------------------
+ * Elapsed time
+ *------------------------------------------------------------
+ */
+double elapsed(struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*------------------------------------------------------------
+ * Append the results to the JSON lines file as one object
+ * with the parameters, sizes, timings and the environment
+ *------------------------------------------------------------
+ */
+int print_json(void)
+{
+    FILE     *f;
+    char      host[256] = "unknown";
+    char      date[32];
+    time_t    now = time(NULL);
+    unsigned  major, minor, release;
+
+    if (NULL == (f = fopen(hand.json_file, "a"))) {
+        printf("Failed to open %s\n", hand.json_file);
+        return -1;
+    }
+
+    gethostname(host, sizeof(host) - 1);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+    H5get_libversion(&major, &minor, &release);
+
+    fprintf(f, "{\"benchmark\": \"%s\", \"nelemts\": %lld, \"max_len\": %lld, \"d\": %d, \"total_len\": %lld, ",
+            BENCHMARK_NAME, hand.nelemts, hand.max_len, hand.d, st.total_len);
+    fprintf(f, "\"vl\": %lld, \"vl_comp\": %lld, \"pairs\": %lld, \"pairs_comp\": %lld, \"blob\": %lld, "
+               "\"blob_comp\": %lld, ", st.vl, st.vl_comp, st.pairs, st.pairs_comp, st.blob, st.blob_comp);
+    fprintf(f, "\"file1\": %lld, \"file2\": %lld, \"file3\": %lld, \"file4\": %lld, ", st.file[0], st.file[1],
+            st.file[2], st.file[3]);
+    fprintf(f, "\"t_vl\": %.6f, \"t_vl_comp\": %.6f, \"t_struct\": %.6f, \"t_struct_comp\": %.6f, ", st.t_vl,
+            st.t_vl_comp, st.t_struct, st.t_struct_comp);
+    if (hand.a) {
+        int j;
+
+        for (j = 0; j < MEM_NPHASES; j++)
+            fprintf(f, "\"mem_%s_peak\": %lld, \"mem_%s_allocated\": %lld, \"mem_%s_nallocs\": %lld, "
+                       "\"mem_%s_rss\": %lld, ", mem_phase_names[j], st.mem[j].peak, mem_phase_names[j],
+                    st.mem[j].allocated, mem_phase_names[j], st.mem[j].nallocs, mem_phase_names[j], st.mem[j].rss);
+    }
+    fprintf(f, "\"host\": \"%s\", \"hdf5\": \"%u.%u.%u\", \"date\": \"%s\"}\n", host, major, minor, release, date);
+
+    fclose(f);
+    return 0;
 }
 
 /*------------------------------------------------------------
@@ -177,12 +593,12 @@ int create_dsets(hid_t file, hid_t file_comp, hid_t file_struct, hid_t file_stru
     unsigned long long    total_len = 0;
     char    *all_strings, *ptr;
     int     i, j;
+    struct timespec start;
 
     /* Allocate and initialize variable-length elements */ 
+    mem_start();
     vl_data = (hvl_t *)malloc(hand.nelemts * sizeof(hvl_t));
 
-    p = the_pairs = (unsigned long long *)malloc(2 * hand.nelemts * sizeof(unsigned long long));
-
     for(i = 0; i < hand.nelemts; i++) {
         vl_data[i].len = rand() % hand.max_len + 1;
         vl_data[i].p = (char *)malloc(vl_data[i].len * sizeof(char));
@@ -195,22 +611,26 @@ int create_dsets(hid_t file, hid_t file_comp, hid_t file_struct, hid_t file_stru
             ((char *)(vl_data[i].p))[j] = j;
         }
 
-        /* The pair of offset and length for each variable-length element to be saved in the "structured" dataset */
-        *p++ = offset;
-        offset += vl_data[i].len;
-        *p++ = vl_data[i].len;
-
         /* The total length of all elements */
         total_len += vl_data[i].len;
     }
+    mem_stop(&st.mem[MEM_BUILD]);
 
-    /* Save all VL elements into a buffer for the "structured" dataset */
+    /* Save the pairs and all VL elements into the buffers for the "structured" datasets */
+    mem_start();
+    p = the_pairs = (unsigned long long *)malloc(2 * hand.nelemts * sizeof(unsigned long long));
     ptr = all_strings = (char *)malloc(total_len * sizeof(char));
 
     for(i = 0; i < hand.nelemts; i++) {
+        /* The pair of offset and length for each variable-length element to be saved in the "structured" dataset */
+        *p++ = offset;
+        offset += vl_data[i].len;
+        *p++ = vl_data[i].len;
+
         memcpy(ptr, (char *)(vl_data[i].p), vl_data[i].len);
         ptr += vl_data[i].len;
     }
+    mem_stop(&st.mem[MEM_ENCODE]);
 
     dset_dim[0] = hand.nelemts;
 
@@ -237,10 +657,19 @@ int create_dsets(hid_t file, hid_t file_comp, hid_t file_struct, hid_t file_stru
     dset_compressed = H5Dcreate2(file_comp, VL_DSET_COMP_NAME, dtype, dataspace, H5P_DEFAULT, dcpl_compressed, H5P_DEFAULT);
 
     /* Write the data to the dataset */
+    mem_start();
+    clock_gettime(CLOCK_MONOTONIC, &start);
     H5Dwrite(dset, dtype, H5S_ALL, H5S_ALL, H5P_DEFAULT, vl_data);
+    st.t_vl = elapsed(&start);
+    mem_stop(&st.mem[MEM_WRITE_VL]);
+    st.vl   = (long long int)H5Dget_storage_size(dset);
 
     /* Write the data to the dataset with compression */
+    clock_gettime(CLOCK_MONOTONIC, &start);
     H5Dwrite(dset_compressed, dtype, H5S_ALL, H5S_ALL, H5P_DEFAULT, vl_data);
+    st.t_vl_comp = elapsed(&start);
+    st.vl_comp   = (long long int)H5Dget_storage_size(dset_compressed);
+    st.total_len = (long long int)total_len;
 
     H5Sclose(dataspace);
     H5Dclose(dset);
@@ -266,10 +695,18 @@ int create_dsets(hid_t file, hid_t file_comp, hid_t file_struct, hid_t file_stru
     dset_compressed = H5Dcreate2(file_struct_comp, OFFSET_LENGTH_DSET_COMP_NAME, H5T_NATIVE_ULLONG, dataspace, H5P_DEFAULT, dcpl_compressed, H5P_DEFAULT);
 
     /* Write the data to the dataset */
+    mem_start();
+    clock_gettime(CLOCK_MONOTONIC, &start);
     H5Dwrite(dset, H5T_NATIVE_ULLONG, H5S_ALL, H5S_ALL, H5P_DEFAULT, the_pairs);
+    st.t_struct = elapsed(&start);
+    mem_stop(&st.mem[MEM_WRITE_STRUCT]);
+    st.pairs    = (long long int)H5Dget_storage_size(dset);
 
     /* Write the data to the dataset with compression */
+    clock_gettime(CLOCK_MONOTONIC, &start);
     H5Dwrite(dset_compressed, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, the_pairs);
+    st.t_struct_comp = elapsed(&start);
+    st.pairs_comp    = (long long int)H5Dget_storage_size(dset_compressed);
 
     H5Sclose(dataspace);
     H5Dclose(dset);
@@ -295,10 +732,18 @@ int create_dsets(hid_t file, hid_t file_comp, hid_t file_struct, hid_t file_stru
     dset_compressed = H5Dcreate2(file_struct_comp, VL_DATA_DSET_COMP_NAME, H5T_NATIVE_CHAR, dataspace, H5P_DEFAULT, dcpl_compressed, H5P_DEFAULT);
 
     /* Write the data to the dataset */
+    mem_start();
+    clock_gettime(CLOCK_MONOTONIC, &start);
     H5Dwrite(dset, H5T_NATIVE_CHAR, H5S_ALL, H5S_ALL, H5P_DEFAULT, all_strings);
+    st.t_struct += elapsed(&start);
+    mem_stop(&st.mem[MEM_WRITE_STRUCT]);
+    st.blob      = (long long int)H5Dget_storage_size(dset);
 
     /* Write the data to the dataset with compression */
+    clock_gettime(CLOCK_MONOTONIC, &start);
     H5Dwrite(dset_compressed, H5T_NATIVE_CHAR, H5S_ALL, H5S_ALL, H5P_DEFAULT, all_strings);
+    st.t_struct_comp += elapsed(&start);
+    st.blob_comp      = (long long int)H5Dget_storage_size(dset_compressed);
 
     H5Sclose(dataspace);
     H5Dclose(dset);
@@ -320,6 +765,70 @@ error:
     return -1;
 }
 
+/*------------------------------------------------------------
+ * Read the VL dataset and the structured datasets back, and
+ * scatter the structured data into hvl_t descriptors that
+ * point into the read buffer without copying the elements
+ *------------------------------------------------------------
+ */
+int read_dsets(hid_t file, hid_t file_struct)
+{
+    hid_t               dset, dtype;
+    hid_t               dataspace;
+    hvl_t              *vl_data;
+    unsigned long long *the_pairs;
+    char               *all_strings;
+    hsize_t             total_len;
+    int                 i;
+
+    /* The VL dataset: the library allocates a buffer for each element */
+    dset      = H5Dopen2(file, VL_DSET_NAME, H5P_DEFAULT);
+    dtype     = H5Tvlen_create(H5T_NATIVE_CHAR);
+    dataspace = H5Dget_space(dset);
+
+    mem_start();
+    vl_data = (hvl_t *)malloc(hand.nelemts * sizeof(hvl_t));
+    H5Dread(dset, dtype, H5S_ALL, H5S_ALL, H5P_DEFAULT, vl_data);
+    mem_stop(&st.mem[MEM_READ_VL]);
+
+    H5Dvlen_reclaim(dtype, dataspace, H5P_DEFAULT, vl_data);
+    free(vl_data);
+    H5Sclose(dataspace);
+    H5Tclose(dtype);
+    H5Dclose(dset);
+
+    /* The offset/length and data datasets */
+    mem_start();
+    the_pairs = (unsigned long long *)malloc(2 * hand.nelemts * sizeof(unsigned long long));
+    dset      = H5Dopen2(file_struct, OFFSET_LENGTH_DSET_NAME, H5P_DEFAULT);
+    H5Dread(dset, H5T_NATIVE_ULLONG, H5S_ALL, H5S_ALL, H5P_DEFAULT, the_pairs);
+    H5Dclose(dset);
+
+    dset      = H5Dopen2(file_struct, VL_DATA_DSET_NAME, H5P_DEFAULT);
+    dataspace = H5Dget_space(dset);
+    H5Sget_simple_extent_dims(dataspace, &total_len, NULL);
+    all_strings = (char *)malloc(total_len * sizeof(char));
+    H5Dread(dset, H5T_NATIVE_CHAR, H5S_ALL, H5S_ALL, H5P_DEFAULT, all_strings);
+    H5Sclose(dataspace);
+    H5Dclose(dset);
+    mem_stop(&st.mem[MEM_READ_STRUCT]);
+
+    /* The elements point into the data section */
+    mem_start();
+    vl_data = (hvl_t *)malloc(hand.nelemts * sizeof(hvl_t));
+    for (i = 0; i < hand.nelemts; i++) {
+        vl_data[i].p   = all_strings + the_pairs[2 * i];
+        vl_data[i].len = (size_t)the_pairs[2 * i + 1];
+    }
+    mem_stop(&st.mem[MEM_SCATTER]);
+
+    free(vl_data);
+    free(the_pairs);
+    free(all_strings);
+
+    return 0;
+}
+
 /*------------------------------------------------------------
  * Main function
  *------------------------------------------------------------
@@ -348,11 +857,31 @@ main(int argc, char **argv)
     /* Create datasets */
     create_dsets(file, file_comp, file_struct, file_struct_comp);
 
+    /* Read the datasets back for the memory of the read phases */
+    if (hand.a)
+        read_dsets(file, file_struct);
+
+    /* Get the file sizes with the global heap */
+    H5Fflush(file, H5F_SCOPE_GLOBAL);
+    H5Fflush(file_comp, H5F_SCOPE_GLOBAL);
+    H5Fflush(file_struct, H5F_SCOPE_GLOBAL);
+    H5Fflush(file_struct_comp, H5F_SCOPE_GLOBAL);
+    H5Fget_filesize(file, (hsize_t *)&st.file[0]);
+    H5Fget_filesize(file_comp, (hsize_t *)&st.file[1]);
+    H5Fget_filesize(file_struct, (hsize_t *)&st.file[2]);
+    H5Fget_filesize(file_struct_comp, (hsize_t *)&st.file[3]);
+
     /* Close resources */
     H5Fclose(file);
     H5Fclose(file_comp);
     H5Fclose(file_struct);
     H5Fclose(file_struct_comp);
 
+    /* Print results */
+    print_results();
+
+    if (hand.json_file)
+        print_json();
+
     return 0;
 }
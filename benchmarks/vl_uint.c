@@ -20,6 +20,15 @@
  * Please remember that for the current VL storage that dataset stores pointers to VL elements; 
  * the elements themselves are stored in the gloabl heap. The h5stat tool reports that space as
  * "Unaccountable space". The h5dump tool -p option will return the size of the dataset with pointers.  
+ *
+ * The program prints the storage of the datasets, the sizes of the four files (which include the global
+ * heap) and the time to write the datasets.  With the option -j the results are also appended to the
+ * given file as a JSON line with the parameters, sizes, timings and the environment (host, HDF5 version
+ * and date), for the sweep driver sweep.py and other scripts.
+ *
+ * To compile the program, please use h5cc.  The -h option lists all the command line options:
+ *
+ *   [-h] [-m --maxLength] [-n --nElements] [-d --dRandom] [-j --jsonFile]
  */
 
 #include "hdf5.h"
@@ -30,6 +39,7 @@
 #include <math.h>
 #include <string.h>
 #include <getopt.h>
+#include <unistd.h>
 
 #define FILE_NAME1                 		"vltype.h5"
 #define FILE_NAME2                 		"vltype_comp.h5"
@@ -43,15 +53,33 @@
 #define VL_DATA_DSET_COMP_NAME  		"data_comp"
 #define NELEMTS     				1000
 #define RANK           				1
+#define BENCHMARK_NAME                  	"vl_uint"
 #define MAX_VL_LEN                      	100
 
 typedef struct {
     long long int   nelemts;
     long long int   max_len;
     int             d;
+    char           *json_file;       /* file to append the results to as JSON lines */
 } handler_t;
 
+typedef struct {
+    long long int   vl;              /* storage of the VL dataset (heap IDs) */
+    long long int   vl_comp;         /* storage of the compressed VL dataset */
+    long long int   pairs;           /* storage of the offset/length dataset */
+    long long int   pairs_comp;      /* storage of the compressed offset/length dataset */
+    long long int   blob;            /* storage of the dataset with the VL elements */
+    long long int   blob_comp;       /* storage of the compressed dataset with the VL elements */
+    long long int   file[4];         /* sizes of the four files */
+    long long int   total_len;       /* total length of the VL elements */
+    double          t_vl;            /* time to write the VL dataset */
+    double          t_vl_comp;       /* time to write the compressed VL dataset */
+    double          t_struct;        /* time to write the offset/length and data datasets */
+    double          t_struct_comp;   /* time to write the compressed offset/length and data datasets */
+} storage_t;
+
 handler_t    hand;
+storage_t    st;
 
 /*------------------------------------------------------------
  * Display command line usage
@@ -60,11 +88,12 @@ handler_t    hand;
 void
 usage(void)
 {
-    printf("    [-h] [-m --maxLength] [-n --nElements]\n");
+    printf("    [-h] [-m --maxLength] [-n --nElements] [-d --dRandom] [-j --jsonFile]\n");
     printf("    [-h --help]: this help page\n");
     printf("    [-m --maxLength]: the maximal length of a variable-length element\n");
     printf("    [-n --nElements]: the number of VL type elements in the chunk/dataset\n");
     printf("    [-d --dRandom]: generate random data (default 1) or compressible data (0)\n");
+    printf("    [-j --jsonFile]: append the results to this file as a JSON line (default none)\n");
     printf("\n");
 }
 
@@ -82,14 +111,16 @@ parse_command_line(int argc, char *argv[])
                                     {"maxLength=", required_argument, NULL, 'm'},
                                     {"nElements=", required_argument, NULL, 'n'},
                                     {"dRandom=", required_argument, NULL, 'd'},
+                                    {"jsonFile=", required_argument, NULL, 'j'},
                                     {NULL, 0, NULL, 0}};
 
     /* Initialize the command line options */
     hand.nelemts = NELEMTS;
     hand.max_len = MAX_VL_LEN;
     hand.d       = 1;
+    hand.json_file = NULL;
  
-    while ((opt = getopt_long(argc, argv, "hm:n:d:", long_options, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "hm:n:d:j:", long_options, NULL)) != -1) {
         switch (opt) {
             case 'h':
                 fprintf(stdout, "Help page:\n");
@@ -130,6 +161,15 @@ parse_command_line(int argc, char *argv[])
                 else
                     printf("optarg is null\n");
                 break;
+            case 'j':
+                /* The file for the results as JSON lines */
+                if (optarg) {
+                    fprintf(stdout, "JSON results file:\t\t\t\t%s\n", optarg);
+                    hand.json_file = optarg;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
             case ':':
                 printf("option needs a value\n");
                 break;
@@ -161,6 +201,91 @@ parse_command_line(int argc, char *argv[])
     }
 }
 
+/*------------------------------------------------------------
+ * Print used storage and timings
+ *------------------------------------------------------------
+ */
+void print_results(void)
+{
+    long long int structured      = st.pairs + st.blob;
+    long long int structured_comp = st.pairs_comp + st.blob_comp;
+
+    printf("\n");
+    printf("Printing the storage of the VL dataset (VS), of the structured datasets (STS) and of their compressed\n");
+    printf("counterparts (CVS, CSTS) in bytes; the VL storage does not include the global heap\n");
+    printf("\n");
+    printf("        VS        CVS        STS       CSTS\n");
+    printf("\n");
+    printf("%10lli %10lli %10lli %10lli \n", st.vl, st.vl_comp, structured, structured_comp);
+
+    printf("\n");
+    printf("Printing the sizes of the files %s (F1), %s (F2), %s (F3), %s (F4) in bytes and the\n",
+           FILE_NAME1, FILE_NAME2, FILE_NAME3, FILE_NAME4);
+    printf("storage ratios F1/F3 (SR) and F2/F4 (CSR)\n");
+    printf("\n");
+    printf("        F1         F2         F3         F4         SR        CSR\n");
+    printf("\n");
+    printf("%10lli %10lli %10lli %10lli %10.1f %10.1f \n", st.file[0], st.file[1], st.file[2], st.file[3],
+           (float)st.file[0] / st.file[2], (float)st.file[1] / st.file[3]);
+
+    printf("\n");
+    printf("Printing the time to write the VL dataset (TV), the structured datasets (TS) and their compressed\n");
+    printf("counterparts (TCV, TCS) in seconds\n");
+    printf("\n");
+    printf("        TV        TCV         TS        TCS\n");
+    printf("\n");
+    printf("%10.4f %10.4f %10.4f %10.4f \n", st.t_vl, st.t_vl_comp, st.t_struct, st.t_struct_comp);
+    printf("\n");
+}
+
+/*------------------------------------------------------------
+ * Elapsed time
+ *------------------------------------------------------------
+ */
+double elapsed(struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*------------------------------------------------------------
+ * Append the results to the JSON lines file as one object
+ * with the parameters, sizes, timings and the environment
+ *------------------------------------------------------------
+ */
+int print_json(void)
+{
+    FILE     *f;
+    char      host[256] = "unknown";
+    char      date[32];
+    time_t    now = time(NULL);
+    unsigned  major, minor, release;
+
+    if (NULL == (f = fopen(hand.json_file, "a"))) {
+        printf("Failed to open %s\n", hand.json_file);
+        return -1;
+    }
+
+    gethostname(host, sizeof(host) - 1);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+    H5get_libversion(&major, &minor, &release);
+
+    fprintf(f, "{\"benchmark\": \"%s\", \"nelemts\": %lld, \"max_len\": %lld, \"d\": %d, \"total_len\": %lld, ",
+            BENCHMARK_NAME, hand.nelemts, hand.max_len, hand.d, st.total_len);
+    fprintf(f, "\"vl\": %lld, \"vl_comp\": %lld, \"pairs\": %lld, \"pairs_comp\": %lld, \"blob\": %lld, "
+               "\"blob_comp\": %lld, ", st.vl, st.vl_comp, st.pairs, st.pairs_comp, st.blob, st.blob_comp);
+    fprintf(f, "\"file1\": %lld, \"file2\": %lld, \"file3\": %lld, \"file4\": %lld, ", st.file[0], st.file[1],
+            st.file[2], st.file[3]);
+    fprintf(f, "\"t_vl\": %.6f, \"t_vl_comp\": %.6f, \"t_struct\": %.6f, \"t_struct_comp\": %.6f, ", st.t_vl,
+            st.t_vl_comp, st.t_struct, st.t_struct_comp);
+    fprintf(f, "\"host\": \"%s\", \"hdf5\": \"%u.%u.%u\", \"date\": \"%s\"}\n", host, major, minor, release, date);
+
+    fclose(f);
+    return 0;
+}
+
 /*------------------------------------------------------------
  * Create datasets
  *------------------------------------------------------------
@@ -177,6 +302,7 @@ int create_dsets(hid_t file, hid_t file_comp, hid_t file_struct, hid_t file_stru
     uint     offset = 0, total_len = 0;
     char    *all_strings, *ptr;
     int     i, j;
+    struct timespec start;
 
     /* Allocate and initialize variable-length elements */ 
     vl_data = (hvl_t *)malloc(hand.nelemts * sizeof(hvl_t));
@@ -237,10 +363,17 @@ int create_dsets(hid_t file, hid_t file_comp, hid_t file_struct, hid_t file_stru
     dset_compressed = H5Dcreate2(file_comp, VL_DSET_COMP_NAME, dtype, dataspace, H5P_DEFAULT, dcpl_compressed, H5P_DEFAULT);
 
     /* Write the data to the dataset */
+    clock_gettime(CLOCK_MONOTONIC, &start);
     H5Dwrite(dset, dtype, H5S_ALL, H5S_ALL, H5P_DEFAULT, vl_data);
+    st.t_vl = elapsed(&start);
+    st.vl   = (long long int)H5Dget_storage_size(dset);
 
     /* Write the data to the dataset with compression */
+    clock_gettime(CLOCK_MONOTONIC, &start);
     H5Dwrite(dset_compressed, dtype, H5S_ALL, H5S_ALL, H5P_DEFAULT, vl_data);
+    st.t_vl_comp = elapsed(&start);
+    st.vl_comp   = (long long int)H5Dget_storage_size(dset_compressed);
+    st.total_len = (long long int)total_len;
 
     H5Sclose(dataspace);
     H5Dclose(dset);
@@ -266,10 +399,16 @@ int create_dsets(hid_t file, hid_t file_comp, hid_t file_struct, hid_t file_stru
     dset_compressed = H5Dcreate2(file_struct_comp, OFFSET_LENGTH_DSET_COMP_NAME, H5T_NATIVE_INT, dataspace, H5P_DEFAULT, dcpl_compressed, H5P_DEFAULT);
 
     /* Write the data to the dataset */
+    clock_gettime(CLOCK_MONOTONIC, &start);
     H5Dwrite(dset, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, the_pairs);
+    st.t_struct = elapsed(&start);
+    st.pairs    = (long long int)H5Dget_storage_size(dset);
 
     /* Write the data to the dataset with compression */
+    clock_gettime(CLOCK_MONOTONIC, &start);
     H5Dwrite(dset_compressed, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, the_pairs);
+    st.t_struct_comp = elapsed(&start);
+    st.pairs_comp    = (long long int)H5Dget_storage_size(dset_compressed);
 
     H5Sclose(dataspace);
     H5Dclose(dset);
@@ -295,10 +434,16 @@ int create_dsets(hid_t file, hid_t file_comp, hid_t file_struct, hid_t file_stru
     dset_compressed = H5Dcreate2(file_struct_comp, VL_DATA_DSET_COMP_NAME, H5T_NATIVE_CHAR, dataspace, H5P_DEFAULT, dcpl_compressed, H5P_DEFAULT);
 
     /* Write the data to the dataset */
+    clock_gettime(CLOCK_MONOTONIC, &start);
     H5Dwrite(dset, H5T_NATIVE_CHAR, H5S_ALL, H5S_ALL, H5P_DEFAULT, all_strings);
+    st.t_struct += elapsed(&start);
+    st.blob      = (long long int)H5Dget_storage_size(dset);
 
     /* Write the data to the dataset with compression */
+    clock_gettime(CLOCK_MONOTONIC, &start);
     H5Dwrite(dset_compressed, H5T_NATIVE_CHAR, H5S_ALL, H5S_ALL, H5P_DEFAULT, all_strings);
+    st.t_struct_comp += elapsed(&start);
+    st.blob_comp      = (long long int)H5Dget_storage_size(dset_compressed);
 
     H5Sclose(dataspace);
     H5Dclose(dset);
@@ -348,11 +493,27 @@ main(int argc, char **argv)
     /* Create datasets */
     create_dsets(file, file_comp, file_struct, file_struct_comp);
 
+    /* Get the file sizes with the global heap */
+    H5Fflush(file, H5F_SCOPE_GLOBAL);
+    H5Fflush(file_comp, H5F_SCOPE_GLOBAL);
+    H5Fflush(file_struct, H5F_SCOPE_GLOBAL);
+    H5Fflush(file_struct_comp, H5F_SCOPE_GLOBAL);
+    H5Fget_filesize(file, (hsize_t *)&st.file[0]);
+    H5Fget_filesize(file_comp, (hsize_t *)&st.file[1]);
+    H5Fget_filesize(file_struct, (hsize_t *)&st.file[2]);
+    H5Fget_filesize(file_struct_comp, (hsize_t *)&st.file[3]);
+
     /* Close resources */
     H5Fclose(file);
     H5Fclose(file_comp);
     H5Fclose(file_struct);
     H5Fclose(file_struct_comp);
 
+    /* Print results */
+    print_results();
+
+    if (hand.json_file)
+        print_json();
+
     return 0;
 }